@@ -127,6 +127,7 @@ typedef struct
    rc_runtime_t runtime;
    rcheevos_rapatchdata_t patchdata; /* ptr alignment */
    rcheevos_memory_regions_t memory; /* ptr alignment */
+   rcheevos_memory_snapshot_t snapshot; /* ptr alignment */
 
    retro_task_t* task;
 #ifdef HAVE_THREADS
@@ -150,6 +151,7 @@ static rcheevos_locals_t rcheevos_locals =
    {0},  /* runtime */
    {0},  /* patchdata */
    {{0}},/* memory */
+   {0},  /* snapshot */
    NULL, /* task */
 #ifdef HAVE_THREADS
    NULL, /* task_lock */
@@ -478,7 +480,15 @@ uint8_t* rcheevos_patch_address(unsigned address)
 
 static unsigned rcheevos_peek(unsigned address, unsigned num_bytes, void* ud)
 {
-   uint8_t* data = rcheevos_memory_find(&rcheevos_locals.memory, address);
+   uint8_t* data;
+   unsigned value;
+
+   /* Usually it's already been read for this frame */
+   if (rcheevos_memory_snapshot_peek(&rcheevos_locals.snapshot,
+            address, num_bytes, &value))
+      return value;
+
+   data = rcheevos_memory_find(&rcheevos_locals.memory, address);
    if (data)
    {
       switch (num_bytes)
@@ -1286,6 +1296,7 @@ bool rcheevos_unload(void)
    {
       rcheevos_free_patchdata(&rcheevos_locals.patchdata);
       rcheevos_memory_destroy(&rcheevos_locals.memory);
+      rcheevos_memory_snapshot_destroy(&rcheevos_locals.snapshot);
 #ifdef HAVE_MENU
       cheevos_reset_menu_badges();
 #endif
@@ -1536,6 +1547,8 @@ Test all the achievements (call once per frame).
 *****************************************************************************/
 void rcheevos_test(void)
 {
+   static struct retro_perf_counter rcheevos_test_perf = {0};
+   bool perfcnt_enable;
    settings_t* settings;
 
    if (!rcheevos_locals.loaded)
@@ -1559,7 +1572,15 @@ void rcheevos_test(void)
       }
    }
 
+   perfcnt_enable = rarch_ctl(RARCH_CTL_IS_PERFCNT_ENABLE, NULL);
+   performance_counter_init(rcheevos_test_perf, "rcheevos_test");
+   performance_counter_start_plus(perfcnt_enable, rcheevos_test_perf);
+
+   rcheevos_memory_snapshot_update(&rcheevos_locals.snapshot,
+         &rcheevos_locals.memory, rcheevos_locals.runtime.memrefs);
    rc_runtime_do_frame(&rcheevos_locals.runtime, &rcheevos_runtime_event_handler, rcheevos_peek, NULL, 0);
+
+   performance_counter_stop_plus(perfcnt_enable, rcheevos_test_perf);
 }
 
 void rcheevos_set_support_cheevos(bool state)
@@ -46,6 +46,148 @@ uint8_t* rcheevos_memory_find(
    return NULL;
 }
 
+/* rcheevos leaves memory references with this address alone */
+#define RCHEEVOS_MEMREF_PLACEHOLDER_ADDRESS 0xFFFFFFFF
+
+/* How many bytes rcheevos will ask for to read a reference of this size */
+static unsigned rcheevos_memory_peek_size(char size)
+{
+   switch (size)
+   {
+      case RC_MEMSIZE_8_BITS:
+      case RC_MEMSIZE_LOW:
+      case RC_MEMSIZE_HIGH:
+      case RC_MEMSIZE_BIT_0:
+      case RC_MEMSIZE_BIT_1:
+      case RC_MEMSIZE_BIT_2:
+      case RC_MEMSIZE_BIT_3:
+      case RC_MEMSIZE_BIT_4:
+      case RC_MEMSIZE_BIT_5:
+      case RC_MEMSIZE_BIT_6:
+      case RC_MEMSIZE_BIT_7:
+         return 1;
+      case RC_MEMSIZE_16_BITS:
+         return 2;
+      case RC_MEMSIZE_24_BITS:
+      case RC_MEMSIZE_32_BITS:
+         return 4;
+      default:
+         break;
+   }
+
+   return 0;
+}
+
+/**
+ * rcheevos_memory_snapshot_update:
+ *
+ * Reads every memory reference the runtime is about to evaluate, once, in
+ * the order it will ask for them. Addresses are only resolved again when the
+ * regions have been rebuilt or a reference has moved (indirect ones do).
+ **/
+void rcheevos_memory_snapshot_update(rcheevos_memory_snapshot_t* snapshot,
+      const rcheevos_memory_regions_t* regions,
+      const struct rc_memref_value_t* memrefs)
+{
+   const rc_memref_value_t* memref;
+   unsigned count = 0;
+
+   if (snapshot->generation != regions->generation)
+   {
+      snapshot->count      = 0;
+      snapshot->generation = regions->generation;
+   }
+
+   for (memref = memrefs; memref; memref = memref->next)
+   {
+      rcheevos_memory_ref_t* ref;
+      const uint8_t* data;
+      unsigned num_bytes;
+
+      if (memref->memref.address == RCHEEVOS_MEMREF_PLACEHOLDER_ADDRESS)
+         continue;
+
+      num_bytes = rcheevos_memory_peek_size(memref->memref.size);
+      if (num_bytes == 0)
+         continue;
+
+      if (count == snapshot->capacity)
+      {
+         unsigned capacity = snapshot->capacity ? snapshot->capacity * 2 : 64;
+         rcheevos_memory_ref_t* refs = (rcheevos_memory_ref_t*)realloc(
+               snapshot->refs, capacity * sizeof(*refs));
+         if (!refs)
+            break;
+         snapshot->refs     = refs;
+         snapshot->capacity = capacity;
+      }
+
+      ref = &snapshot->refs[count];
+      if (count >= snapshot->count ||
+            ref->address   != memref->memref.address ||
+            ref->num_bytes != num_bytes)
+      {
+         ref->address   = memref->memref.address;
+         ref->num_bytes = num_bytes;
+         ref->data      = rcheevos_memory_find(regions, ref->address);
+      }
+
+      data = ref->data;
+      if (data)
+      {
+         switch (num_bytes)
+         {
+            case 4:
+               ref->value = (data[3] << 24) | (data[2] << 16) |
+                            (data[1] <<  8) | (data[0]);
+               break;
+            case 2:
+               ref->value = (data[1] << 8)  | (data[0]);
+               break;
+            default:
+               ref->value = data[0];
+               break;
+         }
+      }
+
+      count++;
+   }
+
+   /* Anything past here is stale, whatever was resolved last frame */
+   snapshot->count = count;
+   snapshot->next  = 0;
+}
+
+/**
+ * rcheevos_memory_snapshot_peek:
+ *
+ * Answers a read from the snapshot if it's the one the runtime was expected
+ * to make next. Returns false if it must be looked up the slow way, which
+ * includes reads of addresses that aren't backed by anything.
+ **/
+bool rcheevos_memory_snapshot_peek(rcheevos_memory_snapshot_t* snapshot,
+      unsigned address, unsigned num_bytes, unsigned* value)
+{
+   const rcheevos_memory_ref_t* ref;
+
+   if (snapshot->next >= snapshot->count)
+      return false;
+
+   ref = &snapshot->refs[snapshot->next];
+   if (ref->address != address || ref->num_bytes != num_bytes)
+      return false;
+
+   snapshot->next++;
+   *value = ref->value;
+   return ref->data != NULL;
+}
+
+void rcheevos_memory_snapshot_destroy(rcheevos_memory_snapshot_t* snapshot)
+{
+   free(snapshot->refs);
+   memset(snapshot, 0, sizeof(*snapshot));
+}
+
 static const char* rcheevos_memory_type(int type)
 {
    switch (type)
@@ -309,7 +451,9 @@ static void rcheevos_memory_init_from_unmapped_memory(rcheevos_memory_regions_t*
 
 void rcheevos_memory_destroy(rcheevos_memory_regions_t* regions)
 {
+   unsigned generation = regions->generation + 1;
    memset(regions, 0, sizeof(*regions));
+   regions->generation = generation;
 }
 
 bool rcheevos_memory_init(rcheevos_memory_regions_t* regions, int console)
@@ -347,6 +491,7 @@ bool rcheevos_memory_init(rcheevos_memory_regions_t* regions, int console)
       }
    }
 
+   new_regions.generation = regions->generation + 1;
    memcpy(regions, &new_regions, sizeof(*regions));
    return has_valid_region;
 }
@@ -25,20 +25,49 @@ RETRO_BEGIN_DECLS
 
 #define MAX_MEMORY_REGIONS 32
 
+struct rc_memref_value_t;
+
 typedef struct
 {
    uint8_t* data[MAX_MEMORY_REGIONS];
    size_t size[MAX_MEMORY_REGIONS];
    size_t total_size;
    unsigned count;
+   unsigned generation; /* bumped whenever the regions are rebuilt */
 } rcheevos_memory_regions_t;
 
+typedef struct
+{
+   uint8_t* data; /* NULL if the address isn't backed by anything */
+   unsigned address;
+   unsigned num_bytes;
+   unsigned value;
+} rcheevos_memory_ref_t;
+
+/* The runtime's memory references resolved to pointers, and their values as
+ * of the start of the frame, in the order the runtime reads them */
+typedef struct
+{
+   rcheevos_memory_ref_t* refs;
+   unsigned count;
+   unsigned capacity;
+   unsigned next;
+   unsigned generation;
+} rcheevos_memory_snapshot_t;
+
 bool rcheevos_memory_init(rcheevos_memory_regions_t* regions, int console);
 void rcheevos_memory_destroy(rcheevos_memory_regions_t* regions);
 
 uint8_t* rcheevos_memory_find(const rcheevos_memory_regions_t* regions,
       unsigned address);
 
+void rcheevos_memory_snapshot_update(rcheevos_memory_snapshot_t* snapshot,
+      const rcheevos_memory_regions_t* regions,
+      const struct rc_memref_value_t* memrefs);
+bool rcheevos_memory_snapshot_peek(rcheevos_memory_snapshot_t* snapshot,
+      unsigned address, unsigned num_bytes, unsigned* value);
+void rcheevos_memory_snapshot_destroy(rcheevos_memory_snapshot_t* snapshot);
+
 RETRO_END_DECLS
 
 #endif
@@ -22,12 +22,21 @@
 #include <streams/file_stream.h>
 #include <lists/dir_list.h>
 #include <file/archive_file.h>
+#include <array/rbuf.h>
+#include <queues/task_queue.h>
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
 #endif
 
+#if (defined(_WIN32) && !defined(_XBOX)) || defined(__unix__) || defined(__APPLE__)
+#include <sys/types.h>
+#include <sys/stat.h>
+#define CORE_INFO_HAVE_CACHE
+#endif
+
 #include "retroarch.h"
+#include "command.h"
 
 #include "core_info.h"
 #include "file_path_special.h"
@@ -50,6 +59,125 @@ enum compare_op
    COMPARE_OP_GREATER_EQUAL
 };
 
+#define CORE_INFO_CACHE_MAGIC       0x464E4943 /* 'CINF' */
+#define CORE_INFO_CACHE_VERSION     1
+#define CORE_INFO_CACHE_FILE        "core_info.cache"
+#define CORE_INFO_CACHE_NONE        0xFFFFFFFF
+/* Info files checked per iteration of the verify task */
+#define CORE_INFO_CACHE_VERIFY_STEP 32
+
+enum
+{
+   CORE_INFO_CACHE_HDR_MAGIC = 0,
+   CORE_INFO_CACHE_HDR_VERSION,
+   CORE_INFO_CACHE_HDR_CORES,
+   CORE_INFO_CACHE_HDR_FIRMWARE,
+   CORE_INFO_CACHE_HDR_TEXT_SIZE,
+   CORE_INFO_CACHE_HDR_CORES_DIR,
+   CORE_INFO_CACHE_HDR_INFO_DIR,
+   CORE_INFO_CACHE_HDR_INFO_MTIME_LO,
+   CORE_INFO_CACHE_HDR_INFO_MTIME_HI,
+   CORE_INFO_CACHE_HEADER_WORDS
+};
+
+/* String fields of core_info_t, see core_info_get_strings() */
+enum
+{
+   CORE_INFO_CACHE_STR_DISPLAY_NAME = 0,
+   CORE_INFO_CACHE_STR_DISPLAY_VERSION,
+   CORE_INFO_CACHE_STR_CORE_NAME,
+   CORE_INFO_CACHE_STR_SYSTEM_MANUFACTURER,
+   CORE_INFO_CACHE_STR_SYSTEMNAME,
+   CORE_INFO_CACHE_STR_SYSTEM_ID,
+   CORE_INFO_CACHE_STR_SUPPORTED_EXTENSIONS,
+   CORE_INFO_CACHE_STR_AUTHORS,
+   CORE_INFO_CACHE_STR_PERMISSIONS,
+   CORE_INFO_CACHE_STR_LICENSES,
+   CORE_INFO_CACHE_STR_CATEGORIES,
+   CORE_INFO_CACHE_STR_DATABASES,
+   CORE_INFO_CACHE_STR_NOTES,
+   CORE_INFO_CACHE_STR_REQUIRED_HW_API,
+   CORE_INFO_CACHE_STR_DESCRIPTION,
+   CORE_INFO_CACHE_STR_COUNT
+};
+
+enum
+{
+   CORE_INFO_CACHE_CORE_PATH = 0,
+   CORE_INFO_CACHE_CORE_MTIME_LO, /* of the .info file */
+   CORE_INFO_CACHE_CORE_MTIME_HI,
+   CORE_INFO_CACHE_CORE_SIZE_LO,
+   CORE_INFO_CACHE_CORE_SIZE_HI,
+   CORE_INFO_CACHE_CORE_FLAGS,
+   CORE_INFO_CACHE_CORE_FIRMWARE_FIRST,
+   CORE_INFO_CACHE_CORE_FIRMWARE_COUNT,
+   CORE_INFO_CACHE_CORE_STRINGS, /* CORE_INFO_CACHE_STR_COUNT words */
+   CORE_INFO_CACHE_CORE_WORDS =
+      CORE_INFO_CACHE_CORE_STRINGS + CORE_INFO_CACHE_STR_COUNT
+};
+
+enum
+{
+   CORE_INFO_CACHE_FIRMWARE_PATH = 0,
+   CORE_INFO_CACHE_FIRMWARE_DESC,
+   CORE_INFO_CACHE_FIRMWARE_OPTIONAL,
+   CORE_INFO_CACHE_FIRMWARE_WORDS
+};
+
+enum core_info_cache_flags
+{
+   CORE_INFO_CACHE_FLAG_HAS_INFO                      = (1 << 0),
+   CORE_INFO_CACHE_FLAG_SUPPORTS_NO_GAME              = (1 << 1),
+   CORE_INFO_CACHE_FLAG_DATABASE_MATCH_ARCHIVE_MEMBER = (1 << 2),
+   CORE_INFO_CACHE_FLAG_IS_EXPERIMENTAL               = (1 << 3),
+   CORE_INFO_CACHE_FLAG_MMAP_CONTENT                  = (1 << 4)
+};
+
+typedef struct
+{
+   const char *key;
+   const char *key2;
+   size_t *cores; /* RBUF of positions in the list */
+   size_t key_len;
+   size_t key2_len;
+   uint32_t hash; /* 0 for empty slots */
+} core_info_index_entry_t;
+
+typedef struct
+{
+   core_info_index_entry_t *entries;
+   size_t cap; /* power of two */
+} core_info_index_table_t;
+
+struct core_info_index
+{
+   core_info_index_table_t exts;
+   core_info_index_table_t databases;
+   core_info_index_table_t ext_databases;
+};
+
+typedef struct core_info_index core_info_index_t;
+
+typedef struct
+{
+   uint8_t *data;
+   const uint32_t *header;
+   const uint32_t *cores;
+   const uint32_t *firmware;
+   const char *text;
+   size_t size;
+} core_info_cache_t;
+
+/* State of the background task that checks the info
+ * files of cores read from the cache */
+typedef struct
+{
+   struct string_list *info_paths;
+   uint64_t *stats; /* mtime and size of each info file */
+   size_t index;
+   bool stale;
+} core_info_cache_verify_t;
+
 static void core_info_list_resolve_all_extensions(
       core_info_list_t *core_info_list)
 {
@@ -90,57 +218,450 @@ static void core_info_list_resolve_all_extensions(
 #endif
 }
 
-static void core_info_list_resolve_all_firmware(
-      core_info_list_t *core_info_list)
+/* Inverted index of the core info list
+ *
+ * Maps supported extensions and databases to the cores
+ * listing them, and extension+database pairs to whether
+ * any core lists both (those entries hold no cores), so capability queries do not have
+ * to scan the string lists of every core. Keys are
+ * matched without regard to case, like the string list
+ * searches they replace. Cores are referenced by their
+ * position in the list, which core_info_list_sort()
+ * keeps up to date. */
+static uint32_t core_info_index_hash(uint32_t hash,
+      const char *s, size_t len)
 {
    size_t i;
-   unsigned c;
-
-   for (i = 0; i < core_info_list->count; i++)
+   for (i = 0; i < len; i++)
    {
-      unsigned count                  = 0;
-      core_info_firmware_t *firmware  = NULL;
-      core_info_t *info               = (core_info_t*)&core_info_list->list[i];
-      config_file_t *config           = (config_file_t*)info->config_data;
+      unsigned char c = (unsigned char)s[i];
+      hash = (hash ^ (uint32_t)((c >= 'A' && c <= 'Z')
+               ? (c | 0x20) : c)) * (uint32_t)0x01000193;
+   }
+   return hash;
+}
 
-      if (!config || !config_get_uint(config, "firmware_count", &count))
-         continue;
+static uint32_t core_info_index_key_hash(const char *key, size_t key_len,
+      const char *key2, size_t key2_len)
+{
+   uint32_t hash = core_info_index_hash((uint32_t)0x811c9dc5, key, key_len);
 
-      firmware = (core_info_firmware_t*)calloc(count, sizeof(*firmware));
+   if (key2)
+      hash = core_info_index_hash(hash * (uint32_t)0x01000193,
+            key2, key2_len);
 
-      if (!firmware)
-         continue;
+   /* Zero marks an empty slot */
+   return hash ? hash : 1;
+}
 
-      info->firmware = firmware;
+/* Returns the entry for 'key' (and 'key2', for the
+ * extension+database table). If there is none yet,
+ * one is added if 'add' is set, else NULL is returned */
+static core_info_index_entry_t *core_info_index_find(
+      core_info_index_table_t *table,
+      const char *key, size_t key_len,
+      const char *key2, size_t key2_len, bool add)
+{
+   size_t i;
+   uint32_t hash;
 
-      for (c = 0; c < count; c++)
+   if (!table->cap)
+      return NULL;
+
+   hash = core_info_index_key_hash(key, key_len, key2, key2_len);
+
+   for (i = hash & (table->cap - 1);; i = (i + 1) & (table->cap - 1))
+   {
+      core_info_index_entry_t *entry = &table->entries[i];
+
+      if (!entry->hash)
       {
-         char path_key[64];
-         char desc_key[64];
-         char opt_key[64];
-         struct config_entry_list 
-            *entry         = NULL;
-         bool tmp_bool     = false;
-         path_key[0]       = desc_key[0] = opt_key[0] = '\0';
+         if (!add)
+            return NULL;
+
+         entry->hash     = hash;
+         entry->key      = key;
+         entry->key_len  = key_len;
+         entry->key2     = key2;
+         entry->key2_len = key2_len;
+         return entry;
+      }
+
+      if (     entry->hash    == hash
+            && entry->key_len == key_len
+            && !strncasecmp(entry->key, key, key_len)
+            && (!key2 || (entry->key2_len == key2_len
+                  && !strncasecmp(entry->key2, key2, key2_len))))
+         return entry;
+   }
+}
+
+static core_info_index_entry_t *core_info_index_add(
+      core_info_index_table_t *table, const char *key, const char *key2)
+{
+   size_t key_len = strlen(key);
 
-         snprintf(path_key, sizeof(path_key), "firmware%u_path", c);
-         snprintf(desc_key, sizeof(desc_key), "firmware%u_desc", c);
-         snprintf(opt_key,  sizeof(opt_key),  "firmware%u_opt",  c);
+   if (!key_len)
+      return NULL;
 
-         entry             = config_get_entry(config, path_key);
+   return core_info_index_find(table, key, key_len,
+         key2, key2 ? strlen(key2) : 0, true);
+}
 
-         if (entry && !string_is_empty(entry->value))
-            info->firmware[c].path = strdup(entry->value);
+static void core_info_index_add_core(core_info_index_entry_t *entry,
+      size_t pos)
+{
+   /* A core listing a key twice is indexed once */
+   if (entry && (!RBUF_LEN(entry->cores)
+            || RBUF_END(entry->cores)[-1] != pos))
+      RBUF_PUSH(entry->cores, pos);
+}
 
-         entry             = config_get_entry(config, desc_key);
+static bool core_info_index_table_init(core_info_index_table_t *table,
+      size_t count)
+{
+   /* Keep the load factor at or below one half */
+   size_t cap = 16;
+   while (cap < count * 2)
+      cap <<= 1;
 
-         if (entry && !string_is_empty(entry->value))
-            info->firmware[c].desc     = strdup(entry->value);
+   if (!(table->entries = (core_info_index_entry_t*)
+            calloc(cap, sizeof(*table->entries))))
+      return false;
 
-         if (config_get_bool(config, opt_key , &tmp_bool))
-            info->firmware[c].optional = tmp_bool;
+   table->cap = cap;
+   return true;
+}
+
+static void core_info_index_table_free(core_info_index_table_t *table)
+{
+   size_t i;
+
+   for (i = 0; i < table->cap; i++)
+      RBUF_FREE(table->entries[i].cores);
+
+   free(table->entries);
+   table->entries = NULL;
+   table->cap     = 0;
+}
+
+static void core_info_index_free(core_info_index_t *index)
+{
+   if (!index)
+      return;
+
+   core_info_index_table_free(&index->exts);
+   core_info_index_table_free(&index->databases);
+   core_info_index_table_free(&index->ext_databases);
+   free(index);
+}
+
+static void core_info_list_build_index(core_info_list_t *core_info_list)
+{
+   size_t i, j, k;
+   size_t num_exts          = 0;
+   size_t num_databases     = 0;
+   size_t num_ext_databases = 0;
+   core_info_index_t *index = (core_info_index_t*)
+      calloc(1, sizeof(*index));
+
+   if (!index)
+      return;
+
+   for (i = 0; i < core_info_list->count; i++)
+   {
+      const core_info_t *info = &core_info_list->list[i];
+      size_t exts             = info->supported_extensions_list
+         ? info->supported_extensions_list->size : 0;
+      size_t databases        = info->databases_list
+         ? info->databases_list->size : 0;
+
+      num_exts              += exts;
+      num_databases         += databases;
+      num_ext_databases     += exts * databases;
+   }
+
+   if (     !core_info_index_table_init(&index->exts, num_exts)
+         || !core_info_index_table_init(&index->databases, num_databases)
+         || !core_info_index_table_init(&index->ext_databases,
+            num_ext_databases))
+   {
+      core_info_index_free(index);
+      return;
+   }
+
+   for (i = 0; i < core_info_list->count; i++)
+   {
+      const core_info_t *info              = &core_info_list->list[i];
+      const struct string_list *exts       = info->supported_extensions_list;
+      const struct string_list *databases  = info->databases_list;
+
+      if (exts)
+      {
+         for (j = 0; j < exts->size; j++)
+         {
+            const char *ext = exts->elems[j].data;
+
+            /* Listed with or without the leading '.' */
+            core_info_index_add_core(core_info_index_add(&index->exts,
+                     (ext[0] == '.') ? ext + 1 : ext, NULL), i);
+
+            if (databases)
+               for (k = 0; k < databases->size; k++)
+                  core_info_index_add(&index->ext_databases,
+                        ext, databases->elems[k].data);
+         }
       }
+
+      if (databases)
+         for (j = 0; j < databases->size; j++)
+            core_info_index_add_core(core_info_index_add(
+                     &index->databases, databases->elems[j].data, NULL), i);
+   }
+
+   core_info_list->index = index;
+}
+
+/* Returns the cores supporting extension 'ext',
+ * setting 'count' to their number */
+static const size_t *core_info_list_find_ext(
+      const core_info_list_t *core_info_list, const char *ext,
+      size_t *count)
+{
+   core_info_index_entry_t *entry = NULL;
+
+   *count = 0;
+
+   if (!core_info_list->index || string_is_empty(ext))
+      return NULL;
+
+   if (!(entry = core_info_index_find(&core_info_list->index->exts,
+               ext, strlen(ext), NULL, 0, false)))
+      return NULL;
+
+   *count = RBUF_LEN(entry->cores);
+   return entry->cores;
+}
+
+/* Reorders the cores of 'core_info_list' by 'cmp', which
+ * is passed pointers to core_info_t pointers, and moves
+ * the positions in the index along with them */
+static void core_info_list_sort(core_info_list_t *core_info_list,
+      int (*cmp)(const void *, const void *))
+{
+   size_t i, j, k;
+   size_t count            = core_info_list->count;
+   core_info_t **sorted    = NULL;
+   core_info_t *reordered  = NULL;
+   size_t *new_pos         = NULL;
+   core_info_index_t *index = core_info_list->index;
+
+   if (count < 2)
+      return;
+
+   sorted    = (core_info_t**)malloc(count * sizeof(*sorted));
+   reordered = (core_info_t*)malloc(count * sizeof(*reordered));
+   new_pos   = (size_t*)malloc(count * sizeof(*new_pos));
+
+   if (!sorted || !reordered || !new_pos)
+      goto end;
+
+   for (i = 0; i < count; i++)
+      sorted[i] = &core_info_list->list[i];
+
+   qsort(sorted, count, sizeof(*sorted), cmp);
+
+   for (i = 0; i < count; i++)
+   {
+      reordered[i]                              = *sorted[i];
+      new_pos[sorted[i] - core_info_list->list] = i;
+   }
+
+   memcpy(core_info_list->list, reordered, count * sizeof(*reordered));
+
+   if (index)
+   {
+      core_info_index_table_t *tables[2];
+      tables[0] = &index->exts;
+      tables[1] = &index->databases;
+
+      for (i = 0; i < 2; i++)
+         for (j = 0; j < tables[i]->cap; j++)
+         {
+            size_t *cores = tables[i]->entries[j].cores;
+            for (k = 0; k < RBUF_LEN(cores); k++)
+               cores[k] = new_pos[cores[k]];
+         }
    }
+
+end:
+   free(sorted);
+   free(reordered);
+   free(new_pos);
+}
+
+/* Core info cache
+ *
+ * Parsing hundreds of small .info files dominates startup
+ * on slow storage, so the parsed info of all cores is kept
+ * in a single file.
+ *
+ * All values are native endian 32-bit words. After the
+ * header come the core records (sorted by core path), the
+ * firmware records and finally the text, which holds all
+ * strings. Strings are stored as offsets into the text,
+ * CORE_INFO_CACHE_NONE marks a missing one.
+ *
+ * A core record is used as is while the info directory
+ * has not been modified since the cache was written,
+ * otherwise its .info file is checked first. Info files
+ * replaced in place do not touch the directory, so a
+ * background task checks all of them once the list has
+ * been built and reloads the list if any have changed. */
+static void core_info_get_strings(core_info_t *info,
+      char **strings[CORE_INFO_CACHE_STR_COUNT])
+{
+   strings[CORE_INFO_CACHE_STR_DISPLAY_NAME]         = &info->display_name;
+   strings[CORE_INFO_CACHE_STR_DISPLAY_VERSION]      = &info->display_version;
+   strings[CORE_INFO_CACHE_STR_CORE_NAME]            = &info->core_name;
+   strings[CORE_INFO_CACHE_STR_SYSTEM_MANUFACTURER]  = &info->system_manufacturer;
+   strings[CORE_INFO_CACHE_STR_SYSTEMNAME]           = &info->systemname;
+   strings[CORE_INFO_CACHE_STR_SYSTEM_ID]            = &info->system_id;
+   strings[CORE_INFO_CACHE_STR_SUPPORTED_EXTENSIONS] = &info->supported_extensions;
+   strings[CORE_INFO_CACHE_STR_AUTHORS]              = &info->authors;
+   strings[CORE_INFO_CACHE_STR_PERMISSIONS]          = &info->permissions;
+   strings[CORE_INFO_CACHE_STR_LICENSES]             = &info->licenses;
+   strings[CORE_INFO_CACHE_STR_CATEGORIES]           = &info->categories;
+   strings[CORE_INFO_CACHE_STR_DATABASES]            = &info->databases;
+   strings[CORE_INFO_CACHE_STR_NOTES]                = &info->notes;
+   strings[CORE_INFO_CACHE_STR_REQUIRED_HW_API]      = &info->required_hw_api;
+   strings[CORE_INFO_CACHE_STR_DESCRIPTION]          = &info->description;
+}
+
+static void core_info_split_lists(core_info_t *info)
+{
+   if (info->supported_extensions)
+      info->supported_extensions_list =
+         string_split(info->supported_extensions, "|");
+   if (info->authors)
+      info->authors_list         = string_split(info->authors, "|");
+   if (info->permissions)
+      info->permissions_list     = string_split(info->permissions, "|");
+   if (info->licenses)
+      info->licenses_list        = string_split(info->licenses, "|");
+   if (info->categories)
+      info->categories_list      = string_split(info->categories, "|");
+   if (info->databases)
+      info->databases_list       = string_split(info->databases, "|");
+   if (info->notes)
+      info->note_list            = string_split(info->notes, "|");
+   if (info->required_hw_api)
+      info->required_hw_api_list = string_split(info->required_hw_api, "|");
+}
+
+static void core_info_resolve_firmware(core_info_t *info,
+      config_file_t *config)
+{
+   unsigned c;
+   unsigned count                 = 0;
+   core_info_firmware_t *firmware = NULL;
+
+   if (!config_get_uint(config, "firmware_count", &count) || !count)
+      return;
+
+   firmware = (core_info_firmware_t*)calloc(count, sizeof(*firmware));
+
+   if (!firmware)
+      return;
+
+   info->firmware       = firmware;
+   info->firmware_count = count;
+
+   for (c = 0; c < count; c++)
+   {
+      char path_key[64];
+      char desc_key[64];
+      char opt_key[64];
+      struct config_entry_list 
+         *entry         = NULL;
+      bool tmp_bool     = false;
+      path_key[0]       = desc_key[0] = opt_key[0] = '\0';
+
+      snprintf(path_key, sizeof(path_key), "firmware%u_path", c);
+      snprintf(desc_key, sizeof(desc_key), "firmware%u_desc", c);
+      snprintf(opt_key,  sizeof(opt_key),  "firmware%u_opt",  c);
+
+      entry             = config_get_entry(config, path_key);
+
+      if (entry && !string_is_empty(entry->value))
+         info->firmware[c].path = strdup(entry->value);
+
+      entry             = config_get_entry(config, desc_key);
+
+      if (entry && !string_is_empty(entry->value))
+         info->firmware[c].desc     = strdup(entry->value);
+
+      if (config_get_bool(config, opt_key , &tmp_bool))
+         info->firmware[c].optional = tmp_bool;
+   }
+}
+
+/* Fills 'info' from a parsed .info file. The string
+ * lists are split afterwards by core_info_split_lists() */
+static void core_info_parse_config_file(core_info_t *info,
+      config_file_t *conf)
+{
+   /* Keys in CORE_INFO_CACHE_STR_* order */
+   static const char *keys[CORE_INFO_CACHE_STR_COUNT] = {
+      "display_name",
+      "display_version",
+      "corename",
+      "manufacturer",
+      "systemname",
+      "systemid",
+      "supported_extensions",
+      "authors",
+      "permissions",
+      "license",
+      "categories",
+      "database",
+      "notes",
+      "required_hw_api",
+      "description"
+   };
+   size_t i;
+   char **strings[CORE_INFO_CACHE_STR_COUNT];
+   bool tmp_bool = false;
+
+   core_info_get_strings(info, strings);
+
+   for (i = 0; i < CORE_INFO_CACHE_STR_COUNT; i++)
+   {
+      struct config_entry_list *entry = config_get_entry(conf, keys[i]);
+
+      if (entry && !string_is_empty(entry->value))
+         *strings[i] = strdup(entry->value);
+   }
+
+   if (config_get_bool(conf, "supports_no_game",
+            &tmp_bool))
+      info->supports_no_game = tmp_bool;
+
+   if (config_get_bool(conf, "database_match_archive_member",
+            &tmp_bool))
+      info->database_match_archive_member = tmp_bool;
+
+   if (config_get_bool(conf, "is_experimental",
+            &tmp_bool))
+      info->is_experimental = tmp_bool;
+
+   if (config_get_bool(conf, "mmap_content",
+            &tmp_bool))
+      info->mmap_content = tmp_bool;
+
+   core_info_resolve_firmware(info, conf);
+
+   info->has_info = true;
 }
 
 static void core_info_list_free(core_info_list_t *core_info_list)
@@ -178,7 +699,6 @@ static void core_info_list_free(core_info_list_t *core_info_list)
       string_list_free(info->categories_list);
       string_list_free(info->databases_list);
       string_list_free(info->required_hw_api_list);
-      config_file_free((config_file_t*)info->config_data);
 
       for (j = 0; j < info->firmware_count; j++)
       {
@@ -190,26 +710,21 @@ static void core_info_list_free(core_info_list_t *core_info_list)
       free(info->core_file_id.str);
    }
 
+   core_info_index_free(core_info_list->index);
    free(core_info_list->all_ext);
    free(core_info_list->list);
    free(core_info_list);
 }
 
-static config_file_t *core_info_list_iterate(
-      const char *current_path,
-      const char *path_basedir)
+static void core_info_get_info_path(char *s, size_t len,
+      const char *core_path, const char *path_basedir)
 {
-   char info_path[PATH_MAX_LENGTH];
    char info_path_base[PATH_MAX_LENGTH];
 
-   if (!current_path)
-      return NULL;
-
-   info_path     [0]          = '\0';
-   info_path_base[0]          = '\0';
+   info_path_base[0] = '\0';
 
    fill_pathname_base_noext(info_path_base,
-         current_path,
+         core_path,
          sizeof(info_path_base));
 
 #if defined(RARCH_MOBILE) || (defined(RARCH_CONSOLE) && !defined(PSP) && !defined(_3DS) && !defined(VITA) && !defined(HW_WUP))
@@ -222,33 +737,529 @@ static config_file_t *core_info_list_iterate(
 
    strlcat(info_path_base, ".info", sizeof(info_path_base));
 
-   fill_pathname_join(info_path,
-         path_basedir,
-         info_path_base, sizeof(info_path_base));
+   fill_pathname_join(s, path_basedir, info_path_base, len);
+}
+
+static bool core_info_stat(const char *path,
+      uint64_t *mtime, uint64_t *size)
+{
+#ifdef CORE_INFO_HAVE_CACHE
+   struct stat buf;
+
+   if (stat(path, &buf) == 0)
+   {
+      *mtime = (uint64_t)buf.st_mtime;
+      *size  = (uint64_t)buf.st_size;
+      return true;
+   }
+#endif
+   *mtime = 0;
+   *size  = 0;
+   return false;
+}
+
+static bool core_info_cache_get_path(char *s, size_t len,
+      const char *dir_cache, const char *path_basedir)
+{
+#ifdef CORE_INFO_HAVE_CACHE
+   const char *dir = !string_is_empty(dir_cache)
+      ? dir_cache : path_basedir;
+
+   if (!string_is_empty(dir))
+   {
+      fill_pathname_join(s, dir, CORE_INFO_CACHE_FILE, len);
+      return true;
+   }
+#endif
+   return false;
+}
+
+/* Reads the cache file at 'path' and checks that every
+ * offset in it is in range, so the rest of the code can
+ * trust it */
+static bool core_info_cache_load(core_info_cache_t *cache,
+      const char *path, const char *dir_cores, const char *path_basedir)
+{
+   size_t i, j;
+   uint64_t words;
+   uint32_t cores, firmware, text_size;
+   const uint32_t *hdr = NULL;
+   void *buff          = NULL;
+   int64_t len         = 0;
+
+   if (     !path_is_valid(path)
+         || !filestream_read_file(path, &buff, &len))
+      return false;
+
+   cache->data = (uint8_t*)buff;
+   cache->size = (size_t)len;
+   hdr         = (const uint32_t*)cache->data;
+
+   if (cache->size < CORE_INFO_CACHE_HEADER_WORDS * sizeof(uint32_t))
+      goto error;
+
+   if (     (hdr[CORE_INFO_CACHE_HDR_MAGIC]   != CORE_INFO_CACHE_MAGIC)
+         || (hdr[CORE_INFO_CACHE_HDR_VERSION] != CORE_INFO_CACHE_VERSION))
+      goto error;
+
+   cores     = hdr[CORE_INFO_CACHE_HDR_CORES];
+   firmware  = hdr[CORE_INFO_CACHE_HDR_FIRMWARE];
+   text_size = hdr[CORE_INFO_CACHE_HDR_TEXT_SIZE];
+   words     = CORE_INFO_CACHE_HEADER_WORDS
+      + (uint64_t)cores    * CORE_INFO_CACHE_CORE_WORDS
+      + (uint64_t)firmware * CORE_INFO_CACHE_FIRMWARE_WORDS;
+
+   if (!text_size || words * sizeof(uint32_t) + text_size != cache->size)
+      goto error;
+
+   cache->header   = hdr;
+   cache->cores    = hdr + CORE_INFO_CACHE_HEADER_WORDS;
+   cache->firmware = cache->cores + cores * CORE_INFO_CACHE_CORE_WORDS;
+   cache->text     = (const char*)(cache->firmware
+         + firmware * CORE_INFO_CACHE_FIRMWARE_WORDS);
+
+   /* The directories the cache was built from */
+   if (     cache->text[text_size - 1] != '\0'
+         || hdr[CORE_INFO_CACHE_HDR_CORES_DIR] >= text_size
+         || hdr[CORE_INFO_CACHE_HDR_INFO_DIR]  >= text_size
+         || !string_is_equal(cache->text
+            + hdr[CORE_INFO_CACHE_HDR_CORES_DIR], dir_cores)
+         || !string_is_equal(cache->text
+            + hdr[CORE_INFO_CACHE_HDR_INFO_DIR], path_basedir))
+      goto error;
+
+   for (i = 0; i != cores; i++)
+   {
+      const uint32_t *rec = cache->cores + i * CORE_INFO_CACHE_CORE_WORDS;
+
+      if (     rec[CORE_INFO_CACHE_CORE_PATH] >= text_size
+            || (uint64_t)rec[CORE_INFO_CACHE_CORE_FIRMWARE_FIRST]
+             + rec[CORE_INFO_CACHE_CORE_FIRMWARE_COUNT] > firmware)
+         goto error;
+
+      for (j = 0; j != CORE_INFO_CACHE_STR_COUNT; j++)
+      {
+         uint32_t offset = rec[CORE_INFO_CACHE_CORE_STRINGS + j];
+         if (offset != CORE_INFO_CACHE_NONE && offset >= text_size)
+            goto error;
+      }
+   }
+
+   for (i = 0; i != firmware; i++)
+   {
+      const uint32_t *rec = cache->firmware
+         + i * CORE_INFO_CACHE_FIRMWARE_WORDS;
+
+      for (j = CORE_INFO_CACHE_FIRMWARE_PATH;
+            j <= CORE_INFO_CACHE_FIRMWARE_DESC; j++)
+         if (rec[j] != CORE_INFO_CACHE_NONE && rec[j] >= text_size)
+            goto error;
+   }
+
+   return true;
+
+error:
+   free(cache->data);
+   memset(cache, 0, sizeof(*cache));
+   return false;
+}
+
+/* Returns the record of the core at 'core_path',
+ * or NULL if it is not in the cache */
+static const uint32_t *core_info_cache_find(const core_info_cache_t *cache,
+      const char *core_path)
+{
+   size_t lo = 0;
+   size_t hi = cache->header[CORE_INFO_CACHE_HDR_CORES];
+
+   while (lo < hi)
+   {
+      size_t mid          = lo + (hi - lo) / 2;
+      const uint32_t *rec = cache->cores + mid * CORE_INFO_CACHE_CORE_WORDS;
+      int cmp             = strcmp(core_path,
+            cache->text + rec[CORE_INFO_CACHE_CORE_PATH]);
+
+      if (!cmp)
+         return rec;
+      if (cmp < 0)
+         hi = mid;
+      else
+         lo = mid + 1;
+   }
 
-   if (path_is_valid(info_path))
-      return config_file_new_from_path_to_string(info_path);
    return NULL;
 }
 
+static bool core_info_cache_stat_equal(const uint32_t *rec,
+      uint64_t mtime, uint64_t size)
+{
+   return rec[CORE_INFO_CACHE_CORE_MTIME_LO] == (uint32_t)mtime
+       && rec[CORE_INFO_CACHE_CORE_MTIME_HI] == (uint32_t)(mtime >> 32)
+       && rec[CORE_INFO_CACHE_CORE_SIZE_LO]  == (uint32_t)size
+       && rec[CORE_INFO_CACHE_CORE_SIZE_HI]  == (uint32_t)(size >> 32);
+}
+
+/* Fills 'info' from cache record 'rec'. The string
+ * lists are split afterwards by core_info_split_lists() */
+static void core_info_cache_read(core_info_t *info,
+      const core_info_cache_t *cache, const uint32_t *rec)
+{
+   size_t i;
+   char **strings[CORE_INFO_CACHE_STR_COUNT];
+   uint32_t flags                 = rec[CORE_INFO_CACHE_CORE_FLAGS];
+   uint32_t count                 = rec[CORE_INFO_CACHE_CORE_FIRMWARE_COUNT];
+   const uint32_t *fw             = cache->firmware
+      + rec[CORE_INFO_CACHE_CORE_FIRMWARE_FIRST]
+      * CORE_INFO_CACHE_FIRMWARE_WORDS;
+   core_info_firmware_t *firmware = NULL;
+
+   core_info_get_strings(info, strings);
+
+   for (i = 0; i < CORE_INFO_CACHE_STR_COUNT; i++)
+   {
+      uint32_t offset = rec[CORE_INFO_CACHE_CORE_STRINGS + i];
+
+      if (offset != CORE_INFO_CACHE_NONE)
+         *strings[i] = strdup(cache->text + offset);
+   }
+
+   info->has_info                      =
+      !!(flags & CORE_INFO_CACHE_FLAG_HAS_INFO);
+   info->supports_no_game              =
+      !!(flags & CORE_INFO_CACHE_FLAG_SUPPORTS_NO_GAME);
+   info->database_match_archive_member =
+      !!(flags & CORE_INFO_CACHE_FLAG_DATABASE_MATCH_ARCHIVE_MEMBER);
+   info->is_experimental               =
+      !!(flags & CORE_INFO_CACHE_FLAG_IS_EXPERIMENTAL);
+   info->mmap_content                  =
+      !!(flags & CORE_INFO_CACHE_FLAG_MMAP_CONTENT);
+
+   if (!count || !(firmware = (core_info_firmware_t*)
+            calloc(count, sizeof(*firmware))))
+      return;
+
+   info->firmware       = firmware;
+   info->firmware_count = count;
+
+   for (i = 0; i < count; i++, fw += CORE_INFO_CACHE_FIRMWARE_WORDS)
+   {
+      if (fw[CORE_INFO_CACHE_FIRMWARE_PATH] != CORE_INFO_CACHE_NONE)
+         firmware[i].path = strdup(cache->text
+               + fw[CORE_INFO_CACHE_FIRMWARE_PATH]);
+      if (fw[CORE_INFO_CACHE_FIRMWARE_DESC] != CORE_INFO_CACHE_NONE)
+         firmware[i].desc = strdup(cache->text
+               + fw[CORE_INFO_CACHE_FIRMWARE_DESC]);
+      firmware[i].optional = !!fw[CORE_INFO_CACHE_FIRMWARE_OPTIONAL];
+   }
+}
+
+static uint32_t core_info_cache_add_text(char **text, const char *str)
+{
+   uint32_t offset;
+   size_t len;
+
+   if (!str)
+      return CORE_INFO_CACHE_NONE;
+
+   offset = (uint32_t)RBUF_LEN(*text);
+   len    = strlen(str) + 1;
+
+   RBUF_RESIZE(*text, offset + len);
+   memcpy(*text + offset, str, len);
+   return offset;
+}
+
+static int core_info_cache_qsort_cmp(const void *a_, const void *b_)
+{
+   const core_info_t *a = *(const core_info_t**)a_;
+   const core_info_t *b = *(const core_info_t**)b_;
+   return strcmp(a->path, b->path);
+}
+
+/* Writes the info of all cores in 'core_info_list'
+ * to the cache file at 'path'. 'stats' holds the
+ * modification time and size of the .info file of
+ * each core, or zeroes where it is missing. The
+ * file is written under a temporary name and renamed
+ * when complete, so readers never see a partial file */
+static bool core_info_cache_write(const char *path,
+      const core_info_list_t *core_info_list, const uint64_t *stats,
+      const char *dir_cores, const char *path_basedir,
+      uint64_t info_dir_mtime)
+{
+   size_t i, j;
+   char dir[PATH_MAX_LENGTH];
+   char tmp_path[PATH_MAX_LENGTH];
+   uint32_t header[CORE_INFO_CACHE_HEADER_WORDS];
+   const core_info_t **sorted = NULL;
+   uint32_t *words            = NULL;
+   uint32_t *firmware         = NULL;
+   char *text                 = NULL;
+   RFILE *file                = NULL;
+   size_t count               = 0;
+   bool success               = false;
+
+   if (!(sorted = (const core_info_t**)malloc(
+               (core_info_list->count + 1) * sizeof(*sorted))))
+      return false;
+
+   for (i = 0; i < core_info_list->count; i++)
+      if (core_info_list->list[i].path)
+         sorted[count++] = &core_info_list->list[i];
+
+   qsort(sorted, count, sizeof(*sorted), core_info_cache_qsort_cmp);
+
+   memset(header, 0, sizeof(header));
+   header[CORE_INFO_CACHE_HDR_MAGIC]          = CORE_INFO_CACHE_MAGIC;
+   header[CORE_INFO_CACHE_HDR_VERSION]        = CORE_INFO_CACHE_VERSION;
+   header[CORE_INFO_CACHE_HDR_CORES]          = (uint32_t)count;
+   header[CORE_INFO_CACHE_HDR_CORES_DIR]      =
+      core_info_cache_add_text(&text, dir_cores);
+   header[CORE_INFO_CACHE_HDR_INFO_DIR]       =
+      core_info_cache_add_text(&text, path_basedir);
+   header[CORE_INFO_CACHE_HDR_INFO_MTIME_LO]  = (uint32_t)info_dir_mtime;
+   header[CORE_INFO_CACHE_HDR_INFO_MTIME_HI]  =
+      (uint32_t)(info_dir_mtime >> 32);
+
+   for (i = 0; i < count; i++)
+   {
+      char **strings[CORE_INFO_CACHE_STR_COUNT];
+      core_info_t *info   = (core_info_t*)sorted[i];
+      size_t idx          = info - core_info_list->list;
+      uint64_t mtime      = stats[idx * 2];
+      uint64_t size       = stats[idx * 2 + 1];
+      uint32_t flags      = 0;
+
+
+      if (info->has_info)
+         flags |= CORE_INFO_CACHE_FLAG_HAS_INFO;
+      if (info->supports_no_game)
+         flags |= CORE_INFO_CACHE_FLAG_SUPPORTS_NO_GAME;
+      if (info->database_match_archive_member)
+         flags |= CORE_INFO_CACHE_FLAG_DATABASE_MATCH_ARCHIVE_MEMBER;
+      if (info->is_experimental)
+         flags |= CORE_INFO_CACHE_FLAG_IS_EXPERIMENTAL;
+      if (info->mmap_content)
+         flags |= CORE_INFO_CACHE_FLAG_MMAP_CONTENT;
+
+      RBUF_PUSH(words, core_info_cache_add_text(&text, info->path));
+      RBUF_PUSH(words, (uint32_t)mtime);
+      RBUF_PUSH(words, (uint32_t)(mtime >> 32));
+      RBUF_PUSH(words, (uint32_t)size);
+      RBUF_PUSH(words, (uint32_t)(size >> 32));
+      RBUF_PUSH(words, flags);
+      RBUF_PUSH(words, (uint32_t)(RBUF_LEN(firmware)
+               / CORE_INFO_CACHE_FIRMWARE_WORDS));
+      RBUF_PUSH(words, (uint32_t)info->firmware_count);
+
+      core_info_get_strings(info, strings);
+      for (j = 0; j < CORE_INFO_CACHE_STR_COUNT; j++)
+         RBUF_PUSH(words, core_info_cache_add_text(&text, *strings[j]));
+
+      for (j = 0; j < info->firmware_count; j++)
+      {
+         RBUF_PUSH(firmware, core_info_cache_add_text(&text,
+                  info->firmware[j].path));
+         RBUF_PUSH(firmware, core_info_cache_add_text(&text,
+                  info->firmware[j].desc));
+         RBUF_PUSH(firmware, info->firmware[j].optional ? 1 : 0);
+      }
+
+   }
+
+   header[CORE_INFO_CACHE_HDR_FIRMWARE]  = (uint32_t)(RBUF_LEN(firmware)
+         / CORE_INFO_CACHE_FIRMWARE_WORDS);
+   header[CORE_INFO_CACHE_HDR_TEXT_SIZE] = (uint32_t)RBUF_LEN(text);
+
+   fill_pathname_basedir(dir, path, sizeof(dir));
+   strlcpy(tmp_path, path, sizeof(tmp_path));
+   strlcat(tmp_path, ".tmp", sizeof(tmp_path));
+
+   if (     (path_is_directory(dir) || path_mkdir(dir))
+         && (file = filestream_open(tmp_path,
+               RETRO_VFS_FILE_ACCESS_WRITE,
+               RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+   {
+      success = (filestream_write(file, header, sizeof(header))
+               == sizeof(header))
+            && (filestream_write(file, words, RBUF_SIZEOF(words))
+               == (int64_t)RBUF_SIZEOF(words))
+            && (filestream_write(file, firmware, RBUF_SIZEOF(firmware))
+               == (int64_t)RBUF_SIZEOF(firmware))
+            && (filestream_write(file, text, RBUF_SIZEOF(text))
+               == (int64_t)RBUF_SIZEOF(text));
+
+      filestream_close(file);
+
+      if (success)
+      {
+         /* rename() will not replace an existing
+          * file on all platforms */
+         if (path_is_valid(path))
+            filestream_delete(path);
+         success = (filestream_rename(tmp_path, path) == 0);
+      }
+
+      if (!success)
+         filestream_delete(tmp_path);
+   }
+
+   free(sorted);
+   RBUF_FREE(words);
+   RBUF_FREE(firmware);
+   RBUF_FREE(text);
+   return success;
+}
+
+static void task_core_info_cache_verify_free(
+      core_info_cache_verify_t *verify)
+{
+   if (!verify)
+      return;
+
+   string_list_free(verify->info_paths);
+   free(verify->stats);
+   free(verify);
+}
+
+static void task_core_info_cache_verify_handler(retro_task_t *task)
+{
+   core_info_cache_verify_t *verify = (core_info_cache_verify_t*)
+      task->state;
+   size_t end                       = verify->index
+      + CORE_INFO_CACHE_VERIFY_STEP;
+
+   if (end > verify->info_paths->size)
+      end = verify->info_paths->size;
+
+   for (; verify->index < end; verify->index++)
+   {
+      uint64_t mtime, size;
+      size_t i = verify->index;
+
+      core_info_stat(verify->info_paths->elems[i].data, &mtime, &size);
+
+      if (     mtime != verify->stats[i * 2]
+            || size  != verify->stats[i * 2 + 1])
+      {
+         verify->stale = true;
+         break;
+      }
+   }
+
+   if (     verify->stale
+         || verify->index >= verify->info_paths->size
+         || task_get_cancelled(task))
+      task_set_finished(task, true);
+}
+
+static void task_core_info_cache_verify_cleanup(retro_task_t *task)
+{
+   task_core_info_cache_verify_free(
+         (core_info_cache_verify_t*)task->state);
+   task->state = NULL;
+}
+
+/* Reloads the core info list when any of the info
+ * files it was read from the cache for has changed.
+ * This must be done on the main thread */
+static void cb_task_core_info_cache_verify(
+      retro_task_t *task, void *task_data,
+      void *user_data, const char *err)
+{
+   char core_path[PATH_MAX_LENGTH];
+   core_info_state_t *p_coreinfo    = coreinfo_get_ptr();
+   core_info_cache_verify_t *verify = (core_info_cache_verify_t*)
+      task->state;
+
+   if (!verify || !verify->stale || task_get_cancelled(task))
+      return;
+
+   core_path[0] = '\0';
+
+   /* The current core info is a copy of a list entry */
+   if (p_coreinfo->current && !string_is_empty(p_coreinfo->current->path))
+      strlcpy(core_path, p_coreinfo->current->path, sizeof(core_path));
+
+   p_coreinfo->cache_verify = true;
+   command_event(CMD_EVENT_CORE_INFO_INIT, NULL);
+   p_coreinfo->cache_verify = false;
+
+   if (!string_is_empty(core_path))
+   {
+      core_info_ctx_find_t info;
+      info.inf  = NULL;
+      info.path = core_path;
+      core_info_load(&info, p_coreinfo);
+   }
+}
+
+static void task_push_core_info_cache_verify(
+      core_info_cache_verify_t *verify)
+{
+   retro_task_t *task = task_init();
+
+   if (!task)
+   {
+      task_core_info_cache_verify_free(verify);
+      return;
+   }
+
+   task->handler  = task_core_info_cache_verify_handler;
+   task->state    = verify;
+   task->callback = cb_task_core_info_cache_verify;
+   task->cleanup  = task_core_info_cache_verify_cleanup;
+   task->mute     = true;
+
+   task_queue_push(task);
+}
+
 static core_info_list_t *core_info_list_new(const char *path,
       const char *libretro_info_dir,
       const char *exts,
-      bool dir_show_hidden_files)
+      const char *dir_cache,
+      bool dir_show_hidden_files,
+      bool verify_cache)
 {
    size_t i;
+   char cache_path[PATH_MAX_LENGTH];
    struct string_list contents      = {0};
+   struct string_list locks         = {0};
+   core_info_cache_t cache;
    core_info_t *core_info           = NULL;
    core_info_list_t *core_info_list = NULL;
+   core_info_cache_verify_t *verify = NULL;
+   uint64_t *stats                  = NULL;
    const char       *path_basedir   = libretro_info_dir;
+   uint64_t info_dir_mtime          = 0;
+   uint64_t info_dir_size           = 0;
+   size_t num_local                 = 0;
+   size_t num_cached                = 0;
+   bool cache_dirty                 = false;
    bool                          ok = false;
 
+   cache_path[0] = '\0';
+   memset(&cache, 0, sizeof(cache));
+
    string_list_initialize(&contents);
+   string_list_initialize(&locks);
 
    if (dir_list_append(&contents, path, exts,
          false, dir_show_hidden_files, false, false))
       ok                            = true;
 
+   /* Lock files can only exist next to cores in the
+    * cores directory, so one listing replaces checking
+    * each core separately */
+   num_local                        = contents.size;
+#if defined(ANDROID)
+   /* Play Store builds do not support
+    * core locking */
+   if (!play_feature_delivery_enabled())
+#endif
+      dir_list_append(&locks, path, FILE_PATH_LOCK_EXTENSION + 1,
+            false, dir_show_hidden_files, false, false);
+
 #if defined(__WINRT__) || defined(WINAPI_FAMILY) && WINAPI_FAMILY == WINAPI_FAMILY_PHONE_APP
    {
       /* UWP: browse the optional packages for additional cores */
@@ -276,12 +1287,17 @@ static core_info_list_t *core_info_list_new(const char *path,
    core_info_list->list    = NULL;
    core_info_list->count   = 0;
    core_info_list->all_ext = NULL;
+   core_info_list->index   = NULL;
 
    core_info               = (core_info_t*)
       calloc(contents.size, sizeof(*core_info));
+   stats                   = (uint64_t*)
+      calloc(contents.size * 2 + 1, sizeof(*stats));
 
-   if (!core_info)
+   if (!core_info || !stats)
    {
+      free(core_info);
+      free(stats);
       core_info_list_free(core_info_list);
       goto error;
    }
@@ -289,143 +1305,101 @@ static core_info_list_t *core_info_list_new(const char *path,
    core_info_list->list    = core_info;
    core_info_list->count   = contents.size;
 
-   for (i = 0; i < contents.size; i++)
-   {
-      const char *base_path = contents.elems[i].data;
-      config_file_t *conf   = core_info_list_iterate(base_path,
-            path_basedir);
+   if (core_info_cache_get_path(cache_path, sizeof(cache_path),
+            dir_cache, path_basedir))
+      core_info_stat(path_basedir, &info_dir_mtime, &info_dir_size);
 
-      if (conf)
+   if (     !string_is_empty(cache_path)
+         && core_info_cache_load(&cache, cache_path, path, path_basedir))
+   {
+      /* Info files added, removed or renamed since the
+       * cache was written show up in the directory */
+      if (     cache.header[CORE_INFO_CACHE_HDR_INFO_MTIME_LO]
+            != (uint32_t)info_dir_mtime
+            || cache.header[CORE_INFO_CACHE_HDR_INFO_MTIME_HI]
+            != (uint32_t)(info_dir_mtime >> 32))
+         verify_cache = true;
+
+      if (!verify_cache && (verify = (core_info_cache_verify_t*)
+               calloc(1, sizeof(*verify))))
       {
-         bool tmp_bool      = false;
-         unsigned tmp_uint  = 0;
-         struct config_entry_list 
-            *entry = config_get_entry(conf, "display_name");
-
-         if (entry && !string_is_empty(entry->value))
-            core_info[i].display_name = strdup(entry->value);
-
-         entry = config_get_entry(conf, "display_version");
-
-         if (entry && !string_is_empty(entry->value))
-            core_info[i].display_version = strdup(entry->value);
-
-         entry = config_get_entry(conf, "corename");
-
-         if (entry && !string_is_empty(entry->value))
-            core_info[i].core_name = strdup(entry->value);
-
-         entry = config_get_entry(conf, "systemname");
+         verify->info_paths = string_list_new();
+         verify->stats      = (uint64_t*)
+            calloc(contents.size * 2 + 1, sizeof(*verify->stats));
 
-         if (entry && !string_is_empty(entry->value))
-               core_info[i].systemname = strdup(entry->value);
-
-         entry = config_get_entry(conf, "systemid");
-
-         if (entry && !string_is_empty(entry->value))
-            core_info[i].system_id = strdup(entry->value);
-
-         entry = config_get_entry(conf, "manufacturer");
-
-         if (entry && !string_is_empty(entry->value))
-            core_info[i].system_manufacturer = strdup(entry->value);
-
-         config_get_uint(conf, "firmware_count", &tmp_uint);
-         core_info[i].firmware_count = tmp_uint;
-
-         entry = config_get_entry(conf, "supported_extensions");
-
-         if (entry && !string_is_empty(entry->value))
+         if (!verify->info_paths || !verify->stats)
          {
-            core_info[i].supported_extensions      = strdup(entry->value);
-            core_info[i].supported_extensions_list =
-               string_split(core_info[i].supported_extensions, "|");
+            task_core_info_cache_verify_free(verify);
+            verify = NULL;
          }
+      }
+   }
 
-         entry = config_get_entry(conf, "authors");
+   for (i = 0; i < contents.size; i++)
+   {
+      char info_path[PATH_MAX_LENGTH];
+      const char *base_path = contents.elems[i].data;
+      const uint32_t *rec   = NULL;
 
-         if (entry && !string_is_empty(entry->value))
-         {
-            core_info[i].authors      = strdup(entry->value);
-            core_info[i].authors_list =
-               string_split(core_info[i].authors, "|");
-         }
+      if (string_is_empty(base_path))
+         continue;
 
-         entry = config_get_entry(conf, "permissions");
+      info_path[0]          = '\0';
+      core_info_get_info_path(info_path, sizeof(info_path),
+            base_path, path_basedir);
 
-         if (entry && !string_is_empty(entry->value))
-         {
-            core_info[i].permissions      = strdup(entry->value);
-            core_info[i].permissions_list =
-               string_split(core_info[i].permissions, "|");
-         }
+      if (cache.data)
+         rec = core_info_cache_find(&cache, base_path);
 
-         entry = config_get_entry(conf, "license");
+      if (rec && verify_cache)
+      {
+         uint64_t mtime, size;
+         core_info_stat(info_path, &mtime, &size);
+         if (!core_info_cache_stat_equal(rec, mtime, size))
+            rec = NULL;
+      }
 
-         if (entry && !string_is_empty(entry->value))
-         {
-            core_info[i].licenses      = strdup(entry->value);
-            core_info[i].licenses_list =
-               string_split(core_info[i].licenses, "|");
-         }
+      if (rec)
+      {
+         core_info_cache_read(&core_info[i], &cache, rec);
 
-         entry = config_get_entry(conf, "categories");
+         stats[i * 2]     = rec[CORE_INFO_CACHE_CORE_MTIME_LO]
+            | ((uint64_t)rec[CORE_INFO_CACHE_CORE_MTIME_HI] << 32);
+         stats[i * 2 + 1] = rec[CORE_INFO_CACHE_CORE_SIZE_LO]
+            | ((uint64_t)rec[CORE_INFO_CACHE_CORE_SIZE_HI] << 32);
+         num_cached++;
 
-         if (entry && !string_is_empty(entry->value))
+         if (verify)
          {
-            core_info[i].categories      = strdup(entry->value);
-            core_info[i].categories_list =
-               string_split(core_info[i].categories, "|");
-         }
-
-         entry = config_get_entry(conf, "database");
+            union string_list_elem_attr attr;
+            attr.i = 0;
 
-         if (entry && !string_is_empty(entry->value))
-         {
-            core_info[i].databases      = strdup(entry->value);
-            core_info[i].databases_list =
-               string_split(core_info[i].databases, "|");
+            verify->stats[verify->info_paths->size * 2]     = stats[i * 2];
+            verify->stats[verify->info_paths->size * 2 + 1] = stats[i * 2 + 1];
+            string_list_append(verify->info_paths, info_path, attr);
          }
+      }
+      else
+      {
+         core_info_stat(info_path, &stats[i * 2], &stats[i * 2 + 1]);
 
-         entry = config_get_entry(conf, "notes");
-
-         if (entry && !string_is_empty(entry->value))
+         if (path_is_valid(info_path))
          {
-            core_info[i].notes     = strdup(entry->value);
-            core_info[i].note_list =
-               string_split(core_info[i].notes, "|");
-         }
-
-         entry = config_get_entry(conf, "required_hw_api");
+            config_file_t *conf =
+               config_file_new_from_path_to_string(info_path);
 
-         if (entry && !string_is_empty(entry->value))
-         {
-            core_info[i].required_hw_api      = strdup(entry->value);
-            core_info[i].required_hw_api_list =
-               string_split(core_info[i].required_hw_api, "|");
+            if (conf)
+            {
+               core_info_parse_config_file(&core_info[i], conf);
+               config_file_free(conf);
+            }
          }
 
-         entry = config_get_entry(conf, "description");
-
-         if (entry && !string_is_empty(entry->value))
-            core_info[i].description = strdup(entry->value);
-
-         if (config_get_bool(conf, "supports_no_game",
-                  &tmp_bool))
-            core_info[i].supports_no_game = tmp_bool;
-
-         if (config_get_bool(conf, "database_match_archive_member",
-                  &tmp_bool))
-            core_info[i].database_match_archive_member = tmp_bool;
-
-         if (config_get_bool(conf, "is_experimental",
-                  &tmp_bool))
-            core_info[i].is_experimental = tmp_bool;
-
-         core_info[i].config_data = conf;
+         cache_dirty = true;
       }
 
-      if (!string_is_empty(base_path))
+      core_info_split_lists(&core_info[i]);
+
       {
          const char *core_filename = path_basename(base_path);
 
@@ -465,17 +1439,47 @@ static core_info_list_t *core_info_list_new(const char *path,
       }
 
       /* Get core lock status */
-      core_info[i].is_locked = core_info_get_core_lock(core_info[i].path, false);
+      if (i < num_local)
+      {
+         char lock_path[PATH_MAX_LENGTH];
+         strlcpy(lock_path, base_path, sizeof(lock_path));
+         strlcat(lock_path, FILE_PATH_LOCK_EXTENSION, sizeof(lock_path));
+         core_info[i].is_locked = locks.size
+            && string_list_find_elem(&locks, lock_path);
+      }
+      else
+         core_info[i].is_locked = core_info_get_core_lock(
+               core_info[i].path, false);
    }
 
    core_info_list_resolve_all_extensions(core_info_list);
-   core_info_list_resolve_all_firmware(core_info_list);
+   core_info_list_build_index(core_info_list);
 
+   /* Rewrite the cache when cores were added, removed
+    * or had their info files changed */
+   if (     !string_is_empty(cache_path)
+         && (cache_dirty || !cache.data
+            || num_cached != cache.header[CORE_INFO_CACHE_HDR_CORES]))
+      core_info_cache_write(cache_path, core_info_list, stats,
+            path, path_basedir, info_dir_mtime);
+
+   if (verify)
+   {
+      if (verify->info_paths->size)
+         task_push_core_info_cache_verify(verify);
+      else
+         task_core_info_cache_verify_free(verify);
+   }
+
+   free(cache.data);
+   free(stats);
    string_list_deinitialize(&contents);
+   string_list_deinitialize(&locks);
    return core_info_list;
 
 error:
    string_list_deinitialize(&contents);
+   string_list_deinitialize(&locks);
    return NULL;
 }
 
@@ -515,32 +1519,17 @@ bool core_info_list_get_info(core_info_list_t *core_info_list,
    return false;
 }
 
-#ifdef HAVE_COMPRESSION
-static bool core_info_does_support_any_file(const core_info_t *core,
-      const struct string_list *list)
+/* Marks the cores supporting the extension of 'path' */
+static void core_info_list_mark_supported(
+      const core_info_list_t *core_info_list, const char *path,
+      bool *is_supported)
 {
-   size_t i;
-   if (!list || !core || !core->supported_extensions_list)
-      return false;
+   size_t i, count;
+   const size_t *cores = core_info_list_find_ext(core_info_list,
+         path_get_extension(path), &count);
 
-   for (i = 0; i < list->size; i++)
-      if (string_list_find_elem_prefix(core->supported_extensions_list,
-               ".", path_get_extension(list->elems[i].data)))
-         return true;
-   return false;
-}
-#endif
-
-static bool core_info_does_support_file(
-      const core_info_t *core, const char *path)
-{
-   if (!core || !core->supported_extensions_list)
-      return false;
-   if (string_is_empty(path))
-      return false;
-
-   return string_list_find_elem_prefix(
-         core->supported_extensions_list, ".", path_get_extension(path));
+   for (i = 0; i < count; i++)
+      is_supported[cores[i]] = true;
 }
 
 /* qsort_r() is not in standard C, sadly. */
@@ -548,18 +1537,12 @@ static bool core_info_does_support_file(
 static int core_info_qsort_cmp(const void *a_, const void *b_)
 {
    core_info_state_t *p_coreinfo = coreinfo_get_ptr();
-   const core_info_t          *a = (const core_info_t*)a_;
-   const core_info_t          *b = (const core_info_t*)b_;
-   int support_a                 = core_info_does_support_file(a,
-         p_coreinfo->tmp_path);
-   int support_b                 = core_info_does_support_file(b,
-         p_coreinfo->tmp_path);
-#ifdef HAVE_COMPRESSION
-   support_a            = support_a ||
-      core_info_does_support_any_file(a, p_coreinfo->tmp_list);
-   support_b            = support_b ||
-      core_info_does_support_any_file(b, p_coreinfo->tmp_list);
-#endif
+   const core_info_t          *a = *(const core_info_t**)a_;
+   const core_info_t          *b = *(const core_info_t**)b_;
+   int support_a                 =
+      p_coreinfo->tmp_supported[a - p_coreinfo->tmp_list];
+   int support_b                 =
+      p_coreinfo->tmp_supported[b - p_coreinfo->tmp_list];
 
    if (support_a != support_b)
       return support_b - support_a;
@@ -647,9 +1630,10 @@ bool core_info_init_current_core(void)
    current->database_match_archive_member = false;
    current->is_experimental               = false;
    current->is_locked                     = false;
+   current->mmap_content                  = false;
+   current->has_info                      = false;
    current->firmware_count                = 0;
    current->path                          = NULL;
-   current->config_data                   = NULL;
    current->display_name                  = NULL;
    current->display_version               = NULL;
    current->core_name                     = NULL;
@@ -700,13 +1684,15 @@ void core_info_deinit_list(void)
 }
 
 bool core_info_init_list(const char *path_info, const char *dir_cores,
-      const char *exts, bool dir_show_hidden_files)
+      const char *exts, const char *dir_cache, bool dir_show_hidden_files)
 {
    core_info_state_t *p_coreinfo = coreinfo_get_ptr();
    if (!(p_coreinfo->curr_list = core_info_list_new(dir_cores,
                !string_is_empty(path_info) ? path_info : dir_cores,
                exts,
-               dir_show_hidden_files)))
+               dir_cache,
+               dir_show_hidden_files,
+               p_coreinfo->cache_verify)))
       return false;
    return true;
 }
@@ -798,6 +1784,7 @@ void core_info_list_get_supported_cores(core_info_list_t *core_info_list,
 {
    size_t i;
    size_t supported              = 0;
+   bool *is_supported            = NULL;
 #ifdef HAVE_COMPRESSION
    struct string_list *list      = NULL;
 #endif
@@ -806,38 +1793,41 @@ void core_info_list_get_supported_cores(core_info_list_t *core_info_list,
    if (!core_info_list)
       return;
 
-   p_coreinfo->tmp_path          = path;
+   is_supported = (bool*)calloc(core_info_list->count + 1,
+         sizeof(*is_supported));
+
+   if (!is_supported)
+      return;
+
+   core_info_list_mark_supported(core_info_list, path, is_supported);
 
 #ifdef HAVE_COMPRESSION
    if (path_is_compressed_file(path))
       list = file_archive_get_file_list(path, NULL);
-   p_coreinfo->tmp_list = list;
+
+   if (list)
+   {
+      for (i = 0; i < list->size; i++)
+         core_info_list_mark_supported(core_info_list,
+               list->elems[i].data, is_supported);
+      string_list_free(list);
+   }
 #endif
 
+   p_coreinfo->tmp_list      = core_info_list->list;
+   p_coreinfo->tmp_supported = is_supported;
+
    /* Let supported core come first in list so we can return
     * a pointer to them. */
-   qsort(core_info_list->list, core_info_list->count,
-         sizeof(core_info_t), core_info_qsort_cmp);
+   core_info_list_sort(core_info_list, core_info_qsort_cmp);
 
-   for (i = 0; i < core_info_list->count; i++, supported++)
-   {
-      const core_info_t *core = &core_info_list->list[i];
-
-      if (core_info_does_support_file(core, path))
-         continue;
-
-#ifdef HAVE_COMPRESSION
-      if (core_info_does_support_any_file(core, list))
-         continue;
-#endif
+   p_coreinfo->tmp_list      = NULL;
+   p_coreinfo->tmp_supported = NULL;
 
-      break;
-   }
+   for (i = 0; i < core_info_list->count; i++)
+      supported += is_supported[i];
 
-#ifdef HAVE_COMPRESSION
-   if (list)
-      string_list_free(list);
-#endif
+   free(is_supported);
 
    *infos     = core_info_list->list;
    *num_infos = supported;
@@ -907,6 +1897,7 @@ void core_info_get_name(const char *path, char *s, size_t len,
 
    for (i = 0; i < contents.size; i++)
    {
+      char info_path[PATH_MAX_LENGTH];
       struct config_entry_list 
          *entry                       = NULL;
       config_file_t *conf             = NULL;
@@ -915,10 +1906,12 @@ void core_info_get_name(const char *path, char *s, size_t len,
       if (!string_is_equal(path_basename(current_path), core_path_basename))
          continue;
 
-      conf = core_info_list_iterate(contents.elems[i].data,
-               path_basedir);
+      info_path[0] = '\0';
+      core_info_get_info_path(info_path, sizeof(info_path),
+            current_path, path_basedir);
 
-      if (!conf)
+      if (     !path_is_valid(info_path)
+            || !(conf = config_file_new_from_path_to_string(info_path)))
          continue;
 
       if (get_display_name)
@@ -944,97 +1937,72 @@ size_t core_info_list_num_info_files(core_info_list_t *core_info_list)
       return 0;
 
    for (i = 0; i < core_info_list->count; i++)
-   {
-      config_file_t *conf = (config_file_t*)
-         core_info_list->list[i].config_data;
-      num += !!conf;
-   }
+      num += core_info_list->list[i].has_info;
 
    return num;
 }
 
-bool core_info_database_match_archive_member(const char *database_path)
+/* Sets 's' and 'len' to the name of the database at
+ * 'database_path', without directory and extension */
+static bool core_info_get_database_name(const char *database_path,
+      const char **s, size_t *len)
 {
-   char      *database           = NULL;
-   const char      *new_path     = path_basename(database_path);
-   core_info_state_t *p_coreinfo = coreinfo_get_ptr();
+   const char *name = path_basename(database_path);
+   const char *ext  = NULL;
 
-   if (string_is_empty(new_path))
+   if (string_is_empty(name))
       return false;
 
-   database                 = strdup(new_path);
-
-   if (string_is_empty(database))
-      goto error;
-
-   path_remove_extension(database);
-
-   if (p_coreinfo->curr_list)
-   {
-      size_t i;
-
-      for (i = 0; i < p_coreinfo->curr_list->count; i++)
-      {
-         const core_info_t *info = &p_coreinfo->curr_list->list[i];
+   ext  = strrchr(name, '.');
+   *s   = name;
+   *len = ext ? (size_t)(ext - name) : strlen(name);
+   return *len > 0;
+}
 
-         if (!info->database_match_archive_member)
-             continue;
+bool core_info_database_match_archive_member(const char *database_path)
+{
+   size_t i;
+   const char *database           = NULL;
+   size_t database_len            = 0;
+   core_info_index_entry_t *entry = NULL;
+   core_info_state_t *p_coreinfo  = coreinfo_get_ptr();
+   core_info_list_t *list         = p_coreinfo->curr_list;
+
+   if (     !list
+         || !list->index
+         || !core_info_get_database_name(database_path,
+            &database, &database_len))
+      return false;
 
-         if (!string_list_find_elem(info->databases_list, database))
-             continue;
+   if (!(entry = core_info_index_find(&list->index->databases,
+               database, database_len, NULL, 0, false)))
+      return false;
 
-         free(database);
+   for (i = 0; i < RBUF_LEN(entry->cores); i++)
+      if (list->list[entry->cores[i]].database_match_archive_member)
          return true;
-      }
-   }
 
-error:
-   if (database)
-      free(database);
    return false;
 }
 
 bool core_info_database_supports_content_path(
       const char *database_path, const char *path)
 {
-   char      *database           = NULL;
-   const char      *new_path     = path_basename(database_path);
+   const char *database          = NULL;
+   size_t database_len           = 0;
+   const char *ext               = path_get_extension(path);
    core_info_state_t *p_coreinfo = coreinfo_get_ptr();
+   core_info_list_t *list        = p_coreinfo->curr_list;
 
-   if (string_is_empty(new_path))
+   if (     !list
+         || !list->index
+         || string_is_empty(ext)
+         || !core_info_get_database_name(database_path,
+            &database, &database_len))
       return false;
 
-   database                 = strdup(new_path);
-
-   if (string_is_empty(database))
-      goto error;
-
-   path_remove_extension(database);
-
-   if (p_coreinfo->curr_list)
-   {
-      size_t i;
-
-      for (i = 0; i < p_coreinfo->curr_list->count; i++)
-      {
-         const core_info_t *info = &p_coreinfo->curr_list->list[i];
-
-         if (!string_list_find_elem(info->supported_extensions_list,
-                  path_get_extension(path)))
-            continue;
-
-         if (!string_list_find_elem(info->databases_list, database))
-            continue;
-
-         free(database);
-         return true;
-      }
-   }
-
-error:
-   if (database)
-      free(database);
-   return false;
+   return core_info_index_find(&list->index->ext_databases,
+         ext, strlen(ext), database, database_len, false) != NULL;
 }
 
 bool core_info_list_get_display_name(core_info_list_t *core_info_list,
@@ -1169,9 +2137,11 @@ void core_info_free_core_updater_info(core_updater_info_t *info)
    info = NULL;
 }
 
-static int core_info_qsort_func_path(const core_info_t *a,
-      const core_info_t *b)
+static int core_info_qsort_func_path(const void *a_, const void *b_)
 {
+   const core_info_t *a = *(const core_info_t**)a_;
+   const core_info_t *b = *(const core_info_t**)b_;
+
    if (!a || !b)
       return 0;
 
@@ -1181,9 +2151,11 @@ static int core_info_qsort_func_path(const core_info_t *a,
    return strcasecmp(a->path, b->path);
 }
 
-static int core_info_qsort_func_display_name(const core_info_t *a,
-      const core_info_t *b)
+static int core_info_qsort_func_display_name(const void *a_, const void *b_)
 {
+   const core_info_t *a = *(const core_info_t**)a_;
+   const core_info_t *b = *(const core_info_t**)b_;
+
    if (!a || !b)
       return 0;
 
@@ -1193,9 +2165,11 @@ static int core_info_qsort_func_display_name(const core_info_t *a,
    return strcasecmp(a->display_name, b->display_name);
 }
 
-static int core_info_qsort_func_core_name(const core_info_t *a,
-      const core_info_t *b)
+static int core_info_qsort_func_core_name(const void *a_, const void *b_)
 {
+   const core_info_t *a = *(const core_info_t**)a_;
+   const core_info_t *b = *(const core_info_t**)b_;
+
    if (!a || !b)
       return 0;
 
@@ -1205,9 +2179,11 @@ static int core_info_qsort_func_core_name(const core_info_t *a,
    return strcasecmp(a->core_name, b->core_name);
 }
 
-static int core_info_qsort_func_system_name(const core_info_t *a,
-      const core_info_t *b)
+static int core_info_qsort_func_system_name(const void *a_, const void *b_)
 {
+   const core_info_t *a = *(const core_info_t**)a_;
+   const core_info_t *b = *(const core_info_t**)b_;
+
    if (!a || !b)
       return 0;
 
@@ -1229,31 +2205,19 @@ void core_info_qsort(core_info_list_t *core_info_list,
    switch (qsort_type)
    {
       case CORE_INFO_LIST_SORT_PATH:
-         qsort(core_info_list->list,
-               core_info_list->count,
-               sizeof(core_info_t),
-               (int (*)(const void *, const void *))
+         core_info_list_sort(core_info_list,
                core_info_qsort_func_path);
          break;
       case CORE_INFO_LIST_SORT_DISPLAY_NAME:
-         qsort(core_info_list->list,
-               core_info_list->count,
-               sizeof(core_info_t),
-               (int (*)(const void *, const void *))
+         core_info_list_sort(core_info_list,
                core_info_qsort_func_display_name);
          break;
       case CORE_INFO_LIST_SORT_CORE_NAME:
-         qsort(core_info_list->list,
-               core_info_list->count,
-               sizeof(core_info_t),
-               (int (*)(const void *, const void *))
+         core_info_list_sort(core_info_list,
                core_info_qsort_func_core_name);
          break;
       case CORE_INFO_LIST_SORT_SYSTEM_NAME:
-         qsort(core_info_list->list,
-               core_info_list->count,
-               sizeof(core_info_t),
-               (int (*)(const void *, const void *))
+         core_info_list_sort(core_info_list,
                core_info_qsort_func_system_name);
          break;
       default:
@@ -63,7 +63,6 @@ typedef struct
 typedef struct
 {
    char *path;
-   void *config_data;
    char *display_name;
    char *display_version;
    char *core_name;
@@ -95,6 +94,8 @@ typedef struct
    bool database_match_archive_member;
    bool is_experimental;
    bool is_locked;
+   bool mmap_content;
+   bool has_info; /* false if the core has no .info file */
 } core_info_t;
 
 /* A subset of core_info parameters required for
@@ -111,6 +112,7 @@ typedef struct
 {
    core_info_t *list;
    char *all_ext;
+   struct core_info_index *index; /* extensions and databases to cores */
    size_t count;
 } core_info_list_t;
 
@@ -131,12 +133,13 @@ typedef struct core_info_ctx_find
 
 struct core_info_state
 {
-#ifdef HAVE_COMPRESSION
-   const struct string_list *tmp_list;
-#endif
-   const char *tmp_path;
+   const core_info_t *tmp_list;
+   const bool *tmp_supported;
    core_info_t *current;
    core_info_list_t *curr_list;
+   /* Check every cached core against its .info
+    * file when the list is next initialised */
+   bool cache_verify;
 };
 
 typedef struct core_info_state core_info_state_t;
@@ -175,8 +178,10 @@ bool core_info_get_current_core(core_info_t **core);
 
 void core_info_deinit_list(void);
 
+/* Parsed core info is kept in a cache file in 'dir_cache',
+ * or in the info directory if 'dir_cache' is empty */
 bool core_info_init_list(const char *path_info, const char *dir_cores,
-      const char *exts, bool show_hidden_files);
+      const char *exts, const char *dir_cache, bool show_hidden_files);
 
 bool core_info_get_list(core_info_list_t **core);
 
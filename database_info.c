@@ -140,21 +140,36 @@ char *bin_to_hex_alloc(const uint8_t *data, size_t len)
    return ret;
 }
 
+/* Strings read in place are not NUL-terminated */
+static char *database_info_strdup(const struct rmsgpack_dom_value *val)
+{
+   char *s;
+
+   if (val->type != RDT_STRING || val->val.string.len == 0)
+      return NULL;
+
+   if (!(s = (char*)malloc(val->val.string.len + 1)))
+      return NULL;
+
+   memcpy(s, val->val.string.buff, val->val.string.len);
+   s[val->val.string.len] = '\0';
+   return s;
+}
+
 static int database_cursor_iterate(libretrodb_cursor_t *cur,
       database_info_t *db_info)
 {
    unsigned i;
    struct rmsgpack_dom_value item;
-   const char* str                = NULL;
+   char str[64];
 
-   if (libretrodb_cursor_read_item(cur, &item) != 0)
+   /* The item is read in place from the database and
+    * must not be freed, see libretrodb_cursor_read_item_view() */
+   if (libretrodb_cursor_read_item_view(cur, &item) != 0)
       return -1;
 
    if (item.type != RDT_MAP)
-   {
-      rmsgpack_dom_value_free(&item);
       return 1;
-   }
 
    db_info->analog_supported       = -1;
    db_info->rumble_supported       = -1;
@@ -164,86 +179,77 @@ static int database_cursor_iterate(libretrodb_cursor_t *cur,
    {
       struct rmsgpack_dom_value *key = &item.val.map.items[i].key;
       struct rmsgpack_dom_value *val = &item.val.map.items[i].value;
-      const char *val_string         = NULL;
 
-      if (!key || !val)
+      if (     key->type != RDT_STRING
+            || key->val.string.len >= sizeof(str))
          continue;
 
-      val_string                     = val->val.string.buff;
-      str                            = key->val.string.buff;
+      memcpy(str, key->val.string.buff, key->val.string.len);
+      str[key->val.string.len]       = '\0';
 
       if (string_is_equal(str, "publisher"))
       {
-         if (!string_is_empty(val_string))
-            db_info->publisher = strdup(val_string);
+         db_info->publisher = database_info_strdup(val);
       }
       else if (string_is_equal(str, "developer"))
       {
-         if (!string_is_empty(val_string))
-            db_info->developer = string_split(val_string, "|");
+         char *developer = database_info_strdup(val);
+         if (developer)
+         {
+            db_info->developer = string_split(developer, "|");
+            free(developer);
+         }
       }
       else if (string_is_equal(str, "serial"))
       {
-         if (!string_is_empty(val_string))
-            db_info->serial = strdup(val_string);
+         db_info->serial = database_info_strdup(val);
       }
       else if (string_is_equal(str, "rom_name"))
       {
-         if (!string_is_empty(val_string))
-            db_info->rom_name = strdup(val_string);
+         db_info->rom_name = database_info_strdup(val);
       }
       else if (string_is_equal(str, "name"))
       {
-         if (!string_is_empty(val_string))
-            db_info->name = strdup(val_string);
+         db_info->name = database_info_strdup(val);
       }
       else if (string_is_equal(str, "description"))
       {
-         if (!string_is_empty(val_string))
-            db_info->description = strdup(val_string);
+         db_info->description = database_info_strdup(val);
       }
       else if (string_is_equal(str, "genre"))
       {
-         if (!string_is_empty(val_string))
-            db_info->genre = strdup(val_string);
+         db_info->genre = database_info_strdup(val);
       }
       else if (string_is_equal(str, "origin"))
       {
-         if (!string_is_empty(val_string))
-            db_info->origin = strdup(val_string);
+         db_info->origin = database_info_strdup(val);
       }
       else if (string_is_equal(str, "franchise"))
       {
-         if (!string_is_empty(val_string))
-            db_info->franchise = strdup(val_string);
+         db_info->franchise = database_info_strdup(val);
       }
       else if (string_ends_with_size(str, "_rating",
                strlen(str), STRLEN_CONST("_rating")))
       {
          if (string_is_equal(str, "bbfc_rating"))
          {
-            if (!string_is_empty(val_string))
-               db_info->bbfc_rating = strdup(val_string);
+            db_info->bbfc_rating = database_info_strdup(val);
          }
          else if (string_is_equal(str, "esrb_rating"))
          {
-            if (!string_is_empty(val_string))
-               db_info->esrb_rating = strdup(val_string);
+            db_info->esrb_rating = database_info_strdup(val);
          }
          else if (string_is_equal(str, "elspa_rating"))
          {
-            if (!string_is_empty(val_string))
-               db_info->elspa_rating = strdup(val_string);
+            db_info->elspa_rating = database_info_strdup(val);
          }
          else if (string_is_equal(str, "cero_rating"))
          {
-            if (!string_is_empty(val_string))
-               db_info->cero_rating          = strdup(val_string);
+            db_info->cero_rating          = database_info_strdup(val);
          }
          else if (string_is_equal(str, "pegi_rating"))
          {
-            if (!string_is_empty(val_string))
-               db_info->pegi_rating          = strdup(val_string);
+            db_info->pegi_rating          = database_info_strdup(val);
          }
          else if (string_is_equal(str, "edge_rating"))
             db_info->edge_magazine_rating    = (unsigned)val->val.uint_;
@@ -254,13 +260,11 @@ static int database_cursor_iterate(libretrodb_cursor_t *cur,
       }
       else if (string_is_equal(str, "enhancement_hw"))
       {
-         if (!string_is_empty(val_string))
-            db_info->enhancement_hw       = strdup(val_string);
+         db_info->enhancement_hw       = database_info_strdup(val);
       }
       else if (string_is_equal(str, "edge_review"))
       {
-         if (!string_is_empty(val_string))
-            db_info->edge_magazine_review = strdup(val_string);
+         db_info->edge_magazine_review = database_info_strdup(val);
       }
       else if (string_is_equal(str, "edge_issue"))
          db_info->edge_magazine_issue     = (unsigned)val->val.uint_;
@@ -279,8 +283,12 @@ static int database_cursor_iterate(libretrodb_cursor_t *cur,
       else if (string_is_equal(str, "size"))
          db_info->size                    = (unsigned)val->val.uint_;
       else if (string_is_equal(str, "crc"))
-         db_info->crc32 = swap_if_little32(
-               *(uint32_t*)val->val.binary.buff);
+      {
+         uint32_t crc32 = 0;
+         if (val->val.binary.len == sizeof(crc32))
+            memcpy(&crc32, val->val.binary.buff, sizeof(crc32));
+         db_info->crc32 = swap_if_little32(crc32);
+      }
       else if (string_is_equal(str, "sha1"))
          db_info->sha1 = bin_to_hex_alloc(
                (uint8_t*)val->val.binary.buff, val->val.binary.len);
@@ -289,8 +297,6 @@ static int database_cursor_iterate(libretrodb_cursor_t *cur,
                (uint8_t*)val->val.binary.buff, val->val.binary.len);
    }
 
-   rmsgpack_dom_value_free(&item);
-
    return 0;
 }
 
@@ -18,6 +18,62 @@
 #ifndef __NETWORK_VIDEO_COMMON_H
 #define __NETWORK_VIDEO_COMMON_H
 
+#include <stddef.h>
+#include <stdint.h>
+#include <boolean.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
+enum network_video_pixelformat
+{
+   NETWORK_VIDEO_PIXELFORMAT_RGBA8888 = 0,
+   NETWORK_VIDEO_PIXELFORMAT_BGRA8888,
+   NETWORK_VIDEO_PIXELFORMAT_RGB565
+};
+
+/* Streaming protocol.
+ *
+ * Instead of a bare framebuffer, every frame starts with a
+ * NETWORK_VIDEO_STREAM_HEADER_SIZE byte header (all fields big-endian):
+ *
+ *    uint32 magic, uint32 frame number,
+ *    uint16 width, uint16 height, uint16 tile count,
+ *    uint8  tile size, uint8 pixel format,
+ *    uint32 flags, uint32 raw payload size, uint32 payload size
+ *
+ * followed by the payload. When NETWORK_VIDEO_STREAM_DEFLATE is set,
+ * the payload is a zlib stream which inflates to 'raw payload size'
+ * bytes. The raw payload is a list of tiles, each one a uint16 tile
+ * column and uint16 tile row (big-endian), followed by the tile's
+ * 32-bit pixels row by row, clipped to the frame at the right and
+ * bottom edges. Pixels are laid out as in the raw protocol.
+ *
+ * Only tiles which changed since the previous frame are sent, unless
+ * NETWORK_VIDEO_STREAM_KEYFRAME is set, in which case every tile is.
+ */
+#define NETWORK_VIDEO_STREAM_MAGIC       0x52414e56 /* 'RANV' */
+#define NETWORK_VIDEO_STREAM_HEADER_SIZE 28
+#define NETWORK_VIDEO_STREAM_TILE_SIZE   32
+
+#define NETWORK_VIDEO_STREAM_KEYFRAME    (1 << 0)
+#define NETWORK_VIDEO_STREAM_DEFLATE     (1 << 1)
+
+/* Frames waiting for the sender thread. When the queue is full,
+ * the oldest frame is dropped so the receiver stays current. */
+#define NETWORK_VIDEO_QUEUE_SIZE         3
+#define NETWORK_VIDEO_NUM_BUFFERS        (NETWORK_VIDEO_QUEUE_SIZE + 3)
+
+typedef struct network_video_buffer
+{
+   uint32_t *data;
+   size_t capacity;
+   unsigned width;
+   unsigned height;
+   unsigned pixfmt;
+} network_video_buffer_t;
+
 typedef struct network
 {
    unsigned video_width;
@@ -27,6 +83,42 @@ typedef struct network
    char address[256];
    uint16_t port;
    int fd;
+
+   bool stream;
+   bool compress;
+   bool send_failed;
+
+   /* Scaler lookup tables, see network_video_scaler_update */
+   unsigned *scale_x;
+   unsigned *scale_y;
+   unsigned scale_src_width;
+   unsigned scale_src_height;
+   unsigned scale_dst_width;
+   unsigned scale_dst_height;
+
+   network_video_buffer_t buffers[NETWORK_VIDEO_NUM_BUFFERS];
+   network_video_buffer_t *free_list[NETWORK_VIDEO_NUM_BUFFERS];
+   network_video_buffer_t *queue[NETWORK_VIDEO_QUEUE_SIZE];
+   unsigned free_count;
+   unsigned queue_head;
+   unsigned queue_count;
+   unsigned dropped;
+
+   /* Owned by the sender */
+   network_video_buffer_t *prev;
+   uint8_t *packet;
+   size_t packet_size;
+   uint8_t *deflate_buf;
+   size_t deflate_size;
+   void *deflate_stream;
+   uint32_t frame_count;
+
+#ifdef HAVE_THREADS
+   sthread_t *thread;
+   slock_t *lock;
+   scond_t *cond;
+   bool die;
+#endif
 } network_video_t;
 
 #endif
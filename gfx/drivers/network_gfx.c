@@ -15,10 +15,14 @@
  *  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <stdlib.h>
+#include <string.h>
+
 #include <retro_miscellaneous.h>
+#include <retro_endianness.h>
 #include <retro_timers.h>
-#include <stdlib.h>
 #include <compat/strl.h>
+#include <string/stdstring.h>
 
 #ifdef HAVE_NETWORKING
 #include <net/net_compat.h>
@@ -33,6 +37,10 @@
 #include "../../menu/menu_driver.h"
 #endif
 
+#ifdef HAVE_ZLIB
+#include <streams/trans_stream.h>
+#endif
+
 #include "../font_driver.h"
 
 #include "../../driver.h"
@@ -45,12 +53,6 @@
 #define xstr(s) str(s)
 #define str(s) #s
 
-enum {
-   NETWORK_VIDEO_PIXELFORMAT_RGBA8888 = 0,
-   NETWORK_VIDEO_PIXELFORMAT_BGRA8888,
-   NETWORK_VIDEO_PIXELFORMAT_RGB565
-} network_video_pixelformat;
-
 static unsigned char *network_menu_frame = NULL;
 static unsigned network_menu_width       = 0;
 static unsigned network_menu_height      = 0;
@@ -62,7 +64,6 @@ static unsigned network_video_bits       = 0;
 static unsigned network_menu_bits        = 0;
 static bool network_rgb32                = false;
 static bool network_menu_rgb32           = false;
-static unsigned *network_video_temp_buf  = NULL;
 
 static void gfx_ctx_network_input_driver(
       const char *joypad_driver,
@@ -81,15 +82,407 @@ static void gfx_ctx_network_input_driver(
    *input_data = NULL;
 }
 
+/* Rebuilds the nearest-neighbour lookup tables whenever the source
+ * or output geometry changes, so scaling a frame costs two table
+ * loads per pixel instead of two divisions. */
+static bool network_video_scaler_update(network_video_t *network,
+      unsigned width, unsigned height)
+{
+   unsigned i;
+   unsigned dst_width  = network->screen_width;
+   unsigned dst_height = network->screen_height;
+
+   if (     network->scale_x
+         && network->scale_src_width  == width
+         && network->scale_src_height == height
+         && network->scale_dst_width  == dst_width
+         && network->scale_dst_height == dst_height)
+      return true;
+
+   free(network->scale_x);
+   free(network->scale_y);
+   network->scale_x          = (unsigned*)malloc(dst_width  * sizeof(unsigned));
+   network->scale_y          = (unsigned*)malloc(dst_height * sizeof(unsigned));
+   network->scale_src_width  = 0;
+   network->scale_src_height = 0;
+
+   if (!network->scale_x || !network->scale_y)
+   {
+      free(network->scale_x);
+      free(network->scale_y);
+      network->scale_x = NULL;
+      network->scale_y = NULL;
+      return false;
+   }
+
+   for (i = 0; i < dst_width; i++)
+      network->scale_x[i] = (width * i) / dst_width;
+   for (i = 0; i < dst_height; i++)
+      network->scale_y[i] = (height * i) / dst_height;
+
+   network->scale_src_width  = width;
+   network->scale_src_height = height;
+   network->scale_dst_width  = dst_width;
+   network->scale_dst_height = dst_height;
+
+   return true;
+}
+
+/* Scales @src to the output geometry and converts it to 32-bit.
+ * Returns the resulting pixel format. */
+static unsigned network_video_convert(network_video_t *network,
+      uint32_t *dst, const void *src, unsigned pitch,
+      unsigned bits, bool menu)
+{
+   unsigned x, y;
+   const unsigned *scale_x = network->scale_x;
+   unsigned dst_width      = network->scale_dst_width;
+   unsigned dst_height     = network->scale_dst_height;
+   bool identity           = dst_width == network->scale_src_width;
+
+   for (y = 0; y < dst_height; y++, dst += dst_width)
+   {
+      const uint8_t *row = (const uint8_t*)src + network->scale_y[y] * pitch;
+
+      if (bits == 32)
+      {
+         const uint32_t *in = (const uint32_t*)row;
+
+         if (identity)
+            memcpy(dst, in, dst_width * sizeof(uint32_t));
+         else
+            for (x = 0; x < dst_width; x++)
+               dst[x] = in[scale_x[x]];
+      }
+      else if (menu)
+      {
+         /* RGBX4444 to RGBX8888 */
+         const uint16_t *in = (const uint16_t*)row;
+
+         for (x = 0; x < dst_width; x++)
+         {
+            unsigned pixel = in[scale_x[x]];
+            unsigned r     = ((pixel & 0xF000) << 8) | ((pixel & 0xF000) << 4);
+            unsigned g     = ((pixel & 0x0F00) << 4) | ((pixel & 0x0F00) << 0);
+            unsigned b     = ((pixel & 0x00F0) << 0) | ((pixel & 0x00F0) >> 4);
+
+            dst[x]         = 0xFF000000 | b | g | r;
+         }
+      }
+      else
+      {
+         /* RGB565 to RGBX8888 */
+         const uint16_t *in = (const uint16_t*)row;
+
+         for (x = 0; x < dst_width; x++)
+         {
+            unsigned pixel = in[scale_x[x]];
+            unsigned r     = ((pixel & 0x001F) << 3) | ((pixel & 0x001C) >> 2);
+            unsigned g     = ((pixel & 0x07E0) << 5) | ((pixel & 0x0600) >> 1);
+            unsigned b     = ((pixel & 0xF800) << 8) | ((pixel & 0xE000) << 3);
+
+            dst[x]         = 0xFF000000 | b | g | r;
+         }
+      }
+   }
+
+   if (bits == 16 && menu)
+      return NETWORK_VIDEO_PIXELFORMAT_RGBA8888;
+   return NETWORK_VIDEO_PIXELFORMAT_BGRA8888;
+}
+
+static bool network_video_reserve(uint8_t **buf, size_t *size, size_t len)
+{
+   uint8_t *tmp;
+
+   if (*size >= len)
+      return true;
+
+   if (!(tmp = (uint8_t*)realloc(*buf, len)))
+      return false;
+
+   *buf  = tmp;
+   *size = len;
+   return true;
+}
+
+/* Encodes @cur as a streaming protocol frame containing only the
+ * tiles that differ from @prev, and sends it. */
+static bool network_video_stream_frame(network_video_t *network,
+      const network_video_buffer_t *cur,
+      const network_video_buffer_t *prev)
+{
+   unsigned tx, ty;
+   unsigned tile     = NETWORK_VIDEO_STREAM_TILE_SIZE;
+   unsigned cols     = (cur->width  + tile - 1) / tile;
+   unsigned rows     = (cur->height + tile - 1) / tile;
+   unsigned tiles    = 0;
+   uint32_t flags    = 0;
+   size_t raw_size   = (size_t)cur->width * cur->height * sizeof(uint32_t)
+      + (size_t)cols * rows * 4;
+   uint8_t *packet   = NULL;
+   uint8_t *out      = NULL;
+   size_t size       = 0;
+   bool keyframe     = !prev
+      || prev->width  != cur->width
+      || prev->height != cur->height
+      || prev->pixfmt != cur->pixfmt;
+
+   if (!network_video_reserve(&network->packet, &network->packet_size,
+            NETWORK_VIDEO_STREAM_HEADER_SIZE + raw_size))
+      return false;
+
+   packet = network->packet;
+   out    = packet + NETWORK_VIDEO_STREAM_HEADER_SIZE;
+
+   for (ty = 0; ty < rows; ty++)
+   {
+      unsigned y0 = ty * tile;
+      unsigned th = MIN(tile, cur->height - y0);
+
+      for (tx = 0; tx < cols; tx++)
+      {
+         unsigned y;
+         unsigned x0          = tx * tile;
+         size_t tw            = MIN(tile, cur->width - x0) * sizeof(uint32_t);
+         size_t offset        = (size_t)y0 * cur->width + x0;
+         const uint32_t *src  = cur->data + offset;
+
+         if (!keyframe)
+         {
+            const uint32_t *ref = prev->data + offset;
+
+            for (y = 0; y < th; y++)
+               if (memcmp(src + y * cur->width, ref + y * cur->width, tw))
+                  break;
+
+            if (y == th)
+               continue;
+         }
+
+         retro_set_unaligned_16be(out,     tx);
+         retro_set_unaligned_16be(out + 2, ty);
+         out += 4;
+
+         for (y = 0; y < th; y++, out += tw)
+            memcpy(out, src + y * cur->width, tw);
+
+         tiles++;
+      }
+   }
+
+   /* Nothing changed, nothing to send */
+   if (!tiles)
+      return true;
+
+   raw_size = out - packet - NETWORK_VIDEO_STREAM_HEADER_SIZE;
+   size     = raw_size;
+
+#ifdef HAVE_ZLIB
+   if (network->compress)
+   {
+      /* Worst case for deflate is a little over the input size */
+      size_t bound = raw_size + (raw_size >> 3) + 64;
+      const struct trans_stream_backend *backend =
+         trans_stream_get_zlib_deflate_backend();
+
+      if (!network->deflate_stream)
+      {
+         network->deflate_stream = backend->stream_new();
+         if (network->deflate_stream)
+            backend->define(network->deflate_stream, "level", 1);
+      }
+
+      if (     network->deflate_stream
+            && network_video_reserve(&network->deflate_buf,
+               &network->deflate_size,
+               NETWORK_VIDEO_STREAM_HEADER_SIZE + bound))
+      {
+         uint32_t rd, wn;
+         enum trans_stream_error err = TRANS_STREAM_ERROR_NONE;
+
+         backend->set_in(network->deflate_stream,
+               packet + NETWORK_VIDEO_STREAM_HEADER_SIZE, (uint32_t)raw_size);
+         backend->set_out(network->deflate_stream,
+               network->deflate_buf + NETWORK_VIDEO_STREAM_HEADER_SIZE,
+               (uint32_t)bound);
+
+         if (     backend->trans(network->deflate_stream, true, &rd, &wn, &err)
+               && err == TRANS_STREAM_ERROR_NONE)
+         {
+            if (wn < raw_size)
+            {
+               packet = network->deflate_buf;
+               size   = wn;
+               flags |= NETWORK_VIDEO_STREAM_DEFLATE;
+            }
+         }
+         else
+         {
+            /* Throw the stream away so the next frame starts clean */
+            backend->stream_free(network->deflate_stream);
+            network->deflate_stream = NULL;
+         }
+      }
+   }
+#endif
+
+   if (keyframe)
+      flags |= NETWORK_VIDEO_STREAM_KEYFRAME;
+
+   retro_set_unaligned_32be(packet +  0, NETWORK_VIDEO_STREAM_MAGIC);
+   retro_set_unaligned_32be(packet +  4, network->frame_count++);
+   retro_set_unaligned_16be(packet +  8, cur->width);
+   retro_set_unaligned_16be(packet + 10, cur->height);
+   retro_set_unaligned_16be(packet + 12, tiles);
+   packet[14] = (uint8_t)tile;
+   packet[15] = (uint8_t)cur->pixfmt;
+   retro_set_unaligned_32be(packet + 16, flags);
+   retro_set_unaligned_32be(packet + 20, (uint32_t)raw_size);
+   retro_set_unaligned_32be(packet + 24, (uint32_t)size);
+
+   return socket_send_all_blocking(network->fd, packet,
+         NETWORK_VIDEO_STREAM_HEADER_SIZE + size, true);
+}
+
+static bool network_video_send(network_video_t *network,
+      const network_video_buffer_t *buf)
+{
+   if (network->stream)
+      return network_video_stream_frame(network, buf, network->prev);
+   return socket_send_all_blocking(network->fd, buf->data,
+         buf->width * buf->height * sizeof(uint32_t), true);
+}
+
+/* Makes @buf the reference for the next frame and recycles
+ * the old one. Must hold the lock when threaded. */
+static void network_video_retire(network_video_t *network,
+      network_video_buffer_t *buf, bool ok)
+{
+   if (network->prev)
+      network->free_list[network->free_count++] = network->prev;
+   network->prev = buf;
+
+   if (!ok && !network->send_failed)
+   {
+      RARCH_ERR("[network]: Lost connection to host.\n");
+      network->send_failed = true;
+   }
+}
+
+#ifdef HAVE_THREADS
+static void network_video_sender_thread(void *data)
+{
+   network_video_t *network = (network_video_t*)data;
+
+   slock_lock(network->lock);
+
+   for (;;)
+   {
+      bool ok;
+      network_video_buffer_t *buf = NULL;
+
+      while (!network->queue_count && !network->die)
+         scond_wait(network->cond, network->lock);
+
+      /* Flush whatever is still queued before shutting down */
+      if (!network->queue_count)
+         break;
+
+      buf                  = network->queue[network->queue_head];
+      network->queue_head  = (network->queue_head + 1)
+         % NETWORK_VIDEO_QUEUE_SIZE;
+      network->queue_count--;
+
+      /* The previous frame is only ever touched from here,
+       * so it can be read without holding the lock. */
+      slock_unlock(network->lock);
+      ok = network_video_send(network, buf);
+      slock_lock(network->lock);
+
+      network_video_retire(network, buf, ok);
+   }
+
+   slock_unlock(network->lock);
+}
+#endif
+
+/* Takes a buffer for the next frame, dropping the oldest queued
+ * frame if the sender has fallen behind. */
+static network_video_buffer_t *network_video_acquire(
+      network_video_t *network)
+{
+   network_video_buffer_t *buf = NULL;
+
+#ifdef HAVE_THREADS
+   slock_lock(network->lock);
+#endif
+
+   if (!network->send_failed)
+   {
+      if (network->queue_count == NETWORK_VIDEO_QUEUE_SIZE)
+      {
+         network->free_list[network->free_count++] =
+            network->queue[network->queue_head];
+         network->queue_head = (network->queue_head + 1)
+            % NETWORK_VIDEO_QUEUE_SIZE;
+         network->queue_count--;
+         network->dropped++;
+      }
+
+      if (network->free_count)
+         buf = network->free_list[--network->free_count];
+   }
+
+#ifdef HAVE_THREADS
+   slock_unlock(network->lock);
+#endif
+
+   return buf;
+}
+
+static void network_video_submit(network_video_t *network,
+      network_video_buffer_t *buf, bool ready)
+{
+#ifdef HAVE_THREADS
+   if (network->thread)
+   {
+      slock_lock(network->lock);
+      if (ready)
+      {
+         network->queue[(network->queue_head + network->queue_count)
+            % NETWORK_VIDEO_QUEUE_SIZE] = buf;
+         network->queue_count++;
+         scond_signal(network->cond);
+      }
+      else
+         network->free_list[network->free_count++] = buf;
+      slock_unlock(network->lock);
+      return;
+   }
+#endif
+
+   if (ready)
+      network_video_retire(network, buf, network_video_send(network, buf));
+   else
+      network->free_list[network->free_count++] = buf;
+}
+
 static void *network_gfx_init(const video_info_t *video,
       input_driver_t **input, void **input_data)
 {
    int fd;
+   unsigned i;
    struct addrinfo *addr = NULL, *next_addr = NULL;
+   const char *mode_str                 = NULL;
+   const char *compress_str             = NULL;
    settings_t *settings                 = config_get_ptr();
    network_video_t *network             = (network_video_t*)calloc(1, sizeof(*network));
    bool video_font_enable               = settings->bools.video_font_enable;
-   const char *joypad_driver            = settings->arrays.joypad_driver;
+   const char *joypad_driver            = settings->arrays.input_joypad_driver;
+
+   if (!network)
+      return NULL;
 
    *input                               = NULL;
    *input_data                          = NULL;
@@ -105,7 +498,7 @@ static void *network_gfx_init(const video_info_t *video,
    gfx_ctx_network_input_driver(joypad_driver,
          input, input_data);
 
-   if (font_enable)
+   if (video_font_enable)
       font_driver_init_osd(network,
             video,
             false,
@@ -115,6 +508,17 @@ static void *network_gfx_init(const video_info_t *video,
    strlcpy(network->address, xstr(NETWORK_VIDEO_HOST), sizeof(network->address));
    network->port = NETWORK_VIDEO_PORT;
 
+   /* NETWORK_VIDEO_MODE=stream selects the delta-encoded streaming
+    * protocol, NETWORK_VIDEO_COMPRESS=0 turns off its deflate pass. */
+   mode_str          = getenv("NETWORK_VIDEO_MODE");
+   compress_str      = getenv("NETWORK_VIDEO_COMPRESS");
+   network->stream   = mode_str && string_is_equal(mode_str, "stream");
+   network->compress = !compress_str || !string_is_equal(compress_str, "0");
+
+   for (i = 0; i < NETWORK_VIDEO_NUM_BUFFERS; i++)
+      network->free_list[i] = &network->buffers[i];
+   network->free_count = NETWORK_VIDEO_NUM_BUFFERS;
+
    RARCH_LOG("[network] Connecting to host %s:%d\n", network->address, network->port);
 try_connect:
    fd = socket_init((void**)&addr, network->port, network->address, SOCKET_TYPE_STREAM);
@@ -153,29 +557,37 @@ try_connect:
       goto try_connect;
    }
 
-   RARCH_LOG("[network]: Init complete.\n");
+#ifdef HAVE_THREADS
+   network->lock = slock_new();
+   network->cond = scond_new();
 
-   return network;
+   if (network->lock && network->cond)
+      network->thread = sthread_create(network_video_sender_thread, network);
+
+   if (!network->thread)
+      RARCH_WARN("[network]: Could not start sender thread, sending frames synchronously.\n");
+#endif
+
+   RARCH_LOG("[network]: Init complete (%s protocol).\n",
+         network->stream ? "streaming" : "raw");
 
-error:
-   if (network)
-      free(network);
-   return NULL;
+   return network;
 }
 
 static bool network_gfx_frame(void *data, const void *frame,
       unsigned frame_width, unsigned frame_height, uint64_t frame_count,
       unsigned pitch, const char *msg, video_frame_info_t *video_info)
 {
-   const void *frame_to_copy = frame;
-   unsigned width            = 0;
-   unsigned height           = 0;
-   unsigned bits             = network_video_bits;
-   unsigned pixfmt           = NETWORK_VIDEO_PIXELFORMAT_RGB565;
-   bool draw                 = true;
-   network_video_t *network  = (network_video_t*)data;
+   const void *frame_to_copy   = frame;
+   unsigned width              = 0;
+   unsigned height             = 0;
+   unsigned bits               = network_video_bits;
+   bool draw                   = true;
+   bool menu                   = false;
+   network_video_buffer_t *buf = NULL;
+   network_video_t *network    = (network_video_t*)data;
 #ifdef HAVE_MENU
-   bool menu_is_alive        = video_info->menu_is_alive;
+   bool menu_is_alive          = video_info->menu_is_alive;
 #endif
 
    if (!frame || !frame_width || !frame_height)
@@ -207,6 +619,7 @@ static bool network_gfx_frame(void *data, const void *frame,
       height        = network_menu_height;
       pitch         = network_menu_pitch;
       bits          = network_menu_bits;
+      menu          = true;
    }
    else
 #endif
@@ -226,114 +639,42 @@ static bool network_gfx_frame(void *data, const void *frame,
 #endif
    }
 
-   if (     network->video_width != width 
-         || network->video_height != height)
-   {
-      network->video_width  = width;
-      network->video_height = height;
-
-      if (network_video_temp_buf)
-         free(network_video_temp_buf);
+   network->video_width  = width;
+   network->video_height = height;
 
-      network_video_temp_buf = (unsigned*)
-         malloc(
-                 network->screen_width 
-               * network->screen_height 
-               * sizeof(unsigned));
-   }
-
-   if (bits == 16)
+   if (     draw
+         && network->fd > 0
+         && network->screen_width  > 0
+         && network->screen_height > 0
+         && (buf = network_video_acquire(network)))
    {
-      if (network_video_temp_buf)
-      {
-         if (frame_to_copy == network_menu_frame)
-         {
-            /* Scale and convert 16-bit RGBX4444 image to 32-bit RGBX8888. */
-            unsigned x, y;
-
-            for (y = 0; y < network->screen_height; y++)
-            {
-               for (x = 0; x < network->screen_width; x++)
-               {
-                  /* scale incoming frame to fit the screen */
-                  unsigned    scaled_x = (width * x) / network->screen_width;
-                  unsigned    scaled_y = (height * y) / network->screen_height;
-                  unsigned short pixel = ((unsigned short*)frame_to_copy)[width * scaled_y + scaled_x];
-
-                  /* convert RGBX4444 to RGBX8888 */
-                  unsigned r           = ((pixel & 0xF000) << 8) 
-                     | ((pixel & 0xF000) << 4);
-                  unsigned g           = ((pixel & 0x0F00) << 4) 
-                     | ((pixel & 0x0F00) << 0);
-                  unsigned b           = ((pixel & 0x00F0) << 0) 
-                     | ((pixel & 0x00F0) >> 4);
-
-                  network_video_temp_buf[network->screen_width * y + x] 
-                     = 0xFF000000 | b | g | r;
-               }
-            }
+      size_t pixels = network->screen_width * network->screen_height;
+      bool ready    = false;
 
-            pixfmt        = NETWORK_VIDEO_PIXELFORMAT_RGBA8888;
-            frame_to_copy = network_video_temp_buf;
-         }
-         else
+      /* Buffers belong to whoever took them off the free list,
+       * so the conversion runs without holding the lock. */
+      if (buf->capacity < pixels)
+      {
+         uint32_t *tmp = (uint32_t*)realloc(buf->data,
+               pixels * sizeof(uint32_t));
+         if (tmp)
          {
-            /* Scale and convert 16-bit RGB565 image to 32-bit RGBX8888. */
-            unsigned x, y;
-
-            for (y = 0; y < network->screen_height; y++)
-            {
-               for (x = 0; x < network->screen_width; x++)
-               {
-                  /* scale incoming frame to fit the screen */
-                  unsigned    scaled_x = (width * x) / network->screen_width;
-                  unsigned    scaled_y = (height * y) / network->screen_height;
-                  unsigned short pixel = ((unsigned short*)frame_to_copy)[(pitch / (bits / 8)) * scaled_y + scaled_x];
-
-                  /* convert RGB565 to RGBX8888 */
-                  unsigned r = ((pixel & 0x001F) << 3) | ((pixel & 0x001C) >> 2);
-                  unsigned g = ((pixel & 0x07E0) << 5) | ((pixel & 0x0600) >> 1);
-                  unsigned b = ((pixel & 0xF800) << 8) | ((pixel & 0xE000) << 3);
-
-                  network_video_temp_buf[network->screen_width * y + x] = 0xFF000000 | b | g | r;
-               }
-            }
-
-            pixfmt = NETWORK_VIDEO_PIXELFORMAT_BGRA8888;
-            frame_to_copy = network_video_temp_buf;
+            buf->data     = tmp;
+            buf->capacity = pixels;
          }
       }
-      else
-      {
-         /* no temp buffer available yet */
-      }
-   }
-   else
-   {
-      /* Scale 32-bit RGBX8888 image to output geometry. */
-      unsigned x, y;
 
-      for (y = 0; y < network->screen_height; y++)
+      if (     buf->capacity >= pixels
+            && network_video_scaler_update(network, width, height))
       {
-         for (x = 0; x < network->screen_width; x++)
-         {
-            /* scale incoming frame to fit the screen */
-            unsigned scaled_x = (width * x) / network->screen_width;
-            unsigned scaled_y = (height * y) / network->screen_height;
-            unsigned    pixel = ((unsigned*)frame_to_copy)[(pitch / (bits / 8)) * scaled_y + scaled_x];
-
-            network_video_temp_buf[network->screen_width * y + x] = pixel;
-         }
+         buf->pixfmt = network_video_convert(network, buf->data,
+               frame_to_copy, pitch, bits, menu);
+         buf->width  = network->screen_width;
+         buf->height = network->screen_height;
+         ready       = true;
       }
 
-      pixfmt = NETWORK_VIDEO_PIXELFORMAT_BGRA8888;
-      frame_to_copy = network_video_temp_buf;
-   }
-
-   if (draw && network->screen_width > 0 && network->screen_height > 0)
-   {
-      if (network->fd > 0)
-         socket_send_all_blocking(network->fd, frame_to_copy, network->screen_width * network->screen_height * 4, true);
+      network_video_submit(network, buf, ready);
    }
 
    if (msg)
@@ -366,24 +707,55 @@ static bool network_gfx_has_windowed(void *data) { return true; }
 
 static void network_gfx_free(void *data)
 {
+   unsigned i;
    network_video_t *network = (network_video_t*)data;
 
    if (network_menu_frame)
       free(network_menu_frame);
 
-   if (network_video_temp_buf)
-      free(network_video_temp_buf);
-
    network_menu_frame     = NULL;
-   network_video_temp_buf = NULL;
 
    font_driver_free_osd();
 
+   if (!network)
+      return;
+
+#ifdef HAVE_THREADS
+   if (network->thread)
+   {
+      slock_lock(network->lock);
+      network->die = true;
+      scond_signal(network->cond);
+      slock_unlock(network->lock);
+      sthread_join(network->thread);
+   }
+
+   if (network->cond)
+      scond_free(network->cond);
+   if (network->lock)
+      slock_free(network->lock);
+#endif
+
+   if (network->dropped)
+      RARCH_LOG("[network]: Dropped %u frames.\n", network->dropped);
+
    if (network->fd >= 0)
       socket_close(network->fd);
 
-   if (network)
-      free(network);
+   for (i = 0; i < NETWORK_VIDEO_NUM_BUFFERS; i++)
+      free(network->buffers[i].data);
+
+#ifdef HAVE_ZLIB
+   if (network->deflate_stream)
+      trans_stream_get_zlib_deflate_backend()->stream_free(
+            network->deflate_stream);
+#endif
+
+   free(network->deflate_buf);
+   free(network->packet);
+   free(network->scale_x);
+   free(network->scale_y);
+   free(network);
 }
 
 static bool network_gfx_set_shader(void *data,
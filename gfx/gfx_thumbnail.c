@@ -38,14 +38,45 @@
 #define DEFAULT_GFX_THUMBNAIL_STREAM_DELAY  83.333333f
 #define DEFAULT_GFX_THUMBNAIL_FADE_DURATION 166.66667f
 
+/* Maximum total size of the 'idle' textures retained
+ * by the in-memory thumbnail cache */
+#define GFX_THUMBNAIL_CACHE_IDLE_SIZE_MAX   (32 * 1024 * 1024)
+
+/* Maximum total size of prefetched textures that
+ * have not yet been displayed */
+#define GFX_THUMBNAIL_PREFETCH_SIZE_MAX     (16 * 1024 * 1024)
+
+/* Number of entries prefetched ahead of/behind
+ * the selection in the current scroll direction */
+#define GFX_THUMBNAIL_PREFETCH_AHEAD        2
+#define GFX_THUMBNAIL_PREFETCH_BEHIND       1
+
+/* When the selection changes more frequently than
+ * this (in us), the user is considered to be scrolling
+ * quickly - only entries ahead of the selection are
+ * then prefetched, up to GFX_THUMBNAIL_PREFETCH_AHEAD_FAST */
+#define GFX_THUMBNAIL_PREFETCH_FAST_INTERVAL 200000
+#define GFX_THUMBNAIL_PREFETCH_AHEAD_FAST   4
+
 /* Utility structure, sent as userdata when pushing
  * an image load */
-typedef struct
+typedef struct gfx_thumbnail_tag
 {
+   char *path; /* NULL if texture should not be cached */
    uint64_t list_id;
-   gfx_thumbnail_t *thumbnail;
+   gfx_thumbnail_t *thumbnail; /* NULL for unclaimed prefetch requests */
+   unsigned upscale_threshold;
+   bool prefetch;
+   bool wanted; /* Prefetch request is within current window */
 } gfx_thumbnail_tag_t;
 
+static void gfx_thumbnail_tag_free(gfx_thumbnail_tag_t *thumbnail_tag)
+{
+   if (thumbnail_tag->path)
+      free(thumbnail_tag->path);
+   free(thumbnail_tag);
+}
+
 /* Setters */
 
 /* When streaming thumbnails, sets time in ms that an
@@ -82,6 +113,297 @@ void gfx_thumbnail_set_fade_missing(bool fade_missing)
    p_gfx_thumb->fade_missing = fade_missing;
 }
 
+/* In-memory texture cache */
+
+static void gfx_thumbnail_cache_clear_entry(
+      gfx_thumbnail_cache_entry_t *entry)
+{
+   if (entry->path)
+      free(entry->path);
+
+   entry->path              = NULL;
+   entry->texture           = 0;
+   entry->size              = 0;
+   entry->width             = 0;
+   entry->height            = 0;
+   entry->upscale_threshold = 0;
+   entry->last_used         = 0;
+   entry->in_use            = false;
+   entry->prefetched        = false;
+}
+
+/* Returns cache entry associated with the specified
+ * image, or NULL if image is not cached */
+static gfx_thumbnail_cache_entry_t *gfx_thumbnail_cache_find(
+      gfx_thumbnail_state_t *p_gfx_thumb, const char *path,
+      unsigned upscale_threshold)
+{
+   size_t i;
+
+   for (i = 0; i < GFX_THUMBNAIL_CACHE_SLOTS; i++)
+   {
+      gfx_thumbnail_cache_entry_t *entry = &p_gfx_thumb->cache[i];
+
+      if (entry->texture &&
+          (entry->upscale_threshold == upscale_threshold) &&
+          string_is_equal(entry->path, path))
+         return entry;
+   }
+
+   return NULL;
+}
+
+
+/* Unloads the least recently used idle texture
+ * > Returns false if no idle textures exist */
+static bool gfx_thumbnail_cache_evict(gfx_thumbnail_state_t *p_gfx_thumb)
+{
+   size_t i;
+   gfx_thumbnail_cache_entry_t *lru = NULL;
+
+   for (i = 0; i < GFX_THUMBNAIL_CACHE_SLOTS; i++)
+   {
+      gfx_thumbnail_cache_entry_t *entry = &p_gfx_thumb->cache[i];
+
+      if (!entry->texture || entry->in_use)
+         continue;
+
+      /* Counter may wrap - compare relative ages */
+      if (!lru || ((uint32_t)(p_gfx_thumb->cache_counter - entry->last_used) >
+                   (uint32_t)(p_gfx_thumb->cache_counter - lru->last_used)))
+         lru = entry;
+   }
+
+   if (!lru)
+      return false;
+
+   video_driver_texture_unload(&lru->texture);
+   p_gfx_thumb->cache_idle_size -= lru->size;
+   if (lru->prefetched)
+      p_gfx_thumb->prefetch_size -= lru->size;
+   gfx_thumbnail_cache_clear_entry(lru);
+
+   return true;
+}
+
+/* Unloads idle textures until the memory budget
+ * is met */
+static void gfx_thumbnail_cache_trim(gfx_thumbnail_state_t *p_gfx_thumb)
+{
+   while (p_gfx_thumb->cache_idle_size > GFX_THUMBNAIL_CACHE_IDLE_SIZE_MAX)
+      if (!gfx_thumbnail_cache_evict(p_gfx_thumb))
+         break;
+}
+
+/* Starts tracking a newly uploaded texture. If 'in_use'
+ * is true, texture is owned by the requesting thumbnail,
+ * otherwise it is owned by the cache
+ * > Returns false if texture cannot be tracked */
+static bool gfx_thumbnail_cache_add(
+      gfx_thumbnail_state_t *p_gfx_thumb, const char *path,
+      unsigned upscale_threshold, uintptr_t texture,
+      unsigned width, unsigned height, bool in_use)
+{
+   size_t i;
+   gfx_thumbnail_cache_entry_t *slot = NULL;
+
+   /* If this image is already cached, the new texture
+    * is an untracked duplicate */
+   if (gfx_thumbnail_cache_find(p_gfx_thumb, path, upscale_threshold))
+      return false;
+
+   for (i = 0; i < GFX_THUMBNAIL_CACHE_SLOTS; i++)
+      if (!p_gfx_thumb->cache[i].texture)
+      {
+         slot = &p_gfx_thumb->cache[i];
+         break;
+      }
+
+   if (!slot)
+   {
+      if (!gfx_thumbnail_cache_evict(p_gfx_thumb))
+         return false;
+
+      for (i = 0; i < GFX_THUMBNAIL_CACHE_SLOTS; i++)
+         if (!p_gfx_thumb->cache[i].texture)
+         {
+            slot = &p_gfx_thumb->cache[i];
+            break;
+         }
+
+      if (!slot)
+         return false;
+   }
+
+   if (!(slot->path = strdup(path)))
+      return false;
+
+   slot->texture           = texture;
+   slot->size              = width * height * sizeof(uint32_t);
+   slot->width             = width;
+   slot->height            = height;
+   slot->upscale_threshold = upscale_threshold;
+   slot->in_use            = in_use;
+   slot->prefetched        = !in_use;
+   slot->last_used         = in_use ? 0 : ++p_gfx_thumb->cache_counter;
+
+   if (!in_use)
+   {
+      p_gfx_thumb->cache_idle_size += slot->size;
+      p_gfx_thumb->prefetch_size   += slot->size;
+      gfx_thumbnail_cache_trim(p_gfx_thumb);
+   }
+
+   return true;
+}
+
+/* Hands an idle cached texture matching 'path' to the
+ * specified thumbnail
+ * > Returns false if no matching texture is available */
+static bool gfx_thumbnail_cache_acquire(
+      gfx_thumbnail_state_t *p_gfx_thumb, const char *path,
+      unsigned upscale_threshold, gfx_thumbnail_t *thumbnail)
+{
+   gfx_thumbnail_cache_entry_t *entry = gfx_thumbnail_cache_find(
+         p_gfx_thumb, path, upscale_threshold);
+
+   if (!entry || entry->in_use)
+      return false;
+
+   entry->in_use                 = true;
+   p_gfx_thumb->cache_idle_size -= entry->size;
+
+   if (entry->prefetched)
+   {
+      p_gfx_thumb->prefetch_size -= entry->size;
+      entry->prefetched           = false;
+   }
+
+   thumbnail->texture            = entry->texture;
+   thumbnail->width              = entry->width;
+   thumbnail->height             = entry->height;
+   thumbnail->status             = GFX_THUMBNAIL_STATUS_AVAILABLE;
+
+   return true;
+}
+
+/* Returns a texture owned by a thumbnail to the cache
+ * > Returns false if texture is not tracked by the
+ *   cache (caller must then unload it) */
+static bool gfx_thumbnail_cache_release(
+      gfx_thumbnail_state_t *p_gfx_thumb, uintptr_t texture)
+{
+   size_t i;
+
+   for (i = 0; i < GFX_THUMBNAIL_CACHE_SLOTS; i++)
+   {
+      gfx_thumbnail_cache_entry_t *entry = &p_gfx_thumb->cache[i];
+
+      if (!entry->in_use || (entry->texture != texture))
+         continue;
+
+      entry->in_use                 = false;
+      entry->last_used              = ++p_gfx_thumb->cache_counter;
+      p_gfx_thumb->cache_idle_size += entry->size;
+
+      gfx_thumbnail_cache_trim(p_gfx_thumb);
+
+      return true;
+   }
+
+   return false;
+}
+
+/* Unloads all idle textures held by the in-memory
+ * thumbnail cache, and stops tracking any textures
+ * currently in use
+ * >> **MUST** be called whenever the menu driver
+ *    context is destroyed, before the video driver
+ *    is deinitialised */
+void gfx_thumbnail_cache_flush(void)
+{
+   size_t i;
+   gfx_thumbnail_state_t *p_gfx_thumb = gfx_thumb_get_ptr();
+
+   for (i = 0; i < GFX_THUMBNAIL_CACHE_SLOTS; i++)
+   {
+      gfx_thumbnail_cache_entry_t *entry = &p_gfx_thumb->cache[i];
+
+      /* In use textures remain owned by their
+       * respective thumbnails */
+      if (entry->texture && !entry->in_use)
+         video_driver_texture_unload(&entry->texture);
+
+      gfx_thumbnail_cache_clear_entry(entry);
+   }
+
+   /* Any outstanding prefetch requests are now stale
+    * (requests are removed from the list by the upload
+    * callback) */
+   for (i = 0; i < GFX_THUMBNAIL_PREFETCH_SLOTS; i++)
+   {
+      gfx_thumbnail_tag_t *thumbnail_tag = p_gfx_thumb->prefetch_tags[i];
+
+      if (!thumbnail_tag)
+         continue;
+
+      thumbnail_tag->thumbnail = NULL;
+      thumbnail_tag->wanted    = false;
+   }
+
+   if (p_gfx_thumb->prefetch_path_data)
+      free(p_gfx_thumb->prefetch_path_data);
+
+   p_gfx_thumb->prefetch_path_data = NULL;
+   p_gfx_thumb->cache_idle_size    = 0;
+   p_gfx_thumb->prefetch_size      = 0;
+}
+
+/* Prefetching */
+
+/* Returns outstanding prefetch request for the
+ * specified image, or NULL if none exists */
+static gfx_thumbnail_tag_t *gfx_thumbnail_prefetch_find(
+      gfx_thumbnail_state_t *p_gfx_thumb, const char *path,
+      unsigned upscale_threshold)
+{
+   size_t i;
+
+   for (i = 0; i < GFX_THUMBNAIL_PREFETCH_SLOTS; i++)
+   {
+      gfx_thumbnail_tag_t *thumbnail_tag = p_gfx_thumb->prefetch_tags[i];
+
+      if (thumbnail_tag &&
+          (thumbnail_tag->upscale_threshold == upscale_threshold) &&
+          string_is_equal(thumbnail_tag->path, path))
+         return thumbnail_tag;
+   }
+
+   return NULL;
+}
+
+static void gfx_thumbnail_prefetch_remove(
+      gfx_thumbnail_state_t *p_gfx_thumb,
+      gfx_thumbnail_tag_t *thumbnail_tag)
+{
+   size_t i;
+
+   for (i = 0; i < GFX_THUMBNAIL_PREFETCH_SLOTS; i++)
+      if (p_gfx_thumb->prefetch_tags[i] == thumbnail_tag)
+         p_gfx_thumb->prefetch_tags[i] = NULL;
+}
+
+/* Marks all outstanding prefetch requests as stale */
+static void gfx_thumbnail_prefetch_invalidate(
+      gfx_thumbnail_state_t *p_gfx_thumb)
+{
+   size_t i;
+
+   for (i = 0; i < GFX_THUMBNAIL_PREFETCH_SLOTS; i++)
+      if (p_gfx_thumb->prefetch_tags[i])
+         p_gfx_thumb->prefetch_tags[i]->wanted = false;
+}
+
 /* Callbacks */
 
 /* Fade animation callback - simply resets thumbnail
@@ -148,6 +470,42 @@ static void gfx_thumbnail_handle_upload(
    if (!thumbnail_tag)
       goto end;
 
+   if (thumbnail_tag->prefetch)
+   {
+      gfx_thumbnail_prefetch_remove(p_gfx_thumb, thumbnail_tag);
+
+      /* If prefetched image was claimed by a thumbnail
+       * that has since been cancelled, handle it as an
+       * unclaimed request */
+      if (thumbnail_tag->list_id != p_gfx_thumb->list_id)
+         thumbnail_tag->thumbnail = NULL;
+
+      if (!thumbnail_tag->thumbnail)
+      {
+         uintptr_t texture = 0;
+
+         /* Discard image if it is no longer required */
+         if (!thumbnail_tag->wanted ||
+             !img || (img->width < 1) || (img->height < 1))
+            goto end;
+
+         if (gfx_thumbnail_cache_find(p_gfx_thumb,
+                  thumbnail_tag->path, thumbnail_tag->upscale_threshold))
+            goto end;
+
+         if (!video_driver_texture_load(
+                  img, TEXTURE_FILTER_MIPMAP_LINEAR, &texture))
+            goto end;
+
+         if (!gfx_thumbnail_cache_add(p_gfx_thumb,
+                  thumbnail_tag->path, thumbnail_tag->upscale_threshold,
+                  texture, img->width, img->height, false))
+            video_driver_texture_unload(&texture);
+
+         goto end;
+      }
+   }
+
    /* Ensure that we are operating on the correct
     * thumbnail... */
    if (thumbnail_tag->list_id != p_gfx_thumb->list_id)
@@ -187,6 +545,13 @@ static void gfx_thumbnail_handle_upload(
    thumbnail_tag->thumbnail->width  = img->width;
    thumbnail_tag->thumbnail->height = img->height;
 
+   /* Track texture in the in-memory cache */
+   if (thumbnail_tag->path)
+      gfx_thumbnail_cache_add(p_gfx_thumb, thumbnail_tag->path,
+            thumbnail_tag->upscale_threshold,
+            thumbnail_tag->thumbnail->texture,
+            img->width, img->height, true);
+
    /* Update thumbnail status */
    thumbnail_tag->thumbnail->status = GFX_THUMBNAIL_STATUS_AVAILABLE;
 
@@ -205,7 +570,7 @@ end:
          gfx_thumbnail_init_fade(p_gfx_thumb,
                thumbnail_tag->thumbnail);
 
-      free(thumbnail_tag);
+      gfx_thumbnail_tag_free(thumbnail_tag);
    }
 }
 
@@ -222,6 +587,8 @@ void gfx_thumbnail_cancel_pending_requests(void)
    gfx_thumbnail_state_t *p_gfx_thumb = gfx_thumb_get_ptr();
 
    p_gfx_thumb->list_id++;
+
+   gfx_thumbnail_prefetch_invalidate(p_gfx_thumb);
 }
 
 /* Requests loading of the specified thumbnail
@@ -266,6 +633,33 @@ void gfx_thumbnail_request(
    /* Load thumbnail, if required */
    if (has_thumbnail)
    {
+      /* If image was recently displayed, reuse
+       * existing texture */
+      if (gfx_thumbnail_cache_acquire(p_gfx_thumb, thumbnail_path,
+               gfx_thumbnail_upscale_threshold, thumbnail))
+         goto end;
+
+      /* If image is currently being prefetched, claim
+       * the outstanding request
+       * > A claimed request is no longer outstanding, so
+       *   it is removed from the list - otherwise another
+       *   thumbnail could claim it in turn, leaving this
+       *   one pending forever */
+      {
+         gfx_thumbnail_tag_t *prefetch_tag = gfx_thumbnail_prefetch_find(
+               p_gfx_thumb, thumbnail_path, gfx_thumbnail_upscale_threshold);
+
+         if (prefetch_tag)
+         {
+            gfx_thumbnail_prefetch_remove(p_gfx_thumb, prefetch_tag);
+
+            prefetch_tag->thumbnail = thumbnail;
+            prefetch_tag->list_id   = p_gfx_thumb->list_id;
+            thumbnail->status       = GFX_THUMBNAIL_STATUS_PENDING;
+            goto end;
+         }
+      }
+
       if (path_is_valid(thumbnail_path))
       {
          gfx_thumbnail_tag_t *thumbnail_tag =
@@ -275,16 +669,22 @@ void gfx_thumbnail_request(
             goto end;
 
          /* Configure user data */
-         thumbnail_tag->thumbnail = thumbnail;
-         thumbnail_tag->list_id   = p_gfx_thumb->list_id;
+         thumbnail_tag->path              = strdup(thumbnail_path);
+         thumbnail_tag->thumbnail         = thumbnail;
+         thumbnail_tag->list_id           = p_gfx_thumb->list_id;
+         thumbnail_tag->upscale_threshold = gfx_thumbnail_upscale_threshold;
+         thumbnail_tag->prefetch          = false;
+         thumbnail_tag->wanted            = false;
 
          /* Would like to cancel any existing image load tasks
           * here, but can't see how to do it... */
-         if (task_push_image_load(
+         if (task_push_image_load_cached(
                thumbnail_path, video_driver_supports_rgba(),
                gfx_thumbnail_upscale_threshold,
                gfx_thumbnail_handle_upload, thumbnail_tag))
             thumbnail->status = GFX_THUMBNAIL_STATUS_PENDING;
+         else
+            gfx_thumbnail_tag_free(thumbnail_tag);
       }
 #ifdef HAVE_NETWORKING
       /* Handle on demand thumbnail downloads */
@@ -374,9 +774,17 @@ void gfx_thumbnail_request_file(
    if (!thumbnail_tag)
       return;
 
-   /* Configure user data */
-   thumbnail_tag->thumbnail = thumbnail;
-   thumbnail_tag->list_id   = p_gfx_thumb->list_id;
+   /* Configure user data
+    * > Files requested here (e.g. savestate images) may
+    *   be overwritten in place without changing size or
+    *   (second granularity) modification time, so they
+    *   bypass both the in-memory and on-disk caches */
+   thumbnail_tag->path              = NULL;
+   thumbnail_tag->thumbnail         = thumbnail;
+   thumbnail_tag->list_id           = p_gfx_thumb->list_id;
+   thumbnail_tag->upscale_threshold = gfx_thumbnail_upscale_threshold;
+   thumbnail_tag->prefetch          = false;
+   thumbnail_tag->wanted            = false;
 
    /* Would like to cancel any existing image load tasks
     * here, but can't see how to do it... */
@@ -385,6 +793,8 @@ void gfx_thumbnail_request_file(
          gfx_thumbnail_upscale_threshold,
          gfx_thumbnail_handle_upload, thumbnail_tag))
       thumbnail->status = GFX_THUMBNAIL_STATUS_PENDING;
+   else
+      gfx_thumbnail_tag_free(thumbnail_tag);
 }
 
 /* Resets (and free()s the current texture of) the
@@ -394,8 +804,11 @@ void gfx_thumbnail_reset(gfx_thumbnail_t *thumbnail)
    if (!thumbnail)
       return;
 
-   /* Unload texture */
-   if (thumbnail->texture)
+   /* Unload texture, unless it is retained by
+    * the in-memory cache */
+   if (thumbnail->texture &&
+       !gfx_thumbnail_cache_release(gfx_thumb_get_ptr(),
+            thumbnail->texture))
       video_driver_texture_unload(&thumbnail->texture);
 
    /* Ensure any 'fade in' animation is killed */
@@ -415,6 +828,191 @@ void gfx_thumbnail_reset(gfx_thumbnail_t *thumbnail)
    thumbnail->fade_active = false;
 }
 
+/* Queues a prefetch request for the specified image,
+ * unless it is already cached or being loaded */
+static void gfx_thumbnail_prefetch_image(
+      gfx_thumbnail_state_t *p_gfx_thumb, const char *path,
+      unsigned upscale_threshold)
+{
+   size_t i;
+   gfx_thumbnail_tag_t *thumbnail_tag = NULL;
+
+   if (gfx_thumbnail_cache_find(p_gfx_thumb, path, upscale_threshold))
+      return;
+
+   /* If a request is already outstanding, keep it */
+   if ((thumbnail_tag = gfx_thumbnail_prefetch_find(
+               p_gfx_thumb, path, upscale_threshold)))
+   {
+      thumbnail_tag->wanted = true;
+      return;
+   }
+
+   /* Enforce memory budget */
+   if (p_gfx_thumb->prefetch_size >= GFX_THUMBNAIL_PREFETCH_SIZE_MAX)
+      return;
+
+   for (i = 0; i < GFX_THUMBNAIL_PREFETCH_SLOTS; i++)
+      if (!p_gfx_thumb->prefetch_tags[i])
+         break;
+
+   if (i == GFX_THUMBNAIL_PREFETCH_SLOTS)
+      return;
+
+   if (!(thumbnail_tag = (gfx_thumbnail_tag_t*)
+            malloc(sizeof(gfx_thumbnail_tag_t))))
+      return;
+
+   thumbnail_tag->path              = strdup(path);
+   thumbnail_tag->thumbnail         = NULL;
+   thumbnail_tag->list_id           = p_gfx_thumb->list_id;
+   thumbnail_tag->upscale_threshold = upscale_threshold;
+   thumbnail_tag->prefetch          = true;
+   thumbnail_tag->wanted            = true;
+
+   if (!thumbnail_tag->path ||
+       !task_push_image_load_cached(
+            path, video_driver_supports_rgba(), upscale_threshold,
+            gfx_thumbnail_handle_upload, thumbnail_tag))
+   {
+      gfx_thumbnail_tag_free(thumbnail_tag);
+      return;
+   }
+
+   p_gfx_thumb->prefetch_tags[i] = thumbnail_tag;
+}
+
+/* Prefetches right/left thumbnails of the specified
+ * playlist entry */
+static void gfx_thumbnail_prefetch_entry(
+      gfx_thumbnail_state_t *p_gfx_thumb,
+      playlist_t *playlist, size_t idx,
+      unsigned upscale_threshold)
+{
+   gfx_thumbnail_path_data_t *path_data = p_gfx_thumb->prefetch_path_data;
+   enum gfx_thumbnail_id thumbnail_ids[2];
+   size_t i;
+
+   thumbnail_ids[0] = GFX_THUMBNAIL_RIGHT;
+   thumbnail_ids[1] = GFX_THUMBNAIL_LEFT;
+
+   if (!gfx_thumbnail_set_content_playlist(path_data, playlist, idx))
+      return;
+
+   for (i = 0; i < 2; i++)
+   {
+      const char *thumbnail_path = NULL;
+
+      if (!gfx_thumbnail_is_enabled(path_data, thumbnail_ids[i]))
+         continue;
+
+      if (!gfx_thumbnail_update_path(path_data, thumbnail_ids[i]))
+         continue;
+
+      if (gfx_thumbnail_get_path(path_data, thumbnail_ids[i],
+               &thumbnail_path))
+         gfx_thumbnail_prefetch_image(p_gfx_thumb,
+               thumbnail_path, upscale_threshold);
+   }
+}
+
+/* Queues background loads of the thumbnails of playlist
+ * entries adjacent to 'selection', so they are available
+ * immediately when scrolled to. The prefetch window
+ * extends further in the current scroll direction when
+ * scrolling quickly. Prefetched images are held by the
+ * in-memory texture cache
+ * NOTE 1: Must be called *after* gfx_thumbnail_request()
+ *         for the current selection
+ * NOTE 2: Any outstanding prefetch requests for entries
+ *         outside the new window are discarded on
+ *         completion (as are all outstanding prefetch
+ *         requests following a call of
+ *         gfx_thumbnail_cancel_pending_requests()) */
+void gfx_thumbnail_prefetch(
+      gfx_thumbnail_path_data_t *path_data,
+      playlist_t *playlist, size_t selection,
+      unsigned gfx_thumbnail_upscale_threshold)
+{
+   gfx_thumbnail_state_t *p_gfx_thumb = gfx_thumb_get_ptr();
+   retro_time_t current_time          = cpu_features_get_time_usec();
+   size_t list_size                   = 0;
+   size_t num_ahead                   = GFX_THUMBNAIL_PREFETCH_AHEAD;
+   size_t num_behind                  = GFX_THUMBNAIL_PREFETCH_BEHIND;
+   size_t num_entries;
+   size_t i;
+
+   if (!path_data || !playlist)
+      return;
+
+   /* Requests for entries outside the new window
+    * are no longer required */
+   gfx_thumbnail_prefetch_invalidate(p_gfx_thumb);
+
+   list_size = playlist_size(playlist);
+   if (selection >= list_size)
+      return;
+
+   /* Determine scroll direction and speed */
+   if (selection != p_gfx_thumb->prefetch_selection)
+   {
+      size_t delta = (selection > p_gfx_thumb->prefetch_selection) ?
+            selection - p_gfx_thumb->prefetch_selection :
+            p_gfx_thumb->prefetch_selection - selection;
+
+      p_gfx_thumb->prefetch_direction =
+            (selection > p_gfx_thumb->prefetch_selection) ? 1 : -1;
+
+      /* Fast single-step scrolling: look further ahead,
+       * skip entries that have just been passed */
+      if ((delta == 1) &&
+          (current_time - p_gfx_thumb->prefetch_time <
+               GFX_THUMBNAIL_PREFETCH_FAST_INTERVAL))
+      {
+         num_ahead  = GFX_THUMBNAIL_PREFETCH_AHEAD_FAST;
+         num_behind = 0;
+      }
+   }
+
+   p_gfx_thumb->prefetch_selection = selection;
+   p_gfx_thumb->prefetch_time      = current_time;
+
+   if (p_gfx_thumb->prefetch_direction == 0)
+      p_gfx_thumb->prefetch_direction = 1;
+
+   /* Get working copy of path data (content will
+    * be replaced for each prefetched entry) */
+   if (!p_gfx_thumb->prefetch_path_data)
+      if (!(p_gfx_thumb->prefetch_path_data = gfx_thumbnail_path_init()))
+         return;
+
+   gfx_thumbnail_path_copy(p_gfx_thumb->prefetch_path_data, path_data);
+
+   /* Queue requests in order of likely use:
+    * nearest entries first, alternating between
+    * 'ahead' and 'behind' */
+   num_entries = (num_ahead > num_behind) ? num_ahead : num_behind;
+
+   for (i = 1; i <= num_entries; i++)
+   {
+      size_t idx_next = (p_gfx_thumb->prefetch_direction > 0) ?
+            selection + i : selection - i;
+      size_t idx_prev = (p_gfx_thumb->prefetch_direction > 0) ?
+            selection - i : selection + i;
+
+      /* Note: out of range indices (including wrap
+       * around on subtraction) are rejected by the
+       * list_size check */
+      if ((i <= num_ahead) && (idx_next < list_size))
+         gfx_thumbnail_prefetch_entry(p_gfx_thumb,
+               playlist, idx_next, gfx_thumbnail_upscale_threshold);
+
+      if ((i <= num_behind) && (idx_prev < list_size))
+         gfx_thumbnail_prefetch_entry(p_gfx_thumb,
+               playlist, idx_prev, gfx_thumbnail_upscale_threshold);
+   }
+}
+
 /* Stream processing */
 
 /* Handles streaming of the specified thumbnail as it moves
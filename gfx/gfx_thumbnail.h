@@ -92,6 +92,35 @@ typedef struct
    enum gfx_thumbnail_shadow_type type;
 } gfx_thumbnail_shadow_t;
 
+/* Maximum number of thumbnail textures tracked
+ * by the in-memory texture cache */
+#define GFX_THUMBNAIL_CACHE_SLOTS 64
+
+/* Maximum number of concurrent thumbnail
+ * prefetch requests */
+#define GFX_THUMBNAIL_PREFETCH_SLOTS 8
+
+/* Opaque image load request (userdata) */
+struct gfx_thumbnail_tag;
+
+/* Holds a thumbnail texture tracked by the in-memory
+ * texture cache. Textures are either 'in use' (owned
+ * by a gfx_thumbnail_t object) or 'idle' (retained
+ * after a gfx_thumbnail_reset(), available for reuse
+ * if the same image is requested again) */
+typedef struct
+{
+   char *path;
+   uintptr_t texture;
+   size_t size;
+   unsigned width;
+   unsigned height;
+   unsigned upscale_threshold;
+   uint32_t last_used;
+   bool in_use;
+   bool prefetched; /* Loaded ahead of use, not yet displayed */
+} gfx_thumbnail_cache_entry_t;
+
 /* Structure containing all gfx_thumbnail
  * global variables */
 struct gfx_thumbnail_state
@@ -108,6 +137,40 @@ struct gfx_thumbnail_state
     * at the time when the load completes */
    uint64_t list_id;
 
+   /* In-memory LRU cache of recently used thumbnail
+    * textures */
+   gfx_thumbnail_cache_entry_t cache[GFX_THUMBNAIL_CACHE_SLOTS];
+
+   /* Total size in bytes of all 'idle' cached
+    * textures */
+   size_t cache_idle_size;
+
+   /* Total size in bytes of all cached textures
+    * loaded by the prefetcher that have not yet
+    * been displayed */
+   size_t prefetch_size;
+
+   /* Outstanding prefetch requests */
+   struct gfx_thumbnail_tag *prefetch_tags[GFX_THUMBNAIL_PREFETCH_SLOTS];
+
+   /* Working copy of the menu thumbnail path data,
+    * used to resolve paths of neighbouring entries */
+   gfx_thumbnail_path_data_t *prefetch_path_data;
+
+   /* Time of the last prefetch */
+   retro_time_t prefetch_time;
+
+   /* Selection at the time of the last prefetch */
+   size_t prefetch_selection;
+
+   /* Incremented each time a cached texture is
+    * released, used to identify the least recently
+    * used entry */
+   uint32_t cache_counter;
+
+   /* Last scroll direction (-1: up, 1: down) */
+   int prefetch_direction;
+
    /* When streaming thumbnails, to minimise the processing
     * of unnecessary images (i.e. when scrolling rapidly through
     * playlists), we delay loading until an entry has been on screen
@@ -189,6 +252,32 @@ void gfx_thumbnail_request_file(
  * specified thumbnail */
 void gfx_thumbnail_reset(gfx_thumbnail_t *thumbnail);
 
+/* Queues background loads of the thumbnails of playlist
+ * entries adjacent to 'selection', so they are available
+ * immediately when scrolled to. The prefetch window
+ * extends further in the current scroll direction when
+ * scrolling quickly. Prefetched images are held by the
+ * in-memory texture cache
+ * NOTE 1: Must be called *after* gfx_thumbnail_request()
+ *         for the current selection
+ * NOTE 2: Any outstanding prefetch requests for entries
+ *         outside the new window are discarded on
+ *         completion (as are all outstanding prefetch
+ *         requests following a call of
+ *         gfx_thumbnail_cancel_pending_requests()) */
+void gfx_thumbnail_prefetch(
+      gfx_thumbnail_path_data_t *path_data,
+      playlist_t *playlist, size_t selection,
+      unsigned gfx_thumbnail_upscale_threshold);
+
+/* Unloads all idle textures held by the in-memory
+ * thumbnail cache, and stops tracking any textures
+ * currently in use
+ * >> **MUST** be called whenever the menu driver
+ *    context is destroyed, before the video driver
+ *    is deinitialised */
+void gfx_thumbnail_cache_flush(void);
+
 /* Stream processing */
 
 /* Handles streaming of the specified thumbnail as it moves
@@ -72,6 +72,18 @@ void gfx_thumbnail_path_reset(gfx_thumbnail_path_data_t *path_data)
    path_data->playlist_left_mode  = PLAYLIST_THUMBNAIL_MODE_DEFAULT;
 }
 
+/* Copies all thumbnail path data from 'src' to 'dst'
+ * (allows thumbnail paths of other content to be
+ * resolved without modifying the source object) */
+void gfx_thumbnail_path_copy(gfx_thumbnail_path_data_t *dst,
+      const gfx_thumbnail_path_data_t *src)
+{
+   if (!dst || !src || (dst == src))
+      return;
+
+   memcpy(dst, src, sizeof(*dst));
+}
+
 /* Initialisation */
 
 /* Creates new thumbnail path data container.
@@ -62,6 +62,12 @@ gfx_thumbnail_path_data_t *gfx_thumbnail_path_init(void);
  * (blanks all internal string containers) */
 void gfx_thumbnail_path_reset(gfx_thumbnail_path_data_t *path_data);
 
+/* Copies all thumbnail path data from 'src' to 'dst'
+ * (allows thumbnail paths of other content to be
+ * resolved without modifying the source object) */
+void gfx_thumbnail_path_copy(gfx_thumbnail_path_data_t *dst,
+      const gfx_thumbnail_path_data_t *src);
+
 /* Utility Functions */
 
 /* Fetches the thumbnail subdirectory (Named_Snaps,
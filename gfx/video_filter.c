@@ -31,6 +31,7 @@
 #include "../frontend/frontend_driver.h"
 #include "../dynamic.h"
 #include "../performance_counters.h"
+#include "../retroarch.h"
 #include "../verbosity.h"
 #include "video_filter.h"
 #include "video_filters/softfilter.h"
@@ -43,6 +44,32 @@ struct rarch_soft_plug
    const struct softfilter_implementation *impl;
 };
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+
+/* Plugins are asked for this many packets per thread, so that
+ * bands finishing early can pick up work from slower ones. */
+#define SOFTFILTER_BANDS_PER_THREAD 4
+/* Never cut bands thinner than this many input rows. */
+#define SOFTFILTER_MIN_BAND_ROWS    8
+
+/* Range of packet indices owned by one thread. The owner pops
+ * from the head, idle threads steal from the tail. */
+struct softfilter_queue
+{
+   slock_t *lock;
+   unsigned head;
+   unsigned tail;
+};
+
+struct softfilter_worker
+{
+   struct rarch_softfilter *filt;
+   sthread_t *thread;
+   unsigned index;
+};
+#endif
+
 struct rarch_softfilter
 {
    config_file_t *conf;
@@ -57,51 +84,194 @@ struct rarch_softfilter
    enum retro_pixel_format pix_fmt, out_pix_fmt;
 
    struct softfilter_work_packet *packets;
+   unsigned num_packets;
    unsigned threads;
 
 #ifdef HAVE_THREADS
-   struct filter_thread_data *thread_data;
+   /* threads - 1 workers; the calling thread acts as
+    * worker 0 and owns queues[0]. */
+   struct softfilter_worker *workers;
+   struct softfilter_queue *queues;
+   slock_t *lock;
+   scond_t *cond_work;
+   scond_t *cond_done;
+   unsigned generation;
+   unsigned pending;
+   bool die;
 #endif
 };
 
 #ifdef HAVE_THREADS
-#include <rthreads/rthreads.h>
+static bool softfilter_queue_pop(struct softfilter_queue *queue,
+      bool steal, unsigned *index)
+{
+   bool ret = false;
+
+   slock_lock(queue->lock);
+   if (queue->head < queue->tail)
+   {
+      *index = steal ? --queue->tail : queue->head++;
+      ret    = true;
+   }
+   slock_unlock(queue->lock);
 
-struct filter_thread_data
+   return ret;
+}
+
+/* Picks the next packet for thread @self: its own queue first,
+ * then the tail of whichever other queue has the most left. */
+static bool softfilter_next_packet(rarch_softfilter_t *filt,
+      unsigned self, unsigned *index)
 {
-   sthread_t *thread;
-   const struct softfilter_work_packet *packet;
-   scond_t *cond;
-   slock_t *lock;
-   void *userdata;
-   bool die;
-   bool done;
-};
+   for (;;)
+   {
+      unsigned i;
+      unsigned victim = self;
+      unsigned most   = 0;
+
+      if (softfilter_queue_pop(&filt->queues[self], false, index))
+         return true;
+
+      for (i = 0; i < filt->threads; i++)
+      {
+         unsigned left;
+         if (i == self)
+            continue;
+         slock_lock(filt->queues[i].lock);
+         left = filt->queues[i].tail - filt->queues[i].head;
+         slock_unlock(filt->queues[i].lock);
+         if (left > most)
+         {
+            most   = left;
+            victim = i;
+         }
+      }
+
+      if (victim == self)
+         return false;
+      if (softfilter_queue_pop(&filt->queues[victim], true, index))
+         return true;
+   }
+}
+
+static void softfilter_run_packets(rarch_softfilter_t *filt, unsigned self)
+{
+   unsigned index;
+   unsigned done = 0;
+
+   while (softfilter_next_packet(filt, self, &index))
+   {
+      const struct softfilter_work_packet *packet = &filt->packets[index];
+      if (packet->work)
+         packet->work(filt->impl_data, packet->thread_data);
+      done++;
+   }
+
+   if (!done)
+      return;
+
+   slock_lock(filt->lock);
+   filt->pending -= done;
+   if (!filt->pending)
+      scond_signal(filt->cond_done);
+   slock_unlock(filt->lock);
+}
 
 static void filter_thread_loop(void *data)
 {
-   struct filter_thread_data *thr = (struct filter_thread_data*)data;
+   struct softfilter_worker *worker = (struct softfilter_worker*)data;
+   rarch_softfilter_t *filt         = worker->filt;
+   unsigned generation              = 0;
 
    for (;;)
    {
-      bool die;
-      slock_lock(thr->lock);
-      while (thr->done && !thr->die)
-         scond_wait(thr->cond, thr->lock);
-      die = thr->die;
-      slock_unlock(thr->lock);
-
-      if (die)
+      slock_lock(filt->lock);
+      while (filt->generation == generation && !filt->die)
+         scond_wait(filt->cond_work, filt->lock);
+      generation = filt->generation;
+      if (filt->die)
+      {
+         slock_unlock(filt->lock);
          break;
+      }
+      slock_unlock(filt->lock);
+
+      softfilter_run_packets(filt, worker->index);
+   }
+}
 
-      if (thr->packet && thr->packet->work)
-         thr->packet->work(thr->userdata, thr->packet->thread_data);
+static bool softfilter_init_threads(rarch_softfilter_t *filt)
+{
+   unsigned i;
 
-      slock_lock(thr->lock);
-      thr->done = true;
-      scond_signal(thr->cond);
-      slock_unlock(thr->lock);
+   if (!(filt->lock = slock_new()))
+      return false;
+   if (!(filt->cond_work = scond_new()))
+      return false;
+   if (!(filt->cond_done = scond_new()))
+      return false;
+
+   filt->queues  = (struct softfilter_queue*)
+      calloc(filt->threads, sizeof(*filt->queues));
+   filt->workers = (struct softfilter_worker*)
+      calloc(filt->threads - 1, sizeof(*filt->workers));
+   if (!filt->queues || !filt->workers)
+      return false;
+
+   for (i = 0; i < filt->threads; i++)
+      if (!(filt->queues[i].lock = slock_new()))
+         return false;
+
+   for (i = 0; i < filt->threads - 1; i++)
+   {
+      filt->workers[i].filt   = filt;
+      filt->workers[i].index  = i + 1;
+      filt->workers[i].thread = sthread_create(
+            filter_thread_loop, &filt->workers[i]);
+      if (!filt->workers[i].thread)
+         return false;
+   }
+
+   return true;
+}
+
+static void softfilter_deinit_threads(rarch_softfilter_t *filt)
+{
+   unsigned i;
+
+   if (filt->workers)
+   {
+      slock_lock(filt->lock);
+      filt->die = true;
+      scond_broadcast(filt->cond_work);
+      slock_unlock(filt->lock);
+
+      for (i = 0; i < filt->threads - 1; i++)
+         if (filt->workers[i].thread)
+            sthread_join(filt->workers[i].thread);
+      free(filt->workers);
+   }
+
+   if (filt->queues)
+   {
+      for (i = 0; i < filt->threads; i++)
+         if (filt->queues[i].lock)
+            slock_free(filt->queues[i].lock);
+      free(filt->queues);
    }
+
+   if (filt->cond_done)
+      scond_free(filt->cond_done);
+   if (filt->cond_work)
+      scond_free(filt->cond_work);
+   if (filt->lock)
+      slock_free(filt->lock);
+
+   filt->workers   = NULL;
+   filt->queues    = NULL;
+   filt->cond_done = NULL;
+   filt->cond_work = NULL;
+   filt->lock      = NULL;
 }
 #endif
 
@@ -135,12 +305,10 @@ static bool create_softfilter_graph(rarch_softfilter_t *filt,
       softfilter_simd_mask_t cpu_features,
       unsigned threads)
 {
-   unsigned input_fmts, input_fmt, output_fmts, i = 0;
+   unsigned input_fmts, input_fmt, output_fmts, bands;
    struct config_file_userdata userdata;
    char key[64], name[64];
 
-   (void)i;
-
    key[0] = name[0] = '\0';
 
    snprintf(key, sizeof(key), "filter");
@@ -208,29 +376,47 @@ static bool create_softfilter_graph(rarch_softfilter_t *filt,
    filt->max_width = max_width;
    filt->max_height = max_height;
 
+   if (threads == RARCH_SOFTFILTER_THREADS_AUTO)
+      threads = cpu_features_get_core_amount();
+
+#ifdef HAVE_THREADS
+   /* Plugins treat the thread count as the number of bands to cut
+    * the frame into, so ask for more bands than threads. Plugins
+    * which only do a single packet are not affected. */
+   bands = threads * SOFTFILTER_BANDS_PER_THREAD;
+   if (bands > max_height / SOFTFILTER_MIN_BAND_ROWS)
+      bands = max_height / SOFTFILTER_MIN_BAND_ROWS;
+   if (bands < threads)
+      bands = threads;
+#else
+   bands = threads;
+#endif
+
    filt->impl_data = filt->impl->create(
          &softfilter_config, input_fmt, input_fmt, max_width, max_height,
-         threads != RARCH_SOFTFILTER_THREADS_AUTO ? threads :
-         cpu_features_get_core_amount(), cpu_features,
-         &userdata);
+         bands, cpu_features, &userdata);
    if (!filt->impl_data)
    {
       RARCH_ERR("Failed to create softfilter state.\n");
       return false;
    }
 
-   threads = filt->impl->query_num_threads(filt->impl_data);
-   if (!threads)
+   filt->num_packets = filt->impl->query_num_threads(filt->impl_data);
+   if (!filt->num_packets)
    {
       RARCH_ERR("Invalid number of threads.\n");
       return false;
    }
 
+   if (threads > filt->num_packets)
+      threads = filt->num_packets;
+
    filt->threads = threads;
-   RARCH_LOG("Using %u threads for softfilter.\n", threads);
+   RARCH_LOG("Using %u threads for softfilter (%u bands).\n",
+         threads, filt->num_packets);
 
    filt->packets = (struct softfilter_work_packet*)
-      calloc(threads, sizeof(*filt->packets));
+      calloc(filt->num_packets, sizeof(*filt->packets));
    if (!filt->packets)
    {
       RARCH_ERR("Failed to allocate softfilter packets.\n");
@@ -238,29 +424,10 @@ static bool create_softfilter_graph(rarch_softfilter_t *filt,
    }
 
 #ifdef HAVE_THREADS
-   if (filt->threads > 1)
+   if (filt->threads > 1 && !softfilter_init_threads(filt))
    {
-      filt->thread_data = (struct filter_thread_data*)
-         calloc(threads, sizeof(*filt->thread_data));
-      if (!filt->thread_data)
-         return false;
-
-      for (i = 0; i < threads; i++)
-      {
-         filt->thread_data[i].userdata = filt->impl_data;
-         filt->thread_data[i].done     = true;
-
-         filt->thread_data[i].lock     = slock_new();
-         if (!filt->thread_data[i].lock)
-            return false;
-         filt->thread_data[i].cond     = scond_new();
-         if (!filt->thread_data[i].cond)
-            return false;
-         filt->thread_data[i].thread   = sthread_create(
-               filter_thread_loop, &filt->thread_data[i]);
-         if (!filt->thread_data[i].thread)
-            return false;
-      }
+      RARCH_ERR("Failed to start softfilter threads.\n");
+      return false;
    }
 #endif
 
@@ -473,6 +640,10 @@ void rarch_softfilter_free(rarch_softfilter_t *filt)
    if (!filt)
       return;
 
+#ifdef HAVE_THREADS
+   softfilter_deinit_threads(filt);
+#endif
+
    free(filt->packets);
    if (filt->impl && filt->impl_data)
       filt->impl->destroy(filt->impl_data);
@@ -486,27 +657,6 @@ void rarch_softfilter_free(rarch_softfilter_t *filt)
    free(filt->plugs);
 #endif
 
-#ifdef HAVE_THREADS
-   if (filt->threads > 1)
-   {
-      for (i = 0; i < filt->threads; i++)
-      {
-         if (!&filt->thread_data[i])
-            continue;
-         if (!filt->thread_data[i].thread)
-            continue;
-         slock_lock(filt->thread_data[i].lock);
-         filt->thread_data[i].die = true;
-         scond_signal(filt->thread_data[i].cond);
-         slock_unlock(filt->thread_data[i].lock);
-         sthread_join(filt->thread_data[i].thread);
-         slock_free(filt->thread_data[i].lock);
-         scond_free(filt->thread_data[i].cond);
-      }
-      free(filt->thread_data);
-   }
-#endif
-
    if (filt->conf)
       config_file_free(filt->conf);
 
@@ -540,11 +690,16 @@ void rarch_softfilter_process(rarch_softfilter_t *filt,
       const void *input, unsigned width, unsigned height,
       size_t input_stride)
 {
+   static struct retro_perf_counter softfilter_process_perf = {0};
+   bool perfcnt_enable = rarch_ctl(RARCH_CTL_IS_PERFCNT_ENABLE, NULL);
    unsigned i;
 
    if (!filt)
       return;
 
+   performance_counter_init(softfilter_process_perf, "softfilter_process");
+   performance_counter_start_plus(perfcnt_enable, softfilter_process_perf);
+
    if (filt->impl && filt->impl->get_work_packets)
       filt->impl->get_work_packets(filt->impl_data, filt->packets,
             output, output_stride, input, width, height, input_stride);
@@ -552,34 +707,41 @@ void rarch_softfilter_process(rarch_softfilter_t *filt,
 #ifdef HAVE_THREADS
    if (filt->threads > 1)
    {
-      /* Fire off workers */
-      for (i = 0; i < filt->threads; i++)
-      {
-#if 0
-         RARCH_LOG("Firing off filter thread %u ...\n", i);
-#endif
-         filt->thread_data[i].packet = &filt->packets[i];
-         slock_lock(filt->thread_data[i].lock);
-         filt->thread_data[i].done = false;
-         scond_signal(filt->thread_data[i].cond);
-         slock_unlock(filt->thread_data[i].lock);
-      }
+      /* Hand every thread an even share of the bands. Whoever
+       * runs out first steals from the others. */
+      slock_lock(filt->lock);
+      filt->pending = filt->num_packets;
+      slock_unlock(filt->lock);
 
-      /* Wait for workers */
       for (i = 0; i < filt->threads; i++)
       {
-#if 0
-         RARCH_LOG("Waiting for filter thread %u ...\n", i);
-#endif
-         slock_lock(filt->thread_data[i].lock);
-         while (!filt->thread_data[i].done)
-            scond_wait(filt->thread_data[i].cond, filt->thread_data[i].lock);
-         slock_unlock(filt->thread_data[i].lock);
+         struct softfilter_queue *queue = &filt->queues[i];
+         slock_lock(queue->lock);
+         queue->head = (filt->num_packets * i) / filt->threads;
+         queue->tail = (filt->num_packets * (i + 1)) / filt->threads;
+         slock_unlock(queue->lock);
       }
-      return;
+
+      slock_lock(filt->lock);
+      filt->generation++;
+      scond_broadcast(filt->cond_work);
+      slock_unlock(filt->lock);
+
+      softfilter_run_packets(filt, 0);
+
+      slock_lock(filt->lock);
+      while (filt->pending)
+         scond_wait(filt->cond_done, filt->lock);
+      slock_unlock(filt->lock);
    }
+   else
 #endif
+   {
+      for (i = 0; i < filt->num_packets; i++)
+         if (filt->packets[i].work)
+            filt->packets[i].work(filt->impl_data,
+                  filt->packets[i].thread_data);
+   }
 
-   for (i = 0; i < filt->threads; i++)
-      filt->packets[i].work(filt->impl_data, filt->packets[i].thread_data);
+   performance_counter_stop_plus(perfcnt_enable, softfilter_process_perf);
 }
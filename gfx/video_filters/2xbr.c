@@ -39,6 +39,18 @@
 #include <math.h>
 #include <retro_endianness.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define TWOXBR_SSE2
+#define TWOXBR_SIMD SOFTFILTER_SIMD_SSE2
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !defined(DONT_WANT_ARM_OPTIMIZATIONS)
+#include <arm_neon.h>
+#define TWOXBR_NEON
+#define TWOXBR_SIMD SOFTFILTER_SIMD_NEON
+#else
+#define TWOXBR_SIMD 0
+#endif
+
 #ifdef RARCH_INTERNAL
 #define softfilter_get_implementation twoxbr_get_implementation
 #define softfilter_thread_data twoxbr_softfilter_thread_data
@@ -58,6 +70,7 @@ struct softfilter_thread_data
    unsigned height;
    int first;
    int last;
+   softfilter_simd_mask_t simd;
 };
 
 struct filter_data
@@ -65,6 +78,7 @@ struct filter_data
    unsigned threads;
    struct softfilter_thread_data *workers;
    unsigned in_fmt;
+   softfilter_simd_mask_t simd;
    uint16_t RGBtoYUV[65536];
    uint16_t tbl_5_to_8[32];
    uint16_t tbl_6_to_8[64];
@@ -226,7 +240,6 @@ static void *twoxbr_generic_create(const struct softfilter_config *config,
       unsigned threads, softfilter_simd_mask_t simd, void *userdata)
 {
    struct filter_data *filt = (struct filter_data*)calloc(1, sizeof(*filt));
-   (void)simd;
    (void)config;
    (void)userdata;
    if (!filt)
@@ -235,6 +248,7 @@ static void *twoxbr_generic_create(const struct softfilter_config *config,
       calloc(threads, sizeof(struct softfilter_thread_data));
    filt->threads = 1;
    filt->in_fmt  = in_fmt;
+   filt->simd    = simd;
    if (!filt->workers)
    {
       free(filt);
@@ -535,8 +549,91 @@ int eq8(uint32_t A, uint32_t B,
          out += 2
 #endif
 
+/* Every FILTRO pass starts out by checking that PE differs
+ * from both of the edge neighbours on its side, so wherever PE
+ * matches PD and PF, or PB and PH, all four passes leave E at
+ * PE. These look for whole vectors of such pixels and write
+ * them out doubled; blocks with an edge in them are left to
+ * the C path. */
+#if defined(TWOXBR_SSE2)
+#define TWOXBR_FLAT_SSE2(name, typename_t, cmpeq, unpacklo, unpackhi) \
+static int name(const typename_t *in, unsigned nextline, \
+      typename_t *out, unsigned dst_stride) \
+{ \
+   __m128i PB   = _mm_loadu_si128((const __m128i*)(in - nextline)); \
+   __m128i PD   = _mm_loadu_si128((const __m128i*)(in - 1)); \
+   __m128i PE   = _mm_loadu_si128((const __m128i*)in); \
+   __m128i PF   = _mm_loadu_si128((const __m128i*)(in + 1)); \
+   __m128i PH   = _mm_loadu_si128((const __m128i*)(in + nextline)); \
+   __m128i eqB  = cmpeq(PE, PB); \
+   __m128i eqD  = cmpeq(PE, PD); \
+   __m128i eqF  = cmpeq(PE, PF); \
+   __m128i eqH  = cmpeq(PE, PH); \
+   __m128i flat = _mm_and_si128( \
+         _mm_and_si128(_mm_or_si128(eqH, eqF), _mm_or_si128(eqF, eqB)), \
+         _mm_and_si128(_mm_or_si128(eqB, eqD), _mm_or_si128(eqD, eqH))); \
+   \
+   if (_mm_movemask_epi8(flat) != 0xFFFF) \
+      return 0; \
+   \
+   _mm_storeu_si128((__m128i*)out, unpacklo(PE, PE)); \
+   _mm_storeu_si128((__m128i*)out + 1, unpackhi(PE, PE)); \
+   _mm_storeu_si128((__m128i*)(out + dst_stride), unpacklo(PE, PE)); \
+   _mm_storeu_si128((__m128i*)(out + dst_stride) + 1, unpackhi(PE, PE)); \
+   return 1; \
+}
+
+TWOXBR_FLAT_SSE2(twoxbr_flat_rgb565, uint16_t,
+      _mm_cmpeq_epi16, _mm_unpacklo_epi16, _mm_unpackhi_epi16)
+TWOXBR_FLAT_SSE2(twoxbr_flat_xrgb8888, uint32_t,
+      _mm_cmpeq_epi32, _mm_unpacklo_epi32, _mm_unpackhi_epi32)
+#define TWOXBR_STEP_RGB565   8
+#define TWOXBR_STEP_XRGB8888 4
+#elif defined(TWOXBR_NEON)
+#define TWOXBR_FLAT_NEON(name, typename_t, vec_t, pair_t, sfx) \
+static int name(const typename_t *in, unsigned nextline, \
+      typename_t *out, unsigned dst_stride) \
+{ \
+   vec_t PB   = vld1q_##sfx(in - nextline); \
+   vec_t PD   = vld1q_##sfx(in - 1); \
+   vec_t PE   = vld1q_##sfx(in); \
+   vec_t PF   = vld1q_##sfx(in + 1); \
+   vec_t PH   = vld1q_##sfx(in + nextline); \
+   vec_t eqB  = vceqq_##sfx(PE, PB); \
+   vec_t eqD  = vceqq_##sfx(PE, PD); \
+   vec_t eqF  = vceqq_##sfx(PE, PF); \
+   vec_t eqH  = vceqq_##sfx(PE, PH); \
+   vec_t flat = vandq_##sfx( \
+         vandq_##sfx(vorrq_##sfx(eqH, eqF), vorrq_##sfx(eqF, eqB)), \
+         vandq_##sfx(vorrq_##sfx(eqB, eqD), vorrq_##sfx(eqD, eqH))); \
+   uint64x2_t edge = vreinterpretq_u64_##sfx(vmvnq_##sfx(flat)); \
+   pair_t row; \
+   \
+   if (vgetq_lane_u64(edge, 0) | vgetq_lane_u64(edge, 1)) \
+      return 0; \
+   \
+   row.val[0] = PE; \
+   row.val[1] = PE; \
+   vst2q_##sfx(out, row); \
+   vst2q_##sfx(out + dst_stride, row); \
+   return 1; \
+}
+
+TWOXBR_FLAT_NEON(twoxbr_flat_rgb565, uint16_t,
+      uint16x8_t, uint16x8x2_t, u16)
+TWOXBR_FLAT_NEON(twoxbr_flat_xrgb8888, uint32_t,
+      uint32x4_t, uint32x4x2_t, u32)
+#define TWOXBR_STEP_RGB565   8
+#define TWOXBR_STEP_XRGB8888 4
+#else
+#define twoxbr_flat_rgb565(in, nextline, out, dst_stride)   0
+#define twoxbr_flat_xrgb8888(in, nextline, out, dst_stride) 0
+#define TWOXBR_STEP_RGB565   1
+#define TWOXBR_STEP_XRGB8888 1
+#endif
+
 static void twoxbr_generic_xrgb8888(void *data, unsigned width, unsigned height,
-      int first, int last, uint32_t *src,
+      int first, int last, int simd, uint32_t *src,
       unsigned src_stride, uint32_t *dst, unsigned dst_stride)
 {
    unsigned nextline, finish;
@@ -556,41 +653,59 @@ static void twoxbr_generic_xrgb8888(void *data, unsigned width, unsigned height,
       uint32_t *in  = (uint32_t*)src;
       uint32_t *out = (uint32_t*)dst;
 
-      for (finish = width; finish; finish -= 1)
+      finish = width;
+      while (finish)
       {
-         uint32_t E[4];
-         uint32_t ex, e, i, ke, ki, ex2, ex3, px;
-         uint32_t A1 = *(in - nextline - nextline - 1);
-         uint32_t B1 = *(in - nextline - nextline);
-         uint32_t C1 = *(in - nextline - nextline + 1);
-         uint32_t A0 = *(in - nextline - 2);
-         uint32_t PA = *(in - nextline - 1);
-         uint32_t PB = *(in - nextline);
-         uint32_t PC = *(in - nextline + 1);
-         uint32_t C4 = *(in - nextline + 2);
-         uint32_t D0 = *(in - 2);
-         uint32_t PD = *(in - 1);
-         uint32_t PE = *(in);
-         uint32_t PF = *(in + 1);
-         uint32_t F4 = *(in + 2);
-         uint32_t G0 = *(in + nextline - 2);
-         uint32_t PG = *(in + nextline - 1);
-         uint32_t PH = *(in + nextline);
-         uint32_t _PI = *(in + nextline + 1);
-         uint32_t I4 = *(in + nextline + 2);
-         uint32_t G5 = *(in + nextline + nextline - 1);
-         uint32_t H5 = *(in + nextline + nextline);
-         uint32_t I5 = *(in + nextline + nextline + 1);
-
-         /*
-          * Map of the pixels:          A1 B1 C1
-          *                          A0 PA PB PC C4
-          *                          D0 PD PE PF F4
-          *                          G0 PG PH _PI I4
-          *                             G5 H5 I5
-          */
-
-         twoxbr_function(FILTRO_RGB8888, filt);
+         unsigned run = 1;
+
+         if (simd && finish >= TWOXBR_STEP_XRGB8888)
+         {
+            if (twoxbr_flat_xrgb8888(in, nextline, out, dst_stride))
+            {
+               in     += TWOXBR_STEP_XRGB8888;
+               out    += TWOXBR_STEP_XRGB8888 << 1;
+               finish -= TWOXBR_STEP_XRGB8888;
+               continue;
+            }
+            run = TWOXBR_STEP_XRGB8888;
+         }
+
+         for (; run; run--, finish--)
+         {
+            uint32_t E[4];
+            uint32_t ex, e, i, ke, ki, ex2, ex3, px;
+            uint32_t A1 = *(in - nextline - nextline - 1);
+            uint32_t B1 = *(in - nextline - nextline);
+            uint32_t C1 = *(in - nextline - nextline + 1);
+            uint32_t A0 = *(in - nextline - 2);
+            uint32_t PA = *(in - nextline - 1);
+            uint32_t PB = *(in - nextline);
+            uint32_t PC = *(in - nextline + 1);
+            uint32_t C4 = *(in - nextline + 2);
+            uint32_t D0 = *(in - 2);
+            uint32_t PD = *(in - 1);
+            uint32_t PE = *(in);
+            uint32_t PF = *(in + 1);
+            uint32_t F4 = *(in + 2);
+            uint32_t G0 = *(in + nextline - 2);
+            uint32_t PG = *(in + nextline - 1);
+            uint32_t PH = *(in + nextline);
+            uint32_t _PI = *(in + nextline + 1);
+            uint32_t I4 = *(in + nextline + 2);
+            uint32_t G5 = *(in + nextline + nextline - 1);
+            uint32_t H5 = *(in + nextline + nextline);
+            uint32_t I5 = *(in + nextline + nextline + 1);
+
+            /*
+             * Map of the pixels:          A1 B1 C1
+             *                          A0 PA PB PC C4
+             *                          D0 PD PE PF F4
+             *                          G0 PG PH _PI I4
+             *                             G5 H5 I5
+             */
+
+            twoxbr_function(FILTRO_RGB8888, filt);
+         }
       }
 
       src += src_stride;
@@ -599,7 +714,7 @@ static void twoxbr_generic_xrgb8888(void *data, unsigned width, unsigned height,
 }
 
 static void twoxbr_generic_rgb565(void *data, unsigned width, unsigned height,
-      int first, int last, uint16_t *src,
+      int first, int last, int simd, uint16_t *src,
       unsigned src_stride, uint16_t *dst, unsigned dst_stride)
 {
    unsigned finish;
@@ -615,41 +730,59 @@ static void twoxbr_generic_rgb565(void *data, unsigned width, unsigned height,
       uint16_t *in  = (uint16_t*)src;
       uint16_t *out = (uint16_t*)dst;
 
-      for (finish = width; finish; finish -= 1)
+      finish = width;
+      while (finish)
       {
-         uint16_t E[4];
-         uint16_t ex, e, i, ke, ki, ex2, ex3, px;
-         uint16_t A1 = *(in - nextline - nextline - 1);
-         uint16_t B1 = *(in - nextline - nextline);
-         uint16_t C1 = *(in - nextline - nextline + 1);
-         uint16_t A0 = *(in - nextline - 2);
-         uint16_t PA = *(in - nextline - 1);
-         uint16_t PB = *(in - nextline);
-         uint16_t PC = *(in - nextline + 1);
-         uint16_t C4 = *(in - nextline + 2);
-         uint16_t D0 = *(in - 2);
-         uint16_t PD = *(in - 1);
-         uint16_t PE = *(in);
-         uint16_t PF = *(in + 1);
-         uint16_t F4 = *(in + 2);
-         uint16_t G0 = *(in + nextline - 2);
-         uint16_t PG = *(in + nextline - 1);
-         uint16_t PH = *(in + nextline);
-         uint16_t _PI = *(in + nextline + 1);
-         uint16_t I4 = *(in + nextline + 2);
-         uint16_t G5 = *(in + nextline + nextline - 1);
-         uint16_t H5 = *(in + nextline + nextline);
-         uint16_t I5 = *(in + nextline + nextline + 1);
-
-         /*
-          * Map of the pixels:          A1 B1 C1
-          *                          A0 PA PB PC C4
-          *                          D0 PD PE PF F4
-          *                          G0 PG PH _PI I4
-          *                             G5 H5 I5
-          */
-
-         twoxbr_function(FILTRO_RGB565, filt);
+         unsigned run = 1;
+
+         if (simd && finish >= TWOXBR_STEP_RGB565)
+         {
+            if (twoxbr_flat_rgb565(in, nextline, out, dst_stride))
+            {
+               in     += TWOXBR_STEP_RGB565;
+               out    += TWOXBR_STEP_RGB565 << 1;
+               finish -= TWOXBR_STEP_RGB565;
+               continue;
+            }
+            run = TWOXBR_STEP_RGB565;
+         }
+
+         for (; run; run--, finish--)
+         {
+            uint16_t E[4];
+            uint16_t ex, e, i, ke, ki, ex2, ex3, px;
+            uint16_t A1 = *(in - nextline - nextline - 1);
+            uint16_t B1 = *(in - nextline - nextline);
+            uint16_t C1 = *(in - nextline - nextline + 1);
+            uint16_t A0 = *(in - nextline - 2);
+            uint16_t PA = *(in - nextline - 1);
+            uint16_t PB = *(in - nextline);
+            uint16_t PC = *(in - nextline + 1);
+            uint16_t C4 = *(in - nextline + 2);
+            uint16_t D0 = *(in - 2);
+            uint16_t PD = *(in - 1);
+            uint16_t PE = *(in);
+            uint16_t PF = *(in + 1);
+            uint16_t F4 = *(in + 2);
+            uint16_t G0 = *(in + nextline - 2);
+            uint16_t PG = *(in + nextline - 1);
+            uint16_t PH = *(in + nextline);
+            uint16_t _PI = *(in + nextline + 1);
+            uint16_t I4 = *(in + nextline + 2);
+            uint16_t G5 = *(in + nextline + nextline - 1);
+            uint16_t H5 = *(in + nextline + nextline);
+            uint16_t I5 = *(in + nextline + nextline + 1);
+
+            /*
+             * Map of the pixels:          A1 B1 C1
+             *                          A0 PA PB PC C4
+             *                          D0 PD PE PF F4
+             *                          G0 PG PH _PI I4
+             *                             G5 H5 I5
+             */
+
+            twoxbr_function(FILTRO_RGB565, filt);
+         }
       }
 
       src += src_stride;
@@ -667,7 +800,7 @@ static void twoxbr_work_cb_rgb565(void *data, void *thread_data)
    unsigned height = thr->height;
 
    twoxbr_generic_rgb565(data, width, height,
-         thr->first, thr->last, input,
+         thr->first, thr->last, thr->simd & TWOXBR_SIMD, input,
          (unsigned)(thr->in_pitch / SOFTFILTER_BPP_RGB565),
          output,
          (unsigned)(thr->out_pitch / SOFTFILTER_BPP_RGB565));
@@ -683,7 +816,7 @@ static void twoxbr_work_cb_xrgb8888(void *data, void *thread_data)
    unsigned height = thr->height;
 
    twoxbr_generic_xrgb8888(data, width, height,
-         thr->first, thr->last, input,
+         thr->first, thr->last, thr->simd & TWOXBR_SIMD, input,
          (unsigned)(thr->in_pitch / SOFTFILTER_BPP_XRGB8888),
         output,
          (unsigned)(thr->out_pitch / SOFTFILTER_BPP_XRGB8888));
@@ -713,6 +846,7 @@ static void twoxbr_generic_packets(void *data,
       thr->in_pitch = input_stride;
       thr->width = width;
       thr->height = y_end - y_start;
+      thr->simd = filt->simd;
 
       /* Workers need to know if they can access
        * pixels outside their given buffer. */
@@ -758,3 +892,9 @@ const struct softfilter_implementation *softfilter_get_implementation(
 #undef softfilter_thread_data
 #undef filter_data
 #endif
+
+#undef TWOXBR_SSE2
+#undef TWOXBR_NEON
+#undef TWOXBR_SIMD
+#undef TWOXBR_STEP_RGB565
+#undef TWOXBR_STEP_XRGB8888
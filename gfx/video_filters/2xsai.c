@@ -18,6 +18,18 @@
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define TWOXSAI_SSE2
+#define TWOXSAI_SIMD SOFTFILTER_SIMD_SSE2
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !defined(DONT_WANT_ARM_OPTIMIZATIONS)
+#include <arm_neon.h>
+#define TWOXSAI_NEON
+#define TWOXSAI_SIMD SOFTFILTER_SIMD_NEON
+#else
+#define TWOXSAI_SIMD 0
+#endif
+
 #ifdef RARCH_INTERNAL
 #define softfilter_get_implementation twoxsai_get_implementation
 #define softfilter_thread_data twoxsai_softfilter_thread_data
@@ -37,6 +49,7 @@ struct softfilter_thread_data
    unsigned height;
    int first;
    int last;
+   softfilter_simd_mask_t simd;
 };
 
 struct filter_data
@@ -44,6 +57,7 @@ struct filter_data
    unsigned threads;
    struct softfilter_thread_data *workers;
    unsigned in_fmt;
+   softfilter_simd_mask_t simd;
 };
 
 static unsigned twoxsai_generic_input_fmts(void)
@@ -69,7 +83,6 @@ static void *twoxsai_generic_create(const struct softfilter_config *config,
 {
    struct filter_data *filt = (struct filter_data*)calloc(1, sizeof(*filt));
 
-   (void)simd;
    (void)config;
    (void)userdata;
    if (!filt)
@@ -78,6 +91,7 @@ static void *twoxsai_generic_create(const struct softfilter_config *config,
       calloc(threads, sizeof(struct softfilter_thread_data));
    filt->threads = 1;
    filt->in_fmt  = in_fmt;
+   filt->simd    = simd;
    if (!filt->workers)
    {
       free(filt);
@@ -224,8 +238,204 @@ static void twoxsai_generic_destroy(void *data)
          out += 2
 #endif
 
+#if defined(TWOXSAI_SSE2)
+#define TWOXSAI_VEC16              __m128i
+#define TWOXSAI_VEC32              __m128i
+#define TWOXSAI_LOAD16(p)          _mm_loadu_si128((const __m128i*)(p))
+#define TWOXSAI_LOAD32(p)          _mm_loadu_si128((const __m128i*)(p))
+#define TWOXSAI_DUP16(x)           _mm_set1_epi16((short)(x))
+#define TWOXSAI_DUP32(x)           _mm_set1_epi32((int)(x))
+#define TWOXSAI_EQ16(a, b)         _mm_cmpeq_epi16(a, b)
+#define TWOXSAI_EQ32(a, b)         _mm_cmpeq_epi32(a, b)
+#define TWOXSAI_AND16(a, b)        _mm_and_si128(a, b)
+#define TWOXSAI_AND32(a, b)        _mm_and_si128(a, b)
+#define TWOXSAI_OR16(a, b)         _mm_or_si128(a, b)
+#define TWOXSAI_OR32(a, b)         _mm_or_si128(a, b)
+#define TWOXSAI_BIC16(a, b)        _mm_andnot_si128(b, a)
+#define TWOXSAI_BIC32(a, b)        _mm_andnot_si128(b, a)
+#define TWOXSAI_SEL16(m, a, b)     _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b))
+#define TWOXSAI_SEL32(m, a, b)     _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b))
+#define TWOXSAI_ADD16(a, b)        _mm_add_epi16(a, b)
+#define TWOXSAI_ADD32(a, b)        _mm_add_epi32(a, b)
+#define TWOXSAI_SUB16(a, b)        _mm_sub_epi16(a, b)
+#define TWOXSAI_SUB32(a, b)        _mm_sub_epi32(a, b)
+#define TWOXSAI_SHR16(a, n)        _mm_srli_epi16(a, n)
+#define TWOXSAI_SHR32(a, n)        _mm_srli_epi32(a, n)
+#define TWOXSAI_GTZ16(a)           _mm_cmpgt_epi16(a, _mm_setzero_si128())
+#define TWOXSAI_GTZ32(a)           _mm_cmpgt_epi32(a, _mm_setzero_si128())
+#define TWOXSAI_LTZ16(a)           _mm_cmplt_epi16(a, _mm_setzero_si128())
+#define TWOXSAI_LTZ32(a)           _mm_cmplt_epi32(a, _mm_setzero_si128())
+#define TWOXSAI_STORE2_16(p, a, b) \
+   _mm_storeu_si128((__m128i*)(p), _mm_unpacklo_epi16(a, b)); \
+   _mm_storeu_si128((__m128i*)(p) + 1, _mm_unpackhi_epi16(a, b))
+#define TWOXSAI_STORE2_32(p, a, b) \
+   _mm_storeu_si128((__m128i*)(p), _mm_unpacklo_epi32(a, b)); \
+   _mm_storeu_si128((__m128i*)(p) + 1, _mm_unpackhi_epi32(a, b))
+#elif defined(TWOXSAI_NEON)
+#define TWOXSAI_VEC16              uint16x8_t
+#define TWOXSAI_VEC32              uint32x4_t
+#define TWOXSAI_LOAD16(p)          vld1q_u16(p)
+#define TWOXSAI_LOAD32(p)          vld1q_u32(p)
+#define TWOXSAI_DUP16(x)           vdupq_n_u16(x)
+#define TWOXSAI_DUP32(x)           vdupq_n_u32(x)
+#define TWOXSAI_EQ16(a, b)         vceqq_u16(a, b)
+#define TWOXSAI_EQ32(a, b)         vceqq_u32(a, b)
+#define TWOXSAI_AND16(a, b)        vandq_u16(a, b)
+#define TWOXSAI_AND32(a, b)        vandq_u32(a, b)
+#define TWOXSAI_OR16(a, b)         vorrq_u16(a, b)
+#define TWOXSAI_OR32(a, b)         vorrq_u32(a, b)
+#define TWOXSAI_BIC16(a, b)        vbicq_u16(a, b)
+#define TWOXSAI_BIC32(a, b)        vbicq_u32(a, b)
+#define TWOXSAI_SEL16(m, a, b)     vbslq_u16(m, a, b)
+#define TWOXSAI_SEL32(m, a, b)     vbslq_u32(m, a, b)
+#define TWOXSAI_ADD16(a, b)        vaddq_u16(a, b)
+#define TWOXSAI_ADD32(a, b)        vaddq_u32(a, b)
+#define TWOXSAI_SUB16(a, b)        vsubq_u16(a, b)
+#define TWOXSAI_SUB32(a, b)        vsubq_u32(a, b)
+#define TWOXSAI_SHR16(a, n)        vshrq_n_u16(a, n)
+#define TWOXSAI_SHR32(a, n)        vshrq_n_u32(a, n)
+#define TWOXSAI_GTZ16(a)           vcgtq_s16(vreinterpretq_s16_u16(a), vdupq_n_s16(0))
+#define TWOXSAI_GTZ32(a)           vcgtq_s32(vreinterpretq_s32_u32(a), vdupq_n_s32(0))
+#define TWOXSAI_LTZ16(a)           vcltq_s16(vreinterpretq_s16_u16(a), vdupq_n_s16(0))
+#define TWOXSAI_LTZ32(a)           vcltq_s32(vreinterpretq_s32_u32(a), vdupq_n_s32(0))
+#define TWOXSAI_STORE2_16(p, a, b) \
+   { \
+      uint16x8x2_t pair_; \
+      pair_.val[0] = a; \
+      pair_.val[1] = b; \
+      vst2q_u16(p, pair_); \
+   }
+#define TWOXSAI_STORE2_32(p, a, b) \
+   { \
+      uint32x4x2_t pair_; \
+      pair_.val[0] = a; \
+      pair_.val[1] = b; \
+      vst2q_u32(p, pair_); \
+   }
+#endif
+
+#if defined(TWOXSAI_SSE2) || defined(TWOXSAI_NEON)
+#define TWOXSAI_VINTERP(w, A, B) \
+   TWOXSAI_ADD##w(TWOXSAI_ADD##w( \
+         TWOXSAI_SHR##w(TWOXSAI_AND##w(A, mask1), 1), \
+         TWOXSAI_SHR##w(TWOXSAI_AND##w(B, mask1), 1)), \
+         TWOXSAI_AND##w(TWOXSAI_AND##w(A, B), low1))
+
+#define TWOXSAI_VINTERP2(w, A, B, C, D) \
+   TWOXSAI_ADD##w(TWOXSAI_ADD##w( \
+         TWOXSAI_ADD##w(TWOXSAI_SHR##w(TWOXSAI_AND##w(A, mask2), 2), \
+            TWOXSAI_SHR##w(TWOXSAI_AND##w(B, mask2), 2)), \
+         TWOXSAI_ADD##w(TWOXSAI_SHR##w(TWOXSAI_AND##w(C, mask2), 2), \
+            TWOXSAI_SHR##w(TWOXSAI_AND##w(D, mask2), 2))), \
+         TWOXSAI_AND##w(TWOXSAI_SHR##w(TWOXSAI_ADD##w( \
+            TWOXSAI_ADD##w(TWOXSAI_AND##w(A, low2), TWOXSAI_AND##w(B, low2)), \
+            TWOXSAI_ADD##w(TWOXSAI_AND##w(C, low2), TWOXSAI_AND##w(D, low2))), 2), low2))
+
+/* All-ones in the lanes where A matches both C and D. As masks
+ * are -1, twoxsai_result(A, B, C, D) is
+ * VRESULT(A, C, D) - VRESULT(B, C, D). */
+#define TWOXSAI_VRESULT(w, A, C, D) \
+   TWOXSAI_AND##w(TWOXSAI_EQ##w(A, C), TWOXSAI_EQ##w(A, D))
+
+/* twoxsai_function on a whole vector of pixels: every branch
+ * is worked out for all lanes and the results are picked with
+ * the compare masks. Handles whole vectors out of @width and
+ * returns how many pixels were done. */
+#define TWOXSAI_ROW_SIMD(name, typename_t, vec_t, w, step, m1, l1, m2, l2) \
+static unsigned name(const typename_t *in, unsigned width, \
+      unsigned nextline, typename_t *out, unsigned dst_stride) \
+{ \
+   unsigned x; \
+   const vec_t mask1 = TWOXSAI_DUP##w(m1); \
+   const vec_t low1  = TWOXSAI_DUP##w(l1); \
+   const vec_t mask2 = TWOXSAI_DUP##w(m2); \
+   const vec_t low2  = TWOXSAI_DUP##w(l2); \
+   \
+   for (x = 0; x + step <= width; x += step) \
+   { \
+      const typename_t *p = in + x; \
+      vec_t colorI = TWOXSAI_LOAD##w(p - nextline - 1); \
+      vec_t colorE = TWOXSAI_LOAD##w(p - nextline + 0); \
+      vec_t colorF = TWOXSAI_LOAD##w(p - nextline + 1); \
+      vec_t colorJ = TWOXSAI_LOAD##w(p - nextline + 2); \
+      vec_t colorG = TWOXSAI_LOAD##w(p - 1); \
+      vec_t colorA = TWOXSAI_LOAD##w(p + 0); \
+      vec_t colorB = TWOXSAI_LOAD##w(p + 1); \
+      vec_t colorK = TWOXSAI_LOAD##w(p + 2); \
+      vec_t colorH = TWOXSAI_LOAD##w(p + nextline - 1); \
+      vec_t colorC = TWOXSAI_LOAD##w(p + nextline + 0); \
+      vec_t colorD = TWOXSAI_LOAD##w(p + nextline + 1); \
+      vec_t colorL = TWOXSAI_LOAD##w(p + nextline + 2); \
+      vec_t colorM = TWOXSAI_LOAD##w(p + nextline + nextline - 1); \
+      vec_t colorN = TWOXSAI_LOAD##w(p + nextline + nextline + 0); \
+      vec_t colorO = TWOXSAI_LOAD##w(p + nextline + nextline + 1); \
+      vec_t eqAD   = TWOXSAI_EQ##w(colorA, colorD); \
+      vec_t eqBC   = TWOXSAI_EQ##w(colorB, colorC); \
+      /* The four branches of twoxsai_function */ \
+      vec_t br1    = TWOXSAI_BIC##w(eqAD, eqBC); \
+      vec_t br2    = TWOXSAI_BIC##w(eqBC, eqAD); \
+      vec_t br3    = TWOXSAI_AND##w(eqAD, eqBC); \
+      vec_t br12   = TWOXSAI_OR##w(eqAD, eqBC); \
+      vec_t pa     = TWOXSAI_AND##w( \
+            TWOXSAI_AND##w(TWOXSAI_EQ##w(colorA, colorC), TWOXSAI_EQ##w(colorA, colorF)), \
+            TWOXSAI_BIC##w(TWOXSAI_EQ##w(colorB, colorJ), TWOXSAI_EQ##w(colorB, colorE))); \
+      vec_t pb     = TWOXSAI_AND##w( \
+            TWOXSAI_AND##w(TWOXSAI_EQ##w(colorB, colorE), TWOXSAI_EQ##w(colorB, colorD)), \
+            TWOXSAI_BIC##w(TWOXSAI_EQ##w(colorA, colorI), TWOXSAI_EQ##w(colorA, colorF))); \
+      vec_t qa     = TWOXSAI_AND##w( \
+            TWOXSAI_AND##w(TWOXSAI_EQ##w(colorA, colorB), TWOXSAI_EQ##w(colorA, colorH)), \
+            TWOXSAI_BIC##w(TWOXSAI_EQ##w(colorC, colorM), TWOXSAI_EQ##w(colorG, colorC))); \
+      vec_t qc     = TWOXSAI_AND##w( \
+            TWOXSAI_AND##w(TWOXSAI_EQ##w(colorC, colorG), TWOXSAI_EQ##w(colorC, colorD)), \
+            TWOXSAI_BIC##w(TWOXSAI_EQ##w(colorA, colorI), TWOXSAI_EQ##w(colorA, colorH))); \
+      vec_t selA   = TWOXSAI_OR##w(TWOXSAI_AND##w(br1, TWOXSAI_OR##w(TWOXSAI_AND##w( \
+                  TWOXSAI_EQ##w(colorA, colorE), TWOXSAI_EQ##w(colorB, colorL)), pa)), \
+            TWOXSAI_BIC##w(pa, br12)); \
+      vec_t selB   = TWOXSAI_OR##w(TWOXSAI_AND##w(br2, TWOXSAI_OR##w(TWOXSAI_AND##w( \
+                  TWOXSAI_EQ##w(colorB, colorF), TWOXSAI_EQ##w(colorA, colorH)), pb)), \
+            TWOXSAI_BIC##w(pb, TWOXSAI_OR##w(br12, pa))); \
+      vec_t selA1  = TWOXSAI_OR##w(TWOXSAI_AND##w(br1, TWOXSAI_OR##w(TWOXSAI_AND##w( \
+                  TWOXSAI_EQ##w(colorA, colorG), TWOXSAI_EQ##w(colorC, colorO)), qa)), \
+            TWOXSAI_BIC##w(qa, br12)); \
+      vec_t selC1  = TWOXSAI_OR##w(TWOXSAI_AND##w(br2, TWOXSAI_OR##w(TWOXSAI_AND##w( \
+                  TWOXSAI_EQ##w(colorC, colorH), TWOXSAI_EQ##w(colorA, colorF)), qc)), \
+            TWOXSAI_BIC##w(qc, TWOXSAI_OR##w(br12, qa))); \
+      vec_t r      = TWOXSAI_SUB##w(TWOXSAI_ADD##w( \
+               TWOXSAI_ADD##w(TWOXSAI_VRESULT(w, colorA, colorG, colorE), \
+                  TWOXSAI_VRESULT(w, colorB, colorK, colorF)), \
+               TWOXSAI_ADD##w(TWOXSAI_VRESULT(w, colorB, colorH, colorN), \
+                  TWOXSAI_VRESULT(w, colorA, colorL, colorO))), \
+            TWOXSAI_ADD##w( \
+               TWOXSAI_ADD##w(TWOXSAI_VRESULT(w, colorB, colorG, colorE), \
+                  TWOXSAI_VRESULT(w, colorA, colorK, colorF)), \
+               TWOXSAI_ADD##w(TWOXSAI_VRESULT(w, colorA, colorH, colorN), \
+                  TWOXSAI_VRESULT(w, colorB, colorL, colorO)))); \
+      vec_t product  = TWOXSAI_SEL##w(selA, colorA, TWOXSAI_SEL##w(selB, colorB, \
+               TWOXSAI_VINTERP(w, colorA, colorB))); \
+      vec_t product1 = TWOXSAI_SEL##w(selA1, colorA, TWOXSAI_SEL##w(selC1, colorC, \
+               TWOXSAI_VINTERP(w, colorA, colorC))); \
+      vec_t product2 = TWOXSAI_SEL##w(br1, colorA, TWOXSAI_SEL##w(br2, colorB, \
+               TWOXSAI_SEL##w(TWOXSAI_AND##w(br3, TWOXSAI_GTZ##w(r)), colorA, \
+               TWOXSAI_SEL##w(TWOXSAI_AND##w(br3, TWOXSAI_LTZ##w(r)), colorB, \
+               TWOXSAI_VINTERP2(w, colorA, colorB, colorC, colorD))))); \
+      \
+      TWOXSAI_STORE2_##w(out + (x << 1), colorA, product); \
+      TWOXSAI_STORE2_##w(out + dst_stride + (x << 1), product1, product2); \
+   } \
+   return x; \
+}
+
+TWOXSAI_ROW_SIMD(twoxsai_row_simd_rgb565, uint16_t,
+      TWOXSAI_VEC16, 16, 8, 0xF7DE, 0x0821, 0xE79C, 0x1863)
+TWOXSAI_ROW_SIMD(twoxsai_row_simd_xrgb8888, uint32_t,
+      TWOXSAI_VEC32, 32, 4, 0xFEFEFEFE, 0x01010101, 0xFCFCFCFC, 0x03030303)
+#else
+#define twoxsai_row_simd_rgb565(in, width, nextline, out, dst_stride) 0
+#define twoxsai_row_simd_xrgb8888(in, width, nextline, out, dst_stride) 0
+#endif
+
 static void twoxsai_generic_xrgb8888(unsigned width, unsigned height,
-      int first, int last, uint32_t *src,
+      int first, int last, int simd, uint32_t *src,
       unsigned src_stride, uint32_t *dst, unsigned dst_stride)
 {
    unsigned finish;
@@ -236,7 +446,17 @@ static void twoxsai_generic_xrgb8888(unsigned width, unsigned height,
       uint32_t *in  = (uint32_t*)src;
       uint32_t *out = (uint32_t*)dst;
 
-      for (finish = width; finish; finish -= 1)
+      finish = width;
+      if (simd)
+      {
+         unsigned done = twoxsai_row_simd_xrgb8888(in, width,
+               nextline, out, dst_stride);
+         in     += done;
+         out    += done << 1;
+         finish -= done;
+      }
+
+      for (; finish; finish -= 1)
       {
          twoxsai_declare_variables(uint32_t, in, nextline);
 
@@ -257,7 +477,7 @@ static void twoxsai_generic_xrgb8888(unsigned width, unsigned height,
 }
 
 static void twoxsai_generic_rgb565(unsigned width, unsigned height,
-      int first, int last, uint16_t *src,
+      int first, int last, int simd, uint16_t *src,
       unsigned src_stride, uint16_t *dst, unsigned dst_stride)
 {
    unsigned finish;
@@ -268,7 +488,17 @@ static void twoxsai_generic_rgb565(unsigned width, unsigned height,
       uint16_t *in  = (uint16_t*)src;
       uint16_t *out = (uint16_t*)dst;
 
-      for (finish = width; finish; finish -= 1)
+      finish = width;
+      if (simd)
+      {
+         unsigned done = twoxsai_row_simd_rgb565(in, width,
+               nextline, out, dst_stride);
+         in     += done;
+         out    += done << 1;
+         finish -= done;
+      }
+
+      for (; finish; finish -= 1)
       {
          twoxsai_declare_variables(uint16_t, in, nextline);
 
@@ -298,7 +528,7 @@ static void twoxsai_work_cb_rgb565(void *data, void *thread_data)
    unsigned height = thr->height;
 
    twoxsai_generic_rgb565(width, height,
-         thr->first, thr->last, input,
+         thr->first, thr->last, thr->simd & TWOXSAI_SIMD, input,
          (unsigned)(thr->in_pitch / SOFTFILTER_BPP_RGB565),
          output,
          (unsigned)(thr->out_pitch / SOFTFILTER_BPP_RGB565));
@@ -314,7 +544,7 @@ static void twoxsai_work_cb_xrgb8888(void *data, void *thread_data)
    unsigned height = thr->height;
 
    twoxsai_generic_xrgb8888(width, height,
-         thr->first, thr->last, input,
+         thr->first, thr->last, thr->simd & TWOXSAI_SIMD, input,
          (unsigned)(thr->in_pitch / SOFTFILTER_BPP_XRGB8888),
          output,
          (unsigned)(thr->out_pitch / SOFTFILTER_BPP_XRGB8888));
@@ -343,6 +573,7 @@ static void twoxsai_generic_packets(void *data,
       thr->in_pitch = input_stride;
       thr->width = width;
       thr->height = y_end - y_start;
+      thr->simd = filt->simd;
 
       /* Workers need to know if they can access pixels
        * outside their given buffer.
@@ -389,3 +620,7 @@ const struct softfilter_implementation *softfilter_get_implementation(
 #undef softfilter_thread_data
 #undef filter_data
 #endif
+
+#undef TWOXSAI_SSE2
+#undef TWOXSAI_NEON
+#undef TWOXSAI_SIMD
@@ -42,6 +42,7 @@ struct softfilter_thread_data
    unsigned height;
    int first;
    int last;
+   int burst;
 };
 
 struct filter_data
@@ -160,7 +161,7 @@ static void *blargg_ntsc_snes_generic_create(const struct softfilter_config *con
       return NULL;
    filt->workers = (struct softfilter_thread_data*)
       calloc(threads, sizeof(struct softfilter_thread_data));
-   filt->threads = 1;
+   filt->threads = threads;
    filt->in_fmt  = in_fmt;
    if (!filt->workers)
    {
@@ -196,26 +197,30 @@ static void blargg_ntsc_snes_generic_destroy(void *data)
 }
 
 static void blargg_ntsc_snes_render_rgb565(void *data, int width, int height,
-      int first, int last,
+      int first, int last, int burst,
       uint16_t *input, int pitch, uint16_t *output, int outpitch)
 {
    struct filter_data *filt = (struct filter_data*)data;
    if(width <= 256 || !hires_blit)
-      retroarch_snes_ntsc_blit(filt->ntsc, input, pitch, filt->burst,
+      retroarch_snes_ntsc_blit(filt->ntsc, input, pitch, burst,
             width, height, output, outpitch * 2, first, last);
    else
-      retroarch_snes_ntsc_blit_hires(filt->ntsc, input, pitch, filt->burst,
+      retroarch_snes_ntsc_blit_hires(filt->ntsc, input, pitch, burst,
             width, height, output, outpitch * 2, first, last);
 
-   filt->burst ^= filt->burst_toggle;
+   /* Every band took its phase from filt->burst when the
+    * packets were made, so the band holding the bottom of
+    * the frame can toggle it for the next one. */
+   if (last)
+      filt->burst ^= filt->burst_toggle;
 }
 
 static void blargg_ntsc_snes_rgb565(void *data, unsigned width, unsigned height,
-      int first, int last, uint16_t *src,
+      int first, int last, int burst, uint16_t *src,
       unsigned src_stride, uint16_t *dst, unsigned dst_stride)
 {
    blargg_ntsc_snes_render_rgb565(data, width, height,
-         first, last,
+         first, last, burst,
          src, src_stride,
          dst, dst_stride);
 
@@ -231,7 +236,7 @@ static void blargg_ntsc_snes_work_cb_rgb565(void *data, void *thread_data)
    unsigned height = thr->height;
 
    blargg_ntsc_snes_rgb565(data, width, height,
-         thr->first, thr->last, input,
+         thr->first, thr->last, thr->burst, input,
          (unsigned)(thr->in_pitch / SOFTFILTER_BPP_RGB565),
          output,
          (unsigned)(thr->out_pitch / SOFTFILTER_BPP_RGB565));
@@ -263,6 +268,11 @@ static void blargg_ntsc_snes_generic_packets(void *data,
       thr->first = y_start;
       thr->last = y_end == height;
 
+      /* Rows only share the burst phase, which steps
+       * once per row, so each band can start from its
+       * own first row. */
+      thr->burst = (filt->burst + y_start) % snes_ntsc_burst_count;
+
       if (filt->in_fmt == SOFTFILTER_FMT_RGB565)
          packets[i].work = blargg_ntsc_snes_work_cb_rgb565;
       packets[i].thread_data = thr;
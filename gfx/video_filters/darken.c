@@ -19,6 +19,14 @@
 #include "softfilter.h"
 #include <stdlib.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define DARKEN_SSE2
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !defined(DONT_WANT_ARM_OPTIMIZATIONS)
+#include <arm_neon.h>
+#define DARKEN_NEON
+#endif
+
 #ifdef RARCH_INTERNAL
 #define softfilter_get_implementation darken_get_implementation
 #define softfilter_thread_data darken_softfilter_thread_data
@@ -36,6 +44,7 @@ struct softfilter_thread_data
    unsigned height;
    int first;
    int last;
+   softfilter_simd_mask_t simd;
 };
 
 struct filter_data
@@ -43,6 +52,7 @@ struct filter_data
    unsigned threads;
    struct softfilter_thread_data *workers;
    unsigned in_fmt;
+   softfilter_simd_mask_t simd;
 };
 
 static unsigned darken_input_fmts(void)
@@ -67,7 +77,6 @@ static void *darken_create(const struct softfilter_config *config,
       unsigned threads, softfilter_simd_mask_t simd, void *userdata)
 {
    struct filter_data *filt = (struct filter_data*)calloc(1, sizeof(*filt));
-   (void)simd;
    (void)config;
    (void)userdata;
    if (!filt)
@@ -76,6 +85,7 @@ static void *darken_create(const struct softfilter_config *config,
       calloc(threads, sizeof(struct softfilter_thread_data));
    filt->threads = threads;
    filt->in_fmt  = in_fmt;
+   filt->simd    = simd;
    if (!filt->workers)
    {
       free(filt);
@@ -114,8 +124,31 @@ static void darken_work_cb_xrgb8888(void *data, void *thread_data)
    unsigned x, y;
    for (y = 0; y < height;
          y++, input += thr->in_pitch >> 2, output += thr->out_pitch >> 2)
-      for (x = 0; x < width; x++)
+   {
+      x = 0;
+#if defined(DARKEN_SSE2)
+      if (thr->simd & SOFTFILTER_SIMD_SSE2)
+      {
+         const __m128i mask = _mm_set1_epi32(0x3f3f3f3f);
+         for (; x + 4 <= width; x += 4)
+         {
+            __m128i in = _mm_loadu_si128((const __m128i*)(input + x));
+            _mm_storeu_si128((__m128i*)(output + x),
+                  _mm_and_si128(_mm_srli_epi32(in, 2), mask));
+         }
+      }
+#elif defined(DARKEN_NEON)
+      if (thr->simd & SOFTFILTER_SIMD_NEON)
+      {
+         const uint32x4_t mask = vdupq_n_u32(0x3f3f3f3f);
+         for (; x + 4 <= width; x += 4)
+            vst1q_u32(output + x,
+                  vandq_u32(vshrq_n_u32(vld1q_u32(input + x), 2), mask));
+      }
+#endif
+      for (; x < width; x++)
          output[x] = (input[x] >> 2) & (0x3f * 0x01010101);
+   }
 }
 
 static void darken_work_cb_rgb565(void *data, void *thread_data)
@@ -130,8 +163,33 @@ static void darken_work_cb_rgb565(void *data, void *thread_data)
    unsigned x, y;
    for (y = 0; y < height;
          y++, input += thr->in_pitch >> 1, output += thr->out_pitch >> 1)
-      for (x = 0; x < width; x++)
+   {
+      x = 0;
+#if defined(DARKEN_SSE2)
+      if (thr->simd & SOFTFILTER_SIMD_SSE2)
+      {
+         const __m128i mask = _mm_set1_epi16(
+               (0x7 << 0) | (0xf << 5) | (0x7 << 11));
+         for (; x + 8 <= width; x += 8)
+         {
+            __m128i in = _mm_loadu_si128((const __m128i*)(input + x));
+            _mm_storeu_si128((__m128i*)(output + x),
+                  _mm_and_si128(_mm_srli_epi16(in, 2), mask));
+         }
+      }
+#elif defined(DARKEN_NEON)
+      if (thr->simd & SOFTFILTER_SIMD_NEON)
+      {
+         const uint16x8_t mask = vdupq_n_u16(
+               (0x7 << 0) | (0xf << 5) | (0x7 << 11));
+         for (; x + 8 <= width; x += 8)
+            vst1q_u16(output + x,
+                  vandq_u16(vshrq_n_u16(vld1q_u16(input + x), 2), mask));
+      }
+#endif
+      for (; x < width; x++)
          output[x] = (input[x] >> 2) & ((0x7 << 0) | (0xf << 5) | (0x7 << 11));
+   }
 }
 
 static void darken_packets(void *data,
@@ -153,6 +211,7 @@ static void darken_packets(void *data,
       thr->in_pitch = input_stride;
       thr->width = width;
       thr->height = y_end - y_start;
+      thr->simd = filt->simd;
 
       if (filt->in_fmt == SOFTFILTER_FMT_XRGB8888)
          packets[i].work = darken_work_cb_xrgb8888;
@@ -189,3 +248,6 @@ const struct softfilter_implementation *softfilter_get_implementation(
 #undef softfilter_thread_data
 #undef filter_data
 #endif
+
+#undef DARKEN_SSE2
+#undef DARKEN_NEON
@@ -20,6 +20,18 @@
 
 #include <retro_endianness.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define EPX_SSE2
+#define EPX_SIMD SOFTFILTER_SIMD_SSE2
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !defined(DONT_WANT_ARM_OPTIMIZATIONS)
+#include <arm_neon.h>
+#define EPX_NEON
+#define EPX_SIMD SOFTFILTER_SIMD_NEON
+#else
+#define EPX_SIMD 0
+#endif
+
 #ifdef RARCH_INTERNAL
 #define softfilter_get_implementation epx_get_implementation
 #define softfilter_thread_data epx_softfilter_thread_data
@@ -39,6 +51,7 @@ struct softfilter_thread_data
    unsigned height;
    int first;
    int last;
+   softfilter_simd_mask_t simd;
 };
 
 struct filter_data
@@ -46,6 +59,7 @@ struct filter_data
    unsigned threads;
    struct softfilter_thread_data *workers;
    unsigned in_fmt;
+   softfilter_simd_mask_t simd;
 };
 
 static unsigned epx_generic_input_fmts(void)
@@ -70,15 +84,15 @@ static void *epx_generic_create(const struct softfilter_config *config,
       unsigned threads, softfilter_simd_mask_t simd, void *userdata)
 {
    struct filter_data *filt = (struct filter_data*)calloc(1, sizeof(*filt));
-   (void)simd;
    (void)config;
    (void)userdata;
    if (!filt)
       return NULL;
    filt->workers = (struct softfilter_thread_data*)
       calloc(threads, sizeof(struct softfilter_thread_data));
-   filt->threads = 1;
+   filt->threads = threads;
    filt->in_fmt  = in_fmt;
+   filt->simd    = simd;
    if (!filt->workers)
    {
       free(filt);
@@ -106,8 +120,66 @@ static void epx_generic_destroy(void *data)
    free(filt);
 }
 
+#if defined(EPX_SSE2) || defined(EPX_NEON)
+/* Vector version of the inner loop of epx_generic_rgb565.
+ * @src points at the first 'X' pixel of the run, @up and @low
+ * at the pixels above and below it. Handles whole blocks of
+ * 8 pixels out of @count and returns how many were done. */
+static int epx_row_simd_rgb565(const uint16_t *src,
+      const uint16_t *up, const uint16_t *low,
+      uint16_t *out1, uint16_t *out2, int count)
+{
+   int x;
+
+   for (x = 0; x + 8 <= count; x += 8)
+   {
+#if defined(EPX_SSE2)
+      __m128i A    = _mm_loadu_si128((const __m128i*)(src + x - 1));
+      __m128i X    = _mm_loadu_si128((const __m128i*)(src + x));
+      __m128i C    = _mm_loadu_si128((const __m128i*)(src + x + 1));
+      __m128i B    = _mm_loadu_si128((const __m128i*)(low + x));
+      __m128i D    = _mm_loadu_si128((const __m128i*)(up + x));
+      /* Lanes where (A == C || B == D) just repeat X */
+      __m128i keep = _mm_or_si128(
+            _mm_cmpeq_epi16(A, C), _mm_cmpeq_epi16(B, D));
+      __m128i m00  = _mm_andnot_si128(keep, _mm_cmpeq_epi16(D, A));
+      __m128i m01  = _mm_andnot_si128(keep, _mm_cmpeq_epi16(C, D));
+      __m128i m10  = _mm_andnot_si128(keep, _mm_cmpeq_epi16(A, B));
+      __m128i m11  = _mm_andnot_si128(keep, _mm_cmpeq_epi16(B, C));
+      __m128i e00  = _mm_or_si128(_mm_and_si128(m00, D), _mm_andnot_si128(m00, X));
+      __m128i e01  = _mm_or_si128(_mm_and_si128(m01, C), _mm_andnot_si128(m01, X));
+      __m128i e10  = _mm_or_si128(_mm_and_si128(m10, A), _mm_andnot_si128(m10, X));
+      __m128i e11  = _mm_or_si128(_mm_and_si128(m11, B), _mm_andnot_si128(m11, X));
+
+      _mm_storeu_si128((__m128i*)(out1 + (x << 1)),     _mm_unpacklo_epi16(e00, e01));
+      _mm_storeu_si128((__m128i*)(out1 + (x << 1) + 8), _mm_unpackhi_epi16(e00, e01));
+      _mm_storeu_si128((__m128i*)(out2 + (x << 1)),     _mm_unpacklo_epi16(e10, e11));
+      _mm_storeu_si128((__m128i*)(out2 + (x << 1) + 8), _mm_unpackhi_epi16(e10, e11));
+#else
+      uint16x8_t A    = vld1q_u16(src + x - 1);
+      uint16x8_t X    = vld1q_u16(src + x);
+      uint16x8_t C    = vld1q_u16(src + x + 1);
+      uint16x8_t B    = vld1q_u16(low + x);
+      uint16x8_t D    = vld1q_u16(up + x);
+      /* Lanes where (A == C || B == D) just repeat X */
+      uint16x8_t keep = vorrq_u16(vceqq_u16(A, C), vceqq_u16(B, D));
+      uint16x8x2_t row;
+
+      row.val[0] = vbslq_u16(vbicq_u16(vceqq_u16(D, A), keep), D, X);
+      row.val[1] = vbslq_u16(vbicq_u16(vceqq_u16(C, D), keep), C, X);
+      vst2q_u16(out1 + (x << 1), row);
+      row.val[0] = vbslq_u16(vbicq_u16(vceqq_u16(A, B), keep), A, X);
+      row.val[1] = vbslq_u16(vbicq_u16(vceqq_u16(B, C), keep), B, X);
+      vst2q_u16(out2 + (x << 1), row);
+#endif
+   }
+
+   return x;
+}
+#endif
+
 static void epx_generic_rgb565 (unsigned width, unsigned height,
-      int first, int lsat, uint16_t *src,
+      int first, int lsat, int simd, uint16_t *src,
       unsigned src_stride, uint16_t *dst, unsigned dst_stride)
 {
    uint16_t colorX, colorA, colorB, colorC, colorD;
@@ -146,7 +218,25 @@ static void epx_generic_rgb565 (unsigned width, unsigned height,
       dP1++;
       dP2++;
 
-      for (w = width - 2; w; w--)
+      w = width - 2;
+#if defined(EPX_SSE2) || defined(EPX_NEON)
+      if (simd)
+      {
+         int done = epx_row_simd_rgb565(sP, uP, lP,
+               (uint16_t*)dP1, (uint16_t*)dP2, w);
+
+         sP     += done;
+         uP     += done;
+         lP     += done;
+         dP1    += done;
+         dP2    += done;
+         w      -= done;
+         colorX  = *(sP - 1);
+         colorC  = *sP;
+      }
+#endif
+
+      for (; w; w--)
       {
          colorA = colorX;
          colorX = colorC;
@@ -206,7 +296,7 @@ static void epx_work_cb_rgb565(void *data, void *thread_data)
    unsigned height = thr->height;
 
    epx_generic_rgb565(width, height,
-         thr->first, thr->last, input,
+         thr->first, thr->last, thr->simd & EPX_SIMD, input,
          (unsigned)(thr->in_pitch / SOFTFILTER_BPP_RGB565),
          output,
          (unsigned)(thr->out_pitch / SOFTFILTER_BPP_RGB565));
@@ -233,6 +323,7 @@ static void epx_generic_packets(void *data,
       thr->in_pitch = input_stride;
       thr->width = width;
       thr->height = y_end - y_start;
+      thr->simd = filt->simd;
 
       /* Workers need to know if they can
        * access pixels outside their given buffer. */
@@ -272,3 +363,7 @@ const struct softfilter_implementation *softfilter_get_implementation(
 #undef softfilter_thread_data
 #undef filter_data
 #endif
+
+#undef EPX_SSE2
+#undef EPX_NEON
+#undef EPX_SIMD
@@ -157,10 +157,8 @@ static void *gameboy3x_generic_create(const struct softfilter_config *config,
    if (!filt)
       return NULL;
 
-   /* Apparently the code is not thread-safe,
-    * so force single threaded operation... */
-   filt->workers = (struct softfilter_thread_data*)calloc(1, sizeof(struct softfilter_thread_data));
-   filt->threads = 1;
+   filt->workers = (struct softfilter_thread_data*)calloc(threads, sizeof(struct softfilter_thread_data));
+   filt->threads = threads;
    filt->in_fmt  = in_fmt;
    if (!filt->workers)
    {
@@ -351,25 +349,31 @@ static void gameboy3x_generic_packets(void *data,
       void *output, size_t output_stride,
       const void *input, unsigned width, unsigned height, size_t input_stride)
 {
-   /* We are guaranteed single threaded operation
-    * (filt->threads = 1) so we don't need to loop
-    * over threads and can cull some code */
+   /* Output rows only depend on their own input row,
+    * so the frame is simply cut into bands */
+   unsigned i;
    struct filter_data *filt = (struct filter_data*)data;
-   struct softfilter_thread_data *thr = (struct softfilter_thread_data*)&filt->workers[0];
 
-   thr->out_data = (uint8_t*)output;
-   thr->in_data = (const uint8_t*)input;
-   thr->out_pitch = output_stride;
-   thr->in_pitch = input_stride;
-   thr->width = width;
-   thr->height = height;
-
-   if (filt->in_fmt == SOFTFILTER_FMT_RGB565)
-      packets[0].work = gameboy3x_work_cb_rgb565;
-   else if (filt->in_fmt == SOFTFILTER_FMT_XRGB8888)
-      packets[0].work = gameboy3x_work_cb_xrgb8888;
-
-   packets[0].thread_data = thr;
+   for (i = 0; i < filt->threads; i++)
+   {
+      struct softfilter_thread_data *thr =
+         (struct softfilter_thread_data*)&filt->workers[i];
+      unsigned y_start = (height * i) / filt->threads;
+      unsigned y_end   = (height * (i + 1)) / filt->threads;
+
+      thr->out_data  = (uint8_t*)output + y_start * 3 * output_stride;
+      thr->in_data   = (const uint8_t*)input + y_start * input_stride;
+      thr->out_pitch = output_stride;
+      thr->in_pitch  = input_stride;
+      thr->width     = width;
+      thr->height    = y_end - y_start;
+
+      if (filt->in_fmt == SOFTFILTER_FMT_RGB565)
+         packets[i].work = gameboy3x_work_cb_rgb565;
+      else if (filt->in_fmt == SOFTFILTER_FMT_XRGB8888)
+         packets[i].work = gameboy3x_work_cb_xrgb8888;
+      packets[i].thread_data = thr;
+   }
 }
 
 static const struct softfilter_implementation gameboy3x_generic = {
@@ -17,6 +17,18 @@
 #include "softfilter.h"
 #include <stdlib.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define LQ2X_SSE2
+#define LQ2X_SIMD SOFTFILTER_SIMD_SSE2
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !defined(DONT_WANT_ARM_OPTIMIZATIONS)
+#include <arm_neon.h>
+#define LQ2X_NEON
+#define LQ2X_SIMD SOFTFILTER_SIMD_NEON
+#else
+#define LQ2X_SIMD 0
+#endif
+
 #ifdef RARCH_INTERNAL
 #define softfilter_get_implementation lq2x_get_implementation
 #define softfilter_thread_data lq2x_softfilter_thread_data
@@ -36,6 +48,7 @@ struct softfilter_thread_data
    unsigned height;
    int first;
    int last;
+   softfilter_simd_mask_t simd;
 };
 
 struct filter_data
@@ -43,6 +56,7 @@ struct filter_data
    unsigned threads;
    struct softfilter_thread_data *workers;
    unsigned in_fmt;
+   softfilter_simd_mask_t simd;
 };
 
 static unsigned lq2x_generic_input_fmts(void)
@@ -67,7 +81,6 @@ static void *lq2x_generic_create(const struct softfilter_config *config,
       unsigned threads, softfilter_simd_mask_t simd, void *userdata)
 {
    struct filter_data *filt = (struct filter_data*)calloc(1, sizeof(*filt));
-   (void)simd;
    (void)config;
    (void)userdata;
    if (!filt)
@@ -76,6 +89,7 @@ static void *lq2x_generic_create(const struct softfilter_config *config,
       calloc(threads, sizeof(struct softfilter_thread_data));
    filt->threads = 1;
    filt->in_fmt  = in_fmt;
+   filt->simd    = simd;
    if (!filt->workers)
    {
       free(filt);
@@ -103,92 +117,191 @@ static void lq2x_generic_destroy(void *data)
    free(filt);
 }
 
+/* Blends C with A; @mask holds the low bits dropped
+ * before halving. */
+#define LQ2X_AVG(C, A, mask) (((C) + (A) - (((C) ^ (A)) & (mask))) >> 1)
+
+#define LQ2X_PIXEL(typename_t, x, mask) \
+   { \
+      const typename_t A = *(src + x - prevline); \
+      const typename_t B = (x > 0) ? src[x - 1] : src[x]; \
+      const typename_t C = src[x]; \
+      const typename_t D = (x < width - 1) ? src[x + 1] : src[x]; \
+      const typename_t E = *(src + x + nextline); \
+      \
+      if (A != E && B != D) \
+      { \
+         out0[(x << 1) + 0] = (A == B ? LQ2X_AVG(C, A, mask) : C); \
+         out0[(x << 1) + 1] = (A == D ? LQ2X_AVG(C, A, mask) : C); \
+         out1[(x << 1) + 0] = (E == B ? LQ2X_AVG(C, E, mask) : C); \
+         out1[(x << 1) + 1] = (E == D ? LQ2X_AVG(C, E, mask) : C); \
+      } \
+      else \
+      { \
+         out0[(x << 1) + 0] = C; \
+         out0[(x << 1) + 1] = C; \
+         out1[(x << 1) + 0] = C; \
+         out1[(x << 1) + 1] = C; \
+      } \
+   }
+
+/* The first pixel of a row is always done by LQ2X_PIXEL,
+ * as it has no left neighbour; @row_simd takes over from the
+ * second one and returns where the C loop has to carry on. */
+#define LQ2X_GENERIC(typename_t, mask, row_simd) \
+   for (y = 0; y < height; y++) \
+   { \
+      const int prevline = (y == 0 ? 0 : src_stride); \
+      const int nextline = (y == height - 1 || last) ? 0 : src_stride; \
+      \
+      x = 0; \
+      if (simd && width > 1) \
+      { \
+         LQ2X_PIXEL(typename_t, 0, mask); \
+         x = row_simd(src, width, prevline, nextline, out0, out1); \
+      } \
+      for (; x < width; x++) \
+         LQ2X_PIXEL(typename_t, x, mask); \
+      \
+      src  += src_stride; \
+      out0 += dst_stride << 1; \
+      out1 += dst_stride << 1; \
+   }
+
+#if defined(LQ2X_SSE2)
+/* Picks @a where @sel is set and @c elsewhere */
+#define LQ2X_SELECT(sel, a, c) \
+   _mm_or_si128(_mm_and_si128(sel, a), _mm_andnot_si128(sel, c))
+
+/* LQ2X_AVG for RGB565, where C + A is worked out in int and
+ * may carry out of the 16-bit lane: C + A - (C ^ A) & mask
+ * is 2 * (C & A) + (C ^ A) & ~mask, which halves without
+ * the carry. */
+#define LQ2X_AVG_SSE2_RGB565(C, A, mask) \
+   _mm_add_epi16(_mm_and_si128(C, A), \
+         _mm_srli_epi16(_mm_andnot_si128(mask, _mm_xor_si128(C, A)), 1))
+
+/* LQ2X_AVG for XRGB8888, which wraps in 32 bits just like
+ * the lanes do. */
+#define LQ2X_AVG_SSE2_XRGB8888(C, A, mask) \
+   _mm_srli_epi32(_mm_sub_epi32(_mm_add_epi32(C, A), \
+         _mm_and_si128(_mm_xor_si128(C, A), mask)), 1)
+
+#define LQ2X_ROW_SSE2(name, typename_t, step, m, set1, cmpeq, avg, unpacklo, unpackhi) \
+static unsigned name(const typename_t *src, unsigned width, \
+      int prevline, int nextline, typename_t *out0, typename_t *out1) \
+{ \
+   unsigned x; \
+   const __m128i mask = set1(m); \
+   for (x = 1; x + step < width; x += step) \
+   { \
+      __m128i A    = _mm_loadu_si128((const __m128i*)(src + x - prevline)); \
+      __m128i B    = _mm_loadu_si128((const __m128i*)(src + x - 1)); \
+      __m128i C    = _mm_loadu_si128((const __m128i*)(src + x)); \
+      __m128i D    = _mm_loadu_si128((const __m128i*)(src + x + 1)); \
+      __m128i E    = _mm_loadu_si128((const __m128i*)(src + x + nextline)); \
+      __m128i CA   = avg(C, A, mask); \
+      __m128i CE   = avg(C, E, mask); \
+      /* Lanes where (A == E || B == D) keep C everywhere */ \
+      __m128i keep = _mm_or_si128(cmpeq(A, E), cmpeq(B, D)); \
+      __m128i e00  = LQ2X_SELECT(_mm_andnot_si128(keep, cmpeq(A, B)), CA, C); \
+      __m128i e01  = LQ2X_SELECT(_mm_andnot_si128(keep, cmpeq(A, D)), CA, C); \
+      __m128i e10  = LQ2X_SELECT(_mm_andnot_si128(keep, cmpeq(E, B)), CE, C); \
+      __m128i e11  = LQ2X_SELECT(_mm_andnot_si128(keep, cmpeq(E, D)), CE, C); \
+      \
+      _mm_storeu_si128((__m128i*)(out0 + (x << 1)), unpacklo(e00, e01)); \
+      _mm_storeu_si128((__m128i*)(out0 + (x << 1) + step), unpackhi(e00, e01)); \
+      _mm_storeu_si128((__m128i*)(out1 + (x << 1)), unpacklo(e10, e11)); \
+      _mm_storeu_si128((__m128i*)(out1 + (x << 1) + step), unpackhi(e10, e11)); \
+   } \
+   return x; \
+}
+
+LQ2X_ROW_SSE2(lq2x_row_sse2_rgb565, uint16_t, 8, 0x0821, _mm_set1_epi16,
+      _mm_cmpeq_epi16, LQ2X_AVG_SSE2_RGB565,
+      _mm_unpacklo_epi16, _mm_unpackhi_epi16)
+LQ2X_ROW_SSE2(lq2x_row_sse2_xrgb8888, uint32_t, 4, 0x0421, _mm_set1_epi32,
+      _mm_cmpeq_epi32, LQ2X_AVG_SSE2_XRGB8888,
+      _mm_unpacklo_epi32, _mm_unpackhi_epi32)
+#elif defined(LQ2X_NEON)
+/* See LQ2X_AVG_SSE2_RGB565 */
+#define LQ2X_AVG_NEON_RGB565(C, A, mask) \
+   vaddq_u16(vandq_u16(C, A), \
+         vshrq_n_u16(vbicq_u16(veorq_u16(C, A), mask), 1))
+
+#define LQ2X_AVG_NEON_XRGB8888(C, A, mask) \
+   vshrq_n_u32(vsubq_u32(vaddq_u32(C, A), \
+         vandq_u32(veorq_u32(C, A), mask)), 1)
+
+#define LQ2X_ROW_NEON(name, typename_t, vec_t, pair_t, step, m, sfx, avg) \
+static unsigned name(const typename_t *src, unsigned width, \
+      int prevline, int nextline, typename_t *out0, typename_t *out1) \
+{ \
+   unsigned x; \
+   const vec_t mask = vdupq_n_##sfx(m); \
+   for (x = 1; x + step < width; x += step) \
+   { \
+      vec_t A    = vld1q_##sfx(src + x - prevline); \
+      vec_t B    = vld1q_##sfx(src + x - 1); \
+      vec_t C    = vld1q_##sfx(src + x); \
+      vec_t D    = vld1q_##sfx(src + x + 1); \
+      vec_t E    = vld1q_##sfx(src + x + nextline); \
+      vec_t CA   = avg(C, A, mask); \
+      vec_t CE   = avg(C, E, mask); \
+      /* Lanes where (A == E || B == D) keep C everywhere */ \
+      vec_t keep = vorrq_##sfx(vceqq_##sfx(A, E), vceqq_##sfx(B, D)); \
+      pair_t row; \
+      \
+      row.val[0] = vbslq_##sfx(vbicq_##sfx(vceqq_##sfx(A, B), keep), CA, C); \
+      row.val[1] = vbslq_##sfx(vbicq_##sfx(vceqq_##sfx(A, D), keep), CA, C); \
+      vst2q_##sfx(out0 + (x << 1), row); \
+      row.val[0] = vbslq_##sfx(vbicq_##sfx(vceqq_##sfx(E, B), keep), CE, C); \
+      row.val[1] = vbslq_##sfx(vbicq_##sfx(vceqq_##sfx(E, D), keep), CE, C); \
+      vst2q_##sfx(out1 + (x << 1), row); \
+   } \
+   return x; \
+}
+
+LQ2X_ROW_NEON(lq2x_row_neon_rgb565, uint16_t,
+      uint16x8_t, uint16x8x2_t, 8, 0x0821, u16, LQ2X_AVG_NEON_RGB565)
+LQ2X_ROW_NEON(lq2x_row_neon_xrgb8888, uint32_t,
+      uint32x4_t, uint32x4x2_t, 4, 0x0421, u32, LQ2X_AVG_NEON_XRGB8888)
+#else
+#define LQ2X_ROW_NONE(src, width, prevline, nextline, out0, out1) 1
+#endif
+
 static void lq2x_generic_rgb565(unsigned width, unsigned height,
-      int first, int last, uint16_t *src,
+      int first, int last, int simd, uint16_t *src,
       unsigned src_stride, uint16_t *dst, unsigned dst_stride)
 {
    unsigned x, y;
    uint16_t *out0 = (uint16_t*)dst;
    uint16_t *out1 = (uint16_t*)(dst + dst_stride);
 
-   for (y = 0; y < height; y++)
-   {
-      int prevline = (y == 0 ? 0 : src_stride);
-      int nextline = (y == height - 1 || last) ? 0 : src_stride;
-
-      for (x = 0; x < width; x++)
-      {
-         uint16_t A = *(src - prevline);
-         uint16_t B = (x > 0) ? *(src - 1) : *src;
-         uint16_t C = *src;
-         uint16_t D = (x < width - 1) ? *(src + 1) : *src;
-         uint16_t E = *(src++ + nextline);
-         uint16_t c = C;
-
-         if (A != E && B != D)
-         {
-            *out0++ = (A == B ? ((C + A - ((C ^ A) & 0x0821)) >> 1) : c);
-            *out0++ = (A == D ? ((C + A - ((C ^ A) & 0x0821)) >> 1) : c);
-            *out1++ = (E == B ? ((C + E - ((C ^ E) & 0x0821)) >> 1) : c);
-            *out1++ = (E == D ? ((C + E - ((C ^ E) & 0x0821)) >> 1) : c);
-         }
-         else
-         {
-            *out0++ = c;
-            *out0++ = c;
-            *out1++ = c;
-            *out1++ = c;
-         }
-      }
-
-      src  += src_stride - width;
-      out0 += dst_stride + dst_stride - (width << 1);
-      out1 += dst_stride + dst_stride - (width << 1);
-   }
+#if defined(LQ2X_SSE2)
+   LQ2X_GENERIC(uint16_t, 0x0821, lq2x_row_sse2_rgb565);
+#elif defined(LQ2X_NEON)
+   LQ2X_GENERIC(uint16_t, 0x0821, lq2x_row_neon_rgb565);
+#else
+   LQ2X_GENERIC(uint16_t, 0x0821, LQ2X_ROW_NONE);
+#endif
 }
 
 static void lq2x_generic_xrgb8888(unsigned width, unsigned height,
-      int first, int last, uint32_t *src,
+      int first, int last, int simd, uint32_t *src,
       unsigned src_stride, uint32_t *dst, unsigned dst_stride)
 {
    unsigned x, y;
    uint32_t *out0 = (uint32_t*)dst;
    uint32_t *out1 = (uint32_t*)(dst + dst_stride);
 
-   for (y = 0; y < height; y++)
-   {
-      int prevline = (y == 0 ? 0 : src_stride);
-      int nextline = (y == height - 1 || last) ? 0 : src_stride;
-
-      for (x = 0; x < width; x++)
-      {
-         uint32_t A = *(src - prevline);
-         uint32_t B = (x > 0) ? *(src - 1) : *src;
-         uint32_t C = *src;
-         uint32_t D = (x < width - 1) ? *(src + 1) : *src;
-         uint32_t E = *(src++ + nextline);
-         uint32_t c = C;
-
-         if (A != E && B != D)
-         {
-            *out0++ = (A == B ? (C + A - ((C ^ A) & 0x0421)) >> 1 : c);
-            *out0++ = (A == D ? (C + A - ((C ^ A) & 0x0421)) >> 1 : c);
-            *out1++ = (E == B ? (C + E - ((C ^ E) & 0x0421)) >> 1 : c);
-            *out1++ = (E == D ? (C + E - ((C ^ E) & 0x0421)) >> 1 : c);
-         }
-         else
-         {
-            *out0++ = c;
-            *out0++ = c;
-            *out1++ = c;
-            *out1++ = c;
-         }
-      }
-
-      src += src_stride - width;
-      out0 += dst_stride + dst_stride - (width << 1);
-      out1 += dst_stride + dst_stride - (width << 1);
-   }
+#if defined(LQ2X_SSE2)
+   LQ2X_GENERIC(uint32_t, 0x0421, lq2x_row_sse2_xrgb8888);
+#elif defined(LQ2X_NEON)
+   LQ2X_GENERIC(uint32_t, 0x0421, lq2x_row_neon_xrgb8888);
+#else
+   LQ2X_GENERIC(uint32_t, 0x0421, LQ2X_ROW_NONE);
+#endif
 }
 
 static void lq2x_work_cb_rgb565(void *data, void *thread_data)
@@ -201,7 +314,7 @@ static void lq2x_work_cb_rgb565(void *data, void *thread_data)
    unsigned height = thr->height;
 
    lq2x_generic_rgb565(width, height,
-         thr->first, thr->last, input,
+         thr->first, thr->last, thr->simd & LQ2X_SIMD, input,
          (unsigned)(thr->in_pitch / SOFTFILTER_BPP_RGB565),
          output,
          (unsigned)(thr->out_pitch / SOFTFILTER_BPP_RGB565));
@@ -219,7 +332,7 @@ static void lq2x_work_cb_xrgb8888(void *data, void *thread_data)
    (void)data;
 
    lq2x_generic_xrgb8888(width, height,
-         thr->first, thr->last, input,
+         thr->first, thr->last, thr->simd & LQ2X_SIMD, input,
          (unsigned)(thr->in_pitch / SOFTFILTER_BPP_XRGB8888),
          output,
          (unsigned)(thr->out_pitch / SOFTFILTER_BPP_XRGB8888));
@@ -246,6 +359,7 @@ static void lq2x_generic_packets(void *data,
       thr->in_pitch = input_stride;
       thr->width = width;
       thr->height = y_end - y_start;
+      thr->simd = filt->simd;
 
       /* Workers need to know if they can access pixels
        * outside their given buffer. */
@@ -291,3 +405,8 @@ const struct softfilter_implementation *softfilter_get_implementation(
 #undef softfilter_thread_data
 #undef filter_data
 #endif
+
+#undef LQ2X_SSE2
+#undef LQ2X_NEON
+#undef LQ2X_ROW_NONE
+#undef LQ2X_SIMD
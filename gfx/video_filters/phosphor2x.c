@@ -21,6 +21,18 @@
 #include <math.h>
 #include <retro_inline.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define PHOSPHOR2X_SSE2
+#define PHOSPHOR2X_SIMD SOFTFILTER_SIMD_SSE2
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !defined(DONT_WANT_ARM_OPTIMIZATIONS)
+#include <arm_neon.h>
+#define PHOSPHOR2X_NEON
+#define PHOSPHOR2X_SIMD SOFTFILTER_SIMD_NEON
+#else
+#define PHOSPHOR2X_SIMD 0
+#endif
+
 #ifdef RARCH_INTERNAL
 #define softfilter_get_implementation phosphor2x_get_implementation
 #define softfilter_thread_data phosphor2x_softfilter_thread_data
@@ -47,6 +59,7 @@ struct filter_data
    unsigned threads;
    struct softfilter_thread_data *workers;
    unsigned in_fmt;
+   softfilter_simd_mask_t simd;
    float phosphor_bleed;
    float scale_add;
    float scale_times;
@@ -56,6 +69,14 @@ struct filter_data
    float phosphor_bloom_565[64];
    float scan_range_8888[256];
    float scan_range_565[64];
+   /* The per-channel results of the float maths above, worked
+    * out once for every input they can be asked for. */
+   uint8_t bleed_8888[256];
+   uint8_t bleed_green_8888[256];
+   uint8_t bleed_565[64];
+   uint8_t bleed_green_565[64];
+   uint8_t scanline_8888[256][256];
+   uint8_t scanline_565[64][64];
 };
 
 #define clamp8(x) ((x) > 255 ? 255 : ((x < 0) ? 0 : (uint32_t)x))
@@ -102,17 +123,109 @@ static INLINE unsigned max_component_rgb565(uint32_t color)
    return max;
 }
 
-static void blit_linear_line_xrgb8888(uint32_t * out,
+/* Splats and blends whole vectors of pixels, leaving the rest
+ * of the line to the C loops. Returns how many input pixels
+ * were done. */
+#if defined(PHOSPHOR2X_SSE2)
+static unsigned blit_linear_line_simd_xrgb8888(uint32_t *out,
       const uint32_t *in, unsigned width)
 {
    unsigned i;
+   const __m128i mask = _mm_set1_epi32(0x7f7f7f7f);
+
+   for (i = 0; i + 4 < width; i += 4)
+   {
+      __m128i a = _mm_loadu_si128((const __m128i*)(in + i));
+      __m128i b = _mm_loadu_si128((const __m128i*)(in + i + 1));
+      __m128i m = _mm_add_epi32(
+            _mm_and_si128(_mm_srli_epi32(a, 1), mask),
+            _mm_and_si128(_mm_srli_epi32(b, 1), mask));
+
+      _mm_storeu_si128((__m128i*)(out + (i << 1)), _mm_unpacklo_epi32(a, m));
+      _mm_storeu_si128((__m128i*)(out + (i << 1)) + 1, _mm_unpackhi_epi32(a, m));
+   }
+   return i;
+}
+
+static unsigned blit_linear_line_simd_rgb565(uint16_t *out,
+      const uint16_t *in, unsigned width)
+{
+   unsigned i;
+   const __m128i mask = _mm_set1_epi16((short)0xF7DE);
+
+   for (i = 0; i + 8 < width; i += 8)
+   {
+      __m128i a = _mm_loadu_si128((const __m128i*)(in + i));
+      __m128i b = _mm_loadu_si128((const __m128i*)(in + i + 1));
+      __m128i m = _mm_add_epi16(
+            _mm_srli_epi16(_mm_and_si128(a, mask), 1),
+            _mm_srli_epi16(_mm_and_si128(b, mask), 1));
+
+      _mm_storeu_si128((__m128i*)(out + (i << 1)), _mm_unpacklo_epi16(a, m));
+      _mm_storeu_si128((__m128i*)(out + (i << 1)) + 1, _mm_unpackhi_epi16(a, m));
+   }
+   return i;
+}
+#elif defined(PHOSPHOR2X_NEON)
+static unsigned blit_linear_line_simd_xrgb8888(uint32_t *out,
+      const uint32_t *in, unsigned width)
+{
+   unsigned i;
+   const uint32x4_t mask = vdupq_n_u32(0x7f7f7f7f);
+
+   for (i = 0; i + 4 < width; i += 4)
+   {
+      uint32x4x2_t pair;
+      uint32x4_t b = vld1q_u32(in + i + 1);
+
+      pair.val[0]  = vld1q_u32(in + i);
+      pair.val[1]  = vaddq_u32(
+            vandq_u32(vshrq_n_u32(pair.val[0], 1), mask),
+            vandq_u32(vshrq_n_u32(b, 1), mask));
+      vst2q_u32(out + (i << 1), pair);
+   }
+   return i;
+}
+
+static unsigned blit_linear_line_simd_rgb565(uint16_t *out,
+      const uint16_t *in, unsigned width)
+{
+   unsigned i;
+   const uint16x8_t mask = vdupq_n_u16(0xF7DE);
+
+   for (i = 0; i + 8 < width; i += 8)
+   {
+      uint16x8x2_t pair;
+      uint16x8_t b = vld1q_u16(in + i + 1);
+
+      pair.val[0]  = vld1q_u16(in + i);
+      pair.val[1]  = vaddq_u16(
+            vshrq_n_u16(vandq_u16(pair.val[0], mask), 1),
+            vshrq_n_u16(vandq_u16(b, mask), 1));
+      vst2q_u16(out + (i << 1), pair);
+   }
+   return i;
+}
+#else
+#define blit_linear_line_simd_xrgb8888(out, in, width) 0
+#define blit_linear_line_simd_rgb565(out, in, width) 0
+#endif
+
+static void blit_linear_line_xrgb8888(uint32_t * out,
+      const uint32_t *in, unsigned width, int simd)
+{
+   unsigned i;
+   unsigned done = 0;
+
+   if (simd)
+      done = blit_linear_line_simd_xrgb8888(out, in, width);
 
    /* Splat pixels out on the line. */
-   for (i = 0; i < width; i++)
+   for (i = done; i < width; i++)
       out[i << 1] = in[i];
 
    /* Blend in-between pixels. */
-   for (i = 1; i < (width << 1) - 1; i += 2)
+   for (i = (done << 1) + 1; i < (width << 1) - 1; i += 2)
       out[i] = blend_pixels_xrgb8888(out[i - 1], out[i + 1]);
 
    /* Blend edge pixels against black. */
@@ -122,16 +235,20 @@ static void blit_linear_line_xrgb8888(uint32_t * out,
 }
 
 static void blit_linear_line_rgb565(uint16_t * out,
-      const uint16_t *in, unsigned width)
+      const uint16_t *in, unsigned width, int simd)
 {
    unsigned i;
+   unsigned done = 0;
+
+   if (simd)
+      done = blit_linear_line_simd_rgb565(out, in, width);
 
    /* Splat pixels out on the line. */
-   for (i = 0; i < width; i++)
+   for (i = done; i < width; i++)
       out[i << 1] = in[i];
 
    /* Blend in-between pixels. */
-   for (i = 1; i < (width << 1) - 1; i += 2)
+   for (i = (done << 1) + 1; i < (width << 1) - 1; i += 2)
       out[i] =
          blend_pixels_rgb565(out[i - 1], out[i + 1]);
 
@@ -145,70 +262,62 @@ static void bleed_phosphors_xrgb8888(void *data,
       uint32_t *scanline, unsigned width)
 {
    unsigned x;
+   unsigned b_set           = 0;
    struct filter_data *filt = (struct filter_data*)data;
 
-   /* Red phosphor */
+   /* One pass over pixel pairs: red bleeds from even pixels
+    * into the next one, blue from odd pixels into the next one,
+    * and green stays where it is. */
    for (x = 0; x < width; x += 2)
    {
-      unsigned r = red_xrgb8888(scanline[x]);
-      unsigned r_set = clamp8(r * filt->phosphor_bleed *
-            filt->phosphor_bloom_8888[r]);
-      set_red_xrgb8888(scanline[x + 1], r_set);
-   }
-
-   /* Green phosphor */
-   for (x = 0; x < width; x++)
-   {
-      unsigned g = green_xrgb8888(scanline[x]);
-      unsigned g_set = clamp8((g >> 1) + 0.5 * g *
-            filt->phosphor_bleed * filt->phosphor_bloom_8888[g]);
-      set_green_xrgb8888(scanline[x], g_set);
+      uint32_t even = scanline[x];
+      uint32_t odd  = scanline[x + 1];
+
+      set_red_xrgb8888(odd, filt->bleed_8888[red_xrgb8888(even)]);
+      set_green_xrgb8888(even,
+            filt->bleed_green_8888[green_xrgb8888(even)]);
+      set_green_xrgb8888(odd,
+            filt->bleed_green_8888[green_xrgb8888(odd)]);
+      set_blue_xrgb8888(even, b_set);
+      b_set = filt->bleed_8888[blue_xrgb8888(odd)];
+
+      scanline[x]     = even;
+      scanline[x + 1] = odd;
    }
 
-   /* Blue phosphor */
-   set_blue_xrgb8888(scanline[0], 0);
-   for (x = 1; x < width; x += 2)
-   {
-      unsigned b = blue_xrgb8888(scanline[x]);
-      unsigned b_set = clamp8(b * filt->phosphor_bleed *
-            filt->phosphor_bloom_8888[b]);
-      set_blue_xrgb8888(scanline[x + 1], b_set);
-   }
+   /* The last blue phosphor lands one past the line. */
+   set_blue_xrgb8888(scanline[width], b_set);
 }
 
 static void bleed_phosphors_rgb565(void *data,
       uint16_t *scanline, unsigned width)
 {
    unsigned x;
+   unsigned b_set           = 0;
    struct filter_data *filt = (struct filter_data*)data;
 
-   /* Red phosphor */
+   /* One pass over pixel pairs: red bleeds from even pixels
+    * into the next one, blue from odd pixels into the next one,
+    * and green stays where it is. */
    for (x = 0; x < width; x += 2)
    {
-      unsigned r = red_rgb565(scanline[x]);
-      unsigned r_set = clamp6(r * filt->phosphor_bleed *
-            filt->phosphor_bloom_565[r]);
-      set_red_rgb565(scanline[x + 1], r_set);
+      uint16_t even = scanline[x];
+      uint16_t odd  = scanline[x + 1];
+
+      set_red_rgb565(odd, filt->bleed_565[red_rgb565(even)]);
+      set_green_rgb565(even,
+            filt->bleed_green_565[green_rgb565(even)]);
+      set_green_rgb565(odd,
+            filt->bleed_green_565[green_rgb565(odd)]);
+      set_blue_rgb565(even, b_set);
+      b_set = filt->bleed_565[blue_rgb565(odd)];
+
+      scanline[x]     = even;
+      scanline[x + 1] = odd;
    }
 
-   /* Green phosphor */
-   for (x = 0; x < width; x++)
-   {
-      unsigned g = green_rgb565(scanline[x]);
-      unsigned g_set = clamp6((g >> 1) + 0.5 * g *
-            filt->phosphor_bleed * filt->phosphor_bloom_565[g]);
-      set_green_rgb565(scanline[x], g_set);
-   }
-
-   /* Blue phosphor */
-   set_blue_rgb565(scanline[0], 0);
-   for (x = 1; x < width; x += 2)
-   {
-      unsigned b = blue_rgb565(scanline[x]);
-      unsigned b_set = clamp6(b * filt->phosphor_bleed *
-            filt->phosphor_bloom_565[b]);
-      set_blue_rgb565(scanline[x + 1], b_set);
-   }
+   /* The last blue phosphor lands one past the line. */
+   set_blue_rgb565(scanline[width], b_set);
 }
 
 static unsigned phosphor2x_generic_input_fmts(void)
@@ -232,10 +341,9 @@ static void *phosphor2x_generic_create(const struct softfilter_config *config,
       unsigned max_width, unsigned max_height,
       unsigned threads, softfilter_simd_mask_t simd, void *userdata)
 {
-   unsigned i;
+   unsigned i, c;
    struct filter_data *filt = (struct filter_data*)calloc(1, sizeof(*filt));
 
-   (void)simd;
    (void)out_fmt;
    (void)max_width;
    (void)max_height;
@@ -246,8 +354,9 @@ static void *phosphor2x_generic_create(const struct softfilter_config *config,
       return NULL;
    filt->workers = (struct softfilter_thread_data*)
       calloc(threads, sizeof(struct softfilter_thread_data));
-   filt->threads = 1;
+   filt->threads = threads;
    filt->in_fmt  = in_fmt;
+   filt->simd    = simd;
    if (!filt->workers)
    {
       free(filt);
@@ -285,6 +394,29 @@ static void *phosphor2x_generic_create(const struct softfilter_config *config,
          (filt->scanrange_high - filt->scanrange_low) / 31.0f;
    }
 
+   /* Same expressions as the phosphor and scanline passes
+    * used to evaluate per pixel. */
+   for (i = 0; i < 256; i++)
+   {
+      filt->bleed_8888[i] = clamp8(i * filt->phosphor_bleed *
+            filt->phosphor_bloom_8888[i]);
+      filt->bleed_green_8888[i] = clamp8((i >> 1) + 0.5 * i *
+            filt->phosphor_bleed * filt->phosphor_bloom_8888[i]);
+      for (c = 0; c < 256; c++)
+         filt->scanline_8888[i][c] =
+            (uint32_t)(filt->scan_range_8888[i] * c);
+   }
+   for (i = 0; i < 64; i++)
+   {
+      filt->bleed_565[i] = clamp6(i * filt->phosphor_bleed *
+            filt->phosphor_bloom_565[i]);
+      filt->bleed_green_565[i] = clamp6((i >> 1) + 0.5 * i *
+            filt->phosphor_bleed * filt->phosphor_bloom_565[i]);
+      for (c = 0; c < 64; c++)
+         filt->scanline_565[i][c] =
+            (uint16_t)(filt->scan_range_565[i] * c);
+   }
+
    return filt;
 }
 
@@ -331,7 +463,8 @@ static void phosphor2x_generic_xrgb8888(void *data,
       uint32_t *out_line      = (uint32_t*)(dst + y * (dst_stride) * 2);
 
       /* Bilinear stretch horizontally. */
-      blit_linear_line_xrgb8888(out_line, in_line, width);
+      blit_linear_line_xrgb8888(out_line, in_line, width,
+            filt->simd & PHOSPHOR2X_SIMD);
 
       /* Mask 'n bleed phosphors */
       bleed_phosphors_xrgb8888(filt, out_line, width << 1);
@@ -342,16 +475,17 @@ static void phosphor2x_generic_xrgb8888(void *data,
 
       for (x = 0; x < (width << 1); x++)
       {
-         unsigned max = max_component_xrgb8888(out_line[x]);
-         set_red_xrgb8888(scan_out[x],
-               (uint32_t)(filt->scan_range_8888[max] *
-                  red_xrgb8888(out_line[x])));
-         set_green_xrgb8888(scan_out[x],
-               (uint32_t)(filt->scan_range_8888[max] *
-                  green_xrgb8888(out_line[x])));
-         set_blue_xrgb8888(scan_out[x],
-               (uint32_t)(filt->scan_range_8888[max] *
-                  blue_xrgb8888(out_line[x])));
+         /* The three channels make up the whole pixel. */
+         uint32_t pixel      = 0;
+         const uint8_t *scan = filt->scanline_8888[
+            max_component_xrgb8888(out_line[x])];
+         set_red_xrgb8888(pixel,
+               (uint32_t)scan[red_xrgb8888(out_line[x])]);
+         set_green_xrgb8888(pixel,
+               (uint32_t)scan[green_xrgb8888(out_line[x])]);
+         set_blue_xrgb8888(pixel,
+               (uint32_t)scan[blue_xrgb8888(out_line[x])]);
+         scan_out[x] = pixel;
       }
    }
 }
@@ -378,7 +512,8 @@ static void phosphor2x_generic_rgb565(void *data,
       const uint16_t *in_line = (const uint16_t*)(src + y * (src_stride));
 
       /* Bilinear stretch horizontally. */
-      blit_linear_line_rgb565(out_line, in_line, width);
+      blit_linear_line_rgb565(out_line, in_line, width,
+            filt->simd & PHOSPHOR2X_SIMD);
 
       /* Mask 'n bleed phosphors. */
       bleed_phosphors_rgb565(filt, out_line, width << 1);
@@ -388,16 +523,17 @@ static void phosphor2x_generic_rgb565(void *data,
 
       for (x = 0; x < (width << 1); x++)
       {
-         unsigned max = max_component_rgb565(out_line[x]);
-         set_red_rgb565(scan_out[x],
-               (uint16_t)(filt->scan_range_565[max] *
-                  red_rgb565(out_line[x])));
-         set_green_rgb565(scan_out[x],
-               (uint16_t)(filt->scan_range_565[max] *
-                  green_rgb565(out_line[x])));
-         set_blue_rgb565(scan_out[x],
-               (uint16_t)(filt->scan_range_565[max] *
-                  blue_rgb565(out_line[x])));
+         /* The three channels make up the whole pixel. */
+         uint16_t pixel      = 0;
+         const uint8_t *scan = filt->scanline_565[
+            max_component_rgb565(out_line[x])];
+         set_red_rgb565(pixel,
+               (uint16_t)scan[red_rgb565(out_line[x])]);
+         set_green_rgb565(pixel,
+               (uint16_t)scan[green_rgb565(out_line[x])]);
+         set_blue_rgb565(pixel,
+               (uint16_t)scan[blue_rgb565(out_line[x])]);
+         scan_out[x] = pixel;
       }
    }
 }
@@ -457,7 +593,7 @@ static void phosphor2x_generic_packets(void *data,
 
       /* Workers need to know if they can access pixels
        * outside their given buffer. */
-      thr->first = y_start;
+      thr->first = y_start == 0;
       thr->last = y_end == height;
 
       if (filt->in_fmt == SOFTFILTER_FMT_RGB565)
@@ -499,3 +635,7 @@ const struct softfilter_implementation *softfilter_get_implementation(
 #undef softfilter_thread_data
 #undef filter_data
 #endif
+
+#undef PHOSPHOR2X_SSE2
+#undef PHOSPHOR2X_NEON
+#undef PHOSPHOR2X_SIMD
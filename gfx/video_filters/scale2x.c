@@ -19,6 +19,18 @@
 #include "softfilter.h"
 #include <stdlib.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define SCALE2X_SSE2
+#define SCALE2X_SIMD SOFTFILTER_SIMD_SSE2
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !defined(DONT_WANT_ARM_OPTIMIZATIONS)
+#include <arm_neon.h>
+#define SCALE2X_NEON
+#define SCALE2X_SIMD SOFTFILTER_SIMD_NEON
+#else
+#define SCALE2X_SIMD 0
+#endif
+
 #ifdef RARCH_INTERNAL
 #define softfilter_get_implementation scale2x_get_implementation
 #define softfilter_thread_data scale2x_softfilter_thread_data
@@ -38,6 +50,7 @@ struct softfilter_thread_data
    unsigned height;
    int first;
    int last;
+   softfilter_simd_mask_t simd;
 };
 
 struct filter_data
@@ -45,58 +58,147 @@ struct filter_data
    unsigned threads;
    struct softfilter_thread_data *workers;
    unsigned in_fmt;
+   softfilter_simd_mask_t simd;
 };
 
-#define SCALE2X_GENERIC(typename_t, width, height, first, last, src, src_stride, dst, dst_stride, out0, out1) \
+#define SCALE2X_PIXEL(typename_t, x) \
+   { \
+      const typename_t A = *(src + x - prevline); \
+      const typename_t B = (x > 0) ? src[x - 1] : src[x]; \
+      const typename_t C = src[x]; \
+      const typename_t D = (x < width - 1) ? src[x + 1] : src[x]; \
+      const typename_t E = *(src + x + nextline); \
+      \
+      if (A != E && B != D) \
+      { \
+         out0[(x << 1) + 0] = (A == B ? A : C); \
+         out0[(x << 1) + 1] = (A == D ? A : C); \
+         out1[(x << 1) + 0] = (E == B ? E : C); \
+         out1[(x << 1) + 1] = (E == D ? E : C); \
+      } \
+      else \
+      { \
+         out0[(x << 1) + 0] = C; \
+         out0[(x << 1) + 1] = C; \
+         out1[(x << 1) + 0] = C; \
+         out1[(x << 1) + 1] = C; \
+      } \
+   }
+
+/* The first pixel of a row is always done by SCALE2X_PIXEL,
+ * as it has no left neighbour; @row_simd takes over from the
+ * second one and returns where the C loop has to carry on. */
+#define SCALE2X_GENERIC(typename_t, row_simd) \
    for (y = 0; y < height; ++y) \
    { \
       const int prevline = ((y == 0) && first) ? 0 : src_stride; \
       const int nextline = ((y == height - 1) && last) ? 0 : src_stride; \
       \
-      for (x = 0; x < width; ++x) \
+      x = 0; \
+      if (simd && width > 1) \
       { \
-         const typename_t A = *(src - prevline); \
-         const typename_t B = (x > 0) ? *(src - 1) : *src; \
-         const typename_t C = *src; \
-         const typename_t D = (x < width - 1) ? *(src + 1) : *src; \
-         const typename_t E = *(src++ + nextline); \
-         \
-         if (A != E && B != D) \
-         { \
-            *out0++ = (A == B ? A : C); \
-            *out0++ = (A == D ? A : C); \
-            *out1++ = (E == B ? E : C); \
-            *out1++ = (E == D ? E : C); \
-         } \
-         else \
-         { \
-            *out0++ = C; \
-            *out0++ = C; \
-            *out1++ = C; \
-            *out1++ = C; \
-         } \
+         SCALE2X_PIXEL(typename_t, 0); \
+         x = row_simd(src, width, prevline, nextline, out0, out1); \
       } \
+      for (; x < width; ++x) \
+         SCALE2X_PIXEL(typename_t, x); \
       \
-      src += src_stride - width; \
-      out0 += dst_stride + dst_stride - (width * SCALE2X_SCALE); \
-      out1 += dst_stride + dst_stride - (width * SCALE2X_SCALE); \
+      src  += src_stride; \
+      out0 += dst_stride << 1; \
+      out1 += dst_stride << 1; \
    }
 
+#if defined(SCALE2X_SSE2)
+/* Picks @a where @sel is set and @c elsewhere */
+#define SCALE2X_SELECT(sel, a, c) \
+   _mm_or_si128(_mm_and_si128(sel, a), _mm_andnot_si128(sel, c))
+
+#define SCALE2X_ROW_SSE2(name, typename_t, step, cmpeq, unpacklo, unpackhi) \
+static unsigned name(const typename_t *src, unsigned width, \
+      int prevline, int nextline, typename_t *out0, typename_t *out1) \
+{ \
+   unsigned x; \
+   for (x = 1; x + step < width; x += step) \
+   { \
+      __m128i A    = _mm_loadu_si128((const __m128i*)(src + x - prevline)); \
+      __m128i B    = _mm_loadu_si128((const __m128i*)(src + x - 1)); \
+      __m128i C    = _mm_loadu_si128((const __m128i*)(src + x)); \
+      __m128i D    = _mm_loadu_si128((const __m128i*)(src + x + 1)); \
+      __m128i E    = _mm_loadu_si128((const __m128i*)(src + x + nextline)); \
+      /* Lanes where (A == E || B == D) keep C everywhere */ \
+      __m128i keep = _mm_or_si128(cmpeq(A, E), cmpeq(B, D)); \
+      __m128i e00  = SCALE2X_SELECT(_mm_andnot_si128(keep, cmpeq(A, B)), A, C); \
+      __m128i e01  = SCALE2X_SELECT(_mm_andnot_si128(keep, cmpeq(A, D)), A, C); \
+      __m128i e10  = SCALE2X_SELECT(_mm_andnot_si128(keep, cmpeq(E, B)), E, C); \
+      __m128i e11  = SCALE2X_SELECT(_mm_andnot_si128(keep, cmpeq(E, D)), E, C); \
+      \
+      _mm_storeu_si128((__m128i*)(out0 + (x << 1)), unpacklo(e00, e01)); \
+      _mm_storeu_si128((__m128i*)(out0 + (x << 1) + step), unpackhi(e00, e01)); \
+      _mm_storeu_si128((__m128i*)(out1 + (x << 1)), unpacklo(e10, e11)); \
+      _mm_storeu_si128((__m128i*)(out1 + (x << 1) + step), unpackhi(e10, e11)); \
+   } \
+   return x; \
+}
+
+SCALE2X_ROW_SSE2(scale2x_row_sse2_rgb565, uint16_t, 8,
+      _mm_cmpeq_epi16, _mm_unpacklo_epi16, _mm_unpackhi_epi16)
+SCALE2X_ROW_SSE2(scale2x_row_sse2_xrgb8888, uint32_t, 4,
+      _mm_cmpeq_epi32, _mm_unpacklo_epi32, _mm_unpackhi_epi32)
+#elif defined(SCALE2X_NEON)
+#define SCALE2X_ROW_NEON(name, typename_t, vec_t, pair_t, step, sfx) \
+static unsigned name(const typename_t *src, unsigned width, \
+      int prevline, int nextline, typename_t *out0, typename_t *out1) \
+{ \
+   unsigned x; \
+   for (x = 1; x + step < width; x += step) \
+   { \
+      vec_t A    = vld1q_##sfx(src + x - prevline); \
+      vec_t B    = vld1q_##sfx(src + x - 1); \
+      vec_t C    = vld1q_##sfx(src + x); \
+      vec_t D    = vld1q_##sfx(src + x + 1); \
+      vec_t E    = vld1q_##sfx(src + x + nextline); \
+      /* Lanes where (A == E || B == D) keep C everywhere */ \
+      vec_t keep = vorrq_##sfx(vceqq_##sfx(A, E), vceqq_##sfx(B, D)); \
+      pair_t row; \
+      \
+      row.val[0] = vbslq_##sfx(vbicq_##sfx(vceqq_##sfx(A, B), keep), A, C); \
+      row.val[1] = vbslq_##sfx(vbicq_##sfx(vceqq_##sfx(A, D), keep), A, C); \
+      vst2q_##sfx(out0 + (x << 1), row); \
+      row.val[0] = vbslq_##sfx(vbicq_##sfx(vceqq_##sfx(E, B), keep), E, C); \
+      row.val[1] = vbslq_##sfx(vbicq_##sfx(vceqq_##sfx(E, D), keep), E, C); \
+      vst2q_##sfx(out1 + (x << 1), row); \
+   } \
+   return x; \
+}
+
+SCALE2X_ROW_NEON(scale2x_row_neon_rgb565, uint16_t,
+      uint16x8_t, uint16x8x2_t, 8, u16)
+SCALE2X_ROW_NEON(scale2x_row_neon_xrgb8888, uint32_t,
+      uint32x4_t, uint32x4x2_t, 4, u32)
+#else
+#define SCALE2X_ROW_NONE(src, width, prevline, nextline, out0, out1) 1
+#endif
+
 static void scale2x_generic_rgb565(unsigned width, unsigned height,
-      int first, int last,
+      int first, int last, int simd,
       const uint16_t *src, unsigned src_stride,
       uint16_t *dst, unsigned dst_stride)
 {
    unsigned x, y;
-   uint16_t *out0, *out1;
-   out0 = (uint16_t*)dst;
-   out1 = (uint16_t*)(dst + dst_stride);
-   SCALE2X_GENERIC(uint16_t, width, height, first, last,
-         src, src_stride, dst, dst_stride, out0, out1);
+   uint16_t *out0 = (uint16_t*)dst;
+   uint16_t *out1 = (uint16_t*)(dst + dst_stride);
+
+#if defined(SCALE2X_SSE2)
+   SCALE2X_GENERIC(uint16_t, scale2x_row_sse2_rgb565);
+#elif defined(SCALE2X_NEON)
+   SCALE2X_GENERIC(uint16_t, scale2x_row_neon_rgb565);
+#else
+   SCALE2X_GENERIC(uint16_t, SCALE2X_ROW_NONE);
+#endif
 }
 
 static void scale2x_generic_xrgb8888(unsigned width, unsigned height,
-      int first, int last,
+      int first, int last, int simd,
       const uint32_t *src, unsigned src_stride,
       uint32_t *dst, unsigned dst_stride)
 {
@@ -104,8 +206,13 @@ static void scale2x_generic_xrgb8888(unsigned width, unsigned height,
    uint32_t *out0 = (uint32_t*)dst;
    uint32_t *out1 = (uint32_t*)(dst + dst_stride);
 
-   SCALE2X_GENERIC(uint32_t, width, height, first, last,
-         src, src_stride, dst, dst_stride, out0, out1);
+#if defined(SCALE2X_SSE2)
+   SCALE2X_GENERIC(uint32_t, scale2x_row_sse2_xrgb8888);
+#elif defined(SCALE2X_NEON)
+   SCALE2X_GENERIC(uint32_t, scale2x_row_neon_xrgb8888);
+#else
+   SCALE2X_GENERIC(uint32_t, SCALE2X_ROW_NONE);
+#endif
 }
 
 static unsigned scale2x_generic_input_fmts(void)
@@ -130,15 +237,15 @@ static void *scale2x_generic_create(const struct softfilter_config *config,
       unsigned threads, softfilter_simd_mask_t simd, void *userdata)
 {
    struct filter_data *filt = (struct filter_data*)calloc(1, sizeof(*filt));
-   (void)simd;
    (void)config;
    (void)userdata;
    if (!filt)
       return NULL;
    filt->workers = (struct softfilter_thread_data*)
       calloc(threads, sizeof(struct softfilter_thread_data));
-   filt->threads = 1;
+   filt->threads = threads;
    filt->in_fmt  = in_fmt;
+   filt->simd    = simd;
    if (!filt->workers)
    {
       free(filt);
@@ -176,7 +283,8 @@ static void scale2x_work_cb_xrgb8888(void *data, void *thread_data)
    unsigned height = thr->height;
 
    scale2x_generic_xrgb8888(width, height,
-         thr->first, thr->last, input,
+         thr->first, thr->last,
+         thr->simd & SCALE2X_SIMD, input,
          (unsigned)(thr->in_pitch / SOFTFILTER_BPP_XRGB8888),
          output,
          (unsigned)(thr->out_pitch / SOFTFILTER_BPP_XRGB8888));
@@ -192,7 +300,8 @@ static void scale2x_work_cb_rgb565(void *data, void *thread_data)
    unsigned height = thr->height;
 
    scale2x_generic_rgb565(width, height,
-         thr->first, thr->last, input,
+         thr->first, thr->last,
+         thr->simd & SCALE2X_SIMD, input,
          (unsigned)(thr->in_pitch / SOFTFILTER_BPP_RGB565),
          output,
          (unsigned)(thr->out_pitch / SOFTFILTER_BPP_RGB565));
@@ -219,10 +328,11 @@ static void scale2x_generic_packets(void *data,
       thr->in_pitch = input_stride;
       thr->width = width;
       thr->height = y_end - y_start;
+      thr->simd = filt->simd;
 
       /* Workers need to know if they can access pixels
        * outside their given buffer. */
-      thr->first = y_start;
+      thr->first = y_start == 0;
       thr->last = y_end == height;
 
       if (filt->in_fmt == SOFTFILTER_FMT_XRGB8888)
@@ -260,3 +370,8 @@ const struct softfilter_implementation *softfilter_get_implementation(
 #undef softfilter_thread_data
 #undef filter_data
 #endif
+
+#undef SCALE2X_SSE2
+#undef SCALE2X_NEON
+#undef SCALE2X_ROW_NONE
+#undef SCALE2X_SIMD
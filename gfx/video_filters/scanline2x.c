@@ -20,6 +20,14 @@
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define SCANLINE2X_SSE2
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !defined(DONT_WANT_ARM_OPTIMIZATIONS)
+#include <arm_neon.h>
+#define SCANLINE2X_NEON
+#endif
+
 #ifdef RARCH_INTERNAL
 #define softfilter_get_implementation scanline2x_get_implementation
 #define softfilter_thread_data scanline2x_softfilter_thread_data
@@ -37,6 +45,7 @@ struct softfilter_thread_data
    unsigned height;
    int first;
    int last;
+   softfilter_simd_mask_t simd;
 };
 
 struct filter_data
@@ -44,6 +53,7 @@ struct filter_data
    unsigned threads;
    struct softfilter_thread_data *workers;
    unsigned in_fmt;
+   softfilter_simd_mask_t simd;
 };
 
 static unsigned scanline2x_generic_input_fmts(void)
@@ -68,18 +78,16 @@ static void *scanline2x_generic_create(const struct softfilter_config *config,
       unsigned threads, softfilter_simd_mask_t simd, void *userdata)
 {
    struct filter_data *filt = (struct filter_data*)calloc(1, sizeof(*filt));
-   (void)simd;
    (void)config;
    (void)userdata;
 
    if (!filt) {
       return NULL;
    }
-   /* Apparently the code is not thread-safe,
-    * so force single threaded operation... */
-   filt->workers = (struct softfilter_thread_data*)calloc(1, sizeof(struct softfilter_thread_data));
-   filt->threads = 1;
+   filt->workers = (struct softfilter_thread_data*)calloc(threads, sizeof(struct softfilter_thread_data));
+   filt->threads = threads;
    filt->in_fmt  = in_fmt;
+   filt->simd    = simd;
    if (!filt->workers) {
       free(filt);
       return NULL;
@@ -117,7 +125,48 @@ static void scanline2x_work_cb_xrgb8888(void *data, void *thread_data)
    for (y = 0; y < thr->height; ++y)
    {
       uint32_t *out_ptr = output;
-      for (x = 0; x < thr->width; ++x)
+
+      x = 0;
+#if defined(SCANLINE2X_SSE2)
+      if (thr->simd & SOFTFILTER_SIMD_SSE2)
+      {
+         for (; x + 4 <= thr->width; x += 4, out_ptr += 8)
+         {
+            __m128i color    = _mm_loadu_si128((const __m128i*)(input + x));
+            __m128i scanline = _mm_sub_epi8(color, _mm_and_si128(
+                     _mm_srli_epi32(color, 2), _mm_set1_epi32(0x3f3f3f3f)));
+
+            _mm_storeu_si128((__m128i*)out_ptr,
+                  _mm_unpacklo_epi32(color, color));
+            _mm_storeu_si128((__m128i*)(out_ptr + 4),
+                  _mm_unpackhi_epi32(color, color));
+            _mm_storeu_si128((__m128i*)(out_ptr + out_stride),
+                  _mm_unpacklo_epi32(scanline, scanline));
+            _mm_storeu_si128((__m128i*)(out_ptr + out_stride + 4),
+                  _mm_unpackhi_epi32(scanline, scanline));
+         }
+      }
+#elif defined(SCANLINE2X_NEON)
+      if (thr->simd & SOFTFILTER_SIMD_NEON)
+      {
+         for (; x + 4 <= thr->width; x += 4, out_ptr += 8)
+         {
+            uint32x4_t color    = vld1q_u32(input + x);
+            uint8x16_t bytes    = vreinterpretq_u8_u32(color);
+            uint32x4_t scanline = vreinterpretq_u32_u8(
+                  vsubq_u8(bytes, vshrq_n_u8(bytes, 2)));
+            uint32x4x2_t row;
+
+            row.val[0] = color;
+            row.val[1] = color;
+            vst2q_u32(out_ptr, row);
+            row.val[0] = scanline;
+            row.val[1] = scanline;
+            vst2q_u32(out_ptr + out_stride, row);
+         }
+      }
+#endif
+      for (; x < thr->width; ++x)
       {
          /* Note: We process the 'padding' bits as though they
           * matter (they don't), since this deals with any potential
@@ -163,7 +212,51 @@ static void scanline2x_work_cb_rgb565(void *data, void *thread_data)
    for (y = 0; y < thr->height; ++y)
    {
       uint16_t *out_ptr = output;
-      for (x = 0; x < thr->width; ++x)
+
+      x = 0;
+#if defined(SCANLINE2X_SSE2)
+      if (thr->simd & SOFTFILTER_SIMD_SSE2)
+      {
+         for (; x + 8 <= thr->width; x += 8, out_ptr += 16)
+         {
+            __m128i color    = _mm_loadu_si128((const __m128i*)(input + x));
+            /* Bit 5 (low green bit) is dropped, like the C path */
+            __m128i masked   = _mm_and_si128(color, _mm_set1_epi16(0xffdf));
+            __m128i scanline = _mm_sub_epi16(masked, _mm_and_si128(
+                     _mm_srli_epi16(masked, 2), _mm_set1_epi16(0x39c7)));
+
+            _mm_storeu_si128((__m128i*)out_ptr,
+                  _mm_unpacklo_epi16(color, color));
+            _mm_storeu_si128((__m128i*)(out_ptr + 8),
+                  _mm_unpackhi_epi16(color, color));
+            _mm_storeu_si128((__m128i*)(out_ptr + out_stride),
+                  _mm_unpacklo_epi16(scanline, scanline));
+            _mm_storeu_si128((__m128i*)(out_ptr + out_stride + 8),
+                  _mm_unpackhi_epi16(scanline, scanline));
+         }
+      }
+#elif defined(SCANLINE2X_NEON)
+      if (thr->simd & SOFTFILTER_SIMD_NEON)
+      {
+         for (; x + 8 <= thr->width; x += 8, out_ptr += 16)
+         {
+            uint16x8_t color    = vld1q_u16(input + x);
+            /* Bit 5 (low green bit) is dropped, like the C path */
+            uint16x8_t masked   = vandq_u16(color, vdupq_n_u16(0xffdf));
+            uint16x8_t scanline = vsubq_u16(masked, vandq_u16(
+                     vshrq_n_u16(masked, 2), vdupq_n_u16(0x39c7)));
+            uint16x8x2_t row;
+
+            row.val[0] = color;
+            row.val[1] = color;
+            vst2q_u16(out_ptr, row);
+            row.val[0] = scanline;
+            row.val[1] = scanline;
+            vst2q_u16(out_ptr + out_stride, row);
+         }
+      }
+#endif
+      for (; x < thr->width; ++x)
       {
          uint16_t *out_line_ptr  = out_ptr;
          uint16_t color          = *(input + x);
@@ -197,27 +290,32 @@ static void scanline2x_generic_packets(void *data,
       void *output, size_t output_stride,
       const void *input, unsigned width, unsigned height, size_t input_stride)
 {
-   /* We are guaranteed single threaded operation
-    * (filt->threads = 1) so we don't need to loop
-    * over threads and can cull some code. This only
-    * makes the tiniest performance difference, but
-    * every little helps when running on an o3DS... */
+   /* Output rows only depend on their own input row,
+    * so the frame is simply cut into bands */
+   unsigned i;
    struct filter_data *filt = (struct filter_data*)data;
-   struct softfilter_thread_data *thr = (struct softfilter_thread_data*)&filt->workers[0];
-
-   thr->out_data = (uint8_t*)output;
-   thr->in_data = (const uint8_t*)input;
-   thr->out_pitch = output_stride;
-   thr->in_pitch = input_stride;
-   thr->width = width;
-   thr->height = height;
-
-   if (filt->in_fmt == SOFTFILTER_FMT_XRGB8888) {
-      packets[0].work = scanline2x_work_cb_xrgb8888;
-   } else if (filt->in_fmt == SOFTFILTER_FMT_RGB565) {
-      packets[0].work = scanline2x_work_cb_rgb565;
+
+   for (i = 0; i < filt->threads; i++)
+   {
+      struct softfilter_thread_data *thr =
+         (struct softfilter_thread_data*)&filt->workers[i];
+      unsigned y_start = (height * i) / filt->threads;
+      unsigned y_end   = (height * (i + 1)) / filt->threads;
+
+      thr->out_data  = (uint8_t*)output + y_start * 2 * output_stride;
+      thr->in_data   = (const uint8_t*)input + y_start * input_stride;
+      thr->out_pitch = output_stride;
+      thr->in_pitch  = input_stride;
+      thr->width     = width;
+      thr->height    = y_end - y_start;
+      thr->simd      = filt->simd;
+
+      if (filt->in_fmt == SOFTFILTER_FMT_XRGB8888)
+         packets[i].work = scanline2x_work_cb_xrgb8888;
+      else if (filt->in_fmt == SOFTFILTER_FMT_RGB565)
+         packets[i].work = scanline2x_work_cb_rgb565;
+      packets[i].thread_data = thr;
    }
-   packets[0].thread_data = thr;
 }
 
 static const struct softfilter_implementation scanline2x_generic = {
@@ -248,3 +346,6 @@ const struct softfilter_implementation *softfilter_get_implementation(
 #undef softfilter_thread_data
 #undef filter_data
 #endif
+
+#undef SCANLINE2X_SSE2
+#undef SCANLINE2X_NEON
@@ -4,6 +4,8 @@
 #ifndef SNES_NTSC_H
 #define SNES_NTSC_H
 
+#include <limits.h>
+
 #include "snes_ntsc_config.h"
 
 #ifdef __cplusplus
@@ -134,7 +136,13 @@ statement in a block (unless you're using C++). */
 /* private */
 enum { snes_ntsc_entry_size = 128 };
 enum { snes_ntsc_palette_size = 0x2000 };
-typedef unsigned long snes_ntsc_rgb_t;
+/* The kernels only ever look at the low 32 bits of an entry, so
+keep the 4 MB table from doubling where long is 64 bits wide */
+#if UINT_MAX == 0xFFFFFFFF
+	typedef unsigned int snes_ntsc_rgb_t;
+#else
+	typedef unsigned long snes_ntsc_rgb_t;
+#endif
 struct snes_ntsc_t {
 	snes_ntsc_rgb_t table [snes_ntsc_palette_size] [snes_ntsc_entry_size];
 };
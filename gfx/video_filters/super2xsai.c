@@ -19,6 +19,18 @@
 #include "softfilter.h"
 #include <stdlib.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define SUPERTWOXSAI_SSE2
+#define SUPERTWOXSAI_SIMD SOFTFILTER_SIMD_SSE2
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !defined(DONT_WANT_ARM_OPTIMIZATIONS)
+#include <arm_neon.h>
+#define SUPERTWOXSAI_NEON
+#define SUPERTWOXSAI_SIMD SOFTFILTER_SIMD_NEON
+#else
+#define SUPERTWOXSAI_SIMD 0
+#endif
+
 #ifdef RARCH_INTERNAL
 #define softfilter_get_implementation supertwoxsai_get_implementation
 #define softfilter_thread_data supertwoxsai_softfilter_thread_data
@@ -38,6 +50,7 @@ struct softfilter_thread_data
    unsigned height;
    int first;
    int last;
+   softfilter_simd_mask_t simd;
 };
 
 struct filter_data
@@ -45,6 +58,7 @@ struct filter_data
    unsigned threads;
    struct softfilter_thread_data *workers;
    unsigned in_fmt;
+   softfilter_simd_mask_t simd;
 };
 
 static unsigned supertwoxsai_generic_input_fmts(void)
@@ -72,13 +86,13 @@ static void *supertwoxsai_generic_create(const struct softfilter_config *config,
    if (!filt)
       return NULL;
 
-   (void)simd;
    (void)config;
    (void)userdata;
 
    filt->workers = (struct softfilter_thread_data*)calloc(threads, sizeof(struct softfilter_thread_data));
    filt->threads = 1;
    filt->in_fmt  = in_fmt;
+   filt->simd    = simd;
 
    if (!filt->workers)
    {
@@ -200,8 +214,222 @@ static void supertwoxsai_generic_destroy(void *data)
          out += 2
 #endif
 
+#if defined(SUPERTWOXSAI_SSE2)
+#define SUPERTWOXSAI_VEC16              __m128i
+#define SUPERTWOXSAI_VEC32              __m128i
+#define SUPERTWOXSAI_LOAD16(p)          _mm_loadu_si128((const __m128i*)(p))
+#define SUPERTWOXSAI_LOAD32(p)          _mm_loadu_si128((const __m128i*)(p))
+#define SUPERTWOXSAI_DUP16(x)           _mm_set1_epi16((short)(x))
+#define SUPERTWOXSAI_DUP32(x)           _mm_set1_epi32((int)(x))
+#define SUPERTWOXSAI_EQ16(a, b)         _mm_cmpeq_epi16(a, b)
+#define SUPERTWOXSAI_EQ32(a, b)         _mm_cmpeq_epi32(a, b)
+#define SUPERTWOXSAI_AND16(a, b)        _mm_and_si128(a, b)
+#define SUPERTWOXSAI_AND32(a, b)        _mm_and_si128(a, b)
+#define SUPERTWOXSAI_OR16(a, b)         _mm_or_si128(a, b)
+#define SUPERTWOXSAI_OR32(a, b)         _mm_or_si128(a, b)
+#define SUPERTWOXSAI_BIC16(a, b)        _mm_andnot_si128(b, a)
+#define SUPERTWOXSAI_BIC32(a, b)        _mm_andnot_si128(b, a)
+#define SUPERTWOXSAI_SEL16(m, a, b)     _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b))
+#define SUPERTWOXSAI_SEL32(m, a, b)     _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b))
+#define SUPERTWOXSAI_ADD16(a, b)        _mm_add_epi16(a, b)
+#define SUPERTWOXSAI_ADD32(a, b)        _mm_add_epi32(a, b)
+#define SUPERTWOXSAI_SUB16(a, b)        _mm_sub_epi16(a, b)
+#define SUPERTWOXSAI_SUB32(a, b)        _mm_sub_epi32(a, b)
+#define SUPERTWOXSAI_SHR16(a, n)        _mm_srli_epi16(a, n)
+#define SUPERTWOXSAI_SHR32(a, n)        _mm_srli_epi32(a, n)
+#define SUPERTWOXSAI_GTZ16(a)           _mm_cmpgt_epi16(a, _mm_setzero_si128())
+#define SUPERTWOXSAI_GTZ32(a)           _mm_cmpgt_epi32(a, _mm_setzero_si128())
+#define SUPERTWOXSAI_LTZ16(a)           _mm_cmplt_epi16(a, _mm_setzero_si128())
+#define SUPERTWOXSAI_LTZ32(a)           _mm_cmplt_epi32(a, _mm_setzero_si128())
+#define SUPERTWOXSAI_STORE2_16(p, a, b) \
+   _mm_storeu_si128((__m128i*)(p), _mm_unpacklo_epi16(a, b)); \
+   _mm_storeu_si128((__m128i*)(p) + 1, _mm_unpackhi_epi16(a, b))
+#define SUPERTWOXSAI_STORE2_32(p, a, b) \
+   _mm_storeu_si128((__m128i*)(p), _mm_unpacklo_epi32(a, b)); \
+   _mm_storeu_si128((__m128i*)(p) + 1, _mm_unpackhi_epi32(a, b))
+#elif defined(SUPERTWOXSAI_NEON)
+#define SUPERTWOXSAI_VEC16              uint16x8_t
+#define SUPERTWOXSAI_VEC32              uint32x4_t
+#define SUPERTWOXSAI_LOAD16(p)          vld1q_u16(p)
+#define SUPERTWOXSAI_LOAD32(p)          vld1q_u32(p)
+#define SUPERTWOXSAI_DUP16(x)           vdupq_n_u16(x)
+#define SUPERTWOXSAI_DUP32(x)           vdupq_n_u32(x)
+#define SUPERTWOXSAI_EQ16(a, b)         vceqq_u16(a, b)
+#define SUPERTWOXSAI_EQ32(a, b)         vceqq_u32(a, b)
+#define SUPERTWOXSAI_AND16(a, b)        vandq_u16(a, b)
+#define SUPERTWOXSAI_AND32(a, b)        vandq_u32(a, b)
+#define SUPERTWOXSAI_OR16(a, b)         vorrq_u16(a, b)
+#define SUPERTWOXSAI_OR32(a, b)         vorrq_u32(a, b)
+#define SUPERTWOXSAI_BIC16(a, b)        vbicq_u16(a, b)
+#define SUPERTWOXSAI_BIC32(a, b)        vbicq_u32(a, b)
+#define SUPERTWOXSAI_SEL16(m, a, b)     vbslq_u16(m, a, b)
+#define SUPERTWOXSAI_SEL32(m, a, b)     vbslq_u32(m, a, b)
+#define SUPERTWOXSAI_ADD16(a, b)        vaddq_u16(a, b)
+#define SUPERTWOXSAI_ADD32(a, b)        vaddq_u32(a, b)
+#define SUPERTWOXSAI_SUB16(a, b)        vsubq_u16(a, b)
+#define SUPERTWOXSAI_SUB32(a, b)        vsubq_u32(a, b)
+#define SUPERTWOXSAI_SHR16(a, n)        vshrq_n_u16(a, n)
+#define SUPERTWOXSAI_SHR32(a, n)        vshrq_n_u32(a, n)
+#define SUPERTWOXSAI_GTZ16(a)           vcgtq_s16(vreinterpretq_s16_u16(a), vdupq_n_s16(0))
+#define SUPERTWOXSAI_GTZ32(a)           vcgtq_s32(vreinterpretq_s32_u32(a), vdupq_n_s32(0))
+#define SUPERTWOXSAI_LTZ16(a)           vcltq_s16(vreinterpretq_s16_u16(a), vdupq_n_s16(0))
+#define SUPERTWOXSAI_LTZ32(a)           vcltq_s32(vreinterpretq_s32_u32(a), vdupq_n_s32(0))
+#define SUPERTWOXSAI_STORE2_16(p, a, b) \
+   { \
+      uint16x8x2_t pair_; \
+      pair_.val[0] = a; \
+      pair_.val[1] = b; \
+      vst2q_u16(p, pair_); \
+   }
+#define SUPERTWOXSAI_STORE2_32(p, a, b) \
+   { \
+      uint32x4x2_t pair_; \
+      pair_.val[0] = a; \
+      pair_.val[1] = b; \
+      vst2q_u32(p, pair_); \
+   }
+#endif
+
+#if defined(SUPERTWOXSAI_SSE2) || defined(SUPERTWOXSAI_NEON)
+#define SUPERTWOXSAI_VINTERP(w, A, B) \
+   SUPERTWOXSAI_ADD##w(SUPERTWOXSAI_ADD##w( \
+         SUPERTWOXSAI_SHR##w(SUPERTWOXSAI_AND##w(A, mask1), 1), \
+         SUPERTWOXSAI_SHR##w(SUPERTWOXSAI_AND##w(B, mask1), 1)), \
+         SUPERTWOXSAI_AND##w(SUPERTWOXSAI_AND##w(A, B), low1))
+
+#define SUPERTWOXSAI_VINTERP2(w, A, B, C, D) \
+   SUPERTWOXSAI_ADD##w(SUPERTWOXSAI_ADD##w( \
+         SUPERTWOXSAI_ADD##w(SUPERTWOXSAI_SHR##w(SUPERTWOXSAI_AND##w(A, mask2), 2), \
+            SUPERTWOXSAI_SHR##w(SUPERTWOXSAI_AND##w(B, mask2), 2)), \
+         SUPERTWOXSAI_ADD##w(SUPERTWOXSAI_SHR##w(SUPERTWOXSAI_AND##w(C, mask2), 2), \
+            SUPERTWOXSAI_SHR##w(SUPERTWOXSAI_AND##w(D, mask2), 2))), \
+         SUPERTWOXSAI_AND##w(SUPERTWOXSAI_SHR##w(SUPERTWOXSAI_ADD##w( \
+            SUPERTWOXSAI_ADD##w(SUPERTWOXSAI_AND##w(A, low2), SUPERTWOXSAI_AND##w(B, low2)), \
+            SUPERTWOXSAI_ADD##w(SUPERTWOXSAI_AND##w(C, low2), SUPERTWOXSAI_AND##w(D, low2))), 2), low2))
+
+/* All-ones in the lanes where A matches both C and D. As masks
+ * are -1, supertwoxsai_result(A, B, C, D) is
+ * VRESULT(A, C, D) - VRESULT(B, C, D). */
+#define SUPERTWOXSAI_VRESULT(w, A, C, D) \
+   SUPERTWOXSAI_AND##w(SUPERTWOXSAI_EQ##w(A, C), SUPERTWOXSAI_EQ##w(A, D))
+
+/* supertwoxsai_function on a whole vector of pixels: every
+ * branch is worked out for all lanes and the results are picked
+ * with the compare masks. Handles whole vectors out of @width
+ * and returns how many pixels were done. */
+#define SUPERTWOXSAI_ROW_SIMD(name, typename_t, vec_t, w, step, m1, l1, m2, l2) \
+static unsigned name(const typename_t *in, unsigned width, \
+      unsigned nextline, typename_t *out, unsigned dst_stride) \
+{ \
+   unsigned x; \
+   const vec_t mask1 = SUPERTWOXSAI_DUP##w(m1); \
+   const vec_t low1  = SUPERTWOXSAI_DUP##w(l1); \
+   const vec_t mask2 = SUPERTWOXSAI_DUP##w(m2); \
+   const vec_t low2  = SUPERTWOXSAI_DUP##w(l2); \
+   \
+   for (x = 0; x + step <= width; x += step) \
+   { \
+      const typename_t *p = in + x; \
+      vec_t colorB0 = SUPERTWOXSAI_LOAD##w(p - nextline - 1); \
+      vec_t colorB1 = SUPERTWOXSAI_LOAD##w(p - nextline + 0); \
+      vec_t colorB2 = SUPERTWOXSAI_LOAD##w(p - nextline + 1); \
+      vec_t colorB3 = SUPERTWOXSAI_LOAD##w(p - nextline + 2); \
+      vec_t color4  = SUPERTWOXSAI_LOAD##w(p - 1); \
+      vec_t color5  = SUPERTWOXSAI_LOAD##w(p + 0); \
+      vec_t color6  = SUPERTWOXSAI_LOAD##w(p + 1); \
+      vec_t colorS2 = SUPERTWOXSAI_LOAD##w(p + 2); \
+      vec_t color1  = SUPERTWOXSAI_LOAD##w(p + nextline - 1); \
+      vec_t color2  = SUPERTWOXSAI_LOAD##w(p + nextline + 0); \
+      vec_t color3  = SUPERTWOXSAI_LOAD##w(p + nextline + 1); \
+      vec_t colorS1 = SUPERTWOXSAI_LOAD##w(p + nextline + 2); \
+      vec_t colorA0 = SUPERTWOXSAI_LOAD##w(p + nextline + nextline - 1); \
+      vec_t colorA1 = SUPERTWOXSAI_LOAD##w(p + nextline + nextline + 0); \
+      vec_t colorA2 = SUPERTWOXSAI_LOAD##w(p + nextline + nextline + 1); \
+      vec_t colorA3 = SUPERTWOXSAI_LOAD##w(p + nextline + nextline + 2); \
+      vec_t eq26    = SUPERTWOXSAI_EQ##w(color2, color6); \
+      vec_t eq53    = SUPERTWOXSAI_EQ##w(color5, color3); \
+      vec_t eq63    = SUPERTWOXSAI_EQ##w(color6, color3); \
+      vec_t eq52    = SUPERTWOXSAI_EQ##w(color5, color2); \
+      /* The first three branches of supertwoxsai_function */ \
+      vec_t br1     = SUPERTWOXSAI_BIC##w(eq26, eq53); \
+      vec_t br2     = SUPERTWOXSAI_BIC##w(eq53, eq26); \
+      vec_t br3     = SUPERTWOXSAI_AND##w(eq26, eq53); \
+      vec_t r       = SUPERTWOXSAI_SUB##w(SUPERTWOXSAI_ADD##w( \
+               SUPERTWOXSAI_ADD##w(SUPERTWOXSAI_VRESULT(w, color6, color1, colorA1), \
+                  SUPERTWOXSAI_VRESULT(w, color6, color4, colorB1)), \
+               SUPERTWOXSAI_ADD##w(SUPERTWOXSAI_VRESULT(w, color6, colorA2, colorS1), \
+                  SUPERTWOXSAI_VRESULT(w, color6, colorB2, colorS2))), \
+            SUPERTWOXSAI_ADD##w( \
+               SUPERTWOXSAI_ADD##w(SUPERTWOXSAI_VRESULT(w, color5, color1, colorA1), \
+                  SUPERTWOXSAI_VRESULT(w, color5, color4, colorB1)), \
+               SUPERTWOXSAI_ADD##w(SUPERTWOXSAI_VRESULT(w, color5, colorA2, colorS1), \
+                  SUPERTWOXSAI_VRESULT(w, color5, colorB2, colorS2)))); \
+      vec_t interp56 = SUPERTWOXSAI_VINTERP(w, color5, color6); \
+      vec_t interp25 = SUPERTWOXSAI_VINTERP(w, color2, color5); \
+      vec_t product3 = SUPERTWOXSAI_SEL##w(SUPERTWOXSAI_GTZ##w(r), color6, \
+            SUPERTWOXSAI_SEL##w(SUPERTWOXSAI_LTZ##w(r), color5, interp56)); \
+      vec_t sel2b1  = SUPERTWOXSAI_BIC##w( \
+            SUPERTWOXSAI_AND##w(eq63, SUPERTWOXSAI_EQ##w(color3, colorA1)), \
+            SUPERTWOXSAI_OR##w(SUPERTWOXSAI_EQ##w(color2, colorA2), \
+               SUPERTWOXSAI_EQ##w(color3, colorA0))); \
+      vec_t sel2b2  = SUPERTWOXSAI_BIC##w( \
+            SUPERTWOXSAI_AND##w(eq52, SUPERTWOXSAI_EQ##w(color2, colorA2)), \
+            SUPERTWOXSAI_OR##w(SUPERTWOXSAI_EQ##w(colorA1, color3), \
+               SUPERTWOXSAI_EQ##w(color2, colorA3))); \
+      vec_t sel1b1  = SUPERTWOXSAI_BIC##w( \
+            SUPERTWOXSAI_AND##w(eq63, SUPERTWOXSAI_EQ##w(color6, colorB1)), \
+            SUPERTWOXSAI_OR##w(SUPERTWOXSAI_EQ##w(color5, colorB2), \
+               SUPERTWOXSAI_EQ##w(color6, colorB0))); \
+      vec_t sel1b2  = SUPERTWOXSAI_BIC##w( \
+            SUPERTWOXSAI_AND##w(eq52, SUPERTWOXSAI_EQ##w(color5, colorB2)), \
+            SUPERTWOXSAI_OR##w(SUPERTWOXSAI_EQ##w(colorB1, color6), \
+               SUPERTWOXSAI_EQ##w(color5, colorB3))); \
+      vec_t sel2a   = SUPERTWOXSAI_OR##w(SUPERTWOXSAI_BIC##w( \
+               SUPERTWOXSAI_AND##w(br2, SUPERTWOXSAI_EQ##w(color4, color5)), \
+               SUPERTWOXSAI_EQ##w(color5, colorA2)), \
+            SUPERTWOXSAI_BIC##w(SUPERTWOXSAI_AND##w( \
+                  SUPERTWOXSAI_EQ##w(color5, color1), SUPERTWOXSAI_EQ##w(color6, color5)), \
+               SUPERTWOXSAI_OR##w(SUPERTWOXSAI_EQ##w(color4, color2), \
+                  SUPERTWOXSAI_EQ##w(color5, colorA0)))); \
+      vec_t sel1a   = SUPERTWOXSAI_OR##w(SUPERTWOXSAI_BIC##w( \
+               SUPERTWOXSAI_AND##w(br1, SUPERTWOXSAI_EQ##w(color1, color2)), \
+               SUPERTWOXSAI_EQ##w(color2, colorB2)), \
+            SUPERTWOXSAI_BIC##w(SUPERTWOXSAI_AND##w( \
+                  SUPERTWOXSAI_EQ##w(color4, color2), SUPERTWOXSAI_EQ##w(color3, color2)), \
+               SUPERTWOXSAI_OR##w(SUPERTWOXSAI_EQ##w(color1, color5), \
+                  SUPERTWOXSAI_EQ##w(color2, colorB0)))); \
+      vec_t product2b = SUPERTWOXSAI_SEL##w(br1, color2, \
+            SUPERTWOXSAI_SEL##w(br2, color5, \
+            SUPERTWOXSAI_SEL##w(br3, product3, \
+            SUPERTWOXSAI_SEL##w(sel2b1, SUPERTWOXSAI_VINTERP2(w, color3, color3, color3, color2), \
+            SUPERTWOXSAI_SEL##w(sel2b2, SUPERTWOXSAI_VINTERP2(w, color2, color2, color2, color3), \
+               SUPERTWOXSAI_VINTERP(w, color2, color3)))))); \
+      vec_t product1b = SUPERTWOXSAI_SEL##w(br1, color2, \
+            SUPERTWOXSAI_SEL##w(br2, color5, \
+            SUPERTWOXSAI_SEL##w(br3, product3, \
+            SUPERTWOXSAI_SEL##w(sel1b1, SUPERTWOXSAI_VINTERP2(w, color6, color6, color6, color5), \
+            SUPERTWOXSAI_SEL##w(sel1b2, SUPERTWOXSAI_VINTERP2(w, color6, color5, color5, color5), \
+               interp56))))); \
+      vec_t product2a = SUPERTWOXSAI_SEL##w(sel2a, interp25, color2); \
+      vec_t product1a = SUPERTWOXSAI_SEL##w(sel1a, interp25, color5); \
+      \
+      SUPERTWOXSAI_STORE2_##w(out + (x << 1), product1a, product1b); \
+      SUPERTWOXSAI_STORE2_##w(out + dst_stride + (x << 1), product2a, product2b); \
+   } \
+   return x; \
+}
+
+SUPERTWOXSAI_ROW_SIMD(supertwoxsai_row_simd_rgb565, uint16_t,
+      SUPERTWOXSAI_VEC16, 16, 8, 0xF7DE, 0x0821, 0xE79C, 0x1863)
+SUPERTWOXSAI_ROW_SIMD(supertwoxsai_row_simd_xrgb8888, uint32_t,
+      SUPERTWOXSAI_VEC32, 32, 4, 0xFEFEFEFE, 0x01010101, 0xFCFCFCFC, 0x03030303)
+#else
+#define supertwoxsai_row_simd_rgb565(in, width, nextline, out, dst_stride) 0
+#define supertwoxsai_row_simd_xrgb8888(in, width, nextline, out, dst_stride) 0
+#endif
+
 static void supertwoxsai_generic_xrgb8888(unsigned width, unsigned height,
-      int first, int last, uint32_t *src,
+      int first, int last, int simd, uint32_t *src,
       unsigned src_stride, uint32_t *dst, unsigned dst_stride)
 {
    unsigned finish;
@@ -212,7 +440,17 @@ static void supertwoxsai_generic_xrgb8888(unsigned width, unsigned height,
       uint32_t *in  = (uint32_t*)src;
       uint32_t *out = (uint32_t*)dst;
 
-      for (finish = width; finish; finish -= 1)
+      finish = width;
+      if (simd)
+      {
+         unsigned done = supertwoxsai_row_simd_xrgb8888(in, width,
+               nextline, out, dst_stride);
+         in     += done;
+         out    += done << 1;
+         finish -= done;
+      }
+
+      for (; finish; finish -= 1)
       {
          supertwoxsai_declare_variables(uint32_t, in, nextline);
 
@@ -231,7 +469,7 @@ static void supertwoxsai_generic_xrgb8888(unsigned width, unsigned height,
 }
 
 static void supertwoxsai_generic_rgb565(unsigned width, unsigned height,
-      int first, int last, uint16_t *src,
+      int first, int last, int simd, uint16_t *src,
       unsigned src_stride, uint16_t *dst, unsigned dst_stride)
 {
    unsigned finish;
@@ -242,7 +480,17 @@ static void supertwoxsai_generic_rgb565(unsigned width, unsigned height,
       uint16_t *in  = (uint16_t*)src;
       uint16_t *out = (uint16_t*)dst;
 
-      for (finish = width; finish; finish -= 1)
+      finish = width;
+      if (simd)
+      {
+         unsigned done = supertwoxsai_row_simd_rgb565(in, width,
+               nextline, out, dst_stride);
+         in     += done;
+         out    += done << 1;
+         finish -= done;
+      }
+
+      for (; finish; finish -= 1)
       {
          supertwoxsai_declare_variables(uint16_t, in, nextline);
 
@@ -269,7 +517,7 @@ static void supertwoxsai_work_cb_rgb565(void *data, void *thread_data)
    unsigned height = thr->height;
 
    supertwoxsai_generic_rgb565(width, height,
-         thr->first, thr->last, input,
+         thr->first, thr->last, thr->simd & SUPERTWOXSAI_SIMD, input,
         (unsigned)(thr->in_pitch / SOFTFILTER_BPP_RGB565),
         output,
         (unsigned)(thr->out_pitch / SOFTFILTER_BPP_RGB565));
@@ -284,7 +532,7 @@ static void supertwoxsai_work_cb_xrgb8888(void *data, void *thread_data)
    unsigned height = thr->height;
 
    supertwoxsai_generic_xrgb8888(width, height,
-         thr->first, thr->last, input,
+         thr->first, thr->last, thr->simd & SUPERTWOXSAI_SIMD, input,
             (unsigned)(thr->in_pitch / SOFTFILTER_BPP_XRGB8888),
             output,
             (unsigned)(thr->out_pitch / SOFTFILTER_BPP_XRGB8888));
@@ -310,6 +558,7 @@ static void supertwoxsai_generic_packets(void *data,
       thr->in_pitch = input_stride;
       thr->width = width;
       thr->height = y_end - y_start;
+      thr->simd = filt->simd;
 
       // Workers need to know if they can access pixels outside their given buffer.
       thr->first = y_start;
@@ -349,3 +598,7 @@ const struct softfilter_implementation *softfilter_get_implementation(softfilter
 #undef softfilter_thread_data
 #undef filter_data
 #endif
+
+#undef SUPERTWOXSAI_SSE2
+#undef SUPERTWOXSAI_NEON
+#undef SUPERTWOXSAI_SIMD
@@ -19,6 +19,18 @@
 #include "softfilter.h"
 #include <stdlib.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define SUPEREAGLE_SSE2
+#define SUPEREAGLE_SIMD SOFTFILTER_SIMD_SSE2
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !defined(DONT_WANT_ARM_OPTIMIZATIONS)
+#include <arm_neon.h>
+#define SUPEREAGLE_NEON
+#define SUPEREAGLE_SIMD SOFTFILTER_SIMD_NEON
+#else
+#define SUPEREAGLE_SIMD 0
+#endif
+
 #ifdef RARCH_INTERNAL
 #define softfilter_get_implementation supereagle_get_implementation
 #define softfilter_thread_data supereagle_softfilter_thread_data
@@ -38,6 +50,7 @@ struct softfilter_thread_data
    unsigned height;
    int first;
    int last;
+   softfilter_simd_mask_t simd;
 };
 
 struct filter_data
@@ -45,6 +58,7 @@ struct filter_data
    unsigned threads;
    struct softfilter_thread_data *workers;
    unsigned in_fmt;
+   softfilter_simd_mask_t simd;
 };
 
 static unsigned supereagle_generic_input_fmts(void)
@@ -69,7 +83,6 @@ static void *supereagle_generic_create(const struct softfilter_config *config,
       unsigned threads, softfilter_simd_mask_t simd, void *userdata)
 {
    struct filter_data *filt = (struct filter_data*)calloc(1, sizeof(*filt));
-   (void)simd;
    (void)config;
    (void)userdata;
    if (!filt)
@@ -77,6 +90,7 @@ static void *supereagle_generic_create(const struct softfilter_config *config,
    filt->workers = (struct softfilter_thread_data*)calloc(threads, sizeof(struct softfilter_thread_data));
    filt->threads = 1;
    filt->in_fmt  = in_fmt;
+   filt->simd    = simd;
    if (!filt->workers)
    {
       free(filt);
@@ -214,8 +228,208 @@ static void supereagle_generic_destroy(void *data)
          out += 2
 #endif
 
+#if defined(SUPEREAGLE_SSE2)
+#define SUPEREAGLE_VEC16              __m128i
+#define SUPEREAGLE_VEC32              __m128i
+#define SUPEREAGLE_LOAD16(p)          _mm_loadu_si128((const __m128i*)(p))
+#define SUPEREAGLE_LOAD32(p)          _mm_loadu_si128((const __m128i*)(p))
+#define SUPEREAGLE_DUP16(x)           _mm_set1_epi16((short)(x))
+#define SUPEREAGLE_DUP32(x)           _mm_set1_epi32((int)(x))
+#define SUPEREAGLE_EQ16(a, b)         _mm_cmpeq_epi16(a, b)
+#define SUPEREAGLE_EQ32(a, b)         _mm_cmpeq_epi32(a, b)
+#define SUPEREAGLE_AND16(a, b)        _mm_and_si128(a, b)
+#define SUPEREAGLE_AND32(a, b)        _mm_and_si128(a, b)
+#define SUPEREAGLE_OR16(a, b)         _mm_or_si128(a, b)
+#define SUPEREAGLE_OR32(a, b)         _mm_or_si128(a, b)
+#define SUPEREAGLE_BIC16(a, b)        _mm_andnot_si128(b, a)
+#define SUPEREAGLE_BIC32(a, b)        _mm_andnot_si128(b, a)
+#define SUPEREAGLE_SEL16(m, a, b)     _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b))
+#define SUPEREAGLE_SEL32(m, a, b)     _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b))
+#define SUPEREAGLE_ADD16(a, b)        _mm_add_epi16(a, b)
+#define SUPEREAGLE_ADD32(a, b)        _mm_add_epi32(a, b)
+#define SUPEREAGLE_SUB16(a, b)        _mm_sub_epi16(a, b)
+#define SUPEREAGLE_SUB32(a, b)        _mm_sub_epi32(a, b)
+#define SUPEREAGLE_SHR16(a, n)        _mm_srli_epi16(a, n)
+#define SUPEREAGLE_SHR32(a, n)        _mm_srli_epi32(a, n)
+#define SUPEREAGLE_GTZ16(a)           _mm_cmpgt_epi16(a, _mm_setzero_si128())
+#define SUPEREAGLE_GTZ32(a)           _mm_cmpgt_epi32(a, _mm_setzero_si128())
+#define SUPEREAGLE_LTZ16(a)           _mm_cmplt_epi16(a, _mm_setzero_si128())
+#define SUPEREAGLE_LTZ32(a)           _mm_cmplt_epi32(a, _mm_setzero_si128())
+#define SUPEREAGLE_STORE2_16(p, a, b) \
+   _mm_storeu_si128((__m128i*)(p), _mm_unpacklo_epi16(a, b)); \
+   _mm_storeu_si128((__m128i*)(p) + 1, _mm_unpackhi_epi16(a, b))
+#define SUPEREAGLE_STORE2_32(p, a, b) \
+   _mm_storeu_si128((__m128i*)(p), _mm_unpacklo_epi32(a, b)); \
+   _mm_storeu_si128((__m128i*)(p) + 1, _mm_unpackhi_epi32(a, b))
+#elif defined(SUPEREAGLE_NEON)
+#define SUPEREAGLE_VEC16              uint16x8_t
+#define SUPEREAGLE_VEC32              uint32x4_t
+#define SUPEREAGLE_LOAD16(p)          vld1q_u16(p)
+#define SUPEREAGLE_LOAD32(p)          vld1q_u32(p)
+#define SUPEREAGLE_DUP16(x)           vdupq_n_u16(x)
+#define SUPEREAGLE_DUP32(x)           vdupq_n_u32(x)
+#define SUPEREAGLE_EQ16(a, b)         vceqq_u16(a, b)
+#define SUPEREAGLE_EQ32(a, b)         vceqq_u32(a, b)
+#define SUPEREAGLE_AND16(a, b)        vandq_u16(a, b)
+#define SUPEREAGLE_AND32(a, b)        vandq_u32(a, b)
+#define SUPEREAGLE_OR16(a, b)         vorrq_u16(a, b)
+#define SUPEREAGLE_OR32(a, b)         vorrq_u32(a, b)
+#define SUPEREAGLE_BIC16(a, b)        vbicq_u16(a, b)
+#define SUPEREAGLE_BIC32(a, b)        vbicq_u32(a, b)
+#define SUPEREAGLE_SEL16(m, a, b)     vbslq_u16(m, a, b)
+#define SUPEREAGLE_SEL32(m, a, b)     vbslq_u32(m, a, b)
+#define SUPEREAGLE_ADD16(a, b)        vaddq_u16(a, b)
+#define SUPEREAGLE_ADD32(a, b)        vaddq_u32(a, b)
+#define SUPEREAGLE_SUB16(a, b)        vsubq_u16(a, b)
+#define SUPEREAGLE_SUB32(a, b)        vsubq_u32(a, b)
+#define SUPEREAGLE_SHR16(a, n)        vshrq_n_u16(a, n)
+#define SUPEREAGLE_SHR32(a, n)        vshrq_n_u32(a, n)
+#define SUPEREAGLE_GTZ16(a)           vcgtq_s16(vreinterpretq_s16_u16(a), vdupq_n_s16(0))
+#define SUPEREAGLE_GTZ32(a)           vcgtq_s32(vreinterpretq_s32_u32(a), vdupq_n_s32(0))
+#define SUPEREAGLE_LTZ16(a)           vcltq_s16(vreinterpretq_s16_u16(a), vdupq_n_s16(0))
+#define SUPEREAGLE_LTZ32(a)           vcltq_s32(vreinterpretq_s32_u32(a), vdupq_n_s32(0))
+#define SUPEREAGLE_STORE2_16(p, a, b) \
+   { \
+      uint16x8x2_t pair_; \
+      pair_.val[0] = a; \
+      pair_.val[1] = b; \
+      vst2q_u16(p, pair_); \
+   }
+#define SUPEREAGLE_STORE2_32(p, a, b) \
+   { \
+      uint32x4x2_t pair_; \
+      pair_.val[0] = a; \
+      pair_.val[1] = b; \
+      vst2q_u32(p, pair_); \
+   }
+#endif
+
+#if defined(SUPEREAGLE_SSE2) || defined(SUPEREAGLE_NEON)
+#define SUPEREAGLE_VINTERP(w, A, B) \
+   SUPEREAGLE_ADD##w(SUPEREAGLE_ADD##w( \
+         SUPEREAGLE_SHR##w(SUPEREAGLE_AND##w(A, mask1), 1), \
+         SUPEREAGLE_SHR##w(SUPEREAGLE_AND##w(B, mask1), 1)), \
+         SUPEREAGLE_AND##w(SUPEREAGLE_AND##w(A, B), low1))
+
+/* supereagle_interpolate2(A, A, A, B) */
+#define SUPEREAGLE_VINTERP3(w, A, B) \
+   SUPEREAGLE_ADD##w(SUPEREAGLE_ADD##w( \
+         SUPEREAGLE_ADD##w(SUPEREAGLE_SHR##w(SUPEREAGLE_AND##w(A, mask2), 2), \
+            SUPEREAGLE_SHR##w(SUPEREAGLE_AND##w(A, mask2), 2)), \
+         SUPEREAGLE_ADD##w(SUPEREAGLE_SHR##w(SUPEREAGLE_AND##w(A, mask2), 2), \
+            SUPEREAGLE_SHR##w(SUPEREAGLE_AND##w(B, mask2), 2))), \
+         SUPEREAGLE_AND##w(SUPEREAGLE_SHR##w(SUPEREAGLE_ADD##w( \
+            SUPEREAGLE_ADD##w(SUPEREAGLE_AND##w(A, low2), SUPEREAGLE_AND##w(A, low2)), \
+            SUPEREAGLE_ADD##w(SUPEREAGLE_AND##w(A, low2), SUPEREAGLE_AND##w(B, low2))), 2), low2))
+
+/* All-ones in the lanes where A matches both C and D. As masks
+ * are -1, supereagle_result(A, B, C, D) is
+ * VRESULT(A, C, D) - VRESULT(B, C, D). */
+#define SUPEREAGLE_VRESULT(w, A, C, D) \
+   SUPEREAGLE_AND##w(SUPEREAGLE_EQ##w(A, C), SUPEREAGLE_EQ##w(A, D))
+
+/* supereagle_function on a whole vector of pixels: every branch
+ * is worked out for all lanes and the results are picked with
+ * the compare masks. Handles whole vectors out of @width and
+ * returns how many pixels were done. */
+#define SUPEREAGLE_ROW_SIMD(name, typename_t, vec_t, w, step, m1, l1, m2, l2) \
+static unsigned name(const typename_t *in, unsigned width, \
+      unsigned nextline, typename_t *out, unsigned dst_stride) \
+{ \
+   unsigned x; \
+   const vec_t mask1 = SUPEREAGLE_DUP##w(m1); \
+   const vec_t low1  = SUPEREAGLE_DUP##w(l1); \
+   const vec_t mask2 = SUPEREAGLE_DUP##w(m2); \
+   const vec_t low2  = SUPEREAGLE_DUP##w(l2); \
+   \
+   for (x = 0; x + step <= width; x += step) \
+   { \
+      const typename_t *p = in + x; \
+      vec_t colorB1 = SUPEREAGLE_LOAD##w(p - nextline + 0); \
+      vec_t colorB2 = SUPEREAGLE_LOAD##w(p - nextline + 1); \
+      vec_t color4  = SUPEREAGLE_LOAD##w(p - 1); \
+      vec_t color5  = SUPEREAGLE_LOAD##w(p + 0); \
+      vec_t color6  = SUPEREAGLE_LOAD##w(p + 1); \
+      vec_t colorS2 = SUPEREAGLE_LOAD##w(p + 2); \
+      vec_t color1  = SUPEREAGLE_LOAD##w(p + nextline - 1); \
+      vec_t color2  = SUPEREAGLE_LOAD##w(p + nextline + 0); \
+      vec_t color3  = SUPEREAGLE_LOAD##w(p + nextline + 1); \
+      vec_t colorS1 = SUPEREAGLE_LOAD##w(p + nextline + 2); \
+      vec_t colorA1 = SUPEREAGLE_LOAD##w(p + nextline + nextline + 0); \
+      vec_t colorA2 = SUPEREAGLE_LOAD##w(p + nextline + nextline + 1); \
+      vec_t eq26    = SUPEREAGLE_EQ##w(color2, color6); \
+      vec_t eq53    = SUPEREAGLE_EQ##w(color5, color3); \
+      /* The first three branches of supereagle_function */ \
+      vec_t br1     = SUPEREAGLE_BIC##w(eq26, eq53); \
+      vec_t br2     = SUPEREAGLE_BIC##w(eq53, eq26); \
+      vec_t br3     = SUPEREAGLE_AND##w(eq26, eq53); \
+      vec_t r       = SUPEREAGLE_SUB##w(SUPEREAGLE_ADD##w( \
+               SUPEREAGLE_ADD##w(SUPEREAGLE_VRESULT(w, color6, color1, colorA1), \
+                  SUPEREAGLE_VRESULT(w, color6, color4, colorB1)), \
+               SUPEREAGLE_ADD##w(SUPEREAGLE_VRESULT(w, color6, colorA2, colorS1), \
+                  SUPEREAGLE_VRESULT(w, color6, colorB2, colorS2))), \
+            SUPEREAGLE_ADD##w( \
+               SUPEREAGLE_ADD##w(SUPEREAGLE_VRESULT(w, color5, color1, colorA1), \
+                  SUPEREAGLE_VRESULT(w, color5, color4, colorB1)), \
+               SUPEREAGLE_ADD##w(SUPEREAGLE_VRESULT(w, color5, colorA2, colorS1), \
+                  SUPEREAGLE_VRESULT(w, color5, colorB2, colorS2)))); \
+      vec_t rpos    = SUPEREAGLE_AND##w(br3, SUPEREAGLE_GTZ##w(r)); \
+      vec_t rneg    = SUPEREAGLE_AND##w(br3, SUPEREAGLE_LTZ##w(r)); \
+      vec_t interp56 = SUPEREAGLE_VINTERP(w, color5, color6); \
+      vec_t interp23 = SUPEREAGLE_VINTERP(w, color2, color3); \
+      vec_t interp25 = SUPEREAGLE_VINTERP(w, color2, color5); \
+      vec_t interp26 = SUPEREAGLE_VINTERP(w, color2, color6); \
+      vec_t interp53 = SUPEREAGLE_VINTERP(w, color5, color3); \
+      vec_t product1a = SUPEREAGLE_SEL##w(br1, \
+               SUPEREAGLE_SEL##w(SUPEREAGLE_OR##w(SUPEREAGLE_EQ##w(color1, color2), \
+                     SUPEREAGLE_EQ##w(color6, colorB2)), \
+                  SUPEREAGLE_VINTERP(w, color2, interp25), interp56), \
+            SUPEREAGLE_SEL##w(br2, color5, \
+            SUPEREAGLE_SEL##w(rpos, interp56, \
+            SUPEREAGLE_SEL##w(br3, color5, \
+               SUPEREAGLE_VINTERP3(w, color5, interp26))))); \
+      vec_t product1b = SUPEREAGLE_SEL##w(br1, color2, \
+            SUPEREAGLE_SEL##w(br2, \
+               SUPEREAGLE_SEL##w(SUPEREAGLE_OR##w(SUPEREAGLE_EQ##w(colorB1, color5), \
+                     SUPEREAGLE_EQ##w(color3, colorS1)), \
+                  SUPEREAGLE_VINTERP(w, color5, interp56), interp56), \
+            SUPEREAGLE_SEL##w(rneg, interp56, \
+            SUPEREAGLE_SEL##w(br3, color2, \
+               SUPEREAGLE_VINTERP3(w, color6, interp53))))); \
+      vec_t product2a = SUPEREAGLE_SEL##w(br1, color2, \
+            SUPEREAGLE_SEL##w(br2, \
+               SUPEREAGLE_SEL##w(SUPEREAGLE_OR##w(SUPEREAGLE_EQ##w(color3, colorA2), \
+                     SUPEREAGLE_EQ##w(color4, color5)), \
+                  SUPEREAGLE_VINTERP(w, color5, interp25), interp23), \
+            SUPEREAGLE_SEL##w(rneg, interp56, \
+            SUPEREAGLE_SEL##w(br3, color2, \
+               SUPEREAGLE_VINTERP3(w, color2, interp53))))); \
+      vec_t product2b = SUPEREAGLE_SEL##w(br1, \
+               SUPEREAGLE_SEL##w(SUPEREAGLE_OR##w(SUPEREAGLE_EQ##w(color6, colorS2), \
+                     SUPEREAGLE_EQ##w(color2, colorA1)), \
+                  SUPEREAGLE_VINTERP(w, color2, interp23), interp23), \
+            SUPEREAGLE_SEL##w(br2, color5, \
+            SUPEREAGLE_SEL##w(rpos, interp56, \
+            SUPEREAGLE_SEL##w(br3, color5, \
+               SUPEREAGLE_VINTERP3(w, color3, interp26))))); \
+      \
+      SUPEREAGLE_STORE2_##w(out + (x << 1), product1a, product1b); \
+      SUPEREAGLE_STORE2_##w(out + dst_stride + (x << 1), product2a, product2b); \
+   } \
+   return x; \
+}
+
+SUPEREAGLE_ROW_SIMD(supereagle_row_simd_rgb565, uint16_t,
+      SUPEREAGLE_VEC16, 16, 8, 0xF7DE, 0x0821, 0xE79C, 0x1863)
+SUPEREAGLE_ROW_SIMD(supereagle_row_simd_xrgb8888, uint32_t,
+      SUPEREAGLE_VEC32, 32, 4, 0xFEFEFEFE, 0x01010101, 0xFCFCFCFC, 0x03030303)
+#else
+#define supereagle_row_simd_rgb565(in, width, nextline, out, dst_stride) 0
+#define supereagle_row_simd_xrgb8888(in, width, nextline, out, dst_stride) 0
+#endif
+
 static void supereagle_generic_xrgb8888(unsigned width, unsigned height,
-      int first, int last, uint32_t *src,
+      int first, int last, int simd, uint32_t *src,
       unsigned src_stride, uint32_t *dst, unsigned dst_stride)
 {
    unsigned finish;
@@ -226,7 +440,17 @@ static void supereagle_generic_xrgb8888(unsigned width, unsigned height,
       uint32_t *in  = (uint32_t*)src;
       uint32_t *out = (uint32_t*)dst;
 
-      for (finish = width; finish; finish -= 1)
+      finish = width;
+      if (simd)
+      {
+         unsigned done = supereagle_row_simd_xrgb8888(in, width,
+               nextline, out, dst_stride);
+         in     += done;
+         out    += done << 1;
+         finish -= done;
+      }
+
+      for (; finish; finish -= 1)
       {
          supereagle_declare_variables(uint32_t, in, nextline);
 
@@ -239,7 +463,7 @@ static void supereagle_generic_xrgb8888(unsigned width, unsigned height,
 }
 
 static void supereagle_generic_rgb565(unsigned width, unsigned height,
-      int first, int last, uint16_t *src,
+      int first, int last, int simd, uint16_t *src,
       unsigned src_stride, uint16_t *dst, unsigned dst_stride)
 {
    unsigned finish;
@@ -250,7 +474,17 @@ static void supereagle_generic_rgb565(unsigned width, unsigned height,
       uint16_t *in  = (uint16_t*)src;
       uint16_t *out = (uint16_t*)dst;
 
-      for (finish = width; finish; finish -= 1)
+      finish = width;
+      if (simd)
+      {
+         unsigned done = supereagle_row_simd_rgb565(in, width,
+               nextline, out, dst_stride);
+         in     += done;
+         out    += done << 1;
+         finish -= done;
+      }
+
+      for (; finish; finish -= 1)
       {
          supereagle_declare_variables(uint16_t, in, nextline);
 
@@ -271,7 +505,7 @@ static void supereagle_work_cb_rgb565(void *data, void *thread_data)
    unsigned height = thr->height;
 
    supereagle_generic_rgb565(width, height,
-         thr->first, thr->last, input,
+         thr->first, thr->last, thr->simd & SUPEREAGLE_SIMD, input,
             (unsigned)(thr->in_pitch / SOFTFILTER_BPP_RGB565),
             output,
             (unsigned)(thr->out_pitch / SOFTFILTER_BPP_RGB565));
@@ -286,7 +520,7 @@ static void supereagle_work_cb_xrgb8888(void *data, void *thread_data)
    unsigned height = thr->height;
 
    supereagle_generic_xrgb8888(width, height,
-         thr->first, thr->last, input,
+         thr->first, thr->last, thr->simd & SUPEREAGLE_SIMD, input,
         (unsigned)(thr->in_pitch / SOFTFILTER_BPP_XRGB8888),
         output,
         (unsigned)(thr->out_pitch / SOFTFILTER_BPP_XRGB8888));
@@ -312,6 +546,7 @@ static void supereagle_generic_packets(void *data,
       thr->in_pitch = input_stride;
       thr->width = width;
       thr->height = y_end - y_start;
+      thr->simd = filt->simd;
 
       /* Workers need to know if they can access pixels outside their given buffer. */
       thr->first = y_start;
@@ -351,3 +586,7 @@ const struct softfilter_implementation *softfilter_get_implementation(softfilter
 #undef softfilter_thread_data
 #undef filter_data
 #endif
+
+#undef SUPEREAGLE_SSE2
+#undef SUPEREAGLE_NEON
+#undef SUPEREAGLE_SIMD
@@ -1269,6 +1269,7 @@ THREAD
 #endif
 
 #include "../libretro-common/rthreads/rthreads.c"
+#include "../libretro-common/rthreads/tpool.c"
 #include "../gfx/video_thread_wrapper.c"
 #include "../audio/audio_thread_wrapper.c"
 #endif
@@ -1284,6 +1285,8 @@ NETPLAY
 #include "../network/netplay/netplay_handshake.c"
 #include "../network/netplay/netplay_init.c"
 #include "../network/netplay/netplay_io.c"
+#include "../network/netplay/netplay_io_thread.c"
+#include "../network/netplay/netplay_relay.c"
 #include "../network/netplay/netplay_keyboard.c"
 #include "../network/netplay/netplay_sync.c"
 #include "../network/netplay/netplay_discovery.c"
@@ -1319,6 +1322,8 @@ DATA RUNLOOP
 #include "../tasks/task_playlist_manager.c"
 #include "../tasks/task_manual_content_scan.c"
 #include "../tasks/task_core_backup.c"
+#include "../tasks/task_dir_list.c"
+#include "../tasks/task_playlist_write.c"
 #ifdef HAVE_ZLIB
 #include "../tasks/task_decompress.c"
 #endif
@@ -1540,7 +1545,6 @@ XML
  LIBRETRODB
 ============================================================ */
 #ifdef HAVE_LIBRETRODB
-#include "../libretro-db/bintree.c"
 #include "../libretro-db/libretrodb.c"
 #include "../libretro-db/rmsgpack.c"
 #include "../libretro-db/rmsgpack_dom.c"
@@ -504,37 +504,71 @@ struct string_list *file_archive_get_file_list(const char *path,
    return userdata.list;
 }
 
-bool file_archive_perform_mode(const char *path, const char *valid_exts,
+bool file_archive_extract_member(file_archive_transfer_t *state,
+      void *context, const char *path,
       const uint8_t *cdata, unsigned cmode, uint32_t csize, uint32_t size,
-      uint32_t crc32, struct archive_extract_userdata *userdata)
+      uint32_t crc32)
 {
    file_archive_file_handle_t handle;
    int ret;
 
-   if (!userdata->transfer || !userdata->transfer->backend)
+   if (!state || !state->backend || !context)
       return false;
 
    handle.data          = NULL;
    handle.real_checksum = 0;
 
-   if (!userdata->transfer->backend->stream_decompress_data_to_file_init(
-            userdata->transfer->context, &handle, cdata, cmode, csize, size))
+   if (!state->backend->stream_decompress_data_to_file_init(
+            context, &handle, cdata, cmode, csize, size))
       return false;
 
    do
    {
-      ret = userdata->transfer->backend->stream_decompress_data_to_file_iterate(
-               userdata->transfer->context, &handle);
+      ret = state->backend->stream_decompress_data_to_file_iterate(
+               context, &handle);
    }while (ret == 0);
 
    if (ret == -1 || !file_archive_decompress_data_to_file(
-            userdata->transfer, &handle, path,
+            state, &handle, path,
             size, crc32))
       return false;
 
    return true;
 }
 
+bool file_archive_perform_mode(const char *path, const char *valid_exts,
+      const uint8_t *cdata, unsigned cmode, uint32_t csize, uint32_t size,
+      uint32_t crc32, struct archive_extract_userdata *userdata)
+{
+   if (!userdata->transfer)
+      return false;
+
+   return file_archive_extract_member(userdata->transfer,
+         userdata->transfer->context, path,
+         cdata, cmode, csize, size, crc32);
+}
+
+void *file_archive_stream_context_new(file_archive_transfer_t *state)
+{
+   if (     !state
+         || !state->backend
+         || !state->backend->stream_context_new
+         || state->type != ARCHIVE_TRANSFER_ITERATE)
+      return NULL;
+
+   return state->backend->stream_context_new(state);
+}
+
+void file_archive_stream_context_free(file_archive_transfer_t *state,
+      void *context)
+{
+   if (!context || !state || !state->backend)
+      return;
+
+   if (state->backend->stream_context_free)
+      state->backend->stream_context_free(context);
+}
+
 /**
  * file_archive_filename_split:
  * @str              : filename to turn into a string list
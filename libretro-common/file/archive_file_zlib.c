@@ -41,6 +41,13 @@
 #define END_OF_CENTRAL_DIR_SIGNATURE 0x06054b50
 #endif
 
+/* Deflated members that are not memory mapped are read
+ * and inflated in chunks of this size, instead of reading
+ * the whole compressed member before inflating it. */
+#ifndef ZIP_STREAM_CHUNK_SIZE
+#define ZIP_STREAM_CHUNK_SIZE (256 * 1024)
+#endif
+
 enum file_archive_compression_mode
 {
    ZIP_MODE_STORED   = 0,
@@ -56,6 +63,9 @@ typedef struct
    void    *current_stream;
    uint8_t *compressed_data;
    uint8_t *decompressed_data;
+   int64_t  compressed_offset;    /* next chunk to read from the archive */
+   uint32_t compressed_remaining; /* bytes of the member not read yet */
+   uint32_t compressed_available; /* bytes of the current chunk not inflated yet */
 } zip_context_t;
 
 static INLINE uint32_t read_le(const uint8_t *data, unsigned size)
@@ -128,6 +138,9 @@ static bool zlib_stream_decompress_data_to_file_init(
    offsetEL = read_le(local_header + 2, 2); /* extra field length */
    offsetData = (int64_t)(size_t)cdata + 26 + 4 + offsetNL + offsetEL;
 
+   zip_context->compressed_remaining = 0;
+   zip_context->compressed_available = csize;
+
 #ifdef HAVE_MMAP
    if (state->archive_mmap_data)
    {
@@ -136,15 +149,27 @@ static bool zlib_stream_decompress_data_to_file_init(
    else
 #endif
    {
+      /* Stored members are handed out as they are, so they
+       * have to be read in full. Deflated members are only
+       * read one chunk ahead of the decompressor. */
+      uint32_t read_size = csize;
+
+      if (cmode == ZIP_MODE_DEFLATED && read_size > ZIP_STREAM_CHUNK_SIZE)
+         read_size = ZIP_STREAM_CHUNK_SIZE;
+
       /* allocate memory for the compressed data */
-      zip_context->compressed_data = (uint8_t*)malloc(csize);
+      zip_context->compressed_data = (uint8_t*)malloc(read_size);
       if (!zip_context->compressed_data)
          goto error;
 
       /* skip over name and extra data */
       filestream_seek(state->archive_file, offsetData, RETRO_VFS_SEEK_POSITION_START);
-      if (filestream_read(state->archive_file, zip_context->compressed_data, csize) != csize)
+      if (filestream_read(state->archive_file, zip_context->compressed_data, read_size) != read_size)
          goto error;
+
+      zip_context->compressed_offset    = offsetData + read_size;
+      zip_context->compressed_remaining = csize - read_size;
+      zip_context->compressed_available = read_size;
    }
 
    switch (cmode)
@@ -167,7 +192,8 @@ static bool zlib_stream_decompress_data_to_file_init(
             goto error;
 
          zlib_inflate_backend.set_in(zip_context->current_stream,
-               zip_context->compressed_data, csize);
+               zip_context->compressed_data,
+               zip_context->compressed_available);
          zlib_inflate_backend.set_out(zip_context->current_stream,
                zip_context->decompressed_data, size);
 
@@ -210,6 +236,35 @@ static int zlib_stream_decompress_data_to_file_iterate(
       return -1;
    }
 
+   zip_context->compressed_available -= rd;
+
+   /* Current chunk fully inflated, read the next one */
+   if (     zip_context->compressed_available == 0
+         && zip_context->compressed_remaining  > 0)
+   {
+      struct file_archive_transfer *state = zip_context->state;
+      uint32_t read_size                  = zip_context->compressed_remaining;
+
+      if (read_size > ZIP_STREAM_CHUNK_SIZE)
+         read_size = ZIP_STREAM_CHUNK_SIZE;
+
+      filestream_seek(state->archive_file, zip_context->compressed_offset,
+            RETRO_VFS_SEEK_POSITION_START);
+      if (filestream_read(state->archive_file,
+               zip_context->compressed_data, read_size) != read_size)
+      {
+         zip_context_free_stream(zip_context, false);
+         return -1;
+      }
+
+      zip_context->compressed_offset    += read_size;
+      zip_context->compressed_remaining -= read_size;
+      zip_context->compressed_available  = read_size;
+
+      zlib_inflate_backend.set_in(zip_context->current_stream,
+            zip_context->compressed_data, read_size);
+   }
+
    /* still more data to process */
    return 0;
 }
@@ -292,12 +347,18 @@ static int zip_file_decompressed(
       if (zip_file_decompressed_handle(userdata->transfer,
                &handle, cdata, cmode, csize, size, crc32))
       {
+         zip_context_t *zip_context = (zip_context_t*)
+            userdata->transfer->context;
+
+         /* handle.data is owned by the zip context - it is
+          * either the decompressed data or, for stored members,
+          * the compressed data (which may point into the archive
+          * mapping). Both are released along with the context. */
          if (decomp_state->opt_file != 0)
          {
             /* Called in case core has need_fullpath enabled. */
             bool success = filestream_write_file(decomp_state->opt_file, handle.data, size);
 
-            free(handle.data);
             handle.data = NULL;
 
             decomp_state->size = 0;
@@ -310,6 +371,19 @@ static int zip_file_decompressed(
             /* Called in case core has need_fullpath disabled.
              * Will move decompressed content directly into
              * RetroArch's ROM buffer. */
+            if (handle.data == zip_context->decompressed_data)
+               zip_context->decompressed_data = NULL;
+            else
+            {
+               uint8_t *data = (uint8_t*)malloc(size);
+
+               if (!data)
+                  return -1;
+
+               memcpy(data, handle.data, size);
+               handle.data = data;
+            }
+
             *decomp_state->buf = handle.data;
             handle.data = NULL;
 
@@ -328,12 +402,16 @@ static int64_t zip_file_read(
       const char *needle, void **buf,
       const char *optional_outfile)
 {
-   file_archive_transfer_t state            = {ARCHIVE_TRANSFER_INIT};
+   file_archive_transfer_t state            = {0};
    decomp_state_t decomp                    = {0};
    struct archive_extract_userdata userdata = {0};
    bool returnerr                           = true;
    int ret                                  = 0;
 
+   /* 'type' is not the first member of the transfer
+    * struct, so it cannot be set in the initializer */
+   state.type                = ARCHIVE_TRANSFER_INIT;
+
    if (needle)
       decomp.needle          = strdup(needle);
    if (optional_outfile)
@@ -427,6 +505,9 @@ static int zip_parse_file_init(file_archive_transfer_t *state,
    zip_context->current_stream    = NULL;
    zip_context->compressed_data   = NULL;
    zip_context->decompressed_data = NULL;
+   zip_context->compressed_offset    = 0;
+   zip_context->compressed_remaining = 0;
+   zip_context->compressed_available = 0;
 
    filestream_seek(state->archive_file, directory_offset, RETRO_VFS_SEEK_POSITION_START);
    if (filestream_read(state->archive_file, zip_context->directory, directory_size) != directory_size)
@@ -517,6 +598,30 @@ static void zip_parse_file_free(void *context)
    free(zip_context);
 }
 
+/* Additional decompression contexts only share the archive
+ * mapping, which is read-only, so they can be used from
+ * several threads at once. Without a mapping all members
+ * are read through the single archive file handle. */
+static void *zip_stream_context_new(struct file_archive_transfer *state)
+{
+#ifdef HAVE_MMAP
+   zip_context_t *zip_context = NULL;
+
+   if (!state->archive_mmap_data)
+      return NULL;
+
+   zip_context = (zip_context_t*)calloc(1, sizeof(*zip_context));
+   if (!zip_context)
+      return NULL;
+
+   zip_context->state = state;
+
+   return zip_context;
+#else
+   return NULL;
+#endif
+}
+
 const struct file_archive_file_backend zlib_backend = {
    zip_parse_file_init,
    zip_parse_file_iterate_step,
@@ -525,5 +630,7 @@ const struct file_archive_file_backend zlib_backend = {
    zlib_stream_decompress_data_to_file_iterate,
    zlib_stream_crc32_calculate,
    zip_file_read,
+   zip_stream_context_new,
+   zip_parse_file_free,
    "zlib"
 };
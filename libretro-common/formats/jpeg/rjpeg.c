@@ -35,6 +35,23 @@
 #include <formats/rjpeg.h>
 #include <features/features_cpu.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#include <rthreads/tpool.h>
+
+/* Upper bound on the number of threads a single
+ * image is decoded with */
+#define RJPEG_MAX_THREADS          8
+
+/* Baseline scans need at least this many MCUs per
+ * thread to have their restart intervals decoded
+ * in parallel */
+#define RJPEG_THREAD_MIN_MCUS      256
+
+/* Same for rows of resampling/color conversion */
+#define RJPEG_THREAD_MIN_ROWS      64
+#endif
+
 enum
 {
    RJPEG_DEFAULT = 0, /* only used for req_comp */
@@ -1329,83 +1346,415 @@ static void rjpeg_jpeg_reset(rjpeg_jpeg *j)
     * since we don't even allow 1<<30 pixels */
 }
 
-static int rjpeg_parse_entropy_coded_data(rjpeg_jpeg *z)
+/* Decodes 'count' MCUs of a baseline scan, starting
+ * with MCU number 'mcu'. Returns 0 on error, 1 if a
+ * restart interval isn't followed by a restart marker
+ * (decoding of the scan stops there) and 2 otherwise */
+static int rjpeg_decode_baseline_mcus(rjpeg_jpeg *z, int mcu, int count)
 {
-   rjpeg_jpeg_reset(z);
+   RJPEG_SIMD_ALIGN(short, data[64]);
 
    if (z->scan_n == 1)
    {
-      int i, j;
       int n = z->order[0];
       int w = (z->img_comp[n].x+7) >> 3;
-      int h = (z->img_comp[n].y+7) >> 3;
+      int i = mcu % w;
+      int j = mcu / w;
 
       /* non-interleaved data, we just need to process one block at a time,
        * in trivial scanline order
        * number of blocks to do just depends on how many actual "pixels" this
        * component has, independent of interleaved MCU blocking and such */
+      while (count-- > 0)
+      {
+         int ha = z->img_comp[n].ha;
+         if (!rjpeg_jpeg_decode_block(z, data, z->huff_dc+z->img_comp[n].hd,
+                  z->huff_ac+ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq]))
+            return 0;
+
+         z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*j*8+i*8,
+               z->img_comp[n].w2, data);
+
+         /* every data block is an MCU, so countdown the restart interval */
+         if (--z->todo <= 0)
+         {
+            if (z->code_bits < 24)
+               rjpeg_grow_buffer_unsafe(z);
+
+            /* if it's NOT a restart, then just bail,
+             * so we get corrupt data rather than no data */
+            if (!RJPEG_RESTART(z->marker))
+               return 1;
+            rjpeg_jpeg_reset(z);
+         }
+
+         if (++i >= w)
+         {
+            i = 0;
+            j++;
+         }
+      }
+   }
+   else
+   {
+      /* interleaved */
+      int k,x,y;
+      int i = mcu % z->img_mcu_x;
+      int j = mcu / z->img_mcu_x;
 
-      if (z->progressive)
+      while (count-- > 0)
       {
-         for (j = 0; j < h; ++j)
+         /* scan an interleaved MCU... process scan_n components in order */
+         for (k = 0; k < z->scan_n; ++k)
          {
-            for (i = 0; i < w; ++i)
+            int n = z->order[k];
+            /* scan out an MCU's worth of this component; that's just determined
+             * by the basic H and V specified for the component */
+            for (y = 0; y < z->img_comp[n].v; ++y)
             {
-               short *data = z->img_comp[n].coeff + 64 * (i + j * z->img_comp[n].coeff_w);
-
-               if (z->spec_start == 0)
-               {
-                  if (!rjpeg_jpeg_decode_block_prog_dc(z, data, &z->huff_dc[z->img_comp[n].hd], n))
-                     return 0;
-               }
-               else
+               for (x = 0; x < z->img_comp[n].h; ++x)
                {
+                  int x2 = (i*z->img_comp[n].h + x)*8;
+                  int y2 = (j*z->img_comp[n].v + y)*8;
                   int ha = z->img_comp[n].ha;
-                  if (!rjpeg_jpeg_decode_block_prog_ac(z, data, &z->huff_ac[ha], z->fast_ac[ha]))
-                     return 0;
-               }
 
-               /* every data block is an MCU, so countdown the restart interval */
-               if (--z->todo <= 0)
-               {
-                  if (z->code_bits < 24)
-                     rjpeg_grow_buffer_unsafe(z);
+                  if (!rjpeg_jpeg_decode_block(z, data,
+                           z->huff_dc+z->img_comp[n].hd,
+                           z->huff_ac+ha, z->fast_ac[ha],
+                           n, z->dequant[z->img_comp[n].tq]))
+                     return 0;
 
-                  if (!RJPEG_RESTART(z->marker))
-                     return 1;
-                  rjpeg_jpeg_reset(z);
+                  z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*y2+x2,
+                        z->img_comp[n].w2, data);
                }
             }
          }
+
+         /* after all interleaved components, that's an interleaved MCU,
+          * so now count down the restart interval */
+         if (--z->todo <= 0)
+         {
+            if (z->code_bits < 24)
+               rjpeg_grow_buffer_unsafe(z);
+            if (!RJPEG_RESTART(z->marker))
+               return 1;
+            rjpeg_jpeg_reset(z);
+         }
+
+         if (++i >= z->img_mcu_x)
+         {
+            i = 0;
+            j++;
+         }
+      }
+   }
+
+   return 2;
+}
+
+#ifdef HAVE_THREADS
+typedef void (*rjpeg_job_func)(void *userdata, unsigned index);
+
+typedef struct
+{
+   rjpeg_job_func func;
+   void *userdata;
+   slock_t *lock;
+   scond_t *cond;
+   unsigned pending;          /* (under lock) */
+} rjpeg_job_batch;
+
+typedef struct
+{
+   rjpeg_job_batch *batch;
+   unsigned index;
+} rjpeg_job;
+
+static void rjpeg_job_thread(void *data)
+{
+   rjpeg_job *job         = (rjpeg_job*)data;
+   rjpeg_job_batch *batch = job->batch;
+
+   batch->func(batch->userdata, job->index);
+
+   slock_lock(batch->lock);
+   if (--batch->pending == 0)
+      scond_signal(batch->cond);
+   slock_unlock(batch->lock);
+}
+
+/* Runs func(userdata, 0 .. count - 1) on the shared
+ * thread pool. Index 0 runs on the calling thread, as
+ * does every job if there is no pool */
+static void rjpeg_run_jobs(rjpeg_job_func func, void *userdata,
+      unsigned count)
+{
+   unsigned i;
+   rjpeg_job_batch batch;
+   rjpeg_job jobs[RJPEG_MAX_THREADS];
+   tpool_t *pool    = tpool_shared();
+
+   batch.func       = func;
+   batch.userdata   = userdata;
+   batch.lock       = NULL;
+   batch.cond       = NULL;
+   batch.pending    = 0;
+
+   if (     !pool
+         || !(batch.lock = slock_new())
+         || !(batch.cond = scond_new()))
+   {
+      if (batch.lock)
+         slock_free(batch.lock);
+      for (i = 0; i < count; i++)
+         func(userdata, i);
+      return;
+   }
+
+   batch.pending = count - 1;
+
+   for (i = 1; i < count; i++)
+   {
+      jobs[i].batch = &batch;
+      jobs[i].index = i;
+      if (!tpool_add_work(pool, rjpeg_job_thread, &jobs[i]))
+         rjpeg_job_thread(&jobs[i]);
+   }
+
+   func(userdata, 0);
+
+   slock_lock(batch.lock);
+   while (batch.pending)
+      scond_wait(batch.cond, batch.lock);
+   slock_unlock(batch.lock);
+
+   scond_free(batch.cond);
+   slock_free(batch.lock);
+}
+
+/* Number of threads to split 'units' units of work
+ * over, given at least 'min_units' per thread */
+static unsigned rjpeg_thread_count(unsigned units, unsigned min_units)
+{
+   unsigned count = (unsigned)tpool_get_thread_count(tpool_shared());
+
+   if (count > RJPEG_MAX_THREADS)
+      count = RJPEG_MAX_THREADS;
+   if (count > units / min_units)
+      count = units / min_units;
+
+   return count ? count : 1;
+}
+
+typedef struct
+{
+   rjpeg_jpeg *z;
+   rjpeg_jpeg *decoders[RJPEG_MAX_THREADS];
+   rjpeg_context contexts[RJPEG_MAX_THREADS];
+   uint8_t **starts;
+   int *status;
+   int segments;
+   int mcus;
+   unsigned threads;
+} rjpeg_restart_job;
+
+static void rjpeg_restart_job_func(void *userdata, unsigned index)
+{
+   int seg;
+   rjpeg_restart_job *job = (rjpeg_restart_job*)userdata;
+   rjpeg_jpeg *z          = job->decoders[index];
+
+   for (seg = index; seg < job->segments; seg += job->threads)
+   {
+      int mcu   = seg * z->restart_interval;
+      int count = job->mcus - mcu;
+
+      if (count > z->restart_interval)
+         count  = z->restart_interval;
+
+      z->s->img_buffer = job->starts[seg];
+      rjpeg_jpeg_reset(z);
+      job->status[seg] = rjpeg_decode_baseline_mcus(z, mcu, count);
+   }
+}
+
+/* Restart intervals of a baseline scan are independent
+ * of each other, so once their start in the stream is
+ * known they can be decoded in parallel. The outcome
+ * (and position in the stream) is the same as decoding
+ * the intervals one after another - the interval that
+ * decoding would have stopped at is redone serially.
+ * Returns -1 if the scan isn't suitable, in which case
+ * nothing has been decoded yet */
+static int rjpeg_parse_baseline_threaded(rjpeg_jpeg *z, int mcus)
+{
+   int i, seg, ret;
+   rjpeg_restart_job job;
+   uint8_t *p        = z->s->img_buffer;
+   uint8_t *end      = z->s->img_buffer_end;
+   int segments      = (mcus + z->restart_interval - 1) / z->restart_interval;
+   unsigned threads  = rjpeg_thread_count(mcus, RJPEG_THREAD_MIN_MCUS);
+   int found         = 1;
+
+   if (threads < 2 || segments < 2)
+      return -1;
+
+   job.starts = (uint8_t**)malloc(segments * sizeof(*job.starts));
+   job.status = (int*)malloc(segments * sizeof(*job.status));
+   if (!job.starts || !job.status)
+      goto fallback;
+
+   /* Find the restart markers. These have to appear in
+    * sequence, and the scan has to end with a different
+    * marker - anything else is left to the serial path */
+   job.starts[0] = p;
+   while (p + 1 < end)
+   {
+      if (*p++ != 0xff)
+         continue;
+      if (*p == 0x00)
+      {
+         p++;
+         continue;
+      }
+      if (*p == 0xff)
+         goto fallback;
+      if (!RJPEG_RESTART(*p))
+         break;
+      if (found == segments || *p != 0xd0 + ((found - 1) & 7))
+         goto fallback;
+      job.starts[found++] = ++p;
+   }
+
+   if (found != segments)
+      goto fallback;
+
+   if (threads > (unsigned)segments)
+      threads     = segments;
+   job.z          = z;
+   job.segments   = segments;
+   job.mcus       = mcus;
+   job.threads    = threads;
+   job.decoders[0] = z;
+
+   for (i = 1; i < (int)threads; i++)
+   {
+      if (!(job.decoders[i] = (rjpeg_jpeg*)malloc(sizeof(*z))))
+      {
+         job.threads = i;
+         break;
+      }
+      memcpy(job.decoders[i], z, sizeof(*z));
+      job.contexts[i]      = *z->s;
+      job.decoders[i]->s   = &job.contexts[i];
+   }
+
+   rjpeg_run_jobs(rjpeg_restart_job_func, &job, job.threads);
+
+   for (i = 1; i < (int)job.threads; i++)
+      free(job.decoders[i]);
+
+   for (seg = 0; seg < segments - 1; seg++)
+      if (job.status[seg] != 2)
+         break;
+
+   /* Redo the interval the scan ended with, so that
+    * the decoder state is left where the serial path
+    * would leave it */
+   ret = 0;
+   if (job.status[seg])
+   {
+      int mcu   = seg * z->restart_interval;
+      int count = mcus - mcu;
+
+      if (count > z->restart_interval)
+         count  = z->restart_interval;
+
+      z->s->img_buffer = job.starts[seg];
+      rjpeg_jpeg_reset(z);
+      ret = rjpeg_decode_baseline_mcus(z, mcu, count) != 0;
+   }
+
+   free(job.starts);
+   free(job.status);
+   return ret;
+
+fallback:
+   if (job.starts)
+      free(job.starts);
+   if (job.status)
+      free(job.status);
+   return -1;
+}
+#endif
+
+static int rjpeg_parse_entropy_coded_data(rjpeg_jpeg *z)
+{
+   rjpeg_jpeg_reset(z);
+
+   if (!z->progressive)
+   {
+      int mcus;
+
+      if (z->scan_n == 1)
+      {
+         int n = z->order[0];
+         mcus  = ((z->img_comp[n].x+7) >> 3) * ((z->img_comp[n].y+7) >> 3);
       }
       else
+         mcus  = z->img_mcu_x * z->img_mcu_y;
+
+#ifdef HAVE_THREADS
+      if (z->restart_interval)
       {
-         RJPEG_SIMD_ALIGN(short, data[64]);
+         int ret = rjpeg_parse_baseline_threaded(z, mcus);
+         if (ret >= 0)
+            return ret;
+      }
+#endif
+
+      return rjpeg_decode_baseline_mcus(z, 0, mcus) != 0;
+   }
+
+   if (z->scan_n == 1)
+   {
+      int i, j;
+      int n = z->order[0];
+      int w = (z->img_comp[n].x+7) >> 3;
+      int h = (z->img_comp[n].y+7) >> 3;
+
+      /* non-interleaved data, we just need to process one block at a time,
+       * in trivial scanline order
+       * number of blocks to do just depends on how many actual "pixels" this
+       * component has, independent of interleaved MCU blocking and such */
 
-         for (j = 0; j < h; ++j)
+      for (j = 0; j < h; ++j)
+      {
+         for (i = 0; i < w; ++i)
          {
-            for (i = 0; i < w; ++i)
+            short *data = z->img_comp[n].coeff + 64 * (i + j * z->img_comp[n].coeff_w);
+
+            if (z->spec_start == 0)
+            {
+               if (!rjpeg_jpeg_decode_block_prog_dc(z, data, &z->huff_dc[z->img_comp[n].hd], n))
+                  return 0;
+            }
+            else
             {
                int ha = z->img_comp[n].ha;
-               if (!rjpeg_jpeg_decode_block(z, data, z->huff_dc+z->img_comp[n].hd,
-                        z->huff_ac+ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq]))
+               if (!rjpeg_jpeg_decode_block_prog_ac(z, data, &z->huff_ac[ha], z->fast_ac[ha]))
                   return 0;
+            }
 
-               z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*j*8+i*8,
-                     z->img_comp[n].w2, data);
+            /* every data block is an MCU, so countdown the restart interval */
+            if (--z->todo <= 0)
+            {
+               if (z->code_bits < 24)
+                  rjpeg_grow_buffer_unsafe(z);
 
-               /* every data block is an MCU, so countdown the restart interval */
-               if (--z->todo <= 0)
-               {
-                  if (z->code_bits < 24)
-                     rjpeg_grow_buffer_unsafe(z);
-
-                  /* if it's NOT a restart, then just bail,
-                   * so we get corrupt data rather than no data */
-                  if (!RJPEG_RESTART(z->marker))
-                     return 1;
-                  rjpeg_jpeg_reset(z);
-               }
+               if (!RJPEG_RESTART(z->marker))
+                  return 1;
+               rjpeg_jpeg_reset(z);
             }
          }
       }
@@ -1415,88 +1764,38 @@ static int rjpeg_parse_entropy_coded_data(rjpeg_jpeg *z)
       /* interleaved */
       int i,j,k,x,y;
 
-      if (z->progressive)
+      for (j = 0; j < z->img_mcu_y; ++j)
       {
-         for (j = 0; j < z->img_mcu_y; ++j)
+         for (i = 0; i < z->img_mcu_x; ++i)
          {
-            for (i = 0; i < z->img_mcu_x; ++i)
+            /* scan an interleaved MCU... process scan_n components in order */
+            for (k = 0; k < z->scan_n; ++k)
             {
-               /* scan an interleaved MCU... process scan_n components in order */
-               for (k = 0; k < z->scan_n; ++k)
+               int n = z->order[k];
+               /* scan out an MCU's worth of this component; that's just determined
+                * by the basic H and V specified for the component */
+               for (y = 0; y < z->img_comp[n].v; ++y)
                {
-                  int n = z->order[k];
-                  /* scan out an MCU's worth of this component; that's just determined
-                   * by the basic H and V specified for the component */
-                  for (y = 0; y < z->img_comp[n].v; ++y)
+                  for (x = 0; x < z->img_comp[n].h; ++x)
                   {
-                     for (x = 0; x < z->img_comp[n].h; ++x)
-                     {
-                        int      x2 = (i*z->img_comp[n].h + x);
-                        int      y2 = (j*z->img_comp[n].v + y);
-                        short *data = z->img_comp[n].coeff + 64 * (x2 + y2 * z->img_comp[n].coeff_w);
-                        if (!rjpeg_jpeg_decode_block_prog_dc(z, data, &z->huff_dc[z->img_comp[n].hd], n))
-                           return 0;
-                     }
+                     int      x2 = (i*z->img_comp[n].h + x);
+                     int      y2 = (j*z->img_comp[n].v + y);
+                     short *data = z->img_comp[n].coeff + 64 * (x2 + y2 * z->img_comp[n].coeff_w);
+                     if (!rjpeg_jpeg_decode_block_prog_dc(z, data, &z->huff_dc[z->img_comp[n].hd], n))
+                        return 0;
                   }
                }
-
-               /* after all interleaved components, that's an interleaved MCU,
-                * so now count down the restart interval */
-               if (--z->todo <= 0)
-               {
-                  if (z->code_bits < 24)
-                     rjpeg_grow_buffer_unsafe(z);
-                  if (!RJPEG_RESTART(z->marker))
-                     return 1;
-                  rjpeg_jpeg_reset(z);
-               }
             }
-         }
-      }
-      else
-      {
-         RJPEG_SIMD_ALIGN(short, data[64]);
 
-         for (j = 0; j < z->img_mcu_y; ++j)
-         {
-            for (i = 0; i < z->img_mcu_x; ++i)
+            /* after all interleaved components, that's an interleaved MCU,
+             * so now count down the restart interval */
+            if (--z->todo <= 0)
             {
-               /* scan an interleaved MCU... process scan_n components in order */
-               for (k = 0; k < z->scan_n; ++k)
-               {
-                  int n = z->order[k];
-                  /* scan out an MCU's worth of this component; that's just determined
-                   * by the basic H and V specified for the component */
-                  for (y = 0; y < z->img_comp[n].v; ++y)
-                  {
-                     for (x = 0; x < z->img_comp[n].h; ++x)
-                     {
-                        int x2 = (i*z->img_comp[n].h + x)*8;
-                        int y2 = (j*z->img_comp[n].v + y)*8;
-                        int ha = z->img_comp[n].ha;
-
-                        if (!rjpeg_jpeg_decode_block(z, data,
-                                 z->huff_dc+z->img_comp[n].hd,
-                                 z->huff_ac+ha, z->fast_ac[ha],
-                                 n, z->dequant[z->img_comp[n].tq]))
-                           return 0;
-
-                        z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*y2+x2,
-                              z->img_comp[n].w2, data);
-                     }
-                  }
-               }
-
-               /* after all interleaved components, that's an interleaved MCU,
-                * so now count down the restart interval */
-               if (--z->todo <= 0)
-               {
-                  if (z->code_bits < 24)
-                     rjpeg_grow_buffer_unsafe(z);
-                  if (!RJPEG_RESTART(z->marker))
-                     return 1;
-                  rjpeg_jpeg_reset(z);
-               }
+               if (z->code_bits < 24)
+                  rjpeg_grow_buffer_unsafe(z);
+               if (!RJPEG_RESTART(z->marker))
+                  return 1;
+               rjpeg_jpeg_reset(z);
             }
          }
       }
@@ -2430,14 +2729,167 @@ static void rjpeg_cleanup_jpeg(rjpeg_jpeg *j)
    }
 }
 
+/* Moves the resampler of component 'k' down by 'rows' output rows */
+static void rjpeg_resample_advance(rjpeg_jpeg *z, rjpeg_resample *r,
+      int k, unsigned rows)
+{
+   while (rows--)
+   {
+      if (++r->ystep >= r->vs)
+      {
+         r->ystep = 0;
+         r->line0 = r->line1;
+         if (++r->ypos < z->img_comp[k].y)
+            r->line1 += z->img_comp[k].w2;
+      }
+   }
+}
+
+/* Resamples and color converts output rows 'j' .. 'j_end' - 1 */
+static void rjpeg_resample_rows(rjpeg_jpeg *z, rjpeg_resample *res_comp,
+      uint8_t **linebuf, uint8_t *output, int n, int decode_n,
+      unsigned j, unsigned j_end)
+{
+   int k;
+   unsigned int i;
+   uint8_t *coutput[4] = {0};
+
+   for (; j < j_end; ++j)
+   {
+      uint8_t *out = output + n * z->s->img_x * j;
+      for (k = 0; k < decode_n; ++k)
+      {
+         rjpeg_resample *r = &res_comp[k];
+         int         y_bot  = r->ystep >= (r->vs >> 1);
+
+         coutput[k]         = r->resample(linebuf[k],
+               y_bot ? r->line1 : r->line0,
+               y_bot ? r->line0 : r->line1,
+               r->w_lores, r->hs);
+
+         rjpeg_resample_advance(z, r, k, 1);
+      }
+
+      if (n >= 3)
+      {
+         uint8_t *y = coutput[0];
+         if (y)
+         {
+            if (z->s->img_n == 3)
+               z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
+            else
+               for (i = 0; i < z->s->img_x; ++i)
+               {
+                  out[0]  = out[1] = out[2] = y[i];
+                  out[3]  = 255; /* not used if n==3 */
+                  out    += n;
+               }
+         }
+      }
+      else
+      {
+         uint8_t *y = coutput[0];
+         if (n == 1)
+            for (i = 0; i < z->s->img_x; ++i)
+               out[i] = y[i];
+         else
+            for (i = 0; i < z->s->img_x; ++i)
+            {
+               *out++ = y[i];
+               *out++ = 255;
+            }
+      }
+   }
+}
+
+#ifdef HAVE_THREADS
+typedef struct
+{
+   rjpeg_jpeg *z;
+   rjpeg_resample *res_comp;
+   uint8_t *linebuf[RJPEG_MAX_THREADS][4];
+   uint8_t *output;
+   int n;
+   int decode_n;
+   unsigned bands;
+} rjpeg_resample_job;
+
+static void rjpeg_resample_job_func(void *userdata, unsigned index)
+{
+   int k;
+   rjpeg_resample res_comp[4];
+   rjpeg_resample_job *job = (rjpeg_resample_job*)userdata;
+   unsigned rows           = job->z->s->img_y;
+   unsigned j              = rows *  index      / job->bands;
+   unsigned j_end          = rows * (index + 1) / job->bands;
+
+   /* Each band starts from its own copy of the
+    * resampler state, moved down to its first row */
+   for (k = 0; k < job->decode_n; ++k)
+   {
+      res_comp[k] = job->res_comp[k];
+      rjpeg_resample_advance(job->z, &res_comp[k], k, j);
+   }
+
+   rjpeg_resample_rows(job->z, res_comp, job->linebuf[index],
+         job->output, job->n, job->decode_n, j, j_end);
+}
+
+/* Returns false if the image is too small to
+ * bother, in which case nothing has been done */
+static bool rjpeg_resample_threaded(rjpeg_jpeg *z, rjpeg_resample *res_comp,
+      uint8_t *output, int n, int decode_n)
+{
+   int k;
+   unsigned i;
+   rjpeg_resample_job job;
+   unsigned bands = rjpeg_thread_count(z->s->img_y, RJPEG_THREAD_MIN_ROWS);
+
+   if (bands < 2)
+      return false;
+
+   job.z        = z;
+   job.res_comp = res_comp;
+   job.output   = output;
+   job.n        = n;
+   job.decode_n = decode_n;
+
+   /* Line buffers are scratch space, one set per band */
+   for (k = 0; k < decode_n; ++k)
+      job.linebuf[0][k] = z->img_comp[k].linebuf;
+
+   for (i = 1; i < bands; i++)
+   {
+      for (k = 0; k < decode_n; ++k)
+         if (!(job.linebuf[i][k] = (uint8_t *) malloc(z->s->img_x + 3)))
+            break;
+
+      if (k < decode_n)
+      {
+         while (k--)
+            free(job.linebuf[i][k]);
+         break;
+      }
+   }
+   job.bands = i;
+
+   if (job.bands >= 2)
+      rjpeg_run_jobs(rjpeg_resample_job_func, &job, job.bands);
+
+   for (i = 1; i < job.bands; i++)
+      for (k = 0; k < decode_n; ++k)
+         free(job.linebuf[i][k]);
+
+   return job.bands >= 2;
+}
+#endif
+
 static uint8_t *rjpeg_load_jpeg_image(rjpeg_jpeg *z,
       unsigned *out_x, unsigned *out_y, int *comp, int req_comp)
 {
    int n, decode_n;
    int k;
-   unsigned int i,j;
    rjpeg_resample res_comp[4];
-   uint8_t *coutput[4] = {0};
    uint8_t *output     = NULL;
    z->s->img_n         = 0;
 
@@ -2489,57 +2941,15 @@ static uint8_t *rjpeg_load_jpeg_image(rjpeg_jpeg *z,
       goto error;
 
    /* now go ahead and resample */
-   for (j = 0; j < z->s->img_y; ++j)
+#ifdef HAVE_THREADS
+   if (!rjpeg_resample_threaded(z, res_comp, output, n, decode_n))
+#endif
    {
-      uint8_t *out = output + n * z->s->img_x * j;
+      uint8_t *linebuf[4];
       for (k = 0; k < decode_n; ++k)
-      {
-         rjpeg_resample *r = &res_comp[k];
-         int         y_bot  = r->ystep >= (r->vs >> 1);
-
-         coutput[k]         = r->resample(z->img_comp[k].linebuf,
-               y_bot ? r->line1 : r->line0,
-               y_bot ? r->line0 : r->line1,
-               r->w_lores, r->hs);
-
-         if (++r->ystep >= r->vs)
-         {
-            r->ystep = 0;
-            r->line0 = r->line1;
-            if (++r->ypos < z->img_comp[k].y)
-               r->line1 += z->img_comp[k].w2;
-         }
-      }
-
-      if (n >= 3)
-      {
-         uint8_t *y = coutput[0];
-         if (y)
-         {
-            if (z->s->img_n == 3)
-               z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
-            else
-               for (i = 0; i < z->s->img_x; ++i)
-               {
-                  out[0]  = out[1] = out[2] = y[i];
-                  out[3]  = 255; /* not used if n==3 */
-                  out    += n;
-               }
-         }
-      }
-      else
-      {
-         uint8_t *y = coutput[0];
-         if (n == 1)
-            for (i = 0; i < z->s->img_x; ++i)
-               out[i] = y[i];
-         else
-            for (i = 0; i < z->s->img_x; ++i)
-            {
-               *out++ = y[i];
-               *out++ = 255;
-            }
-      }
+         linebuf[k] = z->img_comp[k].linebuf;
+      rjpeg_resample_rows(z, res_comp, linebuf, output, n, decode_n,
+            0, z->s->img_y);
    }
 
    rjpeg_cleanup_jpeg(z);
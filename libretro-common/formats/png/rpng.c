@@ -20,7 +20,7 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
-#ifdef DEBUG
+#if defined(DEBUG) || defined(RPNG_TEST)
 #include <stdio.h>
 #endif
 #include <stdint.h>
@@ -37,8 +37,32 @@
 #include <streams/trans_stream.h>
 #include <string/stdstring.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#include <rthreads/tpool.h>
+#endif
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define RPNG_SSE2
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !defined(DONT_WANT_ARM_OPTIMIZATIONS)
+#include <arm_neon.h>
+#define RPNG_NEON
+#endif
+
 #include "rpng_internal.h"
 
+#ifdef HAVE_THREADS
+/* Non-interlaced images with at least this much
+ * filtered data are inflated on the shared thread pool,
+ * with reverse filtering of each scanline starting
+ * as soon as it has been inflated */
+#define RPNG_INFLATE_THREAD_MIN_SIZE (256 * 1024)
+
+/* Amount of data inflated between progress updates */
+#define RPNG_INFLATE_THREAD_CHUNK    (64 * 1024)
+#endif
+
 enum png_ihdr_color_type
 {
    PNG_IHDR_COLOR_GRAY       = 0,
@@ -99,6 +123,17 @@ struct rpng_process
    size_t avail_out;
    size_t total_out;
    size_t pass_size;
+#ifdef HAVE_THREADS
+   slock_t *inflate_lock;
+   scond_t *inflate_cond;
+   size_t inflate_avail;      /* Inflated bytes visible to the filter */
+   size_t inflate_thread_out; /* Inflated bytes (shared, under lock) */
+   bool inflate_thread_done;  /* (shared, under lock) */
+   bool inflate_thread_error; /* (shared, under lock) */
+   bool inflate_thread_quit;  /* (shared, under lock) */
+   bool inflate_threaded;     /* Inflating on the shared pool */
+   uint8_t *inflate_thread_buf;
+#endif
    struct png_ihdr ihdr; /* uint32_t alignment */
    unsigned bpp;
    unsigned pitch;
@@ -221,6 +256,233 @@ static bool png_process_ihdr(struct png_ihdr *ihdr)
 }
 #endif
 
+/* Reverse filtering
+ * > 'in' is the filtered scanline, 'prev' the previous
+ *   reconstructed scanline (all zeros for the first
+ *   scanline of a pass) and 'out' the reconstructed
+ *   scanline. 'pitch' and 'bpp' are in bytes
+ * > SIMD versions are provided for 8 bit RGB/RGBA
+ *   (3/4 bytes per pixel). These are the most common
+ *   formats, and the only ones where the per-pixel
+ *   dependency of Sub/Average/Paeth can be handled
+ *   one whole pixel at a time */
+
+#if defined(RPNG_SSE2) || defined(RPNG_NEON)
+static INLINE uint32_t png_load_pixel(const uint8_t *p, unsigned bpp)
+{
+   uint32_t v = 0;
+   memcpy(&v, p, bpp);
+   return v;
+}
+
+static INLINE void png_store_pixel(uint8_t *p, uint32_t v, unsigned bpp)
+{
+   memcpy(p, &v, bpp);
+}
+#endif
+
+static void png_unfilter_up(uint8_t *out, const uint8_t *in,
+      const uint8_t *prev, unsigned pitch)
+{
+   unsigned i = 0;
+
+#if defined(RPNG_SSE2)
+   for (; i + 16 <= pitch; i += 16)
+      _mm_storeu_si128((__m128i*)(out + i), _mm_add_epi8(
+               _mm_loadu_si128((const __m128i*)(in + i)),
+               _mm_loadu_si128((const __m128i*)(prev + i))));
+#elif defined(RPNG_NEON)
+   for (; i + 16 <= pitch; i += 16)
+      vst1q_u8(out + i, vaddq_u8(vld1q_u8(in + i), vld1q_u8(prev + i)));
+#endif
+
+   for (; i < pitch; i++)
+      out[i] = prev[i] + in[i];
+}
+
+static void png_unfilter_sub(uint8_t *out, const uint8_t *in,
+      unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+
+#if defined(RPNG_SSE2)
+   if (bpp == 3 || bpp == 4)
+   {
+      __m128i a = _mm_setzero_si128();
+
+      for (i = 0; i < pitch; i += bpp)
+      {
+         a = _mm_add_epi8(a, _mm_cvtsi32_si128(
+                  (int)png_load_pixel(in + i, bpp)));
+         png_store_pixel(out + i, (uint32_t)_mm_cvtsi128_si32(a), bpp);
+      }
+      return;
+   }
+#elif defined(RPNG_NEON)
+   if (bpp == 3 || bpp == 4)
+   {
+      uint8x8_t a = vdup_n_u8(0);
+
+      for (i = 0; i < pitch; i += bpp)
+      {
+         a = vadd_u8(a, vreinterpret_u8_u32(
+                  vdup_n_u32(png_load_pixel(in + i, bpp))));
+         png_store_pixel(out + i,
+               vget_lane_u32(vreinterpret_u32_u8(a), 0), bpp);
+      }
+      return;
+   }
+#endif
+
+   for (i = 0; i < bpp; i++)
+      out[i] = in[i];
+   for (i = bpp; i < pitch; i++)
+      out[i] = out[i - bpp] + in[i];
+}
+
+static void png_unfilter_avg(uint8_t *out, const uint8_t *in,
+      const uint8_t *prev, unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+
+#if defined(RPNG_SSE2)
+   if (bpp == 3 || bpp == 4)
+   {
+      __m128i a   = _mm_setzero_si128();
+      __m128i one = _mm_set1_epi8(1);
+
+      for (i = 0; i < pitch; i += bpp)
+      {
+         __m128i b   = _mm_cvtsi32_si128((int)png_load_pixel(prev + i, bpp));
+         __m128i x   = _mm_cvtsi32_si128((int)png_load_pixel(in   + i, bpp));
+         /* _mm_avg_epu8() rounds up - correct to (a + b) >> 1 */
+         __m128i avg = _mm_sub_epi8(_mm_avg_epu8(a, b),
+               _mm_and_si128(_mm_xor_si128(a, b), one));
+         a           = _mm_add_epi8(avg, x);
+         png_store_pixel(out + i, (uint32_t)_mm_cvtsi128_si32(a), bpp);
+      }
+      return;
+   }
+#elif defined(RPNG_NEON)
+   if (bpp == 3 || bpp == 4)
+   {
+      uint8x8_t a = vdup_n_u8(0);
+
+      for (i = 0; i < pitch; i += bpp)
+      {
+         uint8x8_t b = vreinterpret_u8_u32(
+               vdup_n_u32(png_load_pixel(prev + i, bpp)));
+         uint8x8_t x = vreinterpret_u8_u32(
+               vdup_n_u32(png_load_pixel(in + i, bpp)));
+         /* vhadd truncates, i.e. (a + b) >> 1 */
+         a           = vadd_u8(vhadd_u8(a, b), x);
+         png_store_pixel(out + i,
+               vget_lane_u32(vreinterpret_u32_u8(a), 0), bpp);
+      }
+      return;
+   }
+#endif
+
+   for (i = 0; i < bpp; i++)
+      out[i] = (prev[i] >> 1) + in[i];
+   for (i = bpp; i < pitch; i++)
+      out[i] = ((out[i - bpp] + prev[i]) >> 1) + in[i];
+}
+
+static void png_unfilter_paeth(uint8_t *out, const uint8_t *in,
+      const uint8_t *prev, unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+
+#if defined(RPNG_SSE2)
+   if (bpp == 3 || bpp == 4)
+   {
+      /* Predictor is computed on 16 bit lanes:
+       * pa = |b - c|, pb = |a - c|, pc = |a + b - 2c| */
+      __m128i zero = _mm_setzero_si128();
+      __m128i a    = zero;
+      __m128i c    = zero;
+
+      for (i = 0; i < pitch; i += bpp)
+      {
+         __m128i b   = _mm_unpacklo_epi8(_mm_cvtsi32_si128(
+                  (int)png_load_pixel(prev + i, bpp)), zero);
+         __m128i x   = _mm_cvtsi32_si128((int)png_load_pixel(in + i, bpp));
+         __m128i pa  = _mm_sub_epi16(b, c);
+         __m128i pb  = _mm_sub_epi16(a, c);
+         __m128i pc  = _mm_add_epi16(pa, pb);
+         __m128i min, pred, d;
+
+         pa   = _mm_max_epi16(pa, _mm_sub_epi16(zero, pa));
+         pb   = _mm_max_epi16(pb, _mm_sub_epi16(zero, pb));
+         pc   = _mm_max_epi16(pc, _mm_sub_epi16(zero, pc));
+         min  = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+
+         /* pa is smallest ? a : (pb is smallest ? b : c) */
+         {
+            __m128i is_a = _mm_cmpeq_epi16(min, pa);
+            __m128i is_b = _mm_cmpeq_epi16(min, pb);
+            pred = _mm_or_si128(_mm_and_si128(is_b, b),
+                  _mm_andnot_si128(is_b, c));
+            pred = _mm_or_si128(_mm_and_si128(is_a, a),
+                  _mm_andnot_si128(is_a, pred));
+         }
+
+         d    = _mm_add_epi8(_mm_packus_epi16(pred, pred), x);
+         png_store_pixel(out + i, (uint32_t)_mm_cvtsi128_si32(d), bpp);
+
+         a    = _mm_unpacklo_epi8(d, zero);
+         c    = b;
+      }
+      return;
+   }
+#elif defined(RPNG_NEON)
+   if (bpp == 3 || bpp == 4)
+   {
+      int16x8_t a = vdupq_n_s16(0);
+      int16x8_t c = vdupq_n_s16(0);
+
+      for (i = 0; i < pitch; i += bpp)
+      {
+         int16x8_t b   = vreinterpretq_s16_u16(vmovl_u8(vreinterpret_u8_u32(
+                     vdup_n_u32(png_load_pixel(prev + i, bpp)))));
+         uint8x8_t x   = vreinterpret_u8_u32(
+               vdup_n_u32(png_load_pixel(in + i, bpp)));
+         int16x8_t pa  = vsubq_s16(b, c);
+         int16x8_t pb  = vsubq_s16(a, c);
+         int16x8_t pc  = vaddq_s16(pa, pb);
+         int16x8_t min, pred;
+         uint16x8_t is_a, is_b;
+         uint8x8_t d;
+
+         pa   = vabsq_s16(pa);
+         pb   = vabsq_s16(pb);
+         pc   = vabsq_s16(pc);
+         min  = vminq_s16(pc, vminq_s16(pa, pb));
+
+         /* pa is smallest ? a : (pb is smallest ? b : c) */
+         is_a = vceqq_s16(min, pa);
+         is_b = vceqq_s16(min, pb);
+         pred = vbslq_s16(is_b, b, c);
+         pred = vbslq_s16(is_a, a, pred);
+
+         d    = vadd_u8(vmovn_u16(vreinterpretq_u16_s16(pred)), x);
+         png_store_pixel(out + i,
+               vget_lane_u32(vreinterpret_u32_u8(d), 0), bpp);
+
+         a    = vreinterpretq_s16_u16(vmovl_u8(d));
+         c    = b;
+      }
+      return;
+   }
+#endif
+
+   for (i = 0; i < bpp; i++)
+      out[i] = paeth(0, prev[i], 0) + in[i];
+   for (i = bpp; i < pitch; i++)
+      out[i] = paeth(out[i - bpp], prev[i], prev[i - bpp]) + in[i];
+}
+
 static void png_reverse_filter_copy_line_rgb(uint32_t *data,
       const uint8_t *decoded, unsigned width, unsigned bpp)
 {
@@ -535,6 +797,10 @@ static int png_reverse_filter_init(const struct png_ihdr *ihdr,
 
    png_pass_geom(ihdr, ihdr->width, ihdr->height, &pngp->bpp, &pngp->pitch, &pass_size);
 
+#ifdef HAVE_THREADS
+   /* Still being inflated - checked per scanline instead */
+   if (!pngp->inflate_threaded)
+#endif
    if (pngp->total_out < pass_size)
       return -1;
 
@@ -559,7 +825,7 @@ error:
 static int png_reverse_filter_copy_line(uint32_t *data, const struct png_ihdr *ihdr,
       struct rpng_process *pngp, unsigned filter)
 {
-   unsigned i;
+   uint8_t *swap;
 
    switch (filter)
    {
@@ -567,33 +833,20 @@ static int png_reverse_filter_copy_line(uint32_t *data, const struct png_ihdr *i
          memcpy(pngp->decoded_scanline, pngp->inflate_buf, pngp->pitch);
          break;
       case PNG_FILTER_SUB:
-         for (i = 0; i < pngp->bpp; i++)
-            pngp->decoded_scanline[i] = pngp->inflate_buf[i];
-         for (i = pngp->bpp; i < pngp->pitch; i++)
-            pngp->decoded_scanline[i] = pngp->decoded_scanline[i - pngp->bpp] + pngp->inflate_buf[i];
+         png_unfilter_sub(pngp->decoded_scanline, pngp->inflate_buf,
+               pngp->pitch, pngp->bpp);
          break;
       case PNG_FILTER_UP:
-         for (i = 0; i < pngp->pitch; i++)
-            pngp->decoded_scanline[i] = pngp->prev_scanline[i] + pngp->inflate_buf[i];
+         png_unfilter_up(pngp->decoded_scanline, pngp->inflate_buf,
+               pngp->prev_scanline, pngp->pitch);
          break;
       case PNG_FILTER_AVERAGE:
-         for (i = 0; i < pngp->bpp; i++)
-         {
-            uint8_t avg = pngp->prev_scanline[i] >> 1;
-            pngp->decoded_scanline[i] = avg + pngp->inflate_buf[i];
-         }
-         for (i = pngp->bpp; i < pngp->pitch; i++)
-         {
-            uint8_t avg = (pngp->decoded_scanline[i - pngp->bpp] + pngp->prev_scanline[i]) >> 1;
-            pngp->decoded_scanline[i] = avg + pngp->inflate_buf[i];
-         }
+         png_unfilter_avg(pngp->decoded_scanline, pngp->inflate_buf,
+               pngp->prev_scanline, pngp->pitch, pngp->bpp);
          break;
       case PNG_FILTER_PAETH:
-         for (i = 0; i < pngp->bpp; i++)
-            pngp->decoded_scanline[i] = paeth(0, pngp->prev_scanline[i], 0) + pngp->inflate_buf[i];
-         for (i = pngp->bpp; i < pngp->pitch; i++)
-            pngp->decoded_scanline[i] = paeth(pngp->decoded_scanline[i - pngp->bpp],
-                  pngp->prev_scanline[i], pngp->prev_scanline[i - pngp->bpp]) + pngp->inflate_buf[i];
+         png_unfilter_paeth(pngp->decoded_scanline, pngp->inflate_buf,
+               pngp->prev_scanline, pngp->pitch, pngp->bpp);
          break;
 
       default:
@@ -621,16 +874,164 @@ static int png_reverse_filter_copy_line(uint32_t *data, const struct png_ihdr *i
          break;
    }
 
-   memcpy(pngp->prev_scanline, pngp->decoded_scanline, pngp->pitch);
+   /* Current scanline becomes the previous one -
+    * its buffer is fully overwritten next time */
+   swap                   = pngp->prev_scanline;
+   pngp->prev_scanline    = pngp->decoded_scanline;
+   pngp->decoded_scanline = swap;
 
    return IMAGE_PROCESS_NEXT;
 }
 
+#ifdef HAVE_THREADS
+static void rpng_inflate_thread(void *data)
+{
+   struct rpng_process *pngp = (struct rpng_process*)data;
+   size_t avail_in           = pngp->avail_in;
+   size_t total_out          = 0;
+   bool error                = false;
+   bool quit                 = false;
+
+   /* Same termination rules as the single call made by
+    * rpng_load_image_argb_process_inflate_init(), except
+    * that the output is produced in chunks so that the
+    * reverse filter can start on the first scanlines */
+   while (!quit && avail_in > 0 && total_out < pngp->inflate_buf_size)
+   {
+      bool zstatus;
+      uint32_t rd, wn;
+      enum trans_stream_error terror = TRANS_STREAM_ERROR_NONE;
+      size_t chunk = pngp->inflate_buf_size - total_out;
+
+      if (chunk > RPNG_INFLATE_THREAD_CHUNK)
+         chunk = RPNG_INFLATE_THREAD_CHUNK;
+
+      pngp->stream_backend->set_out(pngp->stream,
+            pngp->inflate_thread_buf + total_out, (uint32_t)chunk);
+
+      zstatus = pngp->stream_backend->trans(pngp->stream, false,
+            &rd, &wn, &terror);
+
+      if (!zstatus && terror != TRANS_STREAM_ERROR_BUFFER_FULL)
+      {
+         error = true;
+         break;
+      }
+
+      avail_in  -= rd;
+      total_out += wn;
+
+      slock_lock(pngp->inflate_lock);
+      pngp->inflate_thread_out = total_out;
+      quit                     = pngp->inflate_thread_quit;
+      scond_signal(pngp->inflate_cond);
+      slock_unlock(pngp->inflate_lock);
+
+      /* End of stream */
+      if (terror == TRANS_STREAM_ERROR_NONE)
+         break;
+   }
+
+   slock_lock(pngp->inflate_lock);
+   pngp->inflate_thread_done  = true;
+   pngp->inflate_thread_error = error;
+   scond_signal(pngp->inflate_cond);
+   slock_unlock(pngp->inflate_lock);
+}
+
+static bool rpng_inflate_thread_start(struct rpng_process *pngp)
+{
+   tpool_t *pool              = tpool_shared();
+
+   if (!pool)
+      return false;
+
+   pngp->inflate_avail        = 0;
+   pngp->inflate_thread_out   = 0;
+   pngp->inflate_thread_done  = false;
+   pngp->inflate_thread_error = false;
+   pngp->inflate_thread_quit  = false;
+   pngp->inflate_thread_buf   = pngp->inflate_buf;
+
+   if (!(pngp->inflate_lock = slock_new()))
+      return false;
+   if (!(pngp->inflate_cond = scond_new()))
+      goto error;
+   if (!tpool_add_work(pool, rpng_inflate_thread, pngp))
+      goto error;
+
+   pngp->inflate_threaded     = true;
+   return true;
+
+error:
+   if (pngp->inflate_cond)
+      scond_free(pngp->inflate_cond);
+   slock_free(pngp->inflate_lock);
+   pngp->inflate_cond = NULL;
+   pngp->inflate_lock = NULL;
+   return false;
+}
+
+/* Waits for the inflate job to finish, returns
+ * whether the compressed stream was valid */
+static bool rpng_inflate_thread_stop(struct rpng_process *pngp)
+{
+   bool error;
+
+   slock_lock(pngp->inflate_lock);
+   pngp->inflate_thread_quit = true;
+   while (!pngp->inflate_thread_done)
+      scond_wait(pngp->inflate_cond, pngp->inflate_lock);
+   error = pngp->inflate_thread_error;
+   slock_unlock(pngp->inflate_lock);
+
+   scond_free(pngp->inflate_cond);
+   slock_free(pngp->inflate_lock);
+   pngp->inflate_threaded = false;
+   pngp->inflate_cond   = NULL;
+   pngp->inflate_lock   = NULL;
+
+   pngp->total_out      = pngp->inflate_thread_out;
+   pngp->stream_backend->stream_free(pngp->stream);
+   pngp->stream         = NULL;
+
+   return !error;
+}
+
+/* Blocks until the first 'size' bytes of the
+ * filtered image have been inflated */
+static bool rpng_inflate_thread_wait(struct rpng_process *pngp,
+      size_t size)
+{
+   if (size <= pngp->inflate_avail)
+      return true;
+
+   slock_lock(pngp->inflate_lock);
+   while (      pngp->inflate_thread_out < size
+         &&    !pngp->inflate_thread_done)
+      scond_wait(pngp->inflate_cond, pngp->inflate_lock);
+   pngp->inflate_avail = pngp->inflate_thread_out;
+   if (pngp->inflate_thread_error)
+      pngp->inflate_avail = 0;
+   slock_unlock(pngp->inflate_lock);
+
+   return size <= pngp->inflate_avail;
+}
+#endif
+
 static int png_reverse_filter_regular_iterate(uint32_t **data, const struct png_ihdr *ihdr,
       struct rpng_process *pngp)
 {
    int ret = IMAGE_PROCESS_END;
 
+#ifdef HAVE_THREADS
+   if (     pngp->inflate_threaded
+         && pngp->h < ihdr->height
+         && !rpng_inflate_thread_wait(pngp,
+            pngp->restore_buf_size + 1 + pngp->pitch))
+      ret = IMAGE_PROCESS_ERROR;
+   else
+#endif
    if (pngp->h < ihdr->height)
    {
       unsigned filter = *pngp->inflate_buf++;
@@ -639,7 +1040,9 @@ static int png_reverse_filter_regular_iterate(uint32_t **data, const struct png_
             ihdr, pngp, filter);
    }
 
-   if (ret == IMAGE_PROCESS_END || ret == IMAGE_PROCESS_ERROR_END)
+   if (     ret == IMAGE_PROCESS_END
+         || ret == IMAGE_PROCESS_ERROR
+         || ret == IMAGE_PROCESS_ERROR_END)
       goto end;
 
    pngp->h++;
@@ -652,6 +1055,13 @@ static int png_reverse_filter_regular_iterate(uint32_t **data, const struct png_
    return IMAGE_PROCESS_NEXT;
 
 end:
+#ifdef HAVE_THREADS
+   if (pngp->inflate_threaded)
+   {
+      if (!rpng_inflate_thread_stop(pngp))
+         ret = IMAGE_PROCESS_ERROR;
+   }
+#endif
    png_reverse_filter_deinit(pngp);
 
    pngp->inflate_buf -= pngp->restore_buf_size;
@@ -763,6 +1173,15 @@ static int rpng_load_image_argb_process_inflate_init(rpng_t *rpng, uint32_t **da
    if (!to_continue)
       goto end;
 
+#ifdef HAVE_THREADS
+   /* Inflate in the background and overlap
+    * it with reverse filtering */
+   if (     !rpng->ihdr.interlace
+         &&  process->inflate_buf_size >= RPNG_INFLATE_THREAD_MIN_SIZE
+         &&  rpng_inflate_thread_start(process))
+      goto end;
+#endif
+
    zstatus = process->stream_backend->trans(process->stream, false, &rd, &wn, &terror);
 
    if (!zstatus && terror != TRANS_STREAM_ERROR_BUFFER_FULL)
@@ -776,8 +1195,13 @@ static int rpng_load_image_argb_process_inflate_init(rpng_t *rpng, uint32_t **da
       return 0;
 
 end:
-   process->stream_backend->stream_free(process->stream);
-   process->stream = NULL;
+#ifdef HAVE_THREADS
+   if (!process->inflate_threaded)
+#endif
+   {
+      process->stream_backend->stream_free(process->stream);
+      process->stream = NULL;
+   }
 
 #ifdef GEKKO
    /* we often use these in textures, make sure they're 32-byte aligned */
@@ -885,6 +1309,12 @@ static struct rpng_process *rpng_process_init(rpng_t *rpng)
    process->palette                = 0;
    process->stream                 = NULL;
    process->stream_backend         = trans_stream_get_zlib_inflate_backend();
+#ifdef HAVE_THREADS
+   process->inflate_threaded       = false;
+   process->inflate_lock           = NULL;
+   process->inflate_cond           = NULL;
+   process->inflate_thread_buf     = NULL;
+#endif
 
    png_pass_geom(&rpng->ihdr, rpng->ihdr.width,
          rpng->ihdr.height, NULL, NULL, &process->inflate_buf_size);
@@ -1132,6 +1562,24 @@ bool rpng_iterate_image(rpng_t *rpng)
    return true;
 }
 
+static void rpng_process_free(struct rpng_process *process)
+{
+#ifdef HAVE_THREADS
+   if (process->inflate_threaded)
+      rpng_inflate_thread_stop(process);
+#endif
+   if (process->inflate_buf)
+      free(process->inflate_buf);
+   if (process->stream)
+   {
+      if (process->stream_backend && process->stream_backend->stream_free)
+         process->stream_backend->stream_free(process->stream);
+      else
+         free(process->stream);
+   }
+   free(process);
+}
+
 int rpng_process_image(rpng_t *rpng,
       void **_data, size_t size, unsigned *width, unsigned *height)
 {
@@ -1164,13 +1612,8 @@ int rpng_process_image(rpng_t *rpng,
 
 error:
    if (rpng->process)
-   {
-      if (rpng->process->inflate_buf)
-         free(rpng->process->inflate_buf);
-      if (rpng->process->stream)
-         rpng->process->stream_backend->stream_free(rpng->process->stream);
-      free(rpng->process);
-   }
+      rpng_process_free(rpng->process);
+   rpng->process = NULL;
    return IMAGE_PROCESS_ERROR;
 }
 
@@ -1182,18 +1625,7 @@ void rpng_free(rpng_t *rpng)
    if (rpng->idat_buf.data)
       free(rpng->idat_buf.data);
    if (rpng->process)
-   {
-      if (rpng->process->inflate_buf)
-         free(rpng->process->inflate_buf);
-      if (rpng->process->stream)
-      {
-         if (rpng->process->stream_backend && rpng->process->stream_backend->stream_free)
-            rpng->process->stream_backend->stream_free(rpng->process->stream);
-         else
-            free(rpng->process->stream);
-      }
-      free(rpng->process);
-   }
+      rpng_process_free(rpng->process);
 
    free(rpng);
 }
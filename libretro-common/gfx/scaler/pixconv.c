@@ -35,12 +35,28 @@
 
 #ifdef SCALER_NO_SIMD
 #undef __SSE2__
+#undef __MMX__
 #endif
 
 #if defined(__SSE2__)
 #include <emmintrin.h>
 #elif defined(__MMX__)
 #include <mmintrin.h>
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !defined(SCALER_NO_SIMD) && !defined(DONT_WANT_ARM_OPTIMIZATIONS)
+#include <arm_neon.h>
+#define SCALER_NEON
+#endif
+
+/* The NEON paths compute the same expressions as the C
+ * fallbacks, 8 or 16 pixels at a time, using the structured
+ * (de)interleaving loads and stores for the 24 and 32-bit formats */
+
+#if defined(SCALER_NEON)
+/* Expands 5 and 6-bit channels to 8 bits, like (x << 3) | (x >> 2)
+ * and (x << 2) | (x >> 4) do for the C paths */
+#define CONV_NEON_EXPAND5(x) vorr_u8(vshl_n_u8((x), 3), vshr_n_u8((x), 2))
+#define CONV_NEON_EXPAND6(x) vorr_u8(vshl_n_u8((x), 2), vshr_n_u8((x), 4))
+#define CONV_NEON_EXPAND4(x) vorr_u8(vshl_n_u8((x), 4), (x))
 #endif
 
 void conv_rgb565_0rgb1555(void *output_, const void *input_,
@@ -65,10 +81,18 @@ void conv_rgb565_0rgb1555(void *output_, const void *input_,
       for (; w < max_width; w += 8)
       {
          const __m128i in = _mm_loadu_si128((const __m128i*)(input + w));
-         __m128i hi = _mm_and_si128(_mm_slli_epi16(in, 1), hi_mask);
+         __m128i hi = _mm_and_si128(_mm_srli_epi16(in, 1), hi_mask);
          __m128i lo = _mm_and_si128(in, lo_mask);
          _mm_storeu_si128((__m128i*)(output + w), _mm_or_si128(hi, lo));
       }
+#elif defined(SCALER_NEON)
+      for (; w + 8 <= width; w += 8)
+      {
+         uint16x8_t in = vld1q_u16(input + w);
+         uint16x8_t hi = vandq_u16(vshrq_n_u16(in, 1), vdupq_n_u16(0x7fe0));
+         uint16x8_t lo = vandq_u16(in, vdupq_n_u16(0x1f));
+         vst1q_u16(output + w, vorrq_u16(hi, lo));
+      }
 #endif
 
       for (; w < width; w++)
@@ -112,6 +136,16 @@ void conv_0rgb1555_rgb565(void *output_, const void *input_,
          _mm_storeu_si128((__m128i*)(output + w),
                _mm_or_si128(rg, _mm_or_si128(b, glow)));
       }
+#elif defined(SCALER_NEON)
+      for (; w + 8 <= width; w += 8)
+      {
+         uint16x8_t in   = vld1q_u16(input + w);
+         uint16x8_t rg   = vandq_u16(vshlq_n_u16(in, 1),
+               vdupq_n_u16((0x1f << 11) | (0x1f << 6)));
+         uint16x8_t b    = vandq_u16(in, vdupq_n_u16(0x1f));
+         uint16x8_t glow = vandq_u16(vshrq_n_u16(in, 4), vdupq_n_u16(1 << 5));
+         vst1q_u16(output + w, vorrq_u16(rg, vorrq_u16(b, glow)));
+      }
 #endif
 
       for (; w < width; w++)
@@ -175,6 +209,22 @@ void conv_0rgb1555_argb8888(void *output_, const void *input_,
          _mm_storeu_si128((__m128i*)(output + w + 0), res_lo);
          _mm_storeu_si128((__m128i*)(output + w + 4), res_hi);
       }
+#elif defined(SCALER_NEON)
+      for (; w + 8 <= width; w += 8)
+      {
+         uint8x8x4_t res;
+         uint16x8_t in = vld1q_u16(input + w);
+         uint8x8_t mask = vdup_n_u8(0x1f);
+         uint8x8_t r    = vand_u8(vmovn_u16(vshrq_n_u16(in, 10)), mask);
+         uint8x8_t g    = vand_u8(vmovn_u16(vshrq_n_u16(in,  5)), mask);
+         uint8x8_t b    = vand_u8(vmovn_u16(in), mask);
+
+         res.val[0]     = CONV_NEON_EXPAND5(b);
+         res.val[1]     = CONV_NEON_EXPAND5(g);
+         res.val[2]     = CONV_NEON_EXPAND5(r);
+         res.val[3]     = vdup_n_u8(0xff);
+         vst4_u8((uint8_t*)(output + w), res);
+      }
 #endif
 
       for (; w < width; w++)
@@ -282,6 +332,21 @@ void conv_rgb565_argb8888(void *output_, const void *input_,
       }
 
       _mm_empty();
+#elif defined(SCALER_NEON)
+      for (; w + 8 <= width; w += 8)
+      {
+         uint8x8x4_t res;
+         uint16x8_t in = vld1q_u16(input + w);
+         uint8x8_t r   = vmovn_u16(vshrq_n_u16(in, 11));
+         uint8x8_t g   = vand_u8(vmovn_u16(vshrq_n_u16(in, 5)), vdup_n_u8(0x3f));
+         uint8x8_t b   = vand_u8(vmovn_u16(in), vdup_n_u8(0x1f));
+
+         res.val[0]    = CONV_NEON_EXPAND5(b);
+         res.val[1]    = CONV_NEON_EXPAND6(g);
+         res.val[2]    = CONV_NEON_EXPAND5(r);
+         res.val[3]    = vdup_n_u8(0xff);
+         vst4_u8((uint8_t*)(output + w), res);
+      }
 #endif
 
       for (; w < width; w++)
@@ -324,7 +389,7 @@ void conv_rgb565_abgr8888(void *output_, const void *input_,
       for (; w < max_width; w += 8)
       {
          __m128i res_lo, res_hi;
-         __m128i res_lo_bg, res_hi_bg, res_lo_ra, res_hi_ra;
+         __m128i res_lo_rg, res_hi_rg, res_lo_ba, res_hi_ba;
          const __m128i in = _mm_loadu_si128((const __m128i*)(input + w));
          __m128i        r = _mm_and_si128(_mm_srli_epi16(in, 1), pix_mask_r);
          __m128i        g = _mm_and_si128(in, pix_mask_g);
@@ -332,17 +397,32 @@ void conv_rgb565_abgr8888(void *output_, const void *input_,
          r                = _mm_mulhi_epi16(r, mul16_r);
          g                = _mm_mulhi_epi16(g, mul16_g);
          b                = _mm_mulhi_epi16(b, mul16_b);
-         res_lo_bg        = _mm_unpacklo_epi8(b, g);
-         res_hi_bg        = _mm_unpackhi_epi8(b, g);
-         res_lo_ra        = _mm_unpacklo_epi8(r, a);
-         res_hi_ra        = _mm_unpackhi_epi8(r, a);
-         res_lo           = _mm_or_si128(res_lo_bg,
-               _mm_slli_si128(res_lo_ra, 2));
-         res_hi           = _mm_or_si128(res_hi_bg,
-               _mm_slli_si128(res_hi_ra, 2));
+         res_lo_rg        = _mm_unpacklo_epi8(r, g);
+         res_hi_rg        = _mm_unpackhi_epi8(r, g);
+         res_lo_ba        = _mm_unpacklo_epi8(b, a);
+         res_hi_ba        = _mm_unpackhi_epi8(b, a);
+         res_lo           = _mm_or_si128(res_lo_rg,
+               _mm_slli_si128(res_lo_ba, 2));
+         res_hi           = _mm_or_si128(res_hi_rg,
+               _mm_slli_si128(res_hi_ba, 2));
          _mm_storeu_si128((__m128i*)(output + w + 0), res_lo);
          _mm_storeu_si128((__m128i*)(output + w + 4), res_hi);
       }
+#elif defined(SCALER_NEON)
+      for (; w + 8 <= width; w += 8)
+      {
+         uint8x8x4_t res;
+         uint16x8_t in = vld1q_u16(input + w);
+         uint8x8_t r   = vmovn_u16(vshrq_n_u16(in, 11));
+         uint8x8_t g   = vand_u8(vmovn_u16(vshrq_n_u16(in, 5)), vdup_n_u8(0x3f));
+         uint8x8_t b   = vand_u8(vmovn_u16(in), vdup_n_u8(0x1f));
+
+         res.val[0]    = CONV_NEON_EXPAND5(r);
+         res.val[1]    = CONV_NEON_EXPAND6(g);
+         res.val[2]    = CONV_NEON_EXPAND5(b);
+         res.val[3]    = vdup_n_u8(0xff);
+         vst4_u8((uint8_t*)(output + w), res);
+      }
 #endif
        for (; w < width; w++)
       {
@@ -367,9 +447,23 @@ void conv_argb8888_rgba4444(void *output_, const void *input_,
    uint16_t *output      = (uint16_t*)output_;
 
    for (h = 0; h < height;
-         h++, output += out_stride >> 2, input += in_stride >> 1)
+         h++, output += out_stride >> 1, input += in_stride >> 2)
    {
-      for (w = 0; w < width; w++)
+      w = 0;
+#if defined(SCALER_NEON)
+      for (; w + 8 <= width; w += 8)
+      {
+         uint8x8x4_t in = vld4_u8((const uint8_t*)(input + w));
+         uint8x8_t mask = vdup_n_u8(0xf);
+         uint16x8_t res = vmovl_u8(vand_u8(in.val[2], mask));
+         res            = vsliq_n_u16(vmovl_u8(vand_u8(in.val[1], mask)), res, 4);
+         res            = vsliq_n_u16(vmovl_u8(vand_u8(in.val[0], mask)), res, 4);
+         res            = vsliq_n_u16(vmovl_u8(vand_u8(in.val[3], mask)), res, 4);
+         vst1q_u16(output + w, res);
+      }
+#endif
+
+      for (; w < width; w++)
       {
          uint32_t col = input[w];
          uint32_t r   = (col >> 16) & 0xf;
@@ -401,7 +495,8 @@ void conv_rgba4444_argb8888(void *output_, const void *input_,
    const __m64 mul16_r    = _mm_set1_pi16(0x0440);
    const __m64 mul16_g    = _mm_set1_pi16(0x1100);
    const __m64 mul16_b    = _mm_set1_pi16(0x1100);
-   const __m64 a          = _mm_set1_pi16(0x00ff);
+   const __m64 pix_mask_a = _mm_set1_pi16(0xf);
+   const __m64 mul16_a    = _mm_set1_pi16(0x11);
 
    int max_width            = width - 3;
 #endif
@@ -419,6 +514,7 @@ void conv_rgba4444_argb8888(void *output_, const void *input_,
          __m64          r = _mm_and_si64(_mm_srli_pi16(in, 2), pix_mask_r);
          __m64          g = _mm_and_si64(in, pix_mask_g);
          __m64          b = _mm_and_si64(_mm_slli_pi16(in, 4), pix_mask_b);
+         __m64          a = _mm_mullo_pi16(_mm_and_si64(in, pix_mask_a), mul16_a);
 
          r                = _mm_mulhi_pi16(r, mul16_r);
          g                = _mm_mulhi_pi16(g, mul16_g);
@@ -439,6 +535,23 @@ void conv_rgba4444_argb8888(void *output_, const void *input_,
       }
 
       _mm_empty();
+#elif defined(SCALER_NEON)
+      for (; w + 8 <= width; w += 8)
+      {
+         uint8x8x4_t res;
+         uint16x8_t in  = vld1q_u16(input + w);
+         uint8x8_t mask = vdup_n_u8(0xf);
+         uint8x8_t r    = vmovn_u16(vshrq_n_u16(in, 12));
+         uint8x8_t g    = vand_u8(vmovn_u16(vshrq_n_u16(in, 8)), mask);
+         uint8x8_t b    = vand_u8(vmovn_u16(vshrq_n_u16(in, 4)), mask);
+         uint8x8_t a    = vand_u8(vmovn_u16(in), mask);
+
+         res.val[0]     = CONV_NEON_EXPAND4(b);
+         res.val[1]     = CONV_NEON_EXPAND4(g);
+         res.val[2]     = CONV_NEON_EXPAND4(r);
+         res.val[3]     = CONV_NEON_EXPAND4(a);
+         vst4_u8((uint8_t*)(output + w), res);
+      }
 #endif
 
       for (; w < width; w++)
@@ -469,7 +582,19 @@ void conv_rgba4444_rgb565(void *output_, const void *input_,
    for (h = 0; h < height;
          h++, output += out_stride >> 1, input += in_stride >> 1)
    {
-      for (w = 0; w < width; w++)
+      w = 0;
+#if defined(SCALER_NEON)
+      for (; w + 8 <= width; w += 8)
+      {
+         uint16x8_t in = vld1q_u16(input + w);
+         uint16x8_t r  = vandq_u16(in, vdupq_n_u16(0xf << 12));
+         uint16x8_t g  = vandq_u16(vshrq_n_u16(in, 1), vdupq_n_u16(0xf << 7));
+         uint16x8_t b  = vandq_u16(vshrq_n_u16(in, 3), vdupq_n_u16(0xf << 1));
+         vst1q_u16(output + w, vorrq_u16(r, vorrq_u16(g, b)));
+      }
+#endif
+
+      for (; w < width; w++)
       {
          uint32_t col = input[w];
          uint32_t r   = (col >> 12) & 0xf;
@@ -595,6 +720,21 @@ void conv_0rgb1555_bgr24(void *output_, const void *input_,
          /* Non-POT pixel sizes for the loss */
          store_bgr24_sse2(out, res_lo0, res_hi0, res_lo1, res_hi1);
       }
+#elif defined(SCALER_NEON)
+      for (; w + 8 <= width; w += 8, out += 24)
+      {
+         uint8x8x3_t res;
+         uint16x8_t in  = vld1q_u16(input + w);
+         uint8x8_t mask = vdup_n_u8(0x1f);
+         uint8x8_t r    = vand_u8(vmovn_u16(vshrq_n_u16(in, 10)), mask);
+         uint8x8_t g    = vand_u8(vmovn_u16(vshrq_n_u16(in,  5)), mask);
+         uint8x8_t b    = vand_u8(vmovn_u16(in), mask);
+
+         res.val[0]     = CONV_NEON_EXPAND5(b);
+         res.val[1]     = CONV_NEON_EXPAND5(g);
+         res.val[2]     = CONV_NEON_EXPAND5(r);
+         vst3_u8(out, res);
+      }
 #endif
 
       for (; w < width; w++)
@@ -680,6 +820,20 @@ void conv_rgb565_bgr24(void *output_, const void *input_,
 
          store_bgr24_sse2(out, res_lo0, res_hi0, res_lo1, res_hi1);
       }
+#elif defined(SCALER_NEON)
+      for (; w + 8 <= width; w += 8, out += 24)
+      {
+         uint8x8x3_t res;
+         uint16x8_t in = vld1q_u16(input + w);
+         uint8x8_t r   = vmovn_u16(vshrq_n_u16(in, 11));
+         uint8x8_t g   = vand_u8(vmovn_u16(vshrq_n_u16(in, 5)), vdup_n_u8(0x3f));
+         uint8x8_t b   = vand_u8(vmovn_u16(in), vdup_n_u8(0x1f));
+
+         res.val[0]    = CONV_NEON_EXPAND5(b);
+         res.val[1]    = CONV_NEON_EXPAND6(g);
+         res.val[2]    = CONV_NEON_EXPAND5(r);
+         vst3_u8(out, res);
+      }
 #endif
 
       for (; w < width; w++)
@@ -711,7 +865,23 @@ void conv_bgr24_argb8888(void *output_, const void *input_,
          h++, output += out_stride >> 2, input += in_stride)
    {
       const uint8_t *inp = input;
-      for (w = 0; w < width; w++)
+
+      w = 0;
+#if defined(SCALER_NEON)
+      for (; w + 8 <= width; w += 8, inp += 24)
+      {
+         uint8x8x3_t in = vld3_u8(inp);
+         uint8x8x4_t res;
+
+         res.val[0]     = in.val[0];
+         res.val[1]     = in.val[1];
+         res.val[2]     = in.val[2];
+         res.val[3]     = vdup_n_u8(0xff);
+         vst4_u8((uint8_t*)(output + w), res);
+      }
+#endif
+
+      for (; w < width; w++)
       {
          uint32_t b = *inp++;
          uint32_t g = *inp++;
@@ -729,10 +899,23 @@ void conv_bgr24_rgb565(void *output_, const void *input_,
    const uint8_t *input = (const uint8_t*)input_;
    uint16_t *output     = (uint16_t*)output_;
    for (h = 0; h < height;
-         h++, output += out_stride, input += in_stride)
+         h++, output += out_stride >> 1, input += in_stride)
    {
       const uint8_t *inp = input;
-      for (w = 0; w < width; w++)
+
+      w = 0;
+#if defined(SCALER_NEON)
+      for (; w + 8 <= width; w += 8, inp += 24)
+      {
+         uint8x8x3_t in = vld3_u8(inp);
+         uint16x8_t r   = vshll_n_u8(vand_u8(in.val[2], vdup_n_u8(0xf8)), 8);
+         uint16x8_t g   = vshll_n_u8(vand_u8(in.val[1], vdup_n_u8(0xfc)), 3);
+         uint16x8_t b   = vmovl_u8(vshr_n_u8(in.val[0], 3));
+         vst1q_u16(output + w, vorrq_u16(r, vorrq_u16(g, b)));
+      }
+#endif
+
+      for (; w < width; w++)
       {
          uint16_t b = *inp++;
          uint16_t g = *inp++;
@@ -754,7 +937,19 @@ void conv_argb8888_0rgb1555(void *output_, const void *input_,
    for (h = 0; h < height;
          h++, output += out_stride >> 1, input += in_stride >> 2)
    {
-      for (w = 0; w < width; w++)
+      w = 0;
+#if defined(SCALER_NEON)
+      for (; w + 8 <= width; w += 8)
+      {
+         uint8x8x4_t in = vld4_u8((const uint8_t*)(input + w));
+         uint16x8_t res = vmovl_u8(vshr_n_u8(in.val[2], 3));
+         res            = vsliq_n_u16(vmovl_u8(vshr_n_u8(in.val[1], 3)), res, 5);
+         res            = vsliq_n_u16(vmovl_u8(vshr_n_u8(in.val[0], 3)), res, 5);
+         vst1q_u16(output + w, res);
+      }
+#endif
+
+      for (; w < width; w++)
       {
          uint32_t col = input[w];
          uint16_t r   = (col >> 19) & 0x1f;
@@ -791,6 +986,17 @@ void conv_argb8888_bgr24(void *output_, const void *input_,
          __m128i l3 = _mm_loadu_si128((const __m128i*)(input + w + 12));
          store_bgr24_sse2(out, l0, l1, l2, l3);
       }
+#elif defined(SCALER_NEON)
+      for (; w + 8 <= width; w += 8, out += 24)
+      {
+         uint8x8x4_t in = vld4_u8((const uint8_t*)(input + w));
+         uint8x8x3_t res;
+
+         res.val[0]     = in.val[0];
+         res.val[1]     = in.val[1];
+         res.val[2]     = in.val[2];
+         vst3_u8(out, res);
+      }
 #endif
 
       for (; w < width; w++)
@@ -848,6 +1054,17 @@ void conv_abgr8888_bgr24(void *output_, const void *input_,
          d = conv_shuffle_rb_epi32(d);
          store_bgr24_sse2(out, a, b, c, d);
       }
+#elif defined(SCALER_NEON)
+      for (; w + 8 <= width; w += 8, out += 24)
+      {
+         uint8x8x4_t in = vld4_u8((const uint8_t*)(input + w));
+         uint8x8x3_t res;
+
+         res.val[0]     = in.val[2];
+         res.val[1]     = in.val[1];
+         res.val[2]     = in.val[0];
+         vst3_u8(out, res);
+      }
 #endif
 
       for (; w < width; w++)
@@ -871,7 +1088,20 @@ void conv_argb8888_abgr8888(void *output_, const void *input_,
    for (h = 0; h < height;
          h++, output += out_stride >> 2, input += in_stride >> 2)
    {
-      for (w = 0; w < width; w++)
+      w = 0;
+#if defined(SCALER_NEON)
+      for (; w + 8 <= width; w += 8)
+      {
+         uint8x8x4_t in = vld4_u8((const uint8_t*)(input + w));
+         uint8x8_t b    = in.val[0];
+
+         in.val[0]      = in.val[2];
+         in.val[2]      = b;
+         vst4_u8((uint8_t*)(output + w), in);
+      }
+#endif
+
+      for (; w < width; w++)
       {
          uint32_t col = input[w];
          output[w]    = ((col << 16) & 0xff0000) |
@@ -1001,6 +1231,48 @@ void conv_yuyv_argb8888(void *output_, const void *input_,
          _mm_storeu_si128((__m128i*)(dst +  8), res2);
          _mm_storeu_si128((__m128i*)(dst + 12), res3);
       }
+#elif defined(SCALER_NEON)
+      /* Each loop processes 16 pixels - 8 even and 8 odd ones,
+       * sharing the same chroma. */
+      for (; w + 16 <= width; w += 16, src += 32, dst += 16)
+      {
+         uint8x8x4_t res_lo, res_hi;
+         uint8x8x2_t r, g, b;
+         uint8x8x4_t yuv   = vld4_u8(src); /* [Y0, U, Y1, V] */
+         int16x8_t   y0    = vmulq_n_s16(vreinterpretq_s16_u16(
+                  vmovl_u8(yuv.val[0])), YUV_MAT_Y);
+         int16x8_t   y1    = vmulq_n_s16(vreinterpretq_s16_u16(
+                  vmovl_u8(yuv.val[2])), YUV_MAT_Y);
+         int16x8_t   u     = vreinterpretq_s16_u16(vsubl_u8(yuv.val[1], vdup_n_u8(128)));
+         int16x8_t   v     = vreinterpretq_s16_u16(vsubl_u8(yuv.val[3], vdup_n_u8(128)));
+         int16x8_t   v_r   = vaddq_s16(vmulq_n_s16(v, YUV_MAT_V_R), vdupq_n_s16(YUV_OFFSET));
+         int16x8_t   uv_g  = vaddq_s16(vaddq_s16(vmulq_n_s16(u, YUV_MAT_U_G),
+                  vmulq_n_s16(v, YUV_MAT_V_G)), vdupq_n_s16(YUV_OFFSET));
+         int16x8_t   u_b   = vaddq_s16(vmulq_n_s16(u, YUV_MAT_U_B), vdupq_n_s16(YUV_OFFSET));
+
+         /* Saturate into 8-bit, then interleave even and odd pixels. */
+         r = vzip_u8(
+               vqmovun_s16(vshrq_n_s16(vaddq_s16(y0, v_r),  YUV_SHIFT)),
+               vqmovun_s16(vshrq_n_s16(vaddq_s16(y1, v_r),  YUV_SHIFT)));
+         g = vzip_u8(
+               vqmovun_s16(vshrq_n_s16(vaddq_s16(y0, uv_g), YUV_SHIFT)),
+               vqmovun_s16(vshrq_n_s16(vaddq_s16(y1, uv_g), YUV_SHIFT)));
+         b = vzip_u8(
+               vqmovun_s16(vshrq_n_s16(vaddq_s16(y0, u_b),  YUV_SHIFT)),
+               vqmovun_s16(vshrq_n_s16(vaddq_s16(y1, u_b),  YUV_SHIFT)));
+
+         res_lo.val[0] = b.val[0];
+         res_lo.val[1] = g.val[0];
+         res_lo.val[2] = r.val[0];
+         res_lo.val[3] = vdup_n_u8(0xff);
+         res_hi.val[0] = b.val[1];
+         res_hi.val[1] = g.val[1];
+         res_hi.val[2] = r.val[1];
+         res_hi.val[3] = vdup_n_u8(0xff);
+
+         vst4_u8((uint8_t*)(dst + 0), res_lo);
+         vst4_u8((uint8_t*)(dst + 8), res_hi);
+      }
 #endif
 
       /* Finish off the rest (if any) in C. */
@@ -30,6 +30,221 @@
 #include <gfx/scaler/filter.h>
 #include <gfx/scaler/pixconv.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#include <rthreads/tpool.h>
+
+#define SCALER_MAX_BANDS         8
+/* Frames smaller than this are cheaper to scale than
+ * to hand out to the pool. */
+#define SCALER_BANDS_MIN_PIXELS  (320 * 240)
+#define SCALER_BANDS_MIN_ROWS    16
+
+/* Tracks the bands of one scaler_bands_run() call. The pool
+ * is shared with other users, so tpool_wait() can't be used
+ * to wait for just these. */
+struct scaler_band_batch
+{
+   slock_t *lock;
+   scond_t *cond;
+   unsigned pending;          /* (under lock) */
+};
+
+/* One horizontal band of a frame. Each band owns a private
+ * copy of the context with the frame and filter pointers
+ * moved to its first row, so the kernels themselves need
+ * not know about banding. Bands never write to the same
+ * rows, which keeps the output identical to a serial run. */
+struct scaler_band
+{
+   struct scaler_ctx ctx;
+   const struct scaler_ctx *parent;
+   struct scaler_band_batch *batch;
+   thread_func_t func;
+   const void *input;
+   void *output;
+   int first;
+   int rows;
+};
+
+/* The kernels step from row to row in whole pixels, which
+ * rounds a stride that isn't a multiple of the pixel size
+ * down. Bands have to start on the rows they would reach. */
+static int scaler_band_row_bytes(enum scaler_pix_fmt fmt, int stride)
+{
+   switch (fmt)
+   {
+      case SCALER_FMT_ARGB8888:
+      case SCALER_FMT_ABGR8888:
+         return stride & ~3;
+      case SCALER_FMT_0RGB1555:
+      case SCALER_FMT_RGB565:
+      case SCALER_FMT_RGBA4444:
+         return stride & ~1;
+      default:
+         break;
+   }
+
+   return stride;
+}
+
+/* Converts a band of input rows to ARGB8888 and runs the
+ * horizontal pass over the same rows of the scaled frame. */
+static void scaler_band_horiz(void *data)
+{
+   struct scaler_band *band     = (struct scaler_band*)data;
+   const struct scaler_ctx *ctx = band->parent;
+   const void *input            = (const uint8_t*)band->input
+      + band->first
+      * scaler_band_row_bytes(ctx->in_fmt, ctx->in_stride);
+   const void *input_frame      = input;
+   int input_stride             = ctx->in_stride;
+
+   if (ctx->in_fmt != SCALER_FMT_ARGB8888)
+   {
+      input_frame  = (const uint8_t*)ctx->input.frame
+         + band->first * ctx->input.stride;
+      input_stride = ctx->input.stride;
+      ctx->in_pixconv((void*)input_frame, input,
+            ctx->in_width, band->rows,
+            ctx->input.stride, ctx->in_stride);
+   }
+
+   if (ctx->scaler_special)
+      return;
+
+   band->ctx               = *ctx;
+   band->ctx.scaled.frame += band->first * (ctx->scaled.stride >> 3);
+   band->ctx.scaled.height = band->rows;
+   ctx->scaler_horiz(&band->ctx, input_frame, input_stride);
+}
+
+/* Runs the vertical pass for a band of output rows and
+ * converts them to the output format. */
+static void scaler_band_vert(void *data)
+{
+   struct scaler_band *band     = (struct scaler_band*)data;
+   const struct scaler_ctx *ctx = band->parent;
+   void *output                 = (uint8_t*)band->output
+      + band->first
+      * scaler_band_row_bytes(ctx->out_fmt, ctx->out_stride);
+   void *output_frame           = output;
+   int output_stride            = ctx->out_stride;
+
+   if (ctx->out_fmt != SCALER_FMT_ARGB8888)
+   {
+      output_frame  = (uint8_t*)ctx->output.frame
+         + band->first * ctx->output.stride;
+      output_stride = ctx->output.stride;
+   }
+
+   if (!ctx->scaler_special)
+   {
+      band->ctx                  = *ctx;
+      band->ctx.vert.filter     += band->first * ctx->vert.filter_stride;
+      band->ctx.vert.filter_pos += band->first;
+      band->ctx.out_height       = band->rows;
+      ctx->scaler_vert(&band->ctx, output_frame, output_stride);
+   }
+
+   if (ctx->out_fmt != SCALER_FMT_ARGB8888)
+      ctx->out_pixconv(output, output_frame,
+            ctx->out_width, band->rows,
+            ctx->out_stride, ctx->output.stride);
+}
+
+static void scaler_band_thread(void *data)
+{
+   struct scaler_band *band         = (struct scaler_band*)data;
+   struct scaler_band_batch *batch  = band->batch;
+
+   band->func(band);
+
+   slock_lock(batch->lock);
+   if (--batch->pending == 0)
+      scond_signal(batch->cond);
+   slock_unlock(batch->lock);
+}
+
+/* Splits @height rows into ctx->bands bands and runs @func
+ * on each of them through the shared pool, the last band on
+ * the calling thread. Returns once every band is done. */
+static void scaler_bands_run(const struct scaler_ctx *ctx,
+      struct scaler_band *bands, thread_func_t func,
+      void *output, const void *input, int height)
+{
+   unsigned i;
+   struct scaler_band_batch batch;
+   unsigned count = ctx->bands;
+   tpool_t *pool  = tpool_shared();
+   int first      = 0;
+
+   for (i = 0; i < count; i++)
+   {
+      int last        = (int)(((int64_t)height * (i + 1)) / count);
+      bands[i].parent = ctx;
+      bands[i].batch  = &batch;
+      bands[i].func   = func;
+      bands[i].input  = input;
+      bands[i].output = output;
+      bands[i].first  = first;
+      bands[i].rows   = last - first;
+      first           = last;
+   }
+
+   batch.lock    = NULL;
+   batch.cond    = NULL;
+   batch.pending = count - 1;
+
+   /* The shared pool may have gone away since
+    * scaler_bands_init() - run every band here then */
+   if (     !pool
+         || !(batch.lock = slock_new())
+         || !(batch.cond = scond_new()))
+   {
+      if (batch.lock)
+         slock_free(batch.lock);
+      for (i = 0; i < count; i++)
+         func(&bands[i]);
+      return;
+   }
+
+   for (i = 0; i + 1 < count; i++)
+      if (!tpool_add_work(pool, scaler_band_thread, &bands[i]))
+         scaler_band_thread(&bands[i]);
+   func(&bands[count - 1]);
+
+   slock_lock(batch.lock);
+   while (batch.pending)
+      scond_wait(batch.cond, batch.lock);
+   slock_unlock(batch.lock);
+
+   scond_free(batch.cond);
+   slock_free(batch.lock);
+}
+
+static void scaler_bands_init(struct scaler_ctx *ctx)
+{
+   /* The shared pool has a thread per core, and the
+    * calling thread takes one band itself. */
+   unsigned threads = (unsigned)tpool_get_thread_count(tpool_shared());
+   unsigned bands   = (unsigned)(ctx->out_height / SCALER_BANDS_MIN_ROWS);
+
+   if (threads > SCALER_MAX_BANDS)
+      threads = SCALER_MAX_BANDS;
+   if (bands > threads)
+      bands = threads;
+
+   if (     bands < 2
+         || (int64_t)ctx->out_width * ctx->out_height
+            < SCALER_BANDS_MIN_PIXELS
+         || ctx->in_height < SCALER_BANDS_MIN_ROWS)
+      return;
+
+   ctx->bands = bands;
+}
+#endif
+
 static bool allocate_frames(struct scaler_ctx *ctx)
 {
    uint64_t *scaled_frame = NULL;
@@ -261,6 +476,10 @@ bool scaler_ctx_gen_filter(struct scaler_ctx *ctx)
 
       if (!scaler_gen_filter(ctx))
          return false;
+
+#ifdef HAVE_THREADS
+      scaler_bands_init(ctx);
+#endif
    }
 
    return true;
@@ -282,7 +501,6 @@ void scaler_ctx_gen_reset(struct scaler_ctx *ctx)
       free(ctx->input.frame);
    if (ctx->output.frame)
       free(ctx->output.frame);
-
    ctx->horiz.filter        = NULL;
    ctx->horiz.filter_len    = 0;
    ctx->horiz.filter_stride = 0;
@@ -303,6 +521,8 @@ void scaler_ctx_gen_reset(struct scaler_ctx *ctx)
 
    ctx->output.frame        = NULL;
    ctx->output.stride       = 0;
+
+   ctx->bands               = 0;
 }
 
 /**
@@ -321,6 +541,44 @@ void scaler_ctx_scale(struct scaler_ctx *ctx,
    int input_stride        = ctx->in_stride;
    int output_stride       = ctx->out_stride;
 
+#ifdef HAVE_THREADS
+   if (ctx->bands)
+   {
+      struct scaler_band bands[SCALER_MAX_BANDS];
+
+      /* The point scaler samples arbitrary input rows, so only
+       * the format conversions around it are banded. Otherwise
+       * every row of the scaled frame must be complete before
+       * any band of the vertical pass reads it. */
+      if (!ctx->scaler_special || ctx->in_fmt != SCALER_FMT_ARGB8888)
+         scaler_bands_run(ctx, bands, scaler_band_horiz,
+               output, input, ctx->in_height);
+
+      if (ctx->scaler_special)
+      {
+         if (ctx->in_fmt != SCALER_FMT_ARGB8888)
+         {
+            input_frame  = ctx->input.frame;
+            input_stride = ctx->input.stride;
+         }
+         if (ctx->out_fmt != SCALER_FMT_ARGB8888)
+         {
+            output_frame  = ctx->output.frame;
+            output_stride = ctx->output.stride;
+         }
+         ctx->scaler_special(ctx, output_frame, input_frame,
+               ctx->out_width, ctx->out_height,
+               ctx->in_width, ctx->in_height,
+               output_stride, input_stride);
+      }
+
+      if (!ctx->scaler_special || ctx->out_fmt != SCALER_FMT_ARGB8888)
+         scaler_bands_run(ctx, bands, scaler_band_vert,
+               output, input, ctx->out_height);
+      return;
+   }
+#endif
+
    if (ctx->in_fmt != SCALER_FMT_ARGB8888)
    {
       ctx->in_pixconv(ctx->input.frame, input,
@@ -349,7 +607,7 @@ void scaler_ctx_scale(struct scaler_ctx *ctx,
       if (ctx->scaler_horiz)
          ctx->scaler_horiz(ctx, input_frame, input_stride);
       if (ctx->scaler_vert)
-         ctx->scaler_vert (ctx, output, output_stride);
+         ctx->scaler_vert (ctx, output_frame, output_stride);
    }
 
    if (ctx->out_fmt != SCALER_FMT_ARGB8888)
@@ -33,6 +33,9 @@
 #ifdef _WIN32
 #include <intrin.h>
 #endif
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !defined(SCALER_NO_SIMD) && !defined(DONT_WANT_ARM_OPTIMIZATIONS)
+#include <arm_neon.h>
+#define SCALER_NEON
 #endif
 
 /* ARGB8888 scaler is split in two:
@@ -60,8 +63,24 @@
  *
  * The C version of scalers perform the exact same operations as the
  * SIMD code for testing purposes.
+ *
+ * The NEON version mirrors the SSE2 one - mulhi is a widening multiply
+ * followed by a narrowing shift by 16, and the even and odd filter taps
+ * are accumulated separately before being added together at the end,
+ * so that saturation happens at the exact same points.
  */
 
+/* Saturating 16-bit add, the scalar equivalent of _mm_adds_epi16. */
+static INLINE int16_t scaler_adds_16(int16_t a, int b)
+{
+   int res = a + b;
+   if (res > INT16_MAX)
+      return INT16_MAX;
+   if (res < INT16_MIN)
+      return INT16_MIN;
+   return (int16_t)res;
+}
+
 void scaler_argb8888_vert(const struct scaler_ctx *ctx, void *output_, int stride)
 {
    int h, w, y;
@@ -86,7 +105,7 @@ void scaler_argb8888_vert(const struct scaler_ctx *ctx, void *output_, int strid
          for (y = 0; (y + 1) < ctx->vert.filter_len; y += 2,
                input_base_y += (ctx->scaled.stride >> 2))
          {
-            __m128i coeff = _mm_set_epi64x(filter_vert[y + 1] * 0x0001000100010001ll, filter_vert[y + 0] * 0x0001000100010001ll);
+            __m128i coeff = _mm_set_epi64x((uint16_t)filter_vert[y + 1] * 0x0001000100010001ull, (uint16_t)filter_vert[y + 0] * 0x0001000100010001ull);
             __m128i col   = _mm_set_epi64x(input_base_y[ctx->scaled.stride >> 3], input_base_y[0]);
 
             res           = _mm_adds_epi16(_mm_mulhi_epi16(col, coeff), res);
@@ -94,7 +113,7 @@ void scaler_argb8888_vert(const struct scaler_ctx *ctx, void *output_, int strid
 
          for (; y < ctx->vert.filter_len; y++, input_base_y += (ctx->scaled.stride >> 3))
          {
-            __m128i coeff = _mm_set_epi64x(0, filter_vert[y] * 0x0001000100010001ll);
+            __m128i coeff = _mm_set_epi64x(0, (uint16_t)filter_vert[y] * 0x0001000100010001ull);
             __m128i col   = _mm_set_epi64x(0, input_base_y[0]);
 
             res           = _mm_adds_epi16(_mm_mulhi_epi16(col, coeff), res);
@@ -106,40 +125,60 @@ void scaler_argb8888_vert(const struct scaler_ctx *ctx, void *output_, int strid
          final     = _mm_packus_epi16(res, res);
 
          output[w] = _mm_cvtsi128_si32(final);
+#elif defined(SCALER_NEON)
+         uint8x8_t final;
+         int16x4_t res_lo = vdup_n_s16(0);
+         int16x4_t res_hi = vdup_n_s16(0);
+
+         for (y = 0; (y + 1) < ctx->vert.filter_len; y += 2,
+               input_base_y += (ctx->scaled.stride >> 2))
+         {
+            int16x4_t col_lo = vreinterpret_s16_u64(vld1_u64(input_base_y));
+            int16x4_t col_hi = vreinterpret_s16_u64(
+                  vld1_u64(input_base_y + (ctx->scaled.stride >> 3)));
+
+            res_lo           = vqadd_s16(vshrn_n_s32(
+                     vmull_n_s16(col_lo, filter_vert[y + 0]), 16), res_lo);
+            res_hi           = vqadd_s16(vshrn_n_s32(
+                     vmull_n_s16(col_hi, filter_vert[y + 1]), 16), res_hi);
+         }
+
+         for (; y < ctx->vert.filter_len; y++, input_base_y += (ctx->scaled.stride >> 3))
+         {
+            int16x4_t col    = vreinterpret_s16_u64(vld1_u64(input_base_y));
+
+            res_lo           = vqadd_s16(vshrn_n_s32(
+                     vmull_n_s16(col, filter_vert[y]), 16), res_lo);
+         }
+
+         res_lo    = vqadd_s16(res_hi, res_lo);
+         res_lo    = vshr_n_s16(res_lo, (7 - 2 - 2));
+
+         final     = vqmovun_s16(vcombine_s16(res_lo, res_lo));
+
+         output[w] = vget_lane_u32(vreinterpret_u32_u8(final), 0);
 #else
-         int16_t res_a = 0;
-         int16_t res_r = 0;
-         int16_t res_g = 0;
-         int16_t res_b = 0;
+         /* Even and odd taps are summed apart, like the two
+          * halves of the SIMD register. */
+         int16_t res[2][4] = {{0}};
+         int c;
 
          for (y = 0; y < ctx->vert.filter_len; y++,
                input_base_y += (ctx->scaled.stride >> 3))
          {
             uint64_t col   = *input_base_y;
-
-            int16_t a      = (col >> 48) & 0xffff;
-            int16_t r      = (col >> 32) & 0xffff;
-            int16_t g      = (col >> 16) & 0xffff;
-            int16_t b      = (col >>  0) & 0xffff;
-
             int16_t coeff  = filter_vert[y];
 
-            res_a         += (a * coeff) >> 16;
-            res_r         += (r * coeff) >> 16;
-            res_g         += (g * coeff) >> 16;
-            res_b         += (b * coeff) >> 16;
+            for (c = 0; c < 4; c++)
+               res[y & 1][c] = scaler_adds_16(res[y & 1][c],
+                     ((int16_t)(col >> (c * 16)) * coeff) >> 16);
          }
 
-         res_a           >>= (7 - 2 - 2);
-         res_r           >>= (7 - 2 - 2);
-         res_g           >>= (7 - 2 - 2);
-         res_b           >>= (7 - 2 - 2);
-
-         output[w]         =
-            (clamp_8bit(res_a) << 24) |
-            (clamp_8bit(res_r) << 16) |
-            (clamp_8bit(res_g) << 8)  |
-            (clamp_8bit(res_b) << 0);
+         output[w]         = 0;
+         for (c = 0; c < 4; c++)
+            output[w]     |= (uint32_t)clamp_8bit(
+                  scaler_adds_16(res[1][c], res[0][c]) >> (7 - 2 - 2))
+               << (c * 8);
 #endif
       }
    }
@@ -171,7 +210,7 @@ void scaler_argb8888_horiz(const struct scaler_ctx *ctx, const void *input_, int
 #endif
          for (x = 0; (x + 1) < ctx->horiz.filter_len; x += 2)
          {
-            __m128i coeff = _mm_set_epi64x(filter_horiz[x + 1] * 0x0001000100010001ll, filter_horiz[x + 0] * 0x0001000100010001ll);
+            __m128i coeff = _mm_set_epi64x((uint16_t)filter_horiz[x + 1] * 0x0001000100010001ull, (uint16_t)filter_horiz[x + 0] * 0x0001000100010001ull);
 
             __m128i col   = _mm_unpacklo_epi8(_mm_set_epi64x(0,
                      ((uint64_t)input_base_x[x + 1] << 32) | input_base_x[x + 0]), _mm_setzero_si128());
@@ -182,7 +221,7 @@ void scaler_argb8888_horiz(const struct scaler_ctx *ctx, const void *input_, int
 
          for (; x < ctx->horiz.filter_len; x++)
          {
-            __m128i coeff = _mm_set_epi64x(0, filter_horiz[x] * 0x0001000100010001ll);
+            __m128i coeff = _mm_set_epi64x(0, (uint16_t)filter_horiz[x] * 0x0001000100010001ull);
             __m128i col   = _mm_unpacklo_epi8(_mm_set_epi32(0, 0, 0, input_base_x[x]), _mm_setzero_si128());
 
             col           = _mm_slli_epi16(col, 7);
@@ -198,34 +237,51 @@ void scaler_argb8888_horiz(const struct scaler_ctx *ctx, const void *input_, int
          u.u32[0] = _mm_cvtsi128_si32(res);
          u.u32[1] = _mm_cvtsi128_si32(_mm_srli_si128(res, 4));
 #endif
+#elif defined(SCALER_NEON)
+         int16x4_t res_lo = vdup_n_s16(0);
+         int16x4_t res_hi = vdup_n_s16(0);
+
+         for (x = 0; (x + 1) < ctx->horiz.filter_len; x += 2)
+         {
+            /* Two pixels, expanded to 16 bits and shifted 7 to the left */
+            int16x8_t col    = vreinterpretq_s16_u16(vshll_n_u8(
+                     vreinterpret_u8_u32(vld1_u32(input_base_x + x)), 7));
+
+            res_lo           = vqadd_s16(vshrn_n_s32(vmull_n_s16(
+                        vget_low_s16(col), filter_horiz[x + 0]), 16), res_lo);
+            res_hi           = vqadd_s16(vshrn_n_s32(vmull_n_s16(
+                        vget_high_s16(col), filter_horiz[x + 1]), 16), res_hi);
+         }
+
+         for (; x < ctx->horiz.filter_len; x++)
+         {
+            int16x4_t col    = vget_low_s16(vreinterpretq_s16_u16(vshll_n_u8(
+                        vreinterpret_u8_u32(vdup_n_u32(input_base_x[x])), 7)));
+
+            res_lo           = vqadd_s16(vshrn_n_s32(
+                     vmull_n_s16(col, filter_horiz[x]), 16), res_lo);
+         }
+
+         output[w]        = vget_lane_u64(vreinterpret_u64_s16(
+                  vqadd_s16(res_hi, res_lo)), 0);
 #else
-         int16_t res_a = 0;
-         int16_t res_r = 0;
-         int16_t res_g = 0;
-         int16_t res_b = 0;
+         int16_t res[2][4] = {{0}};
+         int c;
 
          for (x = 0; x < ctx->horiz.filter_len; x++)
          {
             uint32_t col   = input_base_x[x];
-
-            int16_t a      = (col >> (24 - 7)) & (0xff << 7);
-            int16_t r      = (col >> (16 - 7)) & (0xff << 7);
-            int16_t g      = (col >> ( 8 - 7)) & (0xff << 7);
-            int16_t b      = (col << ( 0 + 7)) & (0xff << 7);
-
             int16_t coeff  = filter_horiz[x];
 
-            res_a         += (a * coeff) >> 16;
-            res_r         += (r * coeff) >> 16;
-            res_g         += (g * coeff) >> 16;
-            res_b         += (b * coeff) >> 16;
+            for (c = 0; c < 4; c++)
+               res[x & 1][c] = scaler_adds_16(res[x & 1][c],
+                     ((int16_t)(((col >> (c * 8)) & 0xff) << 7) * coeff) >> 16);
          }
 
-         output[w]         = (
-               (uint64_t)res_a  << 48)  |
-               ((uint64_t)res_r << 32)  |
-               ((uint64_t)res_g << 16)  |
-               ((uint64_t)res_b << 0);
+         output[w]         = 0;
+         for (c = 0; c < 4; c++)
+            output[w]     |= (uint64_t)(uint16_t)
+               scaler_adds_16(res[1][c], res[0][c]) << (c * 16);
 #endif
       }
    }
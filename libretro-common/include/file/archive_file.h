@@ -83,6 +83,7 @@ typedef struct
    char *valid_ext;
    char *callback_error;
    struct archive_extract_userdata *userdata;
+   bool parallel_unsupported;
 } decompress_state_t;
 
 struct archive_extract_userdata
@@ -132,6 +133,12 @@ struct file_archive_file_backend
    uint32_t (*stream_crc_calculate)(uint32_t, const uint8_t *, size_t);
    int64_t (*compressed_file_read)(const char *path, const char *needle, void **buf,
          const char *optional_outfile);
+   /* Optional: additional decompression contexts for an
+    * archive that is already open, so that several members
+    * can be extracted concurrently. Returns NULL if the
+    * backend cannot do this safely for this archive. */
+   void *(*stream_context_new)(file_archive_transfer_t *state);
+   void (*stream_context_free)(void *context);
    const char *ident;
 };
 
@@ -185,6 +192,41 @@ bool file_archive_perform_mode(const char *name, const char *valid_exts,
       const uint8_t *cdata, unsigned cmode, uint32_t csize, uint32_t size,
       uint32_t crc32, struct archive_extract_userdata *userdata);
 
+/**
+ * file_archive_stream_context_new:
+ * @state                       : archive transfer, past ARCHIVE_TRANSFER_INIT.
+ *
+ * Creates a decompression context that can extract members of
+ * the archive opened by @state independently of @state itself,
+ * e.g. on another thread. Must be freed with
+ * file_archive_stream_context_free() before @state is stopped.
+ *
+ * Returns: context, or NULL if the backend (or this particular
+ * archive) does not support concurrent extraction.
+ **/
+void *file_archive_stream_context_new(file_archive_transfer_t *state);
+
+void file_archive_stream_context_free(file_archive_transfer_t *state,
+      void *context);
+
+/**
+ * file_archive_extract_member:
+ * @state                       : archive transfer.
+ * @context                     : backend context to decompress with, either
+ *                                @state->context or one returned by
+ *                                file_archive_stream_context_new().
+ * @path                        : file to extract the member to.
+ *
+ * Same as file_archive_perform_mode(), with an explicit
+ * decompression context.
+ *
+ * Returns: true (1) on success, otherwise false (0).
+ **/
+bool file_archive_extract_member(file_archive_transfer_t *state,
+      void *context, const char *path,
+      const uint8_t *cdata, unsigned cmode, uint32_t csize, uint32_t size,
+      uint32_t crc32);
+
 int file_archive_compressed_read(
       const char* path, void **buf,
       const char* optional_filename, int64_t *length);
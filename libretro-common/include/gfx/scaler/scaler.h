@@ -73,6 +73,11 @@ struct scaler_ctx
    void (*direct_pixconv)(void*, const void*, int, int, int, int);
    struct scaler_filter horiz, vert;   /* ptr alignment */
 
+   /* Number of horizontal bands scaler_ctx_scale() splits
+    * the frame into over the shared thread pool (see
+    * tpool_shared()). 0 means scale serially. */
+   unsigned bands;
+
    struct
    {
       uint32_t *frame;
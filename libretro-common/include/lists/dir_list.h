@@ -30,6 +30,8 @@
 
 RETRO_BEGIN_DECLS
 
+typedef struct dir_list_reader dir_list_reader_t;
+
 /**
  * dir_list_append:
  * @list               : existing list to append to.
@@ -83,6 +85,21 @@ bool dir_list_initialize(struct string_list *list,
  **/
 void dir_list_sort(struct string_list *list, bool dir_first);
 
+/**
+ * dir_list_sort_merge:
+ * @list      : pointer to the directory listing.
+ * @sorted    : number of leading entries that are already sorted.
+ * @dir_first : move the directories in the listing to the top?
+ *
+ * Sorts the entries appended after the first @sorted ones and
+ * merges them into the sorted part, in dir_list_sort() order.
+ *
+ * Returns: false if memory for the merge could not be allocated,
+ * in which case the whole list is sorted instead.
+ **/
+bool dir_list_sort_merge(struct string_list *list, size_t sorted,
+      bool dir_first);
+
 /**
  * dir_list_free:
  * @list : pointer to the directory listing
@@ -94,6 +111,49 @@ void dir_list_free(struct string_list *list);
 
 bool dir_list_deinitialize(struct string_list *list);
 
+/**
+ * dir_list_reader_new:
+ * @dir                : directory path.
+ * @ext                : allowed extensions of file directory entries to include.
+ * @include_dirs       : include directories as part of the finished directory listing?
+ * @include_hidden     : include hidden files and directories as part of the finished directory listing?
+ * @include_compressed : Only include files which match ext. Do not try to match compressed files, etc.
+ *
+ * Opens a directory for reading it in batches with
+ * dir_list_reader_read(). Entries are filtered the same
+ * way as with dir_list_append(). Not recursive.
+ *
+ * Returns: reader handle, or NULL if the directory could not
+ * be opened. Has to be freed with dir_list_reader_free().
+ **/
+dir_list_reader_t *dir_list_reader_new(const char *dir,
+      const char *ext, bool include_dirs,
+      bool include_hidden, bool include_compressed);
+
+/**
+ * dir_list_reader_read:
+ * @reader      : reader handle.
+ * @list        : the string list to add files to.
+ * @max_entries : maximum number of entries to add.
+ *
+ * Reads the next entries of a directory, appending up
+ * to @max_entries of them to @list (unsorted).
+ *
+ * Returns: number of entries added, -1 on error. Fewer than
+ * @max_entries are only added once the end of the directory
+ * is reached.
+ **/
+int dir_list_reader_read(dir_list_reader_t *reader,
+      struct string_list *list, size_t max_entries);
+
+/**
+ * dir_list_reader_free:
+ * @reader : reader handle.
+ *
+ * Closes the directory and frees the reader.
+ **/
+void dir_list_reader_free(dir_list_reader_t *reader);
+
 RETRO_END_DECLS
 
 #endif
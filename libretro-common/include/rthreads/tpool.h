@@ -91,6 +91,43 @@ bool tpool_add_work(tpool_t *tp, thread_func_t func, void *arg);
  */
 void tpool_wait(tpool_t *tp);
 
+/**
+ * tpool_get_thread_count:
+ * @tp            : Thread pool.
+ *
+ * Returns: number of threads in the pool.
+ */
+size_t tpool_get_thread_count(tpool_t *tp);
+
+/**
+ * tpool_shared_init:
+ * @num           : Number of threads the shared pool should have.
+ *
+ * Create the process wide pool returned by tpool_shared(), for
+ * library code that splits short pieces of work over threads
+ * without owning a pool of its own. Does nothing if the shared
+ * pool already exists.
+ *
+ * Returns: true if the shared pool exists.
+ */
+bool tpool_shared_init(size_t num);
+
+/**
+ * tpool_shared_deinit:
+ *
+ * Destroy the shared pool. No work may be outstanding.
+ */
+void tpool_shared_deinit(void);
+
+/**
+ * tpool_shared:
+ *
+ * Returns: the shared pool, or NULL if tpool_shared_init()
+ * hasn't been called, in which case callers are expected to do
+ * their work on the calling thread.
+ */
+tpool_t *tpool_shared(void);
+
 RETRO_END_DECLS
 
 #endif
@@ -21,6 +21,7 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 
 #if defined(_WIN32) && defined(_XBOX)
 #include <xtl.h>
@@ -74,6 +75,71 @@ void dir_list_sort(struct string_list *list, bool dir_first)
             dir_first ? qstrcmp_dir : qstrcmp_plain);
 }
 
+/**
+ * dir_list_sort_merge:
+ * @list      : pointer to the directory listing.
+ * @sorted    : number of leading entries that are already sorted.
+ * @dir_first : move the directories in the listing to the top?
+ *
+ * Sorts the entries appended after the first @sorted ones and
+ * merges them into the sorted part, so that a listing that
+ * grows in batches can be kept sorted without sorting it
+ * again as a whole. The order matches dir_list_sort().
+ *
+ * Returns: false if memory for the merge could not be allocated,
+ * in which case the whole list is sorted instead.
+ **/
+bool dir_list_sort_merge(struct string_list *list, size_t sorted,
+      bool dir_first)
+{
+   size_t i, j, k, count;
+   struct string_list_elem *head = NULL;
+   int (*cmp)(const void*, const void*) = dir_first
+      ? qstrcmp_dir : qstrcmp_plain;
+
+   if (!list || sorted >= list->size)
+      return true;
+
+   count = list->size - sorted;
+   qsort(list->elems + sorted, count,
+         sizeof(struct string_list_elem), cmp);
+
+   /* Nothing to merge, or the batch already sorts after
+    * everything that was listed before it */
+   if (sorted == 0 ||
+         cmp(&list->elems[sorted - 1], &list->elems[sorted]) <= 0)
+      return true;
+
+   /* Merge from a copy of the sorted part into the list */
+   if (!(head = (struct string_list_elem*)
+            malloc(sorted * sizeof(*head))))
+   {
+      dir_list_sort(list, dir_first);
+      return false;
+   }
+
+   memcpy(head, list->elems, sorted * sizeof(*head));
+
+   i = 0;
+   j = sorted;
+   k = 0;
+
+   while (i < sorted && j < list->size)
+   {
+      /* Take from the sorted part on ties, keeping the merge stable */
+      if (cmp(&list->elems[j], &head[i]) < 0)
+         list->elems[k++] = list->elems[j++];
+      else
+         list->elems[k++] = head[i++];
+   }
+
+   while (i < sorted)
+      list->elems[k++] = head[i++];
+
+   free(head);
+   return true;
+}
+
 /**
  * dir_list_free:
  * @list : pointer to the directory listing
@@ -93,6 +159,97 @@ bool dir_list_deinitialize(struct string_list *list)
    return string_list_deinitialize(list);
 }
 
+struct dir_list_reader
+{
+   struct RDIR *entry;
+   char *dir;
+   struct string_list ext_list;
+   bool has_ext_list;
+   bool include_dirs;
+   bool include_hidden;
+   bool include_compressed;
+};
+
+/**
+ * dir_list_read_entry:
+ * @entry              : directory handle positioned on an entry.
+ * @dir                : path of the directory being read.
+ * @ext_list           : the string list of extensions to include
+ * @include_hidden     : include hidden files and directories?
+ * @include_compressed : Only include files which match ext. Do not try to match compressed files, etc.
+ * @file_path          : receives the full path of the entry.
+ * @len                : size of @file_path.
+ * @attr               : receives the type of the entry.
+ *
+ * Classifies the current entry of a directory. Whether the
+ * entry is a directory comes from the dirent type where the
+ * file system provides one, so this does not stat() files.
+ *
+ * Returns: false if the entry is not to be listed. Directories
+ * are always returned, so that callers can recurse into them.
+ **/
+static bool dir_list_read_entry(struct RDIR *entry, const char *dir,
+      struct string_list *ext_list, bool include_hidden,
+      bool include_compressed, char *file_path, size_t len,
+      union string_list_elem_attr *attr)
+{
+   const char *name = retro_dirent_get_name(entry);
+
+   if (name[0] == '.')
+   {
+      /* Do not include hidden files and directories */
+      if (!include_hidden)
+         return false;
+
+      /* char-wise comparisons to avoid string comparison */
+
+      /* Do not include current dir */
+      if (name[1] == '\0')
+         return false;
+      /* Do not include parent dir */
+      if (name[1] == '.' && name[2] == '\0')
+         return false;
+   }
+
+   file_path[0] = '\0';
+   fill_pathname_join(file_path, dir, name, len);
+
+   if (retro_dirent_is_dir(entry, NULL))
+   {
+      attr->i = RARCH_DIRECTORY;
+      return true;
+   }
+   else
+   {
+      const char *file_ext    = path_get_extension(name);
+
+      attr->i                 = RARCH_FILETYPE_UNSET;
+
+      /*
+       * If the file format is explicitly supported by the libretro-core, we
+       * need to immediately load it and not designate it as a compressed file.
+       *
+       * Example: .zip could be supported as a image by the core and as a
+       * compressed_file. In that case, we have to interpret it as a image.
+       *
+       * */
+      if (string_list_find_elem_prefix(ext_list, ".", file_ext))
+         attr->i            = RARCH_PLAIN_FILE;
+      else
+      {
+         bool is_compressed_file;
+         if ((is_compressed_file = path_is_compressed_file(file_path)))
+            attr->i               = RARCH_COMPRESSED_ARCHIVE;
+
+         if (ext_list &&
+               (!is_compressed_file || !include_compressed))
+            return false;
+      }
+   }
+
+   return true;
+}
+
 /**
  * dir_list_read:
  * @dir                : directory path.
@@ -121,28 +278,12 @@ static int dir_list_read(const char *dir,
    {
       union string_list_elem_attr attr;
       char file_path[PATH_MAX_LENGTH];
-      const char *name                = retro_dirent_get_name(entry);
 
-      if (name[0] == '.')
-      {
-         /* Do not include hidden files and directories */
-         if (!include_hidden)
-            continue;
-
-         /* char-wise comparisons to avoid string comparison */
-
-         /* Do not include current dir */
-         if (name[1] == '\0')
-            continue;
-         /* Do not include parent dir */
-         if (name[1] == '.' && name[2] == '\0')
-            continue;
-      }
+      if (!dir_list_read_entry(entry, dir, ext_list, include_hidden,
+               include_compressed, file_path, sizeof(file_path), &attr))
+         continue;
 
-      file_path[0] = '\0';
-      fill_pathname_join(file_path, dir, name, sizeof(file_path));
-
-      if (retro_dirent_is_dir(entry, NULL))
+      if (attr.i == RARCH_DIRECTORY)
       {
          if (recursive)
             dir_list_read(file_path, list, ext_list, include_dirs,
@@ -150,34 +291,6 @@ static int dir_list_read(const char *dir,
 
          if (!include_dirs)
             continue;
-         attr.i = RARCH_DIRECTORY;
-      }
-      else
-      {
-         const char *file_ext    = path_get_extension(name);
-
-         attr.i                  = RARCH_FILETYPE_UNSET;
-
-         /*
-          * If the file format is explicitly supported by the libretro-core, we
-          * need to immediately load it and not designate it as a compressed file.
-          *
-          * Example: .zip could be supported as a image by the core and as a
-          * compressed_file. In that case, we have to interpret it as a image.
-          *
-          * */
-         if (string_list_find_elem_prefix(ext_list, ".", file_ext))
-            attr.i            = RARCH_PLAIN_FILE;
-         else
-         {
-            bool is_compressed_file;
-            if ((is_compressed_file = path_is_compressed_file(file_path)))
-               attr.i               = RARCH_COMPRESSED_ARCHIVE;
-
-            if (ext_list &&
-                  (!is_compressed_file || !include_compressed))
-               continue;
-         }
       }
 
       if (!string_list_append(list, file_path, attr))
@@ -278,3 +391,131 @@ bool dir_list_initialize(struct string_list *list,
    return dir_list_append(list, dir, ext, include_dirs,
             include_hidden, include_compressed, recursive);
 }
+
+/**
+ * dir_list_reader_new:
+ * @dir                : directory path.
+ * @ext                : allowed extensions of file directory entries to include.
+ * @include_dirs       : include directories as part of the finished directory listing?
+ * @include_hidden     : include hidden files and directories as part of the finished directory listing?
+ * @include_compressed : Only include files which match ext. Do not try to match compressed files, etc.
+ *
+ * Opens a directory for reading it in batches with
+ * dir_list_reader_read(). Entries are filtered the same
+ * way as with dir_list_append(). Not recursive.
+ *
+ * Returns: reader handle, or NULL if the directory could not
+ * be opened. Has to be freed with dir_list_reader_free().
+ **/
+dir_list_reader_t *dir_list_reader_new(const char *dir,
+      const char *ext, bool include_dirs,
+      bool include_hidden, bool include_compressed)
+{
+   dir_list_reader_t *reader = NULL;
+   struct RDIR *entry        = NULL;
+
+   if (string_is_empty(dir))
+      return NULL;
+
+   entry = retro_opendir_include_hidden(dir, include_hidden);
+
+   if (!entry || retro_dirent_error(entry))
+      goto error;
+
+   if (!(reader = (dir_list_reader_t*)calloc(1, sizeof(*reader))))
+      goto error;
+
+   if (!(reader->dir = strdup(dir)))
+      goto error;
+
+   reader->entry              = entry;
+   reader->include_dirs       = include_dirs;
+   reader->include_hidden     = include_hidden;
+   reader->include_compressed = include_compressed;
+
+   if (ext)
+   {
+      string_list_initialize(&reader->ext_list);
+      string_split_noalloc(&reader->ext_list, ext, "|");
+      reader->has_ext_list    = true;
+   }
+
+   return reader;
+
+error:
+   if (entry)
+      retro_closedir(entry);
+   if (reader)
+      free(reader);
+   return NULL;
+}
+
+/**
+ * dir_list_reader_read:
+ * @reader      : reader handle.
+ * @list        : the string list to add files to.
+ * @max_entries : maximum number of entries to add.
+ *
+ * Reads the next entries of a directory, appending up
+ * to @max_entries of them to @list (unsorted).
+ *
+ * Returns: number of entries added, -1 on error. Fewer than
+ * @max_entries are only added once the end of the directory
+ * is reached.
+ **/
+int dir_list_reader_read(dir_list_reader_t *reader,
+      struct string_list *list, size_t max_entries)
+{
+   size_t added = 0;
+
+   if (!reader || !reader->entry)
+      return 0;
+
+   while (added < max_entries)
+   {
+      union string_list_elem_attr attr;
+      char file_path[PATH_MAX_LENGTH];
+
+      if (!retro_readdir(reader->entry))
+      {
+         retro_closedir(reader->entry);
+         reader->entry = NULL;
+         break;
+      }
+
+      if (!dir_list_read_entry(reader->entry, reader->dir,
+               reader->has_ext_list ? &reader->ext_list : NULL,
+               reader->include_hidden, reader->include_compressed,
+               file_path, sizeof(file_path), &attr))
+         continue;
+
+      if (attr.i == RARCH_DIRECTORY && !reader->include_dirs)
+         continue;
+
+      if (!string_list_append(list, file_path, attr))
+         return -1;
+
+      added++;
+   }
+
+   return (int)added;
+}
+
+/**
+ * dir_list_reader_free:
+ * @reader : reader handle.
+ *
+ * Closes the directory and frees the reader.
+ **/
+void dir_list_reader_free(dir_list_reader_t *reader)
+{
+   if (!reader)
+      return;
+
+   if (reader->entry)
+      retro_closedir(reader->entry);
+   if (reader->has_ext_list)
+      string_list_deinitialize(&reader->ext_list);
+   free(reader->dir);
+   free(reader);
+}
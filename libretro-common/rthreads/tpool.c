@@ -56,6 +56,9 @@ struct tpool
    bool             stop;         /* Marker to tell the work threads to exit. */
 };
 
+/* See tpool_shared() */
+static tpool_t *tpool_shared_pool = NULL;
+
 static tpool_work_t *tpool_work_create(thread_func_t func, void *arg)
 {
    tpool_work_t *work;
@@ -258,7 +261,8 @@ void tpool_wait(tpool_t *tp)
       /* working_cond is dual use. It signals when we're not stopping but the
        * working_cnt is 0 indicating there isn't any work processing. If we
        * are stopping it will trigger when there aren't any threads running. */
-      if ((!tp->stop && tp->working_cnt != 0) || (tp->stop && tp->thread_cnt != 0))
+      if (     (!tp->stop && (tp->working_cnt != 0 || tp->work_first))
+            || (tp->stop && tp->thread_cnt != 0))
          scond_wait(tp->working_cond, tp->work_mutex);
       else
          break;
@@ -266,3 +270,35 @@ void tpool_wait(tpool_t *tp)
 
    slock_unlock(tp->work_mutex);
 }
+
+size_t tpool_get_thread_count(tpool_t *tp)
+{
+   size_t num;
+
+   if (!tp)
+      return 0;
+
+   slock_lock(tp->work_mutex);
+   num = tp->thread_cnt;
+   slock_unlock(tp->work_mutex);
+
+   return num;
+}
+
+bool tpool_shared_init(size_t num)
+{
+   if (!tpool_shared_pool)
+      tpool_shared_pool = tpool_create(num);
+   return tpool_shared_pool != NULL;
+}
+
+void tpool_shared_deinit(void)
+{
+   tpool_destroy(tpool_shared_pool);
+   tpool_shared_pool = NULL;
+}
+
+tpool_t *tpool_shared(void)
+{
+   return tpool_shared_pool;
+}
@@ -0,0 +1,172 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (rjpeg_test.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <boolean.h>
+#include <formats/rjpeg.h>
+#include <formats/image.h>
+#include <features/features_cpu.h>
+#ifdef HAVE_THREADS
+#include <rthreads/tpool.h>
+#endif
+
+static bool read_file(const char *path, uint8_t **data, size_t *len)
+{
+   long size;
+   FILE *file = fopen(path, "rb");
+
+   if (!file)
+      return false;
+
+   fseek(file, 0, SEEK_END);
+   size = ftell(file);
+   fseek(file, 0, SEEK_SET);
+
+   *data = (uint8_t*)malloc(size > 0 ? size : 1);
+   *len  = size > 0 ? (size_t)size : 0;
+
+   if (!*data || fread(*data, 1, *len, file) != *len)
+   {
+      free(*data);
+      *data = NULL;
+      fclose(file);
+      return false;
+   }
+
+   fclose(file);
+   return true;
+}
+
+static bool rjpeg_load_image_argb(const uint8_t *buf, size_t len,
+      uint32_t **data, unsigned *width, unsigned *height)
+{
+   int retval;
+   rjpeg_t *rjpeg = rjpeg_alloc();
+
+   if (!rjpeg)
+      return false;
+
+   if (!rjpeg_set_buf_ptr(rjpeg, (void*)buf))
+   {
+      rjpeg_free(rjpeg);
+      return false;
+   }
+
+   retval = rjpeg_process_image(rjpeg, (void**)data, len, width, height);
+   rjpeg_free(rjpeg);
+
+   return retval != IMAGE_PROCESS_ERROR && retval != IMAGE_PROCESS_ERROR_END;
+}
+
+/* Decodes an image with and without the shared thread
+ * pool, the results have to be identical. Also reports
+ * how long each decode took */
+static int test_rjpeg(const char *in_path)
+{
+   uint8_t *buf       = NULL;
+   size_t len         = 0;
+   uint32_t *seq_data = NULL;
+   uint32_t *par_data = NULL;
+   unsigned seq_width = 0, seq_height = 0;
+   unsigned par_width = 0, par_height = 0;
+   retro_time_t seq_time, par_time = 0;
+   int ret            = 0;
+
+   if (!read_file(in_path, &buf, &len))
+      return 1;
+
+#ifdef HAVE_THREADS
+   tpool_shared_deinit();
+#endif
+
+   seq_time = cpu_features_get_time_usec();
+   if (!rjpeg_load_image_argb(buf, len, &seq_data, &seq_width, &seq_height))
+   {
+      free(buf);
+      return 2;
+   }
+   seq_time = cpu_features_get_time_usec() - seq_time;
+
+#ifdef HAVE_THREADS
+   if (!tpool_shared_init(4))
+      ret = 3;
+   else
+   {
+      par_time = cpu_features_get_time_usec();
+      if (!rjpeg_load_image_argb(buf, len,
+               &par_data, &par_width, &par_height))
+         ret = 4;
+      par_time = cpu_features_get_time_usec() - par_time;
+   }
+
+   if (ret)
+      ;
+   else if (seq_width != par_width || seq_height != par_height)
+      ret = 5;
+   else if (memcmp(seq_data, par_data,
+            seq_width * seq_height * sizeof(uint32_t)) != 0)
+      ret = 6;
+#endif
+
+   fprintf(stderr, "%s (%u x %u): sequential %u us, threaded %u us, %s.\n",
+         in_path, seq_width, seq_height,
+         (unsigned)seq_time, (unsigned)par_time,
+         ret ? "differ" : "equivalent");
+
+   free(buf);
+   free(seq_data);
+   free(par_data);
+
+   return ret;
+}
+
+int main(int argc, char *argv[])
+{
+   int i;
+
+   if (argc < 2)
+   {
+      fprintf(stderr, "Usage: %s <jpeg files...>\n", argv[0]);
+      return 1;
+   }
+
+   fprintf(stderr, "Doing tests...\n");
+
+   for (i = 1; i < argc; i++)
+   {
+      if (test_rjpeg(argv[i]) != 0)
+      {
+         fprintf(stderr, "Test failed.\n");
+         return -1;
+      }
+   }
+
+#ifdef HAVE_THREADS
+   tpool_shared_deinit();
+#endif
+
+   return 0;
+}
@@ -31,6 +31,9 @@
 #include <file/nbio.h>
 #include <formats/rpng.h>
 #include <formats/image.h>
+#ifdef HAVE_THREADS
+#include <rthreads/tpool.h>
+#endif
 
 static bool rpng_load_image_argb(const char *path, uint32_t **data,
       unsigned *width, unsigned *height)
@@ -182,17 +185,121 @@ static int test_rpng(const char *in_path)
    return 0;
 }
 
+#ifdef HAVE_THREADS
+/* Images big enough to be inflated on the thread pool */
+static const char *corpus_paths[] = {
+   "/tmp/test_noise.png",
+   "/tmp/test_gradient.png",
+   "/tmp/test_odd.png",
+};
+
+static bool make_corpus(void)
+{
+   unsigned i, x, y;
+   static const unsigned sizes[][2] = {
+      { 640, 480 }, { 1024, 1024 }, { 1023, 257 } };
+   uint32_t seed = 1;
+
+   for (i = 0; i < sizeof(corpus_paths) / sizeof(corpus_paths[0]); i++)
+   {
+      bool ok;
+      unsigned width  = sizes[i][0];
+      unsigned height = sizes[i][1];
+      uint32_t *data  = (uint32_t*)malloc(width * height * sizeof(uint32_t));
+
+      if (!data)
+         return false;
+
+      for (y = 0; y < height; y++)
+      {
+         for (x = 0; x < width; x++)
+         {
+            uint32_t *pixel = &data[y * width + x];
+
+            seed = seed * 1103515245 + 12345;
+
+            switch (i)
+            {
+               case 0:
+                  /* Incompressible, every filter type ends up in use */
+                  *pixel = (seed >> 8) | 0xff000000;
+                  break;
+               case 1:
+                  *pixel = ((x * 255 / width) << 16)
+                     | ((y * 255 / height) << 8)
+                     | ((x ^ y) & 0xff)
+                     | (((x + y) & 0xff) << 24);
+                  break;
+               default:
+                  /* Mostly flat with some noise */
+                  *pixel = ((seed >> 16) & 0x0f0f0f) | 0x80404040;
+                  break;
+            }
+         }
+      }
+
+      ok = rpng_save_image_argb(corpus_paths[i], data,
+            width, height, width * sizeof(uint32_t));
+      free(data);
+
+      if (!ok)
+         return false;
+   }
+
+   return true;
+}
+
+/* Decodes an image with and without the shared thread
+ * pool, the results have to be identical */
+static int test_rpng_threaded(const char *in_path)
+{
+   uint32_t *seq_data = NULL;
+   uint32_t *par_data = NULL;
+   unsigned seq_width = 0, seq_height = 0;
+   unsigned par_width = 0, par_height = 0;
+   int ret            = 0;
+
+   tpool_shared_deinit();
+
+   if (!rpng_load_image_argb(in_path, &seq_data, &seq_width, &seq_height))
+      return 1;
+
+   if (!tpool_shared_init(4))
+      ret = 2;
+   else if (!rpng_load_image_argb(in_path,
+            &par_data, &par_width, &par_height))
+      ret = 3;
+   else if (seq_width != par_width || seq_height != par_height)
+      ret = 4;
+   else if (memcmp(seq_data, par_data,
+            seq_width * seq_height * sizeof(uint32_t)) != 0)
+      ret = 5;
+
+   fprintf(stderr, "%s (%u x %u): sequential and threaded decode %s.\n",
+         in_path, seq_width, seq_height, ret ? "differ" : "are equivalent");
+
+   free(seq_data);
+   free(par_data);
+
+   return ret;
+}
+#endif
+
 int main(int argc, char *argv[])
 {
+#ifdef HAVE_THREADS
+   int i;
+#endif
    const char *in_path = "/tmp/test.png";
 
-   if (argc > 2)
+   if (argc >= 2 && !strcmp(argv[1], "-h"))
    {
-      fprintf(stderr, "Usage: %s <png file>\n", argv[0]);
+      fprintf(stderr, "Usage: %s [png file] [png files to compare "
+            "threaded decoding on...]\n", argv[0]);
       return 1;
    }
 
-   if (argc == 2)
+   if (argc >= 2)
       in_path = argv[1];
 
    fprintf(stderr, "Doing tests...\n");
@@ -203,5 +310,33 @@ int main(int argc, char *argv[])
       return -1;
    }
 
+#ifdef HAVE_THREADS
+   if (!make_corpus())
+   {
+      fprintf(stderr, "Failed to write test images.\n");
+      return -1;
+   }
+
+   for (i = 0; i < (int)(sizeof(corpus_paths) / sizeof(corpus_paths[0])); i++)
+   {
+      if (test_rpng_threaded(corpus_paths[i]) != 0)
+      {
+         fprintf(stderr, "Test failed.\n");
+         return -1;
+      }
+   }
+
+   for (i = 1; i < argc; i++)
+   {
+      if (test_rpng_threaded(argv[i]) != 0)
+      {
+         fprintf(stderr, "Test failed.\n");
+         return -1;
+      }
+   }
+
+   tpool_shared_deinit();
+#endif
+
    return 0;
 }
@@ -0,0 +1,370 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (scaler_test.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Runs every pixel converter and every scaler/format
+ * combination over the same pseudo-random frames.
+ *
+ * The sample is built twice: once with SCALER_NO_SIMD,
+ * which writes the output of the C code to a reference
+ * file, and once with the SIMD (and threaded) code, which
+ * memcmps its output against that file. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <boolean.h>
+#include <gfx/scaler/scaler.h>
+#include <gfx/scaler/pixconv.h>
+#ifdef HAVE_THREADS
+#include <rthreads/tpool.h>
+#endif
+
+/* Written around each output to catch overruns */
+#define GUARD_BYTE  0xa5
+#define GUARD_SIZE  64
+
+typedef void (*pixconv_func)(void *output, const void *input,
+      int width, int height, int out_stride, int in_stride);
+
+struct pixconv_test
+{
+   const char *name;
+   pixconv_func func;
+   enum scaler_pix_fmt in_fmt;
+   enum scaler_pix_fmt out_fmt;
+};
+
+static const struct pixconv_test pixconv_tests[] = {
+   { "0rgb1555_argb8888", conv_0rgb1555_argb8888,
+      SCALER_FMT_0RGB1555, SCALER_FMT_ARGB8888 },
+   { "0rgb1555_rgb565",   conv_0rgb1555_rgb565,
+      SCALER_FMT_0RGB1555, SCALER_FMT_RGB565 },
+   { "rgb565_0rgb1555",   conv_rgb565_0rgb1555,
+      SCALER_FMT_RGB565,   SCALER_FMT_0RGB1555 },
+   { "rgb565_abgr8888",   conv_rgb565_abgr8888,
+      SCALER_FMT_RGB565,   SCALER_FMT_ABGR8888 },
+   { "rgb565_argb8888",   conv_rgb565_argb8888,
+      SCALER_FMT_RGB565,   SCALER_FMT_ARGB8888 },
+   { "rgba4444_argb8888", conv_rgba4444_argb8888,
+      SCALER_FMT_RGBA4444, SCALER_FMT_ARGB8888 },
+   { "rgba4444_rgb565",   conv_rgba4444_rgb565,
+      SCALER_FMT_RGBA4444, SCALER_FMT_RGB565 },
+   { "bgr24_argb8888",    conv_bgr24_argb8888,
+      SCALER_FMT_BGR24,    SCALER_FMT_ARGB8888 },
+   { "bgr24_rgb565",      conv_bgr24_rgb565,
+      SCALER_FMT_BGR24,    SCALER_FMT_RGB565 },
+   { "argb8888_0rgb1555", conv_argb8888_0rgb1555,
+      SCALER_FMT_ARGB8888, SCALER_FMT_0RGB1555 },
+   { "argb8888_rgba4444", conv_argb8888_rgba4444,
+      SCALER_FMT_ARGB8888, SCALER_FMT_RGBA4444 },
+   { "argb8888_bgr24",    conv_argb8888_bgr24,
+      SCALER_FMT_ARGB8888, SCALER_FMT_BGR24 },
+   { "abgr8888_bgr24",    conv_abgr8888_bgr24,
+      SCALER_FMT_ABGR8888, SCALER_FMT_BGR24 },
+   { "argb8888_abgr8888", conv_argb8888_abgr8888,
+      SCALER_FMT_ARGB8888, SCALER_FMT_ABGR8888 },
+   { "0rgb1555_bgr24",    conv_0rgb1555_bgr24,
+      SCALER_FMT_0RGB1555, SCALER_FMT_BGR24 },
+   { "rgb565_bgr24",      conv_rgb565_bgr24,
+      SCALER_FMT_RGB565,   SCALER_FMT_BGR24 },
+   { "yuyv_argb8888",     conv_yuyv_argb8888,
+      SCALER_FMT_YUYV,     SCALER_FMT_ARGB8888 },
+};
+
+static const char *fmt_names[] = {
+   "argb8888", "abgr8888", "0rgb1555", "rgb565",
+   "bgr24", "yuyv", "rgba4444"
+};
+
+static const char *scaler_names[] = {
+   "unknown", "point", "bilinear", "sinc"
+};
+
+/* Widths are odd and not multiples of the SIMD
+ * widths so that the scalar tails run too. The last
+ * frame size is big enough to be scaled in bands */
+static const int sizes[][2] = {
+   { 1,   1   },
+   { 7,   3   },
+   { 61,  37  },
+   { 331, 247 }
+};
+
+static FILE *ref_file  = NULL;
+static bool ref_write  = false;
+static unsigned tests  = 0;
+static unsigned failed = 0;
+
+static int fmt_bpp(enum scaler_pix_fmt fmt)
+{
+   switch (fmt)
+   {
+      case SCALER_FMT_ARGB8888:
+      case SCALER_FMT_ABGR8888:
+         return 4;
+      case SCALER_FMT_BGR24:
+         return 3;
+      default:
+         break;
+   }
+
+   return 2;
+}
+
+static uint8_t *random_frame(size_t size, uint32_t seed)
+{
+   size_t i;
+   uint8_t *frame = (uint8_t*)malloc(size);
+
+   if (!frame)
+      return NULL;
+
+   for (i = 0; i < size; i++)
+   {
+      seed     = seed * 1103515245 + 12345;
+      frame[i] = (uint8_t)(seed >> 16);
+   }
+
+   return frame;
+}
+
+/* Writes the output to the reference file, or compares it
+ * against the one stored there */
+static void check_output(const char *name,
+      const uint8_t *output, size_t size)
+{
+   size_t i;
+   char ref_name[128];
+   uint32_t ref_size = 0;
+   uint8_t *ref      = NULL;
+
+   tests++;
+
+   for (i = 0; i < GUARD_SIZE; i++)
+   {
+      if (output[size + i] != GUARD_BYTE)
+      {
+         fprintf(stderr, "%s: wrote past the end of the frame.\n", name);
+         failed++;
+         return;
+      }
+   }
+
+   if (ref_write)
+   {
+      uint32_t out_size = (uint32_t)size;
+      memset(ref_name, 0, sizeof(ref_name));
+      strncpy(ref_name, name, sizeof(ref_name) - 1);
+      fwrite(ref_name, 1, sizeof(ref_name), ref_file);
+      fwrite(&out_size, 1, sizeof(out_size), ref_file);
+      fwrite(output, 1, size, ref_file);
+      return;
+   }
+
+   if (     fread(ref_name, 1, sizeof(ref_name), ref_file) != sizeof(ref_name)
+         || fread(&ref_size, 1, sizeof(ref_size), ref_file) != sizeof(ref_size)
+         || strncmp(ref_name, name, sizeof(ref_name))
+         || ref_size != size)
+   {
+      fprintf(stderr, "%s: reference file doesn't match this test.\n", name);
+      exit(1);
+   }
+
+   if (!(ref = (uint8_t*)malloc(size ? size : 1))
+         || fread(ref, 1, size, ref_file) != size)
+   {
+      fprintf(stderr, "%s: reference file is truncated.\n", name);
+      exit(1);
+   }
+
+   if (memcmp(ref, output, size))
+   {
+      for (i = 0; i < size && ref[i] == output[i]; i++);
+      fprintf(stderr, "%s: differs from the C path at byte %u "
+            "(%02x, expected %02x).\n",
+            name, (unsigned)i, output[i], ref[i]);
+      failed++;
+   }
+
+   free(ref);
+}
+
+static void test_pixconv(const struct pixconv_test *test,
+      int width, int height)
+{
+   char name[128];
+   int in_bpp        = fmt_bpp(test->in_fmt);
+   int out_bpp       = fmt_bpp(test->out_fmt);
+   /* Padded, unaligned row strides */
+   int in_stride     = width * in_bpp + 6;
+   int out_stride    = width * out_bpp + 10;
+   size_t out_size   = (size_t)out_stride * height;
+   uint8_t *input    = random_frame((size_t)in_stride * height,
+         width * 131 + height);
+   uint8_t *output   = (uint8_t*)malloc(out_size + GUARD_SIZE);
+
+   /* YUYV macropixels cover two pixels */
+   if (test->in_fmt == SCALER_FMT_YUYV)
+      width &= ~1;
+
+   if (input && output && width)
+   {
+      memset(output, GUARD_BYTE, out_size + GUARD_SIZE);
+      test->func(output, input, width, height, out_stride, in_stride);
+
+      snprintf(name, sizeof(name), "conv_%s %dx%d",
+            test->name, width, height);
+      check_output(name, output, out_size);
+   }
+
+   free(input);
+   free(output);
+}
+
+static void test_scaler(enum scaler_type type,
+      enum scaler_pix_fmt in_fmt, enum scaler_pix_fmt out_fmt,
+      int in_width, int in_height, int out_width, int out_height)
+{
+   char name[128];
+   struct scaler_ctx ctx;
+   size_t out_size;
+   uint8_t *input  = NULL;
+   uint8_t *output = NULL;
+
+   memset(&ctx, 0, sizeof(ctx));
+   ctx.scaler_type = type;
+   ctx.in_fmt      = in_fmt;
+   ctx.out_fmt     = out_fmt;
+   ctx.in_width    = in_width;
+   ctx.in_height   = in_height;
+   ctx.in_stride   = in_width * fmt_bpp(in_fmt) + 6;
+   ctx.out_width   = out_width;
+   ctx.out_height  = out_height;
+   ctx.out_stride  = out_width * fmt_bpp(out_fmt) + 10;
+
+   /* Not every combination is supported, the same
+    * ones are skipped by both builds */
+   if (!scaler_ctx_gen_filter(&ctx))
+   {
+      scaler_ctx_gen_reset(&ctx);
+      return;
+   }
+
+   out_size = (size_t)ctx.out_stride * out_height;
+   input    = random_frame((size_t)ctx.in_stride * in_height,
+         in_width * 7 + in_height * 3 + in_fmt);
+   output   = (uint8_t*)malloc(out_size + GUARD_SIZE);
+
+   if (input && output)
+   {
+      memset(output, GUARD_BYTE, out_size + GUARD_SIZE);
+
+      if (ctx.unscaled)
+         ctx.direct_pixconv(output, input, out_width, out_height,
+               ctx.out_stride, ctx.in_stride);
+      else
+         scaler_ctx_scale(&ctx, output, input);
+
+      snprintf(name, sizeof(name), "%s %s->%s %dx%d->%dx%d",
+            scaler_names[type], fmt_names[in_fmt], fmt_names[out_fmt],
+            in_width, in_height, out_width, out_height);
+      check_output(name, output, out_size);
+   }
+
+   free(input);
+   free(output);
+   scaler_ctx_gen_reset(&ctx);
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned i, j;
+   int type, in_fmt, out_fmt;
+
+   if (argc == 3 && !strcmp(argv[1], "-w"))
+      ref_write = true;
+   else if (argc != 2)
+   {
+      fprintf(stderr, "Usage: %s [-w] <reference file>\n", argv[0]);
+      return 1;
+   }
+
+   if (!(ref_file = fopen(argv[argc - 1], ref_write ? "wb" : "rb")))
+   {
+      fprintf(stderr, "Can't open %s.\n", argv[argc - 1]);
+      return 1;
+   }
+
+#ifdef HAVE_THREADS
+   /* Large frames are scaled in bands over the shared pool */
+   tpool_shared_init(4);
+#endif
+
+   for (i = 0; i < sizeof(pixconv_tests) / sizeof(pixconv_tests[0]); i++)
+      for (j = 0; j < sizeof(sizes) / sizeof(sizes[0]); j++)
+         test_pixconv(&pixconv_tests[i], sizes[j][0], sizes[j][1]);
+
+   for (type = SCALER_TYPE_POINT; type <= SCALER_TYPE_SINC; type++)
+   {
+      for (in_fmt = SCALER_FMT_ARGB8888; in_fmt <= SCALER_FMT_RGBA4444; in_fmt++)
+      {
+         for (out_fmt = SCALER_FMT_ARGB8888; out_fmt <= SCALER_FMT_RGBA4444; out_fmt++)
+         {
+            for (j = 1; j < sizeof(sizes) / sizeof(sizes[0]); j++)
+            {
+               int width  = sizes[j][0];
+               int height = sizes[j][1];
+
+               /* Upscale, downscale and unscaled */
+               test_scaler((enum scaler_type)type,
+                     (enum scaler_pix_fmt)in_fmt,
+                     (enum scaler_pix_fmt)out_fmt,
+                     width, height, width * 2 + 1, height * 3 / 2);
+               test_scaler((enum scaler_type)type,
+                     (enum scaler_pix_fmt)in_fmt,
+                     (enum scaler_pix_fmt)out_fmt,
+                     width, height, width / 2 + 1, height / 3 + 1);
+               test_scaler((enum scaler_type)type,
+                     (enum scaler_pix_fmt)in_fmt,
+                     (enum scaler_pix_fmt)out_fmt,
+                     width, height, width, height);
+            }
+         }
+      }
+   }
+
+   fclose(ref_file);
+
+#ifdef HAVE_THREADS
+   tpool_shared_deinit();
+#endif
+
+   if (ref_write)
+      fprintf(stderr, "Wrote %u reference outputs.\n", tests);
+   else
+      fprintf(stderr, "%u of %u outputs match the C path.\n",
+            tests - failed, tests);
+
+   return failed ? 1 : 0;
+}
@@ -31,6 +31,15 @@
 #include <sys/stat.h>
 #include <stdlib.h>
 
+#if defined(RARCH_INTERNAL) && defined(HAVE_CONFIG_H)
+#include "../config.h" /* for HAVE_MMAP */
+#endif
+
+#ifdef HAVE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#endif
+
 #include <streams/file_stream.h>
 #include <retro_endianness.h>
 #include <string/stdstring.h>
@@ -39,34 +48,49 @@
 #include "libretrodb.h"
 #include "rmsgpack_dom.h"
 #include "rmsgpack.h"
-#include "bintree.h"
 #include "query.h"
 #include "libretrodb.h"
 
 #define MAGIC_NUMBER "RARCHDB"
 
-struct node_iter_ctx
-{
-	libretrodb_t *db;
-	libretrodb_index_t *idx;
-};
-
 struct libretrodb
 {
 	RFILE *fd;
    char *path;
+   /* Whole database for in place reads, see libretrodb_load() */
+   const uint8_t *data;
+   size_t data_size;
+   struct rmsgpack_dom_view view;
 	uint64_t root;
 	uint64_t count;
 	uint64_t first_index_offset;
+   int data_mapped;
+   int has_indexes;
 };
 
 struct libretrodb_index
 {
 	char name[50];
+   char field[50];
 	uint64_t key_size;
+   uint64_t count;
 	uint64_t next;
+   /* Start of the key table, see libretrodb_create_index() */
+   const uint8_t *data;
 };
 
+/* Index key being sorted, borrowed from the mapped database.
+ * Numbers are stored big-endian in num[] so that every key
+ * sorts with memcmp(). */
+typedef struct libretrodb_index_key
+{
+   const uint8_t *buff;
+   uint64_t offset;
+   uint32_t len;
+   uint8_t type;
+   uint8_t num[8];
+} libretrodb_index_key_t;
+
 typedef struct libretrodb_metadata
 {
 	uint64_t count;
@@ -83,8 +107,16 @@ struct libretrodb_cursor
    RFILE *fd;
 	libretrodb_query_t *query;
 	libretrodb_t *db;
+   /* Position and scratch tables of
+    * libretrodb_cursor_read_item_view() */
+   size_t data_offset;
+   struct rmsgpack_dom_view view;
+   /* Candidate records when an index answers the query */
+   libretrodb_query_plan_t plan;
+   size_t plan_pos;
 	int is_valid;
 	int eof;
+   int planned;
 };
 
 static int libretrodb_read_metadata(RFILE *fd, libretrodb_metadata_t *md)
@@ -180,32 +212,166 @@ clean:
    return rv;
 }
 
-static int libretrodb_read_index_header(RFILE *fd, libretrodb_index_t *idx)
+static uint64_t libretrodb_get_be(const uint8_t *p, size_t size)
+{
+   uint64_t v = 0;
+   size_t i;
+   for (i = 0; i < size; i++)
+      v = (v << 8) | p[i];
+   return v;
+}
+
+static void libretrodb_put_be(uint8_t *p, uint64_t v, size_t size)
+{
+   while (size--)
+   {
+      p[size] = (uint8_t)v;
+      v     >>= 8;
+   }
+}
+
+/* Reads the index header at @offset of the mapped database */
+static int libretrodb_read_index_header(libretrodb_t *db,
+      uint64_t offset, libretrodb_index_t *idx)
 {
-   uint64_t name_len = 50;
-   return rmsgpack_dom_read_into(fd,
-         "name", idx->name, &name_len,
-         "key_size", &idx->key_size,
-         "next", &idx->next, NULL);
+   unsigned i;
+   size_t consumed;
+   struct rmsgpack_dom_value map;
+
+   memset(idx, 0, sizeof(*idx));
+
+   if (offset >= db->data_size || rmsgpack_dom_read_view(&db->view,
+            db->data + offset, db->data_size - (size_t)offset,
+            &consumed, &map) < 0 || map.type != RDT_MAP)
+      return -EINVAL;
+
+   for (i = 0; i < map.val.map.len; i++)
+   {
+      const struct rmsgpack_dom_value *key   = &map.val.map.items[i].key;
+      const struct rmsgpack_dom_value *value = &map.val.map.items[i].value;
+      char *str                              = NULL;
+      uint64_t *num                          = NULL;
+
+      if (key->type != RDT_STRING)
+         continue;
+
+      if (     key->val.string.len == STRLEN_CONST("name")
+            && !memcmp(key->val.string.buff, "name", key->val.string.len))
+         str = idx->name;
+      else if (key->val.string.len == STRLEN_CONST("field")
+            && !memcmp(key->val.string.buff, "field", key->val.string.len))
+         str = idx->field;
+      else if (key->val.string.len == STRLEN_CONST("key_size")
+            && !memcmp(key->val.string.buff, "key_size", key->val.string.len))
+         num = &idx->key_size;
+      else if (key->val.string.len == STRLEN_CONST("count")
+            && !memcmp(key->val.string.buff, "count", key->val.string.len))
+         num = &idx->count;
+      else if (key->val.string.len == STRLEN_CONST("next")
+            && !memcmp(key->val.string.buff, "next", key->val.string.len))
+         num = &idx->next;
+
+      if (str && value->type == RDT_STRING
+            && value->val.string.len < sizeof(idx->name))
+      {
+         memcpy(str, value->val.string.buff, value->val.string.len);
+         str[value->val.string.len] = '\0';
+      }
+      else if (num && value->type == RDT_UINT)
+         *num = value->val.uint_;
+      else if (num && value->type == RDT_INT && value->val.int_ >= 0)
+         *num = (uint64_t)value->val.int_;
+   }
+
+   offset += consumed;
+   if (idx->next > db->data_size - offset)
+      return -EINVAL;
+
+   idx->data = db->data + offset;
+   return 0;
 }
 
 static void libretrodb_write_index_header(RFILE *fd, libretrodb_index_t *idx)
 {
-   rmsgpack_write_map_header(fd, 3);
+   rmsgpack_write_map_header(fd, 5);
    rmsgpack_write_string(fd, "name", STRLEN_CONST("name"));
    rmsgpack_write_string(fd, idx->name, (uint32_t)strlen(idx->name));
+   rmsgpack_write_string(fd, "field", STRLEN_CONST("field"));
+   rmsgpack_write_string(fd, idx->field, (uint32_t)strlen(idx->field));
    rmsgpack_write_string(fd, "key_size", (uint32_t)STRLEN_CONST("key_size"));
    rmsgpack_write_uint(fd, idx->key_size);
+   rmsgpack_write_string(fd, "count", STRLEN_CONST("count"));
+   rmsgpack_write_uint(fd, idx->count);
    rmsgpack_write_string(fd, "next", STRLEN_CONST("next"));
    rmsgpack_write_uint(fd, idx->next);
 }
 
+/* Maps the whole database, or reads it in one go where
+ * mmap() is not available */
+static int libretrodb_load(libretrodb_t *db)
+{
+   void *buff  = NULL;
+   int64_t len = 0;
+#ifdef HAVE_MMAP
+   struct stat st;
+   int fd      = open(db->path, O_RDONLY);
+
+   if (fd >= 0)
+   {
+      if (fstat(fd, &st) == 0 && st.st_size > 0)
+      {
+         buff = mmap(NULL, (size_t)st.st_size,
+               PROT_READ, MAP_SHARED, fd, 0);
+
+         if (buff != MAP_FAILED)
+         {
+            /* The mapping outlives the descriptor */
+            close(fd);
+            db->data        = (const uint8_t*)buff;
+            db->data_size   = (size_t)st.st_size;
+            db->data_mapped = 1;
+            return 0;
+         }
+         buff = NULL;
+      }
+      close(fd);
+   }
+#endif
+
+   if (!filestream_read_file(db->path, &buff, &len))
+      return -EIO;
+
+   db->data        = (const uint8_t*)buff;
+   db->data_size   = (size_t)len;
+   db->data_mapped = 0;
+   return 0;
+}
+
+static void libretrodb_unload(libretrodb_t *db)
+{
+   if (!db->data)
+      return;
+
+#ifdef HAVE_MMAP
+   if (db->data_mapped)
+      munmap((void*)db->data, db->data_size);
+   else
+#endif
+      free((void*)db->data);
+
+   db->data        = NULL;
+   db->data_size   = 0;
+   db->data_mapped = 0;
+}
+
 void libretrodb_close(libretrodb_t *db)
 {
    if (db->fd)
       filestream_close(db->fd);
    if (!string_is_empty(db->path))
       free(db->path);
+   libretrodb_unload(db);
+   rmsgpack_dom_view_free(&db->view);
    db->path = NULL;
    db->fd   = NULL;
 }
@@ -252,6 +418,8 @@ int libretrodb_open(const char *path, libretrodb_t *db)
 
    db->count              = md.count;
    db->first_index_offset = filestream_tell(fd);
+   db->has_indexes        = filestream_get_size(fd)
+      > (int64_t)db->first_index_offset;
    db->fd                 = fd;
    return 0;
 
@@ -261,91 +429,361 @@ error:
    return rv;
 }
 
+/* Finds an index by name, or by indexed field if @index_name
+ * is NULL */
 static int libretrodb_find_index(libretrodb_t *db, const char *index_name,
-      libretrodb_index_t *idx)
+      const char *field_name, libretrodb_index_t *idx)
 {
-   ssize_t eof    = filestream_get_size(db->fd);
-   ssize_t offset = filestream_seek(db->fd,
-         (ssize_t)db->first_index_offset,
-         RETRO_VFS_SEEK_POSITION_START);
+   uint64_t offset;
 
-   /* TODO: this should use filestream_eof instead */
-   while (offset < eof)
-   {
-      libretrodb_read_index_header(db->fd, idx);
+   /* Spare loading databases that have no index at all */
+   if (!db->has_indexes || (!db->data && libretrodb_load(db) < 0))
+      return -1;
 
-      if (strncmp(index_name, idx->name, strlen(idx->name)) == 0)
+   offset = db->first_index_offset;
+
+   while (offset < db->data_size)
+   {
+      if (libretrodb_read_index_header(db, offset, idx) < 0)
+         return -1;
+
+      /* Indexes without a field name predate the current layout */
+      if (     !string_is_empty(idx->field)
+            && (index_name
+               ? string_is_equal(index_name, idx->name)
+               : string_is_equal(field_name, idx->field)))
          return 0;
 
-      filestream_seek(db->fd, (ssize_t)idx->next,
-            RETRO_VFS_SEEK_POSITION_CURRENT);
-      offset = filestream_tell(db->fd);
+      offset = (uint64_t)(idx->data - db->data) + idx->next;
    }
 
    return -1;
 }
 
-static int binsearch(const void *buff, const void *item,
-      uint64_t count, uint8_t field_size, uint64_t *offset)
+/* Turns a field value into index key bytes,
+ * see struct libretrodb_index_key */
+static int libretrodb_index_key(const struct rmsgpack_dom_value *value,
+      libretrodb_index_key_t *key)
 {
-   int mid            = (int)(count / 2);
-   int item_size      = field_size + sizeof(uint64_t);
-   uint64_t *current  = (uint64_t *)buff + (mid * item_size);
-   int rv             = memcmp(current, item, field_size);
+   key->type = (uint8_t)value->type;
 
-   if (rv == 0)
+   switch (value->type)
    {
-      *offset = *(uint64_t *)(current + field_size);
-      return 0;
+      case RDT_STRING:
+      case RDT_BINARY:
+         key->buff = (const uint8_t*)value->val.string.buff;
+         key->len  = value->val.string.len;
+         return 0;
+      case RDT_UINT:
+      case RDT_INT:
+         /* Queries compare integer literals with unsigned fields
+          * by converting them, so both share one key type */
+         key->type = RDT_UINT;
+         libretrodb_put_be(key->num, value->type == RDT_INT
+               ? (uint64_t)value->val.int_ : value->val.uint_, 8);
+         break;
+      case RDT_BOOL:
+         memset(key->num, 0, sizeof(key->num));
+         key->num[7] = value->val.bool_ ? 1 : 0;
+         break;
+      default:
+         return -EINVAL;
    }
 
-   if (count == 0)
+   key->buff = NULL;
+   key->len  = sizeof(key->num);
+   return 0;
+}
+
+static int libretrodb_index_key_cmp(
+      uint8_t type_a, const uint8_t *a, uint32_t len_a,
+      uint8_t type_b, const uint8_t *b, uint32_t len_b)
+{
+   int rv;
+
+   if (type_a != type_b)
+      return type_a < type_b ? -1 : 1;
+   if ((rv = memcmp(a, b, len_a < len_b ? len_a : len_b)) != 0)
+      return rv;
+   if (len_a != len_b)
+      return len_a < len_b ? -1 : 1;
+   return 0;
+}
+
+static int libretrodb_index_key_same(const libretrodb_index_key_t *a,
+      const libretrodb_index_key_t *b)
+{
+   return libretrodb_index_key_cmp(
+         a->type, a->buff ? a->buff : a->num, a->len,
+         b->type, b->buff ? b->buff : b->num, b->len) == 0;
+}
+
+static int libretrodb_index_key_sort(const void *a, const void *b)
+{
+   const libretrodb_index_key_t *ka = (const libretrodb_index_key_t*)a;
+   const libretrodb_index_key_t *kb = (const libretrodb_index_key_t*)b;
+   int rv = libretrodb_index_key_cmp(
+         ka->type, ka->buff ? ka->buff : ka->num, ka->len,
+         kb->type, kb->buff ? kb->buff : kb->num, kb->len);
+
+   if (rv)
+      return rv;
+   /* Postings stay in file order */
+   if (ka->offset != kb->offset)
+      return ka->offset < kb->offset ? -1 : 1;
+   return 0;
+}
+
+/* Returns the key entry at @pos of the key table, or NULL if
+ * it does not fit in the index */
+static const uint8_t *libretrodb_index_entry(
+      const libretrodb_index_t *idx, uint64_t pos)
+{
+   uint64_t offset = libretrodb_get_be(idx->data + pos * 8, 8);
+   uint64_t len;
+
+   if (offset > idx->next || idx->next - offset < 5)
+      return NULL;
+   len = libretrodb_get_be(idx->data + offset + 1, 4);
+   if (idx->next - offset - 5 < len + 4)
+      return NULL;
+   if ((idx->next - offset - 9 - len) / 8 < libretrodb_get_be(
+            idx->data + offset + 5 + len, 4))
+      return NULL;
+   return idx->data + offset;
+}
+
+/* Binary search for the first key of @idx not below @k.
+ * Returns its position, idx->count if there is none, or -1 if
+ * the index is damaged. */
+static int64_t libretrodb_index_seek(const libretrodb_index_t *idx,
+      const libretrodb_index_key_t *k)
+{
+   uint64_t lo = 0;
+   uint64_t hi = idx->count;
+
+   if (idx->count > idx->next / 8)
       return -1;
 
-   if (rv > 0)
-      return binsearch(buff, item, mid, field_size, offset);
+   while (lo < hi)
+   {
+      uint64_t mid         = lo + (hi - lo) / 2;
+      const uint8_t *entry = libretrodb_index_entry(idx, mid);
+
+      if (!entry)
+         return -1;
+
+      if (libretrodb_index_key_cmp(entry[0], entry + 5,
+               (uint32_t)libretrodb_get_be(entry + 1, 4),
+               k->type, k->buff ? k->buff : k->num, k->len) < 0)
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
 
-   return binsearch(current + item_size, item,
-         count - mid, field_size, offset);
+   return (int64_t)lo;
 }
 
-int libretrodb_find_entry(libretrodb_t *db, const char *index_name,
-      const void *key, struct rmsgpack_dom_value *out)
+static void libretrodb_index_postings(const uint8_t *entry,
+      libretrodb_postings_t *out)
+{
+   uint32_t len = (uint32_t)libretrodb_get_be(entry + 1, 4);
+   out->count   = (uint32_t)libretrodb_get_be(entry + 5 + len, 4);
+   out->data    = entry + 9 + len;
+}
+
+static int libretrodb_index_find_key(const libretrodb_index_t *idx,
+      const struct rmsgpack_dom_value *key, libretrodb_postings_t *out)
+{
+   libretrodb_index_key_t k;
+   const uint8_t *entry;
+   int64_t pos;
+
+   out->data  = NULL;
+   out->count = 0;
+
+   if (libretrodb_index_key(key, &k) < 0)
+      return 0;
+
+   if ((pos = libretrodb_index_seek(idx, &k)) < 0)
+      return -EINVAL;
+
+   if (     (uint64_t)pos < idx->count
+         && (entry = libretrodb_index_entry(idx, (uint64_t)pos))
+         && libretrodb_index_key_cmp(entry[0], entry + 5,
+            (uint32_t)libretrodb_get_be(entry + 1, 4),
+            k.type, k.buff ? k.buff : k.num, k.len) == 0)
+      libretrodb_index_postings(entry, out);
+
+   return 0;
+}
+
+/**
+ * libretrodb_index_lookup:
+ * @db                  : Handle to database.
+ * @index_name          : Index to search.
+ * @key                 : Value of the indexed field.
+ * @out                 : Records holding @key.
+ *
+ * Finds every record whose indexed field equals @key, with the same
+ * meaning of equality as queries. @out points into the database and
+ * stays valid until the database is closed.
+ *
+ * Returns: 0 if successful (@out may be empty), otherwise negative
+ * if there is no such index.
+ **/
+int libretrodb_index_lookup(libretrodb_t *db, const char *index_name,
+      const struct rmsgpack_dom_value *key, libretrodb_postings_t *out)
 {
    libretrodb_index_t idx;
+
+   out->data  = NULL;
+   out->count = 0;
+
+   if (libretrodb_find_index(db, index_name, NULL, &idx) < 0)
+      return -1;
+
+   return libretrodb_index_find_key(&idx, key, out);
+}
+
+/**
+ * libretrodb_field_lookup:
+ *
+ * Same as libretrodb_index_lookup(), using whichever index
+ * was built on @field_name.
+ **/
+int libretrodb_field_lookup(libretrodb_t *db, const char *field_name,
+      const struct rmsgpack_dom_value *key, libretrodb_postings_t *out)
+{
+   libretrodb_index_t idx;
+
+   out->data  = NULL;
+   out->count = 0;
+
+   if (libretrodb_find_index(db, NULL, field_name, &idx) < 0)
+      return -1;
+
+   return libretrodb_index_find_key(&idx, key, out);
+}
+
+/**
+ * libretrodb_field_range:
+ * @db                  : Handle to database.
+ * @field_name          : Indexed field.
+ * @min                 : Lowest value.
+ * @max                 : Highest value.
+ * @cb                  : Called with the records of each value.
+ * @ctx                 : Passed to @cb.
+ *
+ * Walks the integer keys from @min to @max of the index built on
+ * @field_name, in ascending order. Signed and unsigned fields share
+ * one key space, so negative values sort above every positive one.
+ *
+ * Returns: 0 if successful, otherwise negative if there is no such
+ * index or @cb failed.
+ **/
+int libretrodb_field_range(libretrodb_t *db, const char *field_name,
+      uint64_t min, uint64_t max, libretrodb_postings_cb cb, void *ctx)
+{
+   libretrodb_index_t idx;
+   libretrodb_index_key_t k;
+   int64_t pos;
    int rv;
-   void *buff;
-   uint64_t offset;
-   ssize_t bufflen, nread = 0;
 
-   if (libretrodb_find_index(db, index_name, &idx) < 0)
+   if (libretrodb_find_index(db, NULL, field_name, &idx) < 0)
       return -1;
 
-   bufflen = idx.next;
-   buff    = malloc(bufflen);
+   k.type = RDT_UINT;
+   k.buff = NULL;
+   k.len  = sizeof(k.num);
+   libretrodb_put_be(k.num, min, 8);
 
-   if (!buff)
-      return -ENOMEM;
+   if ((pos = libretrodb_index_seek(&idx, &k)) < 0)
+      return -EINVAL;
 
-   while (nread < bufflen)
+   for (; (uint64_t)pos < idx.count; pos++)
    {
-      void *buff_ = (uint64_t *)buff + nread;
-      rv          = (int)filestream_read(db->fd, buff_, bufflen - nread);
+      libretrodb_postings_t postings;
+      const uint8_t *entry = libretrodb_index_entry(&idx, (uint64_t)pos);
 
-      if (rv <= 0)
-      {
-         free(buff);
-         return -errno;
-      }
-      nread += rv;
+      if (!entry)
+         return -EINVAL;
+
+      if (     entry[0] != RDT_UINT
+            || libretrodb_get_be(entry + 1, 4) != 8
+            || libretrodb_get_be(entry + 5, 8) > max)
+         break;
+
+      libretrodb_index_postings(entry, &postings);
+      if ((rv = cb(&postings, ctx)) != 0)
+         return rv;
    }
 
-   rv = binsearch(buff, key, db->count, (ssize_t)idx.key_size, &offset);
-   free(buff);
+   return 0;
+}
 
-   if (rv == 0)
-      filestream_seek(db->fd, (ssize_t)offset,
-            RETRO_VFS_SEEK_POSITION_START);
+uint64_t libretrodb_postings_get(const libretrodb_postings_t *postings,
+      uint32_t i)
+{
+   return libretrodb_get_be(postings->data + (size_t)i * 8, 8);
+}
+
+/**
+ * libretrodb_read_item_at:
+ * @db                  : Handle to database.
+ * @offset              : Record offset, as found in an index.
+ * @out                 : Decoded record.
+ *
+ * Decodes the record at @offset in place, with the same lifetime
+ * rules as libretrodb_cursor_read_item_view(): @out is only valid
+ * until the next call on @db.
+ *
+ * Returns: 0 if successful, otherwise negative.
+ **/
+int libretrodb_read_item_at(libretrodb_t *db, uint64_t offset,
+      struct rmsgpack_dom_value *out)
+{
+   size_t consumed;
+
+   if (!db->data && libretrodb_load(db) < 0)
+      return -EIO;
+
+   if (offset >= db->data_size)
+      return -EINVAL;
+
+   return rmsgpack_dom_read_view(&db->view, db->data + offset,
+         db->data_size - (size_t)offset, &consumed, out);
+}
+
+int libretrodb_find_entry(libretrodb_t *db, const char *index_name,
+      const void *key, struct rmsgpack_dom_value *out)
+{
+   libretrodb_index_t idx;
+   libretrodb_postings_t postings;
+   struct rmsgpack_dom_value k;
+
+   if (libretrodb_find_index(db, index_name, NULL, &idx) < 0)
+      return -1;
+
+   /* Only binary indexes have a fixed key size */
+   if (idx.key_size)
+   {
+      k.type           = RDT_BINARY;
+      k.val.binary.len = (uint32_t)idx.key_size;
+   }
+   else
+   {
+      k.type           = RDT_STRING;
+      k.val.string.len = (uint32_t)strlen((const char*)key);
+   }
+   k.val.string.buff   = (char*)key;
+
+   if (     libretrodb_index_lookup(db, index_name, &k, &postings) < 0
+         || postings.count == 0)
+      return -1;
+
+   filestream_seek(db->fd, (ssize_t)libretrodb_postings_get(&postings, 0),
+         RETRO_VFS_SEEK_POSITION_START);
 
    return rmsgpack_dom_read(db->fd, out);
 }
@@ -360,7 +798,10 @@ int libretrodb_find_entry(libretrodb_t *db, const char *index_name,
  **/
 int libretrodb_cursor_reset(libretrodb_cursor_t *cursor)
 {
-   cursor->eof = 0;
+   cursor->eof         = 0;
+   cursor->plan_pos    = 0;
+   cursor->data_offset = (size_t)(cursor->db->root
+         + sizeof(libretrodb_header_t));
    return (int)filestream_seek(cursor->fd,
          (ssize_t)(cursor->db->root + sizeof(libretrodb_header_t)),
          RETRO_VFS_SEEK_POSITION_START);
@@ -375,6 +816,18 @@ int libretrodb_cursor_read_item(libretrodb_cursor_t *cursor,
       return EOF;
 
 retry:
+   if (cursor->planned)
+   {
+      if (cursor->plan_pos >= cursor->plan.count)
+      {
+         cursor->eof = 1;
+         return EOF;
+      }
+      filestream_seek(cursor->fd,
+            (int64_t)cursor->plan.offsets[cursor->plan_pos++],
+            RETRO_VFS_SEEK_POSITION_START);
+   }
+
    rv = rmsgpack_dom_read(cursor->fd, out);
    if (rv < 0)
       return rv;
@@ -387,7 +840,8 @@ retry:
 
    if (cursor->query)
    {
-      if (!libretrodb_query_filter(cursor->query, out))
+      if (!libretrodb_query_filter_plan(cursor->query,
+               cursor->planned ? &cursor->plan : NULL, out))
       {
          rmsgpack_dom_value_free(out);
          goto retry;
@@ -397,6 +851,70 @@ retry:
    return 0;
 }
 
+/**
+ * libretrodb_cursor_read_item_view:
+ * @cursor              : Handle to database cursor.
+ * @out                 : Next matching record.
+ *
+ * Same as libretrodb_cursor_read_item(), but decodes the record in
+ * place from the mapped database instead of building a DOM: strings
+ * and binaries point into the file and are NOT NUL-terminated, the
+ * field table belongs to the cursor. @out is only valid until the
+ * next read or until the cursor is closed, and must not be freed.
+ * Don't mix both read functions on the same cursor.
+ *
+ * Returns: 0 if successful, EOF at the end, otherwise negative.
+ **/
+int libretrodb_cursor_read_item_view(libretrodb_cursor_t *cursor,
+      struct rmsgpack_dom_value *out)
+{
+   int rv;
+   size_t consumed;
+   libretrodb_t *db = cursor->db;
+
+   if (cursor->eof)
+      return EOF;
+
+   if (!db->data && (rv = libretrodb_load(db)) < 0)
+      return rv;
+
+   for (;;)
+   {
+      if (cursor->planned)
+      {
+         if (cursor->plan_pos >= cursor->plan.count)
+         {
+            cursor->eof = 1;
+            return EOF;
+         }
+         cursor->data_offset = (size_t)
+            cursor->plan.offsets[cursor->plan_pos++];
+      }
+
+      if (cursor->data_offset >= db->data_size)
+         return -EINVAL;
+
+      if ((rv = rmsgpack_dom_read_view(&cursor->view,
+                  db->data + cursor->data_offset,
+                  db->data_size - cursor->data_offset,
+                  &consumed, out)) < 0)
+         return rv;
+
+      cursor->data_offset += consumed;
+
+      if (out->type == RDT_NULL)
+      {
+         cursor->eof = 1;
+         return EOF;
+      }
+
+      if (     !cursor->query
+            || libretrodb_query_filter_plan(cursor->query,
+               cursor->planned ? &cursor->plan : NULL, out))
+         return 0;
+   }
+}
+
 /**
  * libretrodb_cursor_close:
  * @cursor              : Handle to database cursor.
@@ -414,7 +932,11 @@ void libretrodb_cursor_close(libretrodb_cursor_t *cursor)
    if (cursor->query)
       libretrodb_query_free(cursor->query);
 
+   rmsgpack_dom_view_free(&cursor->view);
+   libretrodb_query_plan_free(&cursor->plan);
+
    cursor->is_valid = 0;
+   cursor->planned  = 0;
    cursor->eof      = 1;
    cursor->fd       = NULL;
    cursor->db       = NULL;
@@ -449,130 +971,204 @@ int libretrodb_cursor_open(libretrodb_t *db,
    cursor->fd       = fd;
    cursor->db       = db;
    cursor->is_valid = 1;
+   cursor->planned  = 0;
    libretrodb_cursor_reset(cursor);
    cursor->query    = q;
 
    if (q)
+   {
       libretrodb_query_inc_ref(q);
+      cursor->planned = (libretrodb_query_plan(q, db, &cursor->plan) == 0);
+   }
 
    return 0;
 }
 
-static int node_iter(void *value, void *ctx)
-{
-   struct node_iter_ctx *nictx = (struct node_iter_ctx*)ctx;
-
-   if (filestream_write(nictx->db->fd, value,
-            (ssize_t)(nictx->idx->key_size + sizeof(uint64_t))) > 0)
-      return 0;
-
-   return -1;
-}
-
-static uint64_t libretrodb_tell(libretrodb_t *db)
-{
-   return filestream_tell(db->fd);
-}
-
-static int node_compare(const void *a, const void *b, void *ctx)
-{
-   return memcmp(a, b, *(uint8_t *)ctx);
-}
-
+/**
+ * libretrodb_create_index:
+ * @db                  : Handle to database.
+ * @name                : Name of the new index.
+ * @field_name          : Record field to index.
+ *
+ * Appends an index on @field_name to the database. Keys need not be
+ * unique; records missing the field, or holding a map, array or nil
+ * there, are left out.
+ *
+ * The index is a table of big-endian offsets to its sorted keys,
+ * followed by one entry per key:
+ *
+ *   type (1) | length (4) | key | count (4) | record offsets (8 each)
+ *
+ * Records are collected from the mapped database and sorted once,
+ * so building never depends on the input order.
+ *
+ * Returns: 0 if successful, otherwise negative.
+ **/
 int libretrodb_create_index(libretrodb_t *db,
       const char *name, const char *field_name)
 {
-   struct node_iter_ctx nictx;
-   struct rmsgpack_dom_value key;
    libretrodb_index_t idx;
+   struct rmsgpack_dom_value key;
    struct rmsgpack_dom_value item;
-   libretrodb_cursor_t cur          = {0};
-   struct rmsgpack_dom_value *field = NULL;
-   void *buff                       = NULL;
-   uint64_t *buff_u64               = NULL;
-   uint8_t field_size               = 0;
-   uint64_t item_loc                = libretrodb_tell(db);
-   bintree_t *tree                  = bintree_new(node_compare, &field_size);
+   struct rmsgpack_dom_view view       = {0};
+   libretrodb_index_key_t *keys        = NULL;
+   uint8_t *buff                       = NULL;
+   uint8_t *entry                      = NULL;
+   RFILE *fd                           = NULL;
+   size_t i, consumed, keys_cap        = 0;
+   size_t keys_count                   = 0;
+   uint64_t distinct                   = 0;
+   uint64_t size                       = 0;
+   uint64_t offset                     = 0;
+   int binary_size                     = -1;
+   int rv                              = 0;
+
+   if (     string_is_empty(name)
+         || string_is_empty(field_name)
+         || strlen(name)       >= sizeof(idx.name)
+         || strlen(field_name) >= sizeof(idx.field))
+      return -EINVAL;
 
-   item.type                        = RDT_NULL;
+   if (!db->data && (rv = libretrodb_load(db)) < 0)
+      return rv;
 
-   if (!tree || (libretrodb_cursor_open(db, &cur, NULL) != 0))
-      goto clean;
+   if (libretrodb_find_index(db, name, NULL, &idx) == 0)
+      return -EEXIST;
 
    key.type            = RDT_STRING;
    key.val.string.len  = (uint32_t)strlen(field_name);
    key.val.string.buff = (char *) field_name;   /* We know we aren't going to change it */
 
-   while (libretrodb_cursor_read_item(&cur, &item) == 0)
-   {
-      /* Only map keys are supported */
-      if (item.type != RDT_MAP)
-         goto clean;
+   offset              = db->root + sizeof(libretrodb_header_t);
 
-      field = rmsgpack_dom_value_map_value(&item, &key);
-
-      /* Field not found in item */
-      if (!field)
-         goto clean;
+   for (;;)
+   {
+      const struct rmsgpack_dom_value *field = NULL;
+      libretrodb_index_key_t k;
 
-      /* Field is not binary */
-      if (field->type != RDT_BINARY)
+      if (     offset >= db->data_size
+            || (rv = rmsgpack_dom_read_view(&view, db->data + offset,
+                  db->data_size - (size_t)offset, &consumed, &item)) < 0)
+      {
+         rv = -EINVAL;
          goto clean;
+      }
 
-      /* Field is empty */
-      if (field->val.binary.len == 0)
-         goto clean;
+      if (item.type == RDT_NULL)
+         break;
 
-      if (field_size == 0)
-         field_size = field->val.binary.len;
-      /* Field is not of correct size */
-      else if (field->val.binary.len != field_size) 
-         goto clean;
+      if (     (field = rmsgpack_dom_value_map_value(&item, &key))
+            && libretrodb_index_key(field, &k) == 0)
+      {
+         if (keys_count == keys_cap)
+         {
+            size_t new_cap                = keys_cap ? keys_cap * 2 : 1024;
+            libretrodb_index_key_t *tmp   = (libretrodb_index_key_t*)
+               realloc(keys, new_cap * sizeof(*keys));
+
+            if (!tmp)
+            {
+               rv = -ENOMEM;
+               goto clean;
+            }
+            keys     = tmp;
+            keys_cap = new_cap;
+         }
+
+         k.offset           = offset;
+         keys[keys_count++] = k;
+      }
 
-      buff = malloc(field_size + sizeof(uint64_t));
-      if (!buff)
-         goto clean;
+      offset += consumed;
+   }
 
-      memcpy(buff, field->val.binary.buff, field_size);
+   if (keys_count)
+      qsort(keys, keys_count, sizeof(*keys), libretrodb_index_key_sort);
 
-      buff_u64 = (uint64_t *)buff + field_size;
+   /* Size the index, and see whether all keys are binaries
+    * of the same length */
+   for (i = 0; i < keys_count; i++)
+   {
+      if (i == 0 || !libretrodb_index_key_same(&keys[i - 1], &keys[i]))
+      {
+         distinct++;
+         size += 8 + 1 + 4 + keys[i].len + 4;
+
+         if (keys[i].type != RDT_BINARY)
+            binary_size = 0;
+         else if (binary_size == -1)
+            binary_size = (int)keys[i].len;
+         else if (binary_size != (int)keys[i].len)
+            binary_size = 0;
+      }
+      size += 8;
+   }
 
-      memcpy(buff_u64, &item_loc, sizeof(uint64_t));
+   if (!(buff = (uint8_t*)malloc(size ? (size_t)size : 1)))
+   {
+      rv = -ENOMEM;
+      goto clean;
+   }
 
-      /* Value is not unique? */
-      if (bintree_insert(tree, buff) != 0)
+   entry = buff + distinct * 8;
+   for (i = 0, distinct = 0; i < keys_count; )
+   {
+      const uint8_t *k = keys[i].buff ? keys[i].buff : keys[i].num;
+      size_t j         = i;
+      uint8_t *count;
+
+      libretrodb_put_be(buff + distinct++ * 8, (uint64_t)(entry - buff), 8);
+      *entry++ = keys[i].type;
+      libretrodb_put_be(entry, keys[i].len, 4);
+      memcpy(entry + 4, k, keys[i].len);
+      entry   += 4 + keys[i].len;
+      count    = entry;
+      entry   += 4;
+
+      /* Every record sharing this key */
+      do
       {
-         rmsgpack_dom_value_print(field);
-         goto clean;
-      }
-      buff     = NULL;
-      rmsgpack_dom_value_free(&item);
-      item_loc = libretrodb_tell(db);
+         libretrodb_put_be(entry, keys[j].offset, 8);
+         entry += 8;
+         j++;
+      } while (j < keys_count
+            && libretrodb_index_key_same(&keys[j], &keys[i]));
+
+      libretrodb_put_be(count, j - i, 4);
+      i = j;
    }
 
-   filestream_seek(db->fd, 0, RETRO_VFS_SEEK_POSITION_END);
+   if (!(fd = filestream_open(db->path,
+         RETRO_VFS_FILE_ACCESS_READ_WRITE
+         | RETRO_VFS_FILE_ACCESS_UPDATE_EXISTING,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+   {
+      rv = -errno;
+      goto clean;
+   }
 
-   strncpy(idx.name, name, 50);
+   memset(&idx, 0, sizeof(idx));
+   strlcpy(idx.name, name, sizeof(idx.name));
+   strlcpy(idx.field, field_name, sizeof(idx.field));
+   idx.key_size = binary_size > 0 ? (uint64_t)binary_size : 0;
+   idx.count    = distinct;
+   idx.next     = size;
 
-   idx.name[49] = '\0';
-   idx.key_size = field_size;
-   idx.next     = db->count * (field_size + sizeof(uint64_t));
-   libretrodb_write_index_header(db->fd, &idx);
+   filestream_seek(fd, 0, RETRO_VFS_SEEK_POSITION_END);
+   libretrodb_write_index_header(fd, &idx);
+   if (filestream_write(fd, buff, (int64_t)size) != (int64_t)size)
+      rv = -EIO;
+   filestream_close(fd);
 
-   nictx.db     = db;
-   nictx.idx    = &idx;
-   bintree_iterate(tree, node_iter, &nictx);
+   /* Map the file again to see the new index */
+   libretrodb_unload(db);
+   db->has_indexes = 1;
 
 clean:
-   rmsgpack_dom_value_free(&item);
-   if (buff)
-      free(buff);
-   if (cur.is_valid)
-      libretrodb_cursor_close(&cur);
-   if (tree)
-      bintree_free(tree);
-   free(tree);
-   return 0;
+   rmsgpack_dom_view_free(&view);
+   free(keys);
+   free(buff);
+   return rv;
 }
 
 libretrodb_cursor_t *libretrodb_cursor_new(void)
@@ -588,6 +1184,16 @@ libretrodb_cursor_t *libretrodb_cursor_new(void)
    dbc->eof                 = 0;
    dbc->query               = NULL;
    dbc->db                  = NULL;
+   dbc->data_offset         = 0;
+   dbc->plan.offsets        = NULL;
+   dbc->plan.count          = 0;
+   dbc->plan.pushed         = -1;
+   dbc->plan_pos            = 0;
+   dbc->planned             = 0;
+   dbc->view.pairs          = NULL;
+   dbc->view.values         = NULL;
+   dbc->view.pairs_cap      = 0;
+   dbc->view.values_cap     = 0;
 
    return dbc;
 }
@@ -612,6 +1218,14 @@ libretrodb_t *libretrodb_new(void)
    db->count              = 0;
    db->first_index_offset = 0;
    db->path               = NULL;
+   db->data               = NULL;
+   db->data_size          = 0;
+   db->data_mapped        = 0;
+   db->has_indexes        = 0;
+   db->view.pairs         = NULL;
+   db->view.values        = NULL;
+   db->view.pairs_cap     = 0;
+   db->view.values_cap    = 0;
 
    return db;
 }
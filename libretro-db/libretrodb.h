@@ -45,6 +45,16 @@ typedef struct libretrodb_index libretrodb_index_t;
 
 typedef int (*libretrodb_value_provider)(void *ctx, struct rmsgpack_dom_value *out);
 
+/* Records found through an index, see libretrodb_index_lookup() */
+typedef struct libretrodb_postings
+{
+   const uint8_t *data;    /* big-endian record offsets */
+   uint32_t count;
+} libretrodb_postings_t;
+
+typedef int (*libretrodb_postings_cb)(const libretrodb_postings_t *postings,
+      void *ctx);
+
 int libretrodb_create(RFILE *fd, libretrodb_value_provider value_provider, void *ctx);
 
 void libretrodb_close(libretrodb_t *db);
@@ -57,6 +67,21 @@ int libretrodb_create_index(libretrodb_t *db, const char *name,
 int libretrodb_find_entry(libretrodb_t *db, const char *index_name,
         const void *key, struct rmsgpack_dom_value *out);
 
+int libretrodb_index_lookup(libretrodb_t *db, const char *index_name,
+      const struct rmsgpack_dom_value *key, libretrodb_postings_t *out);
+
+int libretrodb_field_lookup(libretrodb_t *db, const char *field_name,
+      const struct rmsgpack_dom_value *key, libretrodb_postings_t *out);
+
+int libretrodb_field_range(libretrodb_t *db, const char *field_name,
+      uint64_t min, uint64_t max, libretrodb_postings_cb cb, void *ctx);
+
+uint64_t libretrodb_postings_get(const libretrodb_postings_t *postings,
+      uint32_t i);
+
+int libretrodb_read_item_at(libretrodb_t *db, uint64_t offset,
+      struct rmsgpack_dom_value *out);
+
 libretrodb_t *libretrodb_new(void);
 
 void libretrodb_free(libretrodb_t *db);
@@ -105,6 +130,9 @@ void libretrodb_query_free(void *q);
 int libretrodb_cursor_read_item(libretrodb_cursor_t *cursor,
       struct rmsgpack_dom_value *out);
 
+int libretrodb_cursor_read_item_view(libretrodb_cursor_t *cursor,
+      struct rmsgpack_dom_value *out);
+
 RETRO_END_DECLS
 
 #endif
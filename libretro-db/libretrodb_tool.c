@@ -21,13 +21,218 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
+#include <compat/strl.h>
 #include <string/stdstring.h>
 
 #include "libretrodb.h"
 #include "rmsgpack_dom.h"
 
+#define BENCH_RUNS 20
+
+/* Appends @value to @s the way the query parser reads it back */
+static void bench_append_value(char *s, size_t len,
+      const struct rmsgpack_dom_value *value)
+{
+   unsigned i;
+   char tmp[16];
+
+   switch (value->type)
+   {
+      case RDT_STRING:
+         strlcat(s, "\"", len);
+         if (value->val.string.len < len - strlen(s) - 2)
+            strncat(s, value->val.string.buff, value->val.string.len);
+         strlcat(s, "\"", len);
+         break;
+      case RDT_BINARY:
+         strlcat(s, "b'", len);
+         for (i = 0; i < value->val.binary.len; i++)
+         {
+            snprintf(tmp, sizeof(tmp), "%02X",
+                  (unsigned char)value->val.binary.buff[i]);
+            strlcat(s, tmp, len);
+         }
+         strlcat(s, "'", len);
+         break;
+      case RDT_INT:
+         snprintf(tmp, sizeof(tmp), "%d", (int)value->val.int_);
+         strlcat(s, tmp, len);
+         break;
+      case RDT_UINT:
+         snprintf(tmp, sizeof(tmp), "%u", (unsigned)value->val.uint_);
+         strlcat(s, tmp, len);
+         break;
+      default:
+         strlcat(s, "nil", len);
+         break;
+   }
+}
+
+static const struct rmsgpack_dom_value *bench_field(
+      const struct rmsgpack_dom_value *item, const char *name)
+{
+   struct rmsgpack_dom_value key;
+   const struct rmsgpack_dom_value *value;
+
+   key.type            = RDT_STRING;
+   key.val.string.len  = (uint32_t)strlen(name);
+   key.val.string.buff = (char*)name;
+
+   value = rmsgpack_dom_value_map_value(item, &key);
+
+   /* Quotes can't be escaped in queries */
+   if (     value && value->type == RDT_STRING
+         && memchr(value->val.string.buff, '"', value->val.string.len))
+      return NULL;
+   return value;
+}
+
+/* Times @query_exp as a full scan and through the planner */
+static int bench_query(libretrodb_t *db, const char *query_exp)
+{
+   unsigned run;
+   clock_t start;
+   double scan_ms, plan_ms;
+   libretrodb_query_plan_t plan;
+   struct rmsgpack_dom_value item;
+   const char *error        = NULL;
+   unsigned scan_count      = 0;
+   unsigned plan_count      = 0;
+   libretrodb_cursor_t *cur = libretrodb_cursor_new();
+   libretrodb_query_t *q    = (libretrodb_query_t*)
+      libretrodb_query_compile(db, query_exp, strlen(query_exp), &error);
+
+   if (!cur || !q)
+   {
+      printf("%s: %s\n", query_exp, error ? error : "out of memory");
+      libretrodb_cursor_free(cur);
+      return 1;
+   }
+
+   start = clock();
+   for (run = 0; run < BENCH_RUNS; run++)
+   {
+      scan_count = 0;
+      libretrodb_cursor_open(db, cur, NULL);
+      while (libretrodb_cursor_read_item_view(cur, &item) == 0)
+         if (libretrodb_query_filter(q, &item))
+            scan_count++;
+      libretrodb_cursor_close(cur);
+   }
+   scan_ms = (clock() - start) * 1000.0 / CLOCKS_PER_SEC / BENCH_RUNS;
+
+   start = clock();
+   for (run = 0; run < BENCH_RUNS; run++)
+   {
+      plan_count = 0;
+      libretrodb_cursor_open(db, cur, q);
+      while (libretrodb_cursor_read_item_view(cur, &item) == 0)
+         plan_count++;
+      libretrodb_cursor_close(cur);
+   }
+   plan_ms = (clock() - start) * 1000.0 / CLOCKS_PER_SEC / BENCH_RUNS;
+
+   printf("%-60s %6u rows  scan %8.3f ms  ", query_exp, scan_count, scan_ms);
+   if (libretrodb_query_plan(q, db, &plan) == 0)
+      printf("index %8.3f ms (%u candidates)", plan_ms, (unsigned)plan.count);
+   else
+      printf("no index");
+   printf("%s\n", plan_count != scan_count ? "  MISMATCH" : "");
+
+   libretrodb_query_plan_free(&plan);
+   libretrodb_query_free(q);
+   libretrodb_cursor_free(cur);
+   return plan_count != scan_count;
+}
+
+/* The query shapes the frontend issues, filled with the values
+ * of the first record */
+static int bench_default(libretrodb_t *db)
+{
+   char query_exp[512];
+   struct rmsgpack_dom_value item;
+   const struct rmsgpack_dom_value *value;
+   int rv                   = 0;
+   libretrodb_cursor_t *cur = libretrodb_cursor_new();
+
+   if (     !cur
+         || libretrodb_cursor_open(db, cur, NULL) != 0
+         || libretrodb_cursor_read_item(cur, &item) != 0)
+   {
+      printf("Could not read the first record\n");
+      libretrodb_cursor_free(cur);
+      return 1;
+   }
+
+   if ((value = bench_field(&item, "crc")))
+   {
+      strlcpy(query_exp, "{crc:or(", sizeof(query_exp));
+      bench_append_value(query_exp, sizeof(query_exp), value);
+      strlcat(query_exp, ",b'00000000')}", sizeof(query_exp));
+      rv |= bench_query(db, query_exp);
+
+      /* The same value twice must still match the record once */
+      strlcpy(query_exp, "{crc:or(", sizeof(query_exp));
+      bench_append_value(query_exp, sizeof(query_exp), value);
+      strlcat(query_exp, ",", sizeof(query_exp));
+      bench_append_value(query_exp, sizeof(query_exp), value);
+      strlcat(query_exp, ")}", sizeof(query_exp));
+      rv |= bench_query(db, query_exp);
+   }
+
+   if ((value = bench_field(&item, "serial")))
+   {
+      strlcpy(query_exp, "{'serial':", sizeof(query_exp));
+      bench_append_value(query_exp, sizeof(query_exp), value);
+      strlcat(query_exp, "}", sizeof(query_exp));
+      rv |= bench_query(db, query_exp);
+   }
+
+   if ((value = bench_field(&item, "name")))
+   {
+      strlcpy(query_exp, "{'name':", sizeof(query_exp));
+      bench_append_value(query_exp, sizeof(query_exp), value);
+      strlcat(query_exp, "}", sizeof(query_exp));
+      rv |= bench_query(db, query_exp);
+   }
+
+   if ((value = bench_field(&item, "developer")) && value->type == RDT_STRING)
+   {
+      strlcpy(query_exp, "{'developer':glob('*", sizeof(query_exp));
+      strncat(query_exp, value->val.string.buff,
+            value->val.string.len < 64 ? value->val.string.len : 64);
+      strlcat(query_exp, "*')}", sizeof(query_exp));
+      rv |= bench_query(db, query_exp);
+   }
+
+   if ((value = bench_field(&item, "releaseyear")))
+   {
+      int year = (int)value->val.int_;
+
+      strlcpy(query_exp, "{'releaseyear':", sizeof(query_exp));
+      bench_append_value(query_exp, sizeof(query_exp), value);
+      strlcat(query_exp, "}", sizeof(query_exp));
+      rv |= bench_query(db, query_exp);
+
+      snprintf(query_exp, sizeof(query_exp),
+            "{'releaseyear':between(%d,%d)}", year - 2, year + 2);
+      rv |= bench_query(db, query_exp);
+
+      snprintf(query_exp, sizeof(query_exp),
+            "{'releasemonth':10,'releaseyear':%d}", year);
+      rv |= bench_query(db, query_exp);
+   }
+
+   rmsgpack_dom_value_free(&item);
+   libretrodb_cursor_close(cur);
+   libretrodb_cursor_free(cur);
+   return rv;
+}
+
 int main(int argc, char ** argv)
 {
    int rv;
@@ -46,6 +251,8 @@ int main(int argc, char ** argv)
       printf("Available Commands:\n");
       printf("\tlist\n");
       printf("\tcreate-index <index name> <field name>\n");
+      printf("\tfind-index <index name> <value>\n");
+      printf("\tbench [query expression...]\n");
       printf("\tfind <query expression>\n");
       printf("\tget-names <query expression>\n");
       return 1;
@@ -86,7 +293,16 @@ int main(int argc, char ** argv)
          rmsgpack_dom_value_free(&item);
       }
    }
-   else if (memcmp(command, "find", 4) == 0)
+   else if (string_is_equal(command, "bench"))
+   {
+      int i;
+
+      if (argc == 3)
+         bench_default(db);
+      for (i = 3; i < argc; i++)
+         bench_query(db, argv[i]);
+   }
+   else if (string_is_equal(command, "find"))
    {
       if (argc != 4)
       {
@@ -172,7 +388,75 @@ int main(int argc, char ** argv)
       index_name = argv[3];
       field_name = argv[4];
 
-      libretrodb_create_index(db, index_name, field_name);
+      if ((rv = libretrodb_create_index(db, index_name, field_name)) != 0)
+      {
+         printf("Could not create index: %s\n", strerror(-rv));
+         goto error;
+      }
+   }
+   else if (memcmp(command, "find-index", 10) == 0)
+   {
+      unsigned i;
+      libretrodb_postings_t postings;
+      struct rmsgpack_dom_value key;
+      const char *value = NULL;
+      char *end         = NULL;
+
+      if (argc != 5)
+      {
+         printf("Usage: %s <db file> find-index <index name> <value>\n", argv[0]);
+         goto error;
+      }
+
+      value               = argv[4];
+      /* Numbers are looked up as integers, like in queries */
+      key.val.int_        = strtoll(value, &end, 10);
+      key.type            = RDT_INT;
+      if (string_is_empty(value) || *end)
+      {
+         key.type            = RDT_STRING;
+         key.val.string.len  = (uint32_t)strlen(value);
+         key.val.string.buff = (char*)value;
+      }
+
+      if (libretrodb_index_lookup(db, argv[3], &key, &postings) != 0)
+      {
+         printf("Could not find index '%s'\n", argv[3]);
+         goto error;
+      }
+
+      /* Binary keys such as crc and md5 are given in hex */
+      if (postings.count == 0 && key.type == RDT_STRING
+            && (key.val.string.len & 1) == 0)
+      {
+         char bin[64];
+         uint32_t len = key.val.string.len / 2;
+
+         for (i = 0; i < len && i < sizeof(bin); i++)
+         {
+            unsigned byte;
+            if (sscanf(value + i * 2, "%2x", &byte) != 1)
+               break;
+            bin[i] = (char)byte;
+         }
+
+         if (i == len)
+         {
+            key.type            = RDT_BINARY;
+            key.val.binary.len  = len;
+            key.val.binary.buff = bin;
+            libretrodb_index_lookup(db, argv[3], &key, &postings);
+         }
+      }
+
+      for (i = 0; i < postings.count; i++)
+      {
+         if (libretrodb_read_item_at(db,
+                  libretrodb_postings_get(&postings, i), &item) != 0)
+            break;
+         rmsgpack_dom_value_print(&item);
+         printf("\n");
+      }
    }
    else
    {
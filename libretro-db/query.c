@@ -228,8 +228,10 @@ static struct rmsgpack_dom_value query_func_between(
          break;
       case RDT_UINT:
          res.val.bool_ = (
-               ((unsigned)input.val.int_ >= argv[0].a.value.val.uint_)
-               && (input.val.int_ <= argv[1].a.value.val.int_));
+               (     argv[0].a.value.val.int_ < 0
+                  || input.val.uint_ >= (uint64_t)argv[0].a.value.val.int_)
+               && argv[1].a.value.val.int_ >= 0
+               && input.val.uint_ <= (uint64_t)argv[1].a.value.val.int_);
          break;
       default:
          break;
@@ -243,24 +245,34 @@ static struct rmsgpack_dom_value query_func_glob(
       unsigned argc, const struct argument * argv)
 {
    struct rmsgpack_dom_value res;
-   unsigned i    = 0;
+   char tmp[256];
+   char *str     = tmp;
+   uint32_t len  = input.val.string.len;
 
    res.type      = RDT_BOOL;
    res.val.bool_ = 0;
 
-   (void)i;
-
    if (argc != 1)
       return res;
    if (argv[0].type != AT_VALUE || argv[0].a.value.type != RDT_STRING)
       return res;
    if (input.type != RDT_STRING)
       return res;
+
+   /* Strings read in place from the database are not NUL-terminated */
+   if (len >= sizeof(tmp) && !(str = (char*)malloc(len + 1)))
+      return res;
+   memcpy(str, input.val.string.buff, len);
+   str[len]      = '\0';
+
    res.val.bool_ = rl_fnmatch(
          argv[0].a.value.val.string.buff,
-         input.val.string.buff,
+         str,
          0
          ) == 0;
+
+   if (str != tmp)
+      free(str);
    return res;
 }
 
@@ -514,6 +526,13 @@ static struct buffer query_parse_value(
              buff, value, error);
    else if (ISDIGIT((int)buff.data[buff.offset]))
       buff = query_parse_integer(s, len, buff, value, error);
+   else
+   {
+      snprintf(s, len,
+            "%" PRIu64 "::Expected a value found '%c'",
+            (uint64_t)buff.offset, buff.data[buff.offset]);
+      *error = s;
+   }
    return buff;
 }
 
@@ -732,9 +751,10 @@ clean:
    return buff;
 }
 
-static struct rmsgpack_dom_value query_func_all_map(
+/* Matches a table, leaving out the entry at argument @skip */
+static struct rmsgpack_dom_value query_match_table(
       struct rmsgpack_dom_value input,
-      unsigned argc, const struct argument *argv)
+      unsigned argc, const struct argument *argv, unsigned skip)
 {
    unsigned i;
    struct argument arg;
@@ -758,6 +778,8 @@ static struct rmsgpack_dom_value query_func_all_map(
 
    for (i = 0; i < argc; i += 2)
    {
+      if (i == skip)
+         continue;
       arg = argv[i];
       if (arg.type != AT_VALUE)
       {
@@ -785,6 +807,13 @@ static struct rmsgpack_dom_value query_func_all_map(
    return res;
 }
 
+static struct rmsgpack_dom_value query_func_all_map(
+      struct rmsgpack_dom_value input,
+      unsigned argc, const struct argument *argv)
+{
+   return query_match_table(input, argc, argv, argc);
+}
+
 static struct buffer query_parse_table(
       char *s, size_t len,
       struct buffer buff,
@@ -999,3 +1028,234 @@ int libretrodb_query_filter(libretrodb_query_t *q,
    struct rmsgpack_dom_value res = inv.func(*v, inv.argc, inv.argv);
    return (res.type == RDT_BOOL && res.val.bool_);
 }
+
+struct query_plan_state
+{
+   uint64_t *offsets;
+   size_t count;
+   size_t cap;
+};
+
+static int query_plan_add(const libretrodb_postings_t *postings, void *data)
+{
+   uint32_t i;
+   struct query_plan_state *state = (struct query_plan_state*)data;
+
+   if (state->count + postings->count > state->cap)
+   {
+      size_t cap     = (state->count + postings->count) * 2;
+      uint64_t *tmp  = (uint64_t*)realloc(state->offsets,
+            cap * sizeof(*tmp));
+      if (!tmp)
+         return -1;
+      state->offsets = tmp;
+      state->cap     = cap;
+   }
+
+   for (i = 0; i < postings->count; i++)
+      state->offsets[state->count++] = libretrodb_postings_get(postings, i);
+
+   return 0;
+}
+
+static int query_plan_offset_cmp(const void *a, const void *b)
+{
+   uint64_t x = *(const uint64_t*)a;
+   uint64_t y = *(const uint64_t*)b;
+   return (x > y) - (x < y);
+}
+
+/* Puts the collected offsets in file order. or() may name the same
+ * value twice, or values that share an index key, so the same record
+ * can have been collected more than once. */
+static void query_plan_sort(struct query_plan_state *state)
+{
+   size_t i, count = 0;
+
+   if (!state->count)
+      return;
+
+   qsort(state->offsets, state->count, sizeof(*state->offsets),
+         query_plan_offset_cmp);
+
+   for (i = 0; i < state->count; i++)
+      if (!count || state->offsets[i] != state->offsets[count - 1])
+         state->offsets[count++] = state->offsets[i];
+
+   state->count = count;
+}
+
+/* Only literals an index key can represent. Nil, for one, also
+ * matches records missing the field. */
+static bool query_plan_is_key(const struct argument *arg)
+{
+   if (arg->type != AT_VALUE)
+      return false;
+
+   switch (arg->a.value.type)
+   {
+      case RDT_STRING:
+      case RDT_BINARY:
+      case RDT_INT:
+      case RDT_UINT:
+      case RDT_BOOL:
+         return true;
+      default:
+         break;
+   }
+
+   return false;
+}
+
+static int query_plan_lookup(struct libretrodb *db, const char *field,
+      const struct argument *arg, struct query_plan_state *state)
+{
+   libretrodb_postings_t postings;
+
+   if (libretrodb_field_lookup(db, field, &arg->a.value, &postings) != 0)
+      return -1;
+
+   return query_plan_add(&postings, state);
+}
+
+/* Collects the records matching one table entry from the index on
+ * @field. Only predicates an index answers exactly qualify: a value,
+ * or() of values and between() on non-negative integers. */
+static int query_plan_argument(struct libretrodb *db, const char *field,
+      const struct argument *arg, struct query_plan_state *state)
+{
+   unsigned i;
+   const struct invocation *inv = &arg->a.invocation;
+
+   if (arg->type == AT_VALUE)
+   {
+      if (!query_plan_is_key(arg))
+         return -1;
+      return query_plan_lookup(db, field, arg, state);
+   }
+
+   if (inv->func == query_func_operator_or)
+   {
+      for (i = 0; i < inv->argc; i++)
+         if (!query_plan_is_key(&inv->argv[i]))
+            return -1;
+
+      for (i = 0; i < inv->argc; i++)
+         if (query_plan_lookup(db, field, &inv->argv[i], state) != 0)
+            return -1;
+
+      return 0;
+   }
+
+   if (     inv->func == query_func_between
+         && inv->argc == 2
+         && inv->argv[0].type == AT_VALUE
+         && inv->argv[1].type == AT_VALUE
+         && inv->argv[0].a.value.type == RDT_INT
+         && inv->argv[1].a.value.type == RDT_INT
+         && inv->argv[0].a.value.val.int_ >= 0)
+   {
+      /* Negative values would sort above every positive one */
+      if (inv->argv[1].a.value.val.int_ < inv->argv[0].a.value.val.int_)
+         return 0;
+      return libretrodb_field_range(db, field,
+            (uint64_t)inv->argv[0].a.value.val.int_,
+            (uint64_t)inv->argv[1].a.value.val.int_,
+            query_plan_add, state);
+   }
+
+   return -1;
+}
+
+/**
+ * libretrodb_query_plan:
+ * @q                   : Compiled query.
+ * @db                  : Database the query will run on.
+ * @plan                : Candidate records.
+ *
+ * Looks for the most selective entry of a query table that an index
+ * of @db can answer, and collects the records it matches, in file
+ * order. libretrodb_query_filter_plan() then only evaluates the rest
+ * of the query on them.
+ *
+ * Returns: 0 if the query can use an index, otherwise -1 and the
+ * whole database has to be scanned.
+ **/
+int libretrodb_query_plan(libretrodb_query_t *q, struct libretrodb *db,
+      libretrodb_query_plan_t *plan)
+{
+   unsigned i;
+   const struct invocation *root = &((struct query*)q)->root;
+
+   plan->offsets = NULL;
+   plan->count   = 0;
+   plan->pushed  = -1;
+
+   if (root->func != query_func_all_map || root->argc % 2 != 0)
+      return -1;
+
+   for (i = 0; i < root->argc; i += 2)
+   {
+      struct query_plan_state state;
+      const struct argument *key = &root->argv[i];
+
+      if (key->type != AT_VALUE || key->a.value.type != RDT_STRING)
+         continue;
+
+      state.offsets = NULL;
+      state.count   = 0;
+      state.cap     = 0;
+
+      if (query_plan_argument(db, key->a.value.val.string.buff,
+                  &root->argv[i + 1], &state) != 0)
+      {
+         free(state.offsets);
+         continue;
+      }
+
+      query_plan_sort(&state);
+
+      if (plan->pushed >= 0 && state.count >= plan->count)
+      {
+         free(state.offsets);
+         continue;
+      }
+
+      free(plan->offsets);
+      plan->offsets = state.offsets;
+      plan->count   = state.count;
+      plan->pushed  = (int)i;
+
+      /* Nothing beats an empty result */
+      if (plan->count == 0)
+         break;
+   }
+
+   if (plan->pushed < 0)
+      return -1;
+
+   return 0;
+}
+
+void libretrodb_query_plan_free(libretrodb_query_plan_t *plan)
+{
+   if (!plan)
+      return;
+   free(plan->offsets);
+   plan->offsets = NULL;
+   plan->count   = 0;
+   plan->pushed  = -1;
+}
+
+int libretrodb_query_filter_plan(libretrodb_query_t *q,
+      const libretrodb_query_plan_t *plan, struct rmsgpack_dom_value *v)
+{
+   struct invocation inv = ((struct query *)q)->root;
+   struct rmsgpack_dom_value res;
+
+   if (!plan || plan->pushed < 0)
+      return libretrodb_query_filter(q, v);
+
+   res = query_match_table(*v, inv.argc, inv.argv, (unsigned)plan->pushed);
+   return (res.type == RDT_BOOL && res.val.bool_);
+}
@@ -32,12 +32,30 @@ RETRO_BEGIN_DECLS
 
 typedef struct libretrodb_query libretrodb_query_t;
 
+struct libretrodb;
+
+/* Records a query can be answered from, see libretrodb_query_plan() */
+typedef struct libretrodb_query_plan
+{
+   uint64_t *offsets;   /* ascending */
+   size_t count;
+   int pushed;          /* table entry the offsets answer */
+} libretrodb_query_plan_t;
+
 void libretrodb_query_inc_ref(libretrodb_query_t *q);
 
 void libretrodb_query_dec_ref(libretrodb_query_t *q);
 
 int libretrodb_query_filter(libretrodb_query_t *q, struct rmsgpack_dom_value *v);
 
+int libretrodb_query_plan(libretrodb_query_t *q, struct libretrodb *db,
+      libretrodb_query_plan_t *plan);
+
+void libretrodb_query_plan_free(libretrodb_query_plan_t *plan);
+
+int libretrodb_query_filter_plan(libretrodb_query_t *q,
+      const libretrodb_query_plan_t *plan, struct rmsgpack_dom_value *v);
+
 RETRO_END_DECLS
 
 #endif
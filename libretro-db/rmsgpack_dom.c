@@ -315,7 +315,8 @@ void rmsgpack_dom_value_print(struct rmsgpack_dom_value *obj)
          printf("%" PRIu64, (uint64_t)obj->val.uint_);
          break;
       case RDT_STRING:
-         printf("\"%s\"", obj->val.string.buff);
+         printf("\"%.*s\"", (int)obj->val.string.len,
+               obj->val.string.buff);
          break;
       case RDT_BINARY:
          printf("\"");
@@ -423,6 +424,307 @@ int rmsgpack_dom_read(RFILE *fd, struct rmsgpack_dom_value *out)
    return rv;
 }
 
+static uint64_t dom_view_uint(const uint8_t *p, size_t size)
+{
+   uint64_t v = 0;
+   size_t i;
+   for (i = 0; i < size; i++)
+      v = (v << 8) | p[i];
+   return v;
+}
+
+/* Decodes the value starting at *p without copying anything.
+ * Strings and binaries point into the buffer, maps and arrays only
+ * get their length; *p is left on their first child. */
+static int dom_view_head(const uint8_t **p, const uint8_t *end,
+      struct rmsgpack_dom_value *v)
+{
+   uint64_t len;
+   size_t size;
+   const uint8_t *s = *p;
+   uint8_t type;
+
+   if (s >= end)
+      return -EINVAL;
+
+   type = *s++;
+
+   if (type < _MPF_FIXMAP)
+   {
+      v->type     = RDT_INT;
+      v->val.int_ = type;
+      *p          = s;
+      return 0;
+   }
+   else if (type < _MPF_FIXARRAY)
+   {
+      v->type          = RDT_MAP;
+      v->val.map.len   = type - _MPF_FIXMAP;
+      v->val.map.items = NULL;
+      *p               = s;
+      return 0;
+   }
+   else if (type < _MPF_FIXSTR)
+   {
+      v->type            = RDT_ARRAY;
+      v->val.array.len   = type - _MPF_FIXARRAY;
+      v->val.array.items = NULL;
+      *p                 = s;
+      return 0;
+   }
+   else if (type < _MPF_NIL)
+   {
+      len = type - _MPF_FIXSTR;
+      if ((size_t)(end - s) < len)
+         return -EINVAL;
+      v->type            = RDT_STRING;
+      v->val.string.len  = (uint32_t)len;
+      v->val.string.buff = (char*)s;
+      *p                 = s + len;
+      return 0;
+   }
+   else if (type > _MPF_MAP32)
+   {
+      v->type     = RDT_INT;
+      v->val.int_ = (int64_t)type - 0xff - 1;
+      *p          = s;
+      return 0;
+   }
+
+   switch (type)
+   {
+      case _MPF_NIL:
+         v->type = RDT_NULL;
+         break;
+      case _MPF_FALSE:
+      case _MPF_TRUE:
+         v->type      = RDT_BOOL;
+         v->val.bool_ = (type == _MPF_TRUE);
+         break;
+      case _MPF_BIN8:
+      case _MPF_BIN16:
+      case _MPF_BIN32:
+      case _MPF_STR8:
+      case _MPF_STR16:
+      case _MPF_STR32:
+         size = (type <= _MPF_BIN32)
+            ? (size_t)1 << (type - _MPF_BIN8)
+            : (size_t)1 << (type - _MPF_STR8);
+         if ((size_t)(end - s) < size)
+            return -EINVAL;
+         len  = dom_view_uint(s, size);
+         s   += size;
+         if ((size_t)(end - s) < len)
+            return -EINVAL;
+         /* Same layout for both */
+         v->type            = (type <= _MPF_BIN32) ? RDT_BINARY : RDT_STRING;
+         v->val.string.len  = (uint32_t)len;
+         v->val.string.buff = (char*)s;
+         s                 += len;
+         break;
+      case _MPF_UINT8:
+      case _MPF_UINT16:
+      case _MPF_UINT32:
+      case _MPF_UINT64:
+         size = (size_t)1 << (type - _MPF_UINT8);
+         if ((size_t)(end - s) < size)
+            return -EINVAL;
+         v->type      = RDT_UINT;
+         v->val.uint_ = dom_view_uint(s, size);
+         s           += size;
+         break;
+      case _MPF_INT8:
+      case _MPF_INT16:
+      case _MPF_INT32:
+      case _MPF_INT64:
+         size = (size_t)1 << (type - _MPF_INT8);
+         if ((size_t)(end - s) < size)
+            return -EINVAL;
+         len  = dom_view_uint(s, size);
+         v->type = RDT_INT;
+         switch (size)
+         {
+            case 1:
+               v->val.int_ = (int8_t)len;
+               break;
+            case 2:
+               v->val.int_ = (int16_t)len;
+               break;
+            case 4:
+               v->val.int_ = (int32_t)len;
+               break;
+            default:
+               v->val.int_ = (int64_t)len;
+               break;
+         }
+         s += size;
+         break;
+      case _MPF_ARRAY16:
+      case _MPF_ARRAY32:
+      case _MPF_MAP16:
+      case _MPF_MAP32:
+         size = (type <= _MPF_ARRAY32)
+            ? (size_t)2 << (type - _MPF_ARRAY16)
+            : (size_t)2 << (type - _MPF_MAP16);
+         if ((size_t)(end - s) < size)
+            return -EINVAL;
+         len  = dom_view_uint(s, size);
+         s   += size;
+         if (type <= _MPF_ARRAY32)
+         {
+            v->type            = RDT_ARRAY;
+            v->val.array.len   = (uint32_t)len;
+            v->val.array.items = NULL;
+         }
+         else
+         {
+            v->type            = RDT_MAP;
+            v->val.map.len     = (uint32_t)len;
+            v->val.map.items   = NULL;
+         }
+         break;
+      default:
+         return -EINVAL;
+   }
+
+   *p = s;
+   return 0;
+}
+
+/* First pass: checks bounds and counts the pairs and array
+ * items the value needs, so the view tables are sized once. */
+static int dom_view_measure(const uint8_t **p, const uint8_t *end,
+      int depth, size_t *pairs, size_t *values)
+{
+   struct rmsgpack_dom_value v;
+   uint64_t i, children;
+   int rv;
+
+   if (depth == MAX_DEPTH)
+      return -ENOMEM;
+
+   if ((rv = dom_view_head(p, end, &v)) < 0)
+      return rv;
+
+   if (v.type == RDT_MAP)
+   {
+      *pairs  += v.val.map.len;
+      children = (uint64_t)v.val.map.len * 2;
+   }
+   else if (v.type == RDT_ARRAY)
+   {
+      *values += v.val.array.len;
+      children = v.val.array.len;
+   }
+   else
+      return 0;
+
+   for (i = 0; i < children; i++)
+      if ((rv = dom_view_measure(p, end, depth + 1, pairs, values)) < 0)
+         return rv;
+
+   return 0;
+}
+
+/* Second pass: the buffer has already been validated */
+static void dom_view_fill(const uint8_t **p, const uint8_t *end,
+      struct rmsgpack_dom_value *out, struct rmsgpack_dom_view *view,
+      size_t *pair, size_t *value)
+{
+   uint32_t i;
+
+   dom_view_head(p, end, out);
+
+   if (out->type == RDT_MAP)
+   {
+      out->val.map.items = view->pairs + *pair;
+      *pair             += out->val.map.len;
+      for (i = 0; i < out->val.map.len; i++)
+      {
+         dom_view_fill(p, end, &out->val.map.items[i].key,
+               view, pair, value);
+         dom_view_fill(p, end, &out->val.map.items[i].value,
+               view, pair, value);
+      }
+   }
+   else if (out->type == RDT_ARRAY)
+   {
+      out->val.array.items = view->values + *value;
+      *value              += out->val.array.len;
+      for (i = 0; i < out->val.array.len; i++)
+         dom_view_fill(p, end, &out->val.array.items[i],
+               view, pair, value);
+   }
+}
+
+/**
+ * rmsgpack_dom_read_view:
+ * @view                : Tables reused across calls.
+ * @buff                : Encoded data.
+ * @len                 : Bytes available in @buff.
+ * @consumed            : Bytes taken by the value.
+ * @out                 : Decoded value.
+ *
+ * Decodes one value in place. Strings and binaries point into @buff
+ * and are NOT NUL-terminated, maps and arrays point into @view.
+ * @out stays valid until the next call with the same @view and must
+ * not be passed to rmsgpack_dom_value_free().
+ *
+ * Returns: 0 if successful, otherwise negative.
+ **/
+int rmsgpack_dom_read_view(struct rmsgpack_dom_view *view,
+      const uint8_t *buff, size_t len, size_t *consumed,
+      struct rmsgpack_dom_value *out)
+{
+   int rv;
+   size_t pair        = 0;
+   size_t value       = 0;
+   size_t pairs       = 0;
+   size_t values      = 0;
+   const uint8_t *p   = buff;
+   const uint8_t *end = buff + len;
+
+   if ((rv = dom_view_measure(&p, end, 0, &pairs, &values)) < 0)
+      return rv;
+
+   if (pairs > view->pairs_cap)
+   {
+      struct rmsgpack_dom_pair *tmp = (struct rmsgpack_dom_pair*)
+         realloc(view->pairs, pairs * sizeof(*tmp));
+      if (!tmp)
+         return -ENOMEM;
+      view->pairs     = tmp;
+      view->pairs_cap = pairs;
+   }
+
+   if (values > view->values_cap)
+   {
+      struct rmsgpack_dom_value *tmp = (struct rmsgpack_dom_value*)
+         realloc(view->values, values * sizeof(*tmp));
+      if (!tmp)
+         return -ENOMEM;
+      view->values     = tmp;
+      view->values_cap = values;
+   }
+
+   *consumed = (size_t)(p - buff);
+   p         = buff;
+   dom_view_fill(&p, end, out, view, &pair, &value);
+   return 0;
+}
+
+void rmsgpack_dom_view_free(struct rmsgpack_dom_view *view)
+{
+   if (!view)
+      return;
+   free(view->pairs);
+   free(view->values);
+   view->pairs      = NULL;
+   view->values     = NULL;
+   view->pairs_cap  = 0;
+   view->values_cap = 0;
+}
+
 int rmsgpack_dom_read_into(RFILE *fd, ...)
 {
    int rv;
@@ -23,6 +23,7 @@
 #ifndef __LIBRETRODB_MSGPACK_DOM_H__
 #define __LIBRETRODB_MSGPACK_DOM_H__
 
+#include <stddef.h>
 #include <stdint.h>
 
 #include <retro_common_api.h>
@@ -79,6 +80,16 @@ struct rmsgpack_dom_pair
 	struct rmsgpack_dom_value value; /* uint64_t alignment */
 };
 
+/* Scratch tables for values decoded in place, grown on demand and
+ * reused from one rmsgpack_dom_read_view() call to the next */
+struct rmsgpack_dom_view
+{
+   struct rmsgpack_dom_pair *pairs;
+   struct rmsgpack_dom_value *values;
+   size_t pairs_cap;
+   size_t values_cap;
+};
+
 void rmsgpack_dom_value_print(struct rmsgpack_dom_value *obj);
 void rmsgpack_dom_value_free(struct rmsgpack_dom_value *v);
 
@@ -91,6 +102,12 @@ struct rmsgpack_dom_value *rmsgpack_dom_value_map_value(
 
 int rmsgpack_dom_read(RFILE *fd, struct rmsgpack_dom_value *out);
 
+int rmsgpack_dom_read_view(struct rmsgpack_dom_view *view,
+      const uint8_t *buff, size_t len, size_t *consumed,
+      struct rmsgpack_dom_value *out);
+
+void rmsgpack_dom_view_free(struct rmsgpack_dom_view *view);
+
 int rmsgpack_dom_write(RFILE *fd, const struct rmsgpack_dom_value *obj);
 
 int rmsgpack_dom_read_into(RFILE *fd, ...);
@@ -2571,7 +2571,8 @@ static int action_ok_audio_add_to_mixer_and_collection(const char *path,
    entry.core_path = (char*)"builtin";
    entry.core_name = (char*)"musicplayer";
 
-   command_playlist_push_write(g_defaults.music_history, &entry);
+   if (playlist_push(g_defaults.music_history, &entry))
+      task_push_playlist_write(g_defaults.music_history);
 
    if (filestream_exists(combined_path))
       task_push_audio_mixer_load(combined_path,
@@ -2602,7 +2603,8 @@ static int action_ok_audio_add_to_mixer_and_collection_and_play(const char *path
    entry.core_path = (char*)"builtin";
    entry.core_name = (char*)"musicplayer";
 
-   command_playlist_push_write(g_defaults.music_history, &entry);
+   if (playlist_push(g_defaults.music_history, &entry))
+      task_push_playlist_write(g_defaults.music_history);
 
    if (filestream_exists(combined_path))
       task_push_audio_mixer_load_and_play(combined_path,
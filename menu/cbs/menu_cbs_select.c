@@ -44,8 +44,8 @@ static int action_select_default(
    file_list_t *selection_buf = menu_entries_get_selection_buf_ptr(0);
 
    if (selection_buf)
-      cbs                     = (menu_file_list_cbs_t*)
-         file_list_get_actiondata_at_offset(selection_buf, idx);
+      cbs                     = menu_entries_get_actiondata(
+            selection_buf, idx);
 
    if (!cbs)
       return -1;
@@ -1570,6 +1570,10 @@ typedef struct materialui_handle
    size_t last_stack_size;
    size_t first_onscreen_entry;
    size_t last_onscreen_entry;
+   /* Range of entries measured by the last
+    * materialui_compute_entries_box() call */
+   size_t first_measured_entry;
+   size_t last_measured_entry;
    /* Used to track scroll animations */
    size_t scroll_animation_selection;
    size_t fullscreen_thumbnail_selection;
@@ -1645,6 +1649,8 @@ typedef struct materialui_handle
    char fullscreen_thumbnail_label[255];
    bool is_portrait;
    bool need_compute;
+   /* Some entry heights are only estimates */
+   bool entries_estimated;
    bool mouse_show;
    bool is_playlist_tab;
    bool is_playlist;
@@ -2663,6 +2669,67 @@ static unsigned materialui_count_lines(const char *str)
    return lines;
 }
 
+/* > Bulk lists (see menu_entries_is_bulk()) are only
+ *   measured this many screens either side of the
+ *   selection, or of what is on screen */
+#define MUI_ENTRIES_WINDOW_SCREENS 2
+
+/* > Returns number of entries that fit in the
+ *   list view at their smallest */
+static size_t materialui_entries_per_screen(
+      materialui_handle_t* mui, unsigned height)
+{
+   unsigned entry_height = mui->font_data.list.line_height +
+         mui->dip_base_unit_size / 5;
+
+   if (entry_height == 0)
+      return 1;
+   return height / entry_height + 1;
+}
+
+/* > Sets the range of entries that the next
+ *   materialui_compute_entries_box() call measures */
+static void materialui_set_measured_entries(
+      materialui_handle_t* mui, unsigned height, size_t centre)
+{
+   size_t window = MUI_ENTRIES_WINDOW_SCREENS *
+         materialui_entries_per_screen(mui, height);
+
+   mui->first_measured_entry = (centre > window) ? centre - window : 0;
+   mui->last_measured_entry  = centre + window;
+   mui->entries_estimated    = false;
+}
+
+/* > Returns true if entry 'entry_idx' is a bulk
+ *   entry outside the measured range */
+static bool materialui_entry_estimated(
+      materialui_handle_t* mui, file_list_t *list, size_t entry_idx)
+{
+   return ((entry_idx < mui->first_measured_entry) ||
+           (entry_idx > mui->last_measured_entry)) &&
+         menu_entries_is_bulk(list, entry_idx);
+}
+
+/* > Returns true if the icon of 'node' is displayed */
+static bool materialui_node_has_icon(
+      materialui_handle_t* mui, materialui_node_t *node)
+{
+   switch (node->icon_type)
+   {
+      case MUI_ICON_TYPE_INTERNAL:
+         return mui->textures.list[node->icon_texture_index] != 0;
+      case MUI_ICON_TYPE_MENU_EXPLORE:
+         return true;
+      case MUI_ICON_TYPE_PLAYLIST:
+         return materialui_get_playlist_icon(
+               mui, node->icon_texture_index) != 0;
+      default:
+         break;
+   }
+
+   return false;
+}
+
 /* > Returns number of lines required to display
  *   the sublabel of entry 'entry_idx' */
 static unsigned materialui_count_sublabel_lines(
@@ -2700,6 +2767,30 @@ static unsigned materialui_count_sublabel_lines(
    return materialui_count_lines(wrapped_sublabel_str);
 }
 
+/* > Returns number of sublabel lines assumed for
+ *   bulk entries outside the measured range: that
+ *   of the first bulk entry inside it */
+static unsigned materialui_estimate_sublabel_lines(
+      materialui_handle_t* mui, file_list_t *list,
+      int usable_width, bool use_icons)
+{
+   size_t entries_end = menu_entries_get_size();
+   size_t i;
+
+   for (i = mui->first_measured_entry;
+         (i < entries_end) && (i <= mui->last_measured_entry); i++)
+   {
+      materialui_node_t *node = (materialui_node_t*)
+            file_list_get_userdata_at_offset(list, i);
+
+      if (node && menu_entries_is_bulk(list, i))
+         return materialui_count_sublabel_lines(mui, usable_width, i,
+               use_icons && materialui_node_has_icon(mui, node));
+   }
+
+   return 0;
+}
+
 /* Used for standard, non-playlist entries
  * > MUI_LIST_VIEW_DEFAULT */
 static void materialui_compute_entries_box_default(
@@ -2717,38 +2808,32 @@ static void materialui_compute_entries_box_default(
          (int)(mui->landscape_optimization.entry_margin * 2);
    float sum              = 0;
    size_t entries_end     = menu_entries_get_size();
+   unsigned estimated_sublabel_lines;
 
    if (!list)
       return;
 
+   estimated_sublabel_lines = materialui_estimate_sublabel_lines(
+         mui, list, usable_width, true);
+
    for (i = 0; i < entries_end; i++)
    {
       unsigned num_sublabel_lines = 0;
       materialui_node_t *node     = (materialui_node_t*)
             file_list_get_userdata_at_offset(list, i);
-      bool has_icon               = false;
 
       if (!node)
          continue;
 
-      switch (node->icon_type)
+      if (materialui_entry_estimated(mui, list, i))
       {
-         case MUI_ICON_TYPE_INTERNAL:
-            has_icon = mui->textures.list[node->icon_texture_index] != 0;
-            break;
-         case MUI_ICON_TYPE_MENU_EXPLORE:
-            has_icon = true;
-            break;
-         case MUI_ICON_TYPE_PLAYLIST:
-            has_icon = materialui_get_playlist_icon(
-                  mui, node->icon_texture_index) != 0;
-            break;
-         default:
-            break;
+         num_sublabel_lines     = estimated_sublabel_lines;
+         mui->entries_estimated = true;
       }
-
-      num_sublabel_lines = materialui_count_sublabel_lines(
-            mui, usable_width, i, has_icon);
+      else
+         num_sublabel_lines = materialui_count_sublabel_lines(
+               mui, usable_width, i,
+               materialui_node_has_icon(mui, node));
 
       node->text_height  = mui->font_data.list.line_height +
             (num_sublabel_lines * mui->font_data.hint.line_height);
@@ -2790,6 +2875,7 @@ static void materialui_compute_entries_box_playlist_list(
    int usable_width       = node_entry_width - (int)(mui->margin * 2);
    float sum              = 0;
    size_t entries_end     = menu_entries_get_size();
+   unsigned estimated_sublabel_lines;
 
    if (!list)
       return;
@@ -2821,6 +2907,9 @@ static void materialui_compute_entries_box_playlist_list(
          usable_width -= mui->thumbnail_width_max + thumbnail_margin;
    }
 
+   estimated_sublabel_lines = materialui_estimate_sublabel_lines(
+         mui, list, usable_width, false);
+
    for (i = 0; i < entries_end; i++)
    {
       unsigned num_sublabel_lines = 0;
@@ -2830,8 +2919,14 @@ static void materialui_compute_entries_box_playlist_list(
       if (!node)
          continue;
 
-      num_sublabel_lines = materialui_count_sublabel_lines(
-            mui, usable_width, i, false);
+      if (materialui_entry_estimated(mui, list, i))
+      {
+         num_sublabel_lines     = estimated_sublabel_lines;
+         mui->entries_estimated = true;
+      }
+      else
+         num_sublabel_lines = materialui_count_sublabel_lines(
+               mui, usable_width, i, false);
 
       node->text_height  = mui->font_data.list.line_height +
             (num_sublabel_lines * mui->font_data.hint.line_height);
@@ -2983,6 +3078,49 @@ static void (*materialui_compute_entries_box)(
  * materialui_compute_entries_box() END
  * ============================== */
 
+/* Re-measures the entries around 'centre' if it got
+ * near an entry whose height is only an estimate,
+ * keeping entry 'anchor_idx' where it is on screen */
+static void materialui_update_entries_window(
+      materialui_handle_t *mui, size_t centre, size_t anchor_idx)
+{
+   gfx_display_t *p_disp     = disp_get_ptr();
+   file_list_t *list         = menu_entries_get_selection_buf_ptr(0);
+   size_t entries_end        = menu_entries_get_size();
+   materialui_node_t *anchor = NULL;
+   float anchor_y            = 0.0f;
+   unsigned width            = 0;
+   unsigned height           = 0;
+   size_t screen;
+
+   if (!mui->entries_estimated || !list ||
+       !mui->font_data.list.font || !mui->font_data.hint.font)
+      return;
+
+   video_driver_get_size(&width, &height);
+   screen = materialui_entries_per_screen(mui, height);
+
+   /* Nothing to do while 'centre' is at least a screen
+    * away from the first estimated entry either side */
+   if (((mui->first_measured_entry == 0) ||
+        (centre >= mui->first_measured_entry + screen)) &&
+       ((mui->last_measured_entry + 1 >= entries_end) ||
+        (centre + screen <= mui->last_measured_entry)))
+      return;
+
+   anchor = (materialui_node_t*)
+         file_list_get_userdata_at_offset(list, anchor_idx);
+   if (anchor)
+      anchor_y = anchor->y;
+
+   materialui_set_measured_entries(mui, height, centre);
+   materialui_compute_entries_box(mui, width, height,
+         p_disp->header_height);
+
+   if (anchor)
+      mui->scroll_y += anchor->y - anchor_y;
+}
+
 /* Compute the scroll value depending on the highlighted entry */
 static float materialui_get_scroll(materialui_handle_t *mui)
 {
@@ -3492,7 +3630,11 @@ static void materialui_render(void *data,
    if (mui->need_compute)
    {
       if (mui->font_data.list.font && mui->font_data.hint.font)
+      {
+         materialui_set_measured_entries(mui, height,
+               menu_navigation_get_selection());
          materialui_compute_entries_box(mui, width, height, header_height);
+      }
 
       /* After calling populate_entries(), we need to call
        * materialui_get_scroll() so the last selected item
@@ -3675,6 +3817,17 @@ static void materialui_render(void *data,
          break;
    }
 
+   /* Pointer scrolling can move away from the selection -
+    * keep the entries that are about to come on screen
+    * measured */
+   materialui_update_entries_window(mui,
+         (mui->scroll_animation_active ||
+          materialui_entry_onscreen(mui, selection)) ?
+               selection :
+               (mui->first_onscreen_entry >> 1) +
+               (mui->last_onscreen_entry >> 1),
+         mui->first_onscreen_entry);
+
    menu_entries_ctl(MENU_ENTRIES_CTL_SET_START, &mui->first_onscreen_entry);
 }
 
@@ -7901,6 +8054,9 @@ static void materialui_navigation_set(void *data, bool scroll)
    if (!mui || !scroll)
       return;
 
+   materialui_update_entries_window(mui,
+         menu_navigation_get_selection(), mui->first_onscreen_entry);
+
    materialui_animate_scroll(
          mui,
          materialui_get_scroll(mui),
@@ -8482,9 +8638,8 @@ static int materialui_switch_tabs(
       file_list_t *selection_buf = menu_entries_get_selection_buf_ptr(0);
       file_list_t *menu_stack    = menu_entries_get_menu_stack_ptr(0);
       size_t selection           = menu_navigation_get_selection();
-      menu_file_list_cbs_t *cbs  = selection_buf ?
-            (menu_file_list_cbs_t*)file_list_get_actiondata_at_offset(
-                  selection_buf, selection) : NULL;
+      menu_file_list_cbs_t *cbs  =
+            menu_entries_get_actiondata(selection_buf, selection);
       bool stack_flushed         = false;
       int ret                    = 0;
 
@@ -708,6 +708,7 @@ static void *ozone_init(void **userdata, bool video_is_threaded)
    }
 
    ozone->need_compute                 = false;
+   ozone->entries_estimated            = false;
    ozone->animations.scroll_y          = 0.0f;
    ozone->animations.scroll_y_sidebar  = 0.0f;
 
@@ -842,6 +843,12 @@ static void ozone_update_thumbnail_image(void *data)
          gfx_thumbnail_upscale_threshold,
          network_on_demand_thumbnails);
    }
+
+   /* Load thumbnails of neighbouring entries
+    * in the background */
+   if (ozone->is_playlist)
+      gfx_thumbnail_prefetch(ozone->thumbnail_path_data,
+            playlist, selection, gfx_thumbnail_upscale_threshold);
 }
 
 static void ozone_refresh_thumbnail_image(void *data, unsigned i)
@@ -1863,6 +1870,16 @@ static void ozone_render(void *data,
             break;
       }
 
+      /* >> Pointer scrolling can move away from the
+       *    selection - keep the entries that are about
+       *    to come on screen measured */
+      ozone_update_entries_window(ozone,
+            OZONE_ENTRY_ONSCREEN(ozone, ozone->selection)
+            ? ozone->selection
+            : (ozone->first_onscreen_entry >> 1) +
+              (ozone->last_onscreen_entry  >> 1),
+            ozone->first_onscreen_entry);
+
       /* >> Loop over all categories */
       ozone->first_onscreen_category = 0;
       ozone->last_onscreen_category  = ozone->system_tab_end + horizontal_list_size;
@@ -2544,6 +2561,8 @@ static void ozone_selection_changed(ozone_handle_t *ozone, bool allow_animation)
       ozone->cursor_in_sidebar_old = ozone->cursor_in_sidebar;
 
       gfx_animation_kill_by_tag(&tag);
+      ozone_update_entries_window(ozone, new_selection,
+            ozone->selection_old);
       ozone_update_scroll(ozone, allow_animation, node);
 
       /* Update thumbnail */
@@ -3088,7 +3107,8 @@ static void ozone_populate_entries(void *data, const char *path, const char *lab
       return;
    }
 
-   ozone->need_compute = true;
+   ozone->need_compute      = true;
+   ozone->entries_estimated = false;
 
    ozone->first_onscreen_entry    = 0;
    ozone->last_onscreen_entry     = 0;
@@ -3275,7 +3295,8 @@ static void ozone_list_deep_copy(const file_list_t *src, file_list_t *dst,
       struct item_file *d = &dst->list[j];
       struct item_file *s = &src->list[i];
       void     *src_udata = s->userdata;
-      void     *src_adata = s->actiondata;
+      void     *src_adata = menu_entries_get_actiondata(
+            (file_list_t*)src, i);
 
       *d       = *s;
       d->alt   = string_is_empty(d->alt)   ? NULL : strdup(d->alt);
@@ -3285,6 +3306,9 @@ static void ozone_list_deep_copy(const file_list_t *src, file_list_t *dst,
       if (src_udata)
          file_list_set_userdata(dst, j, (void*)ozone_copy_node((const ozone_node_t*)src_udata));
 
+      /* The source entry is bound above while its menu is
+       * still the current one; the copy is only drawn once
+       * the next menu has been pushed */
       if (src_adata)
       {
          void *data = malloc(sizeof(menu_file_list_cbs_t));
@@ -155,6 +155,10 @@ struct ozone_handle
    size_t pointer_categories_selection;
    size_t first_onscreen_entry;
    size_t last_onscreen_entry;
+   /* Range of entries measured by the last layout pass -
+    * see ozone_compute_entries_position() */
+   size_t first_measured_entry;
+   size_t last_measured_entry;
    size_t first_onscreen_category;
    size_t last_onscreen_category;
 
@@ -273,6 +277,7 @@ struct ozone_handle
    bool should_draw_messagebox;
 
    bool need_compute;
+   bool entries_estimated; /* some entry heights are estimates */
    bool draw_old_list;
    bool has_all_assets;
 
@@ -373,6 +378,12 @@ bool ozone_is_playlist(ozone_handle_t *ozone, bool depth);
 
 void ozone_compute_entries_position(ozone_handle_t *ozone);
 
+/* Re-measures the entries around 'centre' if it got near an
+ * entry whose height is only estimated, keeping entry 'anchor'
+ * where it is on screen */
+void ozone_update_entries_window(ozone_handle_t *ozone,
+      size_t centre, size_t anchor_idx);
+
 void ozone_update_scroll(ozone_handle_t *ozone, bool allow_animation, ozone_node_t *node);
 
 void ozone_sidebar_update_collapse(ozone_handle_t *ozone, bool allow_animation);
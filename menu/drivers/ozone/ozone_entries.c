@@ -320,54 +320,132 @@ void ozone_update_scroll(ozone_handle_t *ozone, bool allow_animation, ozone_node
    }
 }
 
-void ozone_compute_entries_position(ozone_handle_t *ozone)
+/* Bulk lists (see menu_entries_is_bulk()) are only measured
+ * this many screens either side of the selection, or of what
+ * is on screen */
+#define OZONE_ENTRIES_WINDOW_SCREENS 2
+
+/* Number of entries that fit on screen at their smallest */
+static size_t ozone_entries_per_screen(ozone_handle_t *ozone,
+      unsigned video_height)
+{
+   if (ozone->dimensions.entry_height <= 0)
+      return 1;
+   return video_height / ozone->dimensions.entry_height + 1;
+}
+
+/* Returns the number of lines the sublabel of entry 'i'
+ * wraps to, or 0 if it has none */
+static unsigned ozone_entry_sublabel_lines(ozone_handle_t *ozone,
+      size_t i, int sublabel_max_width)
+{
+   menu_entry_t entry;
+   char wrapped_sublabel_str[MENU_SUBLABEL_MAX_LENGTH];
+
+   MENU_ENTRY_INIT(entry);
+   entry.path_enabled       = false;
+   entry.label_enabled      = false;
+   entry.rich_label_enabled = false;
+   entry.value_enabled      = false;
+   menu_entry_get(&entry, 0, (unsigned)i, NULL, true);
+
+   if (string_is_empty(entry.sublabel))
+      return 0;
+
+   wrapped_sublabel_str[0] = '\0';
+
+   word_wrap(wrapped_sublabel_str, entry.sublabel,
+         sublabel_max_width /
+         ozone->fonts.entries_sublabel.glyph_width, false, 0);
+
+   return ozone_count_lines(wrapped_sublabel_str);
+}
+
+/* Computes the height and position of every entry,
+ * measuring bulk entries only around 'centre' */
+static void ozone_compute_entries_layout(ozone_handle_t *ozone,
+      size_t centre)
 {
-   /* Compute entries height and adjust scrolling if needed */
    unsigned video_info_height;
    unsigned video_info_width;
-   size_t i, entries_end;
+   size_t i, entries_end, window;
+   int sublabel_max_width;
 
    file_list_t *selection_buf    = NULL;
    int entry_padding             = ozone_get_entries_padding(ozone, false);
    float scale_factor            = ozone->last_scale_factor;
    settings_t          *settings = config_get_ptr();
    bool menu_show_sublabels      = settings->bools.menu_show_sublabels;
-
-   menu_entries_ctl(MENU_ENTRIES_CTL_START_GET, &i);
+   unsigned estimated_lines      = 0;
 
    entries_end   = menu_entries_get_size();
    selection_buf = menu_entries_get_selection_buf_ptr(0);
 
    video_driver_get_size(&video_info_width, &video_info_height);
 
-   ozone->entries_height = 0;
+   ozone->entries_height    = 0;
+   ozone->entries_estimated = false;
 
-   for (i = 0; i < entries_end; i++)
+   /* Empty playlist detection:
+      only one item which icon is
+      OZONE_ENTRIES_ICONS_TEXTURE_CORE_INFO */
+   if (ozone->is_playlist && entries_end == 1)
    {
-      /* Entry */
       menu_entry_t entry;
-      ozone_node_t *node       = NULL;
+      uintptr_t tex;
 
       MENU_ENTRY_INIT(entry);
       entry.path_enabled       = false;
       entry.label_enabled      = false;
       entry.rich_label_enabled = false;
       entry.value_enabled      = false;
-      menu_entry_get(&entry, 0, (unsigned)i, NULL, true);
+      entry.sublabel_enabled   = false;
+      menu_entry_get(&entry, 0, 0, NULL, true);
+
+      tex                   = ozone_entries_icon_get_texture(ozone, entry.enum_idx, entry.type, false);
+      ozone->empty_playlist = tex == ozone->icons_textures[OZONE_ENTRIES_ICONS_TEXTURE_CORE_INFO];
+   }
+   else
+      ozone->empty_playlist = false;
+
+   sublabel_max_width = video_info_width -
+      entry_padding * 2 - ozone->dimensions.entry_icon_padding * 2;
+
+   if (ozone->depth == 1)
+   {
+      sublabel_max_width -= (unsigned) ozone->dimensions_sidebar_width;
+
+      if (ozone->show_thumbnail_bar)
+         sublabel_max_width -= ozone->dimensions.thumbnail_bar_width;
+   }
+
+   window = OZONE_ENTRIES_WINDOW_SCREENS *
+      ozone_entries_per_screen(ozone, video_info_height);
 
-      /* Empty playlist detection:
-         only one item which icon is
-         OZONE_ENTRIES_ICONS_TEXTURE_CORE_INFO */
-      if (ozone->is_playlist && entries_end == 1)
+   ozone->first_measured_entry = (centre > window) ? centre - window : 0;
+   ozone->last_measured_entry  = centre + window;
+
+   /* Bulk entries outside the window are given the
+    * sublabel height of the first one inside it */
+   if (menu_show_sublabels)
+   {
+      for (i = ozone->first_measured_entry;
+            i < entries_end && i <= ozone->last_measured_entry; i++)
       {
-         uintptr_t         tex = ozone_entries_icon_get_texture(ozone, entry.enum_idx, entry.type, false);
-         ozone->empty_playlist = tex == ozone->icons_textures[OZONE_ENTRIES_ICONS_TEXTURE_CORE_INFO];
+         if (menu_entries_is_bulk(selection_buf, i))
+         {
+            estimated_lines = ozone_entry_sublabel_lines(ozone, i,
+                  sublabel_max_width);
+            break;
+         }
       }
-      else
-         ozone->empty_playlist = false;
+   }
 
+   for (i = 0; i < entries_end; i++)
+   {
       /* Cache node */
-      node = (ozone_node_t*)file_list_get_userdata_at_offset(selection_buf, i);
+      ozone_node_t *node = (ozone_node_t*)
+         file_list_get_userdata_at_offset(selection_buf, i);
 
       if (!node)
          continue;
@@ -378,31 +456,21 @@ void ozone_compute_entries_position(ozone_handle_t *ozone)
 
       if (menu_show_sublabels)
       {
-         if (!string_is_empty(entry.sublabel))
+         if (     (i < ozone->first_measured_entry
+               ||  i > ozone->last_measured_entry)
+               && menu_entries_is_bulk(selection_buf, i))
          {
-            int sublabel_max_width;
-            char wrapped_sublabel_str[MENU_SUBLABEL_MAX_LENGTH];
-            wrapped_sublabel_str[0] = '\0';
+            node->sublabel_lines     = estimated_lines;
+            ozone->entries_estimated = true;
+         }
+         else
+            node->sublabel_lines = ozone_entry_sublabel_lines(ozone, i,
+                  sublabel_max_width);
 
+         if (node->sublabel_lines > 0)
+         {
             node->height += ozone->dimensions.entry_spacing + 40 * scale_factor;
 
-            sublabel_max_width = video_info_width -
-               entry_padding * 2 - ozone->dimensions.entry_icon_padding * 2;
-
-            if (ozone->depth == 1)
-            {
-               sublabel_max_width -= (unsigned) ozone->dimensions_sidebar_width;
-
-               if (ozone->show_thumbnail_bar)
-                  sublabel_max_width -= ozone->dimensions.thumbnail_bar_width;
-            }
-
-            word_wrap(wrapped_sublabel_str, entry.sublabel,
-                  sublabel_max_width / 
-                  ozone->fonts.entries_sublabel.glyph_width, false, 0);
-
-            node->sublabel_lines = ozone_count_lines(wrapped_sublabel_str);
-
             if (node->sublabel_lines > 1)
             {
                node->height += (node->sublabel_lines - 1) * ozone->fonts.entries_sublabel.line_height;
@@ -415,12 +483,56 @@ void ozone_compute_entries_position(ozone_handle_t *ozone)
 
       ozone->entries_height += node->height;
    }
+}
+
+void ozone_compute_entries_position(ozone_handle_t *ozone)
+{
+   /* Compute entries height and adjust scrolling if needed */
+   file_list_t *selection_buf = menu_entries_get_selection_buf_ptr(0);
+
+   ozone_compute_entries_layout(ozone, menu_navigation_get_selection());
 
    /* Update scrolling */
    ozone->selection = menu_navigation_get_selection();
    ozone_update_scroll(ozone, false, (ozone_node_t*) file_list_get_userdata_at_offset(selection_buf, ozone->selection));
 }
 
+void ozone_update_entries_window(ozone_handle_t *ozone,
+      size_t centre, size_t anchor_idx)
+{
+   unsigned video_info_height;
+   size_t screen;
+   unsigned anchor_y;
+   file_list_t *selection_buf = NULL;
+   ozone_node_t *anchor       = NULL;
+   size_t entries_end         = menu_entries_get_size();
+
+   if (!ozone->entries_estimated)
+      return;
+
+   video_driver_get_size(NULL, &video_info_height);
+   screen = ozone_entries_per_screen(ozone, video_info_height);
+
+   /* Nothing to do while 'centre' is at least a screen
+    * away from the first estimated entry either side */
+   if (     (ozone->first_measured_entry == 0
+         ||  centre >= ozone->first_measured_entry + screen)
+         && (ozone->last_measured_entry + 1 >= entries_end
+         ||  centre + screen <= ozone->last_measured_entry))
+      return;
+
+   selection_buf = menu_entries_get_selection_buf_ptr(0);
+   anchor        = (ozone_node_t*)file_list_get_userdata_at_offset(
+         selection_buf, anchor_idx);
+   anchor_y      = anchor ? anchor->position_y : 0;
+
+   ozone_compute_entries_layout(ozone, centre);
+
+   if (anchor)
+      ozone->animations.scroll_y += (float)anchor_y -
+         (float)anchor->position_y;
+}
+
 void ozone_entries_update_thumbnail_bar(ozone_handle_t *ozone, bool is_playlist, bool allow_animation)
 {
    struct gfx_animation_ctx_entry entry;
@@ -746,9 +746,8 @@ void ozone_change_tab(ozone_handle_t *ozone,
    menu_ctx_list_t list_info;
    file_list_t *selection_buf = menu_entries_get_selection_buf_ptr(0);
    size_t selection = menu_navigation_get_selection();
-   menu_file_list_cbs_t *cbs = selection_buf ?
-      (menu_file_list_cbs_t*)file_list_get_actiondata_at_offset(selection_buf,
-            selection) : NULL;
+   menu_file_list_cbs_t *cbs =
+      menu_entries_get_actiondata(selection_buf, selection);
 
    list_info.type = MENU_LIST_HORIZONTAL;
    list_info.action = MENU_ACTION_LEFT;
@@ -3857,7 +3857,8 @@ static void stripes_list_deep_copy(const file_list_t *src, file_list_t *dst,
       struct item_file *s = &src->list[i];
 
       void *src_udata = s->userdata;
-      void *src_adata = s->actiondata;
+      void *src_adata = menu_entries_get_actiondata(
+            (file_list_t*)src, i);
 
       *d       = *s;
       d->alt   = string_is_empty(d->alt)   ? NULL : strdup(d->alt);
@@ -3867,6 +3868,9 @@ static void stripes_list_deep_copy(const file_list_t *src, file_list_t *dst,
       if (src_udata)
          file_list_set_userdata(dst, j, (void*)stripes_copy_node((const stripes_node_t*)src_udata));
 
+      /* The source entry is bound above while its menu is
+       * still the current one; the copy is only drawn once
+       * the next menu has been pushed */
       if (src_adata)
       {
          void *data = malloc(sizeof(menu_file_list_cbs_t));
@@ -1183,6 +1183,12 @@ static void xmb_update_thumbnail_image(void *data)
          thumbnail_upscale_threshold,
          network_on_demand_thumbnails);
    }
+
+   /* Load thumbnails of neighbouring entries
+    * in the background */
+   if (xmb->is_playlist)
+      gfx_thumbnail_prefetch(xmb->thumbnail_path_data,
+            playlist, selection, thumbnail_upscale_threshold);
 }
 
 static unsigned xmb_get_system_tab(xmb_handle_t *xmb, unsigned i)
@@ -6373,7 +6379,8 @@ static void xmb_list_deep_copy(const file_list_t *src, file_list_t *dst,
       struct item_file *s = &src->list[i];
 
       void *src_udata = s->userdata;
-      void *src_adata = s->actiondata;
+      void *src_adata = menu_entries_get_actiondata(
+            (file_list_t*)src, i);
 
       *d       = *s;
       d->alt   = string_is_empty(d->alt)   ? NULL : strdup(d->alt);
@@ -6383,6 +6390,9 @@ static void xmb_list_deep_copy(const file_list_t *src, file_list_t *dst,
       if (src_udata)
          file_list_set_userdata(dst, j, (void*)xmb_copy_node((const xmb_node_t*)src_udata));
 
+      /* The source entry is bound above while its menu is
+       * still the current one; the copy is only drawn once
+       * the next menu has been pushed */
       if (src_adata)
       {
          void *data = malloc(sizeof(menu_file_list_cbs_t));
@@ -130,10 +130,19 @@
  * get rid of these */
 struct menu_displaylist_state
 {
+   /* Listing of the file browser directory, while
+    * it is still being read in the background */
+   dir_list_async_t *dir_list;
    enum msg_hash_enums new_type;
    char new_path_entry[4096];
    char new_lbl_entry[4096];
    char new_entry[4096];
+   char dir_list_path[PATH_MAX_LENGTH];
+   /* Path of the entry that was selected when the
+    * last batch of the listing came in */
+   char dir_list_selection[PATH_MAX_LENGTH];
+   /* Set while the list is rebuilt for a new batch */
+   bool dir_list_refresh;
 };
 
 static struct menu_displaylist_state menu_displist_st;
@@ -157,6 +166,70 @@ void filebrowser_set_type(enum filebrowser_enums type)
    filebrowser_types = type;
 }
 
+static void filebrowser_dir_list_cb(dir_list_async_t *listing,
+      void *user_data)
+{
+   struct menu_displaylist_state *p_displist = &menu_displist_st;
+   file_list_t *selection_buf                = menu_entries_get_selection_buf_ptr(0);
+   size_t selection                          = menu_navigation_get_selection();
+   const char *menu_path                     = NULL;
+   bool refresh                              = false;
+
+   menu_entries_get_last_stack(&menu_path, NULL, NULL, NULL, NULL);
+
+   /* Stop reading once the user navigated away */
+   if (!string_is_equal(menu_path, p_displist->dir_list_path))
+   {
+      dir_list_async_free(listing);
+      p_displist->dir_list = NULL;
+      return;
+   }
+
+   /* New entries are sorted in; keep the selection
+    * on the entry it is on rather than on its index */
+   p_displist->dir_list_selection[0] = '\0';
+   if (     selection_buf
+         && selection < selection_buf->size
+         && !string_is_empty(selection_buf->list[selection].path))
+      strlcpy(p_displist->dir_list_selection,
+            selection_buf->list[selection].path,
+            sizeof(p_displist->dir_list_selection));
+
+   p_displist->dir_list_refresh = true;
+   menu_entries_ctl(MENU_ENTRIES_CTL_SET_REFRESH, &refresh);
+   menu_driver_ctl(RARCH_MENU_CTL_SET_PREVENT_POPULATE, NULL);
+}
+
+/* Lists the directory of the file browser without
+ * blocking on huge directories: the first entries are
+ * read right away, the rest by a background task that
+ * rebuilds the list whenever more of it was read. */
+static const struct string_list *filebrowser_dir_list(
+      const char *path, const char *exts,
+      bool show_hidden_files, bool include_compressed)
+{
+   struct menu_displaylist_state *p_displist = &menu_displist_st;
+
+   /* Rebuilds for a new batch reuse the listing,
+    * anything else starts over */
+   if (!(      p_displist->dir_list
+            && p_displist->dir_list_refresh
+            && string_is_equal(path, p_displist->dir_list_path)))
+   {
+      dir_list_async_free(p_displist->dir_list);
+      strlcpy(p_displist->dir_list_path, path,
+            sizeof(p_displist->dir_list_path));
+      p_displist->dir_list_selection[0] = '\0';
+      p_displist->dir_list              = task_push_dir_list(path,
+            exts, true, show_hidden_files, include_compressed, true,
+            filebrowser_dir_list_cb, NULL);
+   }
+
+   p_displist->dir_list_refresh = false;
+
+   return dir_list_async_get_list(p_displist->dir_list);
+}
+
 static void filebrowser_parse(
       menu_displaylist_info_t *info,
       unsigned type_data,
@@ -169,7 +242,11 @@ static void filebrowser_parse(
    size_t i, list_size;
    const struct retro_subsystem_info *subsystem;
    bool ret                             = false;
+   bool async                           = false;
    struct string_list str_list          = {0};
+   const struct string_list *dir_list   = &str_list;
+   struct menu_displaylist_state
+                             *p_displist = &menu_displist_st;
    unsigned items_found                 = 0;
    unsigned files_count                 = 0;
    unsigned dirs_count                  = 0;
@@ -220,13 +297,29 @@ static void filebrowser_parse(
                   (filter_ext && info) ? subsystem->roms[content_get_subsystem_rom_id()].valid_extensions : NULL,
                   true, show_hidden_files, true, false);
       }
-      else if (info && ((info->type_default == FILE_TYPE_MANUAL_SCAN_DAT) || (info->type_default == FILE_TYPE_SIDELOAD_CORE)))
-         ret = dir_list_initialize(&str_list, path,
-               info->exts, true, show_hidden_files, false, false);
       else
-         ret = dir_list_initialize(&str_list, path,
-               (filter_ext && info) ? info->exts : NULL,
-               true, show_hidden_files, true, false);
+      {
+         const char *exts        = (filter_ext && info) ? info->exts : NULL;
+         bool include_compressed = true;
+
+         if (info && ((info->type_default == FILE_TYPE_MANUAL_SCAN_DAT) || (info->type_default == FILE_TYPE_SIDELOAD_CORE)))
+         {
+            exts                 = info->exts;
+            include_compressed   = false;
+         }
+
+         /* Only the menu can be refreshed as entries come in */
+         if (info && info->list == menu_entries_get_selection_buf_ptr(0))
+         {
+            async                = true;
+            dir_list             = filebrowser_dir_list(path, exts,
+                  show_hidden_files, include_compressed);
+            ret                  = dir_list != NULL;
+         }
+         else
+            ret = dir_list_initialize(&str_list, path,
+                  exts, true, show_hidden_files, include_compressed, false);
+      }
    }
 
    switch (filebrowser_types)
@@ -273,9 +366,14 @@ static void filebrowser_parse(
       goto end;
    }
 
-   dir_list_sort(&str_list, true);
+   /* Asynchronous listings are kept sorted */
+   if (!async)
+      dir_list_sort(&str_list, true);
 
-   list_size = str_list.size;
+   list_size = dir_list->size;
+
+   /* Only the entries that get displayed need to be bound */
+   menu_entries_set_deferred(true);
 
    if (list_size > 0)
    {
@@ -285,11 +383,11 @@ static void filebrowser_parse(
          bool is_dir                   = false;
          enum msg_hash_enums enum_idx  = MSG_UNKNOWN;
          enum msg_file_type file_type  = FILE_TYPE_NONE;
-         const char *path              = str_list.elems[i].data;
+         const char *path              = dir_list->elems[i].data;
 
          label[0] = '\0';
 
-         switch (str_list.elems[i].attr.i)
+         switch (dir_list->elems[i].attr.i)
          {
             case RARCH_DIRECTORY:
                file_type = FILE_TYPE_DIRECTORY;
@@ -415,9 +513,19 @@ static void filebrowser_parse(
       }
    }
 
+   menu_entries_set_deferred(false);
+
    dir_list_deinitialize(&str_list);
 
-   if (items_found == 0)
+   if (async && dir_list_async_is_finished(p_displist->dir_list))
+   {
+      dir_list_async_free(p_displist->dir_list);
+      p_displist->dir_list = NULL;
+      async                = false;
+   }
+
+   /* More entries may still be on their way */
+   if (items_found == 0 && !async)
    {
       menu_entries_append_enum(info->list,
             msg_hash_to_str(MENU_ENUM_LABEL_VALUE_NO_ITEMS),
@@ -433,6 +541,20 @@ end:
             path,
             MENU_ENUM_LABEL_PARENT_DIRECTORY,
             FILE_TYPE_PARENT_DIRECTORY, 0, 0);
+
+   if (info && !string_is_empty(p_displist->dir_list_selection))
+   {
+      for (i = 0; i < info->list->size; i++)
+      {
+         if (string_is_equal(info->list->list[i].path,
+                  p_displist->dir_list_selection))
+         {
+            menu_navigation_set_selection(i);
+            break;
+         }
+      }
+      p_displist->dir_list_selection[0] = '\0';
+   }
 }
 
 static int menu_displaylist_parse_core_info(menu_displaylist_info_t *info)
@@ -471,7 +593,7 @@ static int menu_displaylist_parse_core_info(menu_displaylist_info_t *info)
    else if (core_info_get_current_core(&core_info) && core_info)
       core_path = core_info->path;
 
-   if (!core_info || !core_info->config_data)
+   if (!core_info || !core_info->has_info)
    {
       if (menu_entries_append_enum(info->list,
             msg_hash_to_str(MENU_ENUM_LABEL_VALUE_NO_CORE_INFORMATION_AVAILABLE),
@@ -1490,6 +1612,8 @@ static int menu_displaylist_parse_playlist(menu_displaylist_info_t *info,
          sanitization = NULL;
    }
 
+   menu_entries_set_deferred(true);
+
    for (i = 0; i < list_size; i++)
    {
       char menu_entry_label[PATH_MAX_LENGTH];
@@ -1573,6 +1697,8 @@ static int menu_displaylist_parse_playlist(menu_displaylist_info_t *info,
          info->count++;
    }
 
+   menu_entries_set_deferred(false);
+
    if (info->count < 1)
       goto error;
 
@@ -2972,7 +3098,7 @@ static unsigned menu_displaylist_parse_information_list(file_list_t *info_list)
           !string_is_equal(system->library_name,
              msg_hash_to_str(MENU_ENUM_LABEL_VALUE_NO_CORE))
          )
-         && core_info && core_info->config_data
+         && core_info && core_info->has_info
       )
       if (menu_entries_append_enum(info_list,
             msg_hash_to_str(MENU_ENUM_LABEL_VALUE_CORE_INFORMATION),
@@ -9911,6 +10037,7 @@ bool menu_displaylist_ctl(enum menu_displaylist_ctl_state type,
 
             if (db_list)
             {
+               menu_entries_set_deferred(true);
                for (i = 0; i < db_list->count; i++)
                {
                   if (!string_is_empty(db_list->list[i].name))
@@ -9918,6 +10045,7 @@ bool menu_displaylist_ctl(enum menu_displaylist_ctl_state type,
                               info->path, MENU_ENUM_LABEL_RDB_ENTRY, FILE_TYPE_RDB_ENTRY, 0, 0))
                         count++;
                }
+               menu_entries_set_deferred(false);
             }
 
             database_info_list_free(db_list);
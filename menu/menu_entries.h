@@ -129,9 +129,17 @@ typedef struct menu_file_list_cbs
          const char *path,
          char *path_buf, size_t path_buf_size);
    enum msg_hash_enums enum_idx;
-   char action_sublabel_cache[MENU_SUBLABEL_MAX_LENGTH];
-   char action_title_cache   [512];
+   /* Identifies the entry in the shared sublabel/title
+    * caches - see menu_entry_get() */
+   uint32_t cache_id;
    bool checked;
+   /* Set while the setting lookup and callback binding
+    * have not been done yet - see menu_entries_get_actiondata() */
+   bool deferred;
+   /* Set for entries appended while binding was deferred,
+    * whether or not they have been bound since -
+    * see menu_entries_is_bulk() */
+   bool bulk;
 } menu_file_list_cbs_t;
 
 typedef struct menu_entry
@@ -198,6 +206,25 @@ bool menu_entries_ctl(enum menu_entries_ctl_state state, void *data);
 void menu_entries_set_checked(file_list_t *list, size_t entry_idx,
       bool checked);
 
+/* When enabled, entries appended to the current selection
+ * buffer with menu_entries_append_enum() are not bound to
+ * their setting and callbacks until they are first accessed
+ * through menu_entries_get_actiondata(). Meant for bulk
+ * lists (directories, playlists, databases) where only
+ * the entries that are displayed or acted upon need it. */
+void menu_entries_set_deferred(bool deferred);
+
+/* Returns the actiondata of entry 'idx' of 'list',
+ * binding it first if binding was deferred. */
+menu_file_list_cbs_t *menu_entries_get_actiondata(
+      file_list_t *list, size_t idx);
+
+/* Returns whether entry 'idx' of 'list' was appended while
+ * binding was deferred. Such lists can be arbitrarily long,
+ * so drivers should only measure their entries around the
+ * part of the list that is on screen. */
+bool menu_entries_is_bulk(file_list_t *list, size_t idx);
+
 /* Menu entry interface -
  *
  * This provides an abstraction of the currently displayed
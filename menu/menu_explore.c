@@ -15,6 +15,23 @@
  */
 
 #include <stddef.h>
+
+#ifdef HAVE_CONFIG_H
+#include "../config.h"
+#endif
+
+#if (defined(_WIN32) && !defined(_XBOX)) || defined(__unix__) || defined(__APPLE__)
+#include <sys/types.h>
+#include <sys/stat.h>
+#define EXPLORE_HAVE_CACHE
+#endif
+
+#ifdef HAVE_MMAP
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
 #include "menu_driver.h"
 #include "menu_cbs.h"
 #include "../retroarch.h"
@@ -24,11 +41,19 @@
 #include <compat/strcasestr.h>
 #include <compat/strl.h>
 #include <array/rbuf.h>
+#include <file/file_path.h>
+#include <streams/file_stream.h>
+#include <string/stdstring.h>
 
 #define EX_ARENA_ALIGNMENT 8
 #define EX_ARENA_BLOCK_SIZE (64 * 1024)
 #define EX_ARENA_ALIGN_UP(n, a) (((n) + (a) - 1) & ~((a) - 1))
 
+#define EXPLORE_CACHE_MAGIC   0x43505845 /* 'EXPC' */
+#define EXPLORE_CACHE_VERSION 1
+#define EXPLORE_CACHE_FILE    "explore.cache"
+#define EXPLORE_CACHE_NONE    0xFFFFFFFF
+
 /* Explore */
 enum
 {
@@ -56,6 +81,46 @@ enum
    EXPLORE_TYPE_FIRSTITEM        = EXPLORE_TYPE_FIRSTCATEGORY + EXPLORE_CAT_COUNT
 };
 
+/* Explore cache file layout, all in 32-bit words */
+enum
+{
+   EXPLORE_CACHE_HDR_MAGIC = 0,
+   EXPLORE_CACHE_HDR_VERSION,
+   EXPLORE_CACHE_HDR_PLAYLISTS,
+   EXPLORE_CACHE_HDR_RDBS,
+   EXPLORE_CACHE_HDR_DEPS,
+   EXPLORE_CACHE_HDR_STRINGS,
+   EXPLORE_CACHE_HDR_ENTRIES,
+   EXPLORE_CACHE_HDR_SPLITS,
+   EXPLORE_CACHE_HDR_TEXT_SIZE,
+   EXPLORE_CACHE_HDR_PLAYLIST_DIR,
+   EXPLORE_CACHE_HDR_DATABASE_DIR,
+   EXPLORE_CACHE_HDR_CAT_FIRST, /* EXPLORE_CAT_COUNT + 1 words */
+   EXPLORE_CACHE_HEADER_WORDS    = EXPLORE_CACHE_HDR_CAT_FIRST
+                                 + EXPLORE_CAT_COUNT + 1,
+
+   /* Playlist and RDB records */
+   EXPLORE_CACHE_SOURCE_NAME = 0,
+   EXPLORE_CACHE_SOURCE_MTIME_LO,
+   EXPLORE_CACHE_SOURCE_MTIME_HI,
+   EXPLORE_CACHE_SOURCE_SIZE_LO,
+   EXPLORE_CACHE_SOURCE_SIZE_HI,
+   EXPLORE_CACHE_SOURCE_DEP_FIRST, /* playlists only */
+   EXPLORE_CACHE_SOURCE_DEP_COUNT,
+   EXPLORE_CACHE_RDB_WORDS       = EXPLORE_CACHE_SOURCE_DEP_FIRST,
+   EXPLORE_CACHE_PLAYLIST_WORDS  = EXPLORE_CACHE_SOURCE_DEP_COUNT + 1,
+
+   /* Entry records */
+   EXPLORE_CACHE_ENTRY_PLAYLIST = 0,
+   EXPLORE_CACHE_ENTRY_INDEX,
+   EXPLORE_CACHE_ENTRY_LABEL,
+   EXPLORE_CACHE_ENTRY_ORIGINAL_TITLE,
+   EXPLORE_CACHE_ENTRY_SPLIT_FIRST,
+   EXPLORE_CACHE_ENTRY_SPLIT_COUNT,
+   EXPLORE_CACHE_ENTRY_BY,         /* EXPLORE_CAT_COUNT words */
+   EXPLORE_CACHE_ENTRY_WORDS     = EXPLORE_CACHE_ENTRY_BY + EXPLORE_CAT_COUNT
+};
+
 /* Arena allocator */
 typedef struct ex_arena
 {
@@ -80,19 +145,41 @@ typedef struct
 
 typedef struct
 {
-   const struct playlist_entry* playlist_entry;
+   const char *label;
    explore_string_t *by[EXPLORE_CAT_COUNT];
    explore_string_t **split;
 #ifdef EXPLORE_SHOW_ORIGINAL_TITLE
    char* original_title;
 #endif
+   uint32_t playlist;       /* index into playlist_names */
+   uint32_t playlist_index; /* index of the entry in that playlist */
 } explore_entry_t;
 
+/* A cache file as read back from disk */
+typedef struct
+{
+   const uint8_t *data;
+   const uint32_t *header;
+   const uint32_t *playlists;
+   const uint32_t *rdbs;
+   const uint32_t *deps;
+   const uint32_t *strings;
+   const uint32_t *entries;
+   const uint32_t *splits;
+   const char *text;
+   size_t size;
+   bool mapped;
+} explore_cache_t;
+
 typedef struct 
 {
    ex_arena arena; /* ptr alignment */
+   explore_cache_t cache;
    explore_string_t **by[EXPLORE_CAT_COUNT];
    explore_entry_t *entries;
+   /* All playlists in the playlist directory; the
+    * playlists themselves are only loaded on demand */
+   const char **playlist_names;
    playlist_t **playlists;
    uintptr_t *icons;
    const char *label_explore_item_str;
@@ -104,6 +191,38 @@ typedef struct
    bool has_unknown[EXPLORE_CAT_COUNT];
 } explore_state_t;
 
+/* A playlist found while building the list */
+typedef struct
+{
+   const char *name;
+   uint64_t mtime;
+   uint64_t size;
+   uint32_t dep_first;
+   uint32_t dep_count;
+   uint32_t cached; /* index in the cache, if unchanged */
+} explore_source_t;
+
+struct explore_rdb
+{
+   libretrodb_t *handle;
+   ex_hashmap32 playlist_crcs;  /* ptr alignment */
+   ex_hashmap32 playlist_names; /* ptr alignment */
+   uint64_t mtime;
+   uint64_t size;
+   size_t count;
+   bool opened;
+   char systemname[256];
+};
+
+/* A playlist entry waiting to be found in its RDB */
+struct explore_pending
+{
+   const struct playlist_entry *entry;
+   uintptr_t next; /* entry with the same crc or name */
+   uint32_t playlist;
+   uint32_t playlist_index;
+};
+
 static const struct
 {
    const char* rdbkey;
@@ -327,9 +446,15 @@ static int explore_qsort_func_entries(const void *a_, const void *b_)
 {
    const explore_entry_t *a = (const explore_entry_t*)a_;
    const explore_entry_t *b = (const explore_entry_t*)b_;
-   if (a->playlist_entry->label[0] != b->playlist_entry->label[0])
-      return (unsigned char)a->playlist_entry->label[0] - (unsigned char)b->playlist_entry->label[0];
-   return strcasecmp(a->playlist_entry->label, b->playlist_entry->label);
+   int ret;
+   if (a->label[0] != b->label[0])
+      return (unsigned char)a->label[0] - (unsigned char)b->label[0];
+   if ((ret = strcasecmp(a->label, b->label)))
+      return ret;
+   /* Keep the order stable for the cache */
+   if (a->playlist != b->playlist)
+      return a->playlist < b->playlist ? -1 : 1;
+   return a->playlist_index < b->playlist_index ? -1 : 1;
 }
 
 static int explore_qsort_func_menulist(const void *a_, const void *b_)
@@ -366,6 +491,32 @@ static int explore_check_company_suffix(const char* p, bool search_reverse)
    return 0;
 }
 
+/* Returns the unique string of category 'cat' equal
+ * to the first 'len' characters of 'str', adding it
+ * if it doesn't exist yet */
+static explore_string_t *explore_intern_string(
+      explore_state_t *explore, ex_hashmap32 *maps,
+      unsigned cat, const char *str, size_t len)
+{
+   uint32_t hash           = ex_hash32_nocase_filtered(
+         (unsigned char*)str, len, '0', 255);
+   explore_string_t* entry = 
+      (explore_string_t*)ex_hashmap32_getptr(&maps[cat], hash);
+
+   if (!entry)
+   {
+      entry                = (explore_string_t*)
+         ex_arena_alloc(&explore->arena,
+               sizeof(explore_string_t) + len);
+      memcpy(entry->str, str, len);
+      entry->str[len]      = '\0';
+      RBUF_PUSH(explore->by[cat], entry);
+      ex_hashmap32_setptr(&maps[cat], hash, entry);
+   }
+
+   return entry;
+}
+
 static void explore_add_unique_string(
       explore_state_t *explore,
       ex_hashmap32 *maps, explore_entry_t *e,
@@ -376,10 +527,7 @@ static void explore_add_unique_string(
    const char *p;
    const char *p_next;
    if (!str || !*str)
-   {
-      explore->has_unknown[cat] = true;
       return;
-   }
 
    if (!explore_by_info[cat].use_split)
       split_buf = NULL;
@@ -387,8 +535,6 @@ static void explore_add_unique_string(
 
    for (p = str + 1;; p++)
    {
-      size_t len              = 0;
-      uint32_t hash           = 0;
       explore_string_t* entry = NULL;
 
       if (*p != '/' && *p != ',' && *p != '|' && *p != '\0')
@@ -417,22 +563,7 @@ static void explore_add_unique_string(
             p--;
       }
 
-      len                     = p - str;
-      hash                    = ex_hash32_nocase_filtered(
-            (unsigned char*)str, len, '0', 255);
-      entry                   = 
-         (explore_string_t*)ex_hashmap32_getptr(&maps[cat], hash);
-
-      if (!entry)
-      {
-         entry                = (explore_string_t*)
-            ex_arena_alloc(&explore->arena,
-                  sizeof(explore_string_t) + len);
-         memcpy(entry->str, str, len);
-         entry->str[len]      = '\0';
-         RBUF_PUSH(explore->by[cat], entry);
-         ex_hashmap32_setptr(&maps[cat], hash, entry);
-      }
+      entry = explore_intern_string(explore, maps, cat, str, p - str);
 
       if (!e->by[cat])
          e->by[cat] = entry;
@@ -459,6 +590,536 @@ static void explore_add_unique_string(
    }
 }
 
+/* Explore cache
+ *
+ * The result of explore_build_list() is written to a
+ * cache file, which is mapped back in as long as no
+ * playlist or RDB it was built from has changed. When
+ * only some playlists changed, the entries of the others
+ * are taken from the cache and only the changed ones are
+ * matched against their RDBs again.
+ *
+ * All values are native endian 32-bit words. After the
+ * header come the playlist records, the RDB records, the
+ * RDB indices each playlist depends on, the text offsets
+ * of all unique strings (by category, in sorted order),
+ * the entry records (in sorted order), the split string
+ * ids of the entries and finally the text, which holds
+ * all strings. Unique strings are stored in the text as
+ * explore_string_t, so they can be used in place. */
+static void explore_cache_free(explore_cache_t *cache)
+{
+   if (!cache->data)
+      return;
+
+#ifdef HAVE_MMAP
+   if (cache->mapped)
+      munmap((void*)cache->data, cache->size);
+   else
+#endif
+      free((void*)cache->data);
+
+   memset(cache, 0, sizeof(*cache));
+}
+
+static bool explore_stat(const char *path, uint64_t *mtime, uint64_t *size)
+{
+#ifdef EXPLORE_HAVE_CACHE
+   struct stat buf;
+
+   if (stat(path, &buf) == 0)
+   {
+      *mtime = (uint64_t)buf.st_mtime;
+      *size  = (uint64_t)buf.st_size;
+      return true;
+   }
+#endif
+   *mtime = 0;
+   *size  = 0;
+   return false;
+}
+
+static bool explore_cache_get_path(char *s, size_t len,
+      const char *directory_cache, const char *directory_playlist)
+{
+#ifdef EXPLORE_HAVE_CACHE
+   const char *dir = !string_is_empty(directory_cache)
+      ? directory_cache : directory_playlist;
+
+   if (!string_is_empty(dir))
+   {
+      fill_pathname_join(s, dir, EXPLORE_CACHE_FILE, len);
+      return true;
+   }
+#endif
+   return false;
+}
+
+static void explore_rdb_path(char *s, size_t len,
+      const char *directory_database, const char *systemname)
+{
+   fill_pathname_join(s, directory_database, systemname, len);
+   strlcat(s, ".rdb", len);
+}
+
+/* Returns true if the file at 'path' still has the
+ * modification time and size stored in source record 'rec' */
+static bool explore_cache_source_valid(const uint32_t *rec,
+      const char *path)
+{
+   uint64_t mtime, size;
+
+   explore_stat(path, &mtime, &size);
+
+   return rec[EXPLORE_CACHE_SOURCE_MTIME_LO] == (uint32_t)mtime
+       && rec[EXPLORE_CACHE_SOURCE_MTIME_HI] == (uint32_t)(mtime >> 32)
+       && rec[EXPLORE_CACHE_SOURCE_SIZE_LO]  == (uint32_t)size
+       && rec[EXPLORE_CACHE_SOURCE_SIZE_HI]  == (uint32_t)(size >> 32);
+}
+
+static INLINE explore_string_t *explore_cache_string(
+      const explore_cache_t *cache, uint32_t id)
+{
+   return (explore_string_t*)(cache->text + cache->strings[id]);
+}
+
+static unsigned explore_cache_category(
+      const explore_cache_t *cache, uint32_t id)
+{
+   unsigned cat;
+   for (cat = 0; cat != EXPLORE_CAT_COUNT - 1; cat++)
+      if (id < cache->header[EXPLORE_CACHE_HDR_CAT_FIRST + cat + 1])
+         break;
+   return cat;
+}
+
+/* Sets up the section pointers of a freshly read cache
+ * file and checks that every offset and id in it is in
+ * range, so the rest of the code can trust it */
+static bool explore_cache_validate(explore_cache_t *cache,
+      const char *directory_playlist, const char *directory_database)
+{
+   size_t i, j;
+   uint64_t words;
+   uint32_t playlists, rdbs, deps, strings, entries, splits, text_size;
+   const uint32_t *cat_first;
+   const uint32_t *hdr = (const uint32_t*)cache->data;
+
+   if (cache->size < EXPLORE_CACHE_HEADER_WORDS * sizeof(uint32_t))
+      return false;
+
+   if (     (hdr[EXPLORE_CACHE_HDR_MAGIC]   != EXPLORE_CACHE_MAGIC)
+         || (hdr[EXPLORE_CACHE_HDR_VERSION] != EXPLORE_CACHE_VERSION))
+      return false;
+
+   playlists = hdr[EXPLORE_CACHE_HDR_PLAYLISTS];
+   rdbs      = hdr[EXPLORE_CACHE_HDR_RDBS];
+   deps      = hdr[EXPLORE_CACHE_HDR_DEPS];
+   strings   = hdr[EXPLORE_CACHE_HDR_STRINGS];
+   entries   = hdr[EXPLORE_CACHE_HDR_ENTRIES];
+   splits    = hdr[EXPLORE_CACHE_HDR_SPLITS];
+   text_size = hdr[EXPLORE_CACHE_HDR_TEXT_SIZE];
+   cat_first = hdr + EXPLORE_CACHE_HDR_CAT_FIRST;
+   words     = EXPLORE_CACHE_HEADER_WORDS
+      + (uint64_t)playlists * EXPLORE_CACHE_PLAYLIST_WORDS
+      + (uint64_t)rdbs      * EXPLORE_CACHE_RDB_WORDS
+      + (uint64_t)deps
+      + (uint64_t)strings
+      + (uint64_t)entries   * EXPLORE_CACHE_ENTRY_WORDS
+      + (uint64_t)splits;
+
+   if (!text_size || words * sizeof(uint32_t) + text_size != cache->size)
+      return false;
+
+   cache->header    = hdr;
+   cache->playlists = hdr              + EXPLORE_CACHE_HEADER_WORDS;
+   cache->rdbs      = cache->playlists + playlists * EXPLORE_CACHE_PLAYLIST_WORDS;
+   cache->deps      = cache->rdbs      + rdbs      * EXPLORE_CACHE_RDB_WORDS;
+   cache->strings   = cache->deps      + deps;
+   cache->entries   = cache->strings   + strings;
+   cache->splits    = cache->entries   + entries   * EXPLORE_CACHE_ENTRY_WORDS;
+   cache->text      = (const char*)(cache->splits + splits);
+
+   /* The settings the cache was built with */
+   if (     cache->text[text_size - 1] != '\0'
+         || hdr[EXPLORE_CACHE_HDR_PLAYLIST_DIR] >= text_size
+         || hdr[EXPLORE_CACHE_HDR_DATABASE_DIR] >= text_size
+         || !string_is_equal(cache->text
+            + hdr[EXPLORE_CACHE_HDR_PLAYLIST_DIR], directory_playlist)
+         || !string_is_equal(cache->text
+            + hdr[EXPLORE_CACHE_HDR_DATABASE_DIR], directory_database))
+      return false;
+
+   if (cat_first[0] != 0 || cat_first[EXPLORE_CAT_COUNT] != strings)
+      return false;
+
+   for (i = 0; i != EXPLORE_CAT_COUNT; i++)
+   {
+      if (cat_first[i] > cat_first[i + 1])
+         return false;
+
+      for (j = cat_first[i]; j != cat_first[i + 1]; j++)
+      {
+         uint32_t idx;
+         uint32_t offset = cache->strings[j];
+
+         if ((offset & 3) || (uint64_t)offset + sizeof(uint32_t) >= text_size)
+            return false;
+
+         memcpy(&idx, cache->text + offset, sizeof(idx));
+         if (idx != j - cat_first[i])
+            return false;
+      }
+   }
+
+   for (i = 0; i != playlists; i++)
+   {
+      const uint32_t *rec = cache->playlists
+         + i * EXPLORE_CACHE_PLAYLIST_WORDS;
+
+      if (     rec[EXPLORE_CACHE_SOURCE_NAME] >= text_size
+            || (uint64_t)rec[EXPLORE_CACHE_SOURCE_DEP_FIRST]
+             + rec[EXPLORE_CACHE_SOURCE_DEP_COUNT] > deps)
+         return false;
+   }
+
+   for (i = 0; i != rdbs; i++)
+      if (cache->rdbs[i * EXPLORE_CACHE_RDB_WORDS
+            + EXPLORE_CACHE_SOURCE_NAME] >= text_size)
+         return false;
+
+   for (i = 0; i != deps; i++)
+      if (cache->deps[i] >= rdbs)
+         return false;
+
+   for (i = 0; i != entries; i++)
+   {
+      const uint32_t *rec = cache->entries
+         + i * EXPLORE_CACHE_ENTRY_WORDS;
+      uint32_t original   = rec[EXPLORE_CACHE_ENTRY_ORIGINAL_TITLE];
+
+      if (     rec[EXPLORE_CACHE_ENTRY_PLAYLIST] >= playlists
+            || rec[EXPLORE_CACHE_ENTRY_LABEL]    >= text_size
+            || (original != EXPLORE_CACHE_NONE && original >= text_size)
+            || (uint64_t)rec[EXPLORE_CACHE_ENTRY_SPLIT_FIRST]
+             + rec[EXPLORE_CACHE_ENTRY_SPLIT_COUNT] > splits
+            || rec[EXPLORE_CACHE_ENTRY_BY + EXPLORE_BY_SYSTEM]
+             == EXPLORE_CACHE_NONE)
+         return false;
+
+      for (j = 0; j != EXPLORE_CAT_COUNT; j++)
+      {
+         uint32_t id = rec[EXPLORE_CACHE_ENTRY_BY + j];
+         if (id != EXPLORE_CACHE_NONE
+               && (id < cat_first[j] || id >= cat_first[j + 1]))
+            return false;
+      }
+   }
+
+   for (i = 0; i != splits; i++)
+      if (cache->splits[i] >= strings)
+         return false;
+
+   return true;
+}
+
+/* Maps the cache file at 'path', or reads it in one go
+ * where mmap() is not available */
+static bool explore_cache_load(explore_cache_t *cache, const char *path,
+      const char *directory_playlist, const char *directory_database)
+{
+   void *buff  = NULL;
+   int64_t len = 0;
+#ifdef HAVE_MMAP
+   struct stat st;
+   int fd      = open(path, O_RDONLY);
+
+   if (fd >= 0)
+   {
+      if (fstat(fd, &st) == 0 && st.st_size > 0)
+      {
+         buff = mmap(NULL, (size_t)st.st_size,
+               PROT_READ, MAP_SHARED, fd, 0);
+
+         if (buff != MAP_FAILED)
+         {
+            cache->data   = (const uint8_t*)buff;
+            cache->size   = (size_t)st.st_size;
+            cache->mapped = true;
+         }
+      }
+      close(fd);
+   }
+#endif
+
+   if (!cache->data)
+   {
+      if (     !path_is_valid(path)
+            || !filestream_read_file(path, &buff, &len))
+         return false;
+
+      cache->data   = (const uint8_t*)buff;
+      cache->size   = (size_t)len;
+      cache->mapped = false;
+   }
+
+   if (!explore_cache_validate(cache,
+            directory_playlist, directory_database))
+   {
+      explore_cache_free(cache);
+      return false;
+   }
+
+   return true;
+}
+
+/* Builds the state directly on top of a valid cache,
+ * which the state takes ownership of */
+static void explore_cache_apply(explore_state_t *explore,
+      explore_cache_t *cache)
+{
+   size_t i, j;
+   unsigned cat;
+   uint32_t playlists = cache->header[EXPLORE_CACHE_HDR_PLAYLISTS];
+   uint32_t entries   = cache->header[EXPLORE_CACHE_HDR_ENTRIES];
+
+   for (cat = 0; cat != EXPLORE_CAT_COUNT; cat++)
+   {
+      uint32_t first = cache->header[EXPLORE_CACHE_HDR_CAT_FIRST + cat];
+      uint32_t count = cache->header[EXPLORE_CACHE_HDR_CAT_FIRST + cat + 1]
+         - first;
+
+      RBUF_RESIZE(explore->by[cat], count);
+      for (i = 0; i != count; i++)
+         explore->by[cat][i] = explore_cache_string(cache,
+               first + (uint32_t)i);
+   }
+
+   RBUF_RESIZE(explore->playlist_names, playlists);
+   RBUF_RESIZE(explore->playlists, playlists);
+   for (i = 0; i != playlists; i++)
+   {
+      explore->playlist_names[i] = cache->text + cache->playlists[
+         i * EXPLORE_CACHE_PLAYLIST_WORDS + EXPLORE_CACHE_SOURCE_NAME];
+      explore->playlists[i]      = NULL;
+   }
+
+   RBUF_RESIZE(explore->entries, entries);
+   for (i = 0; i != entries; i++)
+   {
+      const uint32_t *rec = cache->entries + i * EXPLORE_CACHE_ENTRY_WORDS;
+      explore_entry_t *e  = &explore->entries[i];
+      uint32_t split_cnt  = rec[EXPLORE_CACHE_ENTRY_SPLIT_COUNT];
+
+      e->label            = cache->text + rec[EXPLORE_CACHE_ENTRY_LABEL];
+      e->playlist         = rec[EXPLORE_CACHE_ENTRY_PLAYLIST];
+      e->playlist_index   = rec[EXPLORE_CACHE_ENTRY_INDEX];
+      e->split            = NULL;
+#ifdef EXPLORE_SHOW_ORIGINAL_TITLE
+      e->original_title   = NULL;
+      if (rec[EXPLORE_CACHE_ENTRY_ORIGINAL_TITLE] != EXPLORE_CACHE_NONE)
+         e->original_title = (char*)cache->text
+            + rec[EXPLORE_CACHE_ENTRY_ORIGINAL_TITLE];
+#endif
+
+      for (cat = 0; cat != EXPLORE_CAT_COUNT; cat++)
+      {
+         uint32_t id = rec[EXPLORE_CACHE_ENTRY_BY + cat];
+         e->by[cat]  = (id == EXPLORE_CACHE_NONE)
+            ? NULL : explore_cache_string(cache, id);
+      }
+
+      if (split_cnt)
+      {
+         const uint32_t *split = cache->splits
+            + rec[EXPLORE_CACHE_ENTRY_SPLIT_FIRST];
+
+         e->split = (explore_string_t **)ex_arena_alloc(&explore->arena,
+               (split_cnt + 1) * sizeof(*e->split));
+         for (j = 0; j != split_cnt; j++)
+            e->split[j] = explore_cache_string(cache, split[j]);
+         e->split[split_cnt] = NULL; /* terminator */
+      }
+   }
+
+   explore->cache = *cache;
+   memset(cache, 0, sizeof(*cache));
+}
+
+static uint32_t explore_cache_add_text(char **text, const char *str)
+{
+   uint32_t offset = (uint32_t)RBUF_LEN(*text);
+   size_t len      = strlen(str) + 1;
+
+   RBUF_RESIZE(*text, offset + len);
+   memcpy(*text + offset, str, len);
+   return offset;
+}
+
+/* Adds 'str' as an aligned explore_string_t */
+static uint32_t explore_cache_add_string(char **text,
+      const explore_string_t *str)
+{
+   uint32_t offset;
+
+   while (RBUF_LEN(*text) & 3)
+      RBUF_PUSH(*text, '\0');
+
+   offset = (uint32_t)RBUF_LEN(*text);
+   RBUF_RESIZE(*text, offset + sizeof(str->idx));
+   memcpy(*text + offset, &str->idx, sizeof(str->idx));
+   explore_cache_add_text(text, str->str);
+   return offset;
+}
+
+static void explore_cache_add_source(uint32_t **words,
+      const char *name, uint64_t mtime, uint64_t size, char **text)
+{
+   RBUF_PUSH(*words, explore_cache_add_text(text, name));
+   RBUF_PUSH(*words, (uint32_t)mtime);
+   RBUF_PUSH(*words, (uint32_t)(mtime >> 32));
+   RBUF_PUSH(*words, (uint32_t)size);
+   RBUF_PUSH(*words, (uint32_t)(size >> 32));
+}
+
+static void explore_cache_write(const explore_state_t *explore,
+      const char *path,
+      const char *directory_playlist, const char *directory_database,
+      const explore_source_t *playlists,
+      const struct explore_rdb *rdbs, const uint32_t *deps)
+{
+   size_t i;
+   unsigned cat;
+   uint32_t header[EXPLORE_CACHE_HEADER_WORDS];
+   char dir[PATH_MAX_LENGTH];
+   char tmp_path[PATH_MAX_LENGTH];
+   uint32_t *words = NULL;
+   uint32_t *split = NULL;
+   char *text      = NULL;
+   RFILE *file     = NULL;
+   bool success    = false;
+
+   header[EXPLORE_CACHE_HDR_MAGIC]        = EXPLORE_CACHE_MAGIC;
+   header[EXPLORE_CACHE_HDR_VERSION]      = EXPLORE_CACHE_VERSION;
+   header[EXPLORE_CACHE_HDR_PLAYLISTS]    = (uint32_t)RBUF_LEN(playlists);
+   header[EXPLORE_CACHE_HDR_RDBS]         = (uint32_t)RBUF_LEN(rdbs);
+   header[EXPLORE_CACHE_HDR_DEPS]         = (uint32_t)RBUF_LEN(deps);
+   header[EXPLORE_CACHE_HDR_ENTRIES]      = (uint32_t)RBUF_LEN(explore->entries);
+   header[EXPLORE_CACHE_HDR_PLAYLIST_DIR] = explore_cache_add_text(&text,
+         directory_playlist);
+   header[EXPLORE_CACHE_HDR_DATABASE_DIR] = explore_cache_add_text(&text,
+         directory_database);
+
+   for (i = 0; i != RBUF_LEN(playlists); i++)
+   {
+      explore_cache_add_source(&words, playlists[i].name,
+            playlists[i].mtime, playlists[i].size, &text);
+      RBUF_PUSH(words, playlists[i].dep_first);
+      RBUF_PUSH(words, playlists[i].dep_count);
+   }
+
+   for (i = 0; i != RBUF_LEN(rdbs); i++)
+      explore_cache_add_source(&words, rdbs[i].systemname,
+            rdbs[i].mtime, rdbs[i].size, &text);
+
+   for (i = 0; i != RBUF_LEN(deps); i++)
+      RBUF_PUSH(words, deps[i]);
+
+   header[EXPLORE_CACHE_HDR_CAT_FIRST] = 0;
+   for (cat = 0; cat != EXPLORE_CAT_COUNT; cat++)
+   {
+      for (i = 0; i != RBUF_LEN(explore->by[cat]); i++)
+         RBUF_PUSH(words,
+               explore_cache_add_string(&text, explore->by[cat][i]));
+
+      header[EXPLORE_CACHE_HDR_CAT_FIRST + cat + 1] =
+         header[EXPLORE_CACHE_HDR_CAT_FIRST + cat]
+         + (uint32_t)RBUF_LEN(explore->by[cat]);
+   }
+   header[EXPLORE_CACHE_HDR_STRINGS] =
+      header[EXPLORE_CACHE_HDR_CAT_FIRST + EXPLORE_CAT_COUNT];
+
+   for (i = 0; i != RBUF_LEN(explore->entries); i++)
+   {
+      const explore_entry_t *e = &explore->entries[i];
+      uint32_t split_first     = (uint32_t)RBUF_LEN(split);
+      explore_string_t **s;
+
+      for (s = e->split; s && *s; s++)
+      {
+         /* Split strings can be from any category */
+         for (cat = 0; cat != EXPLORE_CAT_COUNT; cat++)
+         {
+            if (     (*s)->idx < RBUF_LEN(explore->by[cat])
+                  && explore->by[cat][(*s)->idx] == *s)
+            {
+               RBUF_PUSH(split, header[EXPLORE_CACHE_HDR_CAT_FIRST + cat]
+                     + (*s)->idx);
+               break;
+            }
+         }
+      }
+
+      RBUF_PUSH(words, e->playlist);
+      RBUF_PUSH(words, e->playlist_index);
+      RBUF_PUSH(words, explore_cache_add_text(&text, e->label));
+#ifdef EXPLORE_SHOW_ORIGINAL_TITLE
+      RBUF_PUSH(words, e->original_title
+            ? explore_cache_add_text(&text, e->original_title)
+            : EXPLORE_CACHE_NONE);
+#else
+      RBUF_PUSH(words, EXPLORE_CACHE_NONE);
+#endif
+      RBUF_PUSH(words, split_first);
+      RBUF_PUSH(words, (uint32_t)RBUF_LEN(split) - split_first);
+
+      for (cat = 0; cat != EXPLORE_CAT_COUNT; cat++)
+         RBUF_PUSH(words, e->by[cat]
+               ? header[EXPLORE_CACHE_HDR_CAT_FIRST + cat] + e->by[cat]->idx
+               : EXPLORE_CACHE_NONE);
+   }
+
+   header[EXPLORE_CACHE_HDR_SPLITS]    = (uint32_t)RBUF_LEN(split);
+   header[EXPLORE_CACHE_HDR_TEXT_SIZE] = (uint32_t)RBUF_LEN(text);
+
+   fill_pathname_basedir(dir, path, sizeof(dir));
+   strlcpy(tmp_path, path, sizeof(tmp_path));
+   strlcat(tmp_path, ".tmp", sizeof(tmp_path));
+
+   if (     (path_is_directory(dir) || path_mkdir(dir))
+         && (file = filestream_open(tmp_path,
+               RETRO_VFS_FILE_ACCESS_WRITE,
+               RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+   {
+      success = (filestream_write(file, header, sizeof(header))
+               == sizeof(header))
+            && (filestream_write(file, words, RBUF_SIZEOF(words))
+               == (int64_t)RBUF_SIZEOF(words))
+            && (filestream_write(file, split, RBUF_SIZEOF(split))
+               == (int64_t)RBUF_SIZEOF(split))
+            && (filestream_write(file, text, RBUF_SIZEOF(text))
+               == (int64_t)RBUF_SIZEOF(text));
+
+      filestream_close(file);
+
+      if (success)
+      {
+         /* rename() will not replace an existing
+          * file on all platforms */
+         if (path_is_valid(path))
+            filestream_delete(path);
+         success = (filestream_rename(tmp_path, path) == 0);
+      }
+
+      if (!success)
+         filestream_delete(tmp_path);
+   }
+
+   RBUF_FREE(words);
+   RBUF_FREE(split);
+   RBUF_FREE(text);
+}
+
 static void explore_unload_icons(explore_state_t *state)
 {
    unsigned i;
@@ -480,12 +1141,15 @@ static void explore_free(explore_state_t *state)
    RBUF_FREE(state->entries);
 
    for (i = 0; i != RBUF_LEN(state->playlists); i++)
-      playlist_free(state->playlists[i]);
+      if (state->playlists[i])
+         playlist_free(state->playlists[i]);
    RBUF_FREE(state->playlists);
+   RBUF_FREE(state->playlist_names);
 
    explore_unload_icons(state);
    RBUF_FREE(state->icons);
 
+   explore_cache_free(&state->cache);
    ex_arena_free(&state->arena);
 }
 
@@ -539,20 +1203,267 @@ static void explore_load_icons(explore_state_t *state)
    }
 }
 
-static explore_state_t *explore_build_list(void)
+static uintptr_t explore_add_rdb(struct explore_rdb **rdbs,
+      ex_hashmap32 *rdb_indices, const char *directory_database,
+      const char *db_name, size_t db_name_len)
 {
-   unsigned i;
    char tmp[PATH_MAX_LENGTH];
-   struct explore_rdb
+   struct explore_rdb newrdb;
+   uint32_t rdb_hash = ex_hash32_nocase_filtered(
+         (unsigned char*)db_name, db_name_len, '0', 255);
+   uintptr_t rdb_num = ex_hashmap32_getnum(rdb_indices, rdb_hash);
+
+   if (rdb_num)
+      return rdb_num;
+
+   newrdb.handle = NULL;
+   newrdb.count  = 0;
+   newrdb.opened = false;
+   ex_hashmap32_init(&newrdb.playlist_crcs);
+   ex_hashmap32_init(&newrdb.playlist_names);
+
+   if (db_name_len >= sizeof(newrdb.systemname))
+      db_name_len = sizeof(newrdb.systemname)-1;
+   memcpy(newrdb.systemname, db_name, db_name_len);
+   newrdb.systemname[db_name_len] = '\0';
+
+   explore_rdb_path(tmp, sizeof(tmp),
+         directory_database, newrdb.systemname);
+   explore_stat(tmp, &newrdb.mtime, &newrdb.size);
+
+   RBUF_PUSH(*rdbs, newrdb);
+   rdb_num = (uintptr_t)RBUF_LEN(*rdbs);
+   ex_hashmap32_setnum(rdb_indices, rdb_hash, rdb_num);
+   return rdb_num;
+}
+
+/* Records that the playlist whose dependencies start
+ * at 'dep_first' uses RDB 'rdb' */
+static void explore_add_dep(uint32_t **deps, uint32_t dep_first,
+      uint32_t rdb)
+{
+   size_t i;
+   for (i = dep_first; i != RBUF_LEN(*deps); i++)
+      if ((*deps)[i] == rdb)
+         return;
+   RBUF_PUSH(*deps, rdb);
+}
+
+static void explore_add_split(explore_state_t *explore,
+      explore_entry_t *e, explore_string_t ***split_buf)
+{
+   size_t len;
+
+   if (!RBUF_LEN(*split_buf))
+      return;
+
+   RBUF_PUSH(*split_buf, NULL); /* terminator */
+   len        = RBUF_SIZEOF(*split_buf);
+   e->split   = (explore_string_t **)
+      ex_arena_alloc(&explore->arena, len);
+   memcpy(e->split, *split_buf, len);
+   RBUF_CLEAR(*split_buf);
+}
+
+static char *explore_strdup(explore_state_t *explore, const char *str)
+{
+   size_t len = strlen(str) + 1;
+   char *s    = (char*)ex_arena_alloc(&explore->arena, len);
+   memcpy(s, str, len);
+   return s;
+}
+
+static playlist_t *explore_open_playlist(
+      const char *directory_playlist, const char *fname)
+{
+   playlist_config_t playlist_config;
+
+   playlist_config.path[0]                   = '\0';
+   playlist_config.base_content_directory[0] = '\0';
+   playlist_config.capacity                  = COLLECTION_SIZE;
+   playlist_config.old_format                = false;
+   playlist_config.compress                  = false;
+   playlist_config.fuzzy_archive_match       = false;
+   playlist_config.autofix_paths             = false;
+
+   fill_pathname_join(playlist_config.path,
+         directory_playlist, fname, sizeof(playlist_config.path));
+   return playlist_init(&playlist_config);
+}
+
+/* Matches the entries of playlist 'src' against the
+ * RDBs they belong to. Entries are only queued here,
+ * the RDBs are read once all playlists are known */
+static void explore_scan_playlist(explore_state_t *explore,
+      explore_source_t *src, uint32_t playlist_num,
+      struct explore_rdb **rdbs, ex_hashmap32 *rdb_indices,
+      struct explore_pending **pending, uint32_t **deps,
+      const char *directory_playlist, const char *directory_database)
+{
+   size_t j, used_entries = 0;
+   const char *fname      = src->name;
+   const char *fext       = strrchr(fname, '.');
+   playlist_t *playlist   = explore_open_playlist(directory_playlist, fname);
+
+   for (j = 0; j < playlist_size(playlist); j++)
+   {
+      uintptr_t rdb_num;
+      uint32_t entry_crc32;
+      struct explore_pending pend;
+      struct explore_rdb* rdb             = NULL;
+      const struct playlist_entry *entry  = NULL;
+      const char *db_name                 = fname;
+      const char *db_ext                  = fext;
+      playlist_get_index(playlist, j, &entry);
+
+      /* We also could build label from file name, for now it's required */
+      if (!entry->label || !*entry->label)
+         continue;
+
+      /* For auto scanned playlists the entry db_name matches the
+       * lpl file name and we can just use that */
+      if (entry->db_name && *entry->db_name
+            && strcasecmp(entry->db_name, fname))
+      {
+         db_name = entry->db_name;
+         db_ext = strrchr(db_name, '.');
+         if (!db_ext)
+            db_ext = db_name + strlen(db_name);
+      }
+
+      rdb_num = explore_add_rdb(rdbs, rdb_indices,
+            directory_database, db_name, db_ext - db_name);
+      explore_add_dep(deps, src->dep_first, (uint32_t)(rdb_num - 1));
+
+      rdb = &(*rdbs)[rdb_num - 1];
+      if (!rdb->opened)
+      {
+         char tmp[PATH_MAX_LENGTH];
+
+         explore_rdb_path(tmp, sizeof(tmp),
+               directory_database, rdb->systemname);
+
+         rdb->opened = true;
+         rdb->handle = libretrodb_new();
+
+         if (libretrodb_open(tmp, rdb->handle) != 0)
+         {
+            /* Invalid RDB file */
+            libretrodb_free(rdb->handle);
+            rdb->handle = NULL;
+         }
+      }
+
+      if (!rdb->handle)
+         continue;
+
+      pend.entry          = entry;
+      pend.playlist       = playlist_num;
+      pend.playlist_index = (uint32_t)j;
+
+      /* The same game can be in more than one playlist */
+      rdb->count++;
+      entry_crc32 = (uint32_t)strtoul(
+            (entry->crc32 ? entry->crc32 : ""), NULL, 16);
+      if (entry_crc32)
+      {
+         pend.next = ex_hashmap32_getnum(&rdb->playlist_crcs, entry_crc32);
+         RBUF_PUSH(*pending, pend);
+         ex_hashmap32_setnum(&rdb->playlist_crcs,
+               entry_crc32, RBUF_LEN(*pending));
+      }
+      else
+      {
+         pend.next = ex_hashmap32_strgetnum(&rdb->playlist_names,
+               entry->label);
+         RBUF_PUSH(*pending, pend);
+         ex_hashmap32_strsetnum(&rdb->playlist_names,
+               entry->label, RBUF_LEN(*pending));
+      }
+      used_entries++;
+   }
+
+   if (used_entries)
+      explore->playlists[playlist_num] = playlist;
+   else
+      playlist_free(playlist);
+}
+
+/* Adds the entries of playlists that are unchanged since
+ * the cache was written, mapping their playlist indices
+ * through 'playlist_map' */
+static void explore_import_cache(explore_state_t *explore,
+      const explore_cache_t *cache, const uint32_t *playlist_map,
+      ex_hashmap32 *cat_maps, explore_string_t ***split_buf)
+{
+   size_t i, j;
+   unsigned cat;
+
+   for (i = 0; i != cache->header[EXPLORE_CACHE_HDR_ENTRIES]; i++)
    {
-      libretrodb_t *handle;
-      ex_hashmap32 playlist_crcs;  /* ptr alignment */
-      ex_hashmap32 playlist_names; /* ptr alignment */
-      size_t count;
-      char systemname[256];
+      explore_entry_t e;
+      const uint32_t *rec = cache->entries + i * EXPLORE_CACHE_ENTRY_WORDS;
+      const uint32_t *split = cache->splits
+         + rec[EXPLORE_CACHE_ENTRY_SPLIT_FIRST];
+      uint32_t playlist   = playlist_map[rec[EXPLORE_CACHE_ENTRY_PLAYLIST]];
+
+      if (playlist == EXPLORE_CACHE_NONE)
+         continue;
+
+      e.label             = explore_strdup(explore,
+            cache->text + rec[EXPLORE_CACHE_ENTRY_LABEL]);
+      e.playlist          = playlist;
+      e.playlist_index    = rec[EXPLORE_CACHE_ENTRY_INDEX];
+      e.split             = NULL;
+#ifdef EXPLORE_SHOW_ORIGINAL_TITLE
+      e.original_title    = NULL;
+      if (rec[EXPLORE_CACHE_ENTRY_ORIGINAL_TITLE] != EXPLORE_CACHE_NONE)
+         e.original_title = explore_strdup(explore, cache->text
+               + rec[EXPLORE_CACHE_ENTRY_ORIGINAL_TITLE]);
+#endif
+
+      for (cat = 0; cat != EXPLORE_CAT_COUNT; cat++)
+      {
+         uint32_t id = rec[EXPLORE_CACHE_ENTRY_BY + cat];
+         const char *str;
+
+         e.by[cat]   = NULL;
+         if (id == EXPLORE_CACHE_NONE)
+            continue;
+
+         str         = explore_cache_string(cache, id)->str;
+         e.by[cat]   = explore_intern_string(explore,
+               cat_maps, cat, str, strlen(str));
+      }
+
+      for (j = 0; j != rec[EXPLORE_CACHE_ENTRY_SPLIT_COUNT]; j++)
+      {
+         const char *str = explore_cache_string(cache, split[j])->str;
+         RBUF_PUSH(*split_buf, explore_intern_string(explore, cat_maps,
+                  explore_cache_category(cache, split[j]),
+                  str, strlen(str)));
+      }
+
+      explore_add_split(explore, &e, split_buf);
+      RBUF_PUSH(explore->entries, e);
    }
-   *rdbs                                    = NULL;
+}
+
+static explore_state_t *explore_build_list(void)
+{
+   unsigned i;
+   char tmp[PATH_MAX_LENGTH];
+   char cache_path[PATH_MAX_LENGTH];
+   explore_cache_t cache;
+   struct explore_rdb *rdbs                 = NULL;
+   struct explore_pending *pending          = NULL;
+   explore_source_t *sources                = NULL;
+   uint32_t *deps                           = NULL;
+   uint32_t *playlist_map                   = NULL;
+   bool *rdb_valid                          = NULL;
+   bool cache_complete                      = false;
    ex_hashmap32 rdb_indices                 = {0};
+   ex_hashmap32 cached_playlists            = {0};
    ex_hashmap32 cat_maps[EXPLORE_CAT_COUNT] = {{0}};
    explore_string_t **split_buf             = NULL;
    settings_t *settings                     = config_get_ptr();
@@ -569,23 +1480,42 @@ static explore_state_t *explore_build_list(void)
    explore->label_explore_item_str    = 
       msg_hash_to_str(MENU_ENUM_LABEL_EXPLORE_ITEM);
 
-   /* Index all playlists */
+   memset(&cache, 0, sizeof(cache));
+   cache_path[0] = '\0';
+
+   if (     explore_cache_get_path(cache_path, sizeof(cache_path),
+               settings->paths.directory_cache, directory_playlist)
+         && explore_cache_load(&cache, cache_path,
+               directory_playlist, directory_database))
+   {
+      uint32_t rdb_count = cache.header[EXPLORE_CACHE_HDR_RDBS];
+
+      rdb_valid          = (bool*)calloc(rdb_count + 1, sizeof(bool));
+
+      for (i = 0; i != rdb_count; i++)
+      {
+         const uint32_t *rec = cache.rdbs + i * EXPLORE_CACHE_RDB_WORDS;
+         explore_rdb_path(tmp, sizeof(tmp), directory_database,
+               cache.text + rec[EXPLORE_CACHE_SOURCE_NAME]);
+         rdb_valid[i]        = explore_cache_source_valid(rec, tmp);
+      }
+
+      for (i = 0; i != cache.header[EXPLORE_CACHE_HDR_PLAYLISTS]; i++)
+         ex_hashmap32_strsetnum(&cached_playlists, cache.text
+               + cache.playlists[i * EXPLORE_CACHE_PLAYLIST_WORDS
+               + EXPLORE_CACHE_SOURCE_NAME], i + 1);
+
+      cache_complete     = true;
+   }
+
+   /* Find all playlists and check which of them are
+    * unchanged since the cache was written */
    for (dir = retro_vfs_opendir_impl(directory_playlist, false); dir;)
    {
-      playlist_config_t playlist_config;
-      size_t j, used_entries                    = 0;
-      playlist_t *playlist                      = NULL;
+      explore_source_t src;
+      uintptr_t cached_num;
       const char *fext                          = NULL;
       const char *fname                         = NULL;
-      uint32_t fhash;
-
-      playlist_config.path[0]                   = '\0';
-      playlist_config.base_content_directory[0] = '\0';
-      playlist_config.capacity                  = 0;
-      playlist_config.old_format                = false;
-      playlist_config.compress                  = false;
-      playlist_config.fuzzy_archive_match       = false;
-      playlist_config.autofix_paths             = false;
 
       if (!retro_vfs_readdir_impl(dir))
       {
@@ -600,110 +1530,113 @@ static explore_state_t *explore_build_list(void)
       if (!fext || strcasecmp(fext, ".lpl"))
          continue;
 
-      fill_pathname_join(playlist_config.path,
-            directory_playlist, fname, sizeof(playlist_config.path));
-      playlist_config.capacity          = COLLECTION_SIZE;
-      playlist                          = playlist_init(&playlist_config);
+      fill_pathname_join(tmp, directory_playlist, fname, sizeof(tmp));
 
-      fhash = ex_hash32_nocase_filtered(
-            (unsigned char*)fname, fext - fname, '0', 255);
+      src.name      = explore_strdup(explore, fname);
+      src.cached    = EXPLORE_CACHE_NONE;
+      src.dep_first = 0;
+      src.dep_count = 0;
+      explore_stat(tmp, &src.mtime, &src.size);
 
-      for (j = 0; j < playlist_size(playlist); j++)
+      if (     cache.data
+            && (cached_num = ex_hashmap32_strgetnum(
+                  &cached_playlists, fname)))
       {
-         uintptr_t rdb_num;
-         uint32_t entry_crc32;
-         struct explore_rdb* rdb             = NULL;
-         const struct playlist_entry *entry  = NULL;
-         const char *db_name                 = fname;
-         const char *db_ext                  = fext;
-         uint32_t rdb_hash                   = fhash;
-         playlist_get_index(playlist, j, &entry);
-
-         /* We also could build label from file name, for now it's required */
-         if (!entry->label || !*entry->label)
-            continue;
-
-         /* For auto scanned playlists the entry db_name matches the
-          * lpl file name and we can just use that */
-         if (entry->db_name && *entry->db_name
-               && strcasecmp(entry->db_name, fname))
-         {
-            db_name = entry->db_name;
-            db_ext = strrchr(db_name, '.');
-            if (!db_ext)
-               db_ext = db_name + strlen(db_name);
-            rdb_hash = ex_hash32_nocase_filtered(
-               (unsigned char*)db_name, db_ext - db_name, '0', 255);
-         }
-
-         rdb_num = ex_hashmap32_getnum(&rdb_indices, rdb_hash);
-         if (!rdb_num)
-         {
-            struct explore_rdb newrdb;
-            size_t systemname_len;
+         const uint32_t *rec = cache.playlists
+            + (cached_num - 1) * EXPLORE_CACHE_PLAYLIST_WORDS;
+         const uint32_t *dep = cache.deps
+            + rec[EXPLORE_CACHE_SOURCE_DEP_FIRST];
+         bool valid          =
+                string_is_equal(fname,
+                  cache.text + rec[EXPLORE_CACHE_SOURCE_NAME])
+            && explore_cache_source_valid(rec, tmp);
+         uint32_t k;
+
+         for (k = 0; valid
+               && k != rec[EXPLORE_CACHE_SOURCE_DEP_COUNT]; k++)
+            valid = rdb_valid[dep[k]];
+
+         if (valid)
+            src.cached = (uint32_t)(cached_num - 1);
+      }
 
-            newrdb.handle = libretrodb_new();
-            newrdb.count  = 0;
-            ex_hashmap32_init(&newrdb.playlist_crcs);
-            ex_hashmap32_init(&newrdb.playlist_names);
+      if (src.cached == EXPLORE_CACHE_NONE)
+         cache_complete = false;
 
-            systemname_len = db_ext - db_name;
-            if (systemname_len >= sizeof(newrdb.systemname))
-               systemname_len = sizeof(newrdb.systemname)-1;
-            memcpy(newrdb.systemname, db_name, systemname_len);
-            newrdb.systemname[systemname_len] = '\0';
+      RBUF_PUSH(sources, src);
+   }
 
-            fill_pathname_join_noext(
-                  tmp, directory_database, db_name, sizeof(tmp));
-            strlcat(tmp, ".rdb", sizeof(tmp));
+   /* Nothing changed, use the cache as is */
+   if (     cache_complete
+         && RBUF_LEN(sources) == cache.header[EXPLORE_CACHE_HDR_PLAYLISTS])
+   {
+      explore_cache_apply(explore, &cache);
+      goto end;
+   }
 
-            if (libretrodb_open(tmp, newrdb.handle) != 0)
-            {
-               /* Invalid RDB file */
-               libretrodb_free(newrdb.handle);
-               ex_hashmap32_setnum(&rdb_indices, rdb_hash, (uintptr_t)-1);
-               continue;
-            }
+   if (cache.data)
+   {
+      playlist_map = (uint32_t*)malloc((cache.header[
+            EXPLORE_CACHE_HDR_PLAYLISTS] + 1) * sizeof(uint32_t));
+      for (i = 0; i != cache.header[EXPLORE_CACHE_HDR_PLAYLISTS]; i++)
+         playlist_map[i] = EXPLORE_CACHE_NONE;
+   }
 
-            RBUF_PUSH(rdbs, newrdb);
-            rdb_num = (uintptr_t)RBUF_LEN(rdbs);
-            ex_hashmap32_setnum(&rdb_indices, rdb_hash, rdb_num);
-         }
+   RBUF_RESIZE(explore->playlists, RBUF_LEN(sources));
+   for (i = 0; i != RBUF_LEN(sources); i++)
+   {
+      explore_source_t *src = &sources[i];
 
-         if (rdb_num == (uintptr_t)-1)
-            continue;
+      explore->playlists[i] = NULL;
+      src->dep_first        = (uint32_t)RBUF_LEN(deps);
+      RBUF_PUSH(explore->playlist_names, src->name);
 
-         rdb = &rdbs[rdb_num - 1];
-         rdb->count++;
-         entry_crc32 = (uint32_t)strtoul(
-               (entry->crc32 ? entry->crc32 : ""), NULL, 16);
-         if (entry_crc32)
-         {
-            ex_hashmap32_setptr(&rdb->playlist_crcs,
-                  entry_crc32, (void*)entry);
-         }
-         else
+      if (src->cached != EXPLORE_CACHE_NONE)
+      {
+         uint32_t k;
+         const uint32_t *rec = cache.playlists
+            + src->cached * EXPLORE_CACHE_PLAYLIST_WORDS;
+         const uint32_t *dep = cache.deps
+            + rec[EXPLORE_CACHE_SOURCE_DEP_FIRST];
+
+         /* Keep the RDBs of cached playlists known, but
+          * they don't need to be read */
+         for (k = 0; k != rec[EXPLORE_CACHE_SOURCE_DEP_COUNT]; k++)
          {
-            ex_hashmap32_strsetptr(&rdb->playlist_names,
-                  entry->label, (void*)entry);
+            const char *name = cache.text + cache.rdbs[dep[k]
+               * EXPLORE_CACHE_RDB_WORDS + EXPLORE_CACHE_SOURCE_NAME];
+            uintptr_t rdb_num = explore_add_rdb(&rdbs, &rdb_indices,
+                  directory_database, name, strlen(name));
+            explore_add_dep(&deps, src->dep_first, (uint32_t)(rdb_num - 1));
          }
-         used_entries++;
-      }
 
-      if (used_entries)
-         RBUF_PUSH(explore->playlists, playlist);
+         playlist_map[src->cached] = i;
+      }
       else
-         playlist_free(playlist);
+         explore_scan_playlist(explore, src, i, &rdbs, &rdb_indices,
+               &pending, &deps, directory_playlist, directory_database);
+
+      src->dep_count        = (uint32_t)RBUF_LEN(deps) - src->dep_first;
    }
 
+   if (cache.data)
+      explore_import_cache(explore, &cache, playlist_map,
+            cat_maps, &split_buf);
+
    /* Loop through all RDBs referenced in the playlists 
     * and load meta data strings */
    for (i = 0; i != RBUF_LEN(rdbs); i++)
    {
       struct rmsgpack_dom_value item;
       struct explore_rdb* rdb  = &rdbs[i];
-      libretrodb_cursor_t *cur = libretrodb_cursor_new();
-      bool more                = 
+      libretrodb_cursor_t *cur = NULL;
+      bool more                = false;
+
+      if (!rdb->handle)
+         continue;
+
+      cur  = libretrodb_cursor_new();
+      more = 
          (
           libretrodb_cursor_open(rdb->handle, cur, NULL) == 0
           && libretrodb_cursor_read_item(cur, &item) == 0);
@@ -711,11 +1644,11 @@ static explore_state_t *explore_build_list(void)
       for (; more; more = (rmsgpack_dom_value_free(&item),
                libretrodb_cursor_read_item(cur, &item) == 0))
       {
-         unsigned k, l, cat;
+         unsigned k, l, cat, pass;
          explore_entry_t e;
          char *fields[EXPLORE_CAT_COUNT];
          char numeric_buf[EXPLORE_CAT_COUNT][16];
-         const struct playlist_entry *entry = NULL;
+         const struct explore_pending *pend = NULL;
          uint32_t crc32                     = 0;
          char *name                         = NULL;
 #ifdef EXPLORE_SHOW_ORIGINAL_TITLE
@@ -777,62 +1710,59 @@ static explore_state_t *explore_build_list(void)
             }
          }
 
-         if (crc32)
-         {
-            entry = (const struct playlist_entry *)ex_hashmap32_getptr(
-                  &rdb->playlist_crcs, crc32);
-         }
-         if (!entry && name)
+         fields[EXPLORE_BY_SYSTEM] = rdb->systemname;
+
+         /* Entries with a crc are matched by crc, the others
+          * by name. Each entry is only matched once */
+         for (pass = 0; pass < 2; pass++)
          {
-            entry = (const struct playlist_entry *)ex_hashmap32_strgetptr(
-                  &rdb->playlist_names, name);
-         }
-         if (!entry)
-            continue;
+            uintptr_t pending_num = 0;
 
-         e.playlist_entry  = entry;
-         for (l = 0; l < EXPLORE_CAT_COUNT; l++)
-            e.by[l]        = NULL;
-         e.split           = NULL;
+            if (pass == 0 && crc32)
+            {
+               if ((pending_num = ex_hashmap32_getnum(
+                           &rdb->playlist_crcs, crc32)))
+                  ex_hashmap32_setnum(&rdb->playlist_crcs, crc32, 0);
+            }
+            else if (pass == 1 && name)
+            {
+               if ((pending_num = ex_hashmap32_strgetnum(
+                           &rdb->playlist_names, name)))
+                  ex_hashmap32_strsetnum(&rdb->playlist_names, name, 0);
+            }
+
+            for (; pending_num; pending_num = pend->next, rdb->count--)
+            {
+               pend              = &pending[pending_num - 1];
+               e.label           = pend->entry->label;
+               e.playlist        = pend->playlist;
+               e.playlist_index  = pend->playlist_index;
+               for (l = 0; l < EXPLORE_CAT_COUNT; l++)
+                  e.by[l]        = NULL;
+               e.split           = NULL;
 #ifdef EXPLORE_SHOW_ORIGINAL_TITLE
-         e.original_title  = NULL;
+               e.original_title  = NULL;
 #endif
 
-         fields[EXPLORE_BY_SYSTEM] = rdb->systemname;
-
-         for (cat = 0; cat != EXPLORE_CAT_COUNT; cat++)
-         {
-            explore_add_unique_string(explore,
-                  cat_maps, &e, cat,
-                  fields[cat], &split_buf);
-         }
+               for (cat = 0; cat != EXPLORE_CAT_COUNT; cat++)
+               {
+                  explore_add_unique_string(explore,
+                        cat_maps, &e, cat,
+                        fields[cat], &split_buf);
+               }
 
 #ifdef EXPLORE_SHOW_ORIGINAL_TITLE
-         if (original_title && *original_title)
-         {
-            size_t len       = strlen(original_title) + 1;
-            e.original_title = (char*)
-               ex_arena_alloc(&explore->arena, len);
-            memcpy(e.original_title, original_title, len);
-         }
+               if (original_title && *original_title)
+                  e.original_title = explore_strdup(explore, original_title);
 #endif
 
-         if (RBUF_LEN(split_buf))
-         {
-            size_t len;
-
-            RBUF_PUSH(split_buf, NULL); /* terminator */
-            len        = RBUF_SIZEOF(split_buf);
-            e.split    = (explore_string_t **)
-               ex_arena_alloc(&explore->arena, len);
-            memcpy(e.split, split_buf, len);
-            RBUF_CLEAR(split_buf);
+               explore_add_split(explore, &e, &split_buf);
+               RBUF_PUSH(explore->entries, e);
+            }
          }
 
-         RBUF_PUSH(explore->entries, e);
-
          /* if all entries have found connections, we can leave early */
-         if (--rdb->count == 0)
+         if (rdb->count == 0)
          {
             rmsgpack_dom_value_free(&item);
             break;
@@ -843,12 +1773,8 @@ static explore_state_t *explore_build_list(void)
       libretrodb_cursor_free(cur);
       libretrodb_close(rdb->handle);
       libretrodb_free(rdb->handle);
-      ex_hashmap32_free(&rdb->playlist_crcs);
-      ex_hashmap32_free(&rdb->playlist_names);
+      rdb->handle = NULL;
    }
-   RBUF_FREE(split_buf);
-   ex_hashmap32_free(&rdb_indices);
-   RBUF_FREE(rdbs);
 
    for (i = 0; i != EXPLORE_CAT_COUNT; i++)
    {
@@ -861,15 +1787,89 @@ static explore_state_t *explore_build_list(void)
 
       for (idx = 0; idx != len; idx++)
          explore->by[i][idx]->idx = idx;
-
-      ex_hashmap32_free(&cat_maps[i]);
    }
    qsort(explore->entries,
          RBUF_LEN(explore->entries),
          sizeof(*explore->entries), explore_qsort_func_entries);
+
+   if (*cache_path)
+      explore_cache_write(explore, cache_path,
+            directory_playlist, directory_database,
+            sources, rdbs, deps);
+
+end:
+   for (i = 0; i != RBUF_LEN(explore->entries); i++)
+   {
+      unsigned cat;
+      for (cat = 0; cat != EXPLORE_CAT_COUNT; cat++)
+         if (!explore->entries[i].by[cat])
+            explore->has_unknown[cat] = true;
+   }
+
+   for (i = 0; i != RBUF_LEN(rdbs); i++)
+   {
+      ex_hashmap32_free(&rdbs[i].playlist_crcs);
+      ex_hashmap32_free(&rdbs[i].playlist_names);
+   }
+   for (i = 0; i != EXPLORE_CAT_COUNT; i++)
+      ex_hashmap32_free(&cat_maps[i]);
+   RBUF_FREE(split_buf);
+   RBUF_FREE(rdbs);
+   RBUF_FREE(pending);
+   RBUF_FREE(sources);
+   RBUF_FREE(deps);
+   ex_hashmap32_free(&rdb_indices);
+   ex_hashmap32_free(&cached_playlists);
+   free(playlist_map);
+   free(rdb_valid);
+   explore_cache_free(&cache);
    return explore;
 }
 
+/* Returns the playlist of entry 'e' and the index of the
+ * entry in it. Playlists are loaded the first time one
+ * of their entries is opened */
+static playlist_t *explore_get_playlist(explore_state_t *state,
+      const explore_entry_t *e, size_t *idx)
+{
+   size_t i;
+   const struct playlist_entry *entry = NULL;
+   playlist_t *pl                     = state->playlists[e->playlist];
+
+   if (!pl)
+   {
+      settings_t *settings = config_get_ptr();
+
+      if (!(pl = explore_open_playlist(settings->paths.directory_playlist,
+                  state->playlist_names[e->playlist])))
+         return NULL;
+      state->playlists[e->playlist] = pl;
+   }
+
+   if (e->playlist_index < playlist_size(pl))
+   {
+      playlist_get_index(pl, e->playlist_index, &entry);
+      if (entry->label && string_is_equal(entry->label, e->label))
+      {
+         *idx = e->playlist_index;
+         return pl;
+      }
+   }
+
+   /* The playlist was changed since the list was built */
+   for (i = 0; i < playlist_size(pl); i++)
+   {
+      playlist_get_index(pl, i, &entry);
+      if (entry->label && string_is_equal(entry->label, e->label))
+      {
+         *idx = i;
+         return pl;
+      }
+   }
+
+   return NULL;
+}
+
 static int explore_action_get_title(
       const char *path, const char *label,
       unsigned menu_type, char *s, size_t len)
@@ -1223,7 +2223,7 @@ SKIP_EXPLORE_BY_CATEGORY:;
          }
 
          if (use_find && 
-               !strcasestr(e->playlist_entry->label,
+               !strcasestr(e->label,
                   explore_state->find_string))
             goto SKIP_ENTRY;
 
@@ -1250,7 +2250,7 @@ SKIP_EXPLORE_BY_CATEGORY:;
 #endif
          else
             explore_menu_entry(list,
-                  explore_state, e->playlist_entry->label,
+                  explore_state, e->label,
                   EXPLORE_TYPE_FIRSTITEM + (e - explore_state->entries));
 
 SKIP_ENTRY:;
@@ -1275,38 +2275,33 @@ SKIP_ENTRY:;
    else
    {
       /* Content page of selected game */
-      int pl_idx;
-      const struct playlist_entry *pl_entry = 
-         explore_state->entries[current_type - EXPLORE_TYPE_FIRSTITEM].playlist_entry;
+      size_t pl_idx                         = 0;
+      const explore_entry_t *e              = 
+         &explore_state->entries[current_type - EXPLORE_TYPE_FIRSTITEM];
+      playlist_t *pl                        = 
+         explore_get_playlist(explore_state, e, &pl_idx);
       menu_handle_t                   *menu = menu_driver_get_ptr();
 
       strlcpy(explore_state->title,
-            pl_entry->label, sizeof(explore_state->title));
+            e->label, sizeof(explore_state->title));
 
-      for (pl_idx = 0; pl_idx != RBUF_LEN(explore_state->playlists); pl_idx++)
+      if (pl)
       {
          menu_displaylist_info_t          info;
-         const struct playlist_entry* pl_first = NULL;
-         playlist_t                       *pl  = 
-            explore_state->playlists[pl_idx];
+         const struct playlist_entry *pl_entry = NULL;
 
          menu_displaylist_info_init(&info);
 
-         playlist_get_index(pl, 0, &pl_first);
-
-         if (  pl_entry <  pl_first || 
-               pl_entry >= pl_first + playlist_size(pl))
-            continue;
+         playlist_get_index(pl, pl_idx, &pl_entry);
 
          /* Fake all the state so the content screen 
           * and information screen think we're viewing via playlist */
          playlist_set_cached_external(pl);
-         menu->rpl_entry_selection_ptr = (pl_entry - pl_first);
+         menu->rpl_entry_selection_ptr = (unsigned)pl_idx;
          strlcpy(menu->deferred_path,
                pl_entry->path, sizeof(menu->deferred_path));
          info.list                     = list;
          menu_displaylist_ctl(DISPLAYLIST_HORIZONTAL_CONTENT_ACTIONS, &info);
-         break;
       }
    }
 
@@ -64,6 +64,8 @@ bool netplay_init_socket_buffer(
       return false;
    sbuf->bufsz = size;
    sbuf->start = sbuf->read = sbuf->end = 0;
+   sbuf->inbox = NULL;
+   sbuf->relay = NULL;
    return true;
 }
 
@@ -138,6 +140,11 @@ bool netplay_send(
       int sockfd, const void *buf,
       size_t len)
 {
+#ifdef HAVE_THREADS
+   if (sbuf->relay)
+      return netplay_relay_send(sbuf->relay, buf, len);
+#endif
+
    if (buf_remaining(sbuf) < len)
    {
       /* Need to force a blocking send */
@@ -188,6 +195,11 @@ bool netplay_send_flush(struct socket_buffer *sbuf, int sockfd, bool block)
 {
    ssize_t sent;
 
+#ifdef HAVE_THREADS
+   if (sbuf->relay)
+      return netplay_relay_flush(sbuf->relay, block);
+#endif
+
    if (buf_used(sbuf) == 0)
       return true;
 
@@ -255,6 +267,16 @@ bool netplay_send_flush(struct socket_buffer *sbuf, int sockfd, bool block)
    return true;
 }
 
+static ssize_t recv_nonblocking(struct socket_buffer *sbuf, int sockfd,
+   bool *error, void *buf, size_t len)
+{
+#ifdef HAVE_NETPLAY_IO_THREAD
+   if (sbuf->inbox)
+      return netplay_inbox_read(sbuf->inbox, error, buf, len);
+#endif
+   return socket_receive_all_nonblocking(sockfd, error, buf, len);
+}
+
 /**
  * netplay_recv
  *
@@ -271,7 +293,7 @@ ssize_t netplay_recv(struct socket_buffer *sbuf, int sockfd, void *buf,
    /* Receive whatever we can into the buffer */
    if (sbuf->end >= sbuf->start)
    {
-      recvd = socket_receive_all_nonblocking(sockfd, &error,
+      recvd = recv_nonblocking(sbuf, sockfd, &error,
          sbuf->data + sbuf->end, sbuf->bufsz - sbuf->end -
          ((sbuf->start == 0) ? 1 : 0));
 
@@ -284,7 +306,7 @@ ssize_t netplay_recv(struct socket_buffer *sbuf, int sockfd, void *buf,
       {
          sbuf->end = 0;
          error     = false;
-         recvd     = socket_receive_all_nonblocking(
+         recvd     = recv_nonblocking(sbuf,
                sockfd, &error, sbuf->data, sbuf->start - 1);
 
          if (recvd < 0 || error)
@@ -295,7 +317,7 @@ ssize_t netplay_recv(struct socket_buffer *sbuf, int sockfd, void *buf,
    }
    else
    {
-      recvd = socket_receive_all_nonblocking(
+      recvd = recv_nonblocking(sbuf,
             sockfd, &error, sbuf->data + sbuf->end,
             sbuf->start - sbuf->end - 1);
 
@@ -343,7 +365,25 @@ ssize_t netplay_recv(struct socket_buffer *sbuf, int sockfd, void *buf,
    if (block)
    {
       sbuf->start = sbuf->read;
-      if (recvd < 0 || recvd < (ssize_t) len)
+      if (recvd < 0)
+         return -1;
+#ifdef HAVE_NETPLAY_IO_THREAD
+      /* The socket belongs to the I/O thread, so wait on it instead */
+      while (sbuf->inbox && recvd < (ssize_t) len)
+      {
+         bool error    = false;
+         struct netplay_io_thread *io = netplay_inbox_thread(sbuf->inbox);
+         uint32_t events              = netplay_io_thread_events(io);
+         ssize_t more  = netplay_inbox_read(sbuf->inbox, &error,
+               (unsigned char *)buf + recvd, len - recvd);
+         if (more < 0 || error)
+            return -1;
+         if (more == 0)
+            netplay_io_thread_wait(io, events, RETRY_MS);
+         recvd += more;
+      }
+#endif
+      if (recvd < (ssize_t) len)
       {
          if (!socket_receive_all_blocking(
                   sockfd, (unsigned char *)buf + recvd, len - recvd))
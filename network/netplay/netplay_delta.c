@@ -16,6 +16,7 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <sys/types.h>
 
 #include <boolean.h>
@@ -71,6 +72,138 @@ bool netplay_delta_frame_ready(netplay_t *netplay, struct delta_frame *delta,
    return true;
 }
 
+/* Applies a 32x32 GF(2) matrix to a vector */
+static uint32_t crc_gf2_times(const uint32_t *mat, uint32_t vec)
+{
+   uint32_t sum = 0;
+   while (vec)
+   {
+      if (vec & 1)
+         sum ^= *mat;
+      vec >>= 1;
+      mat++;
+   }
+   return sum;
+}
+
+/* out = a * b */
+static void crc_gf2_multiply(uint32_t *out,
+      const uint32_t *a, const uint32_t *b)
+{
+   unsigned n;
+   uint32_t tmp[32];
+   for (n = 0; n < 32; n++)
+      tmp[n] = crc_gf2_times(a, b[n]);
+   memcpy(out, tmp, sizeof(tmp));
+}
+
+/* Builds the operator which advances a CRC-32 over len zero bytes, such
+ * that crc(A+B) == op(crc(A)) ^ crc(B) when B is len bytes long. */
+static void crc_shift_operator(uint32_t *op, size_t len)
+{
+   unsigned n;
+   uint32_t step[32];
+
+   /* One zero bit... */
+   step[0] = 0xedb88320UL;
+   for (n = 1; n < 32; n++)
+      step[n] = 1UL << (n - 1);
+
+   /* ...squared three times is one zero byte */
+   crc_gf2_multiply(step, step, step);
+   crc_gf2_multiply(step, step, step);
+   crc_gf2_multiply(step, step, step);
+
+   for (n = 0; n < 32; n++)
+      op[n] = 1UL << n;
+
+   while (len)
+   {
+      if (len & 1)
+         crc_gf2_multiply(op, step, op);
+      len >>= 1;
+      if (len)
+         crc_gf2_multiply(step, step, step);
+   }
+}
+
+/* Cheap hash used to spot blocks which changed since the last CRC. Four
+ * independent lanes keep the multiplies from serializing. */
+static uint64_t crc_block_hash(const uint8_t *data, size_t len)
+{
+   size_t i;
+   const uint64_t prime = 0x100000001b3ULL;
+   uint64_t h0          = 0xcbf29ce484222325ULL;
+   uint64_t h1          = h0 ^ 1;
+   uint64_t h2          = h0 ^ 2;
+   uint64_t h3          = h0 ^ 3;
+
+   for (i = 0; i + 32 <= len; i += 32)
+   {
+      uint64_t w[4];
+      memcpy(w, data + i, sizeof(w));
+      h0 = (h0 ^ w[0]) * prime;
+      h1 = (h1 ^ w[1]) * prime;
+      h2 = (h2 ^ w[2]) * prime;
+      h3 = (h3 ^ w[3]) * prime;
+   }
+   for (; i < len; i++)
+      h0 = (h0 ^ data[i]) * prime;
+
+   h0 = (h0 ^ h1) * prime;
+   h0 = (h0 ^ h2) * prime;
+   return (h0 ^ h3) * prime;
+}
+
+/**
+ * netplay_delta_crc_init
+ *
+ * Set up the block CRC cache used by netplay_delta_frame_crc. Without it,
+ * CRCs are computed over the whole state every time.
+ */
+void netplay_delta_crc_init(netplay_t *netplay)
+{
+   size_t i, blocks, tail;
+   uint8_t *zero;
+
+   netplay->crc_blocks = 0;
+   blocks = (netplay->state_size + NETPLAY_CRC_BLOCK_SIZE - 1)
+      / NETPLAY_CRC_BLOCK_SIZE;
+   if (blocks < 2)
+      return;
+
+   tail = netplay->state_size - (blocks - 1) * NETPLAY_CRC_BLOCK_SIZE;
+
+   netplay->crc_block_hash = (uint64_t*)malloc(blocks * sizeof(uint64_t));
+   netplay->crc_block_crc  = (uint32_t*)malloc(blocks * sizeof(uint32_t));
+   zero                    = (uint8_t*)calloc(NETPLAY_CRC_BLOCK_SIZE, 1);
+
+   if (!netplay->crc_block_hash || !netplay->crc_block_crc || !zero)
+   {
+      free(netplay->crc_block_hash);
+      free(netplay->crc_block_crc);
+      free(zero);
+      netplay->crc_block_hash = NULL;
+      netplay->crc_block_crc  = NULL;
+      return;
+   }
+
+   crc_shift_operator(netplay->crc_shift_block, NETPLAY_CRC_BLOCK_SIZE);
+   crc_shift_operator(netplay->crc_shift_tail, tail);
+
+   /* States start out zeroed, so seed the cache with that */
+   for (i = 0; i < blocks; i++)
+   {
+      size_t len                 = (i == blocks - 1)
+         ? tail : NETPLAY_CRC_BLOCK_SIZE;
+      netplay->crc_block_hash[i] = crc_block_hash(zero, len);
+      netplay->crc_block_crc[i]  = encoding_crc32(0L, zero, len);
+   }
+
+   free(zero);
+   netplay->crc_blocks = blocks;
+}
+
 /**
  * netplay_delta_frame_crc
  *
@@ -79,10 +212,146 @@ bool netplay_delta_frame_ready(netplay_t *netplay, struct delta_frame *delta,
 uint32_t netplay_delta_frame_crc(netplay_t *netplay,
       struct delta_frame *delta)
 {
+   size_t i;
+   uint32_t crc         = 0;
+   const uint8_t *state = (const uint8_t*)delta->state;
+
    if (!netplay->state_size)
       return 0;
-   return encoding_crc32(0L, (const unsigned char*)delta->state,
-         netplay->state_size);
+   if (!netplay->crc_blocks)
+      return encoding_crc32(0L, state, netplay->state_size);
+
+   for (i = 0; i < netplay->crc_blocks; i++)
+   {
+      size_t offset   = i * NETPLAY_CRC_BLOCK_SIZE;
+      bool last       = (i == netplay->crc_blocks - 1);
+      size_t len      = last
+         ? netplay->state_size - offset : NETPLAY_CRC_BLOCK_SIZE;
+      uint64_t hash   = crc_block_hash(state + offset, len);
+
+      /* Only blocks which changed since the last CRC need a new one */
+      if (hash != netplay->crc_block_hash[i])
+      {
+         netplay->crc_block_hash[i] = hash;
+         netplay->crc_block_crc[i]  = encoding_crc32(0L,
+               state + offset, len);
+      }
+
+      if (i)
+         crc = crc_gf2_times(last
+               ? netplay->crc_shift_tail : netplay->crc_shift_block, crc);
+      crc ^= netplay->crc_block_crc[i];
+   }
+
+   return crc;
+}
+
+/* Unchanged stretches shorter than this are sent as part of the surrounding
+ * changed run, so that every run header is paid for by the bytes it skips */
+#define NETPLAY_DELTA_MIN_SKIP 8
+
+static void delta_put_u32(uint8_t *out, uint32_t val)
+{
+   out[0] = (uint8_t)(val >> 24);
+   out[1] = (uint8_t)(val >> 16);
+   out[2] = (uint8_t)(val >>  8);
+   out[3] = (uint8_t)(val);
+}
+
+static uint32_t delta_get_u32(const uint8_t *in)
+{
+   return ((uint32_t)in[0] << 24) | ((uint32_t)in[1] << 16) |
+          ((uint32_t)in[2] <<  8) |  (uint32_t)in[3];
+}
+
+/**
+ * netplay_delta_encode
+ *
+ * Encode the differences between two savestates of the same size as a
+ * sequence of (skip, count, data) runs. out must hold at least
+ * size + NETPLAY_DELTA_OVERHEAD bytes.
+ *
+ * Returns: The size of the encoded delta.
+ */
+size_t netplay_delta_encode(const uint8_t *base, const uint8_t *state,
+      size_t size, uint8_t *out)
+{
+   size_t pos     = 0;
+   size_t last    = 0;
+   size_t out_pos = 0;
+
+   while (pos < size)
+   {
+      size_t start, end;
+      size_t equal = 0;
+
+      /* Skip what is unchanged, a cache line at a time while we can */
+      while (size - pos >= 64 && !memcmp(base + pos, state + pos, 64))
+         pos += 64;
+      while (pos < size && base[pos] == state[pos])
+         pos++;
+      if (pos == size)
+         break;
+
+      /* Then find where the changes stop */
+      start = pos;
+      for (; pos < size; pos++)
+      {
+         if (base[pos] != state[pos])
+            equal = 0;
+         else if (++equal == NETPLAY_DELTA_MIN_SKIP)
+         {
+            pos++;
+            break;
+         }
+      }
+      end = pos - equal;
+
+      delta_put_u32(out + out_pos, (uint32_t)(start - last));
+      delta_put_u32(out + out_pos + sizeof(uint32_t), (uint32_t)(end - start));
+      out_pos += 2*sizeof(uint32_t);
+      memcpy(out + out_pos, state + start, end - start);
+      out_pos += end - start;
+      last     = end;
+   }
+
+   return out_pos;
+}
+
+/**
+ * netplay_delta_apply
+ *
+ * Apply a delta made by netplay_delta_encode to a copy of its base state.
+ *
+ * Returns: False if the delta is malformed or does not fit the state.
+ */
+bool netplay_delta_apply(uint8_t *state, size_t size,
+      const uint8_t *delta, size_t delta_size)
+{
+   size_t pos    = 0;
+   size_t in_pos = 0;
+
+   while (in_pos < delta_size)
+   {
+      uint32_t skip, count;
+
+      if (delta_size - in_pos < 2*sizeof(uint32_t))
+         return false;
+      skip    = delta_get_u32(delta + in_pos);
+      count   = delta_get_u32(delta + in_pos + sizeof(uint32_t));
+      in_pos += 2*sizeof(uint32_t);
+
+      if (skip > size - pos || count > size - pos - skip ||
+          count > delta_size - in_pos)
+         return false;
+
+      pos += skip;
+      memcpy(state + pos, delta + in_pos, count);
+      pos    += count;
+      in_pos += count;
+   }
+
+   return true;
 }
 
 /*
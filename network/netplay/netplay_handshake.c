@@ -238,7 +238,8 @@ bool netplay_handshake_init_send(netplay_t *netplay,
 
    header[0] = htonl(NETPLAY_MAGIC);
    header[1] = htonl(netplay_platform_magic());
-   header[2] = htonl(NETPLAY_COMPRESSION_SUPPORTED);
+   header[2] = htonl(NETPLAY_COMPRESSION_SUPPORTED |
+         (netplay->udp_fd >= 0 ? NETPLAY_FEATURE_UDP_INPUT : 0));
    header[3] = 0;
    header[4] = htonl(NETPLAY_PROTOCOL_VERSION);
    header[5] = htonl(netplay_impl_magic());
@@ -370,6 +371,8 @@ bool netplay_handshake_init(netplay_t *netplay,
 
    /* Check what compression is supported */
    compression  = ntohl(header[2]);
+   connection->udp_supported = netplay->udp_fd >= 0 &&
+      (compression & NETPLAY_FEATURE_UDP_INPUT);
    compression &= NETPLAY_COMPRESSION_SUPPORTED;
 
    if (compression & NETPLAY_COMPRESSION_ZLIB)
@@ -395,6 +398,11 @@ bool netplay_handshake_init(netplay_t *netplay,
       connection->compression_supported = 0;
    }
 
+   /* Deltas work on top of either transcoder */
+   connection->savestate_delta      =
+      !!(compression & NETPLAY_COMPRESSION_DELTA);
+   connection->savestate_base_valid = false;
+
    if (!ctrans->decompression_backend)
       ctrans->decompression_backend = ctrans->compression_backend->reverse;
 
@@ -489,6 +497,18 @@ static void netplay_handshake_ready(netplay_t *netplay,
    /* Unstall if we were waiting for this */
    if (netplay->stall == NETPLAY_STALL_NO_CONNECTION)
        netplay->stall = NETPLAY_STALL_NONE;
+
+   /* Offer them our UDP input channel */
+   if (connection->udp_supported)
+   {
+      if (simple_rand_next == 1)
+         simple_srand((unsigned int) time(NULL));
+      do
+      {
+         connection->udp_token_in = simple_rand_uint32();
+      } while (!connection->udp_token_in);
+      netplay_cmd_udp_input(netplay, connection);
+   }
 }
 
 /**
@@ -680,6 +700,7 @@ static bool netplay_handshake_sync(netplay_t *netplay,
    /* Now we're ready! */
    connection->mode = NETPLAY_CONNECTION_SPECTATING;
    netplay_handshake_ready(netplay, connection);
+   netplay_relay_spectator(netplay, connection);
 
    return true;
 }
@@ -872,7 +893,7 @@ static bool netplay_handshake_pre_info(netplay_t *netplay,
       return true;
    }
 
-   RECV(&info_buf.core_name, cmd_size)
+   RECV(&info_buf.content_crc, cmd_size)
    {
       RARCH_ERR("Failed to receive netplay info payload.\n");
       return false;
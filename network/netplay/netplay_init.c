@@ -218,6 +218,69 @@ static bool init_tcp_socket(netplay_t *netplay, void *direct_host,
    return ret;
 }
 
+/* Open the UDP socket input is repeated over, on the TCP socket's address
+ * family and, when serving, its port. Input still goes over TCP too, so it's
+ * no loss if this fails. */
+static void init_udp_socket(netplay_t *netplay)
+{
+#ifndef HAVE_SOCKET_LEGACY
+   struct sockaddr_storage addr;
+   socklen_t addr_size = sizeof(addr);
+   int tcp_fd          = netplay->is_server ?
+      netplay->listen_fd : netplay->connections[0].fd;
+   const char *value   = NULL;
+   int fd;
+
+   memset(&addr, 0, sizeof(addr));
+   if (tcp_fd < 0 ||
+       getsockname(tcp_fd, (struct sockaddr*)&addr, &addr_size) < 0)
+      return;
+
+   /* Clients take any address and port */
+   if (!netplay->is_server)
+   {
+      unsigned short family = addr.ss_family;
+      memset(&addr, 0, sizeof(addr));
+      addr.ss_family = family;
+   }
+
+   fd = socket(addr.ss_family, SOCK_DGRAM, 0);
+   if (fd < 0)
+      return;
+
+#if defined(HAVE_INET6) && defined(IPPROTO_IPV6) && defined(IPV6_V6ONLY)
+   if (addr.ss_family == AF_INET6)
+   {
+      int on = 0;
+      setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, (const char*)&on, sizeof(on));
+   }
+#endif
+
+   if (bind(fd, (struct sockaddr*)&addr, addr_size) < 0 ||
+       !socket_nonblock(fd))
+   {
+      RARCH_WARN("[netplay] Could not open a UDP socket, input will go over TCP only.\n");
+      socket_close(fd);
+      return;
+   }
+
+   netplay->udp_fd = fd;
+
+   /* Simulated bad link, for testing */
+   if ((value = getenv("NETPLAY_UDP_LOSS")))
+      netplay->udp_loss   = (unsigned)atoi(value);
+   if ((value = getenv("NETPLAY_UDP_JITTER")))
+      netplay->udp_jitter = (retro_time_t)atoi(value) * 1000;
+   if (netplay->udp_jitter > 0)
+      netplay->udp_delayed = (struct netplay_udp_delayed*)calloc(
+            NETPLAY_UDP_DELAYED_MAX, sizeof(*netplay->udp_delayed));
+   if (netplay->udp_loss || netplay->udp_delayed)
+      RARCH_WARN("[netplay] Simulating %u%% loss and up to %u ms of jitter on UDP input.\n",
+            netplay->udp_loss,
+            netplay->udp_delayed ? (unsigned)(netplay->udp_jitter / 1000) : 0);
+#endif
+}
+
 static bool init_socket(netplay_t *netplay, void *direct_host,
       const char *server, uint16_t port)
 {
@@ -227,6 +290,8 @@ static bool init_socket(netplay_t *netplay, void *direct_host,
    if (!init_tcp_socket(netplay, direct_host, server, port))
       return false;
 
+   init_udp_socket(netplay);
+
    if (netplay->is_server && netplay->nat_traversal)
       netplay_init_nat_traversal(netplay);
 
@@ -304,6 +369,8 @@ static bool netplay_init_serialization(netplay_t *netplay)
       return false;
    }
 
+   netplay_delta_crc_init(netplay);
+
    return true;
 }
 
@@ -332,6 +399,19 @@ bool netplay_try_init_serialization(netplay_t *netplay)
    if (!core_serialize(&serial_info))
       return false;
 
+   /* Serialize again over a buffer full of junk. If the core produces the
+    * same bytes both times, it writes the whole buffer and we can skip
+    * clearing it before every serialization. */
+   if (!(netplay->quirks & NETPLAY_QUIRK_VARIABLE_SIZE) && netplay->zbuffer)
+   {
+      memset(netplay->zbuffer, 0xFF, netplay->state_size);
+      serial_info.data = netplay->zbuffer;
+
+      if (core_serialize(&serial_info))
+         netplay->state_overwritten = !memcmp(netplay->zbuffer,
+               netplay->buffer[netplay->run_ptr].state, netplay->state_size);
+   }
+
    /* Once initialized, we no longer exhibit this quirk */
    netplay->quirks &= ~((uint64_t) NETPLAY_QUIRK_INITIALIZATION);
 
@@ -425,6 +505,7 @@ netplay_t *netplay_new(void *direct_host, const char *server, uint16_t port,
       return NULL;
 
    netplay->listen_fd            = -1;
+   netplay->udp_fd               = -1;
    netplay->tcp_port             = port;
    netplay->cbs                  = *cb;
    netplay->is_server            = (direct_host == NULL && server == NULL);
@@ -506,12 +587,29 @@ netplay_t *netplay_new(void *direct_host, const char *server, uint16_t port,
          goto error;
    }
 
+#ifdef HAVE_NETPLAY_IO_THREAD
+   netplay->io_thread = netplay_io_thread_new(netplay->listen_fd,
+         netplay->udp_fd);
+   if (!netplay->is_server)
+      netplay->connections[0].recv_packet_buffer.inbox =
+         netplay_io_thread_attach(netplay->io_thread,
+               netplay->connections[0].fd);
+#endif
+#ifdef HAVE_THREADS
+   if (netplay->is_server)
+      netplay->relay = netplay_relay_new();
+#endif
+
    return netplay;
 
 error:
    if (netplay->listen_fd >= 0)
       socket_close(netplay->listen_fd);
 
+   if (netplay->udp_fd >= 0)
+      socket_close(netplay->udp_fd);
+   free(netplay->udp_delayed);
+
    if (netplay->connections && netplay->connections[0].fd >= 0)
       socket_close(netplay->connections[0].fd);
 
@@ -529,9 +627,21 @@ void netplay_free(netplay_t *netplay)
 {
    size_t i;
 
+#ifdef HAVE_NETPLAY_IO_THREAD
+   /* Stop reading before the sockets go away */
+   netplay_io_thread_free(netplay->io_thread);
+#endif
+#ifdef HAVE_THREADS
+   netplay_relay_free(netplay->relay);
+#endif
+
    if (netplay->listen_fd >= 0)
       socket_close(netplay->listen_fd);
 
+   if (netplay->udp_fd >= 0)
+      socket_close(netplay->udp_fd);
+   free(netplay->udp_delayed);
+
    for (i = 0; i < netplay->connections_size; i++)
    {
       struct netplay_connection *connection = &netplay->connections[i];
@@ -541,6 +651,7 @@ void netplay_free(netplay_t *netplay)
          netplay_deinit_socket_buffer(&connection->send_packet_buffer);
          netplay_deinit_socket_buffer(&connection->recv_packet_buffer);
       }
+      free(connection->savestate_recv);
    }
 
    if (netplay->connections && netplay->connections != &netplay->one_connection)
@@ -560,6 +671,12 @@ void netplay_free(netplay_t *netplay)
    if (netplay->zbuffer)
       free(netplay->zbuffer);
 
+   free(netplay->savestate_sent);
+   free(netplay->delta_buffer);
+
+   free(netplay->crc_block_hash);
+   free(netplay->crc_block_crc);
+
    if (netplay->compress_nil.compression_stream)
    {
       netplay->compress_nil.compression_backend->stream_free(netplay->compress_nil.compression_stream);
@@ -138,11 +138,35 @@ void netplay_hangup(netplay_t *netplay,
    RARCH_LOG("[netplay] %s\n", dmsg);
    runloop_msg_queue_push(dmsg, 1, 180, false, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
 
-   socket_close(connection->fd);
+#ifdef HAVE_THREADS
+   /* The relay's done with the socket before it's closed */
+   netplay_relay_detach(&connection->send_packet_buffer, connection->fd,
+         false);
+#endif
+#ifdef HAVE_NETPLAY_IO_THREAD
+   if (connection->recv_packet_buffer.inbox)
+   {
+      netplay_io_thread_detach(netplay->io_thread,
+            connection->recv_packet_buffer.inbox);
+      connection->recv_packet_buffer.inbox = NULL;
+   }
+   else
+#endif
+      socket_close(connection->fd);
    connection->active = false;
    netplay_deinit_socket_buffer(&connection->send_packet_buffer);
    netplay_deinit_socket_buffer(&connection->recv_packet_buffer);
 
+   free(connection->savestate_recv);
+   connection->savestate_recv       = NULL;
+   connection->savestate_base_valid = false;
+
+   if (connection->udp_active)
+      RARCH_LOG("[netplay] %u frames of input arrived over UDP ahead of TCP.\n",
+            (unsigned)connection->udp_frames);
+   connection->udp_active   = false;
+   connection->udp_token_in = 0;
+
    if (!netplay->is_server)
    {
       netplay->self_mode = NETPLAY_CONNECTION_NONE;
@@ -187,6 +211,21 @@ void netplay_hangup(netplay_t *netplay,
       remote_unpaused(netplay, connection);
 }
 
+/**
+ * netplay_relay_spectator
+ *
+ * Hands a spectator's output over to the relay, if we have one.
+ */
+void netplay_relay_spectator(netplay_t *netplay,
+      struct netplay_connection *connection)
+{
+#ifdef HAVE_THREADS
+   if (netplay->relay && connection->mode == NETPLAY_CONNECTION_SPECTATING)
+      netplay_relay_attach(netplay->relay, &connection->send_packet_buffer,
+            connection->fd, connection->compression_supported);
+#endif
+}
+
 /**
  * netplay_delayed_state_change:
  *
@@ -228,22 +267,14 @@ void netplay_delayed_state_change(netplay_t *netplay)
    }
 }
 
-/* Send the specified input data */
-static bool send_input_frame(netplay_t *netplay, struct delta_frame *dframe,
-      struct netplay_connection *only, struct netplay_connection *except,
-      uint32_t client_num, bool slave)
+/* Gather a client's input for a frame into buffer, in network byte order.
+ * Returns the number of words used. */
+static size_t pack_input_frame(netplay_t *netplay, struct delta_frame *dframe,
+      uint32_t client_num, bool slave, uint32_t *buffer)
 {
-#define BUFSZ 16 /* FIXME: Arbitrary restriction */
-   uint32_t buffer[BUFSZ], devices, device;
-   size_t bufused, i;
+   uint32_t devices, device;
+   size_t bufused = 0, i;
 
-   /* Set up the basic buffer */
-   bufused = 4;
-   buffer[0] = htonl(NETPLAY_CMD_INPUT);
-   buffer[2] = htonl(dframe->frame);
-   buffer[3] = htonl(client_num);
-
-   /* Add the device data */
    devices = netplay->client_devices[client_num];
    for (device = 0; device < MAX_INPUT_DEVICES; device++)
    {
@@ -255,14 +286,47 @@ static bool send_input_frame(netplay_t *netplay, struct delta_frame *dframe,
          istate = istate->next;
       if (!istate)
          continue;
-      if (bufused + istate->size >= BUFSZ)
+      if (bufused + istate->size >= NETPLAY_MAX_INPUT_WORDS)
          continue; /* FIXME: More severe? */
       for (i = 0; i < istate->size; i++)
          buffer[bufused+i] = htonl(istate->data[i]);
       bufused += istate->size;
    }
+
+   return bufused;
+}
+
+/* Build an INPUT command for the specified input data, returning its size in
+ * words */
+static size_t build_input_frame(netplay_t *netplay, struct delta_frame *dframe,
+      uint32_t client_num, bool slave, uint32_t *buffer)
+{
+   size_t bufused;
+
+   /* Set up the basic buffer */
+   buffer[0] = htonl(NETPLAY_CMD_INPUT);
+   buffer[2] = htonl(dframe->frame);
+   buffer[3] = htonl(client_num);
+
+   /* Add the device data */
+   bufused   = 4 + pack_input_frame(netplay, dframe, client_num, slave,
+         buffer + 4);
    buffer[1] = htonl((bufused-2) * sizeof(uint32_t));
 
+   return bufused;
+}
+
+/* Send the specified input data */
+static bool send_input_frame(netplay_t *netplay, struct delta_frame *dframe,
+      struct netplay_connection *only, struct netplay_connection *except,
+      uint32_t client_num, bool slave)
+{
+   uint32_t buffer[4 + NETPLAY_MAX_INPUT_WORDS];
+   size_t bufused, i;
+   bool relayed = false;
+
+   bufused = build_input_frame(netplay, dframe, client_num, slave, buffer);
+
 #ifdef DEBUG_NETPLAY_STEPS
    RARCH_LOG("[netplay] Sending input for client %u\n", (unsigned) client_num);
    print_state(netplay);
@@ -288,15 +352,160 @@ static bool send_input_frame(netplay_t *netplay, struct delta_frame *dframe,
              (connection->mode != NETPLAY_CONNECTION_PLAYING ||
               i+1 != client_num))
          {
+            /* Spectators on the relay all get the one copy */
+            if (connection->send_packet_buffer.relay)
+            {
+               relayed = true;
+               continue;
+            }
             if (!netplay_send(&connection->send_packet_buffer, connection->fd,
                   buffer, bufused*sizeof(uint32_t)))
                netplay_hangup(netplay, connection);
          }
       }
+
+#ifdef HAVE_THREADS
+      if (relayed)
+      {
+         if (except && except->send_packet_buffer.relay &&
+             !netplay_relay_skip(except->send_packet_buffer.relay,
+                bufused*sizeof(uint32_t)))
+            netplay_hangup(netplay, except);
+         netplay_relay_append(netplay->relay, buffer,
+               bufused*sizeof(uint32_t));
+      }
+#endif
    }
 
    return true;
-#undef BUFSZ
+}
+
+static socklen_t udp_addr_size(const struct sockaddr_storage *addr)
+{
+   switch (addr->ss_family)
+   {
+      case AF_INET:
+         return sizeof(struct sockaddr_in);
+#ifdef AF_INET6
+      case AF_INET6:
+         return sizeof(struct sockaddr_in6);
+#endif
+      default:
+         break;
+   }
+   return 0;
+}
+
+#ifndef HAVE_SOCKET_LEGACY
+/* Send the datagrams held back by simulated jitter whose time has come.
+ * They only go out when there's new input to send, so the delay is
+ * rounded up to a frame. */
+static void flush_udp_delayed(netplay_t *netplay)
+{
+   size_t i, kept      = 0;
+   retro_time_t now    = cpu_features_get_time_usec();
+
+   for (i = 0; i < netplay->udp_delayed_count; i++)
+   {
+      struct netplay_udp_delayed *delayed = &netplay->udp_delayed[i];
+
+      if (delayed->when > now)
+      {
+         if (kept != i)
+            netplay->udp_delayed[kept] = *delayed;
+         kept++;
+         continue;
+      }
+
+      sendto(netplay->udp_fd, (const char*)delayed->data, delayed->size, 0,
+            (struct sockaddr*)&delayed->addr, delayed->addr_size);
+   }
+
+   netplay->udp_delayed_count = kept;
+}
+#endif
+
+/* Repeat the last few frames of our input to a peer over UDP, so that it
+ * needn't wait for TCP to recover a lost packet */
+static void send_udp_input(netplay_t *netplay,
+      struct netplay_connection *connection)
+{
+#ifndef HAVE_SOCKET_LEGACY
+   uint32_t buffer[NETPLAY_UDP_MAX_WORDS];
+   uint32_t count, words, i;
+   size_t ptr          = netplay->self_ptr;
+   uint32_t client_num = netplay->self_client_num;
+   socklen_t addr_size = udp_addr_size(&connection->udp_addr);
+
+   if (!addr_size)
+      return;
+
+   /* Find how far back we have our input. Every frame must be the same size,
+    * so stop at a change of devices. */
+   words = 0;
+   for (count = 0; count < NETPLAY_UDP_WINDOW; count++)
+   {
+      struct delta_frame *dframe = &netplay->buffer[ptr];
+      uint32_t scratch[NETPLAY_MAX_INPUT_WORDS];
+      size_t used;
+      if (!dframe->used || !dframe->have_real[client_num] ||
+          dframe->frame != netplay->self_frame_count - count)
+         break;
+      used = pack_input_frame(netplay, dframe, client_num, false, scratch);
+      if (count && used != words)
+         break;
+      words = (uint32_t)used;
+      ptr   = PREV_PTR(ptr);
+   }
+   if (!count || !words)
+      return;
+
+   /* Then pack it oldest first */
+   for (i = 0; i < count; i++)
+   {
+      ptr = NEXT_PTR(ptr);
+      pack_input_frame(netplay, &netplay->buffer[ptr], client_num, false,
+            buffer + NETPLAY_UDP_HEADER_WORDS + i*words);
+   }
+
+   buffer[0] = htonl(connection->udp_token_out);
+   buffer[1] = htonl(connection->udp_epoch_sent);
+   buffer[2] = htonl(client_num);
+   buffer[3] = htonl(netplay->self_frame_count - (count - 1));
+   buffer[4] = htonl(count);
+   buffer[5] = htonl(words);
+
+   if (netplay->udp_loss || netplay->udp_delayed)
+   {
+      flush_udp_delayed(netplay);
+
+      /* Simulate a lossy link by dropping this percentage of datagrams */
+      if ((unsigned)(rand() % 100) < netplay->udp_loss)
+         return;
+
+      /* And a jittery one by holding the rest back a random while */
+      if (netplay->udp_delayed)
+      {
+         struct netplay_udp_delayed *delayed;
+         if (netplay->udp_delayed_count >= NETPLAY_UDP_DELAYED_MAX)
+            return;
+         delayed            = &netplay->udp_delayed[netplay->udp_delayed_count++];
+         delayed->when      = cpu_features_get_time_usec() +
+            rand() % (netplay->udp_jitter + 1);
+         delayed->addr      = connection->udp_addr;
+         delayed->addr_size = addr_size;
+         delayed->size      = (NETPLAY_UDP_HEADER_WORDS + count*words) *
+            sizeof(uint32_t);
+         memcpy(delayed->data, buffer, delayed->size);
+         return;
+      }
+   }
+
+   /* Best effort, TCP has it anyway */
+   sendto(netplay->udp_fd, (const char*)buffer,
+         (NETPLAY_UDP_HEADER_WORDS + count*words) * sizeof(uint32_t), 0,
+         (struct sockaddr*)&connection->udp_addr, addr_size);
+#endif
 }
 
 /**
@@ -358,9 +567,64 @@ bool netplay_send_cur_input(netplay_t *netplay,
          false))
       return false;
 
+   /* And the last few frames of it again over UDP, if we can */
+   if (connection->udp_active &&
+         netplay->self_mode == NETPLAY_CONNECTION_PLAYING)
+      send_udp_input(netplay, connection);
+
    return true;
 }
 
+/**
+ * netplay_send_cur_input_relayed
+ *
+ * Send the current input frame to the relay, once for all of its peers. As
+ * they're all spectators, they all get the same.
+ */
+void netplay_send_cur_input_relayed(netplay_t *netplay)
+{
+#ifdef HAVE_THREADS
+   uint32_t buffer[4 + NETPLAY_MAX_INPUT_WORDS];
+   uint32_t from_client;
+   size_t bufused;
+   struct delta_frame *dframe = &netplay->buffer[netplay->self_ptr];
+
+   if (!netplay->relay)
+      return;
+
+   /* Every player's input data */
+   for (from_client = 1; from_client < MAX_CLIENTS; from_client++)
+   {
+      if ((netplay->connected_players & (1<<from_client)) &&
+            dframe->have_real[from_client])
+      {
+         bufused = build_input_frame(netplay, dframe, from_client, false,
+               buffer);
+         netplay_relay_append(netplay->relay, buffer,
+               bufused*sizeof(uint32_t));
+      }
+   }
+
+   /* If we're not playing, a NOINPUT */
+   if (netplay->self_mode != NETPLAY_CONNECTION_PLAYING)
+   {
+      buffer[0] = htonl(NETPLAY_CMD_NOINPUT);
+      buffer[1] = htonl(sizeof(uint32_t));
+      buffer[2] = htonl(netplay->self_frame_count);
+      netplay_relay_append(netplay->relay, buffer, 3*sizeof(uint32_t));
+   }
+
+   /* And our own */
+   if (netplay->self_mode == NETPLAY_CONNECTION_PLAYING
+         || netplay->self_mode == NETPLAY_CONNECTION_SLAVE)
+   {
+      bufused = build_input_frame(netplay, dframe, netplay->self_client_num,
+            netplay->self_mode == NETPLAY_CONNECTION_SLAVE, buffer);
+      netplay_relay_append(netplay->relay, buffer, bufused*sizeof(uint32_t));
+   }
+#endif
+}
+
 /**
  * netplay_send_raw_cmd
  *
@@ -377,6 +641,9 @@ bool netplay_send_raw_cmd(netplay_t *netplay,
    cmdbuf[0] = htonl(cmd);
    cmdbuf[1] = htonl(size);
 
+   if (netplay_cmd_is_udp_barrier(cmd))
+      connection->udp_epoch_sent++;
+
    if (!netplay_send(&connection->send_packet_buffer, connection->fd, cmdbuf,
          sizeof(cmdbuf)))
       return false;
@@ -388,6 +655,28 @@ bool netplay_send_raw_cmd(netplay_t *netplay,
    return true;
 }
 
+/* Send a raw command once for all relayed peers but except */
+static void relay_raw_cmd(netplay_t *netplay,
+   struct netplay_connection *except, uint32_t cmd, const void *data,
+   size_t size)
+{
+#ifdef HAVE_THREADS
+   uint32_t cmdbuf[2];
+
+   cmdbuf[0] = htonl(cmd);
+   cmdbuf[1] = htonl(size);
+
+   if (except && except->send_packet_buffer.relay &&
+       !netplay_relay_skip(except->send_packet_buffer.relay,
+          sizeof(cmdbuf) + size))
+      netplay_hangup(netplay, except);
+
+   netplay_relay_append(netplay->relay, cmdbuf, sizeof(cmdbuf));
+   if (size > 0)
+      netplay_relay_append(netplay->relay, data, size);
+#endif
+}
+
 /**
  * netplay_send_raw_cmd_all
  *
@@ -399,6 +688,7 @@ void netplay_send_raw_cmd_all(netplay_t *netplay,
    size_t size)
 {
    size_t i;
+   bool relayed = false;
    for (i = 0; i < netplay->connections_size; i++)
    {
       struct netplay_connection *connection = &netplay->connections[i];
@@ -406,10 +696,81 @@ void netplay_send_raw_cmd_all(netplay_t *netplay,
          continue;
       if (connection->active && connection->mode >= NETPLAY_CONNECTION_CONNECTED)
       {
+         if (connection->send_packet_buffer.relay)
+         {
+            if (netplay_cmd_is_udp_barrier(cmd))
+               connection->udp_epoch_sent++;
+            relayed = true;
+            continue;
+         }
          if (!netplay_send_raw_cmd(netplay, connection, cmd, data, size))
             netplay_hangup(netplay, connection);
       }
    }
+
+   if (relayed)
+      relay_raw_cmd(netplay, except, cmd, data, size);
+}
+
+/**
+ * netplay_cmd_is_udp_barrier
+ *
+ * Is this a command which UDP input sent after it must not overtake? These
+ * change which frame or which players' input comes next.
+ */
+bool netplay_cmd_is_udp_barrier(uint32_t cmd)
+{
+   switch (cmd)
+   {
+      case NETPLAY_CMD_SPECTATE:
+      case NETPLAY_CMD_PLAY:
+      case NETPLAY_CMD_MODE:
+      case NETPLAY_CMD_LOAD_SAVESTATE:
+      case NETPLAY_CMD_LOAD_SAVESTATE_DELTA:
+      case NETPLAY_CMD_RESET:
+         return true;
+      default:
+         break;
+   }
+   return false;
+}
+
+/**
+ * netplay_cmd_udp_input
+ *
+ * Tell the peer where to send UDP input datagrams, if it supports them.
+ */
+bool netplay_cmd_udp_input(netplay_t *netplay,
+   struct netplay_connection *connection)
+{
+#ifndef HAVE_SOCKET_LEGACY
+   uint32_t payload[2];
+   struct sockaddr_storage addr;
+   socklen_t addr_size = sizeof(addr);
+   uint16_t port       = 0;
+
+   if (!connection->udp_supported || netplay->udp_fd < 0 ||
+       !connection->udp_token_in)
+      return true;
+
+   if (getsockname(netplay->udp_fd, (struct sockaddr*)&addr, &addr_size) < 0)
+      return true;
+   if (addr.ss_family == AF_INET)
+      port = ntohs(((struct sockaddr_in*)&addr)->sin_port);
+#ifdef AF_INET6
+   else if (addr.ss_family == AF_INET6)
+      port = ntohs(((struct sockaddr_in6*)&addr)->sin6_port);
+#endif
+   if (!port)
+      return true;
+
+   payload[0] = htonl(port);
+   payload[1] = htonl(connection->udp_token_in);
+   return netplay_send_raw_cmd(netplay, connection, NETPLAY_CMD_UDP_INPUT,
+         payload, sizeof(payload));
+#else
+   return true;
+#endif
 }
 
 /**
@@ -451,6 +812,7 @@ bool netplay_cmd_crc(netplay_t *netplay, struct delta_frame *delta)
 {
    uint32_t payload[2];
    bool success = true;
+   bool relayed = false;
    size_t i;
    payload[0] = htonl(delta->frame);
    payload[1] = htonl(delta->crc);
@@ -458,9 +820,18 @@ bool netplay_cmd_crc(netplay_t *netplay, struct delta_frame *delta)
    {
       if (netplay->connections[i].active &&
             netplay->connections[i].mode >= NETPLAY_CONNECTION_CONNECTED)
+      {
+         if (netplay->connections[i].send_packet_buffer.relay)
+         {
+            relayed = true;
+            continue;
+         }
          success = netplay_send_raw_cmd(netplay, &netplay->connections[i],
             NETPLAY_CMD_CRC, payload, sizeof(payload)) && success;
+      }
    }
+   if (relayed)
+      relay_raw_cmd(netplay, NULL, NETPLAY_CMD_CRC, payload, sizeof(payload));
    return success;
 }
 
@@ -692,7 +1063,10 @@ static void handle_play_spectate(netplay_t *netplay, uint32_t client_num,
 
          /* Mark them as not playing anymore */
          if (connection)
+         {
             connection->mode = NETPLAY_CONNECTION_SPECTATING;
+            netplay_relay_spectator(netplay, connection);
+         }
          else
          {
             netplay->self_devices = 0;
@@ -859,8 +1233,16 @@ static void handle_play_spectate(netplay_t *netplay, uint32_t client_num,
 
          /* Mark them as playing */
          if (connection)
+         {
+#ifdef HAVE_THREADS
+            /* Players' input isn't the spectators' view, so they get their
+             * own from here on */
+            netplay_relay_detach(&connection->send_packet_buffer,
+                  connection->fd, true);
+#endif
             connection->mode =
                   slave ? NETPLAY_CONNECTION_SLAVE : NETPLAY_CONNECTION_PLAYING;
+         }
          else
          {
             netplay->self_devices = devices;
@@ -908,6 +1290,153 @@ static void handle_play_spectate(netplay_t *netplay, uint32_t client_num,
    }
 }
 
+/* Bookkeeping once a frame of a client's input has been read in */
+static void input_received(netplay_t *netplay,
+      struct netplay_connection *connection, struct delta_frame *dframe,
+      uint32_t client_num)
+{
+   dframe->have_real[client_num] = true;
+
+   /* Slaves may go through several packets of data in the same frame
+    * if latency is choppy, so we advance and send their data after
+    * handling all network data this frame */
+   if (connection->mode == NETPLAY_CONNECTION_PLAYING)
+   {
+      netplay->read_ptr[client_num] = NEXT_PTR(netplay->read_ptr[client_num]);
+      netplay->read_frame_count[client_num]++;
+
+      if (netplay->is_server)
+      {
+         /* Forward it on if it's past data */
+         if (dframe->frame <= netplay->self_frame_count)
+            send_input_frame(netplay, dframe, NULL, connection, client_num, false);
+      }
+   }
+
+   /* If this was server data, advance our server pointer too */
+   if (!netplay->is_server && client_num == 0)
+   {
+      netplay->server_ptr = netplay->read_ptr[0];
+      netplay->server_frame_count = netplay->read_frame_count[0];
+   }
+}
+
+/**
+ * poll_udp_input
+ *
+ * Read any UDP input datagrams, and take whatever input in them TCP hasn't
+ * delivered yet. Input is only taken in order and only once TCP has caught up
+ * to the last barrier command the sender sent before it, so this never
+ * changes what is read, only how soon.
+ */
+static void poll_udp_input(netplay_t *netplay, bool *had_input)
+{
+#ifndef HAVE_SOCKET_LEGACY
+   uint32_t buffer[NETPLAY_UDP_MAX_WORDS];
+
+   if (netplay->udp_fd < 0)
+      return;
+#ifdef HAVE_NETPLAY_IO_THREAD
+   if (netplay->io_thread && !netplay_io_thread_udp_pending(netplay->io_thread))
+      return;
+#endif
+
+   for (;;)
+   {
+      struct sockaddr_storage addr;
+      uint32_t token, client_num, frame, count, words, i;
+      struct netplay_connection *connection = NULL;
+      socklen_t addr_size                   = sizeof(addr);
+      ssize_t recvd                         = recvfrom(netplay->udp_fd,
+            (char*)buffer, sizeof(buffer), 0, (struct sockaddr*)&addr,
+            &addr_size);
+
+      if (recvd < 0)
+         break;
+      if (recvd < (ssize_t)(NETPLAY_UDP_HEADER_WORDS * sizeof(uint32_t)))
+         continue;
+
+      token = ntohl(buffer[0]);
+      for (i = 0; i < netplay->connections_size; i++)
+      {
+         struct netplay_connection *sc = &netplay->connections[i];
+         if (sc->active && sc->udp_token_in && sc->udp_token_in == token)
+         {
+            connection = sc;
+            break;
+         }
+      }
+      if (!connection || connection->mode != NETPLAY_CONNECTION_PLAYING)
+         continue;
+
+      /* Their datagrams may not come from where we guessed, e.g. behind NAT,
+       * so answer wherever they do come from */
+      if (addr_size <= sizeof(connection->udp_addr))
+         memcpy(&connection->udp_addr, &addr, addr_size);
+
+      /* Don't overtake anything TCP hasn't delivered yet */
+      if (ntohl(buffer[1]) != connection->udp_epoch_recv)
+         continue;
+
+      if (netplay->is_server)
+         client_num = (uint32_t)(connection - netplay->connections + 1);
+      else
+         client_num = ntohl(buffer[2]);
+      frame = ntohl(buffer[3]);
+      count = ntohl(buffer[4]);
+      words = ntohl(buffer[5]);
+
+      if (client_num >= MAX_CLIENTS ||
+          !(netplay->connected_players & (1<<client_num)) ||
+          count > NETPLAY_UDP_WINDOW ||
+          words != netplay_expected_input_size(netplay,
+             netplay->client_devices[client_num]) ||
+          (size_t)recvd != (NETPLAY_UDP_HEADER_WORDS + count*words) *
+             sizeof(uint32_t))
+         continue;
+
+      for (i = 0; i < count; i++, frame++)
+      {
+         const uint32_t *data = buffer + NETPLAY_UDP_HEADER_WORDS + i*words;
+         uint32_t devices     = netplay->client_devices[client_num];
+         struct delta_frame *dframe;
+         uint32_t device;
+
+         if (frame < netplay->read_frame_count[client_num])
+            continue;
+         if (frame > netplay->read_frame_count[client_num])
+            break;
+
+         dframe = &netplay->buffer[netplay->read_ptr[client_num]];
+         if (!netplay_delta_frame_ready(netplay, dframe, frame))
+            break;
+
+         for (device = 0; device < MAX_INPUT_DEVICES; device++)
+         {
+            netplay_input_state_t istate;
+            uint32_t dsize, di;
+            if (!(devices & (1<<device)))
+               continue;
+
+            dsize  = netplay_expected_input_size(netplay, 1 << device);
+            istate = netplay_input_state_for(&dframe->real_input[device],
+                  client_num, dsize, false, false);
+            if (!istate)
+               break;
+            for (di = 0; di < dsize; di++)
+               istate->data[di] = ntohl(*data++);
+         }
+         if (device < MAX_INPUT_DEVICES)
+            break;
+
+         input_received(netplay, connection, dframe, client_num);
+         connection->udp_frames++;
+         *had_input = true;
+      }
+   }
+#endif
+}
+
 #undef RECV
 #define RECV(buf, sz) \
 recvd = netplay_recv(&connection->recv_packet_buffer, connection->fd, (buf), \
@@ -953,6 +1482,51 @@ static bool netplay_get_cmd(netplay_t *netplay,
          /* Disconnect now! */
          return false;
 
+      case NETPLAY_CMD_UDP_INPUT:
+         {
+#ifndef HAVE_SOCKET_LEGACY
+            uint32_t payload[2];
+            uint16_t port;
+            socklen_t addr_size = sizeof(connection->udp_addr);
+
+            if (cmd_size != sizeof(payload))
+            {
+               RARCH_ERR("NETPLAY_CMD_UDP_INPUT received an unexpected payload size.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            RECV(payload, sizeof(payload))
+            {
+               RARCH_ERR("Failed to receive NETPLAY_CMD_UDP_INPUT payload.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+            port = (uint16_t)ntohl(payload[0]);
+
+            /* Send it to the address we already know them by, at the port
+             * they gave */
+            if (netplay->udp_fd < 0 || getpeername(connection->fd,
+                     (struct sockaddr*)&connection->udp_addr, &addr_size) < 0)
+               break;
+            if (connection->udp_addr.ss_family == AF_INET)
+               ((struct sockaddr_in*)&connection->udp_addr)->sin_port =
+                  htons(port);
+#ifdef AF_INET6
+            else if (connection->udp_addr.ss_family == AF_INET6)
+               ((struct sockaddr_in6*)&connection->udp_addr)->sin6_port =
+                  htons(port);
+#endif
+            else
+               break;
+
+            connection->udp_token_out = ntohl(payload[1]);
+            connection->udp_active    = true;
+#else
+            RARCH_ERR("%s.\n", msg_hash_to_str(MSG_UNKNOWN_NETPLAY_COMMAND_RECEIVED));
+            return netplay_cmd_nak(netplay, connection);
+#endif
+            break;
+         }
+
       case NETPLAY_CMD_INPUT:
          {
             uint32_t frame_num, client_num, input_size, devices, device;
@@ -1059,30 +1633,7 @@ static bool netplay_get_cmd(netplay_t *netplay,
                for (di = 0; di < dsize; di++)
                   istate->data[di] = ntohl(istate->data[di]);
             }
-            dframe->have_real[client_num] = true;
-
-            /* Slaves may go through several packets of data in the same frame
-             * if latency is choppy, so we advance and send their data after
-             * handling all network data this frame */
-            if (connection->mode == NETPLAY_CONNECTION_PLAYING)
-            {
-               netplay->read_ptr[client_num] = NEXT_PTR(netplay->read_ptr[client_num]);
-               netplay->read_frame_count[client_num]++;
-
-               if (netplay->is_server)
-               {
-                  /* Forward it on if it's past data */
-                  if (dframe->frame <= netplay->self_frame_count)
-                     send_input_frame(netplay, dframe, NULL, connection, client_num, false);
-               }
-            }
-
-            /* If this was server data, advance our server pointer too */
-            if (!netplay->is_server && client_num == 0)
-            {
-               netplay->server_ptr = netplay->read_ptr[0];
-               netplay->server_frame_count = netplay->read_frame_count[0];
-            }
+            input_received(netplay, connection, dframe, client_num);
 
 #ifdef DEBUG_NETPLAY_STEPS
             RARCH_LOG("[netplay] Received input from %u\n", client_num);
@@ -1567,10 +2118,13 @@ static bool netplay_get_cmd(netplay_t *netplay,
          break;
 
       case NETPLAY_CMD_LOAD_SAVESTATE:
+      case NETPLAY_CMD_LOAD_SAVESTATE_DELTA:
       case NETPLAY_CMD_RESET:
          {
             uint32_t frame;
             uint32_t isize;
+            uint32_t dsize       = 0;
+            uint32_t header_size = 2*sizeof(uint32_t);
             uint32_t rd, wn;
             uint32_t client;
             uint32_t load_frame_count;
@@ -1622,8 +2176,10 @@ static bool netplay_get_cmd(netplay_t *netplay,
              * too many places. */
 
             /* Check the payload size */
-            if ((cmd == NETPLAY_CMD_LOAD_SAVESTATE &&
-                 (cmd_size < 2*sizeof(uint32_t) || cmd_size > netplay->zbuffer_size + 2*sizeof(uint32_t))) ||
+            if (cmd == NETPLAY_CMD_LOAD_SAVESTATE_DELTA)
+               header_size = 3*sizeof(uint32_t);
+            if ((cmd != NETPLAY_CMD_RESET &&
+                 (cmd_size < header_size || cmd_size > netplay->zbuffer_size + header_size)) ||
                 (cmd == NETPLAY_CMD_RESET && cmd_size != sizeof(uint32_t)))
             {
                RARCH_ERR("CMD_LOAD_SAVESTATE received an unexpected payload size.\n");
@@ -1661,8 +2217,10 @@ static bool netplay_get_cmd(netplay_t *netplay,
             }
 
             /* Now we switch based on whether we're loading a state or resetting */
-            if (cmd == NETPLAY_CMD_LOAD_SAVESTATE)
+            if (cmd != NETPLAY_CMD_RESET)
             {
+               uint8_t *dest = (uint8_t*)netplay->buffer[load_ptr].state;
+
                RECV(&isize, sizeof(isize))
                {
                   RARCH_ERR("CMD_LOAD_SAVESTATE failed to receive inflated size.\n");
@@ -1676,7 +2234,34 @@ static bool netplay_get_cmd(netplay_t *netplay,
                   return netplay_cmd_nak(netplay, connection);
                }
 
-               RECV(netplay->zbuffer, cmd_size - 2*sizeof(uint32_t))
+               if (cmd == NETPLAY_CMD_LOAD_SAVESTATE_DELTA)
+               {
+                  RECV(&dsize, sizeof(dsize))
+                  {
+                     RARCH_ERR("CMD_LOAD_SAVESTATE failed to receive delta size.\n");
+                     return netplay_cmd_nak(netplay, connection);
+                  }
+                  dsize = ntohl(dsize);
+
+                  /* We need the state it's a delta against, and somewhere to
+                   * decompress it */
+                  if (!connection->savestate_recv ||
+                      dsize > netplay->state_size + NETPLAY_DELTA_OVERHEAD)
+                  {
+                     RARCH_ERR("CMD_LOAD_SAVESTATE_DELTA received without a base state.\n");
+                     return netplay_cmd_nak(netplay, connection);
+                  }
+                  if (!netplay->delta_buffer)
+                  {
+                     netplay->delta_buffer = (uint8_t*)malloc(
+                           netplay->state_size + NETPLAY_DELTA_OVERHEAD);
+                     if (!netplay->delta_buffer)
+                        return netplay_cmd_nak(netplay, connection);
+                  }
+                  dest = netplay->delta_buffer;
+               }
+
+               RECV(netplay->zbuffer, cmd_size - header_size)
                {
                   RARCH_ERR("CMD_LOAD_SAVESTATE failed to receive savestate.\n");
                   return netplay_cmd_nak(netplay, connection);
@@ -1692,13 +2277,39 @@ static bool netplay_get_cmd(netplay_t *netplay,
                      ctrans = &netplay->compress_nil;
                }
                ctrans->decompression_backend->set_in(ctrans->decompression_stream,
-                  netplay->zbuffer, cmd_size - 2*sizeof(uint32_t));
+                  netplay->zbuffer, cmd_size - header_size);
                ctrans->decompression_backend->set_out(ctrans->decompression_stream,
-                  (uint8_t*)netplay->buffer[load_ptr].state,
-                  (unsigned)netplay->state_size);
+                  dest, (unsigned)(netplay->state_size
+                     + (cmd == NETPLAY_CMD_LOAD_SAVESTATE_DELTA
+                        ? NETPLAY_DELTA_OVERHEAD : 0)));
                ctrans->decompression_backend->trans(ctrans->decompression_stream,
                   true, &rd, &wn, NULL);
 
+               if (cmd == NETPLAY_CMD_LOAD_SAVESTATE_DELTA)
+               {
+                  memcpy(netplay->buffer[load_ptr].state,
+                        connection->savestate_recv, netplay->state_size);
+                  if (wn != dsize || !netplay_delta_apply(
+                           (uint8_t*)netplay->buffer[load_ptr].state,
+                           netplay->state_size, netplay->delta_buffer, dsize))
+                  {
+                     RARCH_ERR("CMD_LOAD_SAVESTATE_DELTA received a malformed delta.\n");
+                     return netplay_cmd_nak(netplay, connection);
+                  }
+               }
+
+               /* Keep it as the base for the peer's next delta */
+               if (connection->savestate_delta)
+               {
+                  if (!connection->savestate_recv)
+                     connection->savestate_recv = (uint8_t*)malloc(
+                           netplay->state_size);
+                  if (connection->savestate_recv)
+                     memcpy(connection->savestate_recv,
+                           netplay->buffer[load_ptr].state,
+                           netplay->state_size);
+               }
+
                /* Force a rewind to the relevant frame */
                netplay->force_rewind = true;
             }
@@ -1842,6 +2453,9 @@ static bool netplay_get_cmd(netplay_t *netplay,
          return netplay_cmd_nak(netplay, connection);
    }
 
+   if (netplay_cmd_is_udp_barrier(cmd))
+      connection->udp_epoch_recv++;
+
    netplay_recv_flush(&connection->recv_packet_buffer);
    netplay->timeout_cnt = 0;
    if (had_input)
@@ -1856,6 +2470,27 @@ shrt:
 #undef RECV
 }
 
+/* Wait up to RETRY_MS for any of our sockets to have something */
+static bool wait_net_input(netplay_t *netplay, int max_fd)
+{
+   fd_set fds;
+   size_t i;
+   struct timeval tv = {0};
+   tv.tv_usec = RETRY_MS * 1000;
+
+   FD_ZERO(&fds);
+   for (i = 0; i < netplay->connections_size; i++)
+   {
+      struct netplay_connection *connection = &netplay->connections[i];
+      if (connection->active)
+         FD_SET(connection->fd, &fds);
+   }
+   if (netplay->udp_fd >= 0)
+      FD_SET(netplay->udp_fd, &fds);
+
+   return socket_select(max_fd, &fds, NULL, NULL, &tv) >= 0;
+}
+
 /**
  * netplay_poll_net_input
  *
@@ -1876,15 +2511,25 @@ int netplay_poll_net_input(netplay_t *netplay, bool block)
 
    if (max_fd == 0)
       return 0;
+   if (netplay->udp_fd >= max_fd)
+      max_fd = netplay->udp_fd + 1;
 
    netplay->timeout_cnt = 0;
 
    do
    {
+#ifdef HAVE_NETPLAY_IO_THREAD
+      uint32_t io_events = 0;
+      if (netplay->io_thread)
+         io_events = netplay_io_thread_events(netplay->io_thread);
+#endif
       had_input = false;
 
       netplay->timeout_cnt++;
 
+      /* Take what UDP has first, so TCP's copy is known to be stale */
+      poll_udp_input(netplay, &had_input);
+
       /* Read input from each connection */
       for (i = 0; i < netplay->connections_size; i++)
       {
@@ -1904,19 +2549,12 @@ int netplay_poll_net_input(netplay_t *netplay, bool block)
          /* If we're supposed to block but we didn't have enough input, wait for it */
          if (!had_input)
          {
-            fd_set fds;
-            struct timeval tv = {0};
-            tv.tv_usec = RETRY_MS * 1000;
-
-            FD_ZERO(&fds);
-            for (i = 0; i < netplay->connections_size; i++)
-            {
-               struct netplay_connection *connection = &netplay->connections[i];
-               if (connection->active)
-                  FD_SET(connection->fd, &fds);
-            }
-
-            if (socket_select(max_fd, &fds, NULL, NULL, &tv) < 0)
+#ifdef HAVE_NETPLAY_IO_THREAD
+            if (netplay->io_thread)
+               netplay_io_thread_wait(netplay->io_thread, io_events, RETRY_MS);
+            else
+#endif
+            if (!wait_net_input(netplay, max_fd))
                return -1;
 
             RARCH_LOG("[netplay] Network is stalling at frame %u, count %u of %d ...\n",
@@ -0,0 +1,790 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2016-2017 - Gregor Richards
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <boolean.h>
+#include <net/net_compat.h>
+#include <net/net_socket.h>
+
+#include "netplay_private.h"
+
+#ifdef HAVE_NETPLAY_IO_THREAD
+
+#ifdef __linux__
+#define NETPLAY_IO_EPOLL
+#include <sys/epoll.h>
+#endif
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+#include <retro_timers.h>
+#include <rthreads/rthreads.h>
+
+#ifdef _MSC_VER
+#define NETPLAY_IO_BARRIER() MemoryBarrier()
+#else
+#define NETPLAY_IO_BARRIER() __sync_synchronize()
+#endif
+
+/* Most we'll read from a socket in one go */
+#define NETPLAY_IO_READ_SIZE     65536
+
+/* Stop reading from a peer when this much of its data is still waiting for
+ * the main thread, and start again once half of it has been taken */
+#define NETPLAY_IO_INBOX_MAX     (16*1024*1024)
+
+/* Accepted connections not yet picked up by the main thread */
+#define NETPLAY_IO_ACCEPT_QUEUE  64
+
+/* Longest the thread sleeps where there's no wakeup pipe to rouse it
+ * (Windows) */
+#define NETPLAY_IO_WAIT_MS       16
+
+#define NETPLAY_IO_MAX_EVENTS    32
+
+/* Data read from a socket, waiting for the main thread */
+struct netplay_io_chunk
+{
+   struct netplay_io_chunk *volatile next;
+   unsigned char *data;
+   size_t len;
+   size_t pos; /* main thread only */
+};
+
+/* Each connection's socket is drained into a single-producer,
+ * single-consumer list of chunks. The I/O thread appends at tail, the main
+ * thread reads from head->next and frees head as it goes, so neither needs a
+ * lock. */
+struct netplay_inbox
+{
+   struct netplay_io_thread *owner;
+
+   /* Main thread end. head has been read; head->next is the first chunk
+    * that has not */
+   struct netplay_io_chunk *head;
+   volatile size_t consumed;
+
+   /* I/O thread end */
+   struct netplay_io_chunk *tail;
+   volatile size_t produced;
+
+   /* Set by the I/O thread once the socket has been closed or failed. No
+    * more chunks follow */
+   volatile int closed;
+
+   /* Set by the I/O thread while it has stopped reading this socket
+    * because too much is queued */
+   volatile int throttled;
+
+   int fd;
+
+#ifdef NETPLAY_IO_EPOLL
+   /* Whether fd is in the epoll set, I/O thread only */
+   bool watched;
+#endif
+
+   /* I/O thread's list of inboxes */
+   struct netplay_inbox *next;
+
+   /* Attach/detach requests, under the lock */
+   struct netplay_inbox *next_pending;
+};
+
+struct netplay_io_thread
+{
+   sthread_t *thread;
+   slock_t *lock;
+   scond_t *cond;
+
+   int listen_fd;
+   int udp_fd;
+   int wake_fd[2];
+#ifdef NETPLAY_IO_EPOLL
+   int epoll_fd;
+#endif
+
+   /* Inboxes being serviced, I/O thread only */
+   struct netplay_inbox *inboxes;
+
+   /* Requests from the main thread, under the lock */
+   struct netplay_inbox *attaching, *detaching;
+
+   /* Count of reads that might interest the main thread, under the lock */
+   uint32_t events;
+
+   /* Accepted sockets, I/O thread writes at head, main thread reads at
+    * tail */
+   int accepted[NETPLAY_IO_ACCEPT_QUEUE];
+   volatile unsigned accept_head, accept_tail;
+
+   /* Set by the I/O thread when a datagram arrives */
+   volatile int udp_pending;
+
+   volatile int quit;
+
+   unsigned char *read_buf;
+};
+
+static void io_wake(struct netplay_io_thread *t)
+{
+#ifndef _WIN32
+   if (t->wake_fd[1] >= 0)
+   {
+      char c = 0;
+      if (write(t->wake_fd[1], &c, 1) < 0) { /* Already pending */ }
+   }
+#endif
+}
+
+static void io_signal(struct netplay_io_thread *t)
+{
+   slock_lock(t->lock);
+   t->events++;
+   scond_broadcast(t->cond);
+   slock_unlock(t->lock);
+}
+
+/* Start or stop reading a socket. Stopping takes it out of the epoll set
+ * altogether: with no events asked for, epoll still reports EPOLLHUP and
+ * EPOLLERR, and a hung up socket would have us spin. */
+static void io_watch(struct netplay_io_thread *t,
+      struct netplay_inbox *inbox, bool watch)
+{
+#ifdef NETPLAY_IO_EPOLL
+   struct epoll_event ev;
+
+   if (watch == inbox->watched)
+      return;
+   inbox->watched = watch;
+
+   if (!watch)
+   {
+      epoll_ctl(t->epoll_fd, EPOLL_CTL_DEL, inbox->fd, NULL);
+      return;
+   }
+
+   ev.events   = EPOLLIN;
+   ev.data.ptr = inbox;
+   epoll_ctl(t->epoll_fd, EPOLL_CTL_ADD, inbox->fd, &ev);
+#endif
+}
+
+static void inbox_free_chunks(struct netplay_inbox *inbox)
+{
+   struct netplay_io_chunk *chunk = inbox->head;
+   while (chunk)
+   {
+      struct netplay_io_chunk *next = chunk->next;
+      free(chunk);
+      chunk = next;
+   }
+}
+
+/* Read whatever the socket has into the inbox */
+static void inbox_fill(struct netplay_io_thread *t,
+      struct netplay_inbox *inbox)
+{
+   bool error = false;
+   ssize_t recvd;
+   struct netplay_io_chunk *chunk;
+
+   if (inbox->closed)
+      return;
+
+   if (inbox->produced - inbox->consumed >= NETPLAY_IO_INBOX_MAX)
+   {
+      inbox->throttled = 1;
+      io_watch(t, inbox, false);
+      return;
+   }
+
+   recvd = socket_receive_all_nonblocking(inbox->fd, &error,
+         t->read_buf, NETPLAY_IO_READ_SIZE);
+   if (recvd == 0 && !error)
+      return;
+
+   if (recvd > 0 && !error)
+   {
+      chunk = (struct netplay_io_chunk*)malloc(sizeof(*chunk) + recvd);
+      if (chunk)
+      {
+         chunk->next = NULL;
+         chunk->data = (unsigned char*)(chunk + 1);
+         chunk->len  = recvd;
+         chunk->pos  = 0;
+         memcpy(chunk->data, t->read_buf, recvd);
+
+         /* Publish the chunk only once its contents are visible */
+         NETPLAY_IO_BARRIER();
+         inbox->tail->next  = chunk;
+         inbox->tail        = chunk;
+         inbox->produced   += recvd;
+      }
+      else
+         error = true;
+   }
+   else
+      error = true;
+
+   if (error)
+   {
+      /* Everything before this stays readable, then reads fail */
+      NETPLAY_IO_BARRIER();
+      inbox->closed = 1;
+      io_watch(t, inbox, false);
+   }
+
+   io_signal(t);
+}
+
+static void io_accept(struct netplay_io_thread *t)
+{
+   for (;;)
+   {
+      struct sockaddr_storage their_addr;
+      socklen_t addr_size = sizeof(their_addr);
+      int fd              = accept(t->listen_fd,
+            (struct sockaddr*)&their_addr, &addr_size);
+
+      if (fd < 0)
+         break;
+
+      if (t->accept_head - t->accept_tail >= NETPLAY_IO_ACCEPT_QUEUE)
+      {
+         RARCH_WARN("[netplay] Too many pending connections, dropping one.\n");
+         socket_close(fd);
+         continue;
+      }
+
+      t->accepted[t->accept_head % NETPLAY_IO_ACCEPT_QUEUE] = fd;
+      NETPLAY_IO_BARRIER();
+      t->accept_head++;
+   }
+
+   io_signal(t);
+}
+
+/* Take on new inboxes and drop detached ones. Detached inboxes have their
+ * sockets closed here, so a socket is never reused while we may still read
+ * it. */
+static void io_process_requests(struct netplay_io_thread *t)
+{
+   struct netplay_inbox *attaching, *detaching;
+
+   slock_lock(t->lock);
+   attaching    = t->attaching;
+   detaching    = t->detaching;
+   t->attaching = NULL;
+   t->detaching = NULL;
+   slock_unlock(t->lock);
+
+   while (attaching)
+   {
+      struct netplay_inbox *inbox = attaching;
+#ifdef NETPLAY_IO_EPOLL
+      struct epoll_event ev;
+      ev.events   = EPOLLIN;
+      ev.data.ptr = inbox;
+      if (!t->quit && epoll_ctl(t->epoll_fd, EPOLL_CTL_ADD, inbox->fd, &ev) < 0)
+      {
+         NETPLAY_IO_BARRIER();
+         inbox->closed = 1;
+      }
+      else
+         inbox->watched = !t->quit;
+#endif
+      attaching   = inbox->next_pending;
+      inbox->next = t->inboxes;
+      t->inboxes  = inbox;
+   }
+
+   while (detaching)
+   {
+      struct netplay_inbox *inbox = detaching, **prev;
+      detaching = inbox->next_pending;
+
+      for (prev = &t->inboxes; *prev; prev = &(*prev)->next)
+      {
+         if (*prev == inbox)
+         {
+            *prev = inbox->next;
+            break;
+         }
+      }
+
+      io_watch(t, inbox, false);
+      socket_close(inbox->fd);
+      inbox_free_chunks(inbox);
+      free(inbox);
+   }
+}
+
+/* Resume reading sockets the main thread has caught up on */
+static void io_unthrottle(struct netplay_io_thread *t)
+{
+   struct netplay_inbox *inbox;
+   for (inbox = t->inboxes; inbox; inbox = inbox->next)
+   {
+      if (inbox->throttled && !inbox->closed &&
+            inbox->produced - inbox->consumed < NETPLAY_IO_INBOX_MAX / 2)
+      {
+         inbox->throttled = 0;
+         io_watch(t, inbox, true);
+      }
+   }
+}
+
+static void io_drain_wake(struct netplay_io_thread *t)
+{
+#ifndef _WIN32
+   char buf[64];
+   while (read(t->wake_fd[0], buf, sizeof(buf)) > 0) {}
+#endif
+}
+
+#ifdef NETPLAY_IO_EPOLL
+static void io_wait(struct netplay_io_thread *t)
+{
+   struct epoll_event events[NETPLAY_IO_MAX_EVENTS];
+   int i;
+   int n = epoll_wait(t->epoll_fd, events, NETPLAY_IO_MAX_EVENTS,
+         t->wake_fd[0] >= 0 ? -1 : NETPLAY_IO_WAIT_MS);
+
+   for (i = 0; i < n; i++)
+   {
+      void *ptr = events[i].data.ptr;
+
+      if (ptr == &t->listen_fd)
+         io_accept(t);
+      else if (ptr == &t->udp_fd)
+      {
+         t->udp_pending = 1;
+         io_signal(t);
+      }
+      else if (ptr == &t->wake_fd)
+         io_drain_wake(t);
+      else
+         inbox_fill(t, (struct netplay_inbox*)ptr);
+   }
+}
+#else
+static void io_wait(struct netplay_io_thread *t)
+{
+   fd_set fds;
+   struct timeval tv;
+   struct netplay_inbox *inbox;
+   int max_fd = -1;
+
+   FD_ZERO(&fds);
+   if (t->listen_fd >= 0)
+   {
+      FD_SET(t->listen_fd, &fds);
+      max_fd = t->listen_fd;
+   }
+   if (t->wake_fd[0] >= 0)
+   {
+      FD_SET(t->wake_fd[0], &fds);
+      if (t->wake_fd[0] > max_fd)
+         max_fd = t->wake_fd[0];
+   }
+   for (inbox = t->inboxes; inbox; inbox = inbox->next)
+   {
+      if (inbox->closed || inbox->throttled)
+         continue;
+      FD_SET(inbox->fd, &fds);
+      if (inbox->fd > max_fd)
+         max_fd = inbox->fd;
+   }
+
+   /* Winsock refuses to select on nothing */
+   if (max_fd < 0)
+   {
+      retro_sleep(NETPLAY_IO_WAIT_MS);
+      return;
+   }
+
+   tv.tv_sec  = 0;
+   tv.tv_usec = NETPLAY_IO_WAIT_MS * 1000;
+   if (socket_select(max_fd + 1, &fds, NULL, NULL,
+            t->wake_fd[0] >= 0 ? NULL : &tv) <= 0)
+      return;
+
+   if (t->listen_fd >= 0 && FD_ISSET(t->listen_fd, &fds))
+      io_accept(t);
+   if (t->wake_fd[0] >= 0 && FD_ISSET(t->wake_fd[0], &fds))
+      io_drain_wake(t);
+   for (inbox = t->inboxes; inbox; inbox = inbox->next)
+      if (!inbox->closed && !inbox->throttled && FD_ISSET(inbox->fd, &fds))
+         inbox_fill(t, inbox);
+}
+#endif
+
+static void netplay_io_thread_loop(void *data)
+{
+   struct netplay_io_thread *t = (struct netplay_io_thread*)data;
+
+   while (!t->quit)
+   {
+      io_wait(t);
+      io_process_requests(t);
+      io_unthrottle(t);
+   }
+}
+
+#ifdef NETPLAY_IO_EPOLL
+static bool io_epoll_add(struct netplay_io_thread *t, int fd, void *ptr,
+      uint32_t events)
+{
+   struct epoll_event ev;
+   ev.events   = events;
+   ev.data.ptr = ptr;
+   return epoll_ctl(t->epoll_fd, EPOLL_CTL_ADD, fd, &ev) == 0;
+}
+#endif
+
+/**
+ * netplay_io_thread_new
+ * @listen_fd             : listening socket to accept from, or -1
+ * @udp_fd                : UDP input socket to watch, or -1
+ *
+ * Starts a thread to service netplay sockets. Both sockets must already be
+ * nonblocking.
+ *
+ * Returns: the new thread, or NULL if none could be started.
+ */
+struct netplay_io_thread *netplay_io_thread_new(int listen_fd, int udp_fd)
+{
+   struct netplay_io_thread *t = (struct netplay_io_thread*)
+      calloc(1, sizeof(*t));
+
+   if (!t)
+      return NULL;
+
+   t->listen_fd  = listen_fd;
+   t->udp_fd     = udp_fd;
+   t->wake_fd[0] = t->wake_fd[1] = -1;
+#ifdef NETPLAY_IO_EPOLL
+   t->epoll_fd   = -1;
+#endif
+
+   t->lock       = slock_new();
+   t->cond       = scond_new();
+   t->read_buf   = (unsigned char*)malloc(NETPLAY_IO_READ_SIZE);
+   if (!t->lock || !t->cond || !t->read_buf)
+      goto error;
+
+#ifndef _WIN32
+   if (pipe(t->wake_fd) < 0)
+      t->wake_fd[0] = t->wake_fd[1] = -1;
+   else if (fcntl(t->wake_fd[0], F_SETFL, O_NONBLOCK) < 0 ||
+            fcntl(t->wake_fd[1], F_SETFL, O_NONBLOCK) < 0)
+      goto error;
+#endif
+
+#ifdef NETPLAY_IO_EPOLL
+   t->epoll_fd = epoll_create(NETPLAY_IO_MAX_EVENTS);
+   if (t->epoll_fd < 0)
+      goto error;
+   if (listen_fd >= 0 && !io_epoll_add(t, listen_fd, &t->listen_fd, EPOLLIN))
+      goto error;
+   if (t->wake_fd[0] >= 0 && !io_epoll_add(t, t->wake_fd[0], &t->wake_fd, EPOLLIN))
+      goto error;
+   /* Edge triggered, as the main thread does the reading */
+   if (udp_fd >= 0 && !io_epoll_add(t, udp_fd, &t->udp_fd, EPOLLIN | EPOLLET))
+      goto error;
+#endif
+
+   t->thread = sthread_create(netplay_io_thread_loop, t);
+   if (!t->thread)
+      goto error;
+
+   return t;
+
+error:
+   RARCH_WARN("[netplay] Could not start the network thread, polling sockets from the main thread.\n");
+#ifdef NETPLAY_IO_EPOLL
+   if (t->epoll_fd >= 0)
+      close(t->epoll_fd);
+#endif
+#ifndef _WIN32
+   if (t->wake_fd[0] >= 0)
+      close(t->wake_fd[0]);
+   if (t->wake_fd[1] >= 0)
+      close(t->wake_fd[1]);
+#endif
+   if (t->lock)
+      slock_free(t->lock);
+   if (t->cond)
+      scond_free(t->cond);
+   free(t->read_buf);
+   free(t);
+   return NULL;
+}
+
+/**
+ * netplay_io_thread_free
+ * @t                     : the I/O thread
+ *
+ * Stops the thread. Sockets of detached inboxes are closed; sockets of
+ * inboxes still attached are left to their owners.
+ */
+void netplay_io_thread_free(struct netplay_io_thread *t)
+{
+   struct netplay_inbox *inbox;
+
+   if (!t)
+      return;
+
+   t->quit = 1;
+   io_wake(t);
+   sthread_join(t->thread);
+
+   io_process_requests(t);
+   while ((inbox = t->inboxes))
+   {
+      t->inboxes = inbox->next;
+      inbox_free_chunks(inbox);
+      free(inbox);
+   }
+
+   while (t->accept_tail != t->accept_head)
+      socket_close(t->accepted[t->accept_tail++ % NETPLAY_IO_ACCEPT_QUEUE]);
+
+#ifdef NETPLAY_IO_EPOLL
+   close(t->epoll_fd);
+#endif
+#ifndef _WIN32
+   if (t->wake_fd[0] >= 0)
+      close(t->wake_fd[0]);
+   if (t->wake_fd[1] >= 0)
+      close(t->wake_fd[1]);
+#endif
+   slock_free(t->lock);
+   scond_free(t->cond);
+   free(t->read_buf);
+   free(t);
+}
+
+/**
+ * netplay_io_thread_attach
+ * @t                     : the I/O thread
+ * @fd                    : nonblocking socket
+ *
+ * Has the I/O thread read the given socket from now on. Its data is then
+ * read with netplay_inbox_read. Once attached, the socket must be closed
+ * only through netplay_io_thread_detach.
+ *
+ * Returns: the socket's inbox, or NULL on failure, in which case the caller
+ * should read the socket itself.
+ */
+struct netplay_inbox *netplay_io_thread_attach(struct netplay_io_thread *t,
+      int fd)
+{
+   struct netplay_inbox *inbox;
+
+   if (!t)
+      return NULL;
+
+   inbox = (struct netplay_inbox*)calloc(1, sizeof(*inbox));
+   if (!inbox)
+      return NULL;
+
+   inbox->head = (struct netplay_io_chunk*)calloc(1, sizeof(*inbox->head));
+   if (!inbox->head)
+   {
+      free(inbox);
+      return NULL;
+   }
+   inbox->tail  = inbox->head;
+   inbox->owner = t;
+   inbox->fd    = fd;
+
+   slock_lock(t->lock);
+   inbox->next_pending = t->attaching;
+   t->attaching        = inbox;
+   slock_unlock(t->lock);
+   io_wake(t);
+
+   return inbox;
+}
+
+/**
+ * netplay_io_thread_detach
+ * @t                     : the I/O thread
+ * @inbox                 : inbox to detach
+ *
+ * Stops reading the inbox's socket, then closes it and frees the inbox. The
+ * inbox must not be used after this.
+ */
+void netplay_io_thread_detach(struct netplay_io_thread *t,
+      struct netplay_inbox *inbox)
+{
+   slock_lock(t->lock);
+   inbox->next_pending = t->detaching;
+   t->detaching        = inbox;
+   slock_unlock(t->lock);
+   io_wake(t);
+}
+
+/**
+ * netplay_io_thread_accept
+ * @t                     : the I/O thread
+ *
+ * Returns: a socket the I/O thread has accepted, or -1 if there are none.
+ */
+int netplay_io_thread_accept(struct netplay_io_thread *t)
+{
+   int fd;
+
+   if (t->accept_tail == t->accept_head)
+      return -1;
+
+   NETPLAY_IO_BARRIER();
+   fd = t->accepted[t->accept_tail % NETPLAY_IO_ACCEPT_QUEUE];
+   NETPLAY_IO_BARRIER();
+   t->accept_tail++;
+
+   return fd;
+}
+
+/**
+ * netplay_io_thread_udp_pending
+ * @t                     : the I/O thread
+ *
+ * Returns: true if datagrams may have arrived since the last call. Always
+ * true where the thread can't watch the UDP socket for us.
+ */
+bool netplay_io_thread_udp_pending(struct netplay_io_thread *t)
+{
+#ifdef NETPLAY_IO_EPOLL
+   if (!t->udp_pending)
+      return false;
+   t->udp_pending = 0;
+   NETPLAY_IO_BARRIER();
+#endif
+   return true;
+}
+
+/**
+ * netplay_io_thread_events
+ * @t                     : the I/O thread
+ *
+ * Returns: a count which changes whenever the I/O thread has something new
+ * for the main thread.
+ */
+uint32_t netplay_io_thread_events(struct netplay_io_thread *t)
+{
+   uint32_t events;
+   slock_lock(t->lock);
+   events = t->events;
+   slock_unlock(t->lock);
+   return events;
+}
+
+/**
+ * netplay_io_thread_wait
+ * @t                     : the I/O thread
+ * @since                 : value of netplay_io_thread_events from before we
+ *                          last looked for data
+ * @timeout_ms            : longest to wait
+ *
+ * Waits until the I/O thread has something new, or the timeout passes.
+ */
+void netplay_io_thread_wait(struct netplay_io_thread *t, uint32_t since,
+      unsigned timeout_ms)
+{
+   slock_lock(t->lock);
+   if (t->events == since)
+      scond_wait_timeout(t->cond, t->lock, (int64_t)timeout_ms * 1000);
+   slock_unlock(t->lock);
+}
+
+/**
+ * netplay_inbox_thread
+ * @inbox                 : inbox
+ *
+ * Returns: the I/O thread filling the inbox.
+ */
+struct netplay_io_thread *netplay_inbox_thread(struct netplay_inbox *inbox)
+{
+   return inbox->owner;
+}
+
+/**
+ * netplay_inbox_read
+ * @inbox                 : inbox to read from
+ * @error                 : set if the socket has been closed and everything
+ *                          it sent has been read
+ * @buf                   : buffer to read into
+ * @len                   : size of buf
+ *
+ * Nonblocking read, as socket_receive_all_nonblocking, but from data the I/O
+ * thread has already taken off the socket.
+ *
+ * Returns: number of bytes read, which may be 0, or -1 on error.
+ */
+ssize_t netplay_inbox_read(struct netplay_inbox *inbox, bool *error,
+      void *buf, size_t len)
+{
+   unsigned char *out = (unsigned char*)buf;
+   size_t copied      = 0;
+
+   while (copied < len)
+   {
+      size_t avail;
+      struct netplay_io_chunk *next = inbox->head->next;
+
+      if (!next)
+         break;
+      NETPLAY_IO_BARRIER();
+
+      avail = next->len - next->pos;
+      if (avail > len - copied)
+         avail = len - copied;
+      memcpy(out + copied, next->data + next->pos, avail);
+      next->pos += avail;
+      copied    += avail;
+
+      if (next->pos == next->len)
+      {
+         free(inbox->head);
+         inbox->head      = next;
+         inbox->consumed += next->len;
+      }
+   }
+
+   if (copied == 0 && inbox->closed)
+   {
+      NETPLAY_IO_BARRIER();
+      if (!inbox->head->next)
+      {
+         *error = true;
+         return -1;
+      }
+   }
+
+   if (inbox->throttled &&
+         inbox->produced - inbox->consumed < NETPLAY_IO_INBOX_MAX / 2)
+      io_wake(inbox->owner);
+
+   return copied;
+}
+
+#endif
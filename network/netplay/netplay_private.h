@@ -28,6 +28,13 @@
 #include "../../msg_hash.h"
 #include "../../verbosity.h"
 
+/* Sockets are read by a dedicated thread, where we have threads and
+ * something to order memory with */
+#if defined(HAVE_THREADS) && !defined(HAVE_SOCKET_LEGACY) && \
+   (defined(__GNUC__) || defined(_MSC_VER))
+#define HAVE_NETPLAY_IO_THREAD 1
+#endif
+
 #define NETPLAY_PROTOCOL_VERSION 5
 
 #define RARCH_DEFAULT_PORT 55435
@@ -67,6 +74,7 @@ typedef uint32_t client_bitmap_t;
 #define NETPLAY_QUIRK_INITIALIZATION (1<<2)
 #define NETPLAY_QUIRK_ENDIAN_DEPENDENT (1<<3)
 #define NETPLAY_QUIRK_PLATFORM_DEPENDENT (1<<4)
+#define NETPLAY_QUIRK_VARIABLE_SIZE (1<<5)
 
 /* Mapping of serialization quirks to netplay quirks. */
 #define NETPLAY_QUIRK_MAP_UNDERSTOOD \
@@ -86,15 +94,51 @@ typedef uint32_t client_bitmap_t;
    (RETRO_SERIALIZATION_QUIRK_ENDIAN_DEPENDENT)
 #define NETPLAY_QUIRK_MAP_PLATFORM_DEPENDENT \
    (RETRO_SERIALIZATION_QUIRK_PLATFORM_DEPENDENT)
-
-/* Compression protocols supported */
-#define NETPLAY_COMPRESSION_ZLIB (1<<0)
+#define NETPLAY_QUIRK_MAP_VARIABLE_SIZE \
+   (RETRO_SERIALIZATION_QUIRK_CORE_VARIABLE_SIZE)
+
+/* Savestates are CRC'd in blocks of this size, so that only blocks which
+ * changed since the last CRC need to be run through CRC-32 again */
+#define NETPLAY_CRC_BLOCK_SIZE 4096
+
+/* Compression protocols supported. DELTA is not a transcoder of its own, it
+ * means that savestates may be sent as a delta against the last one sent
+ * (NETPLAY_CMD_LOAD_SAVESTATE_DELTA), which is then run through the
+ * negotiated transcoder. */
+#define NETPLAY_COMPRESSION_ZLIB  (1<<0)
+#define NETPLAY_COMPRESSION_DELTA (1<<1)
 #if HAVE_ZLIB
-#define NETPLAY_COMPRESSION_SUPPORTED NETPLAY_COMPRESSION_ZLIB
+#define NETPLAY_COMPRESSION_SUPPORTED \
+   (NETPLAY_COMPRESSION_ZLIB | NETPLAY_COMPRESSION_DELTA)
 #else
-#define NETPLAY_COMPRESSION_SUPPORTED 0
+#define NETPLAY_COMPRESSION_SUPPORTED NETPLAY_COMPRESSION_DELTA
 #endif
 
+/* Worst-case overhead of a savestate delta over the state itself, see
+ * netplay_delta_encode */
+#define NETPLAY_DELTA_OVERHEAD (2*sizeof(uint32_t))
+
+/* Optional features, advertised in the connection header alongside the
+ * compression protocols. Peers which don't know a bit ignore it. */
+#define NETPLAY_FEATURE_UDP_INPUT (1<<16)
+
+/* How many frames of input each UDP input datagram repeats, so that a lost
+ * datagram is covered by the next one */
+#define NETPLAY_UDP_WINDOW 8
+
+/* Largest input, in words, of a single frame of a single client */
+#define NETPLAY_MAX_INPUT_WORDS 12
+
+/* Header of a UDP input datagram: token, epoch, client number, first frame,
+ * frame count and words per frame */
+#define NETPLAY_UDP_HEADER_WORDS 6
+#define NETPLAY_UDP_MAX_WORDS \
+   (NETPLAY_UDP_HEADER_WORDS + NETPLAY_UDP_WINDOW*NETPLAY_MAX_INPUT_WORDS)
+
+/* Most datagrams held back at once by simulated UDP jitter. Any more are
+ * dropped. */
+#define NETPLAY_UDP_DELAYED_MAX 64
+
 enum netplay_cmd
 {
    /* Basic commands */
@@ -140,6 +184,9 @@ enum netplay_cmd
    /* Report player mode refused */
    NETPLAY_CMD_MODE_REFUSED   = 0x0027,
 
+   /* Give the port and token to send UDP input datagrams to */
+   NETPLAY_CMD_UDP_INPUT      = 0x0028,
+
    /* Loading and synchronization */
 
    /* Send the CRC hash of a frame's state */
@@ -166,6 +213,10 @@ enum netplay_cmd
    /* Sends over cheats enabled on client (unsupported) */
    NETPLAY_CMD_CHEATS         = 0x0047,
 
+   /* Send a savestate for the client to load, as a delta against the last
+    * savestate sent over this connection */
+   NETPLAY_CMD_LOAD_SAVESTATE_DELTA = 0x0048,
+
    /* Misc. commands */
 
    /* Sends multiple config requests over,
@@ -317,6 +368,11 @@ struct delta_frame
    bool used; /* a bit derpy, but this is how we know if the delta's been used at all */
 };
 
+struct netplay_inbox;
+struct netplay_io_thread;
+struct netplay_relay;
+struct netplay_relay_peer;
+
 struct socket_buffer
 {
    unsigned char *data;
@@ -324,6 +380,22 @@ struct socket_buffer
    size_t start;
    size_t end;
    size_t read;
+
+   /* If set, received data comes from here rather than from the socket */
+   struct netplay_inbox *inbox;
+
+   /* If set, data to send goes to the relay rather than into this buffer */
+   struct netplay_relay_peer *relay;
+};
+
+/* A datagram held back by simulated UDP jitter */
+struct netplay_udp_delayed
+{
+   retro_time_t when;
+   struct sockaddr_storage addr;
+   socklen_t addr_size;
+   size_t size;
+   uint32_t data[NETPLAY_UDP_MAX_WORDS];
 };
 
 /* Each connection gets a connection struct */
@@ -349,6 +421,27 @@ struct netplay_connection
    /* What compression does this peer support? */
    uint32_t compression_supported;
 
+   /* The last savestate received from this peer, the base for any
+    * NETPLAY_CMD_LOAD_SAVESTATE_DELTA it sends. Allocated on first use. */
+   uint8_t *savestate_recv;
+
+   /* Where to send UDP input datagrams. Starts as the peer's TCP address with
+    * the port it gave us, then follows wherever its datagrams come from. */
+   struct sockaddr_storage udp_addr;
+
+   /* Tokens identifying this connection's datagrams: the one we gave the peer
+    * and expect back, and the one it gave us to send */
+   uint32_t udp_token_in, udp_token_out;
+
+   /* Count of commands which UDP input may not overtake (see
+    * netplay_cmd_is_udp_barrier) sent to and received from this peer.
+    * Datagrams carry the sender's count, and are only used once the receiver
+    * has caught up to it over TCP. */
+   uint32_t udp_epoch_sent, udp_epoch_recv;
+
+   /* Frames of input which arrived over UDP before TCP */
+   uint32_t udp_frames;
+
    /* For the server: When was the last time we requested this client to stall?
     * For the client: How many frames of stall do we have left? */
    uint32_t stall_frame;
@@ -373,6 +466,17 @@ struct netplay_connection
 
    /* Is this connection buffer in use? */
    bool active;
+
+   /* Does this peer accept savestate deltas? */
+   bool savestate_delta;
+
+   /* Does this peer hold netplay->savestate_sent, i.e. can the next savestate
+    * be sent to it as a delta? */
+   bool savestate_base_valid;
+
+   /* Did the peer advertise UDP input, and did it tell us where to send it? */
+   bool udp_supported;
+   bool udp_active;
 };
 
 /* Compression transcoder */
@@ -403,6 +507,25 @@ struct netplay
    /* TCP connection for listening (server only) */
    int listen_fd;
 
+   /* UDP socket for redundant input, or -1 */
+   int udp_fd;
+
+   /* Simulated UDP input loss and jitter, for testing: the percentage of
+    * datagrams dropped and the most microseconds a datagram is held back.
+    * Taken from NETPLAY_UDP_LOSS and NETPLAY_UDP_JITTER (in ms) in the
+    * environment. */
+   unsigned udp_loss;
+   retro_time_t udp_jitter;
+   struct netplay_udp_delayed *udp_delayed;
+   size_t udp_delayed_count;
+
+   /* Thread accepting connections and reading their sockets, or NULL */
+   struct netplay_io_thread *io_thread;
+
+   /* Shared output for spectators, sent by its own thread (server only), or
+    * NULL */
+   struct netplay_relay *relay;
+
    /* Our client number */
    uint32_t self_client_num;
 
@@ -453,6 +576,25 @@ struct netplay
    uint8_t *zbuffer;
    size_t zbuffer_size;
 
+   /* The last savestate sent to peers, and a buffer for encoding and decoding
+    * deltas against it. Both are allocated once a peer supports deltas. */
+   uint8_t *savestate_sent;
+   uint8_t *delta_buffer;
+
+   /* Hash and CRC of each NETPLAY_CRC_BLOCK_SIZE block of the last state
+    * we computed a CRC for, see netplay_delta_frame_crc */
+   uint64_t *crc_block_hash;
+   uint32_t *crc_block_crc;
+   size_t crc_blocks;
+
+   /* CRC-32 shift operators for a full and for the last block */
+   uint32_t crc_shift_block[32];
+   uint32_t crc_shift_tail[32];
+
+   /* Set if the core overwrites the whole savestate buffer on every
+    * serialization, so buffers needn't be cleared before serializing */
+   bool state_overwritten;
+
    /* The size of our packet buffers */
    size_t packet_buffer_size;
 
@@ -603,6 +745,13 @@ bool netplay_resize_socket_buffer(struct socket_buffer *sbuf, size_t newsize);
  */
 void netplay_deinit_socket_buffer(struct socket_buffer *sbuf);
 
+/**
+ * netplay_clear_socket_buffer
+ *
+ * Discard everything in a socket buffer.
+ */
+void netplay_clear_socket_buffer(struct socket_buffer *sbuf);
+
 /**
  * netplay_send
  *
@@ -670,6 +819,36 @@ bool netplay_delta_frame_ready(netplay_t *netplay, struct delta_frame *delta,
  */
 uint32_t netplay_delta_frame_crc(netplay_t *netplay, struct delta_frame *delta);
 
+/**
+ * netplay_delta_crc_init
+ *
+ * Set up the block CRC cache used by netplay_delta_frame_crc. Without it,
+ * CRCs are computed over the whole state every time.
+ */
+void netplay_delta_crc_init(netplay_t *netplay);
+
+/**
+ * netplay_delta_encode
+ *
+ * Encode the differences between two savestates of the same size as a
+ * sequence of (skip, count, data) runs. out must hold at least
+ * size + NETPLAY_DELTA_OVERHEAD bytes.
+ *
+ * Returns: The size of the encoded delta.
+ */
+size_t netplay_delta_encode(const uint8_t *base, const uint8_t *state,
+   size_t size, uint8_t *out);
+
+/**
+ * netplay_delta_apply
+ *
+ * Apply a delta made by netplay_delta_encode to a copy of its base state.
+ *
+ * Returns: False if the delta is malformed or does not fit the state.
+ */
+bool netplay_delta_apply(uint8_t *state, size_t size,
+   const uint8_t *delta, size_t delta_size);
+
 /**
  * netplay_delta_frame_free
  *
@@ -818,6 +997,14 @@ void netplay_free(netplay_t *netplay);
  */
 void netplay_hangup(netplay_t *netplay, struct netplay_connection *connection);
 
+/**
+ * netplay_relay_spectator
+ *
+ * Hands a spectator's output over to the relay, if we have one.
+ */
+void netplay_relay_spectator(netplay_t *netplay,
+   struct netplay_connection *connection);
+
 /**
  * netplay_delayed_state_change:
  *
@@ -836,6 +1023,13 @@ void netplay_delayed_state_change(netplay_t *netplay);
 bool netplay_send_cur_input(netplay_t *netplay,
    struct netplay_connection *connection);
 
+/**
+ * netplay_send_cur_input_relayed
+ *
+ * Send the current input frame to the relay, once for all of its peers.
+ */
+void netplay_send_cur_input_relayed(netplay_t *netplay);
+
 /**
  * netplay_send_raw_cmd
  *
@@ -857,6 +1051,22 @@ void netplay_send_raw_cmd_all(netplay_t *netplay,
    struct netplay_connection *except, uint32_t cmd, const void *data,
    size_t size);
 
+/**
+ * netplay_cmd_is_udp_barrier
+ *
+ * Is this a command which UDP input sent after it must not overtake? These
+ * change which frame or which players' input comes next.
+ */
+bool netplay_cmd_is_udp_barrier(uint32_t cmd);
+
+/**
+ * netplay_cmd_udp_input
+ *
+ * Tell the peer where to send UDP input datagrams, if it supports them.
+ */
+bool netplay_cmd_udp_input(netplay_t *netplay,
+   struct netplay_connection *connection);
+
 /**
  * netplay_cmd_crc
  *
@@ -917,6 +1127,157 @@ void netplay_announce_nat_traversal(netplay_t *netplay);
  */
 void netplay_init_nat_traversal(netplay_t *netplay);
 
+/***************************************************************
+ * NETPLAY-IO-THREAD.C
+ **************************************************************/
+
+#ifdef HAVE_NETPLAY_IO_THREAD
+/**
+ * netplay_io_thread_new
+ *
+ * Starts a thread to accept connections on listen_fd and read the sockets
+ * attached to it. Returns NULL if none could be started.
+ */
+struct netplay_io_thread *netplay_io_thread_new(int listen_fd, int udp_fd);
+
+/**
+ * netplay_io_thread_free
+ *
+ * Stops the thread and frees its inboxes.
+ */
+void netplay_io_thread_free(struct netplay_io_thread *t);
+
+/**
+ * netplay_io_thread_attach
+ *
+ * Has the thread read the given socket into a new inbox. Returns NULL on
+ * failure.
+ */
+struct netplay_inbox *netplay_io_thread_attach(struct netplay_io_thread *t,
+   int fd);
+
+/**
+ * netplay_io_thread_detach
+ *
+ * Stops reading the inbox's socket, closes it and frees the inbox.
+ */
+void netplay_io_thread_detach(struct netplay_io_thread *t,
+   struct netplay_inbox *inbox);
+
+/**
+ * netplay_io_thread_accept
+ *
+ * Returns a socket accepted by the thread, or -1 if there are none.
+ */
+int netplay_io_thread_accept(struct netplay_io_thread *t);
+
+/**
+ * netplay_io_thread_udp_pending
+ *
+ * Returns true if datagrams may have arrived since the last call.
+ */
+bool netplay_io_thread_udp_pending(struct netplay_io_thread *t);
+
+/**
+ * netplay_io_thread_events
+ *
+ * Returns a count which changes whenever the thread has read something.
+ */
+uint32_t netplay_io_thread_events(struct netplay_io_thread *t);
+
+/**
+ * netplay_io_thread_wait
+ *
+ * Waits up to timeout_ms for the event count to move on from since.
+ */
+void netplay_io_thread_wait(struct netplay_io_thread *t, uint32_t since,
+   unsigned timeout_ms);
+
+/**
+ * netplay_inbox_thread
+ *
+ * Returns the I/O thread filling the inbox.
+ */
+struct netplay_io_thread *netplay_inbox_thread(struct netplay_inbox *inbox);
+
+/**
+ * netplay_inbox_read
+ *
+ * Reads what the thread has received, as socket_receive_all_nonblocking.
+ */
+ssize_t netplay_inbox_read(struct netplay_inbox *inbox, bool *error,
+   void *buf, size_t len);
+#endif
+
+/***************************************************************
+ * NETPLAY-RELAY.C
+ **************************************************************/
+
+#ifdef HAVE_THREADS
+/**
+ * netplay_relay_new
+ *
+ * Starts a relay with no peers. Returns NULL if it couldn't be started.
+ */
+struct netplay_relay *netplay_relay_new(void);
+
+/**
+ * netplay_relay_free
+ *
+ * Stops the relay's thread and drops everything not yet sent.
+ */
+void netplay_relay_free(struct netplay_relay *relay);
+
+/**
+ * netplay_relay_attach
+ *
+ * Has the relay send for this connection from now on. Whatever was queued in
+ * sbuf goes first. Fails if the peer takes savestates compressed other than
+ * as the peers already relayed do.
+ */
+bool netplay_relay_attach(struct netplay_relay *relay,
+   struct socket_buffer *sbuf, int fd, uint32_t cx);
+
+/**
+ * netplay_relay_detach
+ *
+ * Takes the connection back from the relay. If flush is set, anything the
+ * relay hadn't yet sent it is queued in sbuf instead, otherwise it's dropped.
+ */
+void netplay_relay_detach(struct socket_buffer *sbuf, int fd, bool flush);
+
+/**
+ * netplay_relay_append
+ *
+ * Adds data for every relayed peer to the log.
+ */
+void netplay_relay_append(struct netplay_relay *relay, const void *buf,
+   size_t len);
+
+/**
+ * netplay_relay_skip
+ *
+ * Leaves the next len bytes added to the log out of what this peer is sent.
+ */
+bool netplay_relay_skip(struct netplay_relay_peer *peer, size_t len);
+
+/**
+ * netplay_relay_send
+ *
+ * Queues data for this peer alone, after what's in the log so far.
+ */
+bool netplay_relay_send(struct netplay_relay_peer *peer, const void *buf,
+   size_t len);
+
+/**
+ * netplay_relay_flush
+ *
+ * Sets the sender going on whatever's queued for this peer, waiting for it
+ * all to be sent if block is set. Returns false if the peer has failed.
+ */
+bool netplay_relay_flush(struct netplay_relay_peer *peer, bool block);
+#endif
+
 /***************************************************************
  * NETPLAY-KEYBOARD.C
  **************************************************************/
@@ -0,0 +1,681 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2016-2017 - Gregor Richards
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <boolean.h>
+#include <net/net_compat.h>
+#include <net/net_socket.h>
+
+#include "netplay_private.h"
+
+#ifdef HAVE_THREADS
+
+#include <rthreads/rthreads.h>
+
+/* Size of the blocks the log is kept in. Anything larger gets a block of its
+ * own. */
+#define NETPLAY_RELAY_SEGMENT_SIZE 65536
+
+/* A peer this far behind the log is given up on */
+#define NETPLAY_RELAY_MAX_LAG      (16*1024*1024)
+
+/* How long to wait before retrying a peer whose socket was full */
+#define NETPLAY_RELAY_RETRY_US     1000
+
+/* A block of the shared log */
+struct netplay_relay_segment
+{
+   struct netplay_relay_segment *next;
+   uint64_t offset; /* of data[0] in the log */
+   size_t size;
+   size_t used;
+   unsigned char *data;
+};
+
+/* Something only one peer gets, or doesn't get: either private data to send
+ * when the peer reaches offset in the log, or len bytes of the log from offset
+ * to leave out */
+struct netplay_relay_item
+{
+   struct netplay_relay_item *next;
+   uint64_t offset;
+   unsigned char *data; /* NULL for a skip */
+   size_t len;
+   size_t cap;
+   size_t sent;
+};
+
+struct netplay_relay_peer
+{
+   struct netplay_relay *relay;
+   struct netplay_relay_peer *next;
+   int fd;
+
+   /* How far into the log this peer has been sent */
+   uint64_t cursor;
+
+   struct netplay_relay_item *head, *tail;
+
+   /* The sender is writing to the socket, outside the lock */
+   bool busy;
+
+   /* The socket was full last time we tried */
+   bool blocked;
+
+   /* Being detached, so the sender should leave it alone */
+   bool closing;
+
+   /* Sending failed or the peer fell too far behind */
+   bool failed;
+};
+
+/* The output every relayed peer shares, and the thread sending it */
+struct netplay_relay
+{
+   slock_t *lock;
+
+   /* Rouses the sender */
+   scond_t *wake;
+
+   /* Signaled whenever the sender puts a peer down */
+   scond_t *idle;
+
+   sthread_t *thread;
+
+   struct netplay_relay_segment *seg_head, *seg_tail;
+   uint64_t log_end;
+
+   struct netplay_relay_peer *peers;
+
+   /* Compression of the savestates in the log, set by the first peer */
+   uint32_t cx;
+
+   bool kicked;
+   bool quit;
+};
+
+static void relay_fail_all(struct netplay_relay *relay)
+{
+   struct netplay_relay_peer *peer;
+   for (peer = relay->peers; peer; peer = peer->next)
+      peer->failed = true;
+}
+
+static void relay_pop_item(struct netplay_relay_peer *peer)
+{
+   struct netplay_relay_item *item = peer->head;
+   peer->head = item->next;
+   if (!peer->head)
+      peer->tail = NULL;
+   free(item->data);
+   free(item);
+}
+
+static struct netplay_relay_segment *relay_find_segment(
+      struct netplay_relay *relay, uint64_t offset)
+{
+   struct netplay_relay_segment *seg;
+   for (seg = relay->seg_head; seg; seg = seg->next)
+      if (offset < seg->offset + seg->used)
+         return seg;
+   return NULL;
+}
+
+/* Does this peer have anything left to send? Lock held. */
+static bool relay_peer_pending(struct netplay_relay_peer *peer)
+{
+   return peer->head || peer->cursor < peer->relay->log_end;
+}
+
+/* Send what we can to one peer. Lock held, but dropped around the sends. */
+static void relay_service_peer(struct netplay_relay *relay,
+      struct netplay_relay_peer *peer)
+{
+   peer->blocked = false;
+
+   while (!peer->failed && !peer->closing)
+   {
+      struct netplay_relay_item *item = peer->head;
+      const unsigned char *ptr;
+      size_t len;
+      ssize_t sent;
+      bool from_item = false;
+
+      if (relay->log_end - peer->cursor > NETPLAY_RELAY_MAX_LAG)
+      {
+         peer->failed = true;
+         break;
+      }
+
+      if (item && item->offset <= peer->cursor)
+      {
+         if (!item->data)
+         {
+            /* Only skip once it's all been written */
+            if (relay->log_end < item->offset + item->len)
+               break;
+            peer->cursor += item->len;
+            relay_pop_item(peer);
+            continue;
+         }
+         ptr       = item->data + item->sent;
+         len       = item->len  - item->sent;
+         from_item = true;
+      }
+      else
+      {
+         uint64_t limit = item ? item->offset : relay->log_end;
+         struct netplay_relay_segment *seg;
+
+         if (peer->cursor >= limit)
+            break;
+         seg = relay_find_segment(relay, peer->cursor);
+         if (!seg)
+            break;
+         if (limit > seg->offset + seg->used)
+            limit = seg->offset + seg->used;
+         ptr = seg->data + (size_t)(peer->cursor - seg->offset);
+         len = (size_t)(limit - peer->cursor);
+      }
+
+      /* The segment or item can't go away while we're busy with it */
+      peer->busy = true;
+      slock_unlock(relay->lock);
+      sent = socket_send_all_nonblocking(peer->fd, ptr, len, true);
+      slock_lock(relay->lock);
+      peer->busy = false;
+
+      if (sent < 0)
+      {
+         peer->failed = true;
+         break;
+      }
+
+      if (from_item)
+      {
+         item->sent += sent;
+         if (item->sent >= item->len)
+            relay_pop_item(peer);
+      }
+      else
+         peer->cursor += sent;
+
+      if ((size_t)sent < len)
+      {
+         peer->blocked = true;
+         break;
+      }
+   }
+
+   scond_broadcast(relay->idle);
+}
+
+/* Free whatever every peer has been sent. Lock held. */
+static void relay_trim(struct netplay_relay *relay)
+{
+   struct netplay_relay_peer *peer;
+   uint64_t low = relay->log_end;
+
+   for (peer = relay->peers; peer; peer = peer->next)
+      if (peer->cursor < low)
+         low = peer->cursor;
+
+   while (relay->seg_head && relay->seg_head != relay->seg_tail &&
+          relay->seg_head->offset + relay->seg_head->used <= low)
+   {
+      struct netplay_relay_segment *seg = relay->seg_head;
+      relay->seg_head = seg->next;
+      free(seg);
+   }
+}
+
+static void relay_thread(void *data)
+{
+   struct netplay_relay *relay = (struct netplay_relay*)data;
+   bool blocked                = false;
+
+   slock_lock(relay->lock);
+   while (!relay->quit)
+   {
+      struct netplay_relay_peer *peer;
+
+      if (!relay->kicked)
+      {
+         if (blocked)
+            scond_wait_timeout(relay->wake, relay->lock,
+                  NETPLAY_RELAY_RETRY_US);
+         else
+            scond_wait(relay->wake, relay->lock);
+         if (relay->quit)
+            break;
+      }
+      relay->kicked = false;
+
+      blocked = false;
+      for (peer = relay->peers; peer; peer = peer->next)
+      {
+         relay_service_peer(relay, peer);
+         if (peer->blocked)
+            blocked = true;
+      }
+
+      relay_trim(relay);
+   }
+   slock_unlock(relay->lock);
+}
+
+/* Rouse the sender. Lock held. */
+static void relay_kick(struct netplay_relay *relay)
+{
+   if (relay->kicked)
+      return;
+   relay->kicked = true;
+   scond_signal(relay->wake);
+}
+
+/* Queue data at the current end of the log for one peer. Lock held. */
+static struct netplay_relay_item *relay_push_item(
+      struct netplay_relay_peer *peer, const void *buf, size_t len)
+{
+   struct netplay_relay *relay     = peer->relay;
+   struct netplay_relay_item *tail = peer->tail;
+   struct netplay_relay_item *item;
+
+   /* Add it to the last private data if nothing's come between, unless
+    * that's being sent right now */
+   if (buf && tail && tail->data && tail->offset == relay->log_end &&
+       !(tail == peer->head && peer->busy))
+   {
+      if (tail->cap - tail->len < len)
+      {
+         size_t cap             = tail->cap * 2;
+         unsigned char *newdata;
+         while (cap - tail->len < len)
+            cap *= 2;
+         newdata = (unsigned char*)realloc(tail->data, cap);
+         if (!newdata)
+            return NULL;
+         tail->data = newdata;
+         tail->cap  = cap;
+      }
+      memcpy(tail->data + tail->len, buf, len);
+      tail->len += len;
+      return tail;
+   }
+
+   item = (struct netplay_relay_item*)calloc(1, sizeof(*item));
+   if (!item)
+      return NULL;
+   item->offset = relay->log_end;
+   item->len    = len;
+   if (buf)
+   {
+      item->cap  = len < 256 ? 256 : len;
+      item->data = (unsigned char*)malloc(item->cap);
+      if (!item->data)
+      {
+         free(item);
+         return NULL;
+      }
+      memcpy(item->data, buf, len);
+   }
+
+   if (tail)
+      tail->next = item;
+   else
+      peer->head = item;
+   peer->tail = item;
+   return item;
+}
+
+/**
+ * netplay_relay_new
+ *
+ * Starts a relay with no peers. Returns NULL if it couldn't be started.
+ */
+struct netplay_relay *netplay_relay_new(void)
+{
+   struct netplay_relay *relay =
+      (struct netplay_relay*)calloc(1, sizeof(*relay));
+   if (!relay)
+      return NULL;
+
+   relay->lock = slock_new();
+   relay->wake = scond_new();
+   relay->idle = scond_new();
+   if (!relay->lock || !relay->wake || !relay->idle)
+      goto error;
+
+   relay->thread = sthread_create(relay_thread, relay);
+   if (!relay->thread)
+      goto error;
+
+   return relay;
+
+error:
+   if (relay->idle)
+      scond_free(relay->idle);
+   if (relay->wake)
+      scond_free(relay->wake);
+   if (relay->lock)
+      slock_free(relay->lock);
+   free(relay);
+   return NULL;
+}
+
+/**
+ * netplay_relay_free
+ *
+ * Stops the relay's thread and drops everything not yet sent.
+ */
+void netplay_relay_free(struct netplay_relay *relay)
+{
+   if (!relay)
+      return;
+
+   slock_lock(relay->lock);
+   relay->quit = true;
+   scond_signal(relay->wake);
+   slock_unlock(relay->lock);
+   sthread_join(relay->thread);
+
+   while (relay->peers)
+   {
+      struct netplay_relay_peer *peer = relay->peers;
+      relay->peers = peer->next;
+      while (peer->head)
+         relay_pop_item(peer);
+      free(peer);
+   }
+   while (relay->seg_head)
+   {
+      struct netplay_relay_segment *seg = relay->seg_head;
+      relay->seg_head = seg->next;
+      free(seg);
+   }
+
+   scond_free(relay->idle);
+   scond_free(relay->wake);
+   slock_free(relay->lock);
+   free(relay);
+}
+
+/**
+ * netplay_relay_attach
+ *
+ * Has the relay send for this connection from now on. Whatever was queued in
+ * sbuf goes first. Fails if the peer takes savestates compressed other than
+ * as the peers already relayed do.
+ */
+bool netplay_relay_attach(struct netplay_relay *relay,
+   struct socket_buffer *sbuf, int fd, uint32_t cx)
+{
+   struct netplay_relay_peer *peer;
+   bool ret = false;
+
+   if (!relay || sbuf->relay)
+      return false;
+
+   peer = (struct netplay_relay_peer*)calloc(1, sizeof(*peer));
+   if (!peer)
+      return false;
+   peer->relay = relay;
+   peer->fd    = fd;
+
+   slock_lock(relay->lock);
+   if (relay->peers && relay->cx != cx)
+      goto done;
+   peer->cursor = relay->log_end;
+
+   /* Take over what's still to be sent */
+   if (sbuf->end < sbuf->start)
+   {
+      if (!relay_push_item(peer, sbuf->data + sbuf->start,
+               sbuf->bufsz - sbuf->start) ||
+          (sbuf->end && !relay_push_item(peer, sbuf->data, sbuf->end)))
+         goto done;
+   }
+   else if (sbuf->end > sbuf->start)
+   {
+      if (!relay_push_item(peer, sbuf->data + sbuf->start,
+               sbuf->end - sbuf->start))
+         goto done;
+   }
+   netplay_clear_socket_buffer(sbuf);
+
+   relay->cx    = cx;
+   peer->next   = relay->peers;
+   relay->peers = peer;
+   sbuf->relay  = peer;
+   ret          = true;
+   if (peer->head)
+      relay_kick(relay);
+
+done:
+   slock_unlock(relay->lock);
+   if (!ret)
+   {
+      while (peer->head)
+         relay_pop_item(peer);
+      free(peer);
+   }
+   return ret;
+}
+
+/**
+ * netplay_relay_detach
+ *
+ * Takes the connection back from the relay. If flush is set, anything the
+ * relay hadn't yet sent it is queued in sbuf instead, otherwise it's dropped.
+ */
+void netplay_relay_detach(struct socket_buffer *sbuf, int fd, bool flush)
+{
+   struct netplay_relay_peer *peer = sbuf->relay;
+   struct netplay_relay_peer **prev;
+   struct netplay_relay *relay;
+   unsigned char *rest = NULL;
+   size_t rest_len     = 0;
+
+   if (!peer)
+      return;
+   relay       = peer->relay;
+   sbuf->relay = NULL;
+
+   slock_lock(relay->lock);
+   peer->closing = true;
+   while (peer->busy)
+      scond_wait(relay->idle, relay->lock);
+
+   if (flush && !peer->failed)
+   {
+      /* Gather up what's left, in order */
+      size_t cap = 0;
+      struct netplay_relay_item *item;
+      for (item = peer->head; item; item = item->next)
+         cap += item->len;
+      cap += (size_t)(relay->log_end - peer->cursor);
+      rest = (unsigned char*)malloc(cap ? cap : 1);
+
+      while (rest)
+      {
+         struct netplay_relay_segment *seg;
+         uint64_t limit;
+
+         item = peer->head;
+         if (item && item->offset <= peer->cursor)
+         {
+            if (item->data)
+            {
+               memcpy(rest + rest_len, item->data + item->sent,
+                     item->len - item->sent);
+               rest_len += item->len - item->sent;
+            }
+            else
+               peer->cursor += item->len;
+            relay_pop_item(peer);
+            continue;
+         }
+
+         limit = item ? item->offset : relay->log_end;
+         if (peer->cursor >= limit)
+            break;
+         seg = relay_find_segment(relay, peer->cursor);
+         if (!seg)
+            break;
+         if (limit > seg->offset + seg->used)
+            limit = seg->offset + seg->used;
+         memcpy(rest + rest_len,
+               seg->data + (size_t)(peer->cursor - seg->offset),
+               (size_t)(limit - peer->cursor));
+         rest_len    += (size_t)(limit - peer->cursor);
+         peer->cursor = limit;
+      }
+   }
+
+   for (prev = &relay->peers; *prev; prev = &(*prev)->next)
+   {
+      if (*prev == peer)
+      {
+         *prev = peer->next;
+         break;
+      }
+   }
+   relay_trim(relay);
+   slock_unlock(relay->lock);
+
+   while (peer->head)
+      relay_pop_item(peer);
+   free(peer);
+
+   if (rest)
+   {
+      if (rest_len)
+         netplay_send(sbuf, fd, rest, rest_len);
+      free(rest);
+   }
+}
+
+/**
+ * netplay_relay_append
+ *
+ * Adds data for every relayed peer to the log.
+ */
+void netplay_relay_append(struct netplay_relay *relay, const void *buf,
+   size_t len)
+{
+   const unsigned char *src = (const unsigned char*)buf;
+   struct netplay_relay_segment *seg;
+
+   slock_lock(relay->lock);
+   if (!relay->peers)
+   {
+      slock_unlock(relay->lock);
+      return;
+   }
+
+   while (len)
+   {
+      size_t chunk;
+
+      seg = relay->seg_tail;
+      if (!seg || seg->used == seg->size)
+      {
+         size_t size = len > NETPLAY_RELAY_SEGMENT_SIZE ?
+            len : NETPLAY_RELAY_SEGMENT_SIZE;
+         seg = (struct netplay_relay_segment*)malloc(sizeof(*seg) + size);
+         if (!seg)
+         {
+            relay_fail_all(relay);
+            break;
+         }
+         seg->next   = NULL;
+         seg->offset = relay->log_end;
+         seg->size   = size;
+         seg->used   = 0;
+         seg->data   = (unsigned char*)(seg + 1);
+         if (relay->seg_tail)
+            relay->seg_tail->next = seg;
+         else
+            relay->seg_head = seg;
+         relay->seg_tail = seg;
+      }
+
+      chunk = seg->size - seg->used;
+      if (chunk > len)
+         chunk = len;
+      memcpy(seg->data + seg->used, src, chunk);
+      seg->used      += chunk;
+      relay->log_end += chunk;
+      src            += chunk;
+      len            -= chunk;
+   }
+   slock_unlock(relay->lock);
+}
+
+/**
+ * netplay_relay_skip
+ *
+ * Leaves the next len bytes added to the log out of what this peer is sent.
+ */
+bool netplay_relay_skip(struct netplay_relay_peer *peer, size_t len)
+{
+   bool ret;
+   slock_lock(peer->relay->lock);
+   ret = relay_push_item(peer, NULL, len) != NULL;
+   slock_unlock(peer->relay->lock);
+   return ret;
+}
+
+/**
+ * netplay_relay_send
+ *
+ * Queues data for this peer alone, after what's in the log so far.
+ */
+bool netplay_relay_send(struct netplay_relay_peer *peer, const void *buf,
+   size_t len)
+{
+   bool ret;
+   if (!len)
+      return true;
+   slock_lock(peer->relay->lock);
+   ret = !peer->failed && relay_push_item(peer, buf, len) != NULL;
+   slock_unlock(peer->relay->lock);
+   return ret;
+}
+
+/**
+ * netplay_relay_flush
+ *
+ * Sets the sender going on whatever's queued for this peer, waiting for it
+ * all to be sent if block is set. Returns false if the peer has failed.
+ */
+bool netplay_relay_flush(struct netplay_relay_peer *peer, bool block)
+{
+   struct netplay_relay *relay = peer->relay;
+   bool ret;
+
+   slock_lock(relay->lock);
+   if (relay_peer_pending(peer))
+      relay_kick(relay);
+   while (block && !peer->failed && relay_peer_pending(peer))
+      scond_wait(relay->idle, relay->lock);
+   ret = !peer->failed;
+   slock_unlock(relay->lock);
+   return ret;
+}
+
+#endif
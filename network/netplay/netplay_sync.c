@@ -544,6 +544,37 @@ static void netplay_handle_frame_hash(netplay_t *netplay,
    }
 }
 
+/* Next connection waiting to be accepted, or -1 */
+static int netplay_accept(netplay_t *netplay)
+{
+   fd_set fds;
+   struct timeval tmp_tv = {0};
+   struct sockaddr_storage their_addr;
+   socklen_t addr_size;
+   int new_fd;
+
+#ifdef HAVE_NETPLAY_IO_THREAD
+   if (netplay->io_thread)
+      return netplay_io_thread_accept(netplay->io_thread);
+#endif
+
+   FD_ZERO(&fds);
+   FD_SET(netplay->listen_fd, &fds);
+   if (socket_select(netplay->listen_fd + 1,
+            &fds, NULL, NULL, &tmp_tv) <= 0 ||
+       !FD_ISSET(netplay->listen_fd, &fds))
+      return -1;
+
+   addr_size = sizeof(their_addr);
+   new_fd    = accept(netplay->listen_fd,
+         (struct sockaddr*)&their_addr, &addr_size);
+
+   if (new_fd < 0)
+      RARCH_ERR("%s\n", msg_hash_to_str(MSG_NETPLAY_FAILED));
+
+   return new_fd;
+}
+
 /**
  * netplay_sync_pre_frame
  * @netplay              : pointer to netplay object
@@ -561,7 +592,9 @@ bool netplay_sync_pre_frame(netplay_t *netplay)
       serial_info.data       = netplay->buffer[netplay->run_ptr].state;
       serial_info.size       = netplay->state_size;
 
-      memset(serial_info.data, 0, serial_info.size);
+      if (!netplay->state_overwritten)
+         memset(serial_info.data, 0, serial_info.size);
+
       if ((netplay->quirks & NETPLAY_QUIRK_INITIALIZATION)
             || netplay->run_frame_count == 0)
       {
@@ -609,37 +642,19 @@ bool netplay_sync_pre_frame(netplay_t *netplay)
 
    if (netplay->is_server)
    {
-      fd_set fds;
-      struct timeval tmp_tv = {0};
       int new_fd;
-      struct sockaddr_storage their_addr;
-      socklen_t addr_size;
       struct netplay_connection *connection;
       size_t connection_num;
 
-      /* Check for a connection */
-      FD_ZERO(&fds);
-      FD_SET(netplay->listen_fd, &fds);
-      if (socket_select(netplay->listen_fd + 1,
-               &fds, NULL, NULL, &tmp_tv) > 0 &&
-          FD_ISSET(netplay->listen_fd, &fds))
+      /* Check for connections */
+      while ((new_fd = netplay_accept(netplay)) >= 0)
       {
-         addr_size = sizeof(their_addr);
-         new_fd = accept(netplay->listen_fd,
-               (struct sockaddr*)&their_addr, &addr_size);
-
-         if (new_fd < 0)
-         {
-            RARCH_ERR("%s\n", msg_hash_to_str(MSG_NETPLAY_FAILED));
-            goto process;
-         }
-
          /* Set the socket nonblocking */
          if (!socket_nonblock(new_fd))
          {
             /* Catastrophe! */
             socket_close(new_fd);
-            goto process;
+            continue;
          }
 
 #if defined(IPPROTO_TCP) && defined(TCP_NODELAY)
@@ -678,7 +693,7 @@ bool netplay_sync_pre_frame(netplay_t *netplay)
                if (!netplay->connections)
                {
                   socket_close(new_fd);
-                  goto process;
+                  continue;
                }
                netplay->connections_size = 1;
 
@@ -695,7 +710,7 @@ bool netplay_sync_pre_frame(netplay_t *netplay)
                if (!new_connections)
                {
                   socket_close(new_fd);
-                  goto process;
+                  continue;
                }
 
                memset(new_connections + netplay->connections_size, 0,
@@ -722,15 +737,18 @@ bool netplay_sync_pre_frame(netplay_t *netplay)
                netplay_deinit_socket_buffer(&connection->send_packet_buffer);
             connection->active = false;
             socket_close(new_fd);
-            goto process;
+            continue;
          }
 
-         netplay_handshake_init_send(netplay, connection);
+#ifdef HAVE_NETPLAY_IO_THREAD
+         connection->recv_packet_buffer.inbox =
+            netplay_io_thread_attach(netplay->io_thread, new_fd);
+#endif
 
+         netplay_handshake_init_send(netplay, connection);
       }
    }
 
-process:
    netplay->can_poll = true;
    input_poll_net();
 
@@ -883,7 +901,8 @@ void netplay_sync_post_frame(netplay_t *netplay, bool stalled)
          start                   = cpu_features_get_time_usec();
 
          /* Remember the current state */
-         memset(serial_info.data, 0, serial_info.size);
+         if (!netplay->state_overwritten)
+            memset(serial_info.data, 0, serial_info.size);
          core_serialize(&serial_info);
          if (netplay->replay_frame_count < netplay->unread_frame_count)
             netplay_handle_frame_hash(netplay, ptr);
@@ -911,7 +930,8 @@ void netplay_sync_post_frame(netplay_t *netplay, bool stalled)
                RARCH_LOG("INP  %X %X\n", ptr->self_state[0], ptr->real_input_state[0]);
             ptr = &netplay->buffer[netplay->replay_ptr];
             serial_info.data = ptr->state;
-            memset(serial_info.data, 0, serial_info.size);
+            if (!netplay->state_overwritten)
+               memset(serial_info.data, 0, serial_info.size);
             core_serialize(&serial_info);
             RARCH_LOG("POST %u: %X\n", netplay->replay_frame_count-1, netplay_delta_frame_crc(netplay, ptr));
          }
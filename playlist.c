@@ -27,9 +27,9 @@
 #include <compat/posix_string.h>
 #include <string/stdstring.h>
 #include <streams/interface_stream.h>
+#include <streams/file_stream.h>
 #include <file/file_path.h>
 #include <lists/string_list.h>
-#include <formats/jsonsax_full.h>
 #include <array/rbuf.h>
 
 #include "playlist.h"
@@ -64,8 +64,18 @@ struct content_playlist
 
    struct playlist_entry *entries;
 
+   /* Contents of the JSON file this playlist was
+    * read from. String fields pointing into it are
+    * owned by the arena, not by the entries */
+   char *arena;
+   size_t arena_size;
+
    playlist_config_t config;  /* size_t alignment */
 
+   /* Write-behind snapshots not yet released,
+    * see playlist_take_deferred_writes() */
+   unsigned writes_in_flight;
+
    enum playlist_label_display_mode label_display_mode;
    enum playlist_thumbnail_mode right_thumbnail_mode;
    enum playlist_thumbnail_mode left_thumbnail_mode;
@@ -75,34 +85,57 @@ struct content_playlist
    bool old_format;
    bool compressed;
    bool cached_external;
+   bool write_deferred;
 };
 
+/* Playlist JSON output is generated in a single
+ * growing buffer, which is then handed to the
+ * file stream in one write */
 typedef struct
 {
-   struct playlist_entry *current_entry;
-   char *current_meta_string;
-   char *current_items_string;
-   char **current_entry_val;
-   char **current_meta_val;
-   int *current_entry_int_val;
-   unsigned *current_entry_uint_val;
-   struct string_list **current_entry_string_list_val;
-   enum playlist_label_display_mode *current_meta_label_display_mode_val;
-   enum playlist_thumbnail_mode *current_meta_thumbnail_mode_val;
-   enum playlist_sort_mode *current_meta_sort_mode_val;
-   intfstream_t *file;
+   char *data;
+   size_t size;
+   size_t capacity;
+   bool compact;  /* Skip indentation and new lines */
+   bool error;
+} playlist_json_writer_t;
+
+/* Contents of a playlist file, generated on the
+ * main thread and written out later, possibly on
+ * another thread. 'playlist' is only set for
+ * write-behind snapshots, and is cleared if the
+ * playlist is freed before the snapshot is released */
+struct playlist_snapshot
+{
+   char *path;
+   char *data;
+   size_t size;
    playlist_t *playlist;
-   JSON_Parser parser;     /* ptr alignment */
-   JSON_Writer writer;     /* ptr alignment */
+   struct playlist_snapshot *next;
+   bool compress;
+   bool written;
+};
 
-   unsigned array_depth;
-   unsigned object_depth;
+/* Write-behind state, see playlist_write_file_deferred().
+ * Only accessed on the main thread */
+static playlist_t **playlist_deferred           = NULL;
+static playlist_snapshot_t **playlist_in_flight = NULL;
+/* Snapshots of playlists freed while queued */
+static playlist_snapshot_t *playlist_orphaned   = NULL;
+
+/* Playlist JSON input is read into a single buffer,
+ * and strings are decoded in place. The buffer is
+ * kept as the playlist string arena: decoded values
+ * are used directly as entry fields */
+typedef struct
+{
+   char *cur;
+   playlist_t *playlist;
 
-   bool in_items;
-   bool in_subsystem_roms;
    bool capacity_exceeded;
    bool out_of_memory;
-} JSONContext;
+   bool error;
+} playlist_json_parser_t;
 
 /* TODO/FIXME - global state - perhaps move outside this file */
 static playlist_t *playlist_cached = NULL;
@@ -394,33 +427,40 @@ void playlist_get_index(playlist_t *playlist,
    *entry = &playlist->entries[idx];
 }
 
+/* Frees a string field, unless it points
+ * into the playlist string arena */
+static void playlist_free_string(playlist_t *playlist, char *str)
+{
+   if (!str)
+      return;
+   if (     playlist->arena
+         && str >= playlist->arena
+         && str <  playlist->arena + playlist->arena_size)
+      return;
+   free(str);
+}
+
 /**
  * playlist_free_entry:
+ * @playlist            : Playlist handle.
  * @entry               : Playlist entry handle.
  *
  * Frees playlist entry.
  **/
-static void playlist_free_entry(struct playlist_entry *entry)
+static void playlist_free_entry(playlist_t *playlist,
+      struct playlist_entry *entry)
 {
    if (!entry)
       return;
 
-   if (entry->path)
-      free(entry->path);
-   if (entry->label)
-      free(entry->label);
-   if (entry->core_path)
-      free(entry->core_path);
-   if (entry->core_name)
-      free(entry->core_name);
-   if (entry->db_name)
-      free(entry->db_name);
-   if (entry->crc32)
-      free(entry->crc32);
-   if (entry->subsystem_ident)
-      free(entry->subsystem_ident);
-   if (entry->subsystem_name)
-      free(entry->subsystem_name);
+   playlist_free_string(playlist, entry->path);
+   playlist_free_string(playlist, entry->label);
+   playlist_free_string(playlist, entry->core_path);
+   playlist_free_string(playlist, entry->core_name);
+   playlist_free_string(playlist, entry->db_name);
+   playlist_free_string(playlist, entry->crc32);
+   playlist_free_string(playlist, entry->subsystem_ident);
+   playlist_free_string(playlist, entry->subsystem_name);
    if (entry->runtime_str)
       free(entry->runtime_str);
    if (entry->last_played_str)
@@ -474,7 +514,7 @@ void playlist_delete_index(playlist_t *playlist,
    /* Free unwanted entry */
    entry_to_delete = (struct playlist_entry *)(playlist->entries + idx);
    if (entry_to_delete)
-      playlist_free_entry(entry_to_delete);
+      playlist_free_entry(playlist, entry_to_delete);
 
    /* Shift remaining entries to fill the gap */
    memmove(playlist->entries + idx, playlist->entries + idx + 1,
@@ -590,24 +630,21 @@ void playlist_update(playlist_t *playlist, size_t idx,
 
    if (update_entry->path && (update_entry->path != entry->path))
    {
-      if (entry->path)
-         free(entry->path);
+      playlist_free_string(playlist, entry->path);
       entry->path        = strdup(update_entry->path);
       playlist->modified = true;
    }
 
    if (update_entry->label && (update_entry->label != entry->label))
    {
-      if (entry->label)
-         free(entry->label);
+      playlist_free_string(playlist, entry->label);
       entry->label       = strdup(update_entry->label);
       playlist->modified = true;
    }
 
    if (update_entry->core_path && (update_entry->core_path != entry->core_path))
    {
-      if (entry->core_path)
-         free(entry->core_path);
+      playlist_free_string(playlist, entry->core_path);
       entry->core_path   = NULL;
       entry->core_path   = strdup(update_entry->core_path);
       playlist->modified = true;
@@ -615,24 +652,21 @@ void playlist_update(playlist_t *playlist, size_t idx,
 
    if (update_entry->core_name && (update_entry->core_name != entry->core_name))
    {
-      if (entry->core_name)
-         free(entry->core_name);
+      playlist_free_string(playlist, entry->core_name);
       entry->core_name   = strdup(update_entry->core_name);
       playlist->modified = true;
    }
 
    if (update_entry->db_name && (update_entry->db_name != entry->db_name))
    {
-      if (entry->db_name)
-         free(entry->db_name);
+      playlist_free_string(playlist, entry->db_name);
       entry->db_name     = strdup(update_entry->db_name);
       playlist->modified = true;
    }
 
    if (update_entry->crc32 && (update_entry->crc32 != entry->crc32))
    {
-      if (entry->crc32)
-         free(entry->crc32);
+      playlist_free_string(playlist, entry->crc32);
       entry->crc32       = strdup(update_entry->crc32);
       playlist->modified = true;
    }
@@ -651,8 +685,7 @@ void playlist_update_runtime(playlist_t *playlist, size_t idx,
 
    if (update_entry->path && (update_entry->path != entry->path))
    {
-      if (entry->path)
-         free(entry->path);
+      playlist_free_string(playlist, entry->path);
       entry->path        = NULL;
       entry->path        = strdup(update_entry->path);
       playlist->modified = playlist->modified || register_update;
@@ -660,8 +693,7 @@ void playlist_update_runtime(playlist_t *playlist, size_t idx,
 
    if (update_entry->core_path && (update_entry->core_path != entry->core_path))
    {
-      if (entry->core_path)
-         free(entry->core_path);
+      playlist_free_string(playlist, entry->core_path);
       entry->core_path   = NULL;
       entry->core_path   = strdup(update_entry->core_path);
       playlist->modified = playlist->modified || register_update;
@@ -822,7 +854,7 @@ bool playlist_push_runtime(playlist_t *playlist,
    if (len == playlist->config.capacity)
    {
       struct playlist_entry *last_entry = &playlist->entries[len - 1];
-      playlist_free_entry(last_entry);
+      playlist_free_entry(playlist, last_entry);
       len--;
    }
    else
@@ -1110,7 +1142,7 @@ bool playlist_push(playlist_t *playlist,
    if (len == playlist->config.capacity)
    {
       struct playlist_entry *last_entry = &playlist->entries[len - 1];
-      playlist_free_entry(last_entry);
+      playlist_free_entry(playlist, last_entry);
       len--;
    }
    else
@@ -1181,1133 +1213,1666 @@ success:
    return true;
 }
 
-static JSON_Writer_HandlerResult JSONOutputHandler(JSON_Writer writer, const char *pBytes, size_t length)
+/* Ensures that 'len' more bytes fit in the output buffer.
+ * On allocation failure the writer is flagged, and all
+ * further output is dropped */
+static bool playlist_json_reserve(playlist_json_writer_t *writer,
+      size_t len)
 {
-   JSONContext *context = (JSONContext*)JSON_Writer_GetUserData(writer);
+   char *data;
+   size_t capacity;
 
-   (void)writer; /* unused */
-   return intfstream_write(context->file, pBytes, length) == length ? JSON_Writer_Continue : JSON_Writer_Abort;
-}
+   if (writer->size + len <= writer->capacity)
+      return true;
+   if (writer->error)
+      return false;
 
-static void JSONLogError(JSONContext *pCtx)
-{
-   if (pCtx->parser && JSON_Parser_GetError(pCtx->parser) != JSON_Error_AbortedByHandler)
-   {
-      JSON_Error error            = JSON_Parser_GetError(pCtx->parser);
-      JSON_Location errorLocation = { 0, 0, 0 };
+   capacity = writer->capacity ? writer->capacity : 4096;
+   while (capacity < writer->size + len)
+      capacity *= 2;
 
-      (void)JSON_Parser_GetErrorLocation(pCtx->parser, &errorLocation);
-      RARCH_WARN("Error: Invalid JSON at line %d, column %d (input byte %d) - %s.\n",
-            (int)errorLocation.line + 1,
-            (int)errorLocation.column + 1,
-            (int)errorLocation.byte,
-            JSON_ErrorString(error));
-   }
-   else if (pCtx->writer && JSON_Writer_GetError(pCtx->writer) != JSON_Error_AbortedByHandler)
+   if (!(data = (char*)realloc(writer->data, capacity)))
    {
-      RARCH_WARN("Error: could not write output - %s.\n", JSON_ErrorString(JSON_Writer_GetError(pCtx->writer)));
+      writer->error = true;
+      return false;
    }
+
+   writer->data     = data;
+   writer->capacity = capacity;
+   return true;
 }
 
-void playlist_write_runtime_file(playlist_t *playlist)
+static void playlist_json_write(playlist_json_writer_t *writer,
+      const char *str, size_t len)
 {
-   size_t i, len;
-   intfstream_t *file  = NULL;
-   JSONContext context = {0};
-
-   if (!playlist || !playlist->modified)
+   if (!playlist_json_reserve(writer, len))
       return;
+   memcpy(writer->data + writer->size, str, len);
+   writer->size += len;
+}
 
-   file = intfstream_open_file(playlist->config.path,
-         RETRO_VFS_FILE_ACCESS_WRITE, RETRO_VFS_FILE_ACCESS_HINT_NONE);
+static void playlist_json_write_new_line(playlist_json_writer_t *writer)
+{
+   if (!writer->compact)
+      playlist_json_write(writer, "\n", 1);
+}
 
-   if (!file)
-   {
-      RARCH_ERR("Failed to write to playlist file: %s\n", playlist->config.path);
+static void playlist_json_write_space(playlist_json_writer_t *writer,
+      size_t num_spaces)
+{
+   if (writer->compact || !playlist_json_reserve(writer, num_spaces))
       return;
-   }
+   memset(writer->data + writer->size, ' ', num_spaces);
+   writer->size += num_spaces;
+}
 
-   context.writer = JSON_Writer_Create(NULL);
-   context.file   = file;
+/* Writes 'c' as a \uXXXX escape sequence, or as
+ * a pair of them (UTF-16 surrogates) for codepoints
+ * outside the BMP. Returns the new output position */
+static char *playlist_json_escape_codepoint(char *out, uint32_t c)
+{
+   static const char hex_digits[] = "0123456789ABCDEF";
 
-   if (!context.writer)
+   if (c >= 0x10000)
    {
-      RARCH_ERR("Failed to create JSON writer\n");
-      goto end;
+      c   -= 0x10000;
+      out  = playlist_json_escape_codepoint(out, 0xD800 | (c >> 10));
+      c    = 0xDC00 | (c & 0x3FF);
    }
 
-   JSON_Writer_SetOutputEncoding(context.writer, JSON_UTF8);
-   JSON_Writer_SetOutputHandler(context.writer, &JSONOutputHandler);
-   JSON_Writer_SetUserData(context.writer, &context);
-
-   JSON_Writer_WriteStartObject(context.writer);
-   JSON_Writer_WriteNewLine(context.writer);
-   JSON_Writer_WriteSpace(context.writer, 2);
-   JSON_Writer_WriteString(context.writer, "version",
-         STRLEN_CONST("version"), JSON_UTF8);
-   JSON_Writer_WriteColon(context.writer);
-   JSON_Writer_WriteSpace(context.writer, 1);
-   JSON_Writer_WriteString(context.writer, "1.0",
-         STRLEN_CONST("1.0"), JSON_UTF8);
-   JSON_Writer_WriteComma(context.writer);
-   JSON_Writer_WriteNewLine(context.writer);
-   JSON_Writer_WriteSpace(context.writer, 2);
-   JSON_Writer_WriteString(context.writer, "items",
-         STRLEN_CONST("items"), JSON_UTF8);
-   JSON_Writer_WriteColon(context.writer);
-   JSON_Writer_WriteSpace(context.writer, 1);
-   JSON_Writer_WriteStartArray(context.writer);
-   JSON_Writer_WriteNewLine(context.writer);
+   out[0] = '\\';
+   out[1] = 'u';
+   out[2] = hex_digits[(c >> 12) & 0xF];
+   out[3] = hex_digits[(c >> 8)  & 0xF];
+   out[4] = hex_digits[(c >> 4)  & 0xF];
+   out[5] = hex_digits[c         & 0xF];
+   return out + 6;
+}
+
+/* Writes a quoted, escaped string (NULL is written
+ * as an empty string). Escaping follows what
+ * jsonsax_full used to produce, so that existing
+ * playlist files are regenerated byte for byte:
+ * > Quotes, backslashes and control characters
+ *   with a short form use it
+ * > Other control characters, DEL, U+2028, U+2029
+ *   and noncharacters are written as \uXXXX
+ * > Invalid UTF-8 is replaced by U+FFFD */
+static void playlist_json_write_string(playlist_json_writer_t *writer,
+      const char *str)
+{
+   char *out;
+   const unsigned char *in = (const unsigned char*)(str ? str : "");
+   size_t len              = strlen((const char*)in);
 
-   for (i = 0, len = RBUF_LEN(playlist->entries); i < len; i++)
+   /* Worst case: every input byte becomes
+    * a 6 character escape sequence */
+   if (!playlist_json_reserve(writer, len * 6 + 2))
+      return;
+
+   out    = writer->data + writer->size;
+   *out++ = '"';
+
+   while (*in)
    {
-      JSON_Writer_WriteSpace(context.writer, 4);
-      JSON_Writer_WriteStartObject(context.writer);
-
-      JSON_Writer_WriteNewLine(context.writer);
-      JSON_Writer_WriteSpace(context.writer, 6);
-      JSON_Writer_WriteString(context.writer, "path",
-            STRLEN_CONST("path"), JSON_UTF8);
-      JSON_Writer_WriteColon(context.writer);
-      JSON_Writer_WriteSpace(context.writer, 1);
-      JSON_Writer_WriteString(context.writer,
-            playlist->entries[i].path
-            ? playlist->entries[i].path
-            : "",
-            playlist->entries[i].path
-            ? strlen(playlist->entries[i].path)
-            : 0,
-            JSON_UTF8);
-      JSON_Writer_WriteComma(context.writer);
-
-      JSON_Writer_WriteNewLine(context.writer);
-      JSON_Writer_WriteSpace(context.writer, 6);
-      JSON_Writer_WriteString(context.writer, "core_path",
-            STRLEN_CONST("core_path"), JSON_UTF8);
-      JSON_Writer_WriteColon(context.writer);
-      JSON_Writer_WriteSpace(context.writer, 1);
-      JSON_Writer_WriteString(context.writer,
-            playlist->entries[i].core_path
-            ? playlist->entries[i].core_path
-            : "",
-            playlist->entries[i].core_path
-            ? strlen(playlist->entries[i].core_path)
-            : 0,
-            JSON_UTF8);
-      JSON_Writer_WriteComma(context.writer);
-      JSON_Writer_WriteNewLine(context.writer);
+      uint32_t c;
+      size_t i, seq_len;
+      unsigned char b = *in;
+
+      if (b < 0x80)
+      {
+         in++;
+
+         if (b >= 0x20 && b != '"' && b != '\\' && b != 0x7F)
+         {
+            *out++ = (char)b;
+            continue;
+         }
 
+         switch (b)
+         {
+            case '"':
+            case '\\':
+               *out++ = '\\';
+               *out++ = (char)b;
+               break;
+            case '\b':
+               *out++ = '\\';
+               *out++ = 'b';
+               break;
+            case '\t':
+               *out++ = '\\';
+               *out++ = 't';
+               break;
+            case '\n':
+               *out++ = '\\';
+               *out++ = 'n';
+               break;
+            case '\f':
+               *out++ = '\\';
+               *out++ = 'f';
+               break;
+            case '\r':
+               *out++ = '\\';
+               *out++ = 'r';
+               break;
+            default:
+               out = playlist_json_escape_codepoint(out, b);
+               break;
+         }
+         continue;
+      }
+
+      /* Multi-byte sequence */
+      if (b >= 0xC2 && b <= 0xDF)
+      {
+         seq_len = 2;
+         c       = b & 0x1F;
+      }
+      else if (b >= 0xE0 && b <= 0xEF)
+      {
+         seq_len = 3;
+         c       = b & 0x0F;
+      }
+      else if (b >= 0xF0 && b <= 0xF4)
       {
-         char tmp[32] = {0};
-
-         snprintf(tmp, sizeof(tmp), "%u", playlist->entries[i].runtime_hours);
-
-         JSON_Writer_WriteSpace(context.writer, 6);
-         JSON_Writer_WriteString(context.writer, "runtime_hours",
-               STRLEN_CONST("runtime_hours"), JSON_UTF8);
-         JSON_Writer_WriteColon(context.writer);
-         JSON_Writer_WriteSpace(context.writer, 1);
-         JSON_Writer_WriteNumber(context.writer, tmp, strlen(tmp), JSON_UTF8);
-         JSON_Writer_WriteComma(context.writer);
-         JSON_Writer_WriteNewLine(context.writer);
-
-         memset(tmp, 0, sizeof(tmp));
-
-         snprintf(tmp, sizeof(tmp), "%u", playlist->entries[i].runtime_minutes);
-
-         JSON_Writer_WriteSpace(context.writer, 6);
-         JSON_Writer_WriteString(context.writer, "runtime_minutes",
-               STRLEN_CONST("runtime_minutes"), JSON_UTF8);
-         JSON_Writer_WriteColon(context.writer);
-         JSON_Writer_WriteSpace(context.writer, 1);
-         JSON_Writer_WriteNumber(context.writer, tmp, strlen(tmp), JSON_UTF8);
-         JSON_Writer_WriteComma(context.writer);
-         JSON_Writer_WriteNewLine(context.writer);
-
-         memset(tmp, 0, sizeof(tmp));
-
-         snprintf(tmp, sizeof(tmp), "%u", playlist->entries[i].runtime_seconds);
-
-         JSON_Writer_WriteSpace(context.writer, 6);
-         JSON_Writer_WriteString(context.writer, "runtime_seconds",
-               STRLEN_CONST("runtime_seconds"), JSON_UTF8);
-         JSON_Writer_WriteColon(context.writer);
-         JSON_Writer_WriteSpace(context.writer, 1);
-         JSON_Writer_WriteNumber(context.writer, tmp, strlen(tmp), JSON_UTF8);
-         JSON_Writer_WriteComma(context.writer);
-         JSON_Writer_WriteNewLine(context.writer);
-
-         memset(tmp, 0, sizeof(tmp));
-
-         snprintf(tmp, sizeof(tmp), "%u", playlist->entries[i].last_played_year);
-
-         JSON_Writer_WriteSpace(context.writer, 6);
-         JSON_Writer_WriteString(context.writer, "last_played_year",
-               STRLEN_CONST("last_played_year"), JSON_UTF8);
-         JSON_Writer_WriteColon(context.writer);
-         JSON_Writer_WriteSpace(context.writer, 1);
-         JSON_Writer_WriteNumber(context.writer, tmp, strlen(tmp), JSON_UTF8);
-         JSON_Writer_WriteComma(context.writer);
-         JSON_Writer_WriteNewLine(context.writer);
-
-         memset(tmp, 0, sizeof(tmp));
-
-         snprintf(tmp, sizeof(tmp), "%u", playlist->entries[i].last_played_month);
-
-         JSON_Writer_WriteSpace(context.writer, 6);
-         JSON_Writer_WriteString(context.writer, "last_played_month",
-               STRLEN_CONST("last_played_month"), JSON_UTF8);
-         JSON_Writer_WriteColon(context.writer);
-         JSON_Writer_WriteSpace(context.writer, 1);
-         JSON_Writer_WriteNumber(context.writer, tmp, strlen(tmp), JSON_UTF8);
-         JSON_Writer_WriteComma(context.writer);
-         JSON_Writer_WriteNewLine(context.writer);
-
-         memset(tmp, 0, sizeof(tmp));
-
-         snprintf(tmp, sizeof(tmp), "%u", playlist->entries[i].last_played_day);
-
-         JSON_Writer_WriteSpace(context.writer, 6);
-         JSON_Writer_WriteString(context.writer, "last_played_day",
-               STRLEN_CONST("last_played_day"), JSON_UTF8);
-         JSON_Writer_WriteColon(context.writer);
-         JSON_Writer_WriteSpace(context.writer, 1);
-         JSON_Writer_WriteNumber(context.writer, tmp,
-               strlen(tmp), JSON_UTF8);
-         JSON_Writer_WriteComma(context.writer);
-         JSON_Writer_WriteNewLine(context.writer);
-
-         memset(tmp, 0, sizeof(tmp));
-
-         snprintf(tmp, sizeof(tmp), "%u", playlist->entries[i].last_played_hour);
-
-         JSON_Writer_WriteSpace(context.writer, 6);
-         JSON_Writer_WriteString(context.writer, "last_played_hour",
-               STRLEN_CONST("last_played_hour"), JSON_UTF8);
-         JSON_Writer_WriteColon(context.writer);
-         JSON_Writer_WriteSpace(context.writer, 1);
-         JSON_Writer_WriteNumber(context.writer, tmp, strlen(tmp), JSON_UTF8);
-         JSON_Writer_WriteComma(context.writer);
-         JSON_Writer_WriteNewLine(context.writer);
-
-         memset(tmp, 0, sizeof(tmp));
-
-         snprintf(tmp, sizeof(tmp), "%u", playlist->entries[i].last_played_minute);
-
-         JSON_Writer_WriteSpace(context.writer, 6);
-         JSON_Writer_WriteString(context.writer, "last_played_minute",
-               STRLEN_CONST("last_played_minute"), JSON_UTF8);
-         JSON_Writer_WriteColon(context.writer);
-         JSON_Writer_WriteSpace(context.writer, 1);
-         JSON_Writer_WriteNumber(context.writer, tmp, strlen(tmp), JSON_UTF8);
-         JSON_Writer_WriteComma(context.writer);
-         JSON_Writer_WriteNewLine(context.writer);
-
-         memset(tmp, 0, sizeof(tmp));
-
-         snprintf(tmp, sizeof(tmp), "%u", playlist->entries[i].last_played_second);
-
-         JSON_Writer_WriteSpace(context.writer, 6);
-         JSON_Writer_WriteString(context.writer, "last_played_second",
-               STRLEN_CONST("last_played_second"), JSON_UTF8);
-         JSON_Writer_WriteColon(context.writer);
-         JSON_Writer_WriteSpace(context.writer, 1);
-         JSON_Writer_WriteNumber(context.writer, tmp,
-               strlen(tmp), JSON_UTF8);
-         JSON_Writer_WriteNewLine(context.writer);
+         seq_len = 4;
+         c       = b & 0x07;
       }
+      else
+         seq_len = 0;
 
-      JSON_Writer_WriteSpace(context.writer, 4);
-      JSON_Writer_WriteEndObject(context.writer);
+      /* Note: The terminating NUL is not a continuation
+       * byte, so this never reads past the string */
+      for (i = 1; i < seq_len; i++)
+      {
+         if ((in[i] & 0xC0) != 0x80)
+         {
+            seq_len = 0;
+            break;
+         }
+         c = (c << 6) | (in[i] & 0x3F);
+      }
 
-      if (i < len - 1)
-         JSON_Writer_WriteComma(context.writer);
+      /* Reject overlong encodings, surrogates
+       * and codepoints beyond U+10FFFF */
+      if (     (seq_len == 3 && (c < 0x800 || (c >= 0xD800 && c <= 0xDFFF)))
+            || (seq_len == 4 && (c < 0x10000 || c > 0x10FFFF)))
+         seq_len = 0;
 
-      JSON_Writer_WriteNewLine(context.writer);
+      if (!seq_len)
+      {
+         out = playlist_json_escape_codepoint(out, 0xFFFD);
+         in++;
+      }
+      else if (   (c == 0x2028)
+               || (c == 0x2029)
+               || ((c & 0xFE) == 0xFE)
+               || (c >= 0xFDD0 && c <= 0xFDEF))
+      {
+         out = playlist_json_escape_codepoint(out, c);
+         in += seq_len;
+      }
+      else
+      {
+         memcpy(out, in, seq_len);
+         out += seq_len;
+         in  += seq_len;
+      }
    }
 
-   JSON_Writer_WriteSpace(context.writer, 2);
-   JSON_Writer_WriteEndArray(context.writer);
-   JSON_Writer_WriteNewLine(context.writer);
-   JSON_Writer_WriteEndObject(context.writer);
-   JSON_Writer_WriteNewLine(context.writer);
-   JSON_Writer_Free(context.writer);
+   *out++       = '"';
+   writer->size = out - writer->data;
+}
+
+static void playlist_json_write_uint(playlist_json_writer_t *writer,
+      unsigned value)
+{
+   char *out;
+   char digits[16];
+   size_t len = 0;
 
-   playlist->modified        = false;
-   playlist->old_format      = false;
-   playlist->compressed      = false;
+   do
+   {
+      digits[len++] = '0' + (value % 10);
+      value        /= 10;
+   } while (value);
 
-   RARCH_LOG("[Playlist]: Written to playlist file: %s\n", playlist->config.path);
-end:
-   intfstream_close(file);
-   free(file);
+   if (!playlist_json_reserve(writer, len))
+      return;
+
+   out           = writer->data + writer->size;
+   writer->size += len;
+
+   while (len)
+      *out++ = digits[--len];
 }
 
-/* No-op versions of JSON whitespace writers,
- * used when generating compressed output */
-static JSON_Status JSON_CALL JSON_Writer_WriteNewLine_NULL(JSON_Writer writer)
+/* Writes an indented object member name,
+ * including the colon separator */
+static void playlist_json_write_key(playlist_json_writer_t *writer,
+      size_t indent, const char *key, size_t len)
 {
-   return JSON_Success;
+   playlist_json_write_space(writer, indent);
+
+   if (playlist_json_reserve(writer, len + 3))
+   {
+      char *out = writer->data + writer->size;
+
+      out[0]    = '"';
+      memcpy(out + 1, key, len);
+      out[len + 1]  = '"';
+      out[len + 2]  = ':';
+      writer->size += len + 3;
+   }
+
+   playlist_json_write_space(writer, 1);
 }
 
-static JSON_Status JSON_CALL JSON_Writer_WriteSpace_NULL(JSON_Writer writer, size_t numberOfSpaces)
+#define PLAYLIST_JSON_WRITE_KEY(writer, indent, key) playlist_json_write_key(writer, indent, key, STRLEN_CONST(key))
+
+static void playlist_snapshot_free(playlist_snapshot_t *snapshot)
 {
-   return JSON_Success;
+   free(snapshot->path);
+   free(snapshot->data);
+   free(snapshot);
 }
 
-void playlist_write_file(playlist_t *playlist)
+/* Writes a snapshot to its playlist file. Output
+ * goes to a temporary file, which then replaces
+ * the playlist file, so that an interrupted write
+ * never leaves a truncated playlist behind */
+static bool playlist_snapshot_write(const playlist_snapshot_t *snapshot)
 {
-   size_t i, len;
+   char tmp_path[PATH_MAX_LENGTH];
    intfstream_t *file = NULL;
-   bool compressed    = false;
-
-   /* Playlist will be written if any of the
-    * following are true:
-    * > 'modified' flag is set
-    * > Current playlist format (old/new) does not
-    *   match requested
-    * > Current playlist compression status does
-    *   not match requested */
-   if (!playlist ||
-       !(playlist->modified ||
-#if defined(HAVE_ZLIB)
-        (playlist->compressed != playlist->config.compress) ||
-#endif
-        (playlist->old_format != playlist->config.old_format)))
-      return;
+   bool success       = false;
+
+   if (     strlcpy(tmp_path, snapshot->path, sizeof(tmp_path))
+                  >= sizeof(tmp_path)
+         || strlcat(tmp_path, ".tmp", sizeof(tmp_path))
+                  >= sizeof(tmp_path))
+   {
+      RARCH_ERR("Failed to write to playlist file: %s\n", snapshot->path);
+      return false;
+   }
 
 #if defined(HAVE_ZLIB)
-   if (playlist->config.compress)
-      file = intfstream_open_rzip_file(playlist->config.path,
+   if (snapshot->compress)
+      file = intfstream_open_rzip_file(tmp_path,
             RETRO_VFS_FILE_ACCESS_WRITE);
    else
 #endif
-      file = intfstream_open_file(playlist->config.path,
+      file = intfstream_open_file(tmp_path,
             RETRO_VFS_FILE_ACCESS_WRITE,
             RETRO_VFS_FILE_ACCESS_HINT_NONE);
 
    if (!file)
    {
-      RARCH_ERR("Failed to write to playlist file: %s\n", playlist->config.path);
-      return;
+      RARCH_ERR("Failed to write to playlist file: %s\n", snapshot->path);
+      return false;
    }
 
-   /* Get current file compression state */
-   compressed = intfstream_is_compressed(file);
+   success = (intfstream_write(file, snapshot->data, snapshot->size)
+         == (int64_t)snapshot->size);
 
-#ifdef RARCH_INTERNAL
-   if (playlist->config.old_format)
-   {
-      for (i = 0, len = RBUF_LEN(playlist->entries); i < len; i++)
-         intfstream_printf(file, "%s\n%s\n%s\n%s\n%s\n%s\n",
-               playlist->entries[i].path      ? playlist->entries[i].path      : "",
-               playlist->entries[i].label     ? playlist->entries[i].label     : "",
-               playlist->entries[i].core_path ? playlist->entries[i].core_path : "",
-               playlist->entries[i].core_name ? playlist->entries[i].core_name : "",
-               playlist->entries[i].crc32     ? playlist->entries[i].crc32     : "",
-               playlist->entries[i].db_name   ? playlist->entries[i].db_name   : ""
-               );
-
-      /* Add metadata lines
-       * > We add these at the end of the file to prevent
-       *   breakage if the playlist is loaded with an older
-       *   version of RetroArch */
-      intfstream_printf(
-            file,
-            "default_core_path = \"%s\"\n"
-            "default_core_name = \"%s\"\n"
-            "label_display_mode = \"%d\"\n"
-            "thumbnail_mode = \"%d|%d\"\n"
-            "sort_mode = \"%d\"\n",
-            playlist->default_core_path ? playlist->default_core_path : "",
-            playlist->default_core_name ? playlist->default_core_name : "",
-            playlist->label_display_mode,
-            playlist->right_thumbnail_mode, playlist->left_thumbnail_mode,
-            playlist->sort_mode);
+   /* Compressed output is only complete once closed */
+   if (intfstream_close(file) != 0)
+      success = false;
+   free(file);
 
-      playlist->old_format = true;
-   }
-   else
-#endif
+   if (success && filestream_rename(tmp_path, snapshot->path) != 0)
    {
-      char uint_str[4];
-      JSONContext context = {0};
-
-      /* Assign JSON whitespace functions
-      * > When compressing playlists, human readability
-      *   is not a factor - can skip all indentation
-      *   and new line characters
-      * > Create these function pointers locally to
-      *   ensure thread safety */
-      JSON_Status (JSON_CALL *json_write_new_line)(JSON_Writer writer) =
-            compressed ?
-                  JSON_Writer_WriteNewLine_NULL :
-                  JSON_Writer_WriteNewLine;
-      JSON_Status (JSON_CALL *json_write_space)(JSON_Writer writer, size_t numberOfSpaces) =
-            compressed ?
-               JSON_Writer_WriteSpace_NULL :
-               JSON_Writer_WriteSpace;
-
-      context.writer = JSON_Writer_Create(NULL);
-      context.file   = file;
-
-      if (!context.writer)
-      {
-         RARCH_ERR("Failed to create JSON writer\n");
-         goto end;
-      }
-
-      JSON_Writer_SetOutputEncoding(context.writer, JSON_UTF8);
-      JSON_Writer_SetOutputHandler(context.writer, &JSONOutputHandler);
-      JSON_Writer_SetUserData(context.writer, &context);
-
-      JSON_Writer_WriteStartObject(context.writer);
-      json_write_new_line(context.writer);
-
-      json_write_space(context.writer, 2);
-      JSON_Writer_WriteString(context.writer, "version",
-            STRLEN_CONST("version"), JSON_UTF8);
-      JSON_Writer_WriteColon(context.writer);
-      json_write_space(context.writer, 1);
-      JSON_Writer_WriteString(context.writer, "1.4",
-            STRLEN_CONST("1.4"), JSON_UTF8);
-      JSON_Writer_WriteComma(context.writer);
-      json_write_new_line(context.writer);
-
-      json_write_space(context.writer, 2);
-      JSON_Writer_WriteString(context.writer, "default_core_path",
-            STRLEN_CONST("default_core_path"), JSON_UTF8);
-      JSON_Writer_WriteColon(context.writer);
-      json_write_space(context.writer, 1);
-      JSON_Writer_WriteString(context.writer,
-            playlist->default_core_path
-            ? playlist->default_core_path
-            : "",
-            playlist->default_core_path
-            ? strlen(playlist->default_core_path)
-            : 0,
-            JSON_UTF8);
-      JSON_Writer_WriteComma(context.writer);
-      json_write_new_line(context.writer);
-
-      json_write_space(context.writer, 2);
-      JSON_Writer_WriteString(context.writer, "default_core_name",
-            STRLEN_CONST("default_core_name"), JSON_UTF8);
-      JSON_Writer_WriteColon(context.writer);
-      json_write_space(context.writer, 1);
-      JSON_Writer_WriteString(context.writer,
-            playlist->default_core_name
-            ? playlist->default_core_name
-            : "",
-            playlist->default_core_name
-            ? strlen(playlist->default_core_name)
-            : 0,
-            JSON_UTF8);
-      JSON_Writer_WriteComma(context.writer);
-      json_write_new_line(context.writer);
+#ifdef _WIN32
+      /* Renaming does not replace existing files here */
+      success =  !filestream_delete(snapshot->path)
+              && !filestream_rename(tmp_path, snapshot->path);
+#else
+      success = false;
+#endif
+   }
 
-      if (!string_is_empty(playlist->base_content_directory))
-      {
-         json_write_space(context.writer, 2);
-         JSON_Writer_WriteString(context.writer, "base_content_directory",
-            STRLEN_CONST("base_content_directory"), JSON_UTF8);
-         JSON_Writer_WriteColon(context.writer);
-         json_write_space(context.writer, 1);
-         JSON_Writer_WriteString(context.writer,
-            playlist->base_content_directory,
-            strlen(playlist->base_content_directory),
-            JSON_UTF8);
-         JSON_Writer_WriteComma(context.writer);
-         json_write_new_line(context.writer);
-      }
+   if (!success)
+   {
+      RARCH_ERR("[Playlist]: Could not write playlist file: %s\n", snapshot->path);
+      filestream_delete(tmp_path);
+      return false;
+   }
 
-      uint_str[0] = '\0';
-      snprintf(uint_str, sizeof(uint_str), "%u", playlist->label_display_mode);
-
-      json_write_space(context.writer, 2);
-      JSON_Writer_WriteString(context.writer, "label_display_mode",
-            STRLEN_CONST("label_display_mode"), JSON_UTF8);
-      JSON_Writer_WriteColon(context.writer);
-      json_write_space(context.writer, 1);
-      JSON_Writer_WriteNumber(context.writer, uint_str,
-            strlen(uint_str), JSON_UTF8);
-      JSON_Writer_WriteComma(context.writer);
-      json_write_new_line(context.writer);
-
-      uint_str[0] = '\0';
-      snprintf(uint_str, sizeof(uint_str), "%u", playlist->right_thumbnail_mode);
-
-      json_write_space(context.writer, 2);
-      JSON_Writer_WriteString(context.writer, "right_thumbnail_mode",
-            STRLEN_CONST("right_thumbnail_mode"), JSON_UTF8);
-      JSON_Writer_WriteColon(context.writer);
-      json_write_space(context.writer, 1);
-      JSON_Writer_WriteNumber(context.writer, uint_str,
-            strlen(uint_str), JSON_UTF8);
-      JSON_Writer_WriteComma(context.writer);
-      json_write_new_line(context.writer);
-
-      uint_str[0] = '\0';
-      snprintf(uint_str, sizeof(uint_str), "%u", playlist->left_thumbnail_mode);
-
-      json_write_space(context.writer, 2);
-      JSON_Writer_WriteString(context.writer, "left_thumbnail_mode",
-            STRLEN_CONST("left_thumbnail_mode"), JSON_UTF8);
-      JSON_Writer_WriteColon(context.writer);
-      json_write_space(context.writer, 1);
-      JSON_Writer_WriteNumber(context.writer, uint_str,
-            strlen(uint_str), JSON_UTF8);
-      JSON_Writer_WriteComma(context.writer);
-      json_write_new_line(context.writer);
-
-      uint_str[0] = '\0';
-      snprintf(uint_str, sizeof(uint_str), "%u", playlist->sort_mode);
-
-      json_write_space(context.writer, 2);
-      JSON_Writer_WriteString(context.writer, "sort_mode",
-            STRLEN_CONST("sort_mode"), JSON_UTF8);
-      JSON_Writer_WriteColon(context.writer);
-      json_write_space(context.writer, 1);
-      JSON_Writer_WriteNumber(context.writer, uint_str,
-            strlen(uint_str), JSON_UTF8);
-      JSON_Writer_WriteComma(context.writer);
-      json_write_new_line(context.writer);
-
-      json_write_space(context.writer, 2);
-      JSON_Writer_WriteString(context.writer, "items",
-            STRLEN_CONST("items"), JSON_UTF8);
-      JSON_Writer_WriteColon(context.writer);
-      json_write_space(context.writer, 1);
-      JSON_Writer_WriteStartArray(context.writer);
-      json_write_new_line(context.writer);
+   RARCH_LOG("[Playlist]: Written to playlist file: %s\n", snapshot->path);
+   return true;
+}
 
-      for (i = 0, len = RBUF_LEN(playlist->entries); i < len; i++)
-      {
-         json_write_space(context.writer, 4);
-         JSON_Writer_WriteStartObject(context.writer);
-
-         json_write_new_line(context.writer);
-         json_write_space(context.writer, 6);
-         JSON_Writer_WriteString(context.writer, "path",
-               STRLEN_CONST("path"), JSON_UTF8);
-         JSON_Writer_WriteColon(context.writer);
-         json_write_space(context.writer, 1);
-         JSON_Writer_WriteString(context.writer,
-               playlist->entries[i].path
-               ? playlist->entries[i].path
-               : "",
-               playlist->entries[i].path
-               ? strlen(playlist->entries[i].path)
-               : 0,
-               JSON_UTF8);
-         JSON_Writer_WriteComma(context.writer);
-
-         json_write_new_line(context.writer);
-         json_write_space(context.writer, 6);
-         JSON_Writer_WriteString(context.writer, "label",
-               STRLEN_CONST("label"), JSON_UTF8);
-         JSON_Writer_WriteColon(context.writer);
-         json_write_space(context.writer, 1);
-         JSON_Writer_WriteString(context.writer,
-               playlist->entries[i].label
-               ? playlist->entries[i].label
-               : "",
-               playlist->entries[i].label
-               ? strlen(playlist->entries[i].label)
-               : 0,
-               JSON_UTF8);
-         JSON_Writer_WriteComma(context.writer);
-
-         json_write_new_line(context.writer);
-         json_write_space(context.writer, 6);
-         JSON_Writer_WriteString(context.writer, "core_path",
-               STRLEN_CONST("core_path"), JSON_UTF8);
-         JSON_Writer_WriteColon(context.writer);
-         json_write_space(context.writer, 1);
-         JSON_Writer_WriteString(context.writer,
-               playlist->entries[i].core_path
-               ? playlist->entries[i].core_path
-               : "",
-               playlist->entries[i].core_path
-               ? strlen(playlist->entries[i].core_path)
-               : 0,
-               JSON_UTF8);
-         JSON_Writer_WriteComma(context.writer);
-
-         json_write_new_line(context.writer);
-         json_write_space(context.writer, 6);
-         JSON_Writer_WriteString(context.writer, "core_name",
-               STRLEN_CONST("core_name"), JSON_UTF8);
-         JSON_Writer_WriteColon(context.writer);
-         json_write_space(context.writer, 1);
-         JSON_Writer_WriteString(context.writer,
-               playlist->entries[i].core_name
-               ? playlist->entries[i].core_name
-               : "",
-               playlist->entries[i].core_name
-               ? strlen(playlist->entries[i].core_name)
-               : 0,
-               JSON_UTF8);
-         JSON_Writer_WriteComma(context.writer);
-
-         json_write_new_line(context.writer);
-         json_write_space(context.writer, 6);
-         JSON_Writer_WriteString(context.writer, "crc32",
-               STRLEN_CONST("crc32"), JSON_UTF8);
-         JSON_Writer_WriteColon(context.writer);
-         json_write_space(context.writer, 1);
-         JSON_Writer_WriteString(context.writer, playlist->entries[i].crc32 ? playlist->entries[i].crc32 : "",
-               playlist->entries[i].crc32
-               ? strlen(playlist->entries[i].crc32)
-               : 0,
-               JSON_UTF8);
-         JSON_Writer_WriteComma(context.writer);
-
-         json_write_new_line(context.writer);
-         json_write_space(context.writer, 6);
-         JSON_Writer_WriteString(context.writer, "db_name",
-               STRLEN_CONST("db_name"), JSON_UTF8);
-         JSON_Writer_WriteColon(context.writer);
-         json_write_space(context.writer, 1);
-         JSON_Writer_WriteString(context.writer, playlist->entries[i].db_name ? playlist->entries[i].db_name : "",
-               playlist->entries[i].db_name
-               ? strlen(playlist->entries[i].db_name)
-               : 0,
-               JSON_UTF8);
-
-         if (!string_is_empty(playlist->entries[i].subsystem_ident))
-         {
-            JSON_Writer_WriteComma(context.writer);
-            json_write_new_line(context.writer);
-            json_write_space(context.writer, 6);
-            JSON_Writer_WriteString(context.writer, "subsystem_ident",
-                  STRLEN_CONST("subsystem_ident"), JSON_UTF8);
-            JSON_Writer_WriteColon(context.writer);
-            json_write_space(context.writer, 1);
-            JSON_Writer_WriteString(context.writer, playlist->entries[i].subsystem_ident ? playlist->entries[i].subsystem_ident : "",
-                  playlist->entries[i].subsystem_ident
-                  ? strlen(playlist->entries[i].subsystem_ident)
-                  : 0,
-                  JSON_UTF8);
-         }
+void playlist_write_runtime_file(playlist_t *playlist)
+{
+   size_t i, len;
+   playlist_snapshot_t snapshot  = {0};
+   playlist_json_writer_t writer = {0};
 
-         if (!string_is_empty(playlist->entries[i].subsystem_name))
-         {
-            JSON_Writer_WriteComma(context.writer);
-            json_write_new_line(context.writer);
-            json_write_space(context.writer, 6);
-            JSON_Writer_WriteString(context.writer, "subsystem_name",
-                  STRLEN_CONST("subsystem_name"), JSON_UTF8);
-            JSON_Writer_WriteColon(context.writer);
-            json_write_space(context.writer, 1);
-            JSON_Writer_WriteString(context.writer,
-                  playlist->entries[i].subsystem_name
-                  ? playlist->entries[i].subsystem_name
-                  : "",
-                  playlist->entries[i].subsystem_name
-                  ? strlen(playlist->entries[i].subsystem_name)
-                  : 0, JSON_UTF8);
-         }
+   if (!playlist || !playlist->modified)
+      return;
 
-         if (  playlist->entries[i].subsystem_roms &&
-               playlist->entries[i].subsystem_roms->size > 0)
-         {
-            unsigned j;
-
-            JSON_Writer_WriteComma(context.writer);
-            json_write_new_line(context.writer);
-            json_write_space(context.writer, 6);
-            JSON_Writer_WriteString(context.writer, "subsystem_roms",
-                  STRLEN_CONST("subsystem_roms"), JSON_UTF8);
-            JSON_Writer_WriteColon(context.writer);
-            json_write_space(context.writer, 1);
-            JSON_Writer_WriteStartArray(context.writer);
-            json_write_new_line(context.writer);
-
-            for (j = 0; j < playlist->entries[i].subsystem_roms->size; j++)
-            {
-               const struct string_list *roms = playlist->entries[i].subsystem_roms;
-               json_write_space(context.writer, 8);
-               JSON_Writer_WriteString(context.writer,
-                     !string_is_empty(roms->elems[j].data)
-                     ? roms->elems[j].data
-                     : "",
-                     !string_is_empty(roms->elems[j].data)
-                     ? strlen(roms->elems[j].data)
-                     : 0,
-                     JSON_UTF8);
-
-               if (j < playlist->entries[i].subsystem_roms->size - 1)
-               {
-                  JSON_Writer_WriteComma(context.writer);
-                  json_write_new_line(context.writer);
-               }
-            }
+   playlist_json_write(&writer, "{", 1);
+   playlist_json_write_new_line(&writer);
+   PLAYLIST_JSON_WRITE_KEY(&writer, 2, "version");
+   playlist_json_write_string(&writer, "1.0");
+   playlist_json_write(&writer, ",", 1);
+   playlist_json_write_new_line(&writer);
+   PLAYLIST_JSON_WRITE_KEY(&writer, 2, "items");
+   playlist_json_write(&writer, "[", 1);
+   playlist_json_write_new_line(&writer);
 
-            json_write_new_line(context.writer);
-            json_write_space(context.writer, 6);
-            JSON_Writer_WriteEndArray(context.writer);
-         }
+   for (i = 0, len = RBUF_LEN(playlist->entries); i < len; i++)
+   {
+      const struct playlist_entry *entry = &playlist->entries[i];
+
+      playlist_json_write_space(&writer, 4);
+      playlist_json_write(&writer, "{", 1);
+      playlist_json_write_new_line(&writer);
+
+      PLAYLIST_JSON_WRITE_KEY(&writer, 6, "path");
+      playlist_json_write_string(&writer, entry->path);
+      playlist_json_write(&writer, ",", 1);
+      playlist_json_write_new_line(&writer);
+
+      PLAYLIST_JSON_WRITE_KEY(&writer, 6, "core_path");
+      playlist_json_write_string(&writer, entry->core_path);
+      playlist_json_write(&writer, ",", 1);
+      playlist_json_write_new_line(&writer);
+
+      PLAYLIST_JSON_WRITE_KEY(&writer, 6, "runtime_hours");
+      playlist_json_write_uint(&writer, entry->runtime_hours);
+      playlist_json_write(&writer, ",", 1);
+      playlist_json_write_new_line(&writer);
+
+      PLAYLIST_JSON_WRITE_KEY(&writer, 6, "runtime_minutes");
+      playlist_json_write_uint(&writer, entry->runtime_minutes);
+      playlist_json_write(&writer, ",", 1);
+      playlist_json_write_new_line(&writer);
+
+      PLAYLIST_JSON_WRITE_KEY(&writer, 6, "runtime_seconds");
+      playlist_json_write_uint(&writer, entry->runtime_seconds);
+      playlist_json_write(&writer, ",", 1);
+      playlist_json_write_new_line(&writer);
+
+      PLAYLIST_JSON_WRITE_KEY(&writer, 6, "last_played_year");
+      playlist_json_write_uint(&writer, entry->last_played_year);
+      playlist_json_write(&writer, ",", 1);
+      playlist_json_write_new_line(&writer);
+
+      PLAYLIST_JSON_WRITE_KEY(&writer, 6, "last_played_month");
+      playlist_json_write_uint(&writer, entry->last_played_month);
+      playlist_json_write(&writer, ",", 1);
+      playlist_json_write_new_line(&writer);
+
+      PLAYLIST_JSON_WRITE_KEY(&writer, 6, "last_played_day");
+      playlist_json_write_uint(&writer, entry->last_played_day);
+      playlist_json_write(&writer, ",", 1);
+      playlist_json_write_new_line(&writer);
+
+      PLAYLIST_JSON_WRITE_KEY(&writer, 6, "last_played_hour");
+      playlist_json_write_uint(&writer, entry->last_played_hour);
+      playlist_json_write(&writer, ",", 1);
+      playlist_json_write_new_line(&writer);
+
+      PLAYLIST_JSON_WRITE_KEY(&writer, 6, "last_played_minute");
+      playlist_json_write_uint(&writer, entry->last_played_minute);
+      playlist_json_write(&writer, ",", 1);
+      playlist_json_write_new_line(&writer);
+
+      PLAYLIST_JSON_WRITE_KEY(&writer, 6, "last_played_second");
+      playlist_json_write_uint(&writer, entry->last_played_second);
+      playlist_json_write_new_line(&writer);
+
+      playlist_json_write_space(&writer, 4);
+      playlist_json_write(&writer, "}", 1);
 
-         json_write_new_line(context.writer);
+      if (i < len - 1)
+         playlist_json_write(&writer, ",", 1);
 
-         json_write_space(context.writer, 4);
-         JSON_Writer_WriteEndObject(context.writer);
+      playlist_json_write_new_line(&writer);
+   }
 
-         if (i < len - 1)
-            JSON_Writer_WriteComma(context.writer);
+   playlist_json_write_space(&writer, 2);
+   playlist_json_write(&writer, "]", 1);
+   playlist_json_write_new_line(&writer);
+   playlist_json_write(&writer, "}", 1);
+   playlist_json_write_new_line(&writer);
 
-         json_write_new_line(context.writer);
-      }
+   if (writer.error)
+   {
+      RARCH_ERR("[Playlist]: Ran out of memory while generating JSON.\n");
+      goto end;
+   }
 
-      json_write_space(context.writer, 2);
-      JSON_Writer_WriteEndArray(context.writer);
-      json_write_new_line(context.writer);
-      JSON_Writer_WriteEndObject(context.writer);
-      json_write_new_line(context.writer);
-      JSON_Writer_Free(context.writer);
+   snapshot.path = playlist->config.path;
+   snapshot.data = writer.data;
+   snapshot.size = writer.size;
 
-      playlist->old_format = false;
+   if (playlist_snapshot_write(&snapshot))
+   {
+      playlist->modified        = false;
+      playlist->old_format      = false;
+      playlist->compressed      = false;
    }
 
-   playlist->modified   = false;
-   playlist->compressed = compressed;
-
-   RARCH_LOG("[Playlist]: Written to playlist file: %s\n", playlist->config.path);
 end:
-   intfstream_close(file);
-   free(file);
+   free(writer.data);
 }
 
-/**
- * playlist_free:
- * @playlist            : Playlist handle.
- *
- * Frees playlist handle.
- */
-void playlist_free(playlist_t *playlist)
+/* Generates the JSON representation of a playlist */
+static void playlist_json_write_playlist(playlist_json_writer_t *writer,
+      playlist_t *playlist)
 {
    size_t i, len;
 
-   if (!playlist)
-      return;
+   playlist_json_write(writer, "{", 1);
+   playlist_json_write_new_line(writer);
 
-   if (playlist->default_core_path)
-      free(playlist->default_core_path);
-   playlist->default_core_path = NULL;
+   PLAYLIST_JSON_WRITE_KEY(writer, 2, "version");
+   playlist_json_write_string(writer, "1.4");
+   playlist_json_write(writer, ",", 1);
+   playlist_json_write_new_line(writer);
 
-   if (playlist->default_core_name)
-      free(playlist->default_core_name);
-   playlist->default_core_name = NULL;
+   PLAYLIST_JSON_WRITE_KEY(writer, 2, "default_core_path");
+   playlist_json_write_string(writer, playlist->default_core_path);
+   playlist_json_write(writer, ",", 1);
+   playlist_json_write_new_line(writer);
 
-   if (playlist->base_content_directory)
-      free(playlist->base_content_directory);
-   playlist->base_content_directory = NULL;
+   PLAYLIST_JSON_WRITE_KEY(writer, 2, "default_core_name");
+   playlist_json_write_string(writer, playlist->default_core_name);
+   playlist_json_write(writer, ",", 1);
+   playlist_json_write_new_line(writer);
 
-   if (playlist->entries)
+   if (!string_is_empty(playlist->base_content_directory))
    {
-      for (i = 0, len = RBUF_LEN(playlist->entries); i < len; i++)
-      {
-         struct playlist_entry *entry = &playlist->entries[i];
+      PLAYLIST_JSON_WRITE_KEY(writer, 2, "base_content_directory");
+      playlist_json_write_string(writer, playlist->base_content_directory);
+      playlist_json_write(writer, ",", 1);
+      playlist_json_write_new_line(writer);
+   }
 
-         if (entry)
-            playlist_free_entry(entry);
-      }
+   PLAYLIST_JSON_WRITE_KEY(writer, 2, "label_display_mode");
+   playlist_json_write_uint(writer, playlist->label_display_mode);
+   playlist_json_write(writer, ",", 1);
+   playlist_json_write_new_line(writer);
 
-      RBUF_FREE(playlist->entries);
-   }
+   PLAYLIST_JSON_WRITE_KEY(writer, 2, "right_thumbnail_mode");
+   playlist_json_write_uint(writer, playlist->right_thumbnail_mode);
+   playlist_json_write(writer, ",", 1);
+   playlist_json_write_new_line(writer);
 
-   free(playlist);
-}
+   PLAYLIST_JSON_WRITE_KEY(writer, 2, "left_thumbnail_mode");
+   playlist_json_write_uint(writer, playlist->left_thumbnail_mode);
+   playlist_json_write(writer, ",", 1);
+   playlist_json_write_new_line(writer);
 
-/**
- * playlist_clear:
- * @playlist        	   : Playlist handle.
- *
- * Clears all playlist entries in playlist.
- **/
-void playlist_clear(playlist_t *playlist)
-{
-   size_t i, len;
-   if (!playlist)
-      return;
+   PLAYLIST_JSON_WRITE_KEY(writer, 2, "sort_mode");
+   playlist_json_write_uint(writer, playlist->sort_mode);
+   playlist_json_write(writer, ",", 1);
+   playlist_json_write_new_line(writer);
+
+   PLAYLIST_JSON_WRITE_KEY(writer, 2, "items");
+   playlist_json_write(writer, "[", 1);
+   playlist_json_write_new_line(writer);
 
    for (i = 0, len = RBUF_LEN(playlist->entries); i < len; i++)
    {
-      struct playlist_entry *entry = &playlist->entries[i];
+      const struct playlist_entry *entry = &playlist->entries[i];
 
-      if (entry)
-         playlist_free_entry(entry);
-   }
-   RBUF_CLEAR(playlist->entries);
-}
-
-/**
- * playlist_size:
- * @playlist        	   : Playlist handle.
- *
- * Gets size of playlist.
- * Returns: size of playlist.
- **/
-size_t playlist_size(playlist_t *playlist)
-{
-   if (!playlist)
-      return 0;
-   return RBUF_LEN(playlist->entries);
-}
+      playlist_json_write_space(writer, 4);
+      playlist_json_write(writer, "{", 1);
+      playlist_json_write_new_line(writer);
 
-/**
- * playlist_capacity:
- * @playlist        	   : Playlist handle.
- *
- * Gets maximum capacity of playlist.
- * Returns: maximum capacity of playlist.
- **/
-size_t playlist_capacity(playlist_t *playlist)
-{
-   if (!playlist)
-      return 0;
-   return playlist->config.capacity;
-}
+      PLAYLIST_JSON_WRITE_KEY(writer, 6, "path");
+      playlist_json_write_string(writer, entry->path);
+      playlist_json_write(writer, ",", 1);
+      playlist_json_write_new_line(writer);
 
-static JSON_Parser_HandlerResult JSONStartArrayHandler(JSON_Parser parser)
-{
-   JSONContext *pCtx = (JSONContext*)JSON_Parser_GetUserData(parser);
+      PLAYLIST_JSON_WRITE_KEY(writer, 6, "label");
+      playlist_json_write_string(writer, entry->label);
+      playlist_json_write(writer, ",", 1);
+      playlist_json_write_new_line(writer);
 
-   pCtx->array_depth++;
+      PLAYLIST_JSON_WRITE_KEY(writer, 6, "core_path");
+      playlist_json_write_string(writer, entry->core_path);
+      playlist_json_write(writer, ",", 1);
+      playlist_json_write_new_line(writer);
 
-   if (pCtx->object_depth == 1)
-   {
-      if (string_is_equal(pCtx->current_meta_string, "items") && pCtx->array_depth == 1)
-         pCtx->in_items = true;
-   }
-   else if (pCtx->object_depth == 2)
-   {
-      if (pCtx->array_depth == 2)
-         if (string_is_equal(pCtx->current_items_string, "subsystem_roms"))
-            pCtx->in_subsystem_roms = true;
-   }
+      PLAYLIST_JSON_WRITE_KEY(writer, 6, "core_name");
+      playlist_json_write_string(writer, entry->core_name);
+      playlist_json_write(writer, ",", 1);
+      playlist_json_write_new_line(writer);
 
-   return JSON_Parser_Continue;
-}
+      PLAYLIST_JSON_WRITE_KEY(writer, 6, "crc32");
+      playlist_json_write_string(writer, entry->crc32);
+      playlist_json_write(writer, ",", 1);
+      playlist_json_write_new_line(writer);
 
-static JSON_Parser_HandlerResult JSONEndArrayHandler(JSON_Parser parser)
-{
-   JSONContext *pCtx = (JSONContext*)JSON_Parser_GetUserData(parser);
+      PLAYLIST_JSON_WRITE_KEY(writer, 6, "db_name");
+      playlist_json_write_string(writer, entry->db_name);
 
-   retro_assert(pCtx->array_depth > 0);
+      if (!string_is_empty(entry->subsystem_ident))
+      {
+         playlist_json_write(writer, ",", 1);
+         playlist_json_write_new_line(writer);
+         PLAYLIST_JSON_WRITE_KEY(writer, 6, "subsystem_ident");
+         playlist_json_write_string(writer, entry->subsystem_ident);
+      }
 
-   pCtx->array_depth--;
+      if (!string_is_empty(entry->subsystem_name))
+      {
+         playlist_json_write(writer, ",", 1);
+         playlist_json_write_new_line(writer);
+         PLAYLIST_JSON_WRITE_KEY(writer, 6, "subsystem_name");
+         playlist_json_write_string(writer, entry->subsystem_name);
+      }
 
-   if (pCtx->object_depth == 1)
-   {
-      if (pCtx->in_items && string_is_equal(pCtx->current_meta_string, "items") && pCtx->array_depth == 0)
+      if (  entry->subsystem_roms &&
+            entry->subsystem_roms->size > 0)
       {
-         free(pCtx->current_meta_string);
-         pCtx->current_meta_string = NULL;
-         pCtx->in_items = false;
+         unsigned j;
+         const struct string_list *roms = entry->subsystem_roms;
 
-         if (pCtx->current_items_string)
+         playlist_json_write(writer, ",", 1);
+         playlist_json_write_new_line(writer);
+         PLAYLIST_JSON_WRITE_KEY(writer, 6, "subsystem_roms");
+         playlist_json_write(writer, "[", 1);
+         playlist_json_write_new_line(writer);
+
+         for (j = 0; j < roms->size; j++)
          {
-            free(pCtx->current_items_string);
-            pCtx->current_items_string = NULL;
+            playlist_json_write_space(writer, 8);
+            playlist_json_write_string(writer, roms->elems[j].data);
+
+            if (j < roms->size - 1)
+            {
+               playlist_json_write(writer, ",", 1);
+               playlist_json_write_new_line(writer);
+            }
          }
+
+         playlist_json_write_new_line(writer);
+         playlist_json_write_space(writer, 6);
+         playlist_json_write(writer, "]", 1);
       }
-   }
-   else if (pCtx->object_depth == 2)
-   {
-      if (pCtx->in_subsystem_roms && string_is_equal(pCtx->current_items_string, "subsystem_roms") && pCtx->array_depth == 1)
-         pCtx->in_subsystem_roms = false;
-   }
 
-   return JSON_Parser_Continue;
-}
+      playlist_json_write_new_line(writer);
 
-static JSON_Parser_HandlerResult JSONStartObjectHandler(JSON_Parser parser)
-{
-   JSONContext *pCtx = (JSONContext*)JSON_Parser_GetUserData(parser);
+      playlist_json_write_space(writer, 4);
+      playlist_json_write(writer, "}", 1);
 
-   pCtx->object_depth++;
+      if (i < len - 1)
+         playlist_json_write(writer, ",", 1);
+
+      playlist_json_write_new_line(writer);
+   }
+
+   playlist_json_write_space(writer, 2);
+   playlist_json_write(writer, "]", 1);
+   playlist_json_write_new_line(writer);
+   playlist_json_write(writer, "}", 1);
+   playlist_json_write_new_line(writer);
+}
 
-   if (pCtx->in_items && pCtx->object_depth == 2)
+/* Playlist will be written if any of the
+ * following are true:
+ * > 'modified' flag is set
+ * > Current playlist format (old/new) does not
+ *   match requested
+ * > Current playlist compression status does
+ *   not match requested */
+static bool playlist_needs_write(playlist_t *playlist)
+{
+   return playlist->modified ||
+#if defined(HAVE_ZLIB)
+        (playlist->compressed != playlist->config.compress) ||
+#endif
+        (playlist->old_format != playlist->config.old_format);
+}
+
+static void playlist_set_written(playlist_t *playlist,
+      const playlist_snapshot_t *snapshot)
+{
+   playlist->modified   = false;
+   playlist->compressed = snapshot->compress;
+#ifdef RARCH_INTERNAL
+   playlist->old_format = playlist->config.old_format;
+#else
+   playlist->old_format = false;
+#endif
+}
+
+#ifdef RARCH_INTERNAL
+static void playlist_old_format_write_value(
+      playlist_json_writer_t *writer, const char *value)
+{
+   if (value)
+      playlist_json_write(writer, value, strlen(value));
+}
+
+/* Generates the old (pre-JSON) representation
+ * of a playlist: six lines per entry, followed
+ * by metadata lines */
+static void playlist_old_format_write_playlist(
+      playlist_json_writer_t *writer, playlist_t *playlist)
+{
+   size_t i, len;
+
+   for (i = 0, len = RBUF_LEN(playlist->entries); i < len; i++)
    {
-      if ((pCtx->array_depth == 1) && !pCtx->capacity_exceeded)
+      const struct playlist_entry *entry = &playlist->entries[i];
+
+      playlist_old_format_write_value(writer, entry->path);
+      playlist_json_write(writer, "\n", 1);
+      playlist_old_format_write_value(writer, entry->label);
+      playlist_json_write(writer, "\n", 1);
+      playlist_old_format_write_value(writer, entry->core_path);
+      playlist_json_write(writer, "\n", 1);
+      playlist_old_format_write_value(writer, entry->core_name);
+      playlist_json_write(writer, "\n", 1);
+      playlist_old_format_write_value(writer, entry->crc32);
+      playlist_json_write(writer, "\n", 1);
+      playlist_old_format_write_value(writer, entry->db_name);
+      playlist_json_write(writer, "\n", 1);
+   }
+
+   /* Add metadata lines
+    * > We add these at the end of the file to prevent
+    *   breakage if the playlist is loaded with an older
+    *   version of RetroArch */
+   playlist_json_write(writer, "default_core_path = \"",
+         STRLEN_CONST("default_core_path = \""));
+   playlist_old_format_write_value(writer, playlist->default_core_path);
+   playlist_json_write(writer, "\"\ndefault_core_name = \"",
+         STRLEN_CONST("\"\ndefault_core_name = \""));
+   playlist_old_format_write_value(writer, playlist->default_core_name);
+   playlist_json_write(writer, "\"\nlabel_display_mode = \"",
+         STRLEN_CONST("\"\nlabel_display_mode = \""));
+   playlist_json_write_uint(writer, playlist->label_display_mode);
+   playlist_json_write(writer, "\"\nthumbnail_mode = \"",
+         STRLEN_CONST("\"\nthumbnail_mode = \""));
+   playlist_json_write_uint(writer, playlist->right_thumbnail_mode);
+   playlist_json_write(writer, "|", 1);
+   playlist_json_write_uint(writer, playlist->left_thumbnail_mode);
+   playlist_json_write(writer, "\"\nsort_mode = \"",
+         STRLEN_CONST("\"\nsort_mode = \""));
+   playlist_json_write_uint(writer, playlist->sort_mode);
+   playlist_json_write(writer, "\"\n", 2);
+}
+#endif
+
+/* Generates the file contents of a playlist, in the
+ * format and compression mode set by its config */
+static playlist_snapshot_t *playlist_snapshot_new(playlist_t *playlist)
+{
+   playlist_json_writer_t writer = {0};
+   playlist_snapshot_t *snapshot = (playlist_snapshot_t*)
+      calloc(1, sizeof(*snapshot));
+
+   if (!snapshot)
+      goto error;
+
+#if defined(HAVE_ZLIB)
+   snapshot->compress = playlist->config.compress;
+#endif
+
+#ifdef RARCH_INTERNAL
+   if (playlist->config.old_format)
+      playlist_old_format_write_playlist(&writer, playlist);
+   else
+#endif
+   {
+      /* When compressing playlists, human readability
+       * is not a factor - can skip all indentation
+       * and new line characters */
+      writer.compact = snapshot->compress;
+      playlist_json_write_playlist(&writer, playlist);
+   }
+
+   if (writer.error || !(snapshot->path = strdup(playlist->config.path)))
+      goto error;
+
+   snapshot->data = writer.data;
+   snapshot->size = writer.size;
+
+   return snapshot;
+
+error:
+   RARCH_ERR("[Playlist]: Ran out of memory while generating playlist file.\n");
+   free(writer.data);
+   free(snapshot);
+   return NULL;
+}
+
+static void playlist_write_file_now(playlist_t *playlist)
+{
+   playlist_snapshot_t *snapshot = playlist_snapshot_new(playlist);
+
+   if (!snapshot)
+      return;
+
+   if (playlist_snapshot_write(snapshot))
+      playlist_set_written(playlist, snapshot);
+
+   playlist_snapshot_free(snapshot);
+}
+
+void playlist_write_file(playlist_t *playlist)
+{
+   if (!playlist || !playlist_needs_write(playlist))
+      return;
+
+   /* A playlist with a queued or unfinished write-behind
+    * request is only written through the queue, so that
+    * an older snapshot never replaces newer contents */
+   if (playlist->write_deferred || playlist->writes_in_flight)
+      playlist_write_file_deferred(playlist);
+   else
+      playlist_write_file_now(playlist);
+}
+
+void playlist_write_file_deferred(playlist_t *playlist)
+{
+   if (     !playlist
+         ||  playlist->write_deferred
+         || !playlist_needs_write(playlist))
+      return;
+
+   if (!RBUF_TRYFIT(playlist_deferred, RBUF_LEN(playlist_deferred) + 1))
+   {
+      /* Playlist stays modified, and is picked up by
+       * the next write if one is already in flight */
+      if (!playlist->writes_in_flight)
+         playlist_write_file_now(playlist);
+      return;
+   }
+
+   RBUF_PUSH(playlist_deferred, playlist);
+   playlist->write_deferred = true;
+}
+
+bool playlist_has_deferred_writes(void)
+{
+   return RBUF_LEN(playlist_deferred) || playlist_orphaned;
+}
+
+playlist_snapshot_t *playlist_take_deferred_writes(void)
+{
+   size_t i, len;
+   playlist_snapshot_t *snapshots = playlist_orphaned;
+   playlist_snapshot_t **tail     = &snapshots;
+
+   playlist_orphaned = NULL;
+
+   while (*tail)
+      tail = &(*tail)->next;
+
+   for (i = 0, len = RBUF_LEN(playlist_deferred); i < len; i++)
+   {
+      playlist_t *playlist          = playlist_deferred[i];
+      playlist_snapshot_t *snapshot = NULL;
+
+      playlist->write_deferred      = false;
+
+      /* On failure, the playlist stays modified and
+       * is written with its next write request */
+      if (     !playlist_needs_write(playlist)
+            || !RBUF_TRYFIT(playlist_in_flight,
+                  RBUF_LEN(playlist_in_flight) + 1)
+            || !(snapshot = playlist_snapshot_new(playlist)))
+         continue;
+
+      snapshot->playlist = playlist;
+      playlist->writes_in_flight++;
+      RBUF_PUSH(playlist_in_flight, snapshot);
+
+      /* Changes made from now on need a new request */
+      playlist_set_written(playlist, snapshot);
+
+      *tail = snapshot;
+      tail  = &snapshot->next;
+   }
+
+   RBUF_FREE(playlist_deferred);
+
+   return snapshots;
+}
+
+void playlist_write_snapshots(playlist_snapshot_t *snapshots)
+{
+   for (; snapshots; snapshots = snapshots->next)
+      snapshots->written = playlist_snapshot_write(snapshots);
+}
+
+void playlist_release_snapshots(playlist_snapshot_t *snapshots)
+{
+   while (snapshots)
+   {
+      size_t i, len;
+      playlist_snapshot_t *next = snapshots->next;
+      playlist_t *playlist      = snapshots->playlist;
+
+      if (playlist)
       {
-         size_t len = RBUF_LEN(pCtx->playlist->entries);
-         if (len < pCtx->playlist->config.capacity)
-         {
-            /* Allocate memory to fit one more item but don't resize the
-             * buffer just yet, wait until JSONEndObjectHandler for that */
-            if (!RBUF_TRYFIT(pCtx->playlist->entries, len + 1))
-            {
-               pCtx->out_of_memory     = true;
-               return JSON_Parser_Abort;
-            }
-            pCtx->current_entry = &pCtx->playlist->entries[len];
-            memset(pCtx->current_entry, 0, sizeof(*pCtx->current_entry));
-         }
-         else
+         /* Keep the changes for the next write */
+         if (!snapshots->written)
+            playlist->modified = true;
+         playlist->writes_in_flight--;
+      }
+
+      for (i = 0, len = RBUF_LEN(playlist_in_flight); i < len; i++)
+      {
+         if (playlist_in_flight[i] == snapshots)
          {
-            /* Hit max item limit.
-             * Note: We can't just abort here, since there may
-             * be more metadata to read at the end of the file... */
-            RARCH_WARN("JSON file contains more entries than current playlist capacity. Excess entries will be discarded.\n");
-            pCtx->capacity_exceeded  = true;
-            pCtx->current_entry      = NULL;
-            /* In addition, since we are discarding excess entries,
-             * the playlist must be flagged as being modified
-             * (i.e. the playlist is not the same as when it was
-             * last saved to disk...) */
-            pCtx->playlist->modified = true;
+            RBUF_REMOVE(playlist_in_flight, i);
+            break;
          }
       }
+
+      playlist_snapshot_free(snapshots);
+      snapshots = next;
    }
 
-   return JSON_Parser_Continue;
+   if (!RBUF_LEN(playlist_in_flight))
+      RBUF_FREE(playlist_in_flight);
 }
 
-static JSON_Parser_HandlerResult JSONEndObjectHandler(JSON_Parser parser)
+/* Replaces the queued write of a playlist about
+ * to be freed by a snapshot of its contents */
+static void playlist_orphan_deferred_write(playlist_t *playlist)
 {
-   JSONContext *pCtx = (JSONContext*)JSON_Parser_GetUserData(parser);
+   size_t i, len;
+   playlist_snapshot_t **tail = &playlist_orphaned;
 
-   if (pCtx->in_items && pCtx->object_depth == 2)
+   for (i = 0, len = RBUF_LEN(playlist_deferred); i < len; i++)
    {
-      if ((pCtx->array_depth == 1) && !pCtx->capacity_exceeded)
-         RBUF_RESIZE(pCtx->playlist->entries,
-               RBUF_LEN(pCtx->playlist->entries) + 1);
+      if (playlist_deferred[i] == playlist)
+      {
+         RBUF_REMOVE(playlist_deferred, i);
+         break;
+      }
    }
 
-   retro_assert(pCtx->object_depth > 0);
+   playlist->write_deferred = false;
+
+   if (!playlist_needs_write(playlist))
+      return;
 
-   pCtx->object_depth--;
+   while (*tail)
+      tail = &(*tail)->next;
 
-   return JSON_Parser_Continue;
+   *tail = playlist_snapshot_new(playlist);
 }
 
-static JSON_Parser_HandlerResult JSONStringHandler(JSON_Parser parser, char *pValue, size_t length, JSON_StringAttributes attributes)
+/**
+ * playlist_free:
+ * @playlist            : Playlist handle.
+ *
+ * Frees playlist handle.
+ */
+void playlist_free(playlist_t *playlist)
 {
-   JSONContext *pCtx = (JSONContext*)JSON_Parser_GetUserData(parser);
-   (void)attributes; /* unused */
+   size_t i, len;
+
+   if (!playlist)
+      return;
 
-   if (pCtx->in_items && pCtx->in_subsystem_roms && pCtx->object_depth == 2 && pCtx->array_depth == 2)
+   /* Queued writes must not be lost, and snapshots
+    * in flight must not refer to a freed playlist */
+   if (playlist->write_deferred)
+      playlist_orphan_deferred_write(playlist);
+
+   for (i = 0, len = RBUF_LEN(playlist_in_flight);
+         playlist->writes_in_flight && i < len; i++)
    {
-      if (pCtx->current_entry_string_list_val && length && !string_is_empty(pValue))
+      if (playlist_in_flight[i]->playlist == playlist)
       {
-         union string_list_elem_attr attr = {0};
+         playlist_in_flight[i]->playlist = NULL;
+         playlist->writes_in_flight--;
+      }
+   }
+
+   playlist_free_string(playlist, playlist->default_core_path);
+   playlist->default_core_path = NULL;
+
+   playlist_free_string(playlist, playlist->default_core_name);
+   playlist->default_core_name = NULL;
 
-         if (!*pCtx->current_entry_string_list_val)
-            *pCtx->current_entry_string_list_val = string_list_new();
+   playlist_free_string(playlist, playlist->base_content_directory);
+   playlist->base_content_directory = NULL;
+
+   if (playlist->entries)
+   {
+      for (i = 0, len = RBUF_LEN(playlist->entries); i < len; i++)
+      {
+         struct playlist_entry *entry = &playlist->entries[i];
 
-         string_list_append(*pCtx->current_entry_string_list_val, pValue, attr);
+         if (entry)
+            playlist_free_entry(playlist, entry);
       }
+
+      RBUF_FREE(playlist->entries);
+   }
+
+   if (playlist->arena)
+      free(playlist->arena);
+   playlist->arena = NULL;
+
+   free(playlist);
+}
+
+/**
+ * playlist_clear:
+ * @playlist        	   : Playlist handle.
+ *
+ * Clears all playlist entries in playlist.
+ **/
+void playlist_clear(playlist_t *playlist)
+{
+   size_t i, len;
+   if (!playlist)
+      return;
+
+   for (i = 0, len = RBUF_LEN(playlist->entries); i < len; i++)
+   {
+      struct playlist_entry *entry = &playlist->entries[i];
+
+      if (entry)
+         playlist_free_entry(playlist, entry);
    }
-   else if (pCtx->in_items && pCtx->object_depth == 2)
+   RBUF_CLEAR(playlist->entries);
+}
+
+/**
+ * playlist_size:
+ * @playlist        	   : Playlist handle.
+ *
+ * Gets size of playlist.
+ * Returns: size of playlist.
+ **/
+size_t playlist_size(playlist_t *playlist)
+{
+   if (!playlist)
+      return 0;
+   return RBUF_LEN(playlist->entries);
+}
+
+/**
+ * playlist_capacity:
+ * @playlist        	   : Playlist handle.
+ *
+ * Gets maximum capacity of playlist.
+ * Returns: maximum capacity of playlist.
+ **/
+size_t playlist_capacity(playlist_t *playlist)
+{
+   if (!playlist)
+      return 0;
+   return playlist->config.capacity;
+}
+
+/* Reads the contents of a playlist file into
+ * a NUL terminated buffer. Returns NULL if
+ * memory could not be allocated */
+static char *playlist_read_json_data(intfstream_t *file, size_t *len)
+{
+   char *data;
+   size_t size       = 0;
+   int64_t file_size = intfstream_get_size(file);
+   /* Reserve one byte for the terminator, and one
+    * so that end of file is detected without having
+    * to grow the buffer */
+   size_t capacity   = (file_size > 0) ? (size_t)file_size + 2 : 4096;
+
+   if (!(data = (char*)malloc(capacity)))
+      return NULL;
+
+   for (;;)
    {
-      if (pCtx->array_depth == 1)
+      int64_t read;
+
+      if (capacity - size < 2)
       {
-         if (pCtx->current_entry_val && length && !string_is_empty(pValue))
+         char *new_data = (char*)realloc(data, capacity * 2);
+
+         if (!new_data)
          {
-            if (*pCtx->current_entry_val)
-               free(*pCtx->current_entry_val);
-            *pCtx->current_entry_val = strdup(pValue);
+            free(data);
+            return NULL;
          }
+
+         data      = new_data;
+         capacity *= 2;
       }
+
+      if ((read = intfstream_read(file, data + size,
+                  capacity - size - 1)) <= 0)
+         break;
+
+      size += (size_t)read;
    }
-   else if (pCtx->object_depth == 1)
-   {
-      if (pCtx->array_depth == 0)
-      {
-         if (pCtx->current_meta_val && length && !string_is_empty(pValue))
-         {
-            /* handle any top-level playlist metadata here */
-#if 0
-            RARCH_LOG("[Playlist]: Found meta: %s = %s\n", pCtx->current_meta_string, pValue);
-#endif
 
-            free(pCtx->current_meta_string);
-            pCtx->current_meta_string = NULL;
+   data[size] = '\0';
+   *len       = size;
+   return data;
+}
 
-            if (*pCtx->current_meta_val)
-               free(*pCtx->current_meta_val);
+/* Skips whitespace and comments.
+ * Returns the next significant character */
+static char playlist_json_skip_space(playlist_json_parser_t *parser)
+{
+   for (;;)
+   {
+      char c = *parser->cur;
+
+      if (c == ' ' || c == '\n' || c == '\r' || c == '\t')
+         parser->cur++;
+      else if (c == '/' && parser->cur[1] == '/')
+      {
+         parser->cur += 2;
+         while (*parser->cur && *parser->cur != '\n')
+            parser->cur++;
+      }
+      else if (c == '/' && parser->cur[1] == '*')
+      {
+         char *end = strstr(parser->cur + 2, "*/");
 
-            *pCtx->current_meta_val = strdup(pValue);
+         if (!end)
+         {
+            parser->error = true;
+            return '\0';
          }
+         parser->cur = end + 2;
       }
+      else
+         return c;
    }
+}
+
+static bool playlist_json_read_hex(const char *in, uint32_t *value)
+{
+   unsigned i;
+   uint32_t result = 0;
+
+   for (i = 0; i < 4; i++)
+   {
+      char c = in[i];
 
-   pCtx->current_entry_val = NULL;
-   pCtx->current_meta_val  = NULL;
+      result <<= 4;
+      if (c >= '0' && c <= '9')
+         result |= c - '0';
+      else if (c >= 'a' && c <= 'f')
+         result |= c - 'a' + 10;
+      else if (c >= 'A' && c <= 'F')
+         result |= c - 'A' + 10;
+      else
+         return false;
+   }
 
-   return JSON_Parser_Continue;
+   *value = result;
+   return true;
 }
 
-static JSON_Parser_HandlerResult JSONNumberHandler(JSON_Parser parser, char *pValue, size_t length, JSON_StringAttributes attributes)
+/* Decodes the string starting at the current
+ * position (an opening quote) in place.
+ * Returns the NUL terminated value, or NULL
+ * on error */
+static char *playlist_json_read_string(playlist_json_parser_t *parser)
 {
-   JSONContext *pCtx = (JSONContext*)JSON_Parser_GetUserData(parser);
-   (void)attributes; /* unused */
+   char *str = parser->cur + 1;
+   char *in  = str;
+   char *out;
+
+   /* Fast path: no escape sequences,
+    * the value stays where it is */
+   while (*in != '"' && *in != '\\' && *in)
+      in++;
+   out = in;
 
-   if (pCtx->in_items && pCtx->object_depth == 2)
+   /* Decoded escape sequences are never longer
+    * than their encoded form, so 'out' cannot
+    * overtake 'in' */
+   while (*in != '"')
    {
-      if (pCtx->array_depth == 1)
+      uint32_t c;
+
+      if (!*in)
       {
-         if (pCtx->current_entry_int_val && length && !string_is_empty(pValue))
-            *pCtx->current_entry_int_val = (int)strtoul(pValue, NULL, 10);
-         else if (pCtx->current_entry_uint_val && length && !string_is_empty(pValue))
-            *pCtx->current_entry_uint_val = (unsigned)strtoul(pValue, NULL, 10);
+         parser->error = true;
+         return NULL;
       }
-   }
-   else if (pCtx->object_depth == 1)
-   {
-      if (pCtx->array_depth == 0)
+
+      if (*in != '\\')
       {
-         if (pCtx->current_meta_string && length && !string_is_empty(pValue))
-         {
-            /* handle any top-level playlist metadata here */
-#if 0
-            RARCH_LOG("[Playlist]: Found meta: %s = %s\n", pCtx->current_meta_string, pValue);
-#endif
+         *out++ = *in++;
+         continue;
+      }
+
+      switch (in[1])
+      {
+         case '"':
+         case '\\':
+         case '/':
+            *out++ = in[1];
+            in    += 2;
+            continue;
+         case 'b':
+            *out++ = '\b';
+            in    += 2;
+            continue;
+         case 'f':
+            *out++ = '\f';
+            in    += 2;
+            continue;
+         case 'n':
+            *out++ = '\n';
+            in    += 2;
+            continue;
+         case 'r':
+            *out++ = '\r';
+            in    += 2;
+            continue;
+         case 't':
+            *out++ = '\t';
+            in    += 2;
+            continue;
+         case 'u':
+            if (playlist_json_read_hex(in + 2, &c))
+               break;
+            /* fall-through */
+         default:
+            parser->error = true;
+            return NULL;
+      }
+
+      in += 6;
 
-            free(pCtx->current_meta_string);
-            pCtx->current_meta_string = NULL;
+      /* UTF-16 surrogate pairs encode codepoints outside
+       * the BMP. Unpaired surrogates are replaced */
+      if (c >= 0xD800 && c <= 0xDBFF)
+      {
+         uint32_t low;
 
-            if (pCtx->current_meta_label_display_mode_val)
-               *pCtx->current_meta_label_display_mode_val = (enum playlist_label_display_mode)strtoul(pValue, NULL, 10);
-            else if (pCtx->current_meta_thumbnail_mode_val)
-               *pCtx->current_meta_thumbnail_mode_val = (enum playlist_thumbnail_mode)strtoul(pValue, NULL, 10);
-            else if (pCtx->current_meta_sort_mode_val)
-               *pCtx->current_meta_sort_mode_val = (enum playlist_sort_mode)strtoul(pValue, NULL, 10);
+         if (     in[0] == '\\'
+               && in[1] == 'u'
+               && playlist_json_read_hex(in + 2, &low)
+               && low >= 0xDC00 && low <= 0xDFFF)
+         {
+            c   = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+            in += 6;
          }
+         else
+            c   = 0xFFFD;
       }
-   }
+      else if (c >= 0xDC00 && c <= 0xDFFF)
+         c = 0xFFFD;
 
-   pCtx->current_entry_int_val               = NULL;
-   pCtx->current_entry_uint_val              = NULL;
-   pCtx->current_meta_label_display_mode_val = NULL;
-   pCtx->current_meta_thumbnail_mode_val     = NULL;
-   pCtx->current_meta_sort_mode_val          = NULL;
+      /* Encode as UTF-8 */
+      if (c < 0x80)
+         *out++ = (char)c;
+      else if (c < 0x800)
+      {
+         *out++ = (char)(0xC0 | (c >> 6));
+         *out++ = (char)(0x80 | (c & 0x3F));
+      }
+      else if (c < 0x10000)
+      {
+         *out++ = (char)(0xE0 | (c >> 12));
+         *out++ = (char)(0x80 | ((c >> 6) & 0x3F));
+         *out++ = (char)(0x80 | (c & 0x3F));
+      }
+      else
+      {
+         *out++ = (char)(0xF0 | (c >> 18));
+         *out++ = (char)(0x80 | ((c >> 12) & 0x3F));
+         *out++ = (char)(0x80 | ((c >> 6) & 0x3F));
+         *out++ = (char)(0x80 | (c & 0x3F));
+      }
+   }
 
-   return JSON_Parser_Continue;
+   *out        = '\0';
+   parser->cur = in + 1;
+   return str;
 }
 
-static JSON_Parser_HandlerResult JSONObjectMemberHandler(JSON_Parser parser, char *pValue, size_t length, JSON_StringAttributes attributes)
+/* Skips a number or literal (true, false, null...) */
+static bool playlist_json_skip_token(playlist_json_parser_t *parser)
 {
-   JSONContext *pCtx = (JSONContext*)JSON_Parser_GetUserData(parser);
-   (void)attributes; /* unused */
+   const char *start = parser->cur;
 
-   if (pCtx->in_items && pCtx->object_depth == 2)
+   for (;;)
    {
-      if (pCtx->array_depth == 1)
+      switch (*parser->cur)
       {
-         if (pCtx->current_entry_val)
-         {
-            /* something went wrong */
-            RARCH_WARN("JSON parsing failed at line %d.\n", __LINE__);
-            return JSON_Parser_Abort;
-         }
+         case '\0':
+         case ' ':
+         case '\n':
+         case '\r':
+         case '\t':
+         case ',':
+         case ':':
+         case '{':
+         case '}':
+         case '[':
+         case ']':
+         case '"':
+         case '/':
+            if (parser->cur == start)
+               parser->error = true;
+            return !parser->error;
+         default:
+            parser->cur++;
+            break;
+      }
+   }
+}
 
-         if (length)
-         {
-            if (!string_is_empty(pValue))
-            {
-               if (!string_is_empty(pCtx->current_items_string))
-                  free(pCtx->current_items_string);
-               pCtx->current_items_string = strdup(pValue);
-            }
+/* Skips a value of any type, including
+ * nested objects and arrays */
+static bool playlist_json_skip_value(playlist_json_parser_t *parser)
+{
+   unsigned depth = 0;
 
-            if (!pCtx->capacity_exceeded)
+   do
+   {
+      switch (playlist_json_skip_space(parser))
+      {
+         case '{':
+         case '[':
+            depth++;
+            parser->cur++;
+            break;
+         case '}':
+         case ']':
+            if (!depth)
             {
-               if (string_is_equal(pValue, "path"))
-                  pCtx->current_entry_val = &pCtx->current_entry->path;
-               else if (string_is_equal(pValue, "label"))
-                  pCtx->current_entry_val = &pCtx->current_entry->label;
-               else if (string_is_equal(pValue, "core_path"))
-                  pCtx->current_entry_val = &pCtx->current_entry->core_path;
-               else if (string_is_equal(pValue, "core_name"))
-                  pCtx->current_entry_val = &pCtx->current_entry->core_name;
-               else if (string_is_equal(pValue, "crc32"))
-                  pCtx->current_entry_val = &pCtx->current_entry->crc32;
-               else if (string_is_equal(pValue, "db_name"))
-                  pCtx->current_entry_val = &pCtx->current_entry->db_name;
-               else if (string_starts_with_size(pValue, "subsystem_", STRLEN_CONST("subsystem_")))
-               {
-                  if (string_is_equal(pValue, "subsystem_ident"))
-                     pCtx->current_entry_val = &pCtx->current_entry->subsystem_ident;
-                  else if (string_is_equal(pValue, "subsystem_name"))
-                     pCtx->current_entry_val = &pCtx->current_entry->subsystem_name;
-                  else if (string_is_equal(pValue, "subsystem_roms"))
-                     pCtx->current_entry_string_list_val = &pCtx->current_entry->subsystem_roms;
-               }
-               else if (string_starts_with_size(pValue, "runtime_", STRLEN_CONST("runtime_")))
-               {
-                  if (string_is_equal(pValue, "runtime_hours"))
-                     pCtx->current_entry_uint_val = &pCtx->current_entry->runtime_hours;
-                  else if (string_is_equal(pValue, "runtime_minutes"))
-                     pCtx->current_entry_uint_val = &pCtx->current_entry->runtime_minutes;
-                  else if (string_is_equal(pValue, "runtime_seconds"))
-                     pCtx->current_entry_uint_val = &pCtx->current_entry->runtime_seconds;
-               }
-               else if (string_starts_with_size(pValue, "last_played_", STRLEN_CONST("last_played_")))
-               {
-                  if (string_is_equal(pValue, "last_played_year"))
-                     pCtx->current_entry_uint_val = &pCtx->current_entry->last_played_year;
-                  else if (string_is_equal(pValue, "last_played_month"))
-                     pCtx->current_entry_uint_val = &pCtx->current_entry->last_played_month;
-                  else if (string_is_equal(pValue, "last_played_day"))
-                     pCtx->current_entry_uint_val = &pCtx->current_entry->last_played_day;
-                  else if (string_is_equal(pValue, "last_played_hour"))
-                     pCtx->current_entry_uint_val = &pCtx->current_entry->last_played_hour;
-                  else if (string_is_equal(pValue, "last_played_minute"))
-                     pCtx->current_entry_uint_val = &pCtx->current_entry->last_played_minute;
-                  else if (string_is_equal(pValue, "last_played_second"))
-                     pCtx->current_entry_uint_val = &pCtx->current_entry->last_played_second;
-               }
+               parser->error = true;
+               return false;
             }
-            else
+            depth--;
+            parser->cur++;
+            break;
+         case ',':
+         case ':':
+            if (!depth)
             {
-               pCtx->current_entry_val             = NULL;
-               pCtx->current_entry_uint_val        = NULL;
-               pCtx->current_entry_string_list_val = NULL;
+               parser->error = true;
+               return false;
             }
-         }
+            parser->cur++;
+            break;
+         case '"':
+            if (!playlist_json_read_string(parser))
+               return false;
+            break;
+         default:
+            if (!playlist_json_skip_token(parser))
+               return false;
+            break;
       }
+   } while (depth);
+
+   return true;
+}
+
+static bool playlist_json_is_number(const char *str)
+{
+   return (str[0] >= '0' && str[0] <= '9')
+      || (str[0] == '-' && str[1] >= '0' && str[1] <= '9');
+}
+
+/* Reads an unsigned number value. Like strtoul(),
+ * negative values wrap around; other literals are
+ * skipped and leave 'value' untouched */
+static bool playlist_json_read_uint(playlist_json_parser_t *parser,
+      unsigned *value)
+{
+   if (playlist_json_is_number(parser->cur))
+      *value = (unsigned)strtoul(parser->cur, NULL, 10);
+
+   return playlist_json_skip_token(parser);
+}
+
+/* Advances to the next member of an object. On success,
+ * the position is at the member value and its name is
+ * returned. Returns NULL at the end of the object, or on
+ * error (flagged in the parser) */
+static char *playlist_json_next_member(playlist_json_parser_t *parser,
+      bool *first)
+{
+   char *key;
+   char c = playlist_json_skip_space(parser);
+
+   if (!*first && c == ',')
+   {
+      parser->cur++;
+      c = playlist_json_skip_space(parser);
+   }
+   else if (c != '}' && !*first)
+      goto error;
+
+   if (c == '}')
+   {
+      parser->cur++;
+      return NULL;
    }
-   else if (pCtx->object_depth == 1)
+
+   if (c != '"' || !(key = playlist_json_read_string(parser)))
+      goto error;
+
+   if (playlist_json_skip_space(parser) != ':')
+      goto error;
+   parser->cur++;
+   playlist_json_skip_space(parser);
+
+   *first = false;
+   return key;
+
+error:
+   parser->error = true;
+   return NULL;
+}
+
+/* Advances to the next element of an array.
+ * Returns false at the end of the array,
+ * or on error (flagged in the parser) */
+static bool playlist_json_next_element(playlist_json_parser_t *parser,
+      bool *first)
+{
+   char c = playlist_json_skip_space(parser);
+
+   if (!*first && c == ',')
+   {
+      parser->cur++;
+      c = playlist_json_skip_space(parser);
+   }
+   else if (c != ']' && !*first)
    {
-      if (pCtx->array_depth == 0)
+      parser->error = true;
+      return false;
+   }
+
+   if (c == ']')
+   {
+      parser->cur++;
+      return false;
+   }
+
+   if (!c)
+   {
+      parser->error = true;
+      return false;
+   }
+
+   *first = false;
+   return true;
+}
+
+static bool playlist_json_read_subsystem_roms(
+      playlist_json_parser_t *parser, struct playlist_entry *entry)
+{
+   bool first = true;
+
+   parser->cur++;
+
+   while (playlist_json_next_element(parser, &first))
+   {
+      char *rom;
+      union string_list_elem_attr attr = {0};
+
+      if (*parser->cur != '"')
+      {
+         if (!playlist_json_skip_value(parser))
+            return false;
+         continue;
+      }
+
+      if (!(rom = playlist_json_read_string(parser)))
+         return false;
+
+      if (string_is_empty(rom))
+         continue;
+
+      if (!entry->subsystem_roms)
+         entry->subsystem_roms = string_list_new();
+
+      string_list_append(entry->subsystem_roms, rom, attr);
+   }
+
+   return !parser->error;
+}
+
+static bool playlist_json_read_entry(playlist_json_parser_t *parser,
+      struct playlist_entry *entry)
+{
+   char *key;
+   bool first = true;
+
+   parser->cur++;
+
+   while ((key = playlist_json_next_member(parser, &first)))
+   {
+      char c = *parser->cur;
+
+      if (c == '"')
       {
-         if (pCtx->current_meta_val)
+         char *value;
+         char **entry_val = NULL;
+
+         if (string_is_equal(key, "path"))
+            entry_val = &entry->path;
+         else if (string_is_equal(key, "label"))
+            entry_val = &entry->label;
+         else if (string_is_equal(key, "core_path"))
+            entry_val = &entry->core_path;
+         else if (string_is_equal(key, "core_name"))
+            entry_val = &entry->core_name;
+         else if (string_is_equal(key, "crc32"))
+            entry_val = &entry->crc32;
+         else if (string_is_equal(key, "db_name"))
+            entry_val = &entry->db_name;
+         else if (string_is_equal(key, "subsystem_ident"))
+            entry_val = &entry->subsystem_ident;
+         else if (string_is_equal(key, "subsystem_name"))
+            entry_val = &entry->subsystem_name;
+
+         if (!(value = playlist_json_read_string(parser)))
+            return false;
+
+         if (entry_val && !string_is_empty(value))
          {
-            /* something went wrong */
-            RARCH_WARN("JSON parsing failed at line %d.\n", __LINE__);
-            return JSON_Parser_Abort;
+            playlist_free_string(parser->playlist, *entry_val);
+            *entry_val = value;
          }
+      }
+      else if (c == '[' && string_is_equal(key, "subsystem_roms"))
+      {
+         if (!playlist_json_read_subsystem_roms(parser, entry))
+            return false;
+      }
+      else if (c == '[' || c == '{')
+      {
+         if (!playlist_json_skip_value(parser))
+            return false;
+      }
+      else
+      {
+         unsigned dummy;
+         unsigned *entry_uint_val = &dummy;
 
-         if (length)
+         if (string_starts_with_size(key, "runtime_",
+                  STRLEN_CONST("runtime_")))
          {
-            if (pCtx->current_meta_string)
-               free(pCtx->current_meta_string);
-            pCtx->current_meta_string = strdup(pValue);
-
-            if (string_is_equal(pValue, "default_core_path"))
-               pCtx->current_meta_val = &pCtx->playlist->default_core_path;
-            else if (string_is_equal(pValue, "default_core_name"))
-               pCtx->current_meta_val = &pCtx->playlist->default_core_name;
-            else if (string_is_equal(pValue, "label_display_mode"))
-               pCtx->current_meta_label_display_mode_val = &pCtx->playlist->label_display_mode;
-            else if (string_is_equal(pValue, "right_thumbnail_mode"))
-               pCtx->current_meta_thumbnail_mode_val = &pCtx->playlist->right_thumbnail_mode;
-            else if (string_is_equal(pValue, "left_thumbnail_mode"))
-               pCtx->current_meta_thumbnail_mode_val = &pCtx->playlist->left_thumbnail_mode;
-            else if (string_is_equal(pValue, "sort_mode"))
-               pCtx->current_meta_sort_mode_val = &pCtx->playlist->sort_mode;
-            else if (string_is_equal(pValue, "base_content_directory"))
-               pCtx->current_meta_val = &pCtx->playlist->base_content_directory;
-
+            if (string_is_equal(key, "runtime_hours"))
+               entry_uint_val = &entry->runtime_hours;
+            else if (string_is_equal(key, "runtime_minutes"))
+               entry_uint_val = &entry->runtime_minutes;
+            else if (string_is_equal(key, "runtime_seconds"))
+               entry_uint_val = &entry->runtime_seconds;
          }
+         else if (string_starts_with_size(key, "last_played_",
+                  STRLEN_CONST("last_played_")))
+         {
+            if (string_is_equal(key, "last_played_year"))
+               entry_uint_val = &entry->last_played_year;
+            else if (string_is_equal(key, "last_played_month"))
+               entry_uint_val = &entry->last_played_month;
+            else if (string_is_equal(key, "last_played_day"))
+               entry_uint_val = &entry->last_played_day;
+            else if (string_is_equal(key, "last_played_hour"))
+               entry_uint_val = &entry->last_played_hour;
+            else if (string_is_equal(key, "last_played_minute"))
+               entry_uint_val = &entry->last_played_minute;
+            else if (string_is_equal(key, "last_played_second"))
+               entry_uint_val = &entry->last_played_second;
+         }
+
+         if (!playlist_json_read_uint(parser, entry_uint_val))
+            return false;
+      }
+   }
+
+   return !parser->error;
+}
+
+static bool playlist_json_read_items(playlist_json_parser_t *parser)
+{
+   bool first           = true;
+   playlist_t *playlist = parser->playlist;
+
+   parser->cur++;
+
+   while (playlist_json_next_element(parser, &first))
+   {
+      size_t len;
+      struct playlist_entry *entry = NULL;
+
+      if (*parser->cur != '{' || parser->capacity_exceeded)
+      {
+         if (!playlist_json_skip_value(parser))
+            return false;
+         continue;
+      }
+
+      len = RBUF_LEN(playlist->entries);
+
+      if (len >= playlist->config.capacity)
+      {
+         /* Hit max item limit.
+          * Note: We can't just abort here, since there may
+          * be more metadata to read at the end of the file... */
+         RARCH_WARN("JSON file contains more entries than current playlist capacity. Excess entries will be discarded.\n");
+         parser->capacity_exceeded = true;
+         /* In addition, since we are discarding excess entries,
+          * the playlist must be flagged as being modified
+          * (i.e. the playlist is not the same as when it was
+          * last saved to disk...) */
+         playlist->modified        = true;
+
+         if (!playlist_json_skip_value(parser))
+            return false;
+         continue;
+      }
+
+      /* Allocate memory to fit one more item but don't
+       * resize the buffer until the entry is complete */
+      if (!RBUF_TRYFIT(playlist->entries, len + 1))
+      {
+         parser->out_of_memory = true;
+         return false;
       }
+
+      entry = &playlist->entries[len];
+      memset(entry, 0, sizeof(*entry));
+
+      if (!playlist_json_read_entry(parser, entry))
+      {
+         playlist_free_entry(playlist, entry);
+         return false;
+      }
+
+      RBUF_RESIZE(playlist->entries, len + 1);
+   }
+
+   return !parser->error;
+}
+
+static void playlist_json_read(playlist_json_parser_t *parser)
+{
+   char *key;
+   bool first           = true;
+   playlist_t *playlist = parser->playlist;
+
+   /* Skip UTF-8 byte order mark */
+   if (     (unsigned char)parser->cur[0] == 0xEF
+         && (unsigned char)parser->cur[1] == 0xBB
+         && (unsigned char)parser->cur[2] == 0xBF)
+      parser->cur += 3;
+
+   if (playlist_json_skip_space(parser) != '{')
+   {
+      parser->error = true;
+      return;
    }
+   parser->cur++;
+
+   while ((key = playlist_json_next_member(parser, &first)))
+   {
+      char c = *parser->cur;
+
+      if (c == '"')
+      {
+         char *value;
+         char **meta_val = NULL;
+
+         if (string_is_equal(key, "default_core_path"))
+            meta_val = &playlist->default_core_path;
+         else if (string_is_equal(key, "default_core_name"))
+            meta_val = &playlist->default_core_name;
+         else if (string_is_equal(key, "base_content_directory"))
+            meta_val = &playlist->base_content_directory;
+
+         if (!(value = playlist_json_read_string(parser)))
+            return;
+
+         if (meta_val && !string_is_empty(value))
+         {
+            playlist_free_string(playlist, *meta_val);
+            *meta_val = value;
+         }
+      }
+      else if (c == '[' && string_is_equal(key, "items"))
+      {
+         if (!playlist_json_read_items(parser))
+            return;
+      }
+      else if (c == '[' || c == '{')
+      {
+         if (!playlist_json_skip_value(parser))
+            return;
+      }
+      else
+      {
+         unsigned value = 0;
+         bool is_number = playlist_json_is_number(parser->cur);
+
+         if (!playlist_json_read_uint(parser, &value))
+            return;
+
+         if (!is_number)
+            continue;
 
-   return JSON_Parser_Continue;
+         if (string_is_equal(key, "label_display_mode"))
+            playlist->label_display_mode   = (enum playlist_label_display_mode)value;
+         else if (string_is_equal(key, "right_thumbnail_mode"))
+            playlist->right_thumbnail_mode = (enum playlist_thumbnail_mode)value;
+         else if (string_is_equal(key, "left_thumbnail_mode"))
+            playlist->left_thumbnail_mode  = (enum playlist_thumbnail_mode)value;
+         else if (string_is_equal(key, "sort_mode"))
+            playlist->sort_mode            = (enum playlist_sort_mode)value;
+      }
+   }
 }
 
 static void get_old_format_metadata_value(
@@ -2389,92 +2954,35 @@ static bool playlist_read_file(playlist_t *playlist)
 
    if (!playlist->old_format)
    {
-      JSONContext context = {0};
-      context.parser      = JSON_Parser_Create(NULL);
-      context.file        = file;
-      context.playlist    = playlist;
+      playlist_json_parser_t parser = {0};
+      size_t size                   = 0;
+      char *data                    = playlist_read_json_data(file, &size);
 
-      if (!context.parser)
+      if (!data)
       {
-         RARCH_ERR("Failed to create JSON parser\n");
+         RARCH_WARN("Ran out of memory while parsing JSON playlist\n");
+         res = false;
          goto end;
       }
 
-#if 0
-      JSON_Parser_SetTrackObjectMembers(context.parser, JSON_True);
-#endif
-      JSON_Parser_SetAllowBOM(context.parser, JSON_True);
-      JSON_Parser_SetAllowComments(context.parser, JSON_True);
-      JSON_Parser_SetAllowSpecialNumbers(context.parser, JSON_True);
-      JSON_Parser_SetAllowHexNumbers(context.parser, JSON_True);
-      JSON_Parser_SetAllowUnescapedControlCharacters(context.parser, JSON_True);
-      JSON_Parser_SetReplaceInvalidEncodingSequences(context.parser, JSON_True);
-
-#if 0
-      JSON_Parser_SetNullHandler(context.parser,          &JSONNullHandler);
-      JSON_Parser_SetBooleanHandler(context.parser,       &JSONBooleanHandler);
-      JSON_Parser_SetSpecialNumberHandler(context.parser, &JSONSpecialNumberHandler);
-      JSON_Parser_SetArrayItemHandler(context.parser,     &JSONArrayItemHandler);
-#endif
-
-      JSON_Parser_SetNumberHandler(context.parser,        &JSONNumberHandler);
-      JSON_Parser_SetStringHandler(context.parser,        &JSONStringHandler);
-      JSON_Parser_SetStartObjectHandler(context.parser,   &JSONStartObjectHandler);
-      JSON_Parser_SetEndObjectHandler(context.parser,     &JSONEndObjectHandler);
-      JSON_Parser_SetObjectMemberHandler(context.parser,  &JSONObjectMemberHandler);
-      JSON_Parser_SetStartArrayHandler(context.parser,    &JSONStartArrayHandler);
-      JSON_Parser_SetEndArrayHandler(context.parser,      &JSONEndArrayHandler);
-      JSON_Parser_SetUserData(context.parser, &context);
+      /* The file contents become the string arena,
+       * see playlist_json_parser_t */
+      playlist->arena      = data;
+      playlist->arena_size = size + 1;
 
-      while (!intfstream_eof(file))
-      {
-         char chunk[4096] = {0};
-         int64_t length = intfstream_read(file, chunk, sizeof(chunk));
+      parser.cur           = data;
+      parser.playlist      = playlist;
 
-         if (!length && !intfstream_eof(file))
-         {
-            RARCH_WARN("Could not read JSON input.\n");
-            goto json_cleanup;
-         }
-
-         if (!JSON_Parser_Parse(context.parser, chunk,
-                  (size_t)length, JSON_False))
-         {
-            if (context.out_of_memory)
-            {
-               RARCH_WARN("Ran out of memory while parsing JSON playlist\n");
-               res = false;
-               goto json_cleanup;
-            }
-            /* Note: Chunk may not be null-terminated.
-             * It is therefore dangerous to print its contents.
-             * Setting a size limit here mitigates the issue, but
-             * in general this is not good practice...
-             * Addendum: RARCH_WARN() actually limits the printed
-             * buffer size anyway, so this warning message is most
-             * likely worthless... */
-            RARCH_WARN("Error parsing chunk:\n---snip---\n%.*s\n---snip---\n", 4096, chunk);
-            JSONLogError(&context);
-            goto json_cleanup;
-         }
-      }
+      playlist_json_read(&parser);
 
-      if (!JSON_Parser_Parse(context.parser, NULL, 0, JSON_True))
+      if (parser.out_of_memory)
       {
-         RARCH_WARN("Error parsing JSON.\n");
-         JSONLogError(&context);
-         goto json_cleanup;
+         RARCH_WARN("Ran out of memory while parsing JSON playlist\n");
+         res = false;
       }
-
-json_cleanup:
-
-      JSON_Parser_Free(context.parser);
-
-      if (context.current_meta_string)
-         free(context.current_meta_string);
-
-      if (context.current_items_string)
-         free(context.current_items_string);
+      else if (parser.error)
+         RARCH_WARN("Error: Invalid JSON at input byte %d.\n",
+               (int)(parser.cur - data));
    }
    else
    {
@@ -2732,10 +3240,14 @@ playlist_t *playlist_init(const playlist_config_t *config)
    playlist->old_format             = false;
    playlist->compressed             = false;
    playlist->cached_external        = false;
+   playlist->write_deferred         = false;
+   playlist->writes_in_flight       = 0;
    playlist->default_core_name      = NULL;
    playlist->default_core_path      = NULL;
    playlist->base_content_directory = NULL;
    playlist->entries                = NULL;
+   playlist->arena                  = NULL;
+   playlist->arena_size             = 0;
    playlist->label_display_mode     = LABEL_DISPLAY_MODE_DEFAULT;
    playlist->right_thumbnail_mode   = PLAYLIST_THUMBNAIL_MODE_DEFAULT;
    playlist->left_thumbnail_mode    = PLAYLIST_THUMBNAIL_MODE_DEFAULT;
@@ -2772,7 +3284,7 @@ playlist_t *playlist_init(const playlist_config_t *config)
                playlist->base_content_directory, playlist->config.base_content_directory,
                sizeof(tmp_entry_path));
 
-            free(entry->path);
+            playlist_free_string(playlist, entry->path);
             entry->path = strdup(tmp_entry_path);
 
             /* Fix subsystem roms paths*/
@@ -2806,8 +3318,7 @@ playlist_t *playlist_init(const playlist_config_t *config)
       }
 
       /* Update playlist base content directory*/
-      if (playlist->base_content_directory)
-         free(playlist->base_content_directory);
+      playlist_free_string(playlist, playlist->base_content_directory);
       playlist->base_content_directory = strdup(playlist->config.base_content_directory);
 
       /* Save playlist */
@@ -3104,8 +3615,7 @@ void playlist_set_default_core_path(playlist_t *playlist, const char *core_path)
 
    if (!string_is_equal(playlist->default_core_path, real_core_path))
    {
-      if (playlist->default_core_path)
-         free(playlist->default_core_path);
+      playlist_free_string(playlist, playlist->default_core_path);
       playlist->default_core_path = strdup(real_core_path);
       playlist->modified = true;
    }
@@ -3119,8 +3629,7 @@ void playlist_set_default_core_name(
 
    if (!string_is_equal(playlist->default_core_name, core_name))
    {
-      if (playlist->default_core_name)
-         free(playlist->default_core_name);
+      playlist_free_string(playlist, playlist->default_core_name);
       playlist->default_core_name = strdup(core_name);
       playlist->modified = true;
    }
@@ -32,6 +32,7 @@ RETRO_BEGIN_DECLS
 #define COLLECTION_SIZE 0x7FFFFFFF
 
 typedef struct content_playlist playlist_t;
+typedef struct playlist_snapshot playlist_snapshot_t;
 
 enum playlist_runtime_status
 {
@@ -275,6 +276,32 @@ void playlist_write_file(playlist_t *playlist);
 
 void playlist_write_runtime_file(playlist_t *playlist);
 
+/* Write-behind playlist persistence
+ * > playlist_write_file_deferred() queues the write
+ *   of a modified playlist instead of performing it.
+ *   Changes made before the queue is taken are
+ *   included in the write
+ * > playlist_take_deferred_writes() snapshots all
+ *   queued playlists. The snapshots may be written
+ *   on any thread with playlist_write_snapshots(),
+ *   and must then be released on the main thread
+ *   with playlist_release_snapshots()
+ * > Playlists freed while queued are snapshotted
+ *   first, so no change is lost
+ * > Except for playlist_write_snapshots(), these
+ *   must only be called on the main thread. Taking
+ *   the queue is left to the caller (see
+ *   task_push_playlist_write()) */
+void playlist_write_file_deferred(playlist_t *playlist);
+
+bool playlist_has_deferred_writes(void);
+
+playlist_snapshot_t *playlist_take_deferred_writes(void);
+
+void playlist_write_snapshots(playlist_snapshot_t *snapshots);
+
+void playlist_release_snapshots(playlist_snapshot_t *snapshots);
+
 void playlist_qsort(playlist_t *playlist);
 
 void playlist_free_cached(void);
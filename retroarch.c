@@ -195,6 +195,7 @@
 
 #ifdef HAVE_THREADS
 #include <rthreads/rthreads.h>
+#include <rthreads/tpool.h>
 #endif
 
 #if defined(HAVE_OPENGL)
@@ -1487,6 +1488,13 @@ static const camera_driver_t *camera_drivers[] = {
 #define MENU_MAX_AXES              32
 #define MENU_MAX_HATS              4
 #define MENU_MAX_MBUTTONS          32 /* Enough to cover largest libretro constant*/
+
+/* Slot counts of the shared sublabel/title caches.
+ * Must be powers of 2; consecutive entries of a list
+ * never share a sublabel slot within a window this size. */
+#define MENU_SUBLABEL_CACHE_SIZE   64
+#define MENU_TITLE_CACHE_SIZE      16
+#define MENU_TITLE_MAX_LENGTH      512
 #endif
 
 /* Descriptive names for options without short variant.
@@ -1819,9 +1827,24 @@ struct menu_state
       rarch_setting_t *list_settings;
       menu_list_t *list;
       size_t begin;
+      uint32_t cache_id;
+      /* See menu_entries_set_deferred() */
+      bool deferred;
    } entries;
    size_t   selection_ptr;
 
+   /* Sublabels and titles that their callbacks reported
+    * as static, keyed by the cache id of the entry.
+    * Only recently displayed entries need these, so they
+    * are kept here rather than inside every entry */
+   struct
+   {
+      uint32_t sublabel_id[MENU_SUBLABEL_CACHE_SIZE];
+      uint32_t title_id[MENU_TITLE_CACHE_SIZE];
+      char sublabel[MENU_SUBLABEL_CACHE_SIZE][MENU_SUBLABEL_MAX_LENGTH];
+      char title[MENU_TITLE_CACHE_SIZE][MENU_TITLE_MAX_LENGTH];
+   } cache;
+
    /* Quick jumping indices with L/R.
     * Rebuilt when parsing directory. */
    struct
@@ -4624,10 +4647,8 @@ static int generic_menu_iterate(
          {
             file_list_t *selection_buf = menu_entries_get_selection_buf_ptr(0);
             size_t selection           = menu_st->selection_ptr;
-            menu_file_list_cbs_t *cbs  = selection_buf ?
-               (menu_file_list_cbs_t*)
-               file_list_get_actiondata_at_offset(selection_buf, selection)
-               : NULL;
+            menu_file_list_cbs_t *cbs  =
+               menu_entries_get_actiondata(selection_buf, selection);
 
             if (cbs && cbs->enum_idx != MSG_UNKNOWN)
             {
@@ -4872,8 +4893,8 @@ int generic_menu_entry_action(
    int ret                     = 0;
    struct rarch_state *p_rarch = &rarch_st;
    file_list_t *selection_buf  = menu_entries_get_selection_buf_ptr(0);
-   menu_file_list_cbs_t *cbs   = selection_buf ?
-      (menu_file_list_cbs_t*)selection_buf->list[i].actiondata : NULL;
+   menu_file_list_cbs_t *cbs   =
+      menu_entries_get_actiondata(selection_buf, i);
 
    switch (action)
    {
@@ -4935,8 +4956,7 @@ int generic_menu_entry_action(
          break;
    }
 
-   cbs = selection_buf ? (menu_file_list_cbs_t*)
-      selection_buf->list[i].actiondata : NULL;
+   cbs = menu_entries_get_actiondata(selection_buf, i);
 
    if (cbs && cbs->action_refresh)
    {
@@ -5142,6 +5162,93 @@ void menu_navigation_set_selection(size_t val)
 }
 
 
+static uint32_t menu_entries_next_cache_id(struct menu_state *menu_st)
+{
+   /* 0 marks an unused cache slot */
+   if (++menu_st->entries.cache_id == 0)
+      menu_st->entries.cache_id = 1;
+   return menu_st->entries.cache_id;
+}
+
+static const char *menu_entries_cache_get(uint32_t *ids,
+      char *strings, size_t len, size_t count, uint32_t id)
+{
+   size_t slot = id & (count - 1);
+   if (ids[slot] != id)
+      return NULL;
+   return strings + slot * len;
+}
+
+static void menu_entries_cache_set(uint32_t *ids,
+      char *strings, size_t len, size_t count, uint32_t id,
+      const char *s)
+{
+   size_t slot = id & (count - 1);
+   ids[slot]   = id;
+   strlcpy(strings + slot * len, s, len);
+}
+
+static rarch_setting_t *menu_entries_find_setting_enum(
+      enum msg_hash_enums enum_idx)
+{
+   switch (enum_idx)
+   {
+      case MENU_ENUM_LABEL_PLAYLIST_ENTRY:
+      case MENU_ENUM_LABEL_PLAYLIST_COLLECTION_ENTRY:
+      case MENU_ENUM_LABEL_EXPLORE_ITEM:
+      case MENU_ENUM_LABEL_RDB_ENTRY:
+         break;
+      default:
+         return menu_setting_find_enum(enum_idx);
+   }
+   return NULL;
+}
+
+void menu_entries_set_deferred(bool deferred)
+{
+   struct rarch_state *p_rarch = &rarch_st;
+   struct menu_state *menu_st  = &p_rarch->menu_driver_state;
+   menu_st->entries.deferred   = deferred;
+}
+
+bool menu_entries_is_bulk(file_list_t *list, size_t idx)
+{
+   menu_file_list_cbs_t *cbs = NULL;
+
+   if (!list || idx >= list->size)
+      return false;
+
+   cbs = (menu_file_list_cbs_t*)list->list[idx].actiondata;
+
+   return cbs && cbs->bulk;
+}
+
+menu_file_list_cbs_t *menu_entries_get_actiondata(
+      file_list_t *list, size_t idx)
+{
+   menu_file_list_cbs_t *cbs   = NULL;
+   struct rarch_state *p_rarch = &rarch_st;
+
+   if (!list || idx >= list->size)
+      return NULL;
+
+   cbs = (menu_file_list_cbs_t*)list->list[idx].actiondata;
+
+   if (cbs && cbs->deferred)
+   {
+      cbs->deferred = false;
+      cbs->setting  = menu_entries_find_setting_enum(cbs->enum_idx);
+
+      if (!string_is_equal(menu_driver_ident(), "null"))
+         menu_cbs_init(p_rarch, list, cbs,
+               list->list[idx].path, list->list[idx].label,
+               list->list[idx].type, idx);
+   }
+
+   return cbs;
+}
+
+
 void menu_entry_get(menu_entry_t *entry, size_t stack_idx,
       size_t i, void *userdata, bool use_representation)
 {
@@ -5165,7 +5272,7 @@ void menu_entry_get(menu_entry_t *entry, size_t stack_idx,
    entry->type                = list->list[i].type;
    entry->entry_idx           = list->list[i].entry_idx;
 
-   cbs                        = (menu_file_list_cbs_t*)list->list[i].actiondata;
+   cbs                        = menu_entries_get_actiondata(list, i);
    entry->idx                 = (unsigned)i;
 
    if (entry->label_enabled && !string_is_empty(entry_label))
@@ -5220,9 +5327,14 @@ void menu_entry_get(menu_entry_t *entry, size_t stack_idx,
 
       if (entry->sublabel_enabled)
       {
-         if (!string_is_empty(cbs->action_sublabel_cache))
-            strlcpy(entry->sublabel,
-                     cbs->action_sublabel_cache, sizeof(entry->sublabel));
+         const char *cached = menu_entries_cache_get(
+               menu_st->cache.sublabel_id,
+               &menu_st->cache.sublabel[0][0],
+               MENU_SUBLABEL_MAX_LENGTH,
+               MENU_SUBLABEL_CACHE_SIZE, cbs->cache_id);
+
+         if (cached)
+            strlcpy(entry->sublabel, cached, sizeof(entry->sublabel));
          else if (cbs->action_sublabel)
          {
             /* If this function callback returns true,
@@ -5233,9 +5345,12 @@ void menu_entry_get(menu_entry_t *entry, size_t stack_idx,
                      label, path,
                      entry->sublabel,
                      sizeof(entry->sublabel)) > 0)
-               strlcpy(cbs->action_sublabel_cache,
-                     entry->sublabel,
-                     sizeof(cbs->action_sublabel_cache));
+               menu_entries_cache_set(
+                     menu_st->cache.sublabel_id,
+                     &menu_st->cache.sublabel[0][0],
+                     MENU_SUBLABEL_MAX_LENGTH,
+                     MENU_SUBLABEL_CACHE_SIZE, cbs->cache_id,
+                     entry->sublabel);
          }
       }
    }
@@ -5621,15 +5736,21 @@ int menu_entries_get_title(char *s, size_t len)
    if (cbs && cbs->action_get_title)
    {
       int ret;
-      if (!string_is_empty(cbs->action_title_cache))
+      const char *cached = menu_entries_cache_get(
+            menu_st->cache.title_id, &menu_st->cache.title[0][0],
+            MENU_TITLE_MAX_LENGTH, MENU_TITLE_CACHE_SIZE, cbs->cache_id);
+      if (cached)
       {
-         strlcpy(s, cbs->action_title_cache, len);
+         strlcpy(s, cached, len);
          return 0;
       }
       menu_entries_get_last_stack(&path, &label, &menu_type, NULL, NULL);
       ret = cbs->action_get_title(path, label, menu_type, s, len);
       if (ret == 1)
-         strlcpy(cbs->action_title_cache, s, sizeof(cbs->action_title_cache));
+         menu_entries_cache_set(
+               menu_st->cache.title_id, &menu_st->cache.title[0][0],
+               MENU_TITLE_MAX_LENGTH, MENU_TITLE_CACHE_SIZE, cbs->cache_id,
+               s);
       return ret;
    }
    return 0;
@@ -5800,8 +5921,10 @@ void menu_entries_append(
    if (!cbs)
       return;
 
-   cbs->action_sublabel_cache[0]   = '\0';
-   cbs->action_title_cache[0]      = '\0';
+   cbs->cache_id                   = menu_entries_next_cache_id(
+         &p_rarch->menu_driver_state);
+   cbs->deferred                   = false;
+   cbs->bulk                       = false;
    cbs->enum_idx                   = MSG_UNKNOWN;
    cbs->checked                    = false;
    cbs->setting                    = menu_setting_find(label);
@@ -5886,8 +6009,10 @@ bool menu_entries_append_enum(
    if (!cbs)
       return false;
 
-   cbs->action_sublabel_cache[0]   = '\0';
-   cbs->action_title_cache[0]      = '\0';
+   cbs->cache_id                   = menu_entries_next_cache_id(
+         &p_rarch->menu_driver_state);
+   cbs->deferred                   = false;
+   cbs->bulk                       = false;
    cbs->enum_idx                   = enum_idx;
    cbs->checked                    = false;
    cbs->setting                    = NULL;
@@ -5912,11 +6037,17 @@ bool menu_entries_append_enum(
 
    file_list_set_actiondata(list, idx, cbs);
 
-   if (   enum_idx != MENU_ENUM_LABEL_PLAYLIST_ENTRY
-       && enum_idx != MENU_ENUM_LABEL_PLAYLIST_COLLECTION_ENTRY
-       && enum_idx != MENU_ENUM_LABEL_EXPLORE_ITEM
-       && enum_idx != MENU_ENUM_LABEL_RDB_ENTRY)
-      cbs->setting                 = menu_setting_find_enum(enum_idx);
+   /* Binding depends on the menu the entry is displayed in,
+    * so it can only be deferred for the current selection buffer */
+   if (     p_rarch->menu_driver_state.entries.deferred
+         && list == menu_entries_get_selection_buf_ptr(0))
+   {
+      cbs->deferred                = true;
+      cbs->bulk                    = true;
+      return true;
+   }
+
+   cbs->setting                    = menu_entries_find_setting_enum(enum_idx);
 
    if (!string_is_equal(menu_ident, "null"))
       menu_cbs_init(p_rarch,
@@ -5975,8 +6106,10 @@ void menu_entries_prepend(file_list_t *list,
    if (!cbs)
       return;
 
-   cbs->action_sublabel_cache[0]   = '\0';
-   cbs->action_title_cache[0]      = '\0';
+   cbs->cache_id                   = menu_entries_next_cache_id(
+         &p_rarch->menu_driver_state);
+   cbs->deferred                   = false;
+   cbs->bulk                       = false;
    cbs->enum_idx                   = enum_idx;
    cbs->checked                    = false;
    cbs->setting                    = menu_setting_find_enum(cbs->enum_idx);
@@ -7511,6 +7644,11 @@ bool menu_driver_ctl(enum rarch_menu_ctl_state state, void *data)
                && p_rarch->menu_driver_ctx->context_destroy)
             p_rarch->menu_driver_ctx->context_destroy(p_rarch->menu_userdata);
 
+         /* Thumbnail textures released by context_destroy()
+          * may be retained by the texture cache - these
+          * must be unloaded before the video driver goes away */
+         gfx_thumbnail_cache_flush();
+
          if (menu_st->data_own)
             return true;
 
@@ -9366,10 +9504,15 @@ static bool get_self_input_state(
    for (i = 0; i < netplay->connections_size; i++)
    {
       struct netplay_connection *connection = &netplay->connections[i];
-      if (connection->active && connection->mode >= NETPLAY_CONNECTION_CONNECTED)
+      if (     connection->active
+            && connection->mode >= NETPLAY_CONNECTION_CONNECTED
+            && !connection->send_packet_buffer.relay)
          netplay_send_cur_input(netplay, &netplay->connections[i]);
    }
 
+   /* Relayed peers all share the one copy */
+   netplay_send_cur_input_relayed(netplay);
+
    /* Handle any delayed state changes */
    if (netplay->is_server)
       netplay_delayed_state_change(netplay);
@@ -10278,31 +10421,158 @@ static void netplay_force_future(netplay_t *netplay)
    }
 }
 
+/**
+ * netplay_compress_savestate
+ * @netplay              : pointer to netplay object
+ * @z                    : compression backend to use
+ * @data                 : data to compress
+ * @size                 : size of data
+ * @wn                   : set to the compressed size
+ *
+ * Compress a savestate or savestate delta into the zbuffer.
+ */
+static bool netplay_compress_savestate(netplay_t *netplay,
+   struct compression_transcoder *z, const uint8_t *data, size_t size,
+   uint32_t *wn)
+{
+   uint32_t rd;
+
+   z->compression_backend->set_in(z->compression_stream,
+      data, (uint32_t)size);
+   z->compression_backend->set_out(z->compression_stream,
+      netplay->zbuffer, (uint32_t)netplay->zbuffer_size);
+   return z->compression_backend->trans(z->compression_stream, true, &rd,
+         wn, NULL);
+}
+
+#ifdef HAVE_THREADS
+/* Queue a savestate on the relay, once for the relayed peers which take it in
+ * this form (as a delta or not), and skipped by the rest */
+static void netplay_relay_savestate(netplay_t *netplay, uint32_t cx,
+   const uint8_t *delta, bool as_delta, const uint32_t *header,
+   size_t header_size, size_t wn)
+{
+   size_t i;
+   bool any = false;
+
+   for (i = 0; i < netplay->connections_size; i++)
+   {
+      struct netplay_connection *connection = &netplay->connections[i];
+      if (!connection->active ||
+          connection->mode < NETPLAY_CONNECTION_CONNECTED ||
+          connection->compression_supported != cx ||
+          !connection->send_packet_buffer.relay) continue;
+      if ((delta && connection->savestate_delta &&
+           connection->savestate_base_valid) == as_delta)
+      {
+         connection->udp_epoch_sent++;
+         any = true;
+      }
+   }
+   if (!any)
+      return;
+
+   for (i = 0; i < netplay->connections_size; i++)
+   {
+      struct netplay_connection *connection = &netplay->connections[i];
+      if (!connection->active ||
+          connection->mode < NETPLAY_CONNECTION_CONNECTED ||
+          connection->compression_supported != cx ||
+          !connection->send_packet_buffer.relay) continue;
+      if ((delta && connection->savestate_delta &&
+           connection->savestate_base_valid) != as_delta &&
+          !netplay_relay_skip(connection->send_packet_buffer.relay,
+             header_size + wn))
+         netplay_hangup(netplay, connection);
+   }
+
+   netplay_relay_append(netplay->relay, header, header_size);
+   netplay_relay_append(netplay->relay, netplay->zbuffer, wn);
+}
+#endif
+
 /**
  * netplay_send_savestate
  * @netplay              : pointer to netplay object
  * @serial_info          : the savestate being loaded
  * @cx                   : compression type
  * @z                    : compression backend to use
+ * @delta                : the savestate as a delta against
+ *                         netplay->savestate_sent, or NULL
+ * @delta_size           : size of delta
  *
  * Send a loaded savestate to those connected peers using the given compression
- * scheme.
+ * scheme. Peers which hold the last state sent get the delta instead.
  */
 void netplay_send_savestate(netplay_t *netplay,
    retro_ctx_serialize_info_t *serial_info, uint32_t cx,
-   struct compression_transcoder *z)
+   struct compression_transcoder *z,
+   const uint8_t *delta, size_t delta_size)
 {
-   uint32_t header[4];
-   uint32_t rd, wn;
+   uint32_t header[5];
+   uint32_t wn;
    size_t i;
+   bool send_full = false;
+
+   for (i = 0; i < netplay->connections_size; i++)
+   {
+      struct netplay_connection *connection = &netplay->connections[i];
+      if (!connection->active ||
+          connection->mode < NETPLAY_CONNECTION_CONNECTED ||
+          connection->compression_supported != cx) continue;
+      if (!delta || !connection->savestate_delta ||
+          !connection->savestate_base_valid)
+         send_full = true;
+   }
+
+   /* Deltas first, as they share the zbuffer with the full state */
+   if (delta)
+   {
+      if (netplay_compress_savestate(netplay, z, delta, delta_size, &wn))
+      {
+         header[0] = htonl(NETPLAY_CMD_LOAD_SAVESTATE_DELTA);
+         header[1] = htonl(wn + 3*sizeof(uint32_t));
+         header[2] = htonl(netplay->run_frame_count);
+         header[3] = htonl(serial_info->size);
+         header[4] = htonl((uint32_t)delta_size);
+
+#ifdef HAVE_THREADS
+         netplay_relay_savestate(netplay, cx, delta, true,
+               header, sizeof(header), wn);
+#endif
+
+         for (i = 0; i < netplay->connections_size; i++)
+         {
+            struct netplay_connection *connection = &netplay->connections[i];
+            if (!connection->active ||
+                connection->mode < NETPLAY_CONNECTION_CONNECTED ||
+                connection->compression_supported != cx ||
+                !connection->savestate_delta ||
+                !connection->savestate_base_valid ||
+                connection->send_packet_buffer.relay) continue;
+
+            connection->udp_epoch_sent++;
+            if (!netplay_send(&connection->send_packet_buffer, connection->fd,
+                  header, sizeof(header)) ||
+                !netplay_send(&connection->send_packet_buffer, connection->fd,
+                  netplay->zbuffer, wn))
+               netplay_hangup(netplay, connection);
+         }
+      }
+      else
+      {
+         /* Didn't fit, so everyone gets the full state */
+         delta     = NULL;
+         send_full = true;
+      }
+   }
+
+   if (!send_full)
+      return;
 
    /* Compress it */
-   z->compression_backend->set_in(z->compression_stream,
-      (const uint8_t*)serial_info->data_const, (uint32_t)serial_info->size);
-   z->compression_backend->set_out(z->compression_stream,
-      netplay->zbuffer, (uint32_t)netplay->zbuffer_size);
-   if (!z->compression_backend->trans(z->compression_stream, true, &rd,
-         &wn, NULL))
+   if (!netplay_compress_savestate(netplay, z,
+         (const uint8_t*)serial_info->data_const, serial_info->size, &wn))
    {
       /* Catastrophe! */
       for (i = 0; i < netplay->connections_size; i++)
@@ -10316,15 +10586,25 @@ void netplay_send_savestate(netplay_t *netplay,
    header[2] = htonl(netplay->run_frame_count);
    header[3] = htonl(serial_info->size);
 
+#ifdef HAVE_THREADS
+   netplay_relay_savestate(netplay, cx, delta, false,
+         header, 4*sizeof(uint32_t), wn);
+#endif
+
    for (i = 0; i < netplay->connections_size; i++)
    {
       struct netplay_connection *connection = &netplay->connections[i];
       if (!connection->active ||
           connection->mode < NETPLAY_CONNECTION_CONNECTED ||
-          connection->compression_supported != cx) continue;
+          connection->compression_supported != cx ||
+          connection->send_packet_buffer.relay) continue;
+      if (delta && connection->savestate_delta &&
+          connection->savestate_base_valid) continue;
 
+      /* UDP input must not overtake this */
+      connection->udp_epoch_sent++;
       if (!netplay_send(&connection->send_packet_buffer, connection->fd, header,
-            sizeof(header)) ||
+            4*sizeof(uint32_t)) ||
           !netplay_send(&connection->send_packet_buffer, connection->fd,
             netplay->zbuffer, wn))
          netplay_hangup(netplay, connection);
@@ -10344,7 +10624,12 @@ void netplay_send_savestate(netplay_t *netplay,
 void netplay_load_savestate(netplay_t *netplay,
       retro_ctx_serialize_info_t *serial_info, bool save)
 {
+   size_t i;
    retro_ctx_serialize_info_t tmp_serial_info;
+   const uint8_t *delta = NULL;
+   size_t delta_size    = 0;
+   bool want_delta      = false;
+   bool have_base       = false;
 
    netplay_force_future(netplay);
 
@@ -10385,12 +10670,62 @@ void netplay_load_savestate(netplay_t *netplay,
             | NETPLAY_QUIRK_NO_TRANSMISSION))
       return;
 
+   /* Peers which take deltas need the last state sent to diff against */
+   for (i = 0; i < netplay->connections_size; i++)
+   {
+      struct netplay_connection *connection = &netplay->connections[i];
+      if (connection->active && connection->savestate_delta)
+      {
+         want_delta = true;
+         if (connection->savestate_base_valid)
+            have_base = true;
+      }
+   }
+   if (want_delta && serial_info->size == netplay->state_size &&
+       !netplay->savestate_sent)
+   {
+      netplay->savestate_sent = (uint8_t*)malloc(netplay->state_size);
+      if (!netplay->delta_buffer)
+         netplay->delta_buffer = (uint8_t*)malloc(
+               netplay->state_size + NETPLAY_DELTA_OVERHEAD);
+      if (!netplay->delta_buffer)
+      {
+         free(netplay->savestate_sent);
+         netplay->savestate_sent = NULL;
+      }
+   }
+   if (!netplay->savestate_sent || serial_info->size != netplay->state_size)
+      want_delta = have_base = false;
+
+   if (have_base)
+   {
+      delta_size = netplay_delta_encode(netplay->savestate_sent,
+            (const uint8_t*)serial_info->data_const, netplay->state_size,
+            netplay->delta_buffer);
+      /* Not worth it if it doesn't save anything */
+      if (delta_size < netplay->state_size)
+         delta = netplay->delta_buffer;
+   }
+
    /* Send this to every peer */
    if (netplay->compress_nil.compression_backend)
-      netplay_send_savestate(netplay, serial_info, 0, &netplay->compress_nil);
+      netplay_send_savestate(netplay, serial_info, 0, &netplay->compress_nil,
+         delta, delta_size);
    if (netplay->compress_zlib.compression_backend)
       netplay_send_savestate(netplay, serial_info, NETPLAY_COMPRESSION_ZLIB,
-         &netplay->compress_zlib);
+         &netplay->compress_zlib, delta, delta_size);
+
+   /* Whoever got it now holds the base for the next delta */
+   if (want_delta)
+      memcpy(netplay->savestate_sent, serial_info->data_const,
+            netplay->state_size);
+   for (i = 0; i < netplay->connections_size; i++)
+   {
+      struct netplay_connection *connection = &netplay->connections[i];
+      connection->savestate_base_valid = want_delta &&
+         connection->active && connection->savestate_delta &&
+         connection->mode >= NETPLAY_CONNECTION_CONNECTED;
+   }
 }
 
 /**
@@ -10418,6 +10753,8 @@ static void netplay_core_reset(netplay_t *netplay)
       if (!connection->active ||
             connection->mode < NETPLAY_CONNECTION_CONNECTED) continue;
 
+      /* UDP input must not overtake this */
+      connection->udp_epoch_sent++;
       if (!netplay_send(&connection->send_packet_buffer, connection->fd, cmd,
                sizeof(cmd)))
          netplay_hangup(netplay, connection);
@@ -10552,6 +10889,8 @@ static bool init_netplay(
       quirks |= NETPLAY_QUIRK_ENDIAN_DEPENDENT;
    if (serialization_quirks & NETPLAY_QUIRK_MAP_PLATFORM_DEPENDENT)
       quirks |= NETPLAY_QUIRK_PLATFORM_DEPENDENT;
+   if (serialization_quirks & NETPLAY_QUIRK_MAP_VARIABLE_SIZE)
+      quirks |= NETPLAY_QUIRK_VARIABLE_SIZE;
 
    if (_netplay_is_client)
    {
@@ -16522,6 +16861,11 @@ bool command_event(enum event_command cmd, void *data)
          }
          g_defaults.image_history = NULL;
 #endif
+
+         /* Histories freed with queued writes leave
+          * snapshots behind; these must reach the disk
+          * before the files may be read again */
+         task_playlist_write_flush();
          break;
       case CMD_EVENT_HISTORY_INIT:
          {
@@ -16595,6 +16939,7 @@ bool command_event(enum event_command cmd, void *data)
             char ext_name[255];
             const char *dir_libretro       = settings->paths.directory_libretro;
             const char *path_libretro_info = settings->paths.path_libretro_info;
+            const char *dir_cache          = settings->paths.directory_cache;
             bool show_hidden_files         = settings->bools.show_hidden_files;
 
             ext_name[0]                    = '\0';
@@ -16608,6 +16953,7 @@ bool command_event(enum event_command cmd, void *data)
                core_info_init_list(path_libretro_info,
                      dir_libretro,
                      ext_name,
+                     dir_cache,
                      show_hidden_files
                      );
          }
@@ -16779,7 +17125,7 @@ bool command_event(enum event_command cmd, void *data)
                          (current_sort_mode == PLAYLIST_SORT_MODE_ALPHABETICAL))
                         playlist_qsort(g_defaults.content_favorites);
 
-                     playlist_write_file(g_defaults.content_favorites);
+                     task_push_playlist_write(g_defaults.content_favorites);
                      runloop_msg_queue_push(msg_hash_to_str(MSG_ADDED_TO_FAVORITES), 1, 180, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
                   }
                }
@@ -17728,7 +18074,11 @@ void main_exit(void *args)
 
    rarch_ctl(RARCH_CTL_STATE_FREE,  NULL);
    global_free(p_rarch);
+   task_playlist_write_flush();
    task_queue_deinit();
+#ifdef HAVE_THREADS
+   tpool_shared_deinit();
+#endif
 
    if (p_rarch->configuration_settings)
       free(p_rarch->configuration_settings);
@@ -26740,9 +27090,8 @@ static void menu_input_post_iterate(
       menu_entry_t entry;
       file_list_t *selection_buf = menu_entries_get_selection_buf_ptr(0);
       size_t selection           = menu_st->selection_ptr;
-      menu_file_list_cbs_t *cbs  = selection_buf ?
-         (menu_file_list_cbs_t*)selection_buf->list[selection].actiondata
-         : NULL;
+      menu_file_list_cbs_t *cbs  =
+         menu_entries_get_actiondata(selection_buf, selection);
 
       MENU_ENTRY_INIT(entry);
       /* Note: If menu_input_pointer_post_iterate() is
@@ -37773,6 +38122,11 @@ void retroarch_init_task_queue(void)
 
    task_queue_deinit();
    task_queue_init(threaded_enable, runloop_task_msg_queue_push);
+
+#ifdef HAVE_THREADS
+   /* Used by the image decoders and the scaler */
+   tpool_shared_init(cpu_features_get_core_amount());
+#endif
 }
 
 static void retroarch_core_options_intl_init(
@@ -40415,6 +40769,8 @@ void rarch_favorites_deinit(void)
    playlist_write_file(g_defaults.content_favorites);
    playlist_free(g_defaults.content_favorites);
    g_defaults.content_favorites = NULL;
+
+   task_playlist_write_flush();
 }
 
 /* Libretro core loader */
@@ -0,0 +1,114 @@
+#!/bin/sh
+# Runs a netplay server and client of the given RetroArch binary on
+# 127.0.0.1, with netplay_proxy between them and netplay_test_core
+# loaded on both sides and netplay_pads pressing buttons on both, then
+# summarizes the savestates the server sent and the frames replayed.
+#
+# usage: loopback.sh [-f] [-s state_mb] [-r desync_every] [-n frames]
+#                    [-t tcp_loss] [-l udp_loss] [-j udp_jitter]
+#                    <retroarch binary>
+#   -f  full savestates only (clears the delta bit in the headers)
+#   -s  size of the core's state in MiB (default 4)
+#   -r  corrupt the client's state every this many frames, 0 for never
+#       (default 120)
+#   -n  frames to run (default 900)
+#   -t  percentage of TCP reads held back 200 ms by the proxy
+#   -l  percentage of UDP input datagrams dropped (NETPLAY_UDP_LOSS)
+#   -j  most ms UDP input datagrams are delayed (NETPLAY_UDP_JITTER)
+
+FULL= STATE_MB=4 DESYNC=120 FRAMES=900 TCP_LOSS=0
+while getopts fs:r:n:t:l:j: opt; do
+   case $opt in
+      f) FULL=-f ;;
+      s) STATE_MB=$OPTARG ;;
+      r) DESYNC=$OPTARG ;;
+      n) FRAMES=$OPTARG ;;
+      t) TCP_LOSS=$OPTARG ;;
+      l) export NETPLAY_UDP_LOSS=$OPTARG ;;
+      j) export NETPLAY_UDP_JITTER=$OPTARG ;;
+      *) exit 1 ;;
+   esac
+done
+shift $((OPTIND - 1))
+[ $# -eq 1 ] || { sed -n '2,20p' "$0"; exit 1; }
+
+RETROARCH=$1
+HERE=$(cd "$(dirname "$0")" && pwd)
+WORK=$(mktemp -d)
+PORT=55445
+PROXY_PORT=55446
+PAD_PORT_server=56400
+PAD_PORT_client=56500
+
+for side in server client; do
+   eval pad_port=\$PAD_PORT_$side
+   cat > "$WORK/$side.cfg" <<CFG
+video_driver = "null"
+audio_driver = "null"
+input_driver = "null"
+input_joypad_driver = "null"
+menu_driver = "null"
+audio_enable = "false"
+video_threaded = "false"
+config_save_on_exit = "false"
+netplay_nickname = "$side"
+netplay_check_frames = "30"
+netplay_input_latency_frames_min = "0"
+netplay_input_latency_frames_range = "0"
+network_remote_enable = "true"
+network_remote_enable_user_p1 = "true"
+network_remote_base_port = "$pad_port"
+CFG
+done
+
+"$HERE/netplay_proxy" $FULL -t $TCP_LOSS -l "$WORK/proxy.log" $PROXY_PORT $PORT &
+PROXY=$!
+
+NETPLAY_TEST_STATE_MB=$STATE_MB NETPLAY_TEST_STATS="$WORK/server.stats" \
+   "$RETROARCH" -c "$WORK/server.cfg" -L "$HERE/netplay_test_core.so" \
+   --host --port $PORT --max-frames=$FRAMES -v > "$WORK/server.log" 2>&1 &
+SERVER=$!
+sleep 1
+NETPLAY_TEST_STATE_MB=$STATE_MB NETPLAY_TEST_DESYNC=$DESYNC \
+   NETPLAY_TEST_TRACE="$WORK/client.trace" \
+   NETPLAY_TEST_STATS="$WORK/client.stats" \
+   "$RETROARCH" -c "$WORK/client.cfg" -L "$HERE/netplay_test_core.so" \
+   --connect 127.0.0.1 --port $PROXY_PORT --max-frames=$FRAMES -v \
+   > "$WORK/client.log" 2>&1 &
+CLIENT=$!
+"$HERE/netplay_pads" $((FRAMES / 60 + 2)) $PAD_PORT_server $PAD_PORT_client &
+PADS=$!
+
+wait $SERVER $CLIENT
+wait $PROXY
+kill $PADS 2>/dev/null
+
+# Frames run beyond the last one reached were replays
+for side in server client; do
+   echo "$side: $(cat "$WORK/$side.stats")" | awk '{
+      split($3, run, "="); split($2, frames, "=")
+      print $0 " replayed=" run[2] - frames[2] }'
+   grep -h "UDP ahead of TCP" "$WORK/$side.log"
+done
+
+# A request is answered by the next savestate the server sends. The
+# client has applied it at its first state load after that.
+awk '
+   FILENAME ~ /trace$/ { loads[++nloads] = $1; next }
+   $3 == "REQUEST_SAVESTATE" { req = $1; next }
+   $3 ~ /^LOAD_SAVESTATE/ {
+      for (i = 1; i <= nloads && loads[i] < $1; i++);
+      if (!req) { printf "initial %s: %d bytes\n", $3, $4; next }
+      n[$3]++; bytes[$3] += $4
+      sent[$3] += $1 - req; applied[$3] += loads[i] - req
+      req = 0
+   }
+   $3 == "TOTAL" { printf "%s total: %d bytes\n", $2, $4 }
+   END {
+      for (t in n)
+         printf "%s: %d sent, %d bytes each, request to sent %.1f ms, " \
+            "to applied %.1f ms\n", t, n[t], bytes[t] / n[t],
+            sent[t] / n[t] * 1000, applied[t] / n[t] * 1000
+   }' "$WORK/client.trace" "$WORK/proxy.log"
+
+rm -rf "$WORK"
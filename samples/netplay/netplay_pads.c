@@ -0,0 +1,86 @@
+/*  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Netplay loopback pads
+ * > Presses random buttons on the network remote RetroPad
+ *   (network_remote_enable) of RetroArch instances on
+ *   127.0.0.1, about ten times a second, so that netplay
+ *   has input to mispredict and replay */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include <libretro.h>
+
+/* As read by the network remote, in host order */
+struct remote_message
+{
+   int port;
+   int device;
+   int index;
+   int id;
+   uint16_t state;
+};
+
+int main(int argc, char *argv[])
+{
+   int i, fd;
+   struct sockaddr_in addr;
+   struct remote_message msg;
+   unsigned ticks;
+
+   if (argc < 3)
+   {
+      fprintf(stderr, "Usage: %s <seconds> <remote port>...\n", argv[0]);
+      return 1;
+   }
+
+   if ((fd = socket(AF_INET, SOCK_DGRAM, 0)) < 0)
+   {
+      perror("socket");
+      return 1;
+   }
+
+   memset(&addr, 0, sizeof(addr));
+   addr.sin_family      = AF_INET;
+   addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+   srand(1);
+
+   for (ticks = atoi(argv[1]) * 10; ticks; ticks--)
+   {
+      for (i = 2; i < argc; i++)
+      {
+         memset(&msg, 0, sizeof(msg));
+         msg.device = RETRO_DEVICE_JOYPAD;
+         msg.id     = rand() % (RETRO_DEVICE_ID_JOYPAD_R + 1);
+         msg.state  = rand() % 2;
+
+         addr.sin_port = htons(atoi(argv[i]));
+         sendto(fd, &msg, sizeof(msg), 0,
+               (struct sockaddr*)&addr, sizeof(addr));
+      }
+      usleep(100000);
+   }
+
+   close(fd);
+   return 0;
+}
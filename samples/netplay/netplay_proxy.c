@@ -0,0 +1,354 @@
+/*  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Netplay loopback proxy
+ * > Sits between one netplay client and server on
+ *   127.0.0.1 and forwards the TCP stream both ways
+ * > Follows the command stream and logs savestate
+ *   requests and loads, with their size and the
+ *   CLOCK_MONOTONIC time at which they went through
+ * > With -f, clears the delta bit from both connection
+ *   headers, so that the peers send full savestates
+ * > With -t, simulates TCP on a lossy link: that percentage
+ *   of reads is held back for a retransmission timeout,
+ *   along with everything behind it */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+/* Only for #defines */
+#include "../../network/netplay/netplay_private.h"
+
+/* Connection header: 6 words, compression/features in word 2 */
+#define PROXY_HEADER_SIZE     24
+#define PROXY_COMPRESSION_OFF  8
+
+/* Delay of a "lost" segment, about Linux's minimum RTO */
+#define PROXY_RETRANSMIT_SEC  0.2
+
+struct proxy_stream
+{
+   const char *name;
+   int from;
+   int to;
+   size_t offset;
+   size_t total;
+   /* Command being followed */
+   uint8_t cmd_header[8];
+   unsigned cmd_header_have;
+   uint32_t cmd;
+   uint32_t cmd_size;
+   uint32_t cmd_left;
+   /* Data held back by simulated loss, and when it goes */
+   uint8_t *held;
+   size_t held_size;
+   size_t held_cap;
+   double release;
+   bool open;
+};
+
+static FILE *proxy_log    = NULL;
+static bool strip_delta   = false;
+static unsigned tcp_loss  = 0;
+
+static double proxy_time(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void proxy_log_cmd(struct proxy_stream *stream)
+{
+   const char *name = NULL;
+
+   switch (stream->cmd)
+   {
+      case NETPLAY_CMD_REQUEST_SAVESTATE:
+         name = "REQUEST_SAVESTATE";
+         break;
+      case NETPLAY_CMD_LOAD_SAVESTATE:
+         name = "LOAD_SAVESTATE";
+         break;
+      case NETPLAY_CMD_LOAD_SAVESTATE_DELTA:
+         name = "LOAD_SAVESTATE_DELTA";
+         break;
+      default:
+         return;
+   }
+
+   fprintf(proxy_log, "%.6f %s %s %u\n", proxy_time(), stream->name,
+         name, (unsigned)(stream->cmd_size + sizeof(stream->cmd_header)));
+   fflush(proxy_log);
+}
+
+/* Edits the header in @data if asked to, and logs the
+ * commands which complete in it */
+static void proxy_follow(struct proxy_stream *stream,
+      uint8_t *data, size_t len)
+{
+   size_t i = 0;
+
+   if (     strip_delta
+         && stream->offset <= PROXY_COMPRESSION_OFF + 3
+         && stream->offset + len > PROXY_COMPRESSION_OFF + 3)
+      data[PROXY_COMPRESSION_OFF + 3 - stream->offset] &=
+         ~NETPLAY_COMPRESSION_DELTA;
+
+   if (stream->offset < PROXY_HEADER_SIZE)
+      i = PROXY_HEADER_SIZE - stream->offset;
+
+   while (i < len)
+   {
+      if (stream->cmd_header_have < sizeof(stream->cmd_header))
+      {
+         stream->cmd_header[stream->cmd_header_have++] = data[i++];
+         if (stream->cmd_header_have < sizeof(stream->cmd_header))
+            continue;
+         stream->cmd      = ntohl(((uint32_t*)stream->cmd_header)[0]);
+         stream->cmd_size = ntohl(((uint32_t*)stream->cmd_header)[1]);
+         stream->cmd_left = stream->cmd_size;
+      }
+      else
+      {
+         size_t chunk = len - i;
+         if (chunk > stream->cmd_left)
+            chunk = stream->cmd_left;
+         stream->cmd_left -= (uint32_t)chunk;
+         i                += chunk;
+      }
+
+      if (!stream->cmd_left)
+      {
+         proxy_log_cmd(stream);
+         stream->cmd_header_have = 0;
+      }
+   }
+
+   stream->offset += len;
+}
+
+static bool proxy_forward(struct proxy_stream *stream,
+      uint8_t *data, size_t len)
+{
+   size_t sent = 0;
+
+   proxy_follow(stream, data, len);
+
+   while (sent < len)
+   {
+      ssize_t ret = send(stream->to, data + sent, len - sent, 0);
+      if (ret <= 0)
+         return false;
+      sent += ret;
+   }
+
+   stream->total += len;
+   return true;
+}
+
+static bool proxy_hold(struct proxy_stream *stream,
+      const uint8_t *data, size_t len)
+{
+   if (stream->held_size + len > stream->held_cap)
+   {
+      size_t cap   = (stream->held_size + len) * 2;
+      uint8_t *buf = (uint8_t*)realloc(stream->held, cap);
+      if (!buf)
+         return false;
+      stream->held     = buf;
+      stream->held_cap = cap;
+   }
+
+   memcpy(stream->held + stream->held_size, data, len);
+   stream->held_size += len;
+   return true;
+}
+
+static bool proxy_release(struct proxy_stream *stream)
+{
+   size_t len        = stream->held_size;
+   stream->held_size = 0;
+   return !len || proxy_forward(stream, stream->held, len);
+}
+
+static bool proxy_pump(struct proxy_stream *stream)
+{
+   static uint8_t buf[1 << 16];
+   ssize_t len = recv(stream->from, buf, sizeof(buf), 0);
+
+   if (len <= 0)
+      return false;
+
+   /* TCP delivers in order, so anything read while a
+    * segment is lost waits for its retransmission */
+   if (     !stream->held_size
+         && (unsigned)(rand() % 100) >= tcp_loss)
+      return proxy_forward(stream, buf, (size_t)len);
+
+   if (!stream->held_size)
+      stream->release = proxy_time() + PROXY_RETRANSMIT_SEC;
+   return proxy_hold(stream, buf, (size_t)len);
+}
+
+static int proxy_socket(void)
+{
+   int one = 1;
+   int fd  = socket(AF_INET, SOCK_STREAM, 0);
+   if (fd >= 0)
+      setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+   return fd;
+}
+
+int main(int argc, char *argv[])
+{
+   int i;
+   struct sockaddr_in addr;
+   struct proxy_stream streams[2];
+   int one       = 1;
+   int listen_fd = -1;
+   int client_fd = -1;
+   int server_fd = -1;
+
+   proxy_log = stdout;
+
+   for (i = 1; i < argc && argv[i][0] == '-'; i++)
+   {
+      if (!strcmp(argv[i], "-f"))
+         strip_delta = true;
+      else if (!strcmp(argv[i], "-t") && i + 1 < argc)
+         tcp_loss    = atoi(argv[++i]);
+      else if (!strcmp(argv[i], "-l") && i + 1 < argc)
+      {
+         if (!(proxy_log = fopen(argv[++i], "w")))
+         {
+            fprintf(stderr, "Can't open %s.\n", argv[i]);
+            return 1;
+         }
+      }
+      else
+         break;
+   }
+
+   if (argc - i != 2)
+   {
+      fprintf(stderr, "Usage: %s [-f] [-t loss%%] [-l log] <listen port> <server port>\n",
+            argv[0]);
+      return 1;
+   }
+
+   memset(&addr, 0, sizeof(addr));
+   addr.sin_family      = AF_INET;
+   addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+   addr.sin_port        = htons(atoi(argv[i]));
+
+   if (     (listen_fd = proxy_socket()) < 0
+         || bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0
+         || listen(listen_fd, 1) < 0
+         || (client_fd = accept(listen_fd, NULL, NULL)) < 0)
+   {
+      perror("listen");
+      return 1;
+   }
+
+   addr.sin_port = htons(atoi(argv[i + 1]));
+   if (     (server_fd = proxy_socket()) < 0
+         || connect(server_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0)
+   {
+      perror("connect");
+      return 1;
+   }
+
+   /* Netplay disables Nagle on its side too */
+   setsockopt(client_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+   setsockopt(server_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+   memset(streams, 0, sizeof(streams));
+   streams[0].name = "c>s";
+   streams[0].from = client_fd;
+   streams[0].to   = server_fd;
+   streams[0].open = true;
+   streams[1].name = "s>c";
+   streams[1].from = server_fd;
+   streams[1].to   = client_fd;
+   streams[1].open = true;
+
+   while (streams[0].open || streams[1].open)
+   {
+      struct pollfd fds[2];
+      int timeout = -1;
+      double now  = proxy_time();
+
+      for (i = 0; i < 2; i++)
+      {
+         fds[i].fd      = streams[i].open ? streams[i].from : -1;
+         fds[i].events  = POLLIN;
+         fds[i].revents = 0;
+
+         if (streams[i].held_size)
+         {
+            int wait = (int)((streams[i].release - now) * 1000) + 1;
+            if (wait < 0)
+               wait = 0;
+            if (timeout < 0 || wait < timeout)
+               timeout = wait;
+         }
+      }
+
+      if (poll(fds, 2, timeout) < 0)
+         break;
+
+      now = proxy_time();
+      for (i = 0; i < 2; i++)
+      {
+         bool ok = true;
+
+         if (streams[i].held_size && streams[i].release <= now)
+            ok = proxy_release(&streams[i]);
+         if (ok && fds[i].revents)
+            ok = proxy_pump(&streams[i]);
+         if (ok)
+            continue;
+
+         /* Whatever was held back still goes before the end */
+         proxy_release(&streams[i]);
+         shutdown(streams[i].to, SHUT_WR);
+         streams[i].open = false;
+      }
+   }
+
+   for (i = 0; i < 2; i++)
+   {
+      fprintf(proxy_log, "%.6f %s TOTAL %u\n", proxy_time(),
+            streams[i].name, (unsigned)streams[i].total);
+      free(streams[i].held);
+   }
+
+   close(client_fd);
+   close(server_fd);
+   close(listen_fd);
+   if (proxy_log != stdout)
+      fclose(proxy_log);
+
+   return 0;
+}
@@ -0,0 +1,247 @@
+/*  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Netplay test core
+ * > Runs without content at 60 frames per second
+ * > Its savestate is NETPLAY_TEST_STATE_MB of "memory",
+ *   half noise and half zeroes, of which 16 bytes change
+ *   per frame, plus a hash of the input of both players
+ * > With NETPLAY_TEST_DESYNC=n, a byte of memory is
+ *   corrupted every n frames, so that the next CRC check
+ *   fails and the server has to send its state again
+ * > NETPLAY_TEST_TRACE names a file which gets the
+ *   CLOCK_MONOTONIC time of every state load, and
+ *   NETPLAY_TEST_STATS one which gets frame counts and
+ *   the input hash on exit */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include <libretro.h>
+
+#define TEST_WIDTH   16
+#define TEST_HEIGHT  16
+
+/* Bytes of memory written per frame */
+#define TEST_WRITES  16
+
+static retro_video_refresh_t video_cb;
+static retro_input_poll_t input_poll_cb;
+static retro_input_state_t input_state_cb;
+static retro_environment_t environ_cb;
+
+static uint16_t frame_buf[TEST_WIDTH * TEST_HEIGHT];
+static struct timespec next_frame;
+static FILE *trace_file   = NULL;
+
+/* Saved state */
+static uint32_t counters[4];
+static uint8_t *memory    = NULL;
+static size_t memory_size = 0;
+
+static unsigned desync_every;
+static unsigned frames_run;
+static unsigned states_loaded;
+
+static double test_time(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void retro_init(void)
+{
+   size_t i;
+   uint32_t seed     = 12345;
+   const char *value = getenv("NETPLAY_TEST_STATE_MB");
+
+   memory_size = (size_t)((value ? atof(value) : 4.0) * 1024 * 1024);
+   memory      = (uint8_t*)calloc(1, memory_size ? memory_size : 1);
+   for (i = 0; memory && i < memory_size / 2; i++)
+   {
+      seed      = seed * 1103515245 + 12345;
+      memory[i] = (uint8_t)(seed >> 16);
+   }
+
+   if ((value = getenv("NETPLAY_TEST_DESYNC")))
+      desync_every = atoi(value);
+   if ((value = getenv("NETPLAY_TEST_TRACE")))
+      trace_file = fopen(value, "w");
+
+   clock_gettime(CLOCK_MONOTONIC, &next_frame);
+}
+
+void retro_deinit(void)
+{
+   const char *path = getenv("NETPLAY_TEST_STATS");
+   FILE *file       = path ? fopen(path, "w") : NULL;
+
+   if (file)
+   {
+      fprintf(file, "frames=%u run=%u loads=%u input=%08x\n",
+            counters[0], frames_run, states_loaded,
+            counters[1] * 3u + counters[2]);
+      fclose(file);
+   }
+
+   if (trace_file)
+      fclose(trace_file);
+   trace_file = NULL;
+
+   free(memory);
+   memory = NULL;
+}
+
+unsigned retro_api_version(void)
+{
+   return RETRO_API_VERSION;
+}
+
+void retro_get_system_info(struct retro_system_info *info)
+{
+   memset(info, 0, sizeof(*info));
+   info->library_name     = "Netplay test";
+   info->library_version  = "1";
+   info->need_fullpath    = false;
+   info->valid_extensions = "";
+}
+
+void retro_get_system_av_info(struct retro_system_av_info *info)
+{
+   memset(info, 0, sizeof(*info));
+   info->timing.fps            = 60.0;
+   info->timing.sample_rate    = 48000.0;
+   info->geometry.base_width   = TEST_WIDTH;
+   info->geometry.base_height  = TEST_HEIGHT;
+   info->geometry.max_width    = TEST_WIDTH;
+   info->geometry.max_height   = TEST_HEIGHT;
+   info->geometry.aspect_ratio = 1.0f;
+}
+
+void retro_set_environment(retro_environment_t cb)
+{
+   bool no_content = true;
+   environ_cb      = cb;
+   cb(RETRO_ENVIRONMENT_SET_SUPPORT_NO_GAME, &no_content);
+}
+
+void retro_set_audio_sample(retro_audio_sample_t cb) { }
+void retro_set_audio_sample_batch(retro_audio_sample_batch_t cb) { }
+void retro_set_input_poll(retro_input_poll_t cb) { input_poll_cb = cb; }
+void retro_set_input_state(retro_input_state_t cb) { input_state_cb = cb; }
+void retro_set_video_refresh(retro_video_refresh_t cb) { video_cb = cb; }
+void retro_set_controller_port_device(unsigned port, unsigned device) { }
+
+void retro_reset(void)
+{
+   memset(counters, 0, sizeof(counters));
+}
+
+void retro_run(void)
+{
+   unsigned port, i;
+   struct timespec now;
+
+   input_poll_cb();
+
+   for (port = 0; port < 2; port++)
+   {
+      uint32_t mask = 0;
+      for (i = 0; i < 16; i++)
+         if (input_state_cb(port, RETRO_DEVICE_JOYPAD, 0, i))
+            mask |= 1u << i;
+      counters[1 + port] = counters[1 + port] * 2654435761u + mask + 1;
+   }
+
+   counters[0]++;
+   frames_run++;
+
+   if (memory_size)
+   {
+      for (i = 0; i < TEST_WRITES; i++)
+         memory[((uint64_t)counters[0] * TEST_WRITES + i)
+            * 2654435761u % memory_size] = (uint8_t)(counters[1] + i);
+
+      if (desync_every && counters[0] % desync_every == 0)
+         memory[(counters[0] * 7919u) % memory_size] ^= 0x5a;
+   }
+
+   video_cb(frame_buf, TEST_WIDTH, TEST_HEIGHT, TEST_WIDTH * 2);
+
+   /* Keep to 60 fps, but let replayed frames run flat out */
+   next_frame.tv_nsec += 16666667;
+   if (next_frame.tv_nsec >= 1000000000)
+   {
+      next_frame.tv_nsec -= 1000000000;
+      next_frame.tv_sec++;
+   }
+   clock_gettime(CLOCK_MONOTONIC, &now);
+   if (now.tv_sec > next_frame.tv_sec + 1)
+      next_frame = now;
+   else
+      clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next_frame, NULL);
+}
+
+size_t retro_serialize_size(void)
+{
+   return sizeof(counters) + memory_size;
+}
+
+bool retro_serialize(void *data, size_t size)
+{
+   if (size < retro_serialize_size())
+      return false;
+   memcpy(data, counters, sizeof(counters));
+   memcpy((uint8_t*)data + sizeof(counters), memory, memory_size);
+   return true;
+}
+
+bool retro_unserialize(const void *data, size_t size)
+{
+   if (size < retro_serialize_size())
+      return false;
+   memcpy(counters, data, sizeof(counters));
+   memcpy(memory, (const uint8_t*)data + sizeof(counters), memory_size);
+   states_loaded++;
+
+   if (trace_file)
+   {
+      fprintf(trace_file, "%.6f %u\n", test_time(), counters[0]);
+      fflush(trace_file);
+   }
+   return true;
+}
+
+bool retro_load_game(const struct retro_game_info *info)
+{
+   enum retro_pixel_format fmt = RETRO_PIXEL_FORMAT_RGB565;
+   return environ_cb(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &fmt);
+}
+
+bool retro_load_game_special(unsigned type,
+      const struct retro_game_info *info, size_t num)
+{
+   return false;
+}
+
+void retro_unload_game(void) { }
+unsigned retro_get_region(void) { return RETRO_REGION_NTSC; }
+void retro_cheat_reset(void) { }
+void retro_cheat_set(unsigned index, bool enabled, const char *code) { }
+void *retro_get_memory_data(unsigned id) { return NULL; }
+size_t retro_get_memory_size(unsigned id) { return 0; }
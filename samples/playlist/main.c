@@ -0,0 +1,269 @@
+/*  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Playlist round-trip benchmark
+ * > Generates a playlist file with the requested number
+ *   of entries, then repeatedly loads and saves it with
+ *   playlist_init() / playlist_write_file()
+ * > Each saved file must be identical to the generated
+ *   one, which is laid out the way the playlist writer
+ *   lays out its output */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+
+#include <libretro.h>
+#include <boolean.h>
+#include <retro_miscellaneous.h>
+#include <streams/interface_stream.h>
+
+#include "../../playlist.h"
+#include "../../core_info.h"
+#include "../../verbosity.h"
+
+/* playlist.c only needs these for core association
+ * lookups and logging, neither of which is exercised
+ * here */
+void RARCH_LOG(const char *fmt, ...) { }
+
+void RARCH_WARN(const char *fmt, ...)
+{
+   va_list ap;
+   va_start(ap, fmt);
+   vfprintf(stderr, fmt, ap);
+   va_end(ap);
+}
+
+void RARCH_ERR(const char *fmt, ...)
+{
+   va_list ap;
+   va_start(ap, fmt);
+   vfprintf(stderr, fmt, ap);
+   va_end(ap);
+}
+
+bool core_info_find(core_info_ctx_find_t *info) { return false; }
+
+bool core_info_core_file_id_is_equal(const char *core_path_a,
+      const char *core_path_b) { return false; }
+
+typedef struct
+{
+   char *data;
+   size_t size;
+   size_t capacity;
+} out_buf_t;
+
+static void out_printf(out_buf_t *out, const char *fmt, ...)
+{
+   int len;
+   va_list ap;
+
+   for (;;)
+   {
+      va_start(ap, fmt);
+      len = vsnprintf(out->data + out->size,
+            out->capacity - out->size, fmt, ap);
+      va_end(ap);
+
+      if (len >= 0 && out->size + len < out->capacity)
+         break;
+
+      out->capacity = out->capacity ? out->capacity * 2 : 1 << 20;
+      out->data     = (char*)realloc(out->data, out->capacity);
+   }
+
+   out->size += len;
+}
+
+/* Generates the reference playlist. Values contain
+ * escaped and non-ASCII characters, so that string
+ * encoding is covered as well */
+static void generate_playlist(out_buf_t *out,
+      unsigned num_entries, bool compact)
+{
+   unsigned i;
+   const char *nl  = compact ? ""   : "\n";
+   const char *sp  = compact ? ""   : " ";
+   const char *in2 = compact ? ""   : "  ";
+   const char *in4 = compact ? ""   : "    ";
+   const char *in6 = compact ? ""   : "      ";
+
+   out_printf(out, "{%s", nl);
+   out_printf(out, "%s\"version\":%s\"1.4\",%s", in2, sp, nl);
+   out_printf(out, "%s\"default_core_path\":%s\"/cores/default_libretro.so\",%s", in2, sp, nl);
+   out_printf(out, "%s\"default_core_name\":%s\"Default\",%s", in2, sp, nl);
+   out_printf(out, "%s\"label_display_mode\":%s0,%s", in2, sp, nl);
+   out_printf(out, "%s\"right_thumbnail_mode\":%s0,%s", in2, sp, nl);
+   out_printf(out, "%s\"left_thumbnail_mode\":%s0,%s", in2, sp, nl);
+   out_printf(out, "%s\"sort_mode\":%s0,%s", in2, sp, nl);
+   out_printf(out, "%s\"items\":%s[%s", in2, sp, nl);
+
+   for (i = 0; i < num_entries; i++)
+   {
+      out_printf(out, "%s{%s", in4, nl);
+      out_printf(out, "%s\"path\":%s\"/roms/System %u/Game %u (Europe) (En,Fr,De).zip#Game %u.bin\",%s",
+            in6, sp, i % 32, i, i, nl);
+      out_printf(out, "%s\"label\":%s\"Game %u \\\"Pok\xC3\xA9mon\\\" \\\\ \\u2028 (Europe)\",%s",
+            in6, sp, i, nl);
+      out_printf(out, "%s\"core_path\":%s\"/cores/core_%u_libretro.so\",%s",
+            in6, sp, i % 16, nl);
+      out_printf(out, "%s\"core_name\":%s\"Core %u\",%s",
+            in6, sp, i % 16, nl);
+      out_printf(out, "%s\"crc32\":%s\"%08X|crc\",%s",
+            in6, sp, i * 2654435761u, nl);
+      out_printf(out, "%s\"db_name\":%s\"System %u.lpl\"%s",
+            in6, sp, i % 32, nl);
+      out_printf(out, "%s}%s%s",
+            in4, (i < num_entries - 1) ? "," : "", nl);
+   }
+
+   out_printf(out, "%s]%s}%s", in2, nl, nl);
+}
+
+static bool write_file(const char *path, const char *data, size_t size)
+{
+   FILE *file = fopen(path, "wb");
+   bool ret   = false;
+
+   if (!file)
+      return false;
+
+   ret = (fwrite(data, 1, size, file) == size);
+   fclose(file);
+   return ret;
+}
+
+static bool check_file(const char *path, const out_buf_t *expected)
+{
+   char *data   = NULL;
+   int64_t size = 0;
+   bool ret     = false;
+#if defined(HAVE_ZLIB)
+   intfstream_t *file = intfstream_open_rzip_file(path,
+         RETRO_VFS_FILE_ACCESS_READ);
+#else
+   intfstream_t *file = intfstream_open_file(path,
+         RETRO_VFS_FILE_ACCESS_READ, RETRO_VFS_FILE_ACCESS_HINT_NONE);
+#endif
+
+   if (!file)
+      return false;
+
+   if (     (size = intfstream_get_size(file)) == (int64_t)expected->size
+         && (data = (char*)malloc(expected->size + 1))
+         && intfstream_read(file, data, size) == size)
+      ret = !memcmp(data, expected->data, expected->size);
+
+   free(data);
+   intfstream_close(file);
+   free(file);
+   return ret;
+}
+
+static double elapsed_ms(clock_t start)
+{
+   return (double)(clock() - start) * 1000.0 / CLOCKS_PER_SEC;
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned i;
+   playlist_config_t config;
+   out_buf_t reference   = {0};
+   out_buf_t compact     = {0};
+   double read_ms        = 0.0;
+   double write_ms       = 0.0;
+   unsigned num_entries  = 50000;
+   unsigned iterations   = 5;
+   bool compress         = false;
+   const char *path      = NULL;
+
+   if (argc < 2)
+   {
+      fprintf(stderr, "Usage: %s <playlist file> [entries] [iterations] [compress]\n", argv[0]);
+      return 1;
+   }
+
+   path = argv[1];
+   if (argc > 2)
+      num_entries = (unsigned)strtoul(argv[2], NULL, 10);
+   if (argc > 3)
+      iterations  = (unsigned)strtoul(argv[3], NULL, 10);
+   if (argc > 4)
+      compress    = !!strtoul(argv[4], NULL, 10);
+
+   if (!num_entries || !iterations)
+      return 1;
+
+   memset(&config, 0, sizeof(config));
+   config.capacity = num_entries;
+   config.compress = compress;
+   playlist_config_set_path(&config, path);
+
+   generate_playlist(&reference, num_entries, false);
+   if (compress)
+      generate_playlist(&compact, num_entries, true);
+
+   if (!write_file(path, reference.data, reference.size))
+   {
+      fprintf(stderr, "Could not write %s\n", path);
+      return 1;
+   }
+
+   for (i = 0; i < iterations; i++)
+   {
+      enum playlist_sort_mode sort_mode;
+      clock_t start        = clock();
+      playlist_t *playlist = playlist_init(&config);
+
+      read_ms += elapsed_ms(start);
+
+      if (!playlist || playlist_size(playlist) != num_entries)
+      {
+         fprintf(stderr, "Failed to load %u entries\n", num_entries);
+         return 1;
+      }
+
+      /* Force a save without changing the contents */
+      sort_mode = playlist_get_sort_mode(playlist);
+      playlist_set_sort_mode(playlist, PLAYLIST_SORT_MODE_OFF);
+      playlist_set_sort_mode(playlist, PLAYLIST_SORT_MODE_ALPHABETICAL);
+      playlist_set_sort_mode(playlist, sort_mode);
+
+      start     = clock();
+      playlist_write_file(playlist);
+      write_ms += elapsed_ms(start);
+
+      playlist_free(playlist);
+
+      if (!check_file(path, compress ? &compact : &reference))
+      {
+         fprintf(stderr, "Saved playlist differs from the original\n");
+         return 1;
+      }
+   }
+
+   printf("%u entries, %u bytes%s\n", num_entries,
+         (unsigned)reference.size, compress ? " (compressed)" : "");
+   printf("read:  %8.2f ms\n", read_ms  / iterations);
+   printf("write: %8.2f ms\n", write_ms / iterations);
+
+   free(reference.data);
+   free(compact.data);
+   return 0;
+}
@@ -0,0 +1,447 @@
+/*  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Softfilter golden-image test and benchmark
+ * > Loads the plugin named by each .filt file the way
+ *   gfx/video_filter.c does, and runs it over a fixed
+ *   pseudo-random frame in every input format it takes
+ * > The CRC of the first output frame must match the one
+ *   stored in the checksum file, both when the frame is
+ *   done in one band and when it is cut into many. Bands
+ *   are run last to first, so a band that depends on the
+ *   output of another shows up as a mismatch
+ * > Then reports the time per frame of a single band */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <boolean.h>
+#include <retro_miscellaneous.h>
+#include <dynamic/dylib.h>
+#include <encodings/crc32.h>
+#include <features/features_cpu.h>
+#include <file/config_file.h>
+#include <file/config_file_userdata.h>
+#include <file/file_path.h>
+#include <string/stdstring.h>
+
+#include "../../gfx/video_filters/softfilter.h"
+
+#if defined(_WIN32)
+#define PLUGIN_EXT "dll"
+#elif defined(__APPLE__)
+#define PLUGIN_EXT "dylib"
+#else
+#define PLUGIN_EXT "so"
+#endif
+
+#define FRAME_WIDTH   320
+#define FRAME_HEIGHT  240
+/* Extra pixels at the end of each input row and extra
+ * rows around the frame, so that strides are exercised
+ * and reads just outside the frame stay deterministic.
+ * The rows repeat the first and last rows of the frame,
+ * so a filter reading a row past the edge gives the same
+ * image as one clamping to it */
+#define FRAME_PAD     16
+#define FRAME_BANDS   16
+#define FRAME_COUNT   100
+
+/* Written after each output to catch overruns */
+#define GUARD_BYTE    0xa5
+#define GUARD_SIZE    64
+
+static const struct softfilter_config softfilter_config = {
+   config_userdata_get_float,
+   config_userdata_get_int,
+   config_userdata_get_hex,
+   config_userdata_get_float_array,
+   config_userdata_get_int_array,
+   config_userdata_get_string,
+   config_userdata_free,
+};
+
+struct filter_run
+{
+   const struct softfilter_implementation *impl;
+   struct config_file_userdata *userdata;
+   softfilter_simd_mask_t simd;
+   unsigned in_fmt;
+   unsigned out_fmt;
+   const uint8_t *input;
+   size_t input_stride;
+   uint8_t *output;
+   size_t output_stride;
+   unsigned out_width;
+   unsigned out_height;
+};
+
+/* Flat 8x8 tiles from a small palette with some noise on
+ * top, so that the edge detecting filters take both their
+ * "equal neighbours" and "different neighbours" paths */
+static uint8_t *make_frame(unsigned fmt, size_t *stride)
+{
+   unsigned x, y;
+   uint32_t seed      = 0x1234567;
+   unsigned bpp       = (fmt == SOFTFILTER_FMT_RGB565)
+      ? SOFTFILTER_BPP_RGB565 : SOFTFILTER_BPP_XRGB8888;
+   unsigned pitch     = FRAME_WIDTH + FRAME_PAD;
+   unsigned rows      = FRAME_HEIGHT + 2 * FRAME_PAD;
+   uint8_t *frame     = (uint8_t*)malloc(pitch * rows * bpp);
+   static const uint32_t palette[] = {
+      0x000000, 0xffffff, 0xff0000, 0x00ff00,
+      0x0000ff, 0xffff00, 0x808080, 0x204060,
+   };
+
+   if (!frame)
+      return NULL;
+
+   for (y = 0; y < rows; y++)
+   {
+      for (x = 0; x < pitch; x++)
+      {
+         uint32_t color;
+
+         seed  = seed * 1103515245 + 12345;
+         color = palette[((x >> 3) * 3 + (y >> 3) * 5) & 7];
+         if (((seed >> 16) & 7) == 0)
+            color = seed & 0xffffff;
+
+         if (bpp == SOFTFILTER_BPP_RGB565)
+            ((uint16_t*)frame)[y * pitch + x] = (uint16_t)
+                 (((color >> 8) & 0xf800)
+                | ((color >> 5) & 0x07e0)
+                | ((color >> 3) & 0x001f));
+         else
+            ((uint32_t*)frame)[y * pitch + x] = color;
+      }
+   }
+
+   for (y = 0; y < FRAME_PAD; y++)
+   {
+      memcpy(frame + y * pitch * bpp,
+            frame + FRAME_PAD * pitch * bpp, pitch * bpp);
+      memcpy(frame + (rows - 1 - y) * pitch * bpp,
+            frame + (rows - 1 - FRAME_PAD) * pitch * bpp, pitch * bpp);
+   }
+
+   *stride = pitch * bpp;
+   return frame;
+}
+
+static unsigned fmt_bpp(unsigned fmt)
+{
+   return (fmt == SOFTFILTER_FMT_RGB565)
+      ? SOFTFILTER_BPP_RGB565 : SOFTFILTER_BPP_XRGB8888;
+}
+
+/* Creates a filter instance cut into @bands and processes
+ * @frames frames with it. Returns the CRC of the first one
+ * or 0 on failure. */
+static uint32_t run_filter(struct filter_run *run, unsigned bands,
+      unsigned frames, retro_time_t *usec)
+{
+   unsigned i, f, num_packets;
+   uint32_t crc                          = 0;
+   retro_time_t start                    = 0;
+   struct softfilter_work_packet *packets = NULL;
+   void *data = run->impl->create(&softfilter_config,
+         run->in_fmt, run->in_fmt, FRAME_WIDTH, FRAME_HEIGHT,
+         bands, run->simd, run->userdata);
+
+   if (!data)
+      return 0;
+
+   num_packets = run->impl->query_num_threads(data);
+   if (!num_packets || !(packets = (struct softfilter_work_packet*)
+         calloc(num_packets, sizeof(*packets))))
+      goto end;
+
+   for (f = 0; f < frames; f++)
+   {
+      if (f == 1)
+         start = cpu_features_get_time_usec();
+
+      run->impl->get_work_packets(data, packets, run->output,
+            run->output_stride, run->input,
+            FRAME_WIDTH, FRAME_HEIGHT, run->input_stride);
+
+      for (i = num_packets; i-- > 0; )
+         if (packets[i].work)
+            packets[i].work(data, packets[i].thread_data);
+
+      if (f == 0)
+      {
+         unsigned y;
+         size_t row_size = run->out_width * fmt_bpp(run->out_fmt);
+
+         crc = encoding_crc32(0, (const uint8_t*)"", 0);
+         for (y = 0; y < run->out_height; y++)
+            crc = encoding_crc32(crc,
+                  run->output + y * run->output_stride, row_size);
+      }
+   }
+
+   if (usec && frames > 1)
+      *usec = (cpu_features_get_time_usec() - start) / (frames - 1);
+
+end:
+   free(packets);
+   run->impl->destroy(data);
+   return crc;
+}
+
+static bool check_guard(const uint8_t *guard)
+{
+   unsigned i;
+   for (i = 0; i < GUARD_SIZE; i++)
+      if (guard[i] != GUARD_BYTE)
+         return false;
+   return true;
+}
+
+/* Returns the stored CRC for @key, or 0 if there is none */
+static uint32_t ref_lookup(config_file_t *ref, const char *key)
+{
+   unsigned value = 0;
+   if (ref && config_get_hex(ref, key, &value))
+      return value;
+   return 0;
+}
+
+/* Returns the number of failed checks */
+static unsigned test_filter(const char *filt_path,
+      config_file_t *ref, bool ref_write, unsigned bands,
+      unsigned frames)
+{
+   unsigned f;
+   char name[64];
+   char plugin[PATH_MAX_LENGTH];
+   char plugin_dir[PATH_MAX_LENGTH];
+   struct config_file_userdata userdata;
+   unsigned failed                              = 0;
+   const char *filt_name                        = path_basename(filt_path);
+   const struct softfilter_implementation *impl = NULL;
+   softfilter_get_implementation_t cb           = NULL;
+   softfilter_simd_mask_t simd                  =
+      (softfilter_simd_mask_t)cpu_features_get();
+   dylib_t lib                                  = NULL;
+   config_file_t *conf                          =
+      config_file_new_from_path_to_string(filt_path);
+
+   name[0] = '\0';
+
+   if (!conf || !config_get_array(conf, "filter", name, sizeof(name)))
+   {
+      fprintf(stderr, "%s: no 'filter' in config.\n", filt_name);
+      failed++;
+      goto end;
+   }
+
+   /* Plugins are named after their short ident */
+   fill_pathname_basedir(plugin_dir, filt_path, sizeof(plugin_dir));
+   fill_pathname_join(plugin, plugin_dir, name, sizeof(plugin));
+   strlcat(plugin, "." PLUGIN_EXT, sizeof(plugin));
+
+   if (    !(lib  = dylib_load(plugin))
+        || !(cb   = (softfilter_get_implementation_t)
+              dylib_proc(lib, "softfilter_get_implementation"))
+        || !(impl = cb(simd))
+        || impl->api_version != SOFTFILTER_API_VERSION)
+   {
+      fprintf(stderr, "%s: can't load %s.\n", filt_name, plugin);
+      failed++;
+      goto end;
+   }
+
+   userdata.conf      = conf;
+   userdata.prefix[0] = "filter";
+   userdata.prefix[1] = impl->short_ident;
+
+   for (f = SOFTFILTER_FMT_RGB565; f <= SOFTFILTER_FMT_XRGB8888; f <<= 1)
+   {
+      char key[128];
+      unsigned max_width, max_height;
+      retro_time_t usec     = 0;
+      uint32_t crc, crc_bands, crc_ref;
+      unsigned output_fmts;
+      struct filter_run run;
+      size_t output_size;
+      uint8_t *frame        = NULL;
+
+      if (!(impl->query_input_formats() & f))
+         continue;
+
+      memset(&run, 0, sizeof(run));
+      run.impl     = impl;
+      run.userdata = &userdata;
+      run.simd     = simd;
+      run.in_fmt   = f;
+
+      /* Same choice as create_softfilter_graph() */
+      output_fmts = impl->query_output_formats(f);
+      if (output_fmts & f)
+         run.out_fmt = f;
+      else if (output_fmts & SOFTFILTER_FMT_XRGB8888)
+         run.out_fmt = SOFTFILTER_FMT_XRGB8888;
+      else
+         run.out_fmt = SOFTFILTER_FMT_RGB565;
+
+      snprintf(key, sizeof(key), "%s_%s", filt_name,
+            (f == SOFTFILTER_FMT_RGB565) ? "rgb565" : "xrgb8888");
+      string_replace_all_chars(key, '.', '_');
+      string_replace_all_chars(key, '-', '_');
+
+      if (!(frame = make_frame(f, &run.input_stride)))
+         break;
+      run.input = frame + FRAME_PAD * run.input_stride;
+
+      /* query_output_size() needs an instance */
+      {
+         void *data = impl->create(&softfilter_config, f, f,
+               FRAME_WIDTH, FRAME_HEIGHT, 1, simd, &userdata);
+         if (!data)
+         {
+            fprintf(stderr, "%s: create() failed.\n", key);
+            failed++;
+            free(frame);
+            continue;
+         }
+         impl->query_output_size(data, &max_width, &max_height,
+               FRAME_WIDTH, FRAME_HEIGHT);
+         impl->destroy(data);
+      }
+
+      run.out_width     = max_width;
+      run.out_height    = max_height;
+      run.output_stride = max_width * fmt_bpp(run.out_fmt);
+      output_size       = run.output_stride * max_height;
+
+      if (!(run.output = (uint8_t*)malloc(output_size + GUARD_SIZE)))
+      {
+         free(frame);
+         break;
+      }
+      memset(run.output, 0, output_size);
+      memset(run.output + output_size, GUARD_BYTE, GUARD_SIZE);
+
+      crc       = run_filter(&run, 1, frames, &usec);
+      memset(run.output, 0, output_size);
+      crc_bands = run_filter(&run, bands, 1, NULL);
+      crc_ref   = ref_lookup(ref, key);
+
+      if (!check_guard(run.output + output_size))
+      {
+         fprintf(stderr, "%s: wrote past the end of the frame.\n", key);
+         failed++;
+      }
+      else if (ref_write)
+      {
+         char value[16];
+         snprintf(value, sizeof(value), "0x%08x", (unsigned)crc);
+         config_set_string(ref, key, value);
+      }
+      else if (!crc_ref)
+      {
+         fprintf(stderr, "%s: no checksum stored.\n", key);
+         failed++;
+      }
+      else if (crc != crc_ref)
+      {
+         fprintf(stderr, "%s: checksum 0x%08x, expected 0x%08x.\n",
+               key, (unsigned)crc, (unsigned)crc_ref);
+         failed++;
+      }
+
+      if (crc_bands != crc)
+      {
+         fprintf(stderr, "%s: output differs when cut into %u bands.\n",
+               key, bands);
+         failed++;
+      }
+
+      printf("%-44s %ux%u -> %ux%u %8.3f ms/frame\n", key,
+            FRAME_WIDTH, FRAME_HEIGHT, max_width, max_height,
+            usec / 1000.0);
+
+      free(run.output);
+      free(frame);
+   }
+
+end:
+   if (lib)
+      dylib_close(lib);
+   if (conf)
+      config_file_free(conf);
+   return failed;
+}
+
+int main(int argc, char *argv[])
+{
+   int i;
+   unsigned failed    = 0;
+   unsigned bands     = FRAME_BANDS;
+   unsigned frames    = FRAME_COUNT;
+   bool ref_write     = false;
+   const char *ref_path = NULL;
+   config_file_t *ref = NULL;
+
+   for (i = 1; i < argc && argv[i][0] == '-'; i++)
+   {
+      if (!strcmp(argv[i], "-w"))
+         ref_write = true;
+      else if (!strcmp(argv[i], "-b") && i + 1 < argc)
+         bands  = strtoul(argv[++i], NULL, 0);
+      else if (!strcmp(argv[i], "-n") && i + 1 < argc)
+         frames = strtoul(argv[++i], NULL, 0);
+      else
+         break;
+   }
+
+   if (argc - i < 2 || !bands || !frames)
+   {
+      fprintf(stderr, "Usage: %s [-w] [-b bands] [-n frames] "
+            "<checksum file> <.filt file>...\n", argv[0]);
+      return 1;
+   }
+
+   ref_path = argv[i++];
+   if (ref_write)
+      ref = config_file_new_alloc();
+   else if (!(ref = config_file_new_from_path_to_string(ref_path)))
+   {
+      fprintf(stderr, "Can't open %s.\n", ref_path);
+      return 1;
+   }
+
+   for (; i < argc; i++)
+      failed += test_filter(argv[i], ref, ref_write, bands, frames);
+
+   if (ref_write && !config_file_write(ref, ref_path, true))
+   {
+      fprintf(stderr, "Can't write %s.\n", ref_path);
+      failed++;
+   }
+
+   config_file_free(ref);
+
+   if (failed)
+   {
+      fprintf(stderr, "%u check(s) failed.\n", failed);
+      return 1;
+   }
+
+   return 0;
+}
@@ -49,6 +49,14 @@
 #include "../config.h"
 #endif
 
+#if defined(HAVE_MMAP) && !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <memmap.h>
+#define HAVE_CONTENT_MMAP
+#endif
+
 #include <boolean.h>
 
 #include <encodings/crc32.h>
@@ -177,6 +185,7 @@ struct content_information_ctx
 
    bool block_extract;
    bool need_fullpath;
+   bool mmap_content;
    bool set_supports_no_game_enable;
 #ifdef HAVE_PATCH
    bool is_ips_pref;
@@ -479,6 +488,160 @@ static int64_t content_file_read(const char *path, void **buf, int64_t *length)
    return filestream_read_file(path, buf, length);
 }
 
+#ifdef HAVE_CONTENT_MMAP
+/**
+ * content_file_mmap:
+ * @path         : path of the content file.
+ * @buf          : mapped content of the file.
+ * @length       : size of the content file.
+ *
+ * Maps an uncompressed content file into memory instead of
+ * copying it into a heap buffer. The mapping is private, so
+ * pages are only read in as the core touches them, and any
+ * write to the buffer is copy-on-write and never reaches the
+ * file on disk.
+ *
+ * Returns: true if successful, false if the content should
+ * be read the regular way instead.
+ **/
+static bool content_file_mmap(const char *path, void **buf, int64_t *length)
+{
+   struct stat st;
+   void *mapped = MAP_FAILED;
+   int fd       = open(path, O_RDONLY);
+
+   if (fd < 0)
+      return false;
+
+   if (     fstat(fd, &st) == 0
+         && S_ISREG(st.st_mode)
+         && st.st_size > 0)
+      mapped = mmap(NULL, (size_t)st.st_size,
+            PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+
+   close(fd);
+
+   if (mapped == MAP_FAILED)
+      return false;
+
+#ifdef MADV_SEQUENTIAL
+   /* Cores almost always copy or checksum content front to back */
+   madvise(mapped, (size_t)st.st_size, MADV_SEQUENTIAL);
+#endif
+
+   *buf    = mapped;
+   *length = st.st_size;
+
+   return true;
+}
+#endif
+
+/* Returns true if the current core's info file allows
+ * its content to be memory mapped instead of read */
+static bool content_core_wants_mmap(void)
+{
+#ifdef HAVE_CONTENT_MMAP
+   core_info_t *core_info = NULL;
+
+   if (core_info_get_current_core(&core_info) && core_info)
+      return core_info->mmap_content;
+#endif
+   return false;
+}
+
+static void content_file_free_data(void *data, int64_t length, bool mapped)
+{
+   if (!data)
+      return;
+
+#ifdef HAVE_CONTENT_MMAP
+   if (mapped)
+   {
+      munmap(data, (size_t)length);
+      return;
+   }
+#endif
+
+   free(data);
+}
+
+typedef struct content_crc_state
+{
+   uint32_t crc;
+   char path[PATH_MAX_LENGTH];
+} content_crc_state_t;
+
+static void task_content_crc_handler(retro_task_t *task)
+{
+   content_crc_state_t *state = (content_crc_state_t*)task->state;
+
+   state->crc = file_crc32(0, state->path);
+
+   task_set_progress(task, 100);
+   task_set_finished(task, true);
+}
+
+static void task_content_crc_callback(retro_task_t *task,
+      void *task_data,
+      void *user_data, const char *error)
+{
+   content_crc_state_t *state = (content_crc_state_t*)task->state;
+   content_state_t *p_content = content_state_get_ptr();
+
+   if (!state)
+      return;
+
+   /* Only apply the result if the CRC is still pending
+    * for the same content - it may have been requested
+    * (and computed synchronously) in the meantime, or
+    * the content may have been unloaded. */
+   if (     p_content->pending_rom_crc
+         && string_is_equal(p_content->pending_rom_crc_path, state->path))
+   {
+      p_content->pending_rom_crc = false;
+      p_content->rom_crc         = state->crc;
+      RARCH_LOG("[CONTENT LOAD]: CRC32: 0x%x .\n",
+            (unsigned)p_content->rom_crc);
+   }
+
+   free(state);
+}
+
+/**
+ * task_push_content_crc:
+ * @path         : path of the content file.
+ *
+ * Computes the CRC32 of a content file that was not
+ * read into memory by the frontend on a background task,
+ * so that the pending CRC is usually ready before anyone
+ * asks for it. content_get_crc() still computes it on the
+ * spot if the task has not finished yet.
+ **/
+static void task_push_content_crc(const char *path)
+{
+   retro_task_t *task         = NULL;
+   content_crc_state_t *state = (content_crc_state_t*)
+      calloc(1, sizeof(*state));
+
+   if (!state)
+      return;
+
+   if (!(task = task_init()))
+   {
+      free(state);
+      return;
+   }
+
+   strlcpy(state->path, path, sizeof(state->path));
+
+   task->state    = state;
+   task->handler  = task_content_crc_handler;
+   task->callback = task_content_crc_callback;
+   task->mute     = true;
+
+   task_queue_push(task);
+}
+
 /**
  * content_load_init_wrap:
  * @args                 : Input arguments.
@@ -661,24 +824,42 @@ static bool content_load(content_ctx_info_t *info,
  * @path         : buffer of the content file.
  * @buf          : size   of the content file.
  * @length       : size of the content file that has been read from.
+ * @mapped       : set to true if @buf is a memory mapping of the
+ *                 file rather than a heap buffer.
  *
  * Read the content file. If read into memory, also performs soft patching
  * (see patch_content function) in case soft patching has not been
  * blocked by the enduser.
  *
+ * If the core opted into it through its core info file, uncompressed
+ * content is memory mapped instead of read. Patching a mapped file
+ * leaves the mapping untouched and produces a regular heap buffer.
+ *
  * Returns: true if successful, false on error.
  **/
 static bool load_content_into_memory(
       content_information_ctx_t *content_ctx,
       content_state_t *p_content,
       unsigned i, const char *path, void **buf,
-      int64_t *length)
+      int64_t *length, bool *mapped)
 {
    uint8_t *ret_buf           = NULL;
 
    RARCH_LOG("[CONTENT LOAD]: %s: %s.\n",
          msg_hash_to_str(MSG_LOADING_CONTENT_FILE), path);
 
+   *mapped                    = false;
+
+#ifdef HAVE_CONTENT_MMAP
+   if (     content_ctx->mmap_content
+         && !path_contains_compressed_file(path)
+         && content_file_mmap(path, (void**)&ret_buf, length))
+   {
+      RARCH_LOG("[CONTENT LOAD]: Content file is memory mapped.\n");
+      *mapped                 = true;
+   }
+   else
+#endif
    if (!content_file_read(path, (void**) &ret_buf, length))
       return false;
 
@@ -693,7 +874,9 @@ static bool load_content_into_memory(
       if (type == RARCH_CONTENT_NONE)
       {
 #ifdef HAVE_PATCH
-         bool has_patch = false;
+         bool has_patch       = false;
+         uint8_t *source_buf  = ret_buf;
+         int64_t source_len   = *length;
 
          /* First content file is significant, attempt to do patching,
           * CRC checking, etc. */
@@ -710,6 +893,14 @@ static bool load_content_into_memory(
                   (uint8_t**)&ret_buf,
                   (void*)length);
 
+         /* A successful patch leaves the source untouched and
+          * returns a newly allocated buffer */
+         if (ret_buf != source_buf)
+         {
+            content_file_free_data(source_buf, source_len, *mapped);
+            *mapped = false;
+         }
+
          if (has_patch)
          {
             p_content->rom_crc = encoding_crc32(0, ret_buf, (size_t)*length);
@@ -721,6 +912,11 @@ static bool load_content_into_memory(
             strlcpy(p_content->pending_rom_crc_path,
                   path, sizeof(p_content->pending_rom_crc_path));
             p_content->pending_rom_crc      = true;
+
+            /* The frontend never reads mapped content itself,
+             * so get the CRC ready in the background */
+            if (*mapped)
+               task_push_content_crc(path);
          }
       }
       else
@@ -883,7 +1079,8 @@ static bool content_file_load(
       enum msg_hash_enums *error_enum,
       char **error_string,
       const struct retro_subsystem_info *special,
-      struct string_list *additional_path_allocs
+      struct string_list *additional_path_allocs,
+      bool *content_mapped
       )
 {
    unsigned i;
@@ -920,7 +1117,8 @@ static bool content_file_load(
 
          if (!load_content_into_memory(
                   content_ctx, p_content,
-                  i, path, (void**)&info[i].data, &len))
+                  i, path, (void**)&info[i].data, &len,
+                  &content_mapped[i]))
          {
             char msg[1024];
             msg[0]          = '\0';
@@ -1200,6 +1398,7 @@ static bool content_file_init(
 {
    union string_list_elem_attr attr;
    struct retro_game_info               *info = NULL;
+   bool                       *content_mapped = NULL;
    bool subsystem_path_is_empty               = path_is_empty(RARCH_PATH_SUBSYSTEM);
    bool ret                                   = subsystem_path_is_empty;
    const struct retro_subsystem_info *special =
@@ -1216,10 +1415,14 @@ static bool content_file_init(
 #endif
 
    if (content->size > 0)
+   {
       info                   = (struct retro_game_info*)
          calloc(content->size, sizeof(*info));
+      content_mapped         = (bool*)
+         calloc(content->size, sizeof(*content_mapped));
+   }
 
-   if (info)
+   if (info && content_mapped)
    {
       unsigned i;
       struct string_list additional_path_allocs;
@@ -1229,19 +1432,30 @@ static bool content_file_init(
          ret = content_file_load(info, p_content,
                content, content_ctx, error_enum,
                error_string,
-               special, &additional_path_allocs);
+               special, &additional_path_allocs,
+               content_mapped);
          string_list_deinitialize(&additional_path_allocs);
       }
 
       for (i = 0; i < content->size; i++)
-         free((void*)info[i].data);
+         content_file_free_data((void*)info[i].data,
+               (int64_t)info[i].size, content_mapped[i]);
 
+      free(content_mapped);
       free(info);
    }
-   else if (!special)
+   else
    {
-      *error_enum   = MSG_ERROR_LIBRETRO_CORE_REQUIRES_CONTENT;
-      return false;
+      if (content_mapped)
+         free(content_mapped);
+      if (info)
+         free(info);
+
+      if (!special)
+      {
+         *error_enum   = MSG_ERROR_LIBRETRO_CORE_REQUIRES_CONTENT;
+         return false;
+      }
    }
 
    return ret;
@@ -1395,7 +1609,8 @@ static void task_push_to_history_list(
             entry.subsystem_name  = (char*)subsystem_name;
             entry.subsystem_roms  = (struct string_list*)path_get_subsystem_list();
 
-            command_playlist_push_write(playlist_hist, &entry);
+            if (playlist_push(playlist_hist, &entry))
+               task_push_playlist_write(playlist_hist);
          }
       }
    }
@@ -1523,6 +1738,7 @@ bool task_push_start_dummy_core(content_ctx_info_t *content_info)
    content_ctx.valid_extensions               = NULL;
    content_ctx.block_extract                  = false;
    content_ctx.need_fullpath                  = false;
+   content_ctx.mmap_content                   = false;
    content_ctx.set_supports_no_game_enable    = false;
 
    content_ctx.subsystem.data                 = NULL;
@@ -1620,6 +1836,7 @@ bool task_push_load_content_from_playlist_from_menu(
    content_ctx.valid_extensions               = NULL;
    content_ctx.block_extract                  = false;
    content_ctx.need_fullpath                  = false;
+   content_ctx.mmap_content                   = false;
    content_ctx.set_supports_no_game_enable    = false;
 
    content_ctx.subsystem.data                 = NULL;
@@ -1762,6 +1979,7 @@ bool task_push_start_current_core(content_ctx_info_t *content_info)
    content_ctx.valid_extensions               = NULL;
    content_ctx.block_extract                  = false;
    content_ctx.need_fullpath                  = false;
+   content_ctx.mmap_content                   = false;
    content_ctx.set_supports_no_game_enable    = false;
 
    content_ctx.subsystem.data                 = NULL;
@@ -1902,6 +2120,7 @@ bool task_push_load_content_with_new_core_from_menu(
    content_ctx.valid_extensions               = NULL;
    content_ctx.block_extract                  = false;
    content_ctx.need_fullpath                  = false;
+   content_ctx.mmap_content                   = false;
    content_ctx.set_supports_no_game_enable    = false;
 
    content_ctx.subsystem.data                 = NULL;
@@ -2013,6 +2232,7 @@ static bool task_load_content_internal(
    content_ctx.valid_extensions               = NULL;
    content_ctx.block_extract                  = false;
    content_ctx.need_fullpath                  = false;
+   content_ctx.mmap_content                   = false;
    content_ctx.set_supports_no_game_enable    = false;
 
    content_ctx.subsystem.data                 = NULL;
@@ -2031,6 +2251,7 @@ static bool task_load_content_internal(
 
       content_ctx.block_extract               = system->block_extract;
       content_ctx.need_fullpath               = system->need_fullpath;
+      content_ctx.mmap_content                = content_core_wants_mmap();
 
       content_ctx.subsystem.data              = sys_info->subsystem.data;
       content_ctx.subsystem.size              = sys_info->subsystem.size;
@@ -2509,6 +2730,7 @@ bool content_init(void)
    content_ctx.valid_extensions               = NULL;
    content_ctx.block_extract                  = false;
    content_ctx.need_fullpath                  = false;
+   content_ctx.mmap_content                   = false;
    content_ctx.set_supports_no_game_enable    = false;
 
    content_ctx.subsystem.data                 = NULL;
@@ -2539,6 +2761,7 @@ bool content_init(void)
 
       content_ctx.block_extract               = system->block_extract;
       content_ctx.need_fullpath               = system->need_fullpath;
+      content_ctx.mmap_content                = content_core_wants_mmap();
 
       content_ctx.subsystem.data              = sys_info->subsystem.data;
       content_ctx.subsystem.size              = sys_info->subsystem.size;
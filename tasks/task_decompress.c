@@ -21,12 +21,265 @@
 #include <retro_miscellaneous.h>
 #include <compat/strl.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#include <rthreads/tpool.h>
+#include <features/features_cpu.h>
+#endif
+
 #include "tasks_internal.h"
 #include "../file_path_special.h"
 #include "../msg_hash.h"
 
 #define CALLBACK_ERROR_SIZE 4200
 
+#ifdef HAVE_THREADS
+/* Maximum number of members queued per extraction thread
+ * before the directory walk waits for them to complete */
+#define DECOMPRESS_JOBS_PER_THREAD 4
+
+typedef struct decompress_parallel decompress_parallel_t;
+
+typedef struct decompress_job
+{
+   decompress_parallel_t *parallel;
+   const uint8_t *cdata;
+   unsigned cmode;
+   uint32_t csize;
+   uint32_t size;
+   uint32_t crc32;
+   char path[PATH_MAX_LENGTH];
+} decompress_job_t;
+
+/* Members of an archive are independent of each other, so
+ * when the archive backend allows it they are extracted on
+ * a pool of threads, each with its own decompression
+ * context, while the task keeps walking the directory. */
+struct decompress_parallel
+{
+   file_archive_transfer_t *transfer;
+   tpool_t *pool;
+   slock_t *lock;
+   scond_t *cond;
+   void   **contexts; /* idle decompression contexts */
+   char    *error;
+   size_t   num_contexts;
+   unsigned num_threads;
+   unsigned pending;
+};
+
+static void decompress_parallel_worker(void *data)
+{
+   decompress_job_t       *job = (decompress_job_t*)data;
+   decompress_parallel_t  *par = job->parallel;
+   void               *context = NULL;
+   bool                     ok = false;
+
+   /* There is one context per thread, so there is
+    * always an idle one when a job starts */
+   slock_lock(par->lock);
+   context = par->contexts[--par->num_contexts];
+   slock_unlock(par->lock);
+
+   ok = file_archive_extract_member(par->transfer, context,
+         job->path, job->cdata, job->cmode, job->csize,
+         job->size, job->crc32);
+
+   slock_lock(par->lock);
+   par->contexts[par->num_contexts++] = context;
+   if (!ok && !par->error)
+   {
+      par->error = (char*)malloc(CALLBACK_ERROR_SIZE);
+      snprintf(par->error, CALLBACK_ERROR_SIZE,
+            "Failed to deflate %s.\n", job->path);
+   }
+   par->pending--;
+   scond_signal(par->cond);
+   slock_unlock(par->lock);
+
+   free(job);
+}
+
+static void decompress_parallel_free(decompress_parallel_t *par)
+{
+   size_t i;
+
+   if (!par)
+      return;
+
+   if (par->pool)
+   {
+      tpool_wait(par->pool);
+      tpool_destroy(par->pool);
+   }
+
+   for (i = 0; i < par->num_contexts; i++)
+      file_archive_stream_context_free(par->transfer, par->contexts[i]);
+
+   if (par->cond)
+      scond_free(par->cond);
+   if (par->lock)
+      slock_free(par->lock);
+   if (par->error)
+      free(par->error);
+   free(par->contexts);
+   free(par);
+}
+
+static decompress_parallel_t *decompress_parallel_new(
+      file_archive_transfer_t *transfer)
+{
+   unsigned i;
+   decompress_parallel_t *par = NULL;
+   unsigned num_threads       = cpu_features_get_core_amount();
+
+   if (num_threads < 2)
+      return NULL;
+
+   par = (decompress_parallel_t*)calloc(1, sizeof(*par));
+   if (!par)
+      return NULL;
+
+   par->transfer = transfer;
+   par->contexts = (void**)calloc(num_threads, sizeof(*par->contexts));
+
+   if (!par->contexts)
+      goto error;
+
+   for (i = 0; i < num_threads; i++)
+   {
+      void *context = file_archive_stream_context_new(transfer);
+
+      if (!context)
+         goto error;
+
+      par->contexts[par->num_contexts++] = context;
+   }
+
+   par->lock        = slock_new();
+   par->cond        = scond_new();
+   par->num_threads = num_threads;
+
+   if (!par->lock || !par->cond)
+      goto error;
+
+   if (!(par->pool = tpool_create(num_threads)))
+      goto error;
+
+   return par;
+
+error:
+   decompress_parallel_free(par);
+   return NULL;
+}
+
+/* Queues a member for extraction, waiting for earlier
+ * members to finish if too many are in flight already */
+static bool decompress_parallel_push(decompress_parallel_t *par,
+      const char *path, const uint8_t *cdata, unsigned cmode,
+      uint32_t csize, uint32_t size, uint32_t crc32)
+{
+   decompress_job_t *job = (decompress_job_t*)calloc(1, sizeof(*job));
+
+   if (!job)
+      return false;
+
+   job->parallel = par;
+   job->cdata    = cdata;
+   job->cmode    = cmode;
+   job->csize    = csize;
+   job->size     = size;
+   job->crc32    = crc32;
+   strlcpy(job->path, path, sizeof(job->path));
+
+   slock_lock(par->lock);
+   while (par->pending >= par->num_threads * DECOMPRESS_JOBS_PER_THREAD)
+      scond_wait(par->cond, par->lock);
+   par->pending++;
+   slock_unlock(par->lock);
+
+   if (!tpool_add_work(par->pool, decompress_parallel_worker, job))
+   {
+      slock_lock(par->lock);
+      par->pending--;
+      slock_unlock(par->lock);
+      free(job);
+      return false;
+   }
+
+   return true;
+}
+
+/* Waits for all queued members, then releases the pool.
+ * Must be called before the archive transfer is stopped,
+ * since the contexts read from its mapping.
+ * Returns the first extraction error, if any. */
+static char *decompress_parallel_finish(decompress_state_t *dec)
+{
+   char *error                = NULL;
+   decompress_parallel_t *par = (decompress_parallel_t*)
+      dec->userdata->cb_data;
+
+   if (!par)
+      return NULL;
+
+   tpool_wait(par->pool);
+
+   error                  = par->error;
+   par->error             = NULL;
+   dec->userdata->cb_data = NULL;
+
+   decompress_parallel_free(par);
+
+   return error;
+}
+#endif
+
+/* Extracts a single archive member to 'path', either
+ * right away or on the extraction thread pool */
+static bool task_decompress_member(const char *path,
+      const char *valid_exts,
+      const uint8_t *cdata,
+      unsigned cmode, uint32_t csize, uint32_t size,
+      uint32_t crc32, struct archive_extract_userdata *userdata)
+{
+#ifdef HAVE_THREADS
+   decompress_parallel_t *par = (decompress_parallel_t*)userdata->cb_data;
+
+   if (!par && !userdata->dec->parallel_unsupported)
+   {
+      if (!(par = decompress_parallel_new(userdata->transfer)))
+         userdata->dec->parallel_unsupported = true;
+      userdata->cb_data = par;
+   }
+
+   if (par && decompress_parallel_push(par, path,
+            cdata, cmode, csize, size, crc32))
+      return true;
+#endif
+
+   return file_archive_perform_mode(path, valid_exts,
+         cdata, cmode, csize, size, crc32, userdata);
+}
+
+/* Sets the task error, joining any pending extraction
+ * first. Extraction errors found by the callbacks on
+ * this thread take precedence. */
+static void task_decompress_set_error(retro_task_t *task,
+      decompress_state_t *dec)
+{
+   char *error = dec->callback_error;
+#ifdef HAVE_THREADS
+   char *parallel_error = decompress_parallel_finish(dec);
+
+   if (!error)
+      error = parallel_error;
+   else if (parallel_error)
+      free(parallel_error);
+#endif
+   task_set_error(task, error);
+}
+
 static int file_decompressed_target_file(const char *name,
       const char *valid_exts,
       const uint8_t *cdata,
@@ -67,7 +320,7 @@ static int file_decompressed_subdir(const char *name,
    if (!path_mkdir(path_dir))
       goto error;
 
-   if (!file_archive_perform_mode(path, valid_exts,
+   if (!task_decompress_member(path, valid_exts,
             cdata, cmode, csize, size, crc32, userdata))
       goto error;
 
@@ -105,7 +358,7 @@ static int file_decompressed(const char *name, const char *valid_exts,
 
    fill_pathname_join(path, dec->target_dir, name, sizeof(path));
 
-   if (!file_archive_perform_mode(path, valid_exts,
+   if (!task_decompress_member(path, valid_exts,
             cdata, cmode, csize, size, crc32, userdata))
       goto error;
 
@@ -169,7 +422,7 @@ static void task_decompress_handler(retro_task_t *task)
 
    if (task_get_cancelled(task) || ret != 0)
    {
-      task_set_error(task, dec->callback_error);
+      task_decompress_set_error(task, dec);
       file_archive_parse_file_iterate_stop(&dec->archive);
 
       task_decompress_handler_finished(task, dec);
@@ -195,7 +448,7 @@ static void task_decompress_handler_target_file(retro_task_t *task)
 
    if (task_get_cancelled(task) || ret != 0)
    {
-      task_set_error(task, dec->callback_error);
+      task_decompress_set_error(task, dec);
       file_archive_parse_file_iterate_stop(&dec->archive);
 
       task_decompress_handler_finished(task, dec);
@@ -223,7 +476,7 @@ static void task_decompress_handler_subdir(retro_task_t *task)
 
    if (task_get_cancelled(task) || ret != 0)
    {
-      task_set_error(task, dec->callback_error);
+      task_decompress_set_error(task, dec);
       file_archive_parse_file_iterate_stop(&dec->archive);
 
       task_decompress_handler_finished(task, dec);
@@ -0,0 +1,242 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <boolean.h>
+
+#include <lists/dir_list.h>
+#include <lists/string_list.h>
+#include <queues/task_queue.h>
+
+#include "tasks_internal.h"
+
+/* Entries read synchronously when the listing is created.
+ * Most directories fit, and are then complete right away */
+#define DIR_LIST_ASYNC_FIRST_BATCH 256
+/* Later batches double in size up to this, so that callers
+ * rebuilding their view after every batch stay O(n) overall */
+#define DIR_LIST_ASYNC_MAX_BATCH   8192
+
+struct dir_list_async
+{
+   dir_list_reader_t *reader;
+   retro_task_t *task;
+   dir_list_async_cb_t cb;
+   void *user_data;
+   /* Sorted entries read so far. Only touched
+    * on the main thread */
+   struct string_list list;
+   /* Filled by the task handler while a batch
+    * task is in flight */
+   struct string_list batch;
+   size_t batch_size;
+   bool batch_eof;
+   bool batch_failed;
+   bool dir_first;
+   bool pending;
+   bool eof;
+   bool failed;
+   bool released;
+};
+
+static void dir_list_async_release(dir_list_async_t *listing)
+{
+   dir_list_reader_free(listing->reader);
+   string_list_deinitialize(&listing->list);
+   string_list_deinitialize(&listing->batch);
+   free(listing);
+}
+
+/* Moves the entries of the last batch into the sorted list */
+static void dir_list_async_take_batch(dir_list_async_t *listing)
+{
+   size_t i;
+   size_t sorted = listing->list.size;
+
+   for (i = 0; i < listing->batch.size; i++)
+   {
+      if (!string_list_append(&listing->list,
+               listing->batch.elems[i].data,
+               listing->batch.elems[i].attr))
+      {
+         listing->failed = true;
+         break;
+      }
+   }
+
+   string_list_deinitialize(&listing->batch);
+   string_list_initialize(&listing->batch);
+
+   dir_list_sort_merge(&listing->list, sorted, listing->dir_first);
+
+   if (listing->failed)
+      listing->eof = true;
+
+   if (listing->eof)
+   {
+      dir_list_reader_free(listing->reader);
+      listing->reader = NULL;
+   }
+}
+
+static void task_dir_list_handler(retro_task_t *task)
+{
+   dir_list_async_t *listing = (dir_list_async_t*)task->state;
+
+   if (!task_get_cancelled(task))
+   {
+      int ret = dir_list_reader_read(listing->reader,
+            &listing->batch, listing->batch_size);
+
+      if (ret < 0)
+         listing->batch_failed = true;
+      else if ((size_t)ret < listing->batch_size)
+         listing->batch_eof    = true;
+   }
+
+   task_set_finished(task, true);
+}
+
+static bool task_dir_list_push_batch(dir_list_async_t *listing);
+
+static void cb_task_dir_list(retro_task_t *task,
+      void *task_data, void *user_data, const char *err)
+{
+   dir_list_async_t *listing = (dir_list_async_t*)task->state;
+
+   listing->task    = NULL;
+   listing->pending = false;
+
+   if (listing->released)
+   {
+      dir_list_async_release(listing);
+      return;
+   }
+
+   listing->eof    = listing->batch_eof;
+   listing->failed = listing->batch_failed;
+
+   /* The task queue is going away; keep what was read */
+   if (task_get_cancelled(task))
+      listing->eof = true;
+
+   dir_list_async_take_batch(listing);
+
+   if (!listing->eof)
+   {
+      if (listing->batch_size < DIR_LIST_ASYNC_MAX_BATCH)
+         listing->batch_size *= 2;
+      if (!task_dir_list_push_batch(listing))
+         listing->eof = true;
+   }
+
+   /* Must come last, the callback may free the listing */
+   if (listing->cb)
+      listing->cb(listing, listing->user_data);
+}
+
+static bool task_dir_list_push_batch(dir_list_async_t *listing)
+{
+   retro_task_t *task = task_init();
+
+   if (!task)
+      return false;
+
+   task->handler      = task_dir_list_handler;
+   task->callback     = cb_task_dir_list;
+   task->state        = listing;
+   task->mute         = true;
+
+   listing->task      = task;
+   listing->pending   = true;
+
+   task_queue_push(task);
+
+   return true;
+}
+
+dir_list_async_t *task_push_dir_list(const char *dir, const char *ext,
+      bool include_dirs, bool include_hidden, bool include_compressed,
+      bool dir_first, dir_list_async_cb_t cb, void *user_data)
+{
+   int ret;
+   dir_list_async_t *listing = (dir_list_async_t*)
+      calloc(1, sizeof(*listing));
+
+   if (!listing)
+      return NULL;
+
+   string_list_initialize(&listing->list);
+   string_list_initialize(&listing->batch);
+
+   listing->cb         = cb;
+   listing->user_data  = user_data;
+   listing->dir_first  = dir_first;
+   listing->batch_size = DIR_LIST_ASYNC_FIRST_BATCH;
+
+   if (!(listing->reader = dir_list_reader_new(dir, ext,
+               include_dirs, include_hidden, include_compressed)))
+      goto error;
+
+   if ((ret = dir_list_reader_read(listing->reader,
+               &listing->batch, listing->batch_size)) < 0)
+      goto error;
+
+   listing->eof = (size_t)ret < listing->batch_size;
+
+   dir_list_async_take_batch(listing);
+
+   if (!listing->eof)
+   {
+      listing->batch_size *= 2;
+      if (!task_dir_list_push_batch(listing))
+         listing->eof = true;
+   }
+
+   return listing;
+
+error:
+   dir_list_async_release(listing);
+   return NULL;
+}
+
+const struct string_list *dir_list_async_get_list(
+      const dir_list_async_t *listing)
+{
+   return listing ? &listing->list : NULL;
+}
+
+bool dir_list_async_is_finished(const dir_list_async_t *listing)
+{
+   return !listing || listing->eof;
+}
+
+void dir_list_async_free(dir_list_async_t *listing)
+{
+   if (!listing)
+      return;
+
+   /* The task in flight owns the listing until
+    * its callback runs */
+   listing->cb        = NULL;
+   if (listing->pending)
+   {
+      listing->released = true;
+      task_queue_cancel_task(listing->task);
+   }
+   else
+      dir_list_async_release(listing);
+}
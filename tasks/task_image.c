@@ -19,16 +19,32 @@
 #include <errno.h>
 
 #include <file/nbio.h>
+#include <file/file_path.h>
 #include <formats/image.h>
 #include <compat/strl.h>
+#include <encodings/crc32.h>
+#include <lists/dir_list.h>
+#include <streams/file_stream.h>
 #include <string/stdstring.h>
 #include <retro_miscellaneous.h>
 #include <features/features_cpu.h>
 
+#if (defined(_WIN32) && !defined(_XBOX)) || defined(__unix__) || defined(__APPLE__)
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <sys/utime.h>
+#else
+#include <utime.h>
+#endif
+#define HAVE_IMAGE_CACHE
+#endif
+
 #include "task_file_transfer.h"
 #include "tasks_internal.h"
 
 #include "../configuration.h"
+#include "../retroarch.h"
 
 enum image_status_enum
 {
@@ -39,15 +55,67 @@ enum image_status_enum
    IMAGE_STATUS_PROCESS_TRANSFER_PARSE
 };
 
+/* On-disk image cache entries consist of a fixed
+ * header (IMAGE_CACHE_HEADER_WORDS native endian
+ * uint32_t values), followed by the source image
+ * path and the decoded (colour converted and, if
+ * required, upscaled or downscaled) pixel data */
+#define IMAGE_CACHE_MAGIC        0x43485452 /* 'RTHC' */
+#define IMAGE_CACHE_VERSION      2
+#define IMAGE_CACHE_HEADER_WORDS 12
+#define IMAGE_CACHE_DIR          "thumbnails"
+#define IMAGE_CACHE_EXT          "rtc"
+
+/* Once the cache directory grows beyond this size,
+ * least recently used entries are deleted until it
+ * is back under IMAGE_CACHE_SIZE_TARGET */
+#define IMAGE_CACHE_SIZE_MAX     (128 * 1024 * 1024)
+#define IMAGE_CACHE_SIZE_TARGET  (96 * 1024 * 1024)
+
+enum image_cache_header
+{
+   IMAGE_CACHE_HDR_MAGIC = 0,
+   IMAGE_CACHE_HDR_VERSION,
+   IMAGE_CACHE_HDR_WIDTH,
+   IMAGE_CACHE_HDR_HEIGHT,
+   IMAGE_CACHE_HDR_UPSCALE,
+   IMAGE_CACHE_HDR_RGBA,
+   IMAGE_CACHE_HDR_MTIME_LO,
+   IMAGE_CACHE_HDR_MTIME_HI,
+   IMAGE_CACHE_HDR_SIZE_LO,
+   IMAGE_CACHE_HDR_SIZE_HI,
+   IMAGE_CACHE_HDR_MAX_SIZE,
+   IMAGE_CACHE_HDR_PATH_LEN
+};
+
+#ifdef HAVE_IMAGE_CACHE
+typedef struct
+{
+   const char *path;
+   uint64_t size;
+   time_t mtime;
+} image_cache_file_t;
+
+/* Total size of the cache directory, or -1 until it
+ * has been measured. Only accessed by image task
+ * handlers, which the task queue never runs
+ * concurrently */
+static int64_t image_cache_total_size = -1;
+#endif
+
 struct nbio_image_handle
 {
    void *handle;
+   char *cache_path;
    transfer_cb_t  cb;
    struct texture_image ti; /* ptr alignment */
+   uint64_t src_mtime;
+   uint64_t src_size;
    size_t size;
    int processing_final_state;
    unsigned frame_duration;
    unsigned upscale_threshold;
+   unsigned max_size;
    enum image_type_enum type;
    enum image_status_enum status;
    bool is_blocking;
@@ -164,6 +232,10 @@ static void task_image_cleanup(nbio_handle_t *nbio)
 
       image->handle                 = NULL;
       image->cb                     = NULL;
+
+      if (image->cache_path)
+         free(image->cache_path);
+      image->cache_path             = NULL;
    }
    if (!string_is_empty(nbio->path))
       free(nbio->path);
@@ -272,6 +344,420 @@ static bool upscale_image(
    return true;
 }
 
+/* Reduces an image to fit within 'max_size' pixels in
+ * each dimension, averaging all source pixels covered
+ * by each output pixel */
+static bool downscale_image(
+      unsigned max_size,
+      struct texture_image *image_src,
+      struct texture_image *image_dst)
+{
+   unsigned x_dst, y_dst;
+   unsigned larger_side;
+
+   /* Sanity check */
+   if ((max_size < 1) || !image_src || !image_dst)
+      return false;
+
+   if (!image_src->pixels || (image_src->width < 1) || (image_src->height < 1))
+      return false;
+
+   larger_side = (image_src->width > image_src->height) ?
+         image_src->width : image_src->height;
+
+   if (larger_side <= max_size)
+      return false;
+
+   /* Get output dimensions, preserving aspect ratio */
+   image_dst->width  = (unsigned)(((uint64_t)image_src->width  * max_size
+         + larger_side / 2) / larger_side);
+   image_dst->height = (unsigned)(((uint64_t)image_src->height * max_size
+         + larger_side / 2) / larger_side);
+
+   if (image_dst->width < 1)
+      image_dst->width = 1;
+   if (image_dst->height < 1)
+      image_dst->height = 1;
+
+   /* Allocate pixel buffer */
+   image_dst->pixels = (uint32_t*)malloc(
+         image_dst->width * image_dst->height * sizeof(uint32_t));
+   if (!image_dst->pixels)
+      return false;
+
+   /* Perform box filter resampling. Channels are
+    * averaged independently, so this works for any
+    * component order */
+   for (y_dst = 0; y_dst < image_dst->height; y_dst++)
+   {
+      unsigned y0 = (unsigned)(((uint64_t)y_dst * image_src->height)
+            / image_dst->height);
+      unsigned y1 = (unsigned)(((uint64_t)(y_dst + 1) * image_src->height)
+            / image_dst->height);
+
+      if (y1 <= y0)
+         y1 = y0 + 1;
+
+      for (x_dst = 0; x_dst < image_dst->width; x_dst++)
+      {
+         unsigned x, y;
+         uint32_t sum[4] = {0};
+         unsigned x0     = (unsigned)(((uint64_t)x_dst * image_src->width)
+               / image_dst->width);
+         unsigned x1     = (unsigned)(((uint64_t)(x_dst + 1) * image_src->width)
+               / image_dst->width);
+         uint32_t count;
+
+         if (x1 <= x0)
+            x1 = x0 + 1;
+
+         count = (x1 - x0) * (y1 - y0);
+
+         for (y = y0; y < y1; y++)
+         {
+            const uint32_t *row = image_src->pixels + y * image_src->width;
+
+            for (x = x0; x < x1; x++)
+            {
+               uint32_t pixel = row[x];
+               sum[0] += (pixel >> 24) & 0xFF;
+               sum[1] += (pixel >> 16) & 0xFF;
+               sum[2] += (pixel >>  8) & 0xFF;
+               sum[3] +=  pixel        & 0xFF;
+            }
+         }
+
+         image_dst->pixels[(y_dst * image_dst->width) + x_dst] =
+                 (((sum[0] + count / 2) / count) << 24)
+               | (((sum[1] + count / 2) / count) << 16)
+               | (((sum[2] + count / 2) / count) <<  8)
+               |  ((sum[3] + count / 2) / count);
+      }
+   }
+
+   return true;
+}
+
+#ifdef HAVE_IMAGE_CACHE
+/* Returns the path of the on-disk cache entry for the
+ * specified source image, or NULL if no cache directory
+ * has been set. Returned string must be free()'d */
+static char *task_image_cache_get_path(const char *fullpath,
+      bool supports_rgba, unsigned upscale_threshold, unsigned max_size)
+{
+   char cache_dir[PATH_MAX_LENGTH];
+   char cache_path[PATH_MAX_LENGTH];
+   char file_name[64];
+   settings_t *settings     = config_get_ptr();
+   const char *dir_cache    = settings ? settings->paths.directory_cache : NULL;
+
+   if (string_is_empty(dir_cache) || string_is_empty(fullpath))
+      return NULL;
+
+   cache_dir[0]  = '\0';
+   cache_path[0] = '\0';
+
+   /* Name is only a hint - the full source path is
+    * stored in (and checked against) the entry header */
+   snprintf(file_name, sizeof(file_name), "%08lx-%u-%u-%u." IMAGE_CACHE_EXT,
+         (unsigned long)encoding_crc32(0,
+            (const uint8_t*)fullpath, strlen(fullpath)),
+         upscale_threshold, max_size, supports_rgba ? 1 : 0);
+
+   fill_pathname_join(cache_dir, dir_cache,
+         IMAGE_CACHE_DIR, sizeof(cache_dir));
+   fill_pathname_join(cache_path, cache_dir,
+         file_name, sizeof(cache_path));
+
+   return strdup(cache_path);
+}
+
+static bool task_image_cache_stat(const char *path,
+      uint64_t *mtime, uint64_t *size)
+{
+   struct stat buf;
+
+   if (stat(path, &buf) != 0)
+      return false;
+
+   *mtime = (uint64_t)buf.st_mtime;
+   *size  = (uint64_t)buf.st_size;
+
+   return true;
+}
+
+static int task_image_cache_file_cmp(const void *a, const void *b)
+{
+   const image_cache_file_t *file_a = (const image_cache_file_t*)a;
+   const image_cache_file_t *file_b = (const image_cache_file_t*)b;
+
+   if (file_a->mtime < file_b->mtime)
+      return -1;
+   if (file_a->mtime > file_b->mtime)
+      return 1;
+   return 0;
+}
+
+/* Measures the cache directory. If it is larger than
+ * IMAGE_CACHE_SIZE_MAX, deletes the least recently used
+ * entries (cache hits refresh the modification time of
+ * an entry) until it is below IMAGE_CACHE_SIZE_TARGET */
+static void task_image_cache_trim(const char *cache_dir)
+{
+   size_t i;
+   uint64_t total_size        = 0;
+   image_cache_file_t *files  = NULL;
+   struct string_list *list   = dir_list_new(cache_dir,
+         IMAGE_CACHE_EXT, false, false, false, false);
+
+   if (!list)
+      return;
+
+   if (list->size &&
+       !(files = (image_cache_file_t*)malloc(
+             list->size * sizeof(image_cache_file_t))))
+   {
+      dir_list_free(list);
+      return;
+   }
+
+   for (i = 0; i < list->size; i++)
+   {
+      struct stat buf;
+
+      files[i].path  = list->elems[i].data;
+      files[i].size  = 0;
+      files[i].mtime = 0;
+
+      if (stat(files[i].path, &buf) != 0)
+         continue;
+
+      files[i].size  = (uint64_t)buf.st_size;
+      files[i].mtime = buf.st_mtime;
+      total_size    += files[i].size;
+   }
+
+   if (total_size > IMAGE_CACHE_SIZE_MAX)
+   {
+      qsort(files, list->size, sizeof(image_cache_file_t),
+            task_image_cache_file_cmp);
+
+      for (i = 0; (i < list->size) &&
+            (total_size > IMAGE_CACHE_SIZE_TARGET); i++)
+         if (!filestream_delete(files[i].path))
+            total_size -= files[i].size;
+   }
+
+   image_cache_total_size = (int64_t)total_size;
+
+   free(files);
+   dir_list_free(list);
+}
+
+/* Attempts to read a valid cache entry for the
+ * source image at 'src_path'. An entry is only
+ * accepted if the source path, modification time,
+ * file size and scaling/format parameters all match */
+static bool task_image_cache_read(
+      struct nbio_image_handle *image, const char *src_path,
+      bool supports_rgba, struct texture_image *img)
+{
+   uint32_t header[IMAGE_CACHE_HEADER_WORDS];
+   char cached_src_path[PATH_MAX_LENGTH];
+   size_t path_len   = strlen(src_path);
+   size_t pixels_len = 0;
+   uint32_t *pixels  = NULL;
+   RFILE *file       = filestream_open(image->cache_path,
+         RETRO_VFS_FILE_ACCESS_READ,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (!file)
+      return false;
+
+   if (filestream_read(file, header, sizeof(header)) != sizeof(header))
+      goto error;
+
+   if (  (header[IMAGE_CACHE_HDR_MAGIC]    != IMAGE_CACHE_MAGIC)
+      || (header[IMAGE_CACHE_HDR_VERSION]  != IMAGE_CACHE_VERSION)
+      || (header[IMAGE_CACHE_HDR_UPSCALE]  != image->upscale_threshold)
+      || (header[IMAGE_CACHE_HDR_RGBA]     != (supports_rgba ? 1 : 0))
+      || (header[IMAGE_CACHE_HDR_MTIME_LO] != (uint32_t)image->src_mtime)
+      || (header[IMAGE_CACHE_HDR_MTIME_HI] != (uint32_t)(image->src_mtime >> 32))
+      || (header[IMAGE_CACHE_HDR_SIZE_LO]  != (uint32_t)image->src_size)
+      || (header[IMAGE_CACHE_HDR_SIZE_HI]  != (uint32_t)(image->src_size >> 32))
+      || (header[IMAGE_CACHE_HDR_MAX_SIZE] != image->max_size)
+      || (header[IMAGE_CACHE_HDR_PATH_LEN] != path_len)
+      || (path_len >= sizeof(cached_src_path)))
+      goto error;
+
+   if ((header[IMAGE_CACHE_HDR_WIDTH]  < 1) ||
+       (header[IMAGE_CACHE_HDR_HEIGHT] < 1) ||
+       (header[IMAGE_CACHE_HDR_WIDTH]  > 0x4000) ||
+       (header[IMAGE_CACHE_HDR_HEIGHT] > 0x4000))
+      goto error;
+
+   if (filestream_read(file, cached_src_path, path_len) != (int64_t)path_len)
+      goto error;
+
+   if (memcmp(cached_src_path, src_path, path_len))
+      goto error;
+
+   pixels_len = header[IMAGE_CACHE_HDR_WIDTH] *
+         header[IMAGE_CACHE_HDR_HEIGHT] * sizeof(uint32_t);
+
+   if (filestream_get_size(file) !=
+         (int64_t)(sizeof(header) + path_len + pixels_len))
+      goto error;
+
+   if (!(pixels = (uint32_t*)malloc(pixels_len)))
+      goto error;
+
+   if (filestream_read(file, pixels, pixels_len) != (int64_t)pixels_len)
+      goto error;
+
+   filestream_close(file);
+
+   /* Mark entry as recently used */
+   utime(image->cache_path, NULL);
+
+   img->width         = header[IMAGE_CACHE_HDR_WIDTH];
+   img->height        = header[IMAGE_CACHE_HDR_HEIGHT];
+   img->pixels        = pixels;
+   img->supports_rgba = image->ti.supports_rgba;
+
+   return true;
+
+error:
+   if (pixels)
+      free(pixels);
+   filestream_close(file);
+   return false;
+}
+
+/* Writes the decoded image to the cache. Data is
+ * written to a temporary file which then replaces
+ * any existing entry, so a partially written file
+ * can never be picked up by a concurrent load. The
+ * temporary file name is unique to this load, since
+ * the same image may be loaded more than once at a
+ * time */
+static void task_image_cache_write(
+      struct nbio_image_handle *image, const char *src_path,
+      bool supports_rgba, const struct texture_image *img)
+{
+   uint32_t header[IMAGE_CACHE_HEADER_WORDS];
+   char cache_dir[PATH_MAX_LENGTH];
+   char tmp_path[PATH_MAX_LENGTH];
+   size_t path_len   = strlen(src_path);
+   size_t pixels_len = img->width * img->height * sizeof(uint32_t);
+   uint64_t old_size = 0;
+   uint64_t old_time = 0;
+   RFILE *file       = NULL;
+   bool success      = false;
+
+   cache_dir[0] = '\0';
+   tmp_path[0]  = '\0';
+
+   fill_pathname_basedir(cache_dir, image->cache_path, sizeof(cache_dir));
+   if (!path_is_directory(cache_dir) && !path_mkdir(cache_dir))
+      return;
+
+   snprintf(tmp_path, sizeof(tmp_path), "%s.%lx.tmp",
+         image->cache_path, (unsigned long)(uintptr_t)image);
+
+   if (!(file = filestream_open(tmp_path,
+         RETRO_VFS_FILE_ACCESS_WRITE,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+      return;
+
+   header[IMAGE_CACHE_HDR_MAGIC]    = IMAGE_CACHE_MAGIC;
+   header[IMAGE_CACHE_HDR_VERSION]  = IMAGE_CACHE_VERSION;
+   header[IMAGE_CACHE_HDR_WIDTH]    = img->width;
+   header[IMAGE_CACHE_HDR_HEIGHT]   = img->height;
+   header[IMAGE_CACHE_HDR_UPSCALE]  = image->upscale_threshold;
+   header[IMAGE_CACHE_HDR_RGBA]     = supports_rgba ? 1 : 0;
+   header[IMAGE_CACHE_HDR_MTIME_LO] = (uint32_t)image->src_mtime;
+   header[IMAGE_CACHE_HDR_MTIME_HI] = (uint32_t)(image->src_mtime >> 32);
+   header[IMAGE_CACHE_HDR_SIZE_LO]  = (uint32_t)image->src_size;
+   header[IMAGE_CACHE_HDR_SIZE_HI]  = (uint32_t)(image->src_size >> 32);
+   header[IMAGE_CACHE_HDR_MAX_SIZE] = image->max_size;
+   header[IMAGE_CACHE_HDR_PATH_LEN] = (uint32_t)path_len;
+
+   success = (filestream_write(file, header, sizeof(header))
+            == sizeof(header))
+         && (filestream_write(file, src_path, path_len)
+            == (int64_t)path_len)
+         && (filestream_write(file, img->pixels, pixels_len)
+            == (int64_t)pixels_len);
+
+   filestream_close(file);
+
+   if (success)
+   {
+      /* rename() will not replace an existing
+       * file on all platforms */
+      if (task_image_cache_stat(image->cache_path, &old_time, &old_size))
+         filestream_delete(image->cache_path);
+      success = (filestream_rename(tmp_path, image->cache_path) == 0);
+   }
+
+   if (!success)
+   {
+      filestream_delete(tmp_path);
+      return;
+   }
+
+   /* Enforce size budget */
+   if (image_cache_total_size >= 0)
+      image_cache_total_size += (int64_t)(sizeof(header) + path_len
+            + pixels_len) - (int64_t)old_size;
+
+   if (     (image_cache_total_size < 0)
+         || (image_cache_total_size > IMAGE_CACHE_SIZE_MAX))
+      task_image_cache_trim(cache_dir);
+}
+
+/* Initial handler for cached image loads: serves the
+ * image directly from the cache if a valid entry is
+ * available, otherwise falls through to the regular
+ * file load/decode handler */
+static void task_image_cache_load_handler(retro_task_t *task)
+{
+   nbio_handle_t            *nbio  = (nbio_handle_t*)task->state;
+   struct nbio_image_handle *image = (struct nbio_image_handle*)nbio->data;
+   bool supports_rgba              = BIT32_GET(nbio->status_flags,
+         NBIO_FLAG_IMAGE_SUPPORTS_RGBA);
+
+   if (task_image_cache_stat(nbio->path,
+            &image->src_mtime, &image->src_size))
+   {
+      struct texture_image *img = (struct texture_image*)
+         malloc(sizeof(struct texture_image));
+
+      if (img)
+      {
+         if (task_image_cache_read(image, nbio->path, supports_rgba, img))
+         {
+            task_set_data(task, img);
+            task_set_finished(task, true);
+            return;
+         }
+
+         free(img);
+      }
+   }
+   else
+   {
+      /* Source cannot be identified - disable caching */
+      free(image->cache_path);
+      image->cache_path = NULL;
+   }
+
+   task->handler = task_file_load_handler;
+   task_file_load_handler(task);
+}
+#endif
+
 bool task_image_load_handler(retro_task_t *task)
 {
    nbio_handle_t            *nbio  = (nbio_handle_t*)task->state;
@@ -366,10 +852,38 @@ bool task_image_load_handler(retro_task_t *task)
             }
          }
 
+         /* Downscale image, if required */
+         if (image->max_size > 0)
+         {
+            struct texture_image img_resampled = {
+               NULL,
+               0,
+               0,
+               false
+            };
+
+            if (downscale_image(image->max_size, &image->ti, &img_resampled))
+            {
+               image->ti.width  = img_resampled.width;
+               image->ti.height = img_resampled.height;
+
+               if (image->ti.pixels)
+                  free(image->ti.pixels);
+               image->ti.pixels = img_resampled.pixels;
+            }
+         }
+
          img->width         = image->ti.width;
          img->height        = image->ti.height;
          img->pixels        = image->ti.pixels;
          img->supports_rgba = image->ti.supports_rgba;
+
+#ifdef HAVE_IMAGE_CACHE
+         if (image->cache_path && img->pixels)
+            task_image_cache_write(image, nbio->path,
+                  BIT32_GET(nbio->status_flags,
+                     NBIO_FLAG_IMAGE_SUPPORTS_RGBA), img);
+#endif
       }
 
       task_set_data(task, img);
@@ -380,8 +894,8 @@ bool task_image_load_handler(retro_task_t *task)
    return true;
 }
 
-bool task_push_image_load(const char *fullpath, 
-      bool supports_rgba, unsigned upscale_threshold,
+static bool task_image_load_push(const char *fullpath,
+      bool supports_rgba, unsigned upscale_threshold, bool use_cache,
       retro_task_callback_t cb, void *user_data)
 {
    nbio_handle_t             *nbio   = NULL;
@@ -430,7 +944,11 @@ bool task_push_image_load(const char *fullpath,
    image->frame_duration             = 0;
    image->size                       = 0;
    image->upscale_threshold          = upscale_threshold;
+   image->max_size                   = 0;
    image->handle                     = NULL;
+   image->cache_path                 = NULL;
+   image->src_mtime                  = 0;
+   image->src_size                   = 0;
 
    image->ti.width                   = 0;
    image->ti.height                  = 0;
@@ -465,7 +983,54 @@ bool task_push_image_load(const char *fullpath,
    t->callback        = cb;
    t->user_data       = user_data;
 
+#ifdef HAVE_IMAGE_CACHE
+   if (use_cache && (nbio->type != NBIO_TYPE_NONE))
+   {
+      unsigned video_width  = 0;
+      unsigned video_height = 0;
+
+      /* A thumbnail is never drawn larger than the
+       * screen, so larger images are stored reduced.
+       * The bound is rounded up to a power of two, so
+       * that small window size changes keep hitting
+       * the same cache entries */
+      video_driver_get_size(&video_width, &video_height);
+      if (video_height > video_width)
+         video_width = video_height;
+      if (video_width > 0)
+      {
+         image->max_size = 256;
+         while (image->max_size < video_width)
+            image->max_size <<= 1;
+      }
+
+      image->cache_path = task_image_cache_get_path(fullpath,
+            supports_rgba, upscale_threshold, image->max_size);
+
+      if (image->cache_path)
+         t->handler     = task_image_cache_load_handler;
+      else
+         image->max_size = 0;
+   }
+#endif
+
    task_queue_push(t);
 
    return true;
 }
+
+bool task_push_image_load(const char *fullpath,
+      bool supports_rgba, unsigned upscale_threshold,
+      retro_task_callback_t cb, void *user_data)
+{
+   return task_image_load_push(fullpath, supports_rgba,
+         upscale_threshold, false, cb, user_data);
+}
+
+bool task_push_image_load_cached(const char *fullpath,
+      bool supports_rgba, unsigned upscale_threshold,
+      retro_task_callback_t cb, void *user_data)
+{
+   return task_image_load_push(fullpath, supports_rgba,
+         upscale_threshold, true, cb, user_data);
+}
@@ -623,7 +623,9 @@ static bool apply_patch_content(uint8_t **buf,
    if ((err = func((const uint8_t*)patch_data, patch_size, ret_buf,
          ret_size, &patched_content, &target_size)) == PATCH_SUCCESS)
    {
-      free(ret_buf);
+      /* The source buffer is not freed here - it may not
+       * come from malloc(). The caller owns it and has to
+       * release it once *buf points to the patched content. */
       *buf  = patched_content;
       *size = target_size;
    }
@@ -723,6 +725,10 @@ static bool try_ips_patch(bool allow_ips,
  *
  * Apply patch to the content file in-memory.
  *
+ * On success @buf is replaced by a newly allocated buffer
+ * holding the patched content; the original buffer is left
+ * untouched and still has to be freed by the caller.
+ *
  **/
 bool patch_content(
       bool is_ips_pref,
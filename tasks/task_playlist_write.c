@@ -0,0 +1,141 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <boolean.h>
+
+#include <features/features_cpu.h>
+#include <queues/task_queue.h>
+
+#include "tasks_internal.h"
+
+/* Time between the first write request and the write,
+ * during which further requests are coalesced */
+#define PLAYLIST_WRITE_DELAY_USEC 1000000
+
+/* Write-behind state. Only touched on the main thread.
+ * A single timer/write task chain is active while there
+ * are queued or unfinished writes, so that playlist files
+ * are always written in request order */
+static bool playlist_write_scheduled = false;
+static unsigned playlist_write_tasks = 0;
+
+static void task_playlist_write_schedule(void);
+
+static void task_playlist_write_handler(retro_task_t *task)
+{
+   /* Writes are not cancellable: once taken, the
+    * snapshots are the only copy of the changes */
+   playlist_write_snapshots((playlist_snapshot_t*)task->state);
+   task_set_finished(task, true);
+}
+
+static void cb_task_playlist_write(retro_task_t *task,
+      void *task_data, void *user_data, const char *err)
+{
+   playlist_release_snapshots((playlist_snapshot_t*)task->state);
+   playlist_write_tasks--;
+
+   playlist_write_scheduled = false;
+
+   /* Requests made while writing */
+   if (playlist_has_deferred_writes())
+      task_playlist_write_schedule();
+}
+
+static void task_playlist_write_timer_handler(retro_task_t *task)
+{
+   task_set_finished(task, true);
+}
+
+static void cb_task_playlist_write_timer(retro_task_t *task,
+      void *task_data, void *user_data, const char *err)
+{
+   retro_task_t *write_task       = NULL;
+   playlist_snapshot_t *snapshots = playlist_take_deferred_writes();
+
+   if (!snapshots)
+   {
+      playlist_write_scheduled = false;
+      return;
+   }
+
+   if (!(write_task = task_init()))
+   {
+      playlist_write_snapshots(snapshots);
+      playlist_release_snapshots(snapshots);
+      playlist_write_scheduled = false;
+      return;
+   }
+
+   write_task->handler  = task_playlist_write_handler;
+   write_task->callback = cb_task_playlist_write;
+   write_task->state    = snapshots;
+   write_task->mute     = true;
+
+   playlist_write_tasks++;
+
+   task_queue_push(write_task);
+}
+
+static void task_playlist_write_schedule(void)
+{
+   retro_task_t *task = NULL;
+
+   if (playlist_write_scheduled)
+      return;
+
+   /* Queued writes are kept until the next request
+    * or task_playlist_write_flush() */
+   if (!(task = task_init()))
+      return;
+
+   task->handler            = task_playlist_write_timer_handler;
+   task->callback           = cb_task_playlist_write_timer;
+   task->when               = cpu_features_get_time_usec()
+      + PLAYLIST_WRITE_DELAY_USEC;
+   task->mute               = true;
+
+   playlist_write_scheduled = true;
+
+   task_queue_push(task);
+}
+
+void task_push_playlist_write(playlist_t *playlist)
+{
+   playlist_write_file_deferred(playlist);
+
+   if (playlist_has_deferred_writes())
+      task_playlist_write_schedule();
+}
+
+static bool task_playlist_write_in_progress(void *data)
+{
+   return playlist_write_tasks > 0;
+}
+
+void task_playlist_write_flush(void)
+{
+   playlist_snapshot_t *snapshots = NULL;
+
+   /* Snapshots in flight are older than queued ones */
+   while (playlist_write_tasks)
+      task_queue_wait(task_playlist_write_in_progress, NULL);
+
+   snapshots = playlist_take_deferred_writes();
+
+   playlist_write_snapshots(snapshots);
+   playlist_release_snapshots(snapshots);
+}
@@ -149,10 +149,59 @@ bool task_push_core_restore(const char *backup_path,
 bool task_push_pl_manager_reset_cores(const playlist_config_t *playlist_config);
 bool task_push_pl_manager_clean_playlist(const playlist_config_t *playlist_config);
 
+/* Queues a write-behind save of a modified playlist.
+ * Requests made within a short delay are coalesced,
+ * and the file is written on a background task.
+ * Main thread only */
+void task_push_playlist_write(playlist_t *playlist);
+
+/* Writes all queued playlists before returning.
+ * Must be called before exiting */
+void task_playlist_write_flush(void);
+
 bool task_push_image_load(const char *fullpath,
       bool supports_rgba, unsigned upscale_threshold,
       retro_task_callback_t cb, void *userdata);
 
+/* As task_push_image_load(), but images larger than the
+ * screen are reduced to fit it, and decoded images are
+ * stored in (and subsequently served from) an on-disk
+ * cache under the cache directory, keyed by source path,
+ * modification time, size, upscale threshold and size
+ * bound. The cache is kept under a fixed size budget by
+ * evicting least recently used entries. Not suitable for
+ * files that are overwritten in place */
+bool task_push_image_load_cached(const char *fullpath,
+      bool supports_rgba, unsigned upscale_threshold,
+      retro_task_callback_t cb, void *userdata);
+
+/* Asynchronous directory listing */
+
+typedef struct dir_list_async dir_list_async_t;
+
+typedef void (*dir_list_async_cb_t)(dir_list_async_t *listing,
+      void *user_data);
+
+/* Lists a directory the way dir_list_new() does
+ * (not recursively), keeping the entries sorted as by
+ * dir_list_sort(). The first entries are read right away;
+ * if the directory has more, the rest are read in growing
+ * batches by background tasks and 'cb' is called on the
+ * main thread after each of them.
+ * Returns NULL if the directory could not be opened. */
+dir_list_async_t *task_push_dir_list(const char *dir, const char *ext,
+      bool include_dirs, bool include_hidden, bool include_compressed,
+      bool dir_first, dir_list_async_cb_t cb, void *user_data);
+
+const struct string_list *dir_list_async_get_list(
+      const dir_list_async_t *listing);
+
+bool dir_list_async_is_finished(const dir_list_async_t *listing);
+
+/* Stops the listing (if still running) and frees it.
+ * 'cb' is not called anymore afterwards */
+void dir_list_async_free(dir_list_async_t *listing);
+
 #ifdef HAVE_LIBRETRODB
 bool task_push_dbscan(
       const char *playlist_directory,
@@ -0,0 +1,302 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Reference receiver for the network video driver's streaming protocol.
+ * See gfx/common/network_common.h for the wire format. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <zlib.h>
+
+#include <retro_endianness.h>
+#include <retro_miscellaneous.h>
+#include <compat/getopt.h>
+#include <net/net_compat.h>
+#include <net/net_socket.h>
+
+/* Only for #defines */
+#include "../../gfx/common/network_common.h"
+
+struct nv_frame
+{
+   uint32_t *pixels;
+   unsigned width;
+   unsigned height;
+   unsigned pixfmt;
+};
+
+static void usage(void)
+{
+   fprintf(stderr,
+         "Usage: nvreceiver [options]\n"
+         "\n"
+         "  -P|--port <port>    Port to listen on (default 4953).\n"
+         "  -o|--output <file>  Write each decoded frame to <file> as PPM.\n"
+         "  -n|--frames <n>     Exit after <n> frames.\n"
+         "  -q|--quiet          Don't print per-frame statistics.\n");
+}
+
+static bool write_ppm(const char *path, const struct nv_frame *frame)
+{
+   unsigned i;
+   FILE *fp = fopen(path, "wb");
+
+   if (!fp)
+      return false;
+
+   fprintf(fp, "P6\n%u %u\n255\n", frame->width, frame->height);
+
+   for (i = 0; i < frame->width * frame->height; i++)
+   {
+      uint32_t px = frame->pixels[i];
+      uint8_t rgb[3];
+
+      /* Pixels are 0xAARRGGBB for BGRA8888 and 0xAABBGGRR for RGBA8888 */
+      if (frame->pixfmt == NETWORK_VIDEO_PIXELFORMAT_RGBA8888)
+      {
+         rgb[0] = (uint8_t)(px >>  0);
+         rgb[1] = (uint8_t)(px >>  8);
+         rgb[2] = (uint8_t)(px >> 16);
+      }
+      else
+      {
+         rgb[0] = (uint8_t)(px >> 16);
+         rgb[1] = (uint8_t)(px >>  8);
+         rgb[2] = (uint8_t)(px >>  0);
+      }
+
+      fwrite(rgb, 1, sizeof(rgb), fp);
+   }
+
+   fclose(fp);
+   return true;
+}
+
+/* Applies the tiles in @data to @frame. */
+static bool apply_tiles(struct nv_frame *frame, const uint8_t *data,
+      size_t size, unsigned tiles, unsigned tile)
+{
+   const uint8_t *end = data + size;
+   unsigned cols      = (frame->width  + tile - 1) / tile;
+   unsigned rows      = (frame->height + tile - 1) / tile;
+
+   while (tiles--)
+   {
+      unsigned tx, ty, x0, y0, tw, th, y;
+
+      if (end - data < 4)
+         return false;
+
+      tx    = retro_get_unaligned_16be((void*)data);
+      ty    = retro_get_unaligned_16be((void*)(data + 2));
+      data += 4;
+
+      if (tx >= cols || ty >= rows)
+         return false;
+
+      x0 = tx * tile;
+      y0 = ty * tile;
+      tw = MIN(tile, frame->width  - x0);
+      th = MIN(tile, frame->height - y0);
+
+      if ((size_t)(end - data) < (size_t)tw * th * sizeof(uint32_t))
+         return false;
+
+      for (y = 0; y < th; y++, data += tw * sizeof(uint32_t))
+         memcpy(frame->pixels + (size_t)(y0 + y) * frame->width + x0,
+               data, tw * sizeof(uint32_t));
+   }
+
+   return data == end;
+}
+
+int main(int argc, char **argv)
+{
+   struct nv_frame frame;
+   struct addrinfo *addr  = NULL;
+   uint8_t *payload       = NULL;
+   uint8_t *raw           = NULL;
+   size_t payload_size    = 0;
+   size_t raw_capacity    = 0;
+   unsigned long received = 0;
+   unsigned long decoded  = 0;
+   unsigned long limit    = 0;
+   unsigned long long total_bytes = 0;
+   const char *output     = NULL;
+   bool quiet             = false;
+   int port               = 4953;
+   int fd, client;
+
+   const struct option opt[] = {
+      {"port",   1, NULL, 'P'},
+      {"output", 1, NULL, 'o'},
+      {"frames", 1, NULL, 'n'},
+      {"quiet",  0, NULL, 'q'},
+      {NULL,     0, NULL, 0}
+   };
+
+   for (;;)
+   {
+      int c = getopt_long(argc, argv, "P:o:n:q", opt, NULL);
+
+      if (c == -1)
+         break;
+
+      switch (c)
+      {
+         case 'P':
+            port = atoi(optarg);
+            break;
+         case 'o':
+            output = optarg;
+            break;
+         case 'n':
+            limit = strtoul(optarg, NULL, 10);
+            break;
+         case 'q':
+            quiet = true;
+            break;
+         default:
+            usage();
+            return 1;
+      }
+   }
+
+   memset(&frame, 0, sizeof(frame));
+
+   fd = socket_init((void**)&addr, port, NULL, SOCKET_TYPE_STREAM);
+   if (fd < 0 || !socket_bind(fd, addr) || listen(fd, 1) < 0)
+   {
+      perror("listen");
+      return 1;
+   }
+   freeaddrinfo_retro(addr);
+
+   fprintf(stderr, "Waiting for connection on port %d.\n", port);
+
+   if ((client = accept(fd, NULL, NULL)) < 0)
+   {
+      perror("accept");
+      return 1;
+   }
+   socket_close(fd);
+
+   for (;;)
+   {
+      uint8_t header[NETWORK_VIDEO_STREAM_HEADER_SIZE];
+      uint32_t frame_num, flags, raw_size, size;
+      unsigned width, height, tiles, tile, pixfmt;
+      const uint8_t *data;
+
+      if (!socket_receive_all_blocking(client, header, sizeof(header)))
+         break;
+
+      if (retro_get_unaligned_32be(header) != NETWORK_VIDEO_STREAM_MAGIC)
+      {
+         fprintf(stderr, "Bad frame header, is the driver in stream mode?\n");
+         return 1;
+      }
+
+      frame_num = retro_get_unaligned_32be(header + 4);
+      width     = retro_get_unaligned_16be(header + 8);
+      height    = retro_get_unaligned_16be(header + 10);
+      tiles     = retro_get_unaligned_16be(header + 12);
+      tile      = header[14];
+      pixfmt    = header[15];
+      flags     = retro_get_unaligned_32be(header + 16);
+      raw_size  = retro_get_unaligned_32be(header + 20);
+      size      = retro_get_unaligned_32be(header + 24);
+
+      if (size > payload_size)
+      {
+         payload      = (uint8_t*)realloc(payload, size);
+         payload_size = size;
+      }
+
+      if (!payload || !socket_receive_all_blocking(client, payload, size))
+         break;
+
+      received++;
+      total_bytes += sizeof(header) + size;
+      data         = payload;
+
+      if (flags & NETWORK_VIDEO_STREAM_DEFLATE)
+      {
+         uLongf out_len = raw_size;
+
+         if (raw_size > raw_capacity)
+         {
+            raw          = (uint8_t*)realloc(raw, raw_size);
+            raw_capacity = raw_size;
+         }
+
+         if (!raw || uncompress(raw, &out_len, payload, size) != Z_OK
+               || out_len != raw_size)
+         {
+            fprintf(stderr, "Frame %u: inflate failed.\n", frame_num);
+            return 1;
+         }
+         data = raw;
+      }
+
+      if (flags & NETWORK_VIDEO_STREAM_KEYFRAME)
+      {
+         if (width * height > frame.width * frame.height)
+            frame.pixels = (uint32_t*)realloc(frame.pixels,
+                  (size_t)width * height * sizeof(uint32_t));
+         frame.width  = width;
+         frame.height = height;
+         frame.pixfmt = pixfmt;
+      }
+      else if (!frame.pixels || width != frame.width || height != frame.height)
+      {
+         fprintf(stderr, "Frame %u: delta without a keyframe.\n", frame_num);
+         return 1;
+      }
+
+      if (!frame.pixels || !tile
+            || !apply_tiles(&frame, data, raw_size, tiles, tile))
+      {
+         fprintf(stderr, "Frame %u: corrupt tile data.\n", frame_num);
+         return 1;
+      }
+
+      decoded++;
+
+      if (!quiet)
+         printf("frame %u: %ux%u %s%u tiles, %u bytes (%u raw)\n",
+               frame_num, width, height,
+               (flags & NETWORK_VIDEO_STREAM_KEYFRAME) ? "keyframe, " : "",
+               tiles, (unsigned)(sizeof(header) + size), raw_size);
+
+      if (output && !write_ppm(output, &frame))
+         perror(output);
+
+      if (limit && decoded >= limit)
+         break;
+   }
+
+   fprintf(stderr, "%lu frames, %llu bytes received.\n",
+         received, total_bytes);
+
+   socket_close(client);
+   free(frame.pixels);
+   free(payload);
+   free(raw);
+   return 0;
+}